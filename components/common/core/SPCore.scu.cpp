@@ -45,6 +45,8 @@ THE SOFTWARE.
 #include "SPUnicode.cc"
 
 #include "SPData.cc"
+#include "SPDataEncodeJson.cc"
+#include "SPDataDecodeJson.cc"
 #include "SPDataDecompressBuffer.cc"
 #include "SPDataDecryptBuffer.cc"
 #include "SPDataStream.cc"
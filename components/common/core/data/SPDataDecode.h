@@ -27,6 +27,7 @@ THE SOFTWARE.
 #include "SPDataDecodeCbor.h"
 #include "SPDataDecodeJson.h"
 #include "SPDataDecodeSerenity.h"
+#include "SPDataReader.h"
 #include "SPDataStream.h"
 
 NS_SP_EXT_BEGIN(data)
@@ -119,6 +120,41 @@ auto read(const StringType &data, const StringView &key = StringView()) -> Value
 	return ValueTemplate<Interface>();
 }
 
+// reads data with visitor (see SPDataReader.h), Serenity format is not supported
+template <typename Interface = DefaultInterface, typename Visitor>
+bool visit(const BytesView &data, Visitor &v) {
+	if (data.size() == 0) {
+		return false;
+	}
+	auto ff = detectDataFormat(data.data(), data.size());
+	switch (ff) {
+	case DataFormat::Cbor:
+		return cbor::visit<Interface>(data, v);
+		break;
+	case DataFormat::Json:
+		return json::visit<Interface>(StringView((const char *)data.data(), data.size()), v);
+		break;
+	case DataFormat::CborBase64: {
+		auto bytes = base64::decode<Interface>(CoderSource(data));
+		return visit<Interface>(BytesView(bytes.data(), bytes.size()), v);
+		break;
+	}
+	case DataFormat::LZ4_Short:
+	case DataFormat::LZ4_Word:
+	case DataFormat::Brotli_Short:
+	case DataFormat::Brotli_Word: {
+		auto bytes = decompress<Interface>(data.data(), data.size());
+		if (!bytes.empty()) {
+			return visit<Interface>(BytesView(bytes.data(), bytes.size()), v);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+	return false;
+}
+
 template <typename Interface = DefaultInterface>
 auto readFile(const StringView &filename, const StringView &key = StringView()) -> ValueTemplate<Interface> {
 	return read<typename Interface::BytesType, Interface>(filesystem::readIntoMemory<Interface>(filename));
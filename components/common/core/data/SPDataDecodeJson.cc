@@ -0,0 +1,189 @@
+/**
+Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "SPCommon.h"
+#include "SPDataDecodeJson.h"
+
+#include "simde/x86/sse2.h"
+
+#include <charconv>
+
+NS_SP_EXT_BEGIN(data)
+
+namespace json {
+
+// bitmasks for 64-byte block, bit N describes byte N
+struct StructuralBlock {
+	uint64_t backslash;
+	uint64_t quote;
+	uint64_t op; // { } [ ] : ,
+	uint64_t whitespace;
+};
+
+static inline uint64_t StructuralBlock_cmp(const simde__m128i *v, char c) {
+	auto m = simde_mm_set1_epi8(c);
+	return uint64_t(uint16_t(simde_mm_movemask_epi8(simde_mm_cmpeq_epi8(v[0], m))))
+		| (uint64_t(uint16_t(simde_mm_movemask_epi8(simde_mm_cmpeq_epi8(v[1], m)))) << 16)
+		| (uint64_t(uint16_t(simde_mm_movemask_epi8(simde_mm_cmpeq_epi8(v[2], m)))) << 32)
+		| (uint64_t(uint16_t(simde_mm_movemask_epi8(simde_mm_cmpeq_epi8(v[3], m)))) << 48);
+}
+
+static inline void StructuralBlock_load(StructuralBlock &block, const char *ptr) {
+	simde__m128i v[4] = {
+		simde_mm_loadu_si128((const simde__m128i *)ptr),
+		simde_mm_loadu_si128((const simde__m128i *)(ptr + 16)),
+		simde_mm_loadu_si128((const simde__m128i *)(ptr + 32)),
+		simde_mm_loadu_si128((const simde__m128i *)(ptr + 48)),
+	};
+
+	block.backslash = StructuralBlock_cmp(v, '\\');
+	block.quote = StructuralBlock_cmp(v, '"');
+	block.op = StructuralBlock_cmp(v, '{') | StructuralBlock_cmp(v, '}')
+		| StructuralBlock_cmp(v, '[') | StructuralBlock_cmp(v, ']')
+		| StructuralBlock_cmp(v, ':') | StructuralBlock_cmp(v, ',');
+	block.whitespace = StructuralBlock_cmp(v, ' ') | StructuralBlock_cmp(v, '\n')
+		| StructuralBlock_cmp(v, '\r') | StructuralBlock_cmp(v, '\t');
+}
+
+// mask of chars, escaped with odd sequence of backslashes; carry is set when last char of block escapes next block's first char
+static inline uint64_t StructuralBlock_escaped(uint64_t backslash, uint64_t &carry) {
+	constexpr uint64_t EvenBits = 0x5555'5555'5555'5555ULL;
+
+	backslash &= ~carry;
+	uint64_t followsEscape = (backslash << 1) | carry;
+	uint64_t oddSequenceStarts = backslash & ~EvenBits & ~followsEscape;
+
+	uint64_t sequencesStartingOnEvenBits;
+	carry = __builtin_add_overflow(oddSequenceStarts, backslash, &sequencesStartingOnEvenBits) ? 1 : 0;
+
+	uint64_t invertMask = sequencesStartingOnEvenBits << 1;
+	return (EvenBits ^ invertMask) & followsEscape;
+}
+
+// bit N is xor of bits 0..N
+static inline uint64_t StructuralBlock_prefixXor(uint64_t v) {
+	v ^= v << 1;
+	v ^= v << 2;
+	v ^= v << 4;
+	v ^= v << 8;
+	v ^= v << 16;
+	v ^= v << 32;
+	return v;
+}
+
+bool buildStructuralIndex(const char *ptr, size_t size, std::vector<uint32_t> &index) {
+	if (size >= size_t(maxOf<uint32_t>())) {
+		return false;
+	}
+
+	index.resize(size + 1);
+
+	auto out = index.data();
+	uint64_t escapedCarry = 0;
+	uint64_t inStringCarry = 0; // all ones, if previous block ends inside string
+	uint64_t scalarCarry = 0; // 1, if previous block ends with scalar char
+
+	char tail[64];
+	StructuralBlock block;
+	for (size_t offset = 0; offset < size; offset += 64) {
+		if (offset + 64 <= size) {
+			StructuralBlock_load(block, ptr + offset);
+		} else {
+			memset(tail, ' ', 64);
+			memcpy(tail, ptr + offset, size - offset);
+			StructuralBlock_load(block, tail);
+		}
+
+		auto escaped = StructuralBlock_escaped(block.backslash, escapedCarry);
+		auto quote = block.quote & ~escaped;
+
+		// includes opening quote, excludes closing quote
+		auto inString = StructuralBlock_prefixXor(quote) ^ inStringCarry;
+		inStringCarry = uint64_t(int64_t(inString) >> 63);
+
+		auto op = block.op & ~inString;
+		auto scalar = ~(block.op | block.whitespace | quote | inString);
+		auto scalarStart = scalar & ~((scalar << 1) | scalarCarry);
+		scalarCarry = scalar >> 63;
+
+		auto bits = op | quote | scalarStart;
+		while (bits) {
+			*out ++ = uint32_t(offset + __builtin_ctzll(bits));
+			bits &= bits - 1;
+		}
+	}
+
+	index.resize(out - index.data());
+	return inStringCarry == 0;
+}
+
+bool decodeNumber(const char *&ptr, const char *end, int64_t &intVal, double &doubleVal, bool &isFloat) {
+	auto start = ptr;
+	bool negative = false;
+	if (ptr < end && *ptr == '-') {
+		negative = true;
+		++ ptr;
+	}
+
+	auto digits = ptr;
+	uint64_t value = 0;
+	while (ptr < end && *ptr >= '0' && *ptr <= '9') {
+		value = value * 10 + uint64_t(*ptr - '0');
+		++ ptr;
+	}
+
+	auto ndigits = size_t(ptr - digits);
+	if (ndigits == 0) {
+		return false;
+	}
+
+	isFloat = (ptr < end && (*ptr == '.' || *ptr == 'e' || *ptr == 'E'));
+	if (!isFloat && ndigits <= 18 && (ndigits == 1 || digits[0] != '0')) {
+		// can not overflow
+		intVal = negative ? - int64_t(value) : int64_t(value);
+		return true;
+	}
+
+	if (isFloat) {
+		// from_chars gives same correctly rounded result as strtod, without locale dependency
+		auto ret = std::from_chars(start, end, doubleVal);
+		if (ret.ec == std::errc::result_out_of_range) {
+			// strtod returns inf or denormalized value in this case
+			auto tmp = StringView(start, ret.ptr - start);
+			if (!tmp.readDouble().grab(doubleVal)) {
+				return false;
+			}
+		} else if (ret.ec != std::errc()) {
+			return false;
+		}
+		ptr = ret.ptr;
+		return true;
+	}
+
+	// large integers are saturated and leading zero means octal, as with sequential decoder
+	auto tmp = StringView(start, ptr - start);
+	return tmp.readInteger().grab(intVal);
+}
+
+}
+
+NS_SP_EXT_END(data)
@@ -52,6 +52,33 @@ inline StringView decodeNumber(StringView &r, bool &isFloat) {
 	return StringView(tmp.data(), tmp.size() - r.size());
 }
 
+// value of escaped char after backslash (except \u)
+inline char decodeEscapedChar(char c) {
+	switch (c) {
+	case '"': return '"'; break;
+	case '\'': return '\''; break;
+	case '/': return '/'; break;
+	case '\\': return '\\'; break;
+	case 'b': return '\b'; break;
+	case 'f': return '\f'; break;
+	case 'n': return '\n'; break;
+	case 'r': return '\r'; break;
+	case 't': return '\t'; break;
+	default: break;
+	}
+	return 0;
+}
+
+// Stage 1 of structural decoder: offsets of structural chars ({ } [ ] : ,), unescaped quotes and
+// first chars of literals outside of strings. Returns false if input ends inside string.
+bool buildStructuralIndex(const char *, size_t, std::vector<uint32_t> &index);
+
+// Fast path for JSON numbers, advances ptr after number
+bool decodeNumber(const char *&ptr, const char *end, int64_t &intVal, double &doubleVal, bool &isFloat);
+
+// Inputs, smaller than this, are parsed with sequential decoder, that has no index setup cost
+constexpr size_t StructuralDecoderMinSize = 1_KiB;
+
 template <typename Interface>
 struct Decoder : public Interface::AllocBaseType {
 	using InterfaceType = Interface;
@@ -104,15 +131,6 @@ struct Decoder : public Interface::AllocBaseType {
 
 template <typename Interface>
 inline void Decoder<Interface>::parseBufferString(StringType &ref) {
-#define Z16 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0
-	static const char escape[256] = {
-		Z16, Z16, 0, 0,'\"', 0, 0, 0, 0, '\'', 0, 0, 0, 0, 0, 0, 0,'/',
-		Z16, Z16, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,'\\', 0, 0, 0,
-		0, 0,'\b', 0, 0, 0,'\f', 0, 0, 0, 0, 0, 0, 0,'\n', 0,
-		0, 0,'\r', 0,'\t', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		Z16, Z16, Z16, Z16, Z16, Z16, Z16, Z16
-	};
-#undef Z16
 	if (r.is('"')) { r ++; }
 	auto s = r.readUntil<StringView::Chars<'\\', '"'>>();
 	ref.assign(s.data(), s.size());
@@ -128,7 +146,7 @@ inline void Decoder<Interface>::parseBufferString(StringType &ref) {
 					r.clear();
 				}
 			} else {
-				ref.push_back(escape[(uint8_t)r[0]]);
+				ref.push_back(decodeEscapedChar(r[0]));
 				++ r;
 			}
 		}
@@ -247,8 +265,229 @@ void Decoder<Interface>::parseJson(ValueType &val) {
 	} while (!r.empty() && !stack.empty() && !stop);
 }
 
+// Stage 2 of structural decoder: materializes values, following structural index
 template <typename Interface>
-auto read(StringView &n, bool validate = false) -> ValueTemplate<Interface> {
+struct StructuralDecoder : public Interface::AllocBaseType {
+	using InterfaceType = Interface;
+	using ValueType = ValueTemplate<Interface>;
+	using StringType = typename InterfaceType::StringType;
+
+	enum class Result {
+		Failed,
+		Scalar,
+		Container,
+	};
+
+	StructuralDecoder(const char *data, size_t size, const std::vector<uint32_t> &index)
+	: data(data), size(size), index(index.data()), count(index.size()) {
+		stack.reserve(10);
+	}
+
+	// returns false for input, that can not be parsed strictly, it should be parsed with sequential decoder
+	bool parseJson(ValueType &val);
+
+	inline bool parseString(StringType &ref);
+	inline Result parseValue(ValueType &current);
+
+	inline char token() const { return data[index[pos]]; }
+
+	const char *data;
+	size_t size;
+	const uint32_t *index;
+	size_t count;
+	size_t pos = 0;
+	size_t end = 0; // offset after parsed value
+	StringType buf;
+	typename InterfaceType::template ArrayType<ValueType *> stack;
+};
+
+template <typename Interface>
+inline bool StructuralDecoder<Interface>::parseString(StringType &ref) {
+	// opening quote is always followed by closing quote in index
+	if (pos + 1 >= count || data[index[pos + 1]] != '"') {
+		return false;
+	}
+
+	auto ptr = data + index[pos] + 1;
+	auto end = data + index[pos + 1];
+	pos += 2;
+
+	auto escape = (const char *)memchr(ptr, '\\', end - ptr);
+	if (!escape) {
+		ref.assign(ptr, end - ptr);
+		return true;
+	}
+
+	ref.assign(ptr, escape - ptr);
+	ptr = escape;
+	while (ptr < end) {
+		++ ptr; // backslash
+		if (*ptr == 'u') {
+			if (end - ptr < 5) {
+				return false;
+			}
+			string::utf8Encode(ref, char16_t(base16::hexToChar(ptr[1], ptr[2]) << 8 | base16::hexToChar(ptr[3], ptr[4]) ));
+			ptr += 5;
+		} else {
+			ref.push_back(decodeEscapedChar(*ptr));
+			++ ptr;
+		}
+
+		escape = (const char *)memchr(ptr, '\\', end - ptr);
+		if (!escape) {
+			escape = end;
+		}
+		ref.append(ptr, escape - ptr);
+		ptr = escape;
+	}
+	return true;
+}
+
+template <typename Interface>
+inline auto StructuralDecoder<Interface>::parseValue(ValueType &current) -> Result {
+	auto ptr = data + index[pos];
+	auto end = data + size;
+	switch (*ptr) {
+	case '"':
+		if (!parseString(buf)) {
+			return Result::Failed;
+		}
+		current._type = ValueType::Type::CHARSTRING;
+		current.strVal = new StringType(std::move(buf));
+		return Result::Scalar;
+		break;
+	case 't':
+		if (end - ptr < 4 || memcmp(ptr, "true", 4) != 0) {
+			return Result::Failed;
+		}
+		current._type = ValueType::Type::BOOLEAN;
+		current.boolVal = true;
+		++ pos;
+		return Result::Scalar;
+		break;
+	case 'f':
+		if (end - ptr < 5 || memcmp(ptr, "false", 5) != 0) {
+			return Result::Failed;
+		}
+		current._type = ValueType::Type::BOOLEAN;
+		current.boolVal = false;
+		++ pos;
+		return Result::Scalar;
+		break;
+	case 'n':
+		if (end - ptr >= 4 && memcmp(ptr, "null", 4) == 0) {
+			++ pos;
+			return Result::Scalar;
+		} else if (end - ptr >= 3 && memcmp(ptr, "nan", 3) == 0) {
+			current._type = ValueType::Type::DOUBLE;
+			current.doubleVal = nan();
+			++ pos;
+			return Result::Scalar;
+		}
+		return Result::Failed;
+		break;
+	case '0': case '1': case '2': case '3': case '4': case '5':
+	case '6': case '7': case '8': case '9': case '-': {
+		bool isFloat = false;
+		int64_t intVal = 0;
+		double doubleVal = 0.0;
+		if (!decodeNumber(ptr, end, intVal, doubleVal, isFloat)) {
+			return Result::Failed;
+		}
+		if (isFloat) {
+			current._type = ValueType::Type::DOUBLE;
+			current.doubleVal = doubleVal;
+		} else {
+			current._type = ValueType::Type::INTEGER;
+			current.intVal = intVal;
+		}
+		++ pos;
+		return Result::Scalar;
+		break;
+	}
+	case '[':
+		current._type = ValueType::Type::ARRAY;
+		current.arrayVal = new typename ValueType::ArrayType();
+		stack.push_back(&current);
+		++ pos;
+		return Result::Container;
+		break;
+	case '{':
+		current._type = ValueType::Type::DICTIONARY;
+		current.dictVal = new typename ValueType::DictionaryType();
+		stack.push_back(&current);
+		++ pos;
+		return Result::Container;
+		break;
+	default:
+		break;
+	}
+	return Result::Failed;
+}
+
+template <typename Interface>
+bool StructuralDecoder<Interface>::parseJson(ValueType &val) {
+	if (count == 0 || (token() != '{' && token() != '[')) {
+		return false;
+	}
+
+	parseValue(val);
+
+	bool afterValue = false;
+	while (!stack.empty()) {
+		if (pos >= count) {
+			return false;
+		}
+
+		auto back = stack.back();
+		auto c = token();
+		if (c == (back->isArray() ? ']' : '}')) {
+			if (back->isArray()) {
+				back->arrayVal->shrink_to_fit();
+			}
+			end = index[pos] + 1;
+			++ pos;
+			stack.pop_back();
+			afterValue = true;
+			continue;
+		}
+
+		if (afterValue) {
+			if (c != ',') {
+				return false;
+			}
+			++ pos;
+			afterValue = false;
+			continue;
+		}
+
+		Result res = Result::Failed;
+		if (back->isArray()) {
+			back->arrayVal->emplace_back(ValueType::Type::EMPTY);
+			res = parseValue(back->arrayVal->back());
+		} else {
+			if (c != '"' || !parseString(buf) || pos >= count || token() != ':') {
+				return false;
+			}
+			++ pos;
+			if (pos >= count) {
+				return false;
+			}
+			res = parseValue(back->dictVal->emplace(std::move(buf), ValueType::Type::EMPTY).first->second);
+		}
+
+		switch (res) {
+		case Result::Failed: return false; break;
+		case Result::Scalar: afterValue = true; break;
+		case Result::Container: afterValue = false; break;
+		}
+	}
+
+	return true;
+}
+
+template <typename Interface>
+auto readSequential(StringView &n, bool validate = false) -> ValueTemplate<Interface> {
 	auto r = n;
 	if (r.empty() || r == "null") {
 		return ValueTemplate<Interface>();
@@ -262,6 +501,37 @@ auto read(StringView &n, bool validate = false) -> ValueTemplate<Interface> {
 	return ret;
 }
 
+// two-stage decoder for large inputs: structural index with SIMD, then values materialization
+// returns false, if input can not be parsed with it (ret is undefined in this case)
+template <typename Interface>
+bool readStructural(StringView &n, ValueTemplate<Interface> &ret) {
+	std::vector<uint32_t> index;
+	if (!buildStructuralIndex(n.data(), n.size(), index)) {
+		return false;
+	}
+
+	StructuralDecoder<Interface> dec(n.data(), n.size(), index);
+	if (!dec.parseJson(ret)) {
+		return false;
+	}
+
+	n += dec.end;
+	return true;
+}
+
+template <typename Interface>
+auto read(StringView &n, bool validate = false) -> ValueTemplate<Interface> {
+	if (!validate && n.size() >= StructuralDecoderMinSize) {
+		ValueTemplate<Interface> ret;
+		auto r = n;
+		if (readStructural(r, ret)) {
+			n = r;
+			return ret;
+		}
+	}
+	return readSequential<Interface>(n, validate);
+}
+
 template <typename Interface>
 auto read(const StringView &r) -> ValueTemplate<Interface> {
 	StringView tmp(r);
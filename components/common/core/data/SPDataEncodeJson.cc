@@ -0,0 +1,136 @@
+/**
+Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "SPCommon.h"
+#include "SPDataEncodeJson.h"
+
+#include "simde/x86/avx2.h"
+
+#include <charconv>
+
+NS_SP_EXT_BEGIN(data)
+
+namespace json {
+
+// mask of bytes, that should be escaped: control chars (< 0x20), quote and backslash
+static inline int findEscapeMask16(const char *ptr) {
+	auto v = simde_mm_loadu_si128((const simde__m128i *)ptr);
+	auto ctrl = simde_mm_cmpeq_epi8(simde_mm_max_epu8(v, simde_mm_set1_epi8(0x1F)), simde_mm_set1_epi8(0x1F));
+	auto quote = simde_mm_cmpeq_epi8(v, simde_mm_set1_epi8('"'));
+	auto slash = simde_mm_cmpeq_epi8(v, simde_mm_set1_epi8('\\'));
+	return simde_mm_movemask_epi8(simde_mm_or_si128(ctrl, simde_mm_or_si128(quote, slash)));
+}
+
+#if SIMDE_X86_AVX2_NATIVE
+static inline int findEscapeMask32(const char *ptr) {
+	auto v = simde_mm256_loadu_si256((const simde__m256i *)ptr);
+	auto ctrl = simde_mm256_cmpeq_epi8(simde_mm256_max_epu8(v, simde_mm256_set1_epi8(0x1F)), simde_mm256_set1_epi8(0x1F));
+	auto quote = simde_mm256_cmpeq_epi8(v, simde_mm256_set1_epi8('"'));
+	auto slash = simde_mm256_cmpeq_epi8(v, simde_mm256_set1_epi8('\\'));
+	return simde_mm256_movemask_epi8(simde_mm256_or_si256(ctrl, simde_mm256_or_si256(quote, slash)));
+}
+#endif
+
+static inline bool isEscapeChar(char c) {
+	return uint8_t(c) < 0x20 || c == '"' || c == '\\';
+}
+
+size_t findEscapeChar(const char *ptr, size_t size) {
+	size_t offset = 0;
+
+#if SIMDE_X86_AVX2_NATIVE
+	while (offset + 32 <= size) {
+		if (auto mask = findEscapeMask32(ptr + offset)) {
+			return offset + __builtin_ctz(uint32_t(mask));
+		}
+		offset += 32;
+	}
+#endif
+
+	while (offset + 16 <= size) {
+		if (auto mask = findEscapeMask16(ptr + offset)) {
+			return offset + __builtin_ctz(uint32_t(mask));
+		}
+		offset += 16;
+	}
+
+	while (offset < size) {
+		if (isEscapeChar(ptr[offset])) {
+			return offset;
+		}
+		++ offset;
+	}
+
+	return size;
+}
+
+void encodeString(EncodeBuffer &buffer, const char *ptr, size_t size) {
+	static constexpr char HexChars[] = "0123456789abcdef";
+
+	buffer.put('"');
+	while (size > 0) {
+		auto offset = findEscapeChar(ptr, size);
+		if (offset > 0) {
+			buffer.put(ptr, offset);
+		}
+		if (offset == size) {
+			break;
+		}
+
+		auto c = ptr[offset];
+		switch (c) {
+		case '\n' : buffer.put("\\n", 2); break;
+		case '\r' : buffer.put("\\r", 2); break;
+		case '\t' : buffer.put("\\t", 2); break;
+		case '\f' : buffer.put("\\f", 2); break;
+		case '\b' : buffer.put("\\b", 2); break;
+		case '\\' : buffer.put("\\\\", 2); break;
+		case '\"' : buffer.put("\\\"", 2); break;
+		default: {
+			char buf[6] = { '\\', 'u', '0', '0', HexChars[(uint8_t(c) >> 4) & 0xF], HexChars[uint8_t(c) & 0xF] };
+			buffer.put(buf, 6);
+			break;
+		}
+		}
+
+		ptr += offset + 1;
+		size -= offset + 1;
+	}
+	buffer.put('"');
+}
+
+void encodeNumber(EncodeBuffer &buffer, int64_t value) {
+	auto buf = buffer.reserve(NumberBufferSize);
+	auto ret = std::to_chars(buf, buf + NumberBufferSize, value);
+	buffer.commit(ret.ptr - buf);
+}
+
+void encodeNumber(EncodeBuffer &buffer, double value) {
+	// shortest representation, that reads back exactly; nan and inf are written as with iostreams
+	auto buf = buffer.reserve(NumberBufferSize);
+	auto ret = std::to_chars(buf, buf + NumberBufferSize, value);
+	buffer.commit(ret.ptr - buf);
+}
+
+}
+
+NS_SP_EXT_END(data)
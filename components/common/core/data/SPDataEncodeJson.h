@@ -29,30 +29,84 @@ NS_SP_EXT_BEGIN(data)
 
 namespace json {
 
-template <typename StringType>
-inline void encodeString(OutputStream &stream, const StringType &str) {
-	stream << '"';
-	for (auto &i : str) {
-		switch (i) {
-		case '\n' : stream << "\\n"; break;
-		case '\r' : stream << "\\r"; break;
-		case '\t' : stream << "\\t"; break;
-		case '\f' : stream << "\\f"; break;
-		case '\b' : stream << "\\b"; break;
-		case '\\' : stream << "\\\\"; break;
-		case '\"' : stream << "\\\""; break;
-		case ' ' : stream << " "; break;
-		default:
-			if (i >= 0 && i <= 0x20) {
-				stream << "\\u" << std::setfill('0') << std::setw(4)
-					<< std::hex << (int32_t)i << std::dec << std::setw(1) << std::setfill(' ');
-			} else {
-				stream << i;
+// Collects encoder output in contiguous memory, and writes it into stream with large blocks
+struct EncodeBuffer {
+	static constexpr size_t BufferSize = 4_KiB;
+
+	EncodeBuffer(OutputStream *stream) : stream(stream) { }
+	~EncodeBuffer() { flush(); }
+
+	EncodeBuffer(const EncodeBuffer &) = delete;
+	EncodeBuffer &operator=(const EncodeBuffer &) = delete;
+
+	void flush() {
+		if (used > 0) {
+			stream->write(data, used);
+			used = 0;
+		}
+	}
+
+	// returns pointer to at least size (<= BufferSize) writable bytes, use commit to confirm write
+	char *reserve(size_t size) {
+		if (used + size > BufferSize) {
+			flush();
+		}
+		return data + used;
+	}
+
+	void commit(size_t size) { used += size; }
+
+	void put(char c) {
+		if (used == BufferSize) {
+			flush();
+		}
+		data[used ++] = c;
+	}
+
+	void put(const char *str, size_t size) {
+		if (used + size > BufferSize) {
+			flush();
+			if (size > BufferSize) {
+				stream->write(str, size);
+				return;
+			}
+		}
+		memcpy(data + used, str, size);
+		used += size;
+	}
+
+	void put(StringView str) { put(str.data(), str.size()); }
+
+	void put(char c, size_t count) {
+		while (count > 0) {
+			auto n = std::min(count, BufferSize - used);
+			memset(data + used, c, n);
+			used += n;
+			count -= n;
+			if (used == BufferSize) {
+				flush();
 			}
-			break;
 		}
 	}
-	stream << '"';
+
+	OutputStream *stream;
+	size_t used = 0;
+	char data[BufferSize];
+};
+
+static constexpr size_t NumberBufferSize = 32;
+
+// returns offset of first char, that should be escaped, or size, if there is no such chars
+size_t findEscapeChar(const char *, size_t);
+
+void encodeString(EncodeBuffer &, const char *, size_t);
+void encodeNumber(EncodeBuffer &, int64_t);
+void encodeNumber(EncodeBuffer &, double);
+
+template <typename StringType>
+inline void encodeString(OutputStream &stream, const StringType &str) {
+	EncodeBuffer buffer(&stream);
+	encodeString(buffer, str.data(), str.size());
 }
 
 template <typename Interface>
@@ -60,26 +114,32 @@ struct RawEncoder : public Interface::AllocBaseType {
 	using InterfaceType = Interface;
 	using ValueType = ValueTemplate<Interface>;
 
-	inline RawEncoder(OutputStream *stream) : stream(stream) { }
+	inline RawEncoder(OutputStream *stream) : stream(stream), buffer(stream) { }
 
-	inline void write(nullptr_t) { (*stream) << "null"; }
-	inline void write(bool value) { (*stream) << ((value)?"true":"false"); }
-	inline void write(int64_t value) { (*stream) << value; }
-	inline void write(double value) { (*stream) << std::setprecision(std::numeric_limits<double>::max_digits10) << value; }
+	inline void write(nullptr_t) { buffer.put("null", 4); }
+	inline void write(bool value) { if (value) { buffer.put("true", 4); } else { buffer.put("false", 5); } }
+	inline void write(int64_t value) { encodeNumber(buffer, value); }
+	inline void write(double value) { encodeNumber(buffer, value); }
 
 	inline void write(const typename ValueType::StringType &str) {
-		encodeString(*stream, str);
+		encodeString(buffer, str.data(), str.size());
+	}
+
+	inline void write(const typename ValueType::BytesType &data) {
+		buffer.put("\"BASE64:", 8);
+		buffer.put(base64url::encode(data));
+		buffer.put('"');
 	}
 
-	inline void write(const typename ValueType::BytesType &data) { (*stream) << '"' << "BASE64:" << base64url::encode(data) << '"'; }
-	inline void onBeginArray(const typename ValueType::ArrayType &arr) { (*stream) << '['; }
-	inline void onEndArray(const typename ValueType::ArrayType &arr) { (*stream) << ']'; }
-	inline void onBeginDict(const typename ValueType::DictionaryType &dict) { (*stream) << '{'; }
-	inline void onEndDict(const typename ValueType::DictionaryType &dict) { (*stream) << '}'; }
-	inline void onKey(const typename ValueType::StringType &str) { write(str); (*stream) << ':'; }
-	inline void onNextValue() { (*stream) << ','; }
+	inline void onBeginArray(const typename ValueType::ArrayType &arr) { buffer.put('['); }
+	inline void onEndArray(const typename ValueType::ArrayType &arr) { buffer.put(']'); }
+	inline void onBeginDict(const typename ValueType::DictionaryType &dict) { buffer.put('{'); }
+	inline void onEndDict(const typename ValueType::DictionaryType &dict) { buffer.put('}'); }
+	inline void onKey(const typename ValueType::StringType &str) { write(str); buffer.put(':'); }
+	inline void onNextValue() { buffer.put(','); }
 
 	OutputStream *stream;
+	EncodeBuffer buffer;
 };
 
 template <typename Interface>
@@ -87,12 +147,12 @@ struct PrettyEncoder : public Interface::AllocBaseType {
 	using InterfaceType = Interface;
 	using ValueType = ValueTemplate<Interface>;
 
-	PrettyEncoder(OutputStream *stream, bool timeMarkers = false) : timeMarkers(timeMarkers), stream(stream) { }
+	PrettyEncoder(OutputStream *stream, bool timeMarkers = false) : timeMarkers(timeMarkers), stream(stream), buffer(stream) { }
 
-	void write(nullptr_t) { (*stream) << "null"; offsetted = false; }
-	void write(bool value) { (*stream) << ((value)?"true":"false"); offsetted = false; }
+	void write(nullptr_t) { buffer.put("null", 4); offsetted = false; }
+	void write(bool value) { if (value) { buffer.put("true", 4); } else { buffer.put("false", 5); } offsetted = false; }
 	void write(int64_t value) {
-		(*stream) << value; offsetted = false;
+		encodeNumber(buffer, value); offsetted = false;
 		if (timeMarkers
 			&& (lastKey.find("time") != maxOf<size_t>()
 					|| lastKey.find("Time") != maxOf<size_t>()
@@ -100,18 +160,22 @@ struct PrettyEncoder : public Interface::AllocBaseType {
 					|| lastKey.find("date") != maxOf<size_t>()
 					|| lastKey.find("Date") != maxOf<size_t>())
 			&& (value > 1000000000000000 && value < 10000000000000000)) {
-			(*stream) << " /* " << Time::microseconds(value).toHttp() << " */";
+			buffer.put(" /* ", 4);
+			buffer.put(Time::microseconds(value).toHttp());
+			buffer.put(" */", 3);
 		}
 	}
-	void write(double value) { (*stream) << std::setprecision(std::numeric_limits<double>::max_digits10) << value; offsetted = false; }
+	void write(double value) { encodeNumber(buffer, value); offsetted = false; }
 
 	void write(const typename ValueType::StringType &str) {
-		encodeString(*stream, str);
+		encodeString(buffer, str.data(), str.size());
 		offsetted = false;
 	}
 
 	void write(const typename ValueType::BytesType &data) {
-		(*stream) << '"'  << "BASE64:" << base64url::encode(data) << '"';
+		buffer.put("\"BASE64:", 8);
+		buffer.put(base64url::encode(data));
+		buffer.put('"');
 		offsetted = false;
 	}
 
@@ -125,7 +189,7 @@ struct PrettyEncoder : public Interface::AllocBaseType {
 	}
 
 	void onBeginArray(const typename ValueType::ArrayType &arr) {
-		(*stream) << '[';
+		buffer.put('[');
 		if (!isObjectArray(arr)) {
 			++ depth;
 			bstack.push_back(false);
@@ -139,66 +203,56 @@ struct PrettyEncoder : public Interface::AllocBaseType {
 		if (!bstack.empty()) {
 			if (!bstack.back()) {
 				-- depth;
-				(*stream) << '\n';
-				for (size_t i = 0; i < depth; i++) {
-					(*stream) << '\t';
-				}
+				buffer.put('\n');
+				buffer.put('\t', depth);
 			}
 			bstack.pop_back();
 		} else {
 			-- depth;
-			(*stream) << '\n';
-			for (size_t i = 0; i < depth; i++) {
-				(*stream) << '\t';
-			}
+			buffer.put('\n');
+			buffer.put('\t', depth);
 		}
-		(*stream) << ']';
+		buffer.put(']');
 		popComplex = true;
 	}
 
 	void onBeginDict(const typename ValueType::DictionaryType &dict) {
 		lastKey = StringView();
-		(*stream) << '{';
+		buffer.put('{');
 		++ depth;
 	}
 
 	void onEndDict(const typename ValueType::DictionaryType &dict) {
 		lastKey = StringView();
 		-- depth;
-		(*stream) << '\n';
-		for (size_t i = 0; i < depth; i++) {
-			(*stream) << '\t';
-		}
-		(*stream) << '}';
+		buffer.put('\n');
+		buffer.put('\t', depth);
+		buffer.put('}');
 		popComplex = true;
 	}
 
 	void onKey(const typename ValueType::StringType &str) {
 		lastKey = str;
-		(*stream) << '\n';
-		for (size_t i = 0; i < depth; i++) {
-			(*stream) << '\t';
-		}
+		buffer.put('\n');
+		buffer.put('\t', depth);
 		write(str);
 		offsetted = true;
-		(*stream) << ':' << ' ';
+		buffer.put(": ", 2);
 	}
 
 	void onNextValue() {
 		lastKey = StringView();
-		(*stream) << ',';
+		buffer.put(',');
 	}
 
 	void onValue(const ValueType &val) {
 		if (depth > 0) {
 			if (popComplex && (val.isArray() || val.isDictionary())) {
-				(*stream) << ' ';
+				buffer.put(' ');
 			} else {
 				if (!offsetted) {
-					(*stream) << '\n';
-					for (size_t i = 0; i < depth; i++) {
-						(*stream) << '\t';
-					}
+					buffer.put('\n');
+					buffer.put('\t', depth);
 					offsetted = true;
 				}
 			}
@@ -211,6 +265,7 @@ struct PrettyEncoder : public Interface::AllocBaseType {
 	bool offsetted = false;
 	bool timeMarkers = false;
 	OutputStream *stream;
+	EncodeBuffer buffer;
 	StringView lastKey;
 	typename Interface::template ArrayType<bool> bstack;
 };
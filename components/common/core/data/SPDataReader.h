@@ -0,0 +1,1194 @@
+/**
+Copyright (c) 2019 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#ifndef COMMON_DATA_SPDATAREADER_H_
+#define COMMON_DATA_SPDATAREADER_H_
+
+#include "SPDataDecodeCbor.h"
+#include "SPDataDecodeJson.h"
+#include "SPSpanView.h"
+
+NS_SP_EXT_BEGIN(data)
+
+// Event-based readers: data is reported to visitor as it parsed, without ValueTemplate construction
+//
+// Visitor interface (ReaderVisitor provides defaults for all callbacks):
+//  onBeginArray(size_t) / onBeginDict(size_t) - size hint, maxOf<size_t>() if unknown;
+//    ReaderResult::Skip skips container contents, onEndArray / onEndDict is not called for it
+//  onEndArray() / onEndDict()
+//  onKey(StringView) - ReaderResult::Skip skips value for this key
+//  onNull(), onBool(bool), onInteger(int64_t), onDouble(double), onString(StringView), onBytes(BytesView)
+//
+// Strings and bytes are views into source data or into reader buffer (for escaped and chunked strings),
+// key is valid until next onKey, other values - until callback returns.
+// ReaderResult::Stop from any callback interrupts reading, it's not an error.
+// Skipped subtrees are not validated.
+
+enum class ReaderResult {
+	Continue,
+	Skip,
+	Stop,
+};
+
+constexpr uint32_t ReaderMaxDepth = 256;
+
+struct ReaderVisitor {
+	ReaderResult onBeginArray(size_t) { return ReaderResult::Continue; }
+	ReaderResult onEndArray() { return ReaderResult::Continue; }
+	ReaderResult onBeginDict(size_t) { return ReaderResult::Continue; }
+	ReaderResult onEndDict() { return ReaderResult::Continue; }
+	ReaderResult onKey(StringView) { return ReaderResult::Continue; }
+	ReaderResult onNull() { return ReaderResult::Continue; }
+	ReaderResult onBool(bool) { return ReaderResult::Continue; }
+	ReaderResult onInteger(int64_t) { return ReaderResult::Continue; }
+	ReaderResult onDouble(double) { return ReaderResult::Continue; }
+	ReaderResult onString(StringView) { return ReaderResult::Continue; }
+	ReaderResult onBytes(BytesView) { return ReaderResult::Continue; }
+};
+
+namespace cbor {
+
+template <typename Interface, typename Visitor>
+struct Reader : public Interface::AllocBaseType {
+	using InterfaceType = Interface;
+	using StringType = typename InterfaceType::StringType;
+
+	Reader(BytesViewTemplate<Endian::Network> &r, Visitor &v) : r(r), visitor(v) { }
+
+	// returns false if data is malformed
+	bool read() {
+		MajorTypeEncoded majorType; uint8_t type;
+		if (readHeader(majorType, type)) {
+			readValue(majorType, type, 0);
+		}
+		return !failed;
+	}
+
+	inline bool readHeader(MajorTypeEncoded &majorType, uint8_t &type) {
+		if (r.empty()) {
+			failed = true;
+			return false;
+		}
+		type = r.readUnsigned();
+		majorType = (MajorTypeEncoded)(type & toInt(Flags::MajorTypeMaskEncoded));
+		type = type & toInt(Flags::AdditionalInfoMask);
+		return true;
+	}
+
+	inline bool isBreak(MajorTypeEncoded majorType, uint8_t type) const {
+		return majorType == MajorTypeEncoded::Simple && type == toInt(Flags::UndefinedLength);
+	}
+
+	inline bool emit(ReaderResult res) {
+		if (res == ReaderResult::Stop) {
+			stopped = true;
+			return false;
+		}
+		return true;
+	}
+
+	// all read functions returns false, when reading should be interrupted
+	bool readString(MajorTypeEncoded, uint8_t type, StringType &, const uint8_t * &ptr, size_t &size);
+	bool readArray(uint8_t type, uint32_t depth);
+	bool readMap(uint8_t type, uint32_t depth);
+	bool readSimpleValue(uint8_t type);
+	bool readValue(MajorTypeEncoded, uint8_t type, uint32_t depth);
+	bool skipValue(MajorTypeEncoded, uint8_t type, uint32_t depth);
+	bool skipItems(size_t size, uint32_t depth);
+
+	BytesViewTemplate<Endian::Network> r;
+	Visitor &visitor;
+	StringType buf;
+	StringType keyBuf;
+	bool failed = false;
+	bool stopped = false;
+};
+
+template <typename Interface, typename Visitor>
+bool Reader<Interface, Visitor>::readString(MajorTypeEncoded majorType, uint8_t type, StringType &target, const uint8_t * &ptr, size_t &size) {
+	if (type != toInt(Flags::UndefinedLength)) {
+		auto len = _readIntValue(r, type);
+		if (len > r.size()) {
+			failed = true;
+			return false;
+		}
+		ptr = r.data();
+		size = size_t(len);
+		r.offset(size);
+		return true;
+	}
+
+	// chunked string, concatenated in buffer
+	target.clear();
+	MajorTypeEncoded chunkType; uint8_t chunkInfo;
+	while (readHeader(chunkType, chunkInfo)) {
+		if (isBreak(chunkType, chunkInfo)) {
+			ptr = (const uint8_t *)target.data();
+			size = target.size();
+			return true;
+		}
+		if (chunkType != majorType || chunkInfo == toInt(Flags::UndefinedLength)) {
+			break;
+		}
+		auto len = _readIntValue(r, chunkInfo);
+		if (len > r.size()) {
+			break;
+		}
+		target.append((const char *)r.data(), size_t(len));
+		r.offset(size_t(len));
+	}
+	failed = true;
+	return false;
+}
+
+template <typename Interface, typename Visitor>
+bool Reader<Interface, Visitor>::readArray(uint8_t type, uint32_t depth) {
+	size_t size = maxOf<size_t>();
+	if (type != toInt(Flags::UndefinedLength)) {
+		size = size_t(_readIntValue(r, type));
+	}
+
+	// every item takes at least one byte, so size hint can not be larger then remaining data
+	switch (visitor.onBeginArray((size == maxOf<size_t>()) ? size : min(size, r.size()))) {
+	case ReaderResult::Stop: stopped = true; return false; break;
+	case ReaderResult::Skip: return skipItems(size, depth); break;
+	default: break;
+	}
+
+	if (depth >= ReaderMaxDepth) {
+		failed = true;
+		return false;
+	}
+
+	MajorTypeEncoded majorType; uint8_t itemType;
+	while (size > 0) {
+		if (!readHeader(majorType, itemType)) {
+			return false;
+		}
+		if (isBreak(majorType, itemType)) {
+			if (size != maxOf<size_t>()) {
+				failed = true;
+				return false;
+			}
+			break;
+		}
+		if (!readValue(majorType, itemType, depth + 1)) {
+			return false;
+		}
+		if (size != maxOf<size_t>()) {
+			-- size;
+		}
+	}
+
+	return emit(visitor.onEndArray());
+}
+
+template <typename Interface, typename Visitor>
+bool Reader<Interface, Visitor>::readMap(uint8_t type, uint32_t depth) {
+	size_t size = maxOf<size_t>();
+	if (type != toInt(Flags::UndefinedLength)) {
+		size = size_t(_readIntValue(r, type));
+	}
+
+	switch (visitor.onBeginDict((size == maxOf<size_t>()) ? size : min(size, r.size() / 2))) {
+	case ReaderResult::Stop: stopped = true; return false; break;
+	case ReaderResult::Skip:
+		if (size != maxOf<size_t>()) {
+			if (size > r.size()) {
+				failed = true;
+				return false;
+			}
+			size *= 2;
+		}
+		return skipItems(size, depth);
+		break;
+	default: break;
+	}
+
+	if (depth >= ReaderMaxDepth) {
+		failed = true;
+		return false;
+	}
+
+	MajorTypeEncoded majorType; uint8_t itemType;
+	while (size > 0) {
+		if (!readHeader(majorType, itemType)) {
+			return false;
+		}
+		if (isBreak(majorType, itemType)) {
+			if (size != maxOf<size_t>()) {
+				failed = true;
+				return false;
+			}
+			break;
+		}
+
+		bool skip = false;
+		const uint8_t *keyPtr = nullptr;
+		size_t keySize = 0;
+
+		switch (majorType) {
+		case MajorTypeEncoded::Unsigned:
+			keyBuf = string::ToStringTraits<Interface>::toString(_readIntValue(r, itemType));
+			keyPtr = (const uint8_t *)keyBuf.data(); keySize = keyBuf.size();
+			break;
+		case MajorTypeEncoded::Negative:
+			keyBuf = string::ToStringTraits<Interface>::toString((int64_t)(-1 - _readIntValue(r, itemType)));
+			keyPtr = (const uint8_t *)keyBuf.data(); keySize = keyBuf.size();
+			break;
+		case MajorTypeEncoded::ByteString:
+		case MajorTypeEncoded::CharString:
+			if (!readString(majorType, itemType, keyBuf, keyPtr, keySize)) {
+				return false;
+			}
+			break;
+		default:
+			// key can not be converted to string, skip pair (as Decoder does)
+			if (!skipValue(majorType, itemType, depth + 1)) {
+				return false;
+			}
+			skip = true;
+			break;
+		}
+
+		if (!skip) {
+			switch (visitor.onKey(StringView((const char *)keyPtr, keySize))) {
+			case ReaderResult::Stop: stopped = true; return false; break;
+			case ReaderResult::Skip: skip = true; break;
+			default: break;
+			}
+		}
+
+		if (!readHeader(majorType, itemType)) {
+			return false;
+		}
+		if (skip) {
+			if (!skipValue(majorType, itemType, depth + 1)) {
+				return false;
+			}
+		} else if (!readValue(majorType, itemType, depth + 1)) {
+			return false;
+		}
+
+		if (size != maxOf<size_t>()) {
+			-- size;
+		}
+	}
+
+	return emit(visitor.onEndDict());
+}
+
+template <typename Interface, typename Visitor>
+bool Reader<Interface, Visitor>::readSimpleValue(uint8_t type) {
+	if (type == toInt(Flags::Simple8Bit)) {
+		return emit(visitor.onInteger(r.readUnsigned()));
+	} else if (type == toInt(Flags::AdditionalFloat16Bit)) {
+		return emit(visitor.onDouble((double)r.readFloat16()));
+	} else if (type == toInt(Flags::AdditionalFloat32Bit)) {
+		return emit(visitor.onDouble((double)r.readFloat32()));
+	} else if (type == toInt(Flags::AdditionalFloat64Bit)) {
+		return emit(visitor.onDouble(r.readFloat64()));
+	} else if (type == toInt(SimpleValue::Null) || type == toInt(SimpleValue::Undefined)) {
+		return emit(visitor.onNull());
+	} else if (type == toInt(SimpleValue::True)) {
+		return emit(visitor.onBool(true));
+	} else if (type == toInt(SimpleValue::False)) {
+		return emit(visitor.onBool(false));
+	} else if (type == toInt(Flags::UndefinedLength)) {
+		// break code outside of container
+		failed = true;
+		return false;
+	}
+	return emit(visitor.onInteger(type));
+}
+
+template <typename Interface, typename Visitor>
+bool Reader<Interface, Visitor>::readValue(MajorTypeEncoded majorType, uint8_t type, uint32_t depth) {
+	const uint8_t *ptr = nullptr;
+	size_t size = 0;
+
+	switch (majorType) {
+	case MajorTypeEncoded::Unsigned:
+		return emit(visitor.onInteger((int64_t)_readIntValue(r, type)));
+		break;
+	case MajorTypeEncoded::Negative:
+		return emit(visitor.onInteger((int64_t)(-1 - _readIntValue(r, type))));
+		break;
+	case MajorTypeEncoded::ByteString:
+		if (!readString(majorType, type, buf, ptr, size)) {
+			return false;
+		}
+		return emit(visitor.onBytes(BytesView(ptr, size)));
+		break;
+	case MajorTypeEncoded::CharString:
+		if (!readString(majorType, type, buf, ptr, size)) {
+			return false;
+		}
+		return emit(visitor.onString(StringView((const char *)ptr, size)));
+		break;
+	case MajorTypeEncoded::Array:
+		return readArray(type, depth);
+		break;
+	case MajorTypeEncoded::Map:
+		return readMap(type, depth);
+		break;
+	case MajorTypeEncoded::Tag:
+		/* auto tagValue = */ _readIntValue(r, type);
+		if (!readHeader(majorType, type)) {
+			return false;
+		}
+		// tags are nested into each other, so, they are limited with the same depth as containers
+		if (depth + 1 >= ReaderMaxDepth) {
+			failed = true;
+			return false;
+		}
+		return readValue(majorType, type, depth + 1);
+		break;
+	case MajorTypeEncoded::Simple:
+		return readSimpleValue(type);
+		break;
+	}
+	return false;
+}
+
+template <typename Interface, typename Visitor>
+bool Reader<Interface, Visitor>::skipValue(MajorTypeEncoded majorType, uint8_t type, uint32_t depth) {
+	if (depth >= ReaderMaxDepth) {
+		failed = true;
+		return false;
+	}
+
+	switch (majorType) {
+	case MajorTypeEncoded::Unsigned:
+	case MajorTypeEncoded::Negative:
+		_readIntValue(r, type);
+		return true;
+		break;
+	case MajorTypeEncoded::ByteString:
+	case MajorTypeEncoded::CharString:
+		if (type != toInt(Flags::UndefinedLength)) {
+			auto len = _readIntValue(r, type);
+			if (len > r.size()) {
+				failed = true;
+				return false;
+			}
+			r.offset(size_t(len));
+			return true;
+		}
+		break;
+	case MajorTypeEncoded::Tag:
+		_readIntValue(r, type);
+		if (!readHeader(majorType, type)) {
+			return false;
+		}
+		return skipValue(majorType, type, depth + 1);
+		break;
+	case MajorTypeEncoded::Simple:
+		if (type == toInt(Flags::Simple8Bit)) {
+			r.offset(1);
+		} else if (type == toInt(Flags::AdditionalFloat16Bit)) {
+			r.offset(2);
+		} else if (type == toInt(Flags::AdditionalFloat32Bit)) {
+			r.offset(4);
+		} else if (type == toInt(Flags::AdditionalFloat64Bit)) {
+			r.offset(8);
+		} else if (type == toInt(Flags::UndefinedLength)) {
+			failed = true;
+			return false;
+		}
+		return true;
+		break;
+	default:
+		break;
+	}
+
+	// containers and chunked strings: number of items to skip, map takes two items per entry
+	size_t size = maxOf<size_t>();
+	if (type != toInt(Flags::UndefinedLength)) {
+		size = size_t(_readIntValue(r, type));
+		if (majorType == MajorTypeEncoded::Map) {
+			if (size > r.size()) {
+				failed = true;
+				return false;
+			}
+			size *= 2;
+		}
+	}
+
+	return skipItems(size, depth);
+}
+
+template <typename Interface, typename Visitor>
+bool Reader<Interface, Visitor>::skipItems(size_t size, uint32_t depth) {
+	MajorTypeEncoded itemMajorType; uint8_t itemType;
+	while (size > 0) {
+		if (!readHeader(itemMajorType, itemType)) {
+			return false;
+		}
+		if (isBreak(itemMajorType, itemType)) {
+			if (size != maxOf<size_t>()) {
+				failed = true;
+				return false;
+			}
+			break;
+		}
+		if (!skipValue(itemMajorType, itemType, depth + 1)) {
+			return false;
+		}
+		if (size != maxOf<size_t>()) {
+			-- size;
+		}
+	}
+	return true;
+}
+
+template <typename Interface = DefaultInterface, typename Visitor>
+bool visit(BytesViewTemplate<Endian::Network> &data, Visitor &v) {
+	// read CBOR id ( 0xd9d9f7 )
+	if (data.size() <= 3 || data[0] != 0xd9 || data[1] != 0xd9 || data[2] != 0xf7) {
+		return false;
+	}
+
+	BytesViewTemplate<Endian::Network> reader(data);
+	reader.offset(3);
+
+	Reader<Interface, Visitor> dec(reader, v);
+	auto ret = dec.read();
+	data = dec.r;
+	return ret;
+}
+
+template <typename Interface = DefaultInterface, typename Visitor>
+bool visit(const BytesView &data, Visitor &v) {
+	BytesViewTemplate<Endian::Network> reader(data.data(), data.size());
+	return visit<Interface>(reader, v);
+}
+
+}
+
+namespace json {
+
+template <typename Interface, typename Visitor>
+struct Reader : public Interface::AllocBaseType {
+	using InterfaceType = Interface;
+	using StringType = typename InterfaceType::StringType;
+
+	Reader(StringView &r, Visitor &v) : r(r), visitor(v) { }
+
+	// returns false if data is malformed
+	bool read() {
+		skipWhitespace();
+		readValue(0);
+		return !failed;
+	}
+
+	inline void skipWhitespace() {
+		r.skipChars<StringView::Chars<' ', '\n', '\r', '\t'>>();
+	}
+
+	inline bool emit(ReaderResult res) {
+		if (res == ReaderResult::Stop) {
+			stopped = true;
+			return false;
+		}
+		return true;
+	}
+
+	bool readString(StringType &, StringView &);
+	bool skipString();
+	bool readArray(uint32_t depth);
+	bool readDict(uint32_t depth);
+	bool readValue(uint32_t depth);
+	bool skipValue();
+
+	StringView r;
+	Visitor &visitor;
+	StringType buf;
+	StringType keyBuf;
+	bool failed = false;
+	bool stopped = false;
+};
+
+template <typename Interface, typename Visitor>
+bool Reader<Interface, Visitor>::readString(StringType &target, StringView &ret) {
+	++ r; // opening quote
+	auto s = r.readUntil<StringView::Chars<'\\', '"'>>();
+	if (r.is('"')) {
+		// fast path - string without escape sequences
+		++ r;
+		ret = s;
+		return true;
+	}
+
+	target.assign(s.data(), s.size());
+	while (r.is('\\')) {
+		++ r;
+		if (r.is('u')) {
+			++ r;
+			if (r.size() < 4) {
+				break;
+			}
+			string::utf8Encode(target, char16_t(base16::hexToChar(r[0], r[1]) << 8 | base16::hexToChar(r[2], r[3]) ));
+			r += 4;
+		} else if (!r.empty()) {
+			target.push_back(decodeEscapedChar(r[0]));
+			++ r;
+		}
+		auto s = r.readUntil<StringView::Chars<'\\', '"'>>();
+		target.append(s.data(), s.size());
+	}
+
+	if (r.is('"')) {
+		++ r;
+		ret = StringView(target);
+		return true;
+	}
+
+	failed = true;
+	return false;
+}
+
+template <typename Interface, typename Visitor>
+bool Reader<Interface, Visitor>::skipString() {
+	++ r; // opening quote
+	while (!r.empty()) {
+		r.skipUntil<StringView::Chars<'\\', '"'>>();
+		if (r.is('"')) {
+			++ r;
+			return true;
+		} else if (r.is('\\')) {
+			++ r;
+			if (!r.empty()) {
+				++ r;
+			}
+		}
+	}
+	failed = true;
+	return false;
+}
+
+template <typename Interface, typename Visitor>
+bool Reader<Interface, Visitor>::readArray(uint32_t depth) {
+	switch (visitor.onBeginArray(maxOf<size_t>())) {
+	case ReaderResult::Stop: stopped = true; return false; break;
+	case ReaderResult::Skip: return skipValue(); break;
+	default: break;
+	}
+
+	if (depth >= ReaderMaxDepth) {
+		failed = true;
+		return false;
+	}
+
+	++ r;
+	skipWhitespace();
+	if (r.is(']')) {
+		++ r;
+		return emit(visitor.onEndArray());
+	}
+
+	while (readValue(depth + 1)) {
+		skipWhitespace();
+		if (r.is(',')) {
+			++ r;
+			skipWhitespace();
+		} else if (r.is(']')) {
+			++ r;
+			return emit(visitor.onEndArray());
+		} else {
+			failed = true;
+			break;
+		}
+	}
+	return false;
+}
+
+template <typename Interface, typename Visitor>
+bool Reader<Interface, Visitor>::readDict(uint32_t depth) {
+	switch (visitor.onBeginDict(maxOf<size_t>())) {
+	case ReaderResult::Stop: stopped = true; return false; break;
+	case ReaderResult::Skip: return skipValue(); break;
+	default: break;
+	}
+
+	if (depth >= ReaderMaxDepth) {
+		failed = true;
+		return false;
+	}
+
+	++ r;
+	skipWhitespace();
+	if (r.is('}')) {
+		++ r;
+		return emit(visitor.onEndDict());
+	}
+
+	StringView key;
+	while (r.is('"')) {
+		if (!readString(keyBuf, key)) {
+			return false;
+		}
+
+		skipWhitespace();
+		if (!r.is(':')) {
+			break;
+		}
+		++ r;
+		skipWhitespace();
+
+		switch (visitor.onKey(key)) {
+		case ReaderResult::Stop: stopped = true; return false; break;
+		case ReaderResult::Skip:
+			if (!skipValue()) {
+				return false;
+			}
+			break;
+		default:
+			if (!readValue(depth + 1)) {
+				return false;
+			}
+			break;
+		}
+
+		skipWhitespace();
+		if (r.is(',')) {
+			++ r;
+			skipWhitespace();
+		} else if (r.is('}')) {
+			++ r;
+			return emit(visitor.onEndDict());
+		} else {
+			break;
+		}
+	}
+
+	failed = true;
+	return false;
+}
+
+template <typename Interface, typename Visitor>
+bool Reader<Interface, Visitor>::readValue(uint32_t depth) {
+	if (r.empty()) {
+		failed = true;
+		return false;
+	}
+
+	switch (r[0]) {
+	case '"': {
+		StringView str;
+		if (!readString(buf, str)) {
+			return false;
+		}
+		return emit(visitor.onString(str));
+		break;
+	}
+	case 't':
+		if (r.is("true")) {
+			r += 4;
+			return emit(visitor.onBool(true));
+		}
+		break;
+	case 'f':
+		if (r.is("false")) {
+			r += 5;
+			return emit(visitor.onBool(false));
+		}
+		break;
+	case 'n':
+		if (r.is("null")) {
+			r += 4;
+			return emit(visitor.onNull());
+		} else if (r.is("nan")) {
+			r += 3;
+			return emit(visitor.onDouble(nan()));
+		}
+		break;
+	case '0': case '1': case '2': case '3': case '4': case '5':
+	case '6': case '7': case '8': case '9': case '-': {
+		bool isFloat = false;
+		int64_t intVal = 0;
+		double doubleVal = 0.0;
+		auto ptr = r.data();
+		if (!decodeNumber(ptr, r.data() + r.size(), intVal, doubleVal, isFloat)) {
+			break;
+		}
+		r += ptr - r.data();
+		return emit(isFloat ? visitor.onDouble(doubleVal) : visitor.onInteger(intVal));
+		break;
+	}
+	case '[':
+		return readArray(depth);
+		break;
+	case '{':
+		return readDict(depth);
+		break;
+	default:
+		break;
+	}
+
+	failed = true;
+	return false;
+}
+
+template <typename Interface, typename Visitor>
+bool Reader<Interface, Visitor>::skipValue() {
+	if (r.empty()) {
+		failed = true;
+		return false;
+	}
+
+	switch (r[0]) {
+	case '"':
+		return skipString();
+		break;
+	case '[':
+	case '{': {
+		// only brackets balance is tracked here
+		size_t level = 0;
+		do {
+			r.skipUntil<StringView::Chars<'"', '[', ']', '{', '}'>>();
+			if (r.empty()) {
+				failed = true;
+				return false;
+			}
+			switch (r[0]) {
+			case '"':
+				if (!skipString()) {
+					return false;
+				}
+				break;
+			case '[':
+			case '{':
+				++ level;
+				++ r;
+				break;
+			default:
+				-- level;
+				++ r;
+				break;
+			}
+		} while (level > 0);
+		return true;
+		break;
+	}
+	default:
+		r.skipUntil<StringView::Chars<',', ']', '}', ' ', '\n', '\r', '\t'>>();
+		return true;
+		break;
+	}
+	return false;
+}
+
+template <typename Interface = DefaultInterface, typename Visitor>
+bool visit(StringView &n, Visitor &v) {
+	Reader<Interface, Visitor> dec(n, v);
+	auto ret = dec.read();
+	n = dec.r;
+	return ret;
+}
+
+template <typename Interface = DefaultInterface, typename Visitor>
+bool visit(const StringView &n, Visitor &v) {
+	StringView tmp(n);
+	return visit<Interface>(tmp, v);
+}
+
+}
+
+// Visitor, that materializes values, like data::read does
+template <typename Interface = DefaultInterface>
+class ValueBuilder : public ReaderVisitor {
+public:
+	using ValueType = ValueTemplate<Interface>;
+
+	ValueBuilder(ValueType &val) : _root(&val) { }
+
+	ReaderResult onBeginArray(size_t size) {
+		auto val = next();
+		*val = ValueType(ValueType::Type::ARRAY);
+		if (size != maxOf<size_t>()) {
+			val->getArray().reserve(size);
+		}
+		_stack.emplace_back(val);
+		return ReaderResult::Continue;
+	}
+
+	ReaderResult onBeginDict(size_t) {
+		auto val = next();
+		*val = ValueType(ValueType::Type::DICTIONARY);
+		_stack.emplace_back(val);
+		return ReaderResult::Continue;
+	}
+
+	ReaderResult onEndArray() { _stack.pop_back(); return ReaderResult::Continue; }
+	ReaderResult onEndDict() { _stack.pop_back(); return ReaderResult::Continue; }
+	ReaderResult onKey(StringView key) { _key = key; return ReaderResult::Continue; }
+
+	ReaderResult onNull() { next(); return ReaderResult::Continue; }
+	ReaderResult onBool(bool val) { next()->setBool(val); return ReaderResult::Continue; }
+	ReaderResult onInteger(int64_t val) { next()->setInteger(val); return ReaderResult::Continue; }
+	ReaderResult onDouble(double val) { next()->setDouble(val); return ReaderResult::Continue; }
+	ReaderResult onString(StringView val) { next()->setString(val); return ReaderResult::Continue; }
+	ReaderResult onBytes(BytesView val) { next()->setBytes(val); return ReaderResult::Continue; }
+
+	// true if last started container is closed
+	bool empty() const { return _stack.empty(); }
+
+protected:
+	ValueType *next() {
+		if (_stack.empty()) {
+			*_root = ValueType();
+			return _root;
+		}
+
+		auto back = _stack.back();
+		if (back->isArray()) {
+			return &back->addValue(ValueType());
+		} else {
+			return &back->setValue(ValueType(), _key);
+		}
+	}
+
+	ValueType *_root;
+	StringView _key;
+	typename Interface::template ArrayType<ValueType *> _stack;
+};
+
+// Visitor, that extracts only selected values by paths, other data is skipped without materialization
+//
+// Path is a keys, separated with '.', array items addressed by index: "data.items.0.name"
+// Value for path stored in values[idx]; without storage (empty values, or nullptr in it) path is only marked as found
+// Reading is stopped as soon as all paths are found
+// Projection with more then MaxFields paths, or with empty path, or with path longer then MaxDepth components
+// is invalid: isValid() returns false, nothing is extracted and isComplete() is never true
+template <typename Interface = DefaultInterface>
+class Projection : public ReaderVisitor {
+public:
+	using ValueType = ValueTemplate<Interface>;
+
+	static constexpr size_t MaxFields = 64;
+	static constexpr uint32_t MaxDepth = 16;
+
+	Projection(SpanView<StringView> paths, SpanView<ValueType *> values = SpanView<ValueType *>())
+	: _paths(paths), _values(values), _builder(_capture) {
+		if (_paths.size() > MaxFields) {
+			_valid = false;
+			_candidates[0] = 0;
+			return;
+		}
+
+		for (size_t i = 0; i < _paths.size(); ++ i) {
+			size_t len = 0;
+			if (!_paths[i].empty()) {
+				len = 1;
+				for (size_t j = 0; j < _paths[i].size(); ++ j) {
+					if (_paths[i][j] == '.') {
+						++ len;
+					}
+				}
+			}
+			if (len > 0 && len <= MaxDepth) {
+				_lengths[i] = uint8_t(len);
+				_all |= (uint64_t(1) << i);
+			} else {
+				_lengths[i] = 0;
+				_valid = false;
+			}
+		}
+		if (!_valid) {
+			_all = 0;
+		}
+		_candidates[0] = _all;
+	}
+
+	bool isValid() const { return _valid; }
+	bool isFound(size_t idx) const { return idx < MaxFields && (_found & (uint64_t(1) << idx)) != 0; }
+	bool isComplete() const { return _valid && _found == _all; }
+
+	ReaderResult onBeginArray(size_t size) {
+		if (_captureLevel > 0) {
+			++ _captureLevel;
+			return _builder.onBeginArray(size);
+		}
+		return beginContainer(true);
+	}
+
+	ReaderResult onBeginDict(size_t size) {
+		if (_captureLevel > 0) {
+			++ _captureLevel;
+			return _builder.onBeginDict(size);
+		}
+		return beginContainer(false);
+	}
+
+	ReaderResult onEndArray() {
+		if (_captureLevel > 0) {
+			_builder.onEndArray();
+			return endCapture();
+		}
+		return endContainer();
+	}
+
+	ReaderResult onEndDict() {
+		if (_captureLevel > 0) {
+			_builder.onEndDict();
+			return endCapture();
+		}
+		return endContainer();
+	}
+
+	ReaderResult onKey(StringView key) {
+		if (_captureLevel > 0) {
+			return _builder.onKey(key);
+		}
+
+		_pending = 0;
+		auto c = _candidates[_level];
+		for (size_t i = 0; c; ++ i, c >>= 1) {
+			if ((c & 1) && getComponent(_paths[i], _level - 1) == key) {
+				_pending |= (uint64_t(1) << i);
+			}
+		}
+		return _pending ? ReaderResult::Continue : ReaderResult::Skip;
+	}
+
+	ReaderResult onNull() {
+		if (_captureLevel > 0) { return _builder.onNull(); }
+		return onScalar([&] (ValueType &val) { val = ValueType(); });
+	}
+
+	ReaderResult onBool(bool v) {
+		if (_captureLevel > 0) { return _builder.onBool(v); }
+		return onScalar([&] (ValueType &val) { val.setBool(v); });
+	}
+
+	ReaderResult onInteger(int64_t v) {
+		if (_captureLevel > 0) { return _builder.onInteger(v); }
+		return onScalar([&] (ValueType &val) { val.setInteger(v); });
+	}
+
+	ReaderResult onDouble(double v) {
+		if (_captureLevel > 0) { return _builder.onDouble(v); }
+		return onScalar([&] (ValueType &val) { val.setDouble(v); });
+	}
+
+	ReaderResult onString(StringView v) {
+		if (_captureLevel > 0) { return _builder.onString(v); }
+		return onScalar([&] (ValueType &val) { val.setString(v); });
+	}
+
+	ReaderResult onBytes(BytesView v) {
+		if (_captureLevel > 0) { return _builder.onBytes(v); }
+		return onScalar([&] (ValueType &val) { val.setBytes(v); });
+	}
+
+protected:
+	static StringView getComponent(StringView path, uint32_t idx) {
+		StringView ret = path.readUntil<StringView::Chars<'.'>>();
+		while (idx > 0) {
+			++ path;
+			ret = path.readUntil<StringView::Chars<'.'>>();
+			-- idx;
+		}
+		return ret;
+	}
+
+	ValueType *getStorage(size_t idx) const {
+		return (idx < _values.size()) ? _values[idx] : nullptr;
+	}
+
+	// fields, that points to current value within container
+	uint64_t match() {
+		if (_level == 0) {
+			return 0;
+		}
+
+		if (!_isArray[_level]) {
+			auto ret = _pending;
+			_pending = 0;
+			return ret;
+		}
+
+		auto idx = _index[_level] ++;
+		uint64_t ret = 0;
+		auto c = _candidates[_level];
+		for (size_t i = 0; c; ++ i, c >>= 1) {
+			if (c & 1) {
+				auto comp = getComponent(_paths[i], _level - 1);
+				if (!comp.empty() && comp.readInteger().get(-1) == int64_t(idx) && comp.empty()) {
+					ret |= (uint64_t(1) << i);
+				}
+			}
+		}
+		return ret;
+	}
+
+	// fields, that ends on current level
+	uint64_t complete(uint64_t fields) const {
+		uint64_t ret = 0;
+		auto c = fields;
+		for (size_t i = 0; c; ++ i, c >>= 1) {
+			if ((c & 1) && _lengths[i] == _level) {
+				ret |= (uint64_t(1) << i);
+			}
+		}
+		return ret;
+	}
+
+	template <typename Callback>
+	ReaderResult onScalar(const Callback &cb) {
+		auto fields = complete(match());
+		for (size_t i = 0; fields; ++ i, fields >>= 1) {
+			if (fields & 1) {
+				if (auto val = getStorage(i)) {
+					cb(*val);
+				}
+				_found |= (uint64_t(1) << i);
+			}
+		}
+		return isComplete() ? ReaderResult::Stop : ReaderResult::Continue;
+	}
+
+	ReaderResult beginContainer(bool isArray) {
+		uint64_t fields = _all;
+		if (_level > 0) {
+			fields = match();
+			auto target = complete(fields);
+			if (target) {
+				return beginCapture(target, fields & ~target, isArray);
+			}
+		}
+
+		if (!fields || _level >= MaxDepth) {
+			return ReaderResult::Skip;
+		}
+
+		++ _level;
+		_candidates[_level] = fields;
+		_isArray[_level] = isArray;
+		_index[_level] = 0;
+		return ReaderResult::Continue;
+	}
+
+	ReaderResult endContainer() {
+		if (_level > 0) {
+			-- _level;
+		}
+		return isComplete() ? ReaderResult::Stop : ReaderResult::Continue;
+	}
+
+	// container is a value for one or more paths, nested paths are resolved from captured value
+	ReaderResult beginCapture(uint64_t target, uint64_t nested, bool isArray) {
+		bool needValue = (nested != 0);
+		auto c = target;
+		for (size_t i = 0; c; ++ i, c >>= 1) {
+			if ((c & 1) && getStorage(i)) {
+				needValue = true;
+			}
+		}
+
+		if (!needValue) {
+			_found |= target;
+			return isComplete() ? ReaderResult::Stop : ReaderResult::Skip;
+		}
+
+		_captureTarget = target;
+		_captureNested = nested;
+		_captureLevel = 1;
+		_capture = ValueType();
+		return isArray ? _builder.onBeginArray(maxOf<size_t>()) : _builder.onBeginDict(maxOf<size_t>());
+	}
+
+	ReaderResult endCapture() {
+		-- _captureLevel;
+		if (_captureLevel > 0) {
+			return ReaderResult::Continue;
+		}
+
+		auto nested = _captureNested;
+		for (size_t i = 0; nested; ++ i, nested >>= 1) {
+			if (nested & 1) {
+				const ValueType *val = &_capture;
+				for (uint32_t j = _level; j < _lengths[i] && val; ++ j) {
+					auto comp = getComponent(_paths[i], j);
+					if (val->isDictionary()) {
+						val = val->hasValue(comp) ? &val->getValue(comp) : nullptr;
+					} else if (val->isArray()) {
+						auto idx = comp.readInteger().get(-1);
+						val = (idx >= 0 && size_t(idx) < val->size() && comp.empty()) ? &val->getValue(size_t(idx)) : nullptr;
+					} else {
+						val = nullptr;
+					}
+				}
+				if (val) {
+					if (auto storage = getStorage(i)) {
+						*storage = *val;
+					}
+					_found |= (uint64_t(1) << i);
+				}
+			}
+		}
+
+		auto target = _captureTarget;
+		ValueType *first = nullptr;
+		for (size_t i = 0; target; ++ i, target >>= 1) {
+			if (target & 1) {
+				if (auto storage = getStorage(i)) {
+					if (!first) {
+						*storage = std::move(_capture);
+						first = storage;
+					} else {
+						*storage = *first;
+					}
+				}
+				_found |= (uint64_t(1) << i);
+			}
+		}
+
+		_capture = ValueType();
+		return isComplete() ? ReaderResult::Stop : ReaderResult::Continue;
+	}
+
+	SpanView<StringView> _paths;
+	SpanView<ValueType *> _values;
+
+	bool _valid = true;
+	uint64_t _all = 0; // all valid paths
+	uint64_t _found = 0;
+	uint64_t _pending = 0; // paths, matched with last key
+
+	uint32_t _level = 0; // number of tracked containers
+	std::array<uint8_t, MaxFields> _lengths; // number of components in path
+	std::array<uint64_t, MaxDepth + 1> _candidates; // paths, that goes through container on level
+	std::array<bool, MaxDepth + 1> _isArray;
+	std::array<size_t, MaxDepth + 1> _index; // next array item index on level
+
+	uint32_t _captureLevel = 0;
+	uint64_t _captureTarget = 0;
+	uint64_t _captureNested = 0;
+	ValueType _capture;
+	ValueBuilder<Interface> _builder;
+};
+
+NS_SP_EXT_END(data)
+
+#endif /* COMMON_DATA_SPDATAREADER_H_ */
@@ -38,6 +38,9 @@ namespace json {
 template <typename Interface = memory::DefaultInterface>
 struct Decoder;
 
+template <typename Interface = memory::DefaultInterface>
+struct StructuralDecoder;
+
 }
 
 namespace cbor {
@@ -353,6 +356,9 @@ protected:
 	template <typename Iface>
 	friend struct json::Decoder;
 
+	template <typename Iface>
+	friend struct json::StructuralDecoder;
+
 	template <typename Iface>
 	friend struct serenity::Decoder;
 
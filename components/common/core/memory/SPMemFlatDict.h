@@ -0,0 +1,372 @@
+/**
+Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#ifndef COMMON_MEMORY_SPMEMFLATDICT_H_
+#define COMMON_MEMORY_SPMEMFLATDICT_H_
+
+#include "SPCore.h"
+
+NS_SP_EXT_BEGIN(memory)
+
+template <typename Type>
+class flat_dict_iterator {
+public:
+	using iterator_category = std::random_access_iterator_tag;
+	using value_type = std::remove_cv_t<Type>;
+	using difference_type = std::ptrdiff_t;
+	using pointer = Type *;
+	using reference = Type &;
+
+	flat_dict_iterator() noexcept { }
+	flat_dict_iterator(Type *data, const uint32_t *pos) noexcept : _data(data), _pos(pos) { }
+
+	template <typename T, typename = std::enable_if_t<std::is_convertible<T *, Type *>::value>>
+	flat_dict_iterator(const flat_dict_iterator<T> &other) noexcept : _data(other.data()), _pos(other.position()) { }
+
+	reference operator*() const noexcept { return _data[*_pos]; }
+	pointer operator->() const noexcept { return &_data[*_pos]; }
+	reference operator[](difference_type n) const noexcept { return _data[_pos[n]]; }
+
+	flat_dict_iterator &operator++() noexcept { ++ _pos; return *this; }
+	flat_dict_iterator operator++(int) noexcept { auto tmp = *this; ++ _pos; return tmp; }
+	flat_dict_iterator &operator--() noexcept { -- _pos; return *this; }
+	flat_dict_iterator operator--(int) noexcept { auto tmp = *this; -- _pos; return tmp; }
+
+	flat_dict_iterator &operator+=(difference_type n) noexcept { _pos += n; return *this; }
+	flat_dict_iterator &operator-=(difference_type n) noexcept { _pos -= n; return *this; }
+	flat_dict_iterator operator+(difference_type n) const noexcept { return flat_dict_iterator(_data, _pos + n); }
+	flat_dict_iterator operator-(difference_type n) const noexcept { return flat_dict_iterator(_data, _pos - n); }
+	difference_type operator-(const flat_dict_iterator &other) const noexcept { return _pos - other._pos; }
+
+	bool operator==(const flat_dict_iterator &other) const noexcept { return _pos == other._pos; }
+	bool operator!=(const flat_dict_iterator &other) const noexcept { return _pos != other._pos; }
+	bool operator<(const flat_dict_iterator &other) const noexcept { return _pos < other._pos; }
+	bool operator>(const flat_dict_iterator &other) const noexcept { return _pos > other._pos; }
+	bool operator<=(const flat_dict_iterator &other) const noexcept { return _pos <= other._pos; }
+	bool operator>=(const flat_dict_iterator &other) const noexcept { return _pos >= other._pos; }
+
+	Type *data() const noexcept { return _data; }
+	const uint32_t *position() const noexcept { return _pos; }
+
+protected:
+	Type *_data = nullptr;
+	const uint32_t *_pos = nullptr;
+};
+
+/* Dictionary with string keys, stored in single vector of pairs
+ *
+ * Pairs are stored in order of insertion in one allocation (short keys are stored inline with SSO), with
+ * additional sorted vector of positions, so, iteration is ordered like std::map, and insertion only moves
+ * positions, not pairs. Dictionaries with HashIndexThreshold or more keys also maintains open-addressing
+ * hash index, so, lookup takes one hash and, usually, one key comparison instead of binary search.
+ *
+ * Insertion is O(n) for positions, so, it's best suitable for objects, that are built once, then read.
+ * Insertion can invalidate references to values, like with vector.
+ *
+ * Semantic of emplace follows std::map: existing value is not replaced.
+ */
+template <typename Key, typename Value, template <typename> class VectorType, typename AllocBaseType = AllocBase>
+class flat_dict : public AllocBaseType {
+public:
+	static constexpr size_t InitialCapacity = 8;
+	static constexpr size_t HashIndexThreshold = 16;
+
+	using key_type = Key;
+	using mapped_type = Value;
+	using value_type = Pair<Key, Value>;
+	using key_compare = std::less<>;
+
+	using reference = value_type &;
+	using const_reference = const value_type &;
+
+	using vector_type = VectorType<value_type>;
+	using index_type = VectorType<uint32_t>;
+
+	using iterator = flat_dict_iterator<value_type>;
+	using const_iterator = flat_dict_iterator<const value_type>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	using size_type = size_t;
+	using difference_type = std::ptrdiff_t;
+
+	flat_dict() noexcept { }
+
+	flat_dict(const flat_dict &) = default;
+	flat_dict(flat_dict &&) = default;
+
+	flat_dict &operator=(const flat_dict &) = default;
+	flat_dict &operator=(flat_dict &&) = default;
+
+	template <class InputIterator>
+	flat_dict(InputIterator first, InputIterator last) {
+		for (auto it = first; it != last; ++ it) {
+			emplace(it->first, it->second);
+		}
+	}
+
+	flat_dict(InitializerList<value_type> il) {
+		reserve(il.size());
+		for (auto &it : il) {
+			emplace(std::move(const_cast<Key &>(it.first)), std::move(const_cast<Value &>(it.second)));
+		}
+	}
+
+	void reserve(size_type cap) { _data.reserve(cap); _order.reserve(cap); }
+
+	bool empty() const noexcept { return _data.empty(); }
+	size_t size() const noexcept { return _data.size(); }
+	void clear() { _data.clear(); _order.clear(); _index.clear(); }
+
+	iterator begin() noexcept { return iterator(_data.data(), _order.data()); }
+	iterator end() noexcept { return iterator(_data.data(), _order.data() + _order.size()); }
+
+	const_iterator begin() const noexcept { return const_iterator(_data.data(), _order.data()); }
+	const_iterator end() const noexcept { return const_iterator(_data.data(), _order.data() + _order.size()); }
+
+	const_iterator cbegin() const noexcept { return begin(); }
+	const_iterator cend() const noexcept { return end(); }
+
+	reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+	reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+
+	const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+	const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+	template <typename K, typename ... Args>
+	Pair<iterator, bool> emplace(K &&key, Args && ... args) {
+		return try_emplace(std::forward<K>(key), std::forward<Args>(args)...);
+	}
+
+	template <typename K, typename ... Args>
+	iterator emplace_hint(const_iterator, K &&key, Args && ... args) {
+		return try_emplace(std::forward<K>(key), std::forward<Args>(args)...).first;
+	}
+
+	template <typename K, typename ... Args>
+	Pair<iterator, bool> try_emplace(K &&key, Args && ... args) {
+		size_t rank = 0;
+		if (_data.empty() || _data[_order.back()].first < key) {
+			// fast path for keys in order
+			rank = _order.size();
+		} else {
+			auto it = lower_bound(key);
+			if (it != end() && !(key < it->first)) {
+				return pair(it, false);
+			}
+			rank = it.position() - _order.data();
+		}
+
+		if (_data.size() < _data.capacity()) {
+			_data.emplace_back(std::piecewise_construct,
+					std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+		} else {
+			// construct before reallocation: arguments can refer to values in this dictionary
+			value_type tmp(std::piecewise_construct,
+					std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+			if (_data.capacity() == 0) {
+				reserve(InitialCapacity);
+			}
+			_data.emplace_back(std::move(tmp));
+		}
+
+		auto pos = uint32_t(_data.size() - 1);
+		if (rank == _order.size()) {
+			_order.emplace_back(pos);
+		} else {
+			_order.emplace(_order.begin() + rank, pos);
+		}
+
+		update_index(rank);
+		return pair(iterator(_data.data(), _order.data() + rank), true);
+	}
+
+	template <typename P>
+	Pair<iterator, bool> insert(P &&value) {
+		return try_emplace(std::forward<P>(value).first, std::forward<P>(value).second);
+	}
+
+	template <typename K, typename M>
+	Pair<iterator, bool> insert_or_assign(K &&key, M &&obj) {
+		auto ret = try_emplace(std::forward<K>(key), std::forward<M>(obj));
+		if (!ret.second) {
+			ret.first->second = std::forward<M>(obj);
+		}
+		return ret;
+	}
+
+	template <typename K>
+	Value &operator[](K &&key) {
+		return try_emplace(std::forward<K>(key)).first->second;
+	}
+
+	iterator erase(const_iterator it) {
+		auto rank = it.position() - _order.data();
+		auto pos = _order[rank];
+
+		_data.erase(_data.begin() + pos);
+		_order.erase(_order.begin() + rank);
+		for (auto &p : _order) {
+			if (p > pos) {
+				-- p;
+			}
+		}
+
+		rebuild_index();
+		return iterator(_data.data(), _order.data() + rank);
+	}
+
+	template <typename K, typename = std::enable_if_t<!std::is_convertible<const K &, const_iterator>::value>>
+	size_type erase(const K &key) {
+		auto it = find(key);
+		if (it != end()) {
+			erase(it);
+			return 1;
+		}
+		return 0;
+	}
+
+	template <typename K> iterator find(const K &key) { return iterator(_data.data(), _order.data() + do_find(key)); }
+	template <typename K> const_iterator find(const K &key) const { return const_iterator(_data.data(), _order.data() + do_find(key)); }
+
+	template <typename K> size_t count(const K &key) const { return do_find(key) != _order.size() ? 1 : 0; }
+	template <typename K> bool contains(const K &key) const { return do_find(key) != _order.size(); }
+
+	template <typename K> iterator lower_bound(const K &key) {
+		return std::lower_bound(begin(), end(), key, [] (const value_type &l, const K &r) { return l.first < r; });
+	}
+	template <typename K> const_iterator lower_bound(const K &key) const {
+		return std::lower_bound(begin(), end(), key, [] (const value_type &l, const K &r) { return l.first < r; });
+	}
+
+	template <typename K> iterator upper_bound(const K &key) {
+		return std::upper_bound(begin(), end(), key, [] (const K &l, const value_type &r) { return l < r.first; });
+	}
+	template <typename K> const_iterator upper_bound(const K &key) const {
+		return std::upper_bound(begin(), end(), key, [] (const K &l, const value_type &r) { return l < r.first; });
+	}
+
+protected:
+	template <typename K>
+	static Pair<const char *, size_t> key_view(const K &key) {
+		if constexpr (std::is_convertible<const K &, const char *>::value) {
+			const char *str = key;
+			return pair(str, strlen(str));
+		} else {
+			return pair((const char *)key.data(), size_t(key.size()));
+		}
+	}
+
+	static uint32_t key_hash(const char *str, size_t len) {
+		return hash::hash32(str, uint32_t(len));
+	}
+
+	// returns rank of key in sorted order, or size() if not found
+	template <typename K>
+	size_t do_find(const K &key) const {
+		if (!_index.empty()) {
+			auto view = key_view(key);
+			auto mask = _index.size() - 1;
+			auto slot = key_hash(view.first, view.second) & mask;
+			while (auto rank = _index[slot]) {
+				auto &k = _data[_order[rank - 1]].first;
+				if (size_t(k.size()) == view.second && memcmp(k.data(), view.first, view.second) == 0) {
+					return rank - 1;
+				}
+				slot = (slot + 1) & mask;
+			}
+			return _order.size();
+		}
+
+		auto it = lower_bound(key);
+		if (it != end() && !(key < it->first)) {
+			return it.position() - _order.data();
+		}
+		return _order.size();
+	}
+
+	// index stores rank + 1, zero is empty slot; table is kept at most half full
+	void index_insert(size_t rank) {
+		auto &k = _data[_order[rank]].first;
+		auto mask = _index.size() - 1;
+		auto slot = key_hash((const char *)k.data(), k.size()) & mask;
+		while (_index[slot]) {
+			slot = (slot + 1) & mask;
+		}
+		_index[slot] = uint32_t(rank + 1);
+	}
+
+	void rebuild_index() {
+		_index.clear();
+		if (_order.size() < HashIndexThreshold) {
+			return;
+		}
+
+		size_t cap = HashIndexThreshold * 2;
+		while (cap < _order.size() * 2) {
+			cap *= 2;
+		}
+
+		_index.resize(cap, 0);
+		for (size_t i = 0; i < _order.size(); ++ i) {
+			index_insert(i);
+		}
+	}
+
+	// key was inserted with rank: shift ranks after it
+	void update_index(size_t rank) {
+		if (_order.size() < HashIndexThreshold) {
+			return;
+		}
+
+		if (_index.empty() || _order.size() * 2 > _index.size()) {
+			rebuild_index();
+			return;
+		}
+
+		if (rank + 1 != _order.size()) {
+			for (auto &it : _index) {
+				if (it > rank) {
+					++ it;
+				}
+			}
+		}
+		index_insert(rank);
+	}
+
+	vector_type _data; // pairs in order of insertion
+	index_type _order; // positions of pairs in key order
+	index_type _index; // hash index of ranks for large dictionaries
+};
+
+template <typename Key, typename Value, template <typename> class VectorType, typename AllocBaseType> inline bool
+operator==(const flat_dict<Key, Value, VectorType, AllocBaseType> &l, const flat_dict<Key, Value, VectorType, AllocBaseType> &r) {
+	return l.size() == r.size() && std::equal(l.begin(), l.end(), r.begin());
+}
+
+template <typename Key, typename Value, template <typename> class VectorType, typename AllocBaseType> inline bool
+operator!=(const flat_dict<Key, Value, VectorType, AllocBaseType> &l, const flat_dict<Key, Value, VectorType, AllocBaseType> &r) {
+	return !(l == r);
+}
+
+NS_SP_EXT_END(memory)
+
+#endif /* COMMON_MEMORY_SPMEMFLATDICT_H_ */
@@ -32,6 +32,7 @@ THE SOFTWARE.
 #include "SPMemSet.h"
 #include "SPMemMap.h"
 #include "SPMemDict.h"
+#include "SPMemFlatDict.h"
 
 NS_SP_EXT_BEGIN(memory)
 
@@ -79,6 +80,16 @@ struct StandartInterface : public memory::AllocBase {
 	static constexpr bool usesMemoryPool() { return false; }
 };
 
+// Interfaces with flat dictionaries (sorted vector with hash index for large objects) instead of rbtree:
+// faster to build and read, but insertion invalidates references to other values of dictionary
+struct PoolFlatInterface : public PoolInterface {
+	template <typename Value> using DictionaryType = memory::flat_dict<StringType, Value, memory::vector, memory::AllocPool>;
+};
+
+struct StandartFlatInterface : public StandartInterface {
+	template <typename Value> using DictionaryType = memory::flat_dict<StringType, Value, VectorType>;
+};
+
 NS_SP_EXT_END(memory)
 
 /*
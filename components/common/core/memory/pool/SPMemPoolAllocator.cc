@@ -75,6 +75,65 @@ namespace stappler::mempool::custom {
 
 static std::atomic<size_t> s_nAllocators = 0;
 
+// protects allocator <-> magazine links, allocator destruction and thread termination
+static std::mutex s_magazinesMutex;
+
+// trivially destructible, so, it remains valid after tl_magazines destruction, when static destructors
+// (like global pool termination) still can free nodes on this thread
+static thread_local bool tl_magazinesReleased = false;
+
+struct ThreadMagazines {
+	MemMagazine *list = nullptr;
+	MemMagazine *last = nullptr;
+
+	~ThreadMagazines() {
+		tl_magazinesReleased = true;
+
+		std::unique_lock<std::mutex> lock(s_magazinesMutex);
+		while (list) {
+			auto mag = list;
+			list = mag->threadNext;
+
+			mag->lock();
+			auto allocator = mag->allocator.load();
+			auto nodes = mag->drain();
+			mag->allocator = nullptr;
+			mag->unlock();
+
+			if (allocator) {
+				auto ref = &allocator->magazines;
+				while (*ref && *ref != mag) {
+					ref = &(*ref)->next;
+				}
+				if (*ref) {
+					*ref = mag->next;
+				}
+				if (nodes) {
+					allocator->free_nodes(nodes);
+				}
+			}
+			delete mag;
+		}
+		last = nullptr;
+	}
+};
+
+static thread_local ThreadMagazines tl_magazines;
+
+MemNode *MemMagazine::drain() {
+	MemNode *ret = nullptr;
+	for (uint32_t i = 0; i < MAGAZINE_INDEX; ++ i) {
+		while (auto node = buf[i]) {
+			buf[i] = node->next;
+			node->next = ret;
+			ret = node;
+		}
+		count[i] = 0;
+	}
+	cached.store(0, std::memory_order_relaxed);
+	return ret;
+}
+
 #if LINUX
 static uint32_t allocator_mmap_realloc(int filedes, void *ptr, uint32_t idx, uint32_t required) {
 	auto oldSize = idx * BOUNDARY_SIZE;
@@ -180,6 +239,36 @@ Allocator::Allocator(bool threadSafe) {
 Allocator::~Allocator() {
 	MemNode *node, **ref;
 
+	if (magazines) {
+		// other threads can hold our nodes, take them back, magazines will be released with their threads
+		MemNode *nodes = nullptr;
+		std::unique_lock<std::mutex> lock(s_magazinesMutex);
+		while (magazines) {
+			auto mag = magazines;
+			magazines = mag->next;
+
+			mag->lock();
+			auto n = mag->drain();
+			while (n) {
+				auto next = n->next;
+				n->next = nodes;
+				nodes = n;
+				n = next;
+			}
+			mag->allocator = nullptr;
+			mag->next = nullptr;
+			mag->unlock();
+		}
+		lock.unlock();
+
+		while (nodes) {
+			node = nodes;
+			nodes = node->next;
+			allocated -= node->endp - (uint8_t *)node;
+			::free(node);
+		}
+	}
+
 	if (mutex) {
 		delete mutex;
 	}
@@ -232,6 +321,12 @@ MemNode *Allocator::alloc(uint32_t in_size) {
 		return nullptr;
 	}
 
+	if (index < MAGAZINE_INDEX && use_magazines()) {
+		if (auto node = magazine_alloc(uint32_t(index))) {
+			return node;
+		}
+	}
+
 	/* First see if there are any nodes in the area we know
 	 * our node will fit into.
 	 */
@@ -361,6 +456,176 @@ MemNode *Allocator::alloc(uint32_t in_size) {
 }
 
 void Allocator::free(MemNode *node) {
+	if (use_magazines()) {
+		node = magazine_free(node);
+		if (!node) {
+			return;
+		}
+	}
+	free_nodes(node);
+}
+
+size_t Allocator::get_cached() const {
+	size_t ret = 0;
+	std::unique_lock<std::mutex> lock(s_magazinesMutex);
+	auto mag = magazines;
+	while (mag) {
+		ret += mag->cached.load(std::memory_order_relaxed);
+		mag = mag->next;
+	}
+	return ret;
+}
+
+bool Allocator::use_magazines() const {
+#if LINUX
+	if (mmapPtr) {
+		return false;
+	}
+#endif
+	return magazinesEnabled && mutex && max == ALLOCATOR_MAX_FREE_UNLIMITED;
+}
+
+MemMagazine *Allocator::get_magazine() {
+	if (tl_magazinesReleased) {
+		// thread magazines was flushed on thread termination, use allocator's lists directly
+		return nullptr;
+	}
+
+	auto &local = tl_magazines;
+	if (local.last && local.last->allocator.load(std::memory_order_relaxed) == this) {
+		return local.last;
+	}
+
+	MemMagazine *unused = nullptr;
+	auto mag = local.list;
+	while (mag) {
+		auto a = mag->allocator.load(std::memory_order_relaxed);
+		if (a == this) {
+			local.last = mag;
+			return mag;
+		} else if (!a) {
+			unused = mag;
+		}
+		mag = mag->threadNext;
+	}
+
+	if (!unused) {
+		unused = new MemMagazine;
+		unused->threadNext = local.list;
+		local.list = unused;
+	}
+
+	std::unique_lock<std::mutex> lock(s_magazinesMutex);
+	unused->allocator = this;
+	unused->next = magazines;
+	magazines = unused;
+
+	local.last = unused;
+	return unused;
+}
+
+MemNode *Allocator::magazine_alloc(uint32_t index) {
+	auto mag = get_magazine();
+	if (!mag) {
+		return nullptr;
+	}
+
+	mag->lock();
+	if (mag->allocator.load(std::memory_order_relaxed) != this) {
+		mag->unlock();
+		return nullptr;
+	}
+
+	if (!mag->buf[index]) {
+		// refill magazine with nodes of exactly this index
+		std::unique_lock<Allocator> lock(*this);
+		if (index <= last) {
+			MemNode **ref = &buf[index];
+			uint32_t n = 0;
+			while (*ref && n < MAGAZINE_BATCH) {
+				auto node = *ref;
+				*ref = node->next;
+				node->next = mag->buf[index];
+				mag->buf[index] = node;
+				++ n;
+
+				current += node->index + 1;
+				if (current > max) {
+					current = max;
+				}
+			}
+
+			if (buf[index] == nullptr && index == last) {
+				uint32_t max_index = last;
+				while (max_index > 0 && buf[max_index] == nullptr) {
+					-- max_index;
+				}
+				last = max_index;
+			}
+
+			mag->count[index] += n;
+			mag->cached.fetch_add(size_t(n) * (index + 1) * BOUNDARY_SIZE, std::memory_order_relaxed);
+		}
+	}
+
+	MemNode *node = mag->buf[index];
+	if (node) {
+		mag->buf[index] = node->next;
+		-- mag->count[index];
+		mag->cached.fetch_sub(node->endp - (uint8_t *)node, std::memory_order_relaxed);
+
+		node->next = nullptr;
+		node->first_avail = (uint8_t *)node + SIZEOF_MEMNODE;
+	}
+	mag->unlock();
+	return node;
+}
+
+MemNode *Allocator::magazine_free(MemNode *node) {
+	auto mag = get_magazine();
+	if (!mag) {
+		return node;
+	}
+
+	mag->lock();
+	if (mag->allocator.load(std::memory_order_relaxed) != this) {
+		mag->unlock();
+		return node;
+	}
+
+	MemNode *ret = nullptr;
+	MemNode *next = nullptr;
+	do {
+		next = node->next;
+		auto index = node->index;
+		if (index < MAGAZINE_INDEX) {
+			if (mag->count[index] >= MAGAZINE_SIZE) {
+				// magazine is full, return batch of nodes to allocator
+				for (uint32_t i = 0; i < MAGAZINE_BATCH; ++ i) {
+					auto n = mag->buf[index];
+					mag->buf[index] = n->next;
+					mag->cached.fetch_sub(n->endp - (uint8_t *)n, std::memory_order_relaxed);
+					n->next = ret;
+					ret = n;
+				}
+				mag->count[index] -= MAGAZINE_BATCH;
+			}
+
+			node->next = mag->buf[index];
+			mag->buf[index] = node;
+			++ mag->count[index];
+			mag->cached.fetch_add(node->endp - (uint8_t *)node, std::memory_order_relaxed);
+		} else {
+			node->next = ret;
+			ret = node;
+		}
+	} while ((node = next) != nullptr);
+
+	mag->unlock();
+	return ret;
+}
+
+void Allocator::free_nodes(MemNode *node) {
 	MemNode *next, *freelist = nullptr;
 
 	std::unique_lock<Allocator> lock(*this);
@@ -60,6 +60,13 @@ static constexpr uint32_t MIN_ALLOC (2 * BOUNDARY_SIZE);
 static constexpr uint32_t MAX_INDEX ( 20 );
 static constexpr uint32_t ALLOCATOR_MAX_FREE_UNLIMITED ( 0 );
 
+// per-thread magazines cache nodes with index below MAGAZINE_INDEX (up to 32KiB)
+static constexpr uint32_t MAGAZINE_INDEX ( 8 );
+
+// max nodes of single index in thread magazine, and number of nodes to refill/drain at once
+static constexpr uint32_t MAGAZINE_SIZE ( 16 );
+static constexpr uint32_t MAGAZINE_BATCH ( 8 );
+
 // address space (not actual mem) reservation for mmap allocator
 // you can not allocate more then this with mmap
 static constexpr size_t ALLOCATOR_MMAP_RESERVED = size_t(64_GiB);
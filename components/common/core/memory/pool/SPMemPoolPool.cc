@@ -168,6 +168,9 @@ Pool *Pool::create(Allocator *alloc, PoolFlags flags) {
 	Allocator *allocator = alloc;
 	if (allocator == nullptr) {
 		allocator = new Allocator((flags & PoolFlags::ThreadSafeAllocator) != PoolFlags::None);
+
+		// private allocator of unmanaged pool is destroyed with the pool, thread cache is only an overhead for it
+		allocator->magazinesEnabled = false;
 	}
 
 	auto node = allocator->alloc(MIN_ALLOC - SIZEOF_MEMNODE);
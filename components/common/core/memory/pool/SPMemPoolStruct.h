@@ -86,6 +86,28 @@ struct Cleanup {
 	static void run(Cleanup **cref);
 };
 
+struct Allocator;
+
+// Thread-local cache of free nodes for single allocator; owner thread works with it
+// without allocator's lock, nodes are returned to allocator in batches
+struct MemMagazine {
+	std::atomic<Allocator *> allocator = nullptr;
+	MemMagazine *next = nullptr; // next magazine of the same allocator
+	MemMagazine *threadNext = nullptr; // next magazine of the same thread
+	std::atomic_flag busy = ATOMIC_FLAG_INIT;
+	std::array<MemNode *, MAGAZINE_INDEX> buf;
+	std::array<uint32_t, MAGAZINE_INDEX> count;
+	std::atomic<size_t> cached = 0; // bytes in magazine
+
+	MemMagazine() { buf.fill(nullptr); count.fill(0); }
+
+	void lock() { while (busy.test_and_set(std::memory_order_acquire)) { } }
+	void unlock() { busy.clear(std::memory_order_release); }
+
+	// extract all nodes as single list
+	MemNode *drain();
+};
+
 struct Allocator {
 	using AllocMutex = std::recursive_mutex;
 
@@ -99,10 +121,15 @@ struct Allocator {
 
 	AllocMutex *mutex = nullptr;
 	std::array<MemNode *, MAX_INDEX> buf;
-	std::atomic<size_t> allocated;
+	std::atomic<size_t> allocated; // bytes, acquired from system, including nodes in thread magazines
+	MemMagazine *magazines = nullptr;
+	bool magazinesEnabled = true;
 
 	static size_t getAllocatorsCount();
 
+	// bytes of free nodes, cached in thread magazines
+	size_t get_cached() const;
+
 	Allocator(bool threadSafe = true);
 	~Allocator();
 
@@ -111,6 +138,13 @@ struct Allocator {
 	MemNode *alloc(uint32_t);
 	void free(MemNode *);
 
+	// magazines are used for shared thread-safe allocators without free memory limit
+	bool use_magazines() const;
+	MemMagazine *get_magazine();
+	MemNode *magazine_alloc(uint32_t index);
+	MemNode *magazine_free(MemNode *);
+	void free_nodes(MemNode *);
+
 	void lock();
 	void unlock();
 
@@ -223,6 +223,12 @@ struct ToStringTraits<memory::PoolInterface> {
 	}
 };
 
+template <>
+struct ToStringTraits<memory::StandartFlatInterface> : ToStringTraits<memory::StandartInterface> { };
+
+template <>
+struct ToStringTraits<memory::PoolFlatInterface> : ToStringTraits<memory::PoolInterface> { };
+
 NS_SP_EXT_END(string)
 
 
@@ -241,7 +241,7 @@ void file::close() {
 	if (is_open()) {
 		if (!_isBundled) {
 			fclose(_nativeFile);
-			if (_flags != Flags::DelOnClose && _buf[0] != 0) {
+			if (_flags == Flags::DelOnClose && _buf[0] != 0) {
 				::unlink(_buf);
 			}
 			memset(_buf, 0, 256);
@@ -344,6 +344,18 @@ struct ProducerTraits<filesystem::ifile> {
 	}
 };
 
+template <>
+struct ConsumerTraits<filesystem::ifile> {
+	using type = filesystem::ifile;
+	static size_t WriteFn(void *ptr, const uint8_t *buf, size_t nbytes) {
+		auto r = ((type *)ptr)->xsputn((const char *)buf, nbytes);
+		return (r > 0) ? size_t(r) : 0;
+	}
+
+	// data is flushed on close
+	static void FlushFn(void *ptr) { }
+};
+
 NS_SP_EXT_END(io)
 
 #endif /* COMMON_UTILS_SPFILESYSTEM_H_ */
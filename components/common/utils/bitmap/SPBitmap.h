@@ -168,6 +168,13 @@ public:
 
 	Bitmap resample(ResampleFilter, uint32_t width, uint32_t height, uint32_t stride = 0) const;
 
+	// streaming resample: image from producer is decoded, resampled and encoded into consumer line by line,
+	// only filter window of source lines is kept in memory; output format is the same as source
+	// (or PNG, if source format is not writable)
+	static bool resample(const io::Producer &, const io::Consumer &, uint32_t width, uint32_t height);
+
+	static bool resample(const io::Producer &, const io::Consumer &, ResampleFilter, uint32_t width, uint32_t height);
+
 protected:
 	void setInfo(uint32_t w, uint32_t h, PixelFormat c, Alpha a = Bitmap::Alpha::Unpremultiplied, uint32_t stride = 0);
 
@@ -209,13 +216,43 @@ public:
 	using save_fn = bool (*) (const StringView &, const uint8_t *data, uint32_t width, uint32_t height, uint32_t stride,
 			Color format, bool invert);
 
+	// image parameters for line-by-line processing, lines are tightly packed (stride is width * bpp)
+	struct LineInfo {
+		Color color = Color::RGBA8888;
+		Alpha alpha = Alpha::Opaque;
+		uint32_t width = 0;
+		uint32_t height = 0;
+	};
+
+	using line_fn = Callback<bool(const uint8_t *)>;
+	using info_fn = Callback<bool(const LineInfo &)>;
+	using source_fn = Callback<bool(const line_fn &)>;
+
+	// decoder calls info callback with image parameters, then line callback for every line from top to bottom;
+	// decoder can reduce image size, if it can do it cheaply (like JPEG DCT scaling), but not below minWidth x minHeight;
+	// returning false from callback stops decoding
+	using read_lines_fn = bool (*) (const io::Producer &, uint32_t minWidth, uint32_t minHeight,
+			const info_fn &, const line_fn &);
+
+	// encoder calls source with line callback, source should push exactly info.height lines into it;
+	// info is read only when first line is pushed, so source can fill it when it starts
+	using write_lines_fn = bool (*) (const io::Consumer &, const LineInfo &info, const source_fn &);
+
 	static void add(const BitmapFormat &);
 
+	// decode image from producer line by line; formats without line reader are decoded in memory
+	static bool readLines(const io::Producer &, uint32_t minWidth, uint32_t minHeight, const info_fn &, const line_fn &);
+
+	// encode image into consumer line by line; formats without line writer are encoded from memory
+	static bool writeLines(FileFormat, const io::Consumer &, const LineInfo &, const source_fn &);
+
 	BitmapFormat(FileFormat, const check_fn&, const size_fn &, const load_fn & = nullptr,
-			const write_fn & = nullptr, const save_fn & = nullptr);
+			const write_fn & = nullptr, const save_fn & = nullptr,
+			const read_lines_fn & = nullptr, const write_lines_fn & = nullptr);
 
 	BitmapFormat(const String &, const check_fn&, const size_fn &, const load_fn & = nullptr,
-			const write_fn & = nullptr, const save_fn & = nullptr);
+			const write_fn & = nullptr, const save_fn & = nullptr,
+			const read_lines_fn & = nullptr, const write_lines_fn & = nullptr);
 
 	StringView getName() const;
 
@@ -244,6 +281,8 @@ public:
 	load_fn getLoadFn() const;
 	write_fn getWriteFn() const;
 	save_fn getSaveFn() const;
+	read_lines_fn getReadLinesFn() const;
+	write_lines_fn getWriteLinesFn() const;
 
 protected:
 	check_fn check_ptr = nullptr;
@@ -251,6 +290,8 @@ protected:
 	load_fn load_ptr = nullptr;
 	write_fn write_ptr = nullptr;
 	save_fn save_ptr = nullptr;
+	read_lines_fn read_lines_ptr = nullptr;
+	write_lines_fn write_lines_ptr = nullptr;
 
 	Flags flags = None;
 	FileFormat format = FileFormat::Custom;
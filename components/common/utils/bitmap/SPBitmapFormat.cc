@@ -60,6 +60,27 @@ struct JpegError {
 	}
 };
 
+// we only support RGB or grayscale
+static Color setupColorSpace(j_decompress_ptr cinfo, Color color) {
+	if (cinfo->jpeg_color_space == JCS_GRAYSCALE) {
+		return (color == Color::A8?Color::A8:Color::I8);
+	} else if (cinfo->jpeg_color_space == JCS_YCCK || cinfo->jpeg_color_space == JCS_CMYK) {
+		cinfo->out_color_space = JCS_CMYK;
+		return Color::RGB888;
+	} else {
+		cinfo->out_color_space = JCS_RGB;
+		return Color::RGB888;
+	}
+}
+
+static void convertCmykLine(uint8_t *loc, const uint8_t *buf, uint32_t width) {
+	for (size_t i = 0; i < width; ++ i) {
+		*loc++ = (buf[i * 4]) * (buf[i * 4 + 3]) / 255;
+		*loc++ = (buf[i * 4 + 1]) * (buf[i * 4 + 3]) / 255;
+		*loc++ = (buf[i * 4 + 2]) * (buf[i * 4 + 3]) / 255;
+	}
+}
+
 static bool loadJpg(const uint8_t *inputData, size_t size,
 		Bytes &outputData, Color &color, Alpha &alpha, uint32_t &width, uint32_t &height,
 		uint32_t &stride, const Bitmap::StrideFn &strideFn) {
@@ -85,16 +106,7 @@ static bool loadJpg(const uint8_t *inputData, size_t size,
 		/* reading the image header which contains image information */
 		jpeg_read_header(&cinfo, TRUE);
 
-		// we only support RGB or grayscale
-		if (cinfo.jpeg_color_space == JCS_GRAYSCALE) {
-			color = (color == Color::A8?Color::A8:Color::I8);
-		} else if (cinfo.jpeg_color_space == JCS_YCCK || cinfo.jpeg_color_space == JCS_CMYK) {
-			cinfo.out_color_space = JCS_CMYK;
-			color = Color::RGB888;
-		} else {
-			cinfo.out_color_space = JCS_RGB;
-			color = Color::RGB888;
-		}
+		color = setupColorSpace(&cinfo, color);
 
 		/* Start decompression jpeg here */
 		jpeg_start_decompress( &cinfo );
@@ -124,12 +136,7 @@ static bool loadJpg(const uint8_t *inputData, size_t size,
 				row_pointer[0] = buf.data();
 				jpeg_read_scanlines(&cinfo, row_pointer, 1);
 
-				auto loc = outputData.data() + location;
-				for (size_t i = 0; i < cinfo.output_width; ++ i) {
-					*loc++ = (buf[i * 4]) * (buf[i * 4 + 3]) / 255;
-					*loc++ = (buf[i * 4 + 1]) * (buf[i * 4 + 3]) / 255;
-					*loc++ = (buf[i * 4 + 2]) * (buf[i * 4 + 3]) / 255;
-				}
+				convertCmykLine(outputData.data() + location, buf.data(), cinfo.output_width);
 				location += stride;
 			}
 		} else {
@@ -149,6 +156,34 @@ static bool loadJpg(const uint8_t *inputData, size_t size,
 	return ret;
 }
 
+static bool setupCompress(j_compress_ptr cinfo, uint32_t width, uint32_t height, Color format) {
+	/* Setting the parameters of the output file here */
+	cinfo->image_width = width;
+	cinfo->image_height = height;
+	cinfo->input_components = Bitmap::getBytesPerPixel(format);
+
+    switch (format) {
+    case Color::A8:
+    case Color::I8:
+    	cinfo->input_components = 1;
+    	cinfo->in_color_space = JCS_GRAYSCALE;
+    	break;
+    case Color::RGB888:
+    	cinfo->input_components = 3;
+    	cinfo->in_color_space = JCS_RGB;
+    	break;
+    default:
+		log::format("JPEG", "Color format is not supported by JPEG!");
+    	return false;
+    	break;
+    }
+
+    /* default compression parameters, we shouldn't be worried about these */
+    jpeg_set_defaults( cinfo );
+    jpeg_set_quality( cinfo, 90, TRUE );
+    return true;
+}
+
 struct JpegStruct {
 	struct jpeg_compress_struct cinfo;
 	struct jpeg_error_mgr jerr;
@@ -202,30 +237,10 @@ struct JpegStruct {
 		/* this is a pointer to one row of image data */
 		JSAMPROW row_pointer[1];
 
-		/* Setting the parameters of the output file here */
-		cinfo.image_width = width;
-		cinfo.image_height = height;
-		cinfo.input_components = Bitmap::getBytesPerPixel(format);
-
-	    switch (format) {
-	    case Color::A8:
-	    case Color::I8:
-	    	cinfo.input_components = 1;
-	    	cinfo.in_color_space = JCS_GRAYSCALE;
-	    	break;
-	    case Color::RGB888:
-	    	cinfo.input_components = 3;
-	    	cinfo.in_color_space = JCS_RGB;
-	    	break;
-	    default:
-			log::format("JPEG", "Color format is not supported by JPEG!");
-	    	return false;
-	    	break;
-	    }
+		if (!setupCompress(&cinfo, width, height, format)) {
+			return false;
+		}
 
-	    /* default compression parameters, we shouldn't be worried about these */
-	    jpeg_set_defaults( &cinfo );
-	    jpeg_set_quality( &cinfo, 90, TRUE );
 	    /* Now do the compression .. */
 	    jpeg_start_compress( &cinfo, TRUE );
 	    /* like reading a file, this time write one row at a time */
@@ -263,6 +278,204 @@ static Bytes writeJpeg(const uint8_t *data, uint32_t width, uint32_t height, uin
 	}
 }
 
+// libjpeg data source, that reads from producer by chunks
+struct JpegSource {
+	struct jpeg_source_mgr pub;
+	const io::Producer *file = nullptr;
+	JOCTET buffer[4_KiB];
+
+	static void init(j_decompress_ptr) { }
+	static void term(j_decompress_ptr) { }
+
+	static boolean fill(j_decompress_ptr cinfo) {
+		auto src = (JpegSource *)cinfo->src;
+		auto size = src->file->read(src->buffer, sizeof(src->buffer));
+		if (size == 0) {
+			// insert fake EOI marker on premature end of data, like stdio source does
+			src->buffer[0] = (JOCTET) 0xFF;
+			src->buffer[1] = (JOCTET) JPEG_EOI;
+			size = 2;
+		}
+
+		src->pub.next_input_byte = src->buffer;
+		src->pub.bytes_in_buffer = size;
+		return TRUE;
+	}
+
+	static void skip(j_decompress_ptr cinfo, long num) {
+		auto src = (JpegSource *)cinfo->src;
+		if (num > 0) {
+			while (num > long(src->pub.bytes_in_buffer)) {
+				num -= long(src->pub.bytes_in_buffer);
+				fill(cinfo);
+			}
+			src->pub.next_input_byte += size_t(num);
+			src->pub.bytes_in_buffer -= size_t(num);
+		}
+	}
+
+	JpegSource(const io::Producer &f) : file(&f) {
+		pub.init_source = &init;
+		pub.fill_input_buffer = &fill;
+		pub.skip_input_data = &skip;
+		pub.resync_to_restart = &jpeg_resync_to_restart;
+		pub.term_source = &term;
+		pub.bytes_in_buffer = 0;
+		pub.next_input_byte = nullptr;
+	}
+};
+
+// libjpeg data destination, that writes into consumer by chunks
+struct JpegDestination {
+	struct jpeg_destination_mgr pub;
+	const io::Consumer *file = nullptr;
+	JOCTET buffer[4_KiB];
+
+	static void init(j_compress_ptr cinfo) {
+		auto dest = (JpegDestination *)cinfo->dest;
+		dest->pub.next_output_byte = dest->buffer;
+		dest->pub.free_in_buffer = sizeof(dest->buffer);
+	}
+
+	static boolean empty(j_compress_ptr cinfo) {
+		auto dest = (JpegDestination *)cinfo->dest;
+		dest->file->write(dest->buffer, sizeof(dest->buffer));
+		init(cinfo);
+		return TRUE;
+	}
+
+	static void term(j_compress_ptr cinfo) {
+		auto dest = (JpegDestination *)cinfo->dest;
+		auto size = sizeof(dest->buffer) - dest->pub.free_in_buffer;
+		if (size > 0) {
+			dest->file->write(dest->buffer, size);
+		}
+		dest->file->flush();
+	}
+
+	JpegDestination(const io::Consumer &f) : file(&f) {
+		pub.init_destination = &init;
+		pub.empty_output_buffer = &empty;
+		pub.term_destination = &term;
+	}
+};
+
+static bool readJpegLines(const io::Producer &file, uint32_t minWidth, uint32_t minHeight,
+		const BitmapFormat::info_fn &infoCb, const BitmapFormat::line_fn &lineCb) {
+	struct jpeg_decompress_struct cinfo;
+	struct JpegError jerr;
+	JpegSource source(file);
+
+	Bytes line;
+	Bytes buf;
+
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = &JpegError::ErrorExit;
+	if (setjmp(jerr.setjmp_buffer))	{
+		jpeg_destroy_decompress(&cinfo);
+		return false;
+	}
+
+	jpeg_create_decompress( &cinfo );
+	cinfo.src = &source.pub;
+
+	jpeg_read_header(&cinfo, TRUE);
+
+	BitmapFormat::LineInfo info;
+	info.color = setupColorSpace(&cinfo, Color::RGB888);
+	info.alpha = Alpha::Opaque;
+
+	// libjpeg can downscale image by 1/2, 1/4 or 1/8 in DCT domain, it's much cheaper then full decode + resample
+	for (unsigned int denom = 8; denom > 1; denom /= 2) {
+		if ((cinfo.image_width + denom - 1) / denom >= minWidth && (cinfo.image_height + denom - 1) / denom >= minHeight) {
+			cinfo.scale_num = 1;
+			cinfo.scale_denom = denom;
+			break;
+		}
+	}
+
+	jpeg_start_decompress( &cinfo );
+
+	info.width = cinfo.output_width;
+	info.height = cinfo.output_height;
+
+	bool ret = infoCb(info);
+	if (ret) {
+		line.resize(cinfo.output_width * cinfo.output_components);
+		if (cinfo.out_color_space == JCS_CMYK) {
+			buf.resize(cinfo.output_width * Bitmap::getBytesPerPixel(info.color));
+		}
+
+		JSAMPROW row_pointer[1] = { line.data() };
+		while (cinfo.output_scanline < cinfo.output_height) {
+			jpeg_read_scanlines(&cinfo, row_pointer, 1);
+			if (cinfo.out_color_space == JCS_CMYK) {
+				convertCmykLine(buf.data(), line.data(), cinfo.output_width);
+				ret = lineCb(buf.data());
+			} else {
+				ret = lineCb(line.data());
+			}
+			if (!ret) {
+				break;
+			}
+		}
+	}
+
+	jpeg_destroy_decompress( &cinfo );
+	return ret;
+}
+
+static bool writeJpegLines(const io::Consumer &file, const BitmapFormat::LineInfo &info, const BitmapFormat::source_fn &source) {
+	struct jpeg_compress_struct cinfo;
+	struct JpegError jerr;
+	JpegDestination dest(file);
+
+	bool started = false;
+	bool failed = false;
+
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = &JpegError::ErrorExit;
+	jpeg_create_compress(&cinfo);
+	cinfo.dest = &dest.pub;
+
+	auto ret = source([&] (const uint8_t *line) -> bool {
+		// source callback is not a part of libjpeg call chain, so, error should return here
+		if (setjmp(jerr.setjmp_buffer)) {
+			failed = true;
+			return false;
+		}
+
+		if (!started) {
+			if (!setupCompress(&cinfo, info.width, info.height, info.color)) {
+				failed = true;
+				return false;
+			}
+			jpeg_start_compress( &cinfo, TRUE );
+			started = true;
+		} else if (cinfo.next_scanline >= cinfo.image_height) {
+			return false;
+		}
+
+		JSAMPROW row_pointer[1] = { (JSAMPROW)line };
+		jpeg_write_scanlines( &cinfo, row_pointer, 1 );
+		return true;
+	});
+
+	if (ret && started && !failed && cinfo.next_scanline == cinfo.image_height) {
+		if (setjmp(jerr.setjmp_buffer)) {
+			jpeg_destroy_compress( &cinfo );
+			return false;
+		}
+
+		jpeg_finish_compress( &cinfo );
+		jpeg_destroy_compress( &cinfo );
+		return true;
+	}
+
+	jpeg_destroy_compress( &cinfo );
+	return false;
+}
+
 NS_SP_EXT_END(jpeg)
 
 
@@ -282,40 +495,21 @@ static void readDynamicData(png_structp pngPtr, png_bytep data, png_size_t lengt
 	state->offset += length;
 }
 
-static bool loadPng(const uint8_t *inputData, size_t size,
-		Bytes &outputData, Color &color, Alpha &alpha, uint32_t &width, uint32_t &height,
-		uint32_t &stride, const Bitmap::StrideFn &strideFn) {
-	auto png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    if (png_ptr == NULL) {
-    	log::text("libpng", "fail to create read struct");
-        return false;
-    }
-
-    auto info_ptr = png_create_info_struct(png_ptr);
-    if (info_ptr == NULL) {
-    	log::text("libpng", "fail to create info struct");
-        png_destroy_read_struct(&png_ptr, NULL, NULL);
-        return false;
-    }
-
-	if (setjmp(png_jmpbuf(png_ptr))) {
-		log::text("libpng", "error in processing (setjmp return)");
-	    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-	    return false;
+static void readProducerData(png_structp pngPtr, png_bytep data, png_size_t length) {
+	auto file = (const io::Producer *)png_get_io_ptr(pngPtr);
+	while (length > 0) {
+		auto size = file->read(data, length);
+		if (size == 0) {
+			png_error(pngPtr, "unexpected end of data");
+		}
+		data += size;
+		length -= size;
 	}
+}
 
-	ReadState state;
-	state.data = inputData;
-	state.offset = 0;
-
-#ifdef PNG_ARM_NEON_API_SUPPORTED
-#if PNG_ARM_NEON_OPT == 1
-	if (platform::proc::_isArmNeonSupported()) {
-		png_set_option(png_ptr, PNG_ARM_NEON, PNG_OPTION_ON);
-	}
-#endif
-#endif
-	png_set_read_fn(png_ptr,(png_voidp)&state, readDynamicData);
+// read header and setup transformations into 8-bit gray, gray-alpha, RGB or RGBA
+static bool readInfo(png_structp png_ptr, png_infop info_ptr, Color &color, Alpha &alpha,
+		uint32_t &width, uint32_t &height, size_t &rowbytes) {
     png_read_info(png_ptr, info_ptr);
 
     width = png_get_image_width(png_ptr, info_ptr);
@@ -339,11 +533,13 @@ static bool loadPng(const uint8_t *inputData, size_t size,
     if (bitdepth < 8) {
         png_set_packing(png_ptr);
     }
+    if (png_get_interlace_type(png_ptr, info_ptr) != PNG_INTERLACE_NONE) {
+    	png_set_interlace_handling(png_ptr);
+    }
 
     png_read_update_info(png_ptr, info_ptr);
-    bitdepth = png_get_bit_depth(png_ptr, info_ptr);
     color_type = png_get_color_type(png_ptr, info_ptr);
-	auto rowbytes = png_get_rowbytes(png_ptr, info_ptr);
+	rowbytes = png_get_rowbytes(png_ptr, info_ptr);
 
 	if (color_type == PNG_COLOR_TYPE_GRAY) {
 		color = (color == Color::A8?Color::A8:Color::I8);
@@ -354,11 +550,60 @@ static bool loadPng(const uint8_t *inputData, size_t size,
 	} else if (color_type == PNG_COLOR_TYPE_RGBA) {
 		color = Color::RGBA8888;
 	} else {
+        log::format("Bitmap", "unsupported color type: %u", (unsigned int)color_type);
+	    return false;
+	}
+
+	if (color == Color::I8 || color == Color::RGB888) {
+		alpha = Alpha::Opaque;
+	} else {
+		alpha = Alpha::Unpremultiplied;
+	}
+
+	return true;
+}
+
+static bool loadPng(const uint8_t *inputData, size_t size,
+		Bytes &outputData, Color &color, Alpha &alpha, uint32_t &width, uint32_t &height,
+		uint32_t &stride, const Bitmap::StrideFn &strideFn) {
+	auto png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (png_ptr == NULL) {
+    	log::text("libpng", "fail to create read struct");
+        return false;
+    }
+
+    auto info_ptr = png_create_info_struct(png_ptr);
+    if (info_ptr == NULL) {
+    	log::text("libpng", "fail to create info struct");
+        png_destroy_read_struct(&png_ptr, NULL, NULL);
+        return false;
+    }
+
+	if (setjmp(png_jmpbuf(png_ptr))) {
+		log::text("libpng", "error in processing (setjmp return)");
+	    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+	    return false;
+	}
+
+	ReadState state;
+	state.data = inputData;
+	state.offset = 0;
+
+#ifdef PNG_ARM_NEON_API_SUPPORTED
+#if PNG_ARM_NEON_OPT == 1
+	if (platform::proc::_isArmNeonSupported()) {
+		png_set_option(png_ptr, PNG_ARM_NEON, PNG_OPTION_ON);
+	}
+#endif
+#endif
+	png_set_read_fn(png_ptr,(png_voidp)&state, readDynamicData);
+
+	size_t rowbytes = 0;
+	if (!readInfo(png_ptr, info_ptr, color, alpha, width, height, rowbytes)) {
 		width = 0;
 		height = 0;
 		stride = 0;
 		outputData.clear();
-        log::format("Bitmap", "unsupported color type: %u", (unsigned int)color_type);
 	    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
 	    return false;
 	}
@@ -369,12 +614,6 @@ static bool loadPng(const uint8_t *inputData, size_t size,
 		stride = (uint32_t)rowbytes;
 	}
 
-	if (color == Color::I8 || color == Color::RGB888) {
-		alpha = Alpha::Opaque;
-	} else {
-		alpha = Alpha::Unpremultiplied;
-	}
-
     // read png data
     png_bytep* row_pointers = new png_bytep[height];
 
@@ -448,6 +687,27 @@ struct PngStruct {
 	    valid = true;
 	}
 
+	static int getColorType(Bitmap::PixelFormat format) {
+		switch (format) {
+		case Bitmap::PixelFormat::A8:
+		case Bitmap::PixelFormat::I8:
+			return PNG_COLOR_TYPE_GRAY;
+			break;
+		case Bitmap::PixelFormat::IA88:
+			return PNG_COLOR_TYPE_GRAY_ALPHA;
+			break;
+		case Bitmap::PixelFormat::RGB888:
+			return PNG_COLOR_TYPE_RGB;
+			break;
+		case Bitmap::PixelFormat::RGBA8888:
+			return PNG_COLOR_TYPE_RGBA;
+			break;
+		default:
+			break;
+		}
+		return -1;
+	}
+
 	static void writePngFn(png_structp png_ptr, png_bytep data, png_size_t length) {
 		auto vec = (Bytes *)png_get_io_ptr(png_ptr);
 		size_t offset = vec->size();
@@ -473,24 +733,10 @@ struct PngStruct {
 			stride = Bitmap::getBytesPerPixel(format) * width;
 		}
 
-	    int color_type = 0;
-		switch (format) {
-		case Bitmap::PixelFormat::A8:
-		case Bitmap::PixelFormat::I8:
-			color_type = PNG_COLOR_TYPE_GRAY;
-			break;
-		case Bitmap::PixelFormat::IA88:
-			color_type = PNG_COLOR_TYPE_GRAY_ALPHA;
-			break;
-		case Bitmap::PixelFormat::RGB888:
-			color_type = PNG_COLOR_TYPE_RGB;
-			break;
-		case Bitmap::PixelFormat::RGBA8888:
-			color_type = PNG_COLOR_TYPE_RGBA;
-			break;
-		default:
-			return false;
-		}
+	    int color_type = getColorType(format);
+	    if (color_type < 0) {
+	    	return false;
+	    }
 
 		/* Set image attributes. */
 		png_set_IHDR (png_ptr, info_ptr, width, height, bit_depth,
@@ -531,6 +777,143 @@ static Bytes writePng(const uint8_t *data, uint32_t width, uint32_t height, uint
 	}
 }
 
+static bool readPngLines(const io::Producer &file, uint32_t, uint32_t,
+		const BitmapFormat::info_fn &infoCb, const BitmapFormat::line_fn &lineCb) {
+	auto png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (png_ptr == NULL) {
+    	log::text("libpng", "fail to create read struct");
+        return false;
+    }
+
+    auto info_ptr = png_create_info_struct(png_ptr);
+    if (info_ptr == NULL) {
+    	log::text("libpng", "fail to create info struct");
+        png_destroy_read_struct(&png_ptr, NULL, NULL);
+        return false;
+    }
+
+	Bytes data;
+
+	if (setjmp(png_jmpbuf(png_ptr))) {
+		log::text("libpng", "error in processing (setjmp return)");
+	    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+	    return false;
+	}
+
+#ifdef PNG_ARM_NEON_API_SUPPORTED
+#if PNG_ARM_NEON_OPT == 1
+	if (platform::proc::_isArmNeonSupported()) {
+		png_set_option(png_ptr, PNG_ARM_NEON, PNG_OPTION_ON);
+	}
+#endif
+#endif
+	png_set_read_fn(png_ptr, (png_voidp)&file, readProducerData);
+
+	BitmapFormat::LineInfo info;
+	size_t rowbytes = 0;
+	if (!readInfo(png_ptr, info_ptr, info.color, info.alpha, info.width, info.height, rowbytes)) {
+	    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+	    return false;
+	}
+
+	bool ret = infoCb(info);
+	if (ret) {
+		if (png_get_interlace_type(png_ptr, info_ptr) != PNG_INTERLACE_NONE) {
+			// interlaced image can not be read line by line, read it as a whole
+			data.resize(rowbytes * info.height);
+
+		    png_bytep* row_pointers = new png_bytep[info.height];
+		    for (uint32_t i = 0; i < info.height; ++i) {
+		        row_pointers[i] = data.data() + i * rowbytes;
+		    }
+
+		    png_read_image(png_ptr, row_pointers);
+		    delete [] row_pointers;
+
+		    for (uint32_t i = 0; i < info.height; ++ i) {
+		    	if (!lineCb(data.data() + i * rowbytes)) {
+		    		ret = false;
+		    		break;
+		    	}
+		    }
+		} else {
+			data.resize(rowbytes);
+			for (uint32_t i = 0; i < info.height; ++ i) {
+				png_read_row(png_ptr, data.data(), nullptr);
+				if (!lineCb(data.data())) {
+					ret = false;
+					break;
+				}
+			}
+		}
+	}
+
+    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+	return ret;
+}
+
+static void writeConsumerData(png_structp png_ptr, png_bytep data, png_size_t length) {
+	auto file = (const io::Consumer *)png_get_io_ptr(png_ptr);
+	file->write(data, length);
+}
+
+static void flushConsumerData(png_structp png_ptr) {
+	auto file = (const io::Consumer *)png_get_io_ptr(png_ptr);
+	file->flush();
+}
+
+static bool writePngLines(const io::Consumer &file, const BitmapFormat::LineInfo &info, const BitmapFormat::source_fn &source) {
+	PngStruct s;
+	if (!s.png_ptr || !s.info_ptr) {
+		return false;
+	}
+
+	png_set_write_fn(s.png_ptr, (png_voidp)&file, &writeConsumerData, &flushConsumerData);
+
+	uint32_t row = 0;
+	bool failed = false;
+
+	auto ret = source([&] (const uint8_t *line) -> bool {
+		// source callback is not a part of libpng call chain, so, error should return here
+		if (setjmp(png_jmpbuf(s.png_ptr))) {
+			log::text("libpng", "error in processing (setjmp return)");
+			failed = true;
+			return false;
+		}
+
+		if (row == 0) {
+			auto color_type = PngStruct::getColorType(info.color);
+			if (color_type < 0) {
+				failed = true;
+				return false;
+			}
+
+			png_set_IHDR(s.png_ptr, s.info_ptr, info.width, info.height, s.bit_depth,
+					color_type, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+			png_write_info(s.png_ptr, s.info_ptr);
+		} else if (row >= info.height) {
+			return false;
+		}
+
+		png_write_row(s.png_ptr, (png_bytep)line);
+		++ row;
+		return true;
+	});
+
+	if (!ret || failed || row == 0 || row != info.height) {
+		return false;
+	}
+
+	if (setjmp(png_jmpbuf(s.png_ptr))) {
+		log::text("libpng", "error in processing (setjmp return)");
+		return false;
+	}
+
+	png_write_end(s.png_ptr, s.info_ptr);
+	png_write_flush(s.png_ptr);
+	return true;
+}
+
 NS_SP_EXT_END(png)
 
 
@@ -1288,10 +1671,10 @@ static bool BitmapFormat_getTiffImageSize(const io::Producer &file, StackBuffer<
 
 static BitmapFormat s_defaultFormats[toInt(Bitmap::FileFormat::Custom)] = {
 	BitmapFormat(Bitmap::FileFormat::Png, &BitmapFormat_isPng, &BitmapFormat_getPngImageSize
-			, &png::loadPng, &png::writePng, &png::savePng
+			, &png::loadPng, &png::writePng, &png::savePng, &png::readPngLines, &png::writePngLines
 	),
 	BitmapFormat(Bitmap::FileFormat::Jpeg, &BitmapFormat_isJpg, &BitmapFormat_getJpegImageSize
-			, &jpeg::loadJpg, &jpeg::writeJpeg, &jpeg::saveJpeg
+			, &jpeg::loadJpg, &jpeg::writeJpeg, &jpeg::saveJpeg, &jpeg::readJpegLines, &jpeg::writeJpegLines
 	),
 	BitmapFormat(Bitmap::FileFormat::WebpLossless, &BitmapFormat_isWebpLossless, &BitmapFormat_getWebpLosslessImageSize
 			, &webp::loadWebp, &webp::writeWebpLossless, &webp::saveWebpLossless
@@ -1317,8 +1700,9 @@ void BitmapFormat::add(const BitmapFormat &fmt) {
 	s_formatListMutex.unlock();
 }
 
-BitmapFormat::BitmapFormat(FileFormat f, const check_fn &c, const size_fn &s, const load_fn &l, const write_fn &wr, const save_fn &sv)
-: check_ptr(c), size_ptr(s), load_ptr(l), write_ptr(wr), save_ptr(sv), format(f) {
+BitmapFormat::BitmapFormat(FileFormat f, const check_fn &c, const size_fn &s, const load_fn &l, const write_fn &wr, const save_fn &sv,
+		const read_lines_fn &rl, const write_lines_fn &wl)
+: check_ptr(c), size_ptr(s), load_ptr(l), write_ptr(wr), save_ptr(sv), read_lines_ptr(rl), write_lines_ptr(wl), format(f) {
 	assert(f != FileFormat::Custom);
 	if (check_ptr && size_ptr) {
 		flags |= Recognizable;
@@ -1342,8 +1726,10 @@ BitmapFormat::BitmapFormat(FileFormat f, const check_fn &c, const size_fn &s, co
 	}
 }
 
-BitmapFormat::BitmapFormat(const String &n, const check_fn &c, const size_fn &s, const load_fn &l, const write_fn &wr, const save_fn &sv)
-: check_ptr(c), size_ptr(s), load_ptr(l), write_ptr(wr), save_ptr(sv), format(FileFormat::Custom), name(n) {
+BitmapFormat::BitmapFormat(const String &n, const check_fn &c, const size_fn &s, const load_fn &l, const write_fn &wr, const save_fn &sv,
+		const read_lines_fn &rl, const write_lines_fn &wl)
+: check_ptr(c), size_ptr(s), load_ptr(l), write_ptr(wr), save_ptr(sv), read_lines_ptr(rl), write_lines_ptr(wl)
+, format(FileFormat::Custom), name(n) {
 	if (check_ptr && size_ptr) {
 		flags |= Recognizable;
 	}
@@ -1417,6 +1803,137 @@ BitmapFormat::size_fn BitmapFormat::getSizeFn() const { return size_ptr; }
 BitmapFormat::load_fn BitmapFormat::getLoadFn() const { return load_ptr; }
 BitmapFormat::write_fn BitmapFormat::getWriteFn() const { return write_ptr; }
 BitmapFormat::save_fn BitmapFormat::getSaveFn() const { return save_ptr; }
+BitmapFormat::read_lines_fn BitmapFormat::getReadLinesFn() const { return read_lines_ptr; }
+BitmapFormat::write_lines_fn BitmapFormat::getWriteLinesFn() const { return write_lines_ptr; }
+
+static bool BitmapFormat_readFile(const io::Producer &file, Bytes &data) {
+	auto size = file.seek(0, io::Seek::End);
+	if (size == 0 || size == maxOf<size_t>()) {
+		return false;
+	}
+
+	file.seek(0, io::Seek::Set);
+	data.resize(size);
+
+	size_t offset = 0;
+	while (offset < size) {
+		auto ret = file.read(data.data() + offset, size - offset);
+		if (ret == 0) {
+			return false;
+		}
+		offset += ret;
+	}
+	return true;
+}
+
+bool BitmapFormat::readLines(const io::Producer &file, uint32_t minWidth, uint32_t minHeight, const info_fn &infoCb, const line_fn &lineCb) {
+	StackBuffer<512> data;
+	if (file.seekAndRead(0, data, 512) < 32) {
+		return false;
+	}
+
+	auto readWith = [&] (const BitmapFormat &fmt) -> bool {
+		if (fmt.read_lines_ptr) {
+			file.seek(0, io::Seek::Set);
+			return fmt.read_lines_ptr(file, minWidth, minHeight, infoCb, lineCb);
+		}
+
+		// format can not be decoded line by line, so, we decode it in memory and then emit lines
+		LineInfo info;
+		uint32_t stride = 0;
+		Bytes bitmap;
+		{
+			Bytes encoded;
+			if (!BitmapFormat_readFile(file, encoded)
+					|| !fmt.load_ptr(encoded.data(), encoded.size(), bitmap, info.color, info.alpha, info.width, info.height, stride, nullptr)) {
+				return false;
+			}
+		}
+
+		if (!infoCb(info)) {
+			return false;
+		}
+
+		for (uint32_t i = 0; i < info.height; ++ i) {
+			if (!lineCb(bitmap.data() + size_t(i) * stride)) {
+				return false;
+			}
+		}
+		return true;
+	};
+
+	for (int i = 0; i < toInt(Bitmap::FileFormat::Custom); ++i) {
+		auto &fmt = s_defaultFormats[i];
+		if (fmt.isReadable() && fmt.is(data.data(), data.size())) {
+			return readWith(fmt);
+		}
+	}
+
+	Vector<BitmapFormat> fns;
+
+	s_formatListMutex.lock();
+
+	fns.reserve(s_formatList.size());
+	for (auto &it : s_formatList) {
+		if (it.isReadable()) {
+			fns.emplace_back(it);
+		}
+	}
+
+	s_formatListMutex.unlock();
+
+	for (auto &it : fns) {
+		if (it.is(data.data(), data.size())) {
+			return readWith(it);
+		}
+	}
+
+	return false;
+}
+
+bool BitmapFormat::writeLines(FileFormat fmt, const io::Consumer &file, const LineInfo &info, const source_fn &source) {
+	if (fmt == FileFormat::Custom) {
+		return false;
+	}
+
+	auto &support = s_defaultFormats[toInt(fmt)];
+	if (!support.isWritable() || !support.write_ptr) {
+		// fallback to png
+		return writeLines(FileFormat::Png, file, info, source);
+	}
+
+	if (support.write_lines_ptr) {
+		return support.write_lines_ptr(file, info, source);
+	}
+
+	// format can not be encoded line by line, so, we collect lines in memory and then encode them
+	Bytes bitmap;
+	uint32_t row = 0;
+	uint32_t stride = 0;
+
+	if (!source([&] (const uint8_t *line) -> bool {
+		if (row == 0) {
+			stride = info.width * Bitmap::getBytesPerPixel(info.color);
+			bitmap.resize(size_t(stride) * info.height);
+		} else if (row >= info.height) {
+			return false;
+		}
+		memcpy(bitmap.data() + size_t(row) * stride, line, stride);
+		++ row;
+		return true;
+	}) || row == 0 || row != info.height) {
+		return false;
+	}
+
+	auto data = support.write_ptr(bitmap.data(), info.width, info.height, stride, info.color, false);
+	if (data.empty()) {
+		return false;
+	}
+
+	file.write(data.data(), data.size());
+	file.flush();
+	return true;
+}
 
 
 bool Bitmap::getImageSize(const StringView &path, size_t &width, size_t &height) {
@@ -17,188 +17,93 @@
 #include "SPBitmap.h"
 #include "SPLog.h"
 
-NS_SP_BEGIN
-
-#define RESAMPLER_DEBUG_OPS 0
-#define RESAMPLER_DEFAULT_FILTER "lanczos4"
+#include "simde/x86/sse2.h"
 
-#define RESAMPLER_DEBUG 0
-//#define M_PI 3.14159265358979323846
-
-#define resampler_assert assert
+NS_SP_BEGIN
 
-class Resampler : public memory::AllocPool {
+// Separable resampler: contributor weights are precomputed once per axis, then image is processed
+// in tiles of destination rows: horizontal pass over required source rows, then vertical pass.
+// Tiles are independent, so they are distributed between worker threads for large images.
+class Resampler {
 public:
-	using Real = float; // float or double
+	using Real = float;
+	using Filter = Bitmap::ResampleFilter;
 
 	static constexpr uint32_t MaxDimensions = 16384;
 
-	struct Contrib {
-		Real weight;
-		unsigned short pixel;
-	};
+	// minimal number of destination rows, processed by a worker as a single unit
+	static constexpr uint32_t TileRows = 32;
 
-	struct Contrib_List {
-		unsigned short n;
-		Contrib* p;
-	};
+	// minimal number of multiply-adds to justify additional worker thread
+	static constexpr size_t WorkPerThread = 1 << 22;
 
-	enum Boundary_Op {
-		BOUNDARY_WRAP = 0,
-		BOUNDARY_REFLECT = 1,
-		BOUNDARY_CLAMP = 2
-	};
+	// Contributors for one axis: each destination sample takes exactly `taps` contiguous source samples,
+	// starting from `offsets[i]`; weights are stored as flat zero-padded (dst * taps) table.
+	// Contributors outside of the image are folded into edge samples (clamp boundary)
+	struct Axis {
+		uint32_t src = 0;
+		uint32_t dst = 0;
+		uint32_t taps = 0;
+		std::vector<uint32_t> offsets;
+		std::vector<Real> weights;
 
-	enum Status {
-		STATUS_OKAY = 0,
-		STATUS_OUT_OF_MEMORY = 1,
-		STATUS_BAD_FILTER_NAME = 2,
-		STATUS_SCAN_BUFFER_FULL = 3
+		bool init(Real (*filter)(Real), Real support);
 	};
 
-	// src_x/src_y - Input dimensions
-	// dst_x/dst_y - Output dimensions
-	// boundary_op - How to sample pixels near the image boundaries
-	// sample_low/sample_high - Clamp output samples to specified range, or disable clamping if sample_low >= sample_high
-	// Pclist_x/Pclist_y - Optional pointers to contributor lists from another instance of a Resampler
-	// src_x_ofs/src_y_ofs - Offset input image by specified amount (fractional values okay)
-	Resampler(int src_x, int src_y, int dst_x, int dst_y, Boundary_Op boundary_op = BOUNDARY_CLAMP,
-			Real sample_low = 0.0f, Real sample_high = 0.0f,
-			Bitmap::ResampleFilter Pfilter_name = Bitmap::ResampleFilter::Default,
-			Contrib_List* Pclist_x = NULL, Contrib_List* Pclist_y = NULL,
-			Real filter_x_scale = 1.0f, Real filter_y_scale = 1.0f,
-			Real src_x_ofs = 0.0f, Real src_y_ofs = 0.0f);
+	Resampler() = default;
+	Resampler(const Bitmap &source, Bitmap &target);
 
-	~Resampler();
+	Resampler(const Resampler &) = delete;
+	Resampler &operator=(const Resampler &) = delete;
 
-	// Reinits resampler so it can handle another frame.
-	void restart();
-
-	// false on out of memory.
-	bool put_line(const Real* Psrc);
-
-	// NULL if no scanlines are currently available (give the resampler more scanlines!)
-	const Real* get_line();
-
-	Status status() const {
-		return m_status;
-	}
-
-	// Returned contributor lists can be shared with another Resampler.
-	void get_clists(Contrib_List** ptr_clist_x, Contrib_List** ptr_clist_y);
-
-	Contrib_List* get_clist_x() const {
-		return m_Pclist_x;
-	}
-	Contrib_List* get_clist_y() const {
-		return m_Pclist_y;
-	}
+	bool init(Filter);
 
-	// Filter accessors.
-	static int get_filter_num();
+	// init for streaming mode, when there is no source or target bitmaps
+	bool init(Filter, uint32_t bpp, uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight);
 
-private:
-	Resampler();
-	Resampler(const Resampler& o);
-	Resampler& operator=(const Resampler& o);
+	// nthreads = 0 - select number of workers based on amount of work
+	void run(uint32_t nthreads = 0);
 
-#ifdef RESAMPLER_DEBUG_OPS
-	int total_ops;
-#endif
+	// streaming mode: source rows are pushed one by one, destination row is written into callback as soon as
+	// all of its contributors are available, so, only `taps` horizontally filtered rows are stored
+	bool push(const uint8_t *, const Callback<bool(const uint8_t *)> &);
 
-	int m_intermediate_x;
+	bool isComplete() const { return _nextSrc == _y.src && _nextDst == _y.dst; }
 
-	int m_resample_src_x;
-	int m_resample_src_y;
-	int m_resample_dst_x;
-	int m_resample_dst_y;
-
-	Boundary_Op m_boundary_op;
-
-	Real* m_Pdst_buf;
-	Real* m_Ptmp_buf;
-
-	Contrib_List* m_Pclist_x;
-	Contrib_List* m_Pclist_y;
-
-	bool m_clist_x_forced;
-	bool m_clist_y_forced;
-
-	bool m_delay_x_resample;
-
-	int* m_Psrc_y_count;
-	unsigned char* m_Psrc_y_flag;
-
-	// The maximum number of scanlines that can be buffered at one time.
-	enum {
-		MAX_SCAN_BUF_SIZE = MaxDimensions
-	};
-
-	struct Scan_Buf {
-		int scan_buf_y[MAX_SCAN_BUF_SIZE];
-		Real* scan_buf_l[MAX_SCAN_BUF_SIZE];
+protected:
+	struct Buffers {
+		std::vector<Real> line; // source row, converted to Real
+		std::vector<Real> rows; // horizontally filtered source rows, required for a tile
+		std::vector<Real> out; // destination row
 	};
 
-	Scan_Buf* m_Pscan_buf;
+	void processTile(uint32_t tile, Buffers &) const;
 
-	int m_cur_src_y;
-	int m_cur_dst_y;
+	void readLine(Real *, const uint8_t *) const;
+	void writeLine(uint8_t *, const Real *) const;
 
-	Status m_status;
+	template <uint32_t Channels>
+	void filterPixels(Real *, const Real *) const;
 
-	memory::pool_t *m_pool;
+	void filterLine(Real *, const Real *) const;
+	void filterColumn(Real *, const Real *rows, const Real *weights) const;
 
-	void resample_x(Real* Pdst, const Real* Psrc);
-	void scale_y_mov(Real* Ptmp, const Real* Psrc, Real weight, int dst_x);
-	void scale_y_add(Real* Ptmp, const Real* Psrc, Real weight, int dst_x);
-	void clamp(Real* Pdst, int n);
-	void resample_y(Real* Pdst);
+	const Bitmap *_source = nullptr;
+	Bitmap *_target = nullptr;
+	uint32_t _bpp = 0;
+	uint32_t _rowSize = 0; // Real values in horizontally filtered row
+	uint32_t _tileRows = TileRows;
 
-	int reflect(const int j, const int src_x, const Boundary_Op boundary_op);
+	Axis _x;
+	Axis _y;
 
-	Contrib_List* make_clist(int src_x, int dst_x, Boundary_Op boundary_op, Real (*Pfilter)(Real),
-			Real filter_support, Real filter_scale, Real src_ofs);
-
-	inline int count_ops(Contrib_List* Pclist, int k) {
-		int i, t = 0;
-		for (i = 0; i < k; i++)
-			t += Pclist[i].n;
-		return (t);
-	}
-
-	Real m_lo;
-	Real m_hi;
-
-	inline Real clamp_sample(Real f) const {
-		if (f < m_lo)
-			f = m_lo;
-		else if (f > m_hi)
-			f = m_hi;
-		return f;
-	}
+	// streaming state; `rows` is a ring of `taps` rows, stored twice, so any `taps` sequential rows are contiguous
+	Buffers _stream;
+	Bytes _streamLine;
+	uint32_t _nextSrc = 0;
+	uint32_t _nextDst = 0;
 };
 
-
-static inline int resampler_range_check(int v, int h) { (void)h; resampler_assert((v >= 0) && (v < h)); return v; }
-
-// Float to int cast with truncation.
-static inline int cast_to_int(Resampler::Real i) { return int(i); }
-
-// (x mod y) with special handling for negative x values.
-static inline int posmod(int x, int y) {
-	if (x >= 0) {
-		return (x % y);
-	} else {
-		int m = (-x) % y;
-
-		if (m != 0) {
-			m = y - m;
-		}
-
-		return (m);
-	}
-}
-
 // To add your own filter, insert the new function below and update the filter table.
 // There is no need to make the filter function particularly fast, because it's
 // only called during initializing to create the X and Y axis contributor tables.
@@ -480,824 +385,361 @@ static struct {
 
 static const int NUM_FILTERS = sizeof(g_filters) / sizeof(g_filters[0]);
 
-/* Ensure that the contributing source sample is
- * within bounds. If not, reflect, clamp, or wrap.
- */
-int Resampler::reflect(const int j, const int src_x, const Boundary_Op boundary_op) {
-	int n;
-
-	if (j < 0) {
-		if (boundary_op == BOUNDARY_REFLECT) {
-			n = -j;
-
-			if (n >= src_x)
-				n = src_x - 1;
-		} else if (boundary_op == BOUNDARY_WRAP)
-			n = posmod(j, src_x);
-		else
-			n = 0;
-	} else if (j >= src_x) {
-		if (boundary_op == BOUNDARY_REFLECT) {
-			n = (src_x - j) + (src_x - 1);
-
-			if (n < 0)
-				n = 0;
-		} else if (boundary_op == BOUNDARY_WRAP)
-			n = posmod(j, src_x);
-		else
-			n = src_x - 1;
-	} else
-		n = j;
-
-	return n;
-}
-
-// The make_clist() method generates, for all destination samples,
-// the list of all source samples with non-zero weighted contributions.
-Resampler::Contrib_List* Resampler::make_clist(int src_x, int dst_x, Boundary_Op boundary_op, Real (*Pfilter)(Real),
-		Real filter_support, Real filter_scale, Real src_ofs) {
-	typedef struct {
-		// The center of the range in DISCRETE coordinates (pixel center = 0.0f).
-		Real center;
-		int left, right;
-	} Contrib_Bounds;
-
-	int i, j, k, n, left, right;
-	Real total_weight;
-	Real xscale, center, half_width, weight;
-	Contrib_List* Pcontrib;
-	Contrib* Pcpool;
-	Contrib* Pcpool_next;
-	Contrib_Bounds* Pcontrib_bounds;
-
-	if ((Pcontrib = (Contrib_List*)memory::pool::calloc(m_pool, dst_x, sizeof(Contrib_List))) == NULL)
-		return NULL;
-
-	Pcontrib_bounds = (Contrib_Bounds*)memory::pool::calloc(m_pool, dst_x, sizeof(Contrib_Bounds));
-	if (!Pcontrib_bounds) {
-		return (NULL);
-	}
-
-	const Real oo_filter_scale = 1.0f / filter_scale;
 
+bool Resampler::Axis::init(Real (*filter)(Real), Real support) {
 	const Real NUDGE = 0.5f;
-	xscale = dst_x / (Real)src_x;
-
-	if (xscale < 1.0f) {
-		int total;
-		(void)total;
+	const Real scale = dst / (Real)src;
 
-		/* Handle case when there are fewer destination
-		 * samples than source samples (downsampling/minification).
-		 */
+	// on minification filter is stretched to cover all source samples
+	const Real filterScale = std::min(scale, 1.0f);
+	const Real halfWidth = support / filterScale;
 
-		// stretched half width of filter
-		half_width = (filter_support / xscale) * filter_scale;
-
-		// Find the range of source sample(s) that will contribute to each destination sample.
+	auto getCenter = [&] (uint32_t i) {
+		// Convert from discrete to continuous coordinates, scale, then convert back to discrete.
+		return ((Real)i + NUDGE) / scale - NUDGE;
+	};
 
-		for (i = 0, n = 0; i < dst_x; i++) {
-			// Convert from discrete to continuous coordinates, scale, then convert back to discrete.
-			center = ((Real)i + NUDGE) / xscale;
-			center -= NUDGE;
-			center += src_ofs;
+	taps = 0;
+	for (uint32_t i = 0; i < dst; ++ i) {
+		const Real center = getCenter(i);
+		const int left = std::max(int(floor(center - halfWidth)), 0);
+		const int right = std::min(int(ceil(center + halfWidth)), int(src) - 1);
+		taps = std::max(taps, uint32_t(std::max(right - left + 1, 1)));
+	}
 
-			left = cast_to_int((Real)floor(center - half_width));
-			right = cast_to_int((Real)ceil(center + half_width));
+	offsets.resize(dst);
+	weights.assign(size_t(dst) * taps, 0.0f);
 
-			Pcontrib_bounds[i].center = center;
-			Pcontrib_bounds[i].left = left;
-			Pcontrib_bounds[i].right = right;
+	for (uint32_t i = 0; i < dst; ++ i) {
+		const Real center = getCenter(i);
+		const int left = int(floor(center - halfWidth));
+		const int right = int(ceil(center + halfWidth));
 
-			n += (right - left + 1);
+		Real total = 0.0f;
+		for (int j = left; j <= right; ++ j) {
+			total += filter((center - (Real)j) * filterScale);
 		}
 
-		/* Allocate memory for contributors. */
-
-		if ((n == 0) || ((Pcpool = (Contrib*)memory::pool::calloc(m_pool, n, sizeof(Contrib))) == NULL)) {
-			return NULL;
+		if (total == 0.0f) {
+			return false;
 		}
-		total = n;
-
-		Pcpool_next = Pcpool;
-
-		/* Create the list of source samples which
-		 * contribute to each destination sample.
-		 */
-
-		for (i = 0; i < dst_x; i++) {
-			int max_k = -1;
-			Real max_w = -1e+20f;
-
-			center = Pcontrib_bounds[i].center;
-			left = Pcontrib_bounds[i].left;
-			right = Pcontrib_bounds[i].right;
 
-			Pcontrib[i].n = 0;
-			Pcontrib[i].p = Pcpool_next;
-			Pcpool_next += (right - left + 1);
-			resampler_assert ((Pcpool_next - Pcpool) <= total);
+		const Real norm = 1.0f / total;
+		const uint32_t offset = std::min(uint32_t(std::max(left, 0)), src - taps);
+		Real *w = weights.data() + size_t(i) * taps;
 
-			total_weight = 0;
-
-			for (j = left; j <= right; j++)
-				total_weight += (*Pfilter)((center - (Real)j) * xscale * oo_filter_scale);
-			const Real norm = static_cast<Real>(1.0f / total_weight);
-
-			total_weight = 0;
-
-#if RESAMPLER_DEBUG
-			printf("%i: ", i);
-#endif
-
-			for (j = left; j <= right; j++) {
-				weight = (*Pfilter)((center - (Real)j) * xscale * oo_filter_scale) * norm;
-				if (weight == 0.0f)
-					continue;
-
-				n = reflect(j, src_x, boundary_op);
-
-#if RESAMPLER_DEBUG
-				printf("%i(%f), ", n, weight);
-#endif
-
-				/* Increment the number of source
-				 * samples which contribute to the
-				 * current destination sample.
-				 */
-
-				k = Pcontrib[i].n++;
-
-				Pcontrib[i].p[k].pixel = (unsigned short)(n); /* store src sample number */
-				Pcontrib[i].p[k].weight = weight; /* store src sample weight */
-
-				total_weight += weight; /* total weight of all contributors */
-
-				if (weight > max_w) {
-					max_w = weight;
-					max_k = k;
-				}
-			}
-
-#if RESAMPLER_DEBUG
-			printf("\n\n");
-#endif
-
-			//resampler_assert(Pcontrib[i].n);
-			//resampler_assert(max_k != -1);
-			if ((max_k == -1) || (Pcontrib[i].n == 0)) {
-				return NULL;
+		total = 0.0f;
+		for (int j = left; j <= right; ++ j) {
+			const Real weight = filter((center - (Real)j) * filterScale) * norm;
+			if (weight != 0.0f) {
+				w[std::min(std::max(j, 0), int(src) - 1) - offset] += weight;
+				total += weight;
 			}
-
-			if (total_weight != 1.0f)
-				Pcontrib[i].p[max_k].weight += 1.0f - total_weight;
 		}
-	} else {
-		/* Handle case when there are more
-		 * destination samples than source
-		 * samples (upsampling).
-		 */
 
-		half_width = filter_support * filter_scale;
-
-		// Find the source sample(s) that contribute to each destination sample.
-
-		for (i = 0, n = 0; i < dst_x; i++) {
-			// Convert from discrete to continuous coordinates, scale, then convert back to discrete.
-			center = ((Real)i + NUDGE) / xscale;
-			center -= NUDGE;
-			center += src_ofs;
-
-			left = cast_to_int((Real)floor(center - half_width));
-			right = cast_to_int((Real)ceil(center + half_width));
-
-			Pcontrib_bounds[i].center = center;
-			Pcontrib_bounds[i].left = left;
-			Pcontrib_bounds[i].right = right;
-
-			n += (right - left + 1);
+		if (total == 0.0f) {
+			return false;
 		}
 
-		/* Allocate memory for contributors. */
-
-		int total = n;
-		if ((total == 0) || ((Pcpool = (Contrib*)memory::pool::calloc(m_pool, total, sizeof(Contrib))) == NULL)) {
-			return NULL;
+		if (total != 1.0f) {
+			auto maxWeight = std::max_element(w, w + taps);
+			*maxWeight += 1.0f - total;
 		}
 
-		Pcpool_next = Pcpool;
-
-		/* Create the list of source samples which
-		 * contribute to each destination sample.
-		 */
-
-		for (i = 0; i < dst_x; i++) {
-			int max_k = -1;
-			Real max_w = -1e+20f;
-
-			center = Pcontrib_bounds[i].center;
-			left = Pcontrib_bounds[i].left;
-			right = Pcontrib_bounds[i].right;
-
-			Pcontrib[i].n = 0;
-			Pcontrib[i].p = Pcpool_next;
-			Pcpool_next += (right - left + 1);
-			resampler_assert((Pcpool_next - Pcpool) <= total);
-
-			total_weight = 0;
-			for (j = left; j <= right; j++)
-				total_weight += (*Pfilter)((center - (Real)j) * oo_filter_scale);
-
-			const Real norm = static_cast<Real>(1.0f / total_weight);
-
-			total_weight = 0;
-
-#if RESAMPLER_DEBUG
-			printf("%i: ", i);
-#endif
-
-			for (j = left; j <= right; j++) {
-				weight = (*Pfilter)((center - (Real)j) * oo_filter_scale) * norm;
-				if (weight == 0.0f)
-					continue;
-
-				n = reflect(j, src_x, boundary_op);
-
-#if RESAMPLER_DEBUG
-				printf("%i(%f), ", n, weight);
-#endif
-
-				/* Increment the number of source
-				 * samples which contribute to the
-				 * current destination sample.
-				 */
-
-				k = Pcontrib[i].n++;
-
-				Pcontrib[i].p[k].pixel = (unsigned short)(n); /* store src sample number */
-				Pcontrib[i].p[k].weight = weight; /* store src sample weight */
-
-				total_weight += weight; /* total weight of all contributors */
-
-				if (weight > max_w) {
-					max_w = weight;
-					max_k = k;
-				}
-			}
-
-#if RESAMPLER_DEBUG
-			printf("\n\n");
-#endif
+		offsets[i] = offset;
+	}
 
-			//resampler_assert(Pcontrib[i].n);
-			//resampler_assert(max_k != -1);
+	return true;
+}
 
-			if ((max_k == -1) || (Pcontrib[i].n == 0)) {
-				return NULL;
+Resampler::Resampler(const Bitmap &source, Bitmap &target)
+: _source(&source), _target(&target), _bpp(Bitmap::getBytesPerPixel(source.format())) {
+	_rowSize = target.width() * _bpp;
+	_x.src = source.width();
+	_x.dst = target.width();
+	_y.src = source.height();
+	_y.dst = target.height();
+}
+
+bool Resampler::init(Filter f, uint32_t bpp, uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight) {
+	_bpp = bpp;
+	_rowSize = dstWidth * _bpp;
+	_x.src = srcWidth;
+	_x.dst = dstWidth;
+	_y.src = srcHeight;
+	_y.dst = dstHeight;
+	_nextSrc = 0;
+	_nextDst = 0;
+	_stream.rows.clear();
+	return init(f);
+}
+
+bool Resampler::init(Filter f) {
+	for (int i = 0; i < NUM_FILTERS; ++ i) {
+		if (g_filters[i].name == f) {
+			if (!_x.init(g_filters[i].func, g_filters[i].support) || !_y.init(g_filters[i].func, g_filters[i].support)) {
+				return false;
 			}
 
-			if (total_weight != 1.0f)
-				Pcontrib[i].p[max_k].weight += 1.0f - total_weight;
+			// neighbour tiles share `taps` source rows, that should be filtered horizontally by both of them,
+			// so tile should be large enough to keep this overhead low
+			_tileRows = std::max(TileRows, uint32_t(4 * size_t(_y.taps) * _y.dst / _y.src));
+			return true;
 		}
 	}
-
-#if RESAMPLER_DEBUG
-	printf("*******\n");
-#endif
-
-	return Pcontrib;
+	return false;
 }
 
-void Resampler::resample_x(Real* Pdst, const Real* Psrc) {
-	resampler_assert(Pdst);
-	resampler_assert(Psrc);
-
-	int i, j;
-	Real total;
-	Contrib_List *Pclist = m_Pclist_x;
-	Contrib *p;
-
-	for (i = m_resample_dst_x; i > 0; i--, Pclist++) {
-#if RESAMPLER_DEBUG_OPS
-		total_ops += Pclist->n;
-#endif
-
-		for (j = Pclist->n, p = Pclist->p, total = 0; j > 0; j--, p++)
-			total += Psrc[p->pixel] * p->weight;
-
-		*Pdst++ = total;
+void Resampler::run(uint32_t nthreads) {
+	if (nthreads == 0) {
+		const size_t work = (size_t(_y.src) * _x.dst * _x.taps + size_t(_y.dst) * _x.dst * _y.taps) * _bpp;
+		nthreads = uint32_t(std::min(work / WorkPerThread + 1, size_t(std::max(std::thread::hardware_concurrency(), 1U))));
 	}
-}
-
-void Resampler::scale_y_mov(Real* Ptmp, const Real* Psrc, Real weight, int dst_x) {
-	int i;
 
-#if RESAMPLER_DEBUG_OPS
-	total_ops += dst_x;
-#endif
-
-	// Not += because temp buf wasn't cleared.
-	for (i = dst_x; i > 0; i--)
-		*Ptmp++ = *Psrc++ * weight;
-}
-
-void Resampler::scale_y_add(Real* Ptmp, const Real* Psrc, Real weight, int dst_x) {
-#if RESAMPLER_DEBUG_OPS
-	total_ops += dst_x;
-#endif
-
-	for (int i = dst_x; i > 0; i--)
-		(*Ptmp++) += *Psrc++ * weight;
-}
-
-void Resampler::clamp(Real* Pdst, int n) {
-	while (n > 0) {
-		*Pdst = clamp_sample(*Pdst);
-		++Pdst;
-		n--;
+	nthreads = std::min(nthreads, _y.dst);
+	if ((_y.dst + _tileRows - 1) / _tileRows < nthreads) {
+		_tileRows = (_y.dst + nthreads - 1) / nthreads;
 	}
-}
-
-void Resampler::resample_y(Real* Pdst) {
-	int i, j;
-	Real* Psrc;
-	Contrib_List* Pclist = &m_Pclist_y[m_cur_dst_y];
-
-	Real* Ptmp = m_delay_x_resample ? m_Ptmp_buf : Pdst;
-	resampler_assert(Ptmp);
 
-	/* Process each contributor. */
+	const uint32_t ntiles = (_y.dst + _tileRows - 1) / _tileRows;
 
-	for (i = 0; i < Pclist->n; i++) {
-		/* locate the contributor's location in the scan
-		 * buffer -- the contributor must always be found!
-		 */
-
-		for (j = 0; j < MAX_SCAN_BUF_SIZE; j++)
-			if (m_Pscan_buf->scan_buf_y[j] == Pclist->p[i].pixel)
-				break;
-
-		resampler_assert(j < MAX_SCAN_BUF_SIZE);
-
-		Psrc = m_Pscan_buf->scan_buf_l[j];
-
-		if (!i)
-			scale_y_mov(Ptmp, Psrc, Pclist->p[i].weight, m_intermediate_x);
-		else
-			scale_y_add(Ptmp, Psrc, Pclist->p[i].weight, m_intermediate_x);
-
-		/* If this source line doesn't contribute to any
-		 * more destination lines then mark the scanline buffer slot
-		 * which holds this source line as free.
-		 * (The max. number of slots used depends on the Y
-		 * axis sampling factor and the scaled filter width.)
-		 */
-
-		if (--m_Psrc_y_count[resampler_range_check(Pclist->p[i].pixel, m_resample_src_y)] == 0) {
-			m_Psrc_y_flag[resampler_range_check(Pclist->p[i].pixel, m_resample_src_y)] = false;
-			m_Pscan_buf->scan_buf_y[j] = -1;
+	std::atomic<uint32_t> next(0);
+	auto worker = [&] {
+		Buffers buffers;
+		uint32_t tile = 0;
+		while ((tile = next.fetch_add(1)) < ntiles) {
+			processTile(tile, buffers);
 		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(nthreads);
+	for (uint32_t i = 1; i < nthreads; ++ i) {
+		threads.emplace_back(worker);
 	}
 
-	/* Now generate the destination line */
+	worker();
 
-	if (m_delay_x_resample) // Was X resampling delayed until after Y resampling?
-	{
-		resampler_assert(Pdst != Ptmp);
-		resample_x(Pdst, Ptmp);
-	} else {
-		resampler_assert(Pdst == Ptmp);
+	for (auto &it : threads) {
+		it.join();
 	}
-
-	if (m_lo < m_hi)
-		clamp(Pdst, m_resample_dst_x);
 }
 
-bool Resampler::put_line(const Real* Psrc) {
-	int i;
-
-	if (m_cur_src_y >= m_resample_src_y)
+bool Resampler::push(const uint8_t *data, const Callback<bool(const uint8_t *)> &cb) {
+	if (_nextSrc >= _y.src) {
 		return false;
+	}
 
-	/* Does this source line contribute
-	 * to any destination line? if not,
-	 * exit now.
-	 */
-
-	if (!m_Psrc_y_count[resampler_range_check(m_cur_src_y, m_resample_src_y)]) {
-		m_cur_src_y++;
+	if (_nextDst >= _y.dst) {
+		// rest of source rows are not required
+		++ _nextSrc;
 		return true;
 	}
 
-	/* Find an empty slot in the scanline buffer. (FIXME: Perf. is terrible here with extreme scaling ratios.) */
-
-	for (i = 0; i < MAX_SCAN_BUF_SIZE; i++)
-		if (m_Pscan_buf->scan_buf_y[i] == -1)
-			break;
-
-	/* If the buffer is full, exit with an error. */
-
-	if (i == MAX_SCAN_BUF_SIZE) {
-		m_status = STATUS_SCAN_BUFFER_FULL;
-		return false;
+	const uint32_t taps = _y.taps;
+	if (_stream.rows.empty()) {
+		_stream.line.resize(size_t(_x.src) * _bpp);
+		_stream.rows.resize(size_t(taps) * 2 * _rowSize);
+		_stream.out.resize(_rowSize);
+		_streamLine.resize(_rowSize);
 	}
 
-	m_Psrc_y_flag[resampler_range_check(m_cur_src_y, m_resample_src_y)] = 1;
-	m_Pscan_buf->scan_buf_y[i] = m_cur_src_y;
+	Real *row = _stream.rows.data() + size_t(_nextSrc % taps) * _rowSize;
+	readLine(_stream.line.data(), data);
+	filterLine(row, _stream.line.data());
+	memcpy(row + size_t(taps) * _rowSize, row, _rowSize * sizeof(Real));
+	++ _nextSrc;
 
-	/* Does this slot have any memory allocated to it? */
+	// offsets are monotonic, and the last required row was just pushed, so all of the contributors are in the ring
+	while (_nextDst < _y.dst && _y.offsets[_nextDst] + taps <= _nextSrc) {
+		filterColumn(_stream.out.data(), _stream.rows.data() + size_t(_y.offsets[_nextDst] % taps) * _rowSize,
+				_y.weights.data() + size_t(_nextDst) * taps);
+		writeLine(_streamLine.data(), _stream.out.data());
+		++ _nextDst;
 
-	if (!m_Pscan_buf->scan_buf_l[i]) {
-		if ((m_Pscan_buf->scan_buf_l[i] = (Real*)memory::pool::palloc(m_pool, m_intermediate_x * sizeof(Real))) == NULL) {
-			m_status = STATUS_OUT_OF_MEMORY;
+		if (!cb(_streamLine.data())) {
 			return false;
 		}
 	}
 
-	// Resampling on the X axis first?
-	if (m_delay_x_resample) {
-		resampler_assert(m_intermediate_x == m_resample_src_x);
-
-		// Y-X resampling order
-		memcpy(m_Pscan_buf->scan_buf_l[i], Psrc, m_intermediate_x * sizeof(Real));
-	} else {
-		resampler_assert(m_intermediate_x == m_resample_dst_x);
-
-		// X-Y resampling order
-		resample_x(m_Pscan_buf->scan_buf_l[i], Psrc);
-	}
-
-	m_cur_src_y++;
-
 	return true;
 }
 
-const Resampler::Real* Resampler::get_line() {
-	int i;
-
-	/* If all the destination lines have been
-	 * generated, then always return NULL.
-	 */
+void Resampler::processTile(uint32_t tile, Buffers &buf) const {
+	const uint32_t dstFirst = tile * _tileRows;
+	const uint32_t dstLast = std::min(dstFirst + _tileRows, _y.dst);
 
-	if (m_cur_dst_y == m_resample_dst_y)
-		return NULL;
+	// offsets are monotonic, so tile requires continuous range of source rows
+	const uint32_t srcFirst = _y.offsets[dstFirst];
+	const uint32_t srcLast = _y.offsets[dstLast - 1] + _y.taps;
 
-	/* Check to see if all the required
-	 * contributors are present, if not,
-	 * return NULL.
-	 */
+	buf.line.resize(size_t(_x.src) * _bpp);
+	buf.rows.resize(size_t(srcLast - srcFirst) * _rowSize);
+	buf.out.resize(_rowSize);
 
-	for (i = 0; i < m_Pclist_y[m_cur_dst_y].n; i++)
-		if (!m_Psrc_y_flag[resampler_range_check(m_Pclist_y[m_cur_dst_y].p[i].pixel, m_resample_src_y)])
-			return NULL;
+	const uint8_t *srcData = _source->dataPtr();
+	const uint32_t srcStride = _source->stride();
 
-	resample_y(m_Pdst_buf);
-
-	m_cur_dst_y++;
-
-	return m_Pdst_buf;
-}
-
-Resampler::~Resampler() {
-#if RESAMPLER_DEBUG_OPS
-	printf("actual ops: %i\n", total_ops);
-#endif
-
-	m_Pdst_buf = NULL;
-
-	if (m_Ptmp_buf) {
-		m_Ptmp_buf = NULL;
+	for (uint32_t y = srcFirst; y < srcLast; ++ y) {
+		readLine(buf.line.data(), srcData + size_t(y) * srcStride);
+		filterLine(buf.rows.data() + size_t(y - srcFirst) * _rowSize, buf.line.data());
 	}
 
-	/* Don't deallocate a contibutor list
-	 * if the user passed us one of their own.
-	 */
+	uint8_t *dstData = _target->dataPtr();
+	const uint32_t dstStride = _target->stride();
 
-	if ((m_Pclist_x) && (!m_clist_x_forced)) {
-		m_Pclist_x = NULL;
-	}
-
-	if ((m_Pclist_y) && (!m_clist_y_forced)) {
-		m_Pclist_y = NULL;
-	}
-
-	m_Psrc_y_count = NULL;
-	m_Psrc_y_flag = NULL;
-
-	if (m_Pscan_buf) {
-		m_Pscan_buf = NULL;
+	for (uint32_t y = dstFirst; y < dstLast; ++ y) {
+		filterColumn(buf.out.data(), buf.rows.data() + size_t(_y.offsets[y] - srcFirst) * _rowSize,
+				_y.weights.data() + size_t(y) * _y.taps);
+		writeLine(dstData + size_t(y) * dstStride, buf.out.data());
 	}
 }
 
-void Resampler::restart() {
-	if (STATUS_OKAY != m_status)
-		return;
+void Resampler::readLine(Real *dst, const uint8_t *src) const {
+	const size_t count = size_t(_x.src) * _bpp;
+	const auto zero = simde_mm_setzero_si128();
 
-	m_cur_src_y = m_cur_dst_y = 0;
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		int32_t tmp;
+		memcpy(&tmp, src + i, sizeof(int32_t));
 
-	int i, j;
-	for (i = 0; i < m_resample_src_y; i++) {
-		m_Psrc_y_count[i] = 0;
-		m_Psrc_y_flag[i] = 0;
+		auto v = simde_mm_unpacklo_epi8(simde_mm_cvtsi32_si128(tmp), zero);
+		simde_mm_storeu_ps(dst + i, simde_mm_cvtepi32_ps(simde_mm_unpacklo_epi16(v, zero)));
 	}
 
-	for (i = 0; i < m_resample_dst_y; i++) {
-		for (j = 0; j < m_Pclist_y[i].n; j++)
-			m_Psrc_y_count[resampler_range_check(m_Pclist_y[i].p[j].pixel, m_resample_src_y)]++;
-	}
-
-	for (i = 0; i < MAX_SCAN_BUF_SIZE; i++) {
-		m_Pscan_buf->scan_buf_y[i] = -1;
-		m_Pscan_buf->scan_buf_l[i] = NULL;
+	for (; i < count; ++ i) {
+		dst[i] = Real(src[i]);
 	}
 }
 
-Resampler::Resampler(int src_x, int src_y, int dst_x, int dst_y, Boundary_Op boundary_op, Real sample_low,
-		Real sample_high, Bitmap::ResampleFilter Pfilter_name, Contrib_List* Pclist_x, Contrib_List* Pclist_y, Real filter_x_scale,
-		Real filter_y_scale, Real src_x_ofs, Real src_y_ofs) {
-	int i, j;
-	Real support, (*func)(Real);
-
-	resampler_assert(src_x > 0);
-	resampler_assert(src_y > 0);
-	resampler_assert(dst_x > 0);
-	resampler_assert(dst_y > 0);
-
-#if RESAMPLER_DEBUG_OPS
-	total_ops = 0;
-#endif
-
-	m_pool = memory::pool::acquire();
-
-	m_lo = sample_low;
-	m_hi = sample_high;
-
-	m_delay_x_resample = false;
-	m_intermediate_x = 0;
-	m_Pdst_buf = NULL;
-	m_Ptmp_buf = NULL;
-	m_clist_x_forced = false;
-	m_Pclist_x = NULL;
-	m_clist_y_forced = false;
-	m_Pclist_y = NULL;
-	m_Psrc_y_count = NULL;
-	m_Psrc_y_flag = NULL;
-	m_Pscan_buf = NULL;
-	m_status = STATUS_OKAY;
-
-	m_resample_src_x = src_x;
-	m_resample_src_y = src_y;
-	m_resample_dst_x = dst_x;
-	m_resample_dst_y = dst_y;
-
-	m_boundary_op = boundary_op;
-
-	if ((m_Pdst_buf = (Real*)memory::pool::palloc(m_pool, m_resample_dst_x * sizeof(Real))) == NULL) {
-		m_status = STATUS_OUT_OF_MEMORY;
-		return;
-	}
-
-	// Find the specified filter.
-
-	for (i = 0; i < NUM_FILTERS; i++)
-		if (Pfilter_name == g_filters[i].name)
-			break;
-
-	if (i == NUM_FILTERS) {
-		m_status = STATUS_BAD_FILTER_NAME;
-		return;
-	}
-
-	func = g_filters[i].func;
-	support = g_filters[i].support;
-
-	/* Create contributor lists, unless the user supplied custom lists. */
-
-	if (!Pclist_x) {
-		m_Pclist_x = make_clist(m_resample_src_x, m_resample_dst_x, m_boundary_op, func, support, filter_x_scale,
-				src_x_ofs);
-		if (!m_Pclist_x) {
-			m_status = STATUS_OUT_OF_MEMORY;
-			return;
-		}
-	} else {
-		m_Pclist_x = Pclist_x;
-		m_clist_x_forced = true;
-	}
+void Resampler::writeLine(uint8_t *dst, const Real *src) const {
+	const size_t count = _rowSize;
+	const auto half = simde_mm_set1_ps(0.5f);
+	const auto low = simde_mm_setzero_ps();
+	const auto high = simde_mm_set1_ps(255.0f);
 
-	if (!Pclist_y) {
-		m_Pclist_y = make_clist(m_resample_src_y, m_resample_dst_y, m_boundary_op, func, support, filter_y_scale,
-				src_y_ofs);
-		if (!m_Pclist_y) {
-			m_status = STATUS_OUT_OF_MEMORY;
-			return;
-		}
-	} else {
-		m_Pclist_y = Pclist_y;
-		m_clist_y_forced = true;
-	}
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		auto v = simde_mm_min_ps(simde_mm_max_ps(simde_mm_add_ps(simde_mm_loadu_ps(src + i), half), low), high);
+		auto iv = simde_mm_cvttps_epi32(v);
+		iv = simde_mm_packs_epi32(iv, iv);
+		iv = simde_mm_packus_epi16(iv, iv);
 
-	if ((m_Psrc_y_count = (int*)memory::pool::calloc(m_pool, m_resample_src_y, sizeof(int))) == NULL) {
-		m_status = STATUS_OUT_OF_MEMORY;
-		return;
+		int32_t tmp = simde_mm_cvtsi128_si32(iv);
+		memcpy(dst + i, &tmp, sizeof(int32_t));
 	}
 
-	if ((m_Psrc_y_flag = (unsigned char*)memory::pool::calloc(m_pool, m_resample_src_y, sizeof(unsigned char))) == NULL) {
-		m_status = STATUS_OUT_OF_MEMORY;
-		return;
+	for (; i < count; ++ i) {
+		dst[i] = uint8_t(std::min(std::max(src[i] + 0.5f, 0.0f), 255.0f));
 	}
+}
 
-	/* Count how many times each source line
-	 * contributes to a destination line.
-	 */
+template <uint32_t Channels>
+void Resampler::filterPixels(Real *dst, const Real *src) const {
+	const uint32_t taps = _x.taps;
+	const Real *w = _x.weights.data();
 
-	for (i = 0; i < m_resample_dst_y; i++) {
-		for (j = 0; j < m_Pclist_y[i].n; j++) {
-			auto tmp = resampler_range_check(m_Pclist_y[i].p[j].pixel, m_resample_src_y);
-			m_Psrc_y_count[tmp]++;
+	for (uint32_t i = 0; i < _x.dst; ++ i, w += taps) {
+		const Real *s = src + size_t(_x.offsets[i]) * Channels;
+		Real acc[Channels] = { 0.0f };
+		for (uint32_t k = 0; k < taps; ++ k, s += Channels) {
+			for (uint32_t c = 0; c < Channels; ++ c) {
+				acc[c] += w[k] * s[c];
+			}
 		}
-	}
-
-	if ((m_Pscan_buf = (Scan_Buf*)memory::pool::palloc(m_pool, sizeof(Scan_Buf))) == NULL) {
-		m_status = STATUS_OUT_OF_MEMORY;
-		return;
-	}
-
-	for (i = 0; i < MAX_SCAN_BUF_SIZE; i++) {
-		m_Pscan_buf->scan_buf_y[i] = -1;
-		m_Pscan_buf->scan_buf_l[i] = NULL;
-	}
-
-	m_cur_src_y = m_cur_dst_y = 0;
-	{
-		// Determine which axis to resample first by comparing the number of multiplies required
-		// for each possibility.
-		int x_ops = count_ops(m_Pclist_x, m_resample_dst_x);
-		int y_ops = count_ops(m_Pclist_y, m_resample_dst_y);
-
-		// Hack 10/2000: Weight Y axis ops a little more than X axis ops.
-		// (Y axis ops use more cache resources.)
-		int xy_ops = x_ops * m_resample_src_y + (4 * y_ops * m_resample_dst_x) / 3;
-
-		int yx_ops = (4 * y_ops * m_resample_src_x) / 3 + x_ops * m_resample_dst_y;
-
-#if RESAMPLER_DEBUG_OPS
-		printf("src: %i %i\n", m_resample_src_x, m_resample_src_y);
-		printf("dst: %i %i\n", m_resample_dst_x, m_resample_dst_y);
-		printf("x_ops: %i\n", x_ops);
-		printf("y_ops: %i\n", y_ops);
-		printf("xy_ops: %i\n", xy_ops);
-		printf("yx_ops: %i\n", yx_ops);
-#endif
-
-		// Now check which resample order is better. In case of a tie, choose the order
-		// which buffers the least amount of data.
-		if ((xy_ops > yx_ops) || ((xy_ops == yx_ops) && (m_resample_src_x < m_resample_dst_x))) {
-			m_delay_x_resample = true;
-			m_intermediate_x = m_resample_src_x;
-		} else {
-			m_delay_x_resample = false;
-			m_intermediate_x = m_resample_dst_x;
+		for (uint32_t c = 0; c < Channels; ++ c) {
+			dst[i * Channels + c] = acc[c];
 		}
-#if RESAMPLER_DEBUG_OPS
-		printf("delaying: %i\n", m_delay_x_resample);
-#endif
 	}
-
-	if (m_delay_x_resample) {
-		if ((m_Ptmp_buf = (Real*)memory::pool::palloc(m_pool, m_intermediate_x * sizeof(Real))) == NULL) {
-			m_status = STATUS_OUT_OF_MEMORY;
-			return;
-		}
-	}
-}
-
-void Resampler::get_clists(Contrib_List** ptr_clist_x, Contrib_List** ptr_clist_y) {
-	if (ptr_clist_x)
-		*ptr_clist_x = m_Pclist_x;
-
-	if (ptr_clist_y)
-		*ptr_clist_y = m_Pclist_y;
 }
 
-int Resampler::get_filter_num() {
-	return NUM_FILTERS;
-}
+void Resampler::filterLine(Real *dst, const Real *src) const {
+	const uint32_t taps = _x.taps;
+	const Real *w = _x.weights.data();
 
-class ResamplerData {
-public:
-	using Filter = Bitmap::ResampleFilter;
-
-	struct Node {
-		Resampler *resampler = nullptr;
-		memory::vector<Resampler::Real> sample;
-
-		template <typename ... Args>
-		Node(uint32_t width, Args && ... args) : resampler(new Resampler(width, forward<Args>(args)...)) {
-			sample.resize(width);
+	switch (_bpp) {
+	case 4:
+		// one pixel is exactly one vector
+		for (uint32_t i = 0; i < _x.dst; ++ i, w += taps) {
+			const Real *s = src + size_t(_x.offsets[i]) * 4;
+			auto acc = simde_mm_setzero_ps();
+			for (uint32_t k = 0; k < taps; ++ k) {
+				acc = simde_mm_add_ps(acc, simde_mm_mul_ps(simde_mm_set1_ps(w[k]), simde_mm_loadu_ps(s + k * 4)));
+			}
+			simde_mm_storeu_ps(dst + i * 4, acc);
 		}
-	};
-
-	ResamplerData(memory::pool_t *p) : pool(p) { }
-
-	ResamplerData(const ResamplerData &) = delete;
-	ResamplerData(ResamplerData &&) = delete;
-
-	ResamplerData &operator=(const ResamplerData &) = delete;
-	ResamplerData &operator=(ResamplerData &&) = delete;
-
-	void resample(Filter, const Bitmap &source, Bitmap &target);
-
-protected:
-	memory::pool_t *pool = nullptr;
-};
-
-
-void ResamplerData::resample(Filter filter, const Bitmap &source, Bitmap &target) {
-	memory::pool::push(pool);
-
-	auto bpp = Bitmap::getBytesPerPixel(source.format());
-
-	memory::vector<Node> nodes;
-	nodes.reserve(bpp);
-
-	nodes.emplace_back(source.width(), source.height(), target.width(), target.height(),
-			Resampler::BOUNDARY_CLAMP, 0.0f, 1.0f, filter);
-
-	for (uint8_t i = 1; i < bpp; i++) {
-		nodes.emplace_back(source.width(), source.height(), target.width(), target.height(),
-				Resampler::BOUNDARY_CLAMP, 0.0f, 1.0f, filter,
-				nodes.front().resampler->get_clist_x(), nodes.front().resampler->get_clist_y());
-	}
-
-	uint32_t dst_y = 0;
-	const uint32_t src_pitch = source.stride();
-	const uint32_t dst_pitch = target.stride();
-	auto pSrc_image = source.dataPtr();
-	auto dst_image = target.dataPtr();
+		break;
+	case 1:
+		// vectorize over contributors
+		for (uint32_t i = 0; i < _x.dst; ++ i, w += taps) {
+			const Real *s = src + _x.offsets[i];
+			auto acc = simde_mm_setzero_ps();
+			uint32_t k = 0;
+			for (; k + 4 <= taps; k += 4) {
+				acc = simde_mm_add_ps(acc, simde_mm_mul_ps(simde_mm_loadu_ps(w + k), simde_mm_loadu_ps(s + k)));
+			}
 
-	for (uint32_t src_y = 0; src_y < source.height(); src_y++) {
-		const uint8_t* pSrc = &pSrc_image[src_y * src_pitch];
+			Real tmp[4];
+			simde_mm_storeu_ps(tmp, acc);
 
-		for (uint32_t x = 0; x < source.width(); x++) {
-			for (auto &it : nodes) {
-				it.sample[x] = *pSrc++ * (1.0f / 255.0f);
+			Real sum = (tmp[0] + tmp[1]) + (tmp[2] + tmp[3]);
+			for (; k < taps; ++ k) {
+				sum += w[k] * s[k];
 			}
+			dst[i] = sum;
 		}
-
-		for (auto &it : nodes) {
-			if (!it.resampler->put_line(it.sample.data())) {
-				log::format("Bitmap", "Resampler: Out of memory!");
-				memory::pool::pop();
-				return;
-			}
+		break;
+	case 2: filterPixels<2>(dst, src); break;
+	case 3: filterPixels<3>(dst, src); break;
+	default: break;
+	}
+}
+
+void Resampler::filterColumn(Real *dst, const Real *rows, const Real *w) const {
+	const uint32_t taps = _y.taps;
+	const size_t count = _rowSize;
+
+	// process row in blocks of 16 values to keep accumulators in registers
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		auto acc0 = simde_mm_setzero_ps();
+		auto acc1 = simde_mm_setzero_ps();
+		auto acc2 = simde_mm_setzero_ps();
+		auto acc3 = simde_mm_setzero_ps();
+
+		const Real *s = rows + i;
+		for (uint32_t k = 0; k < taps; ++ k, s += count) {
+			auto weight = simde_mm_set1_ps(w[k]);
+			acc0 = simde_mm_add_ps(acc0, simde_mm_mul_ps(weight, simde_mm_loadu_ps(s)));
+			acc1 = simde_mm_add_ps(acc1, simde_mm_mul_ps(weight, simde_mm_loadu_ps(s + 4)));
+			acc2 = simde_mm_add_ps(acc2, simde_mm_mul_ps(weight, simde_mm_loadu_ps(s + 8)));
+			acc3 = simde_mm_add_ps(acc3, simde_mm_mul_ps(weight, simde_mm_loadu_ps(s + 12)));
 		}
 
-		while (true) {
-			bool complete = false;
-			uint8_t comp_index = 0;
-			for (auto &it : nodes) {
-				const float* pOutput_samples = it.resampler->get_line();
-				if (!pOutput_samples) {
-					complete = true;
-					break;
-				}
-
-				uint8_t* pDst = &dst_image[dst_y * dst_pitch + comp_index];
-
-				for (uint32_t x = 0; x < target.width(); x++) {
-					int c = (int)(255.0f * pOutput_samples[x] + .5f);
-					if (c < 0) {
-						c = 0;
-					} else if (c > 255) {
-						c = 255;
-					}
-					*pDst = uint8_t(c);
-					pDst += bpp;
-				}
-
-				comp_index ++;
-			}
-			if (complete) {
-				break;
-			}
-			dst_y++;
-		}
+		simde_mm_storeu_ps(dst + i, acc0);
+		simde_mm_storeu_ps(dst + i + 4, acc1);
+		simde_mm_storeu_ps(dst + i + 8, acc2);
+		simde_mm_storeu_ps(dst + i + 12, acc3);
 	}
 
-	//std::cout << memory::pool::get_allocated_bytes(pool) << "\n";
-
-	memory::pool::pop();
+	for (; i < count; ++ i) {
+		Real sum = 0.0f;
+		const Real *s = rows + i;
+		for (uint32_t k = 0; k < taps; ++ k, s += count) {
+			sum += w[k] * *s;
+		}
+		dst[i] = sum;
+	}
 }
 
-
 Bitmap Bitmap::resample(ResampleFilter f, uint32_t width, uint32_t height, uint32_t stride) const {
 	Bitmap ret;
 	if (empty()) {
 		return ret;
 	}
 
-	if ((min(width, height) <= 1) || (max(height, height) > Resampler::MaxDimensions)) {
+	if ((min(width, height) <= 1) || (max(width, height) > Resampler::MaxDimensions)) {
 		log::format("Bitmap", "Invalid resample width/height (%u x %u), max dimension is %u",
 				width, height, Resampler::MaxDimensions);
 		return ret;
@@ -1305,7 +747,7 @@ Bitmap Bitmap::resample(ResampleFilter f, uint32_t width, uint32_t height, uint3
 
 	if ((max(_width, _height) > Resampler::MaxDimensions)) {
 		log::format("Bitmap", "Bitmap is too large (%u x %u), max dimension is %u",
-				width, height, Resampler::MaxDimensions);
+				_width, _height, Resampler::MaxDimensions);
 		return ret;
 	}
 
@@ -1318,20 +760,67 @@ Bitmap Bitmap::resample(ResampleFilter f, uint32_t width, uint32_t height, uint3
 	ret._originalFormat = _originalFormat;
 	ret._originalFormatName = _originalFormatName;
 
-	auto p = memory::pool::create(memory::pool::acquire());
-	memory::pool::push(p);
-
-	ResamplerData data(p);
-	data.resample(f, *this, ret);
-
-	memory::pool::pop();
-	memory::pool::destroy(p);
+	Resampler resampler(*this, ret);
+	if (!resampler.init(f)) {
+		log::text("Bitmap", "Fail to initialize resampler");
+		ret.clear();
+		return ret;
+	}
 
+	resampler.run();
 	return ret;
 }
 
 Bitmap Bitmap::resample(uint32_t width, uint32_t height, uint32_t stride) const {
-	return resample(ResamplerData::Filter::Default, width, height, stride);
+	return resample(ResampleFilter::Default, width, height, stride);
+}
+
+bool Bitmap::resample(const io::Producer &source, const io::Consumer &target, ResampleFilter f, uint32_t width, uint32_t height) {
+	if ((min(width, height) <= 1) || (max(width, height) > Resampler::MaxDimensions)) {
+		log::format("Bitmap", "Invalid resample width/height (%u x %u), max dimension is %u",
+				width, height, Resampler::MaxDimensions);
+		return false;
+	}
+
+	auto fmt = detectFormat(source).first;
+	if (fmt == FileFormat::Custom) {
+		fmt = FileFormat::Png;
+	}
+
+	BitmapFormat::LineInfo info;
+	Resampler resampler;
+
+	// encoder reads info on first line, it's filled by decoder before that
+	return BitmapFormat::writeLines(fmt, target, info, [&] (const BitmapFormat::line_fn &write) -> bool {
+		return BitmapFormat::readLines(source, width, height, [&] (const BitmapFormat::LineInfo &src) -> bool {
+			if ((max(src.width, src.height) > Resampler::MaxDimensions)) {
+				log::format("Bitmap", "Bitmap is too large (%u x %u), max dimension is %u",
+						src.width, src.height, Resampler::MaxDimensions);
+				return false;
+			}
+
+			if (getBytesPerPixel(src.color) == 0) {
+				log::text("Bitmap", "Invalid color format for resampling");
+				return false;
+			}
+
+			info = src;
+			info.width = width;
+			info.height = height;
+
+			if (!resampler.init(f, getBytesPerPixel(src.color), src.width, src.height, width, height)) {
+				log::text("Bitmap", "Fail to initialize resampler");
+				return false;
+			}
+			return true;
+		}, [&] (const uint8_t *line) -> bool {
+			return resampler.push(line, write);
+		}) && resampler.isComplete();
+	});
+}
+
+bool Bitmap::resample(const io::Producer &source, const io::Consumer &target, uint32_t width, uint32_t height) {
+	return resample(source, target, ResampleFilter::Default, width, height);
 }
 
 NS_SP_END
@@ -166,6 +166,7 @@ Distance::Distance() noexcept { }
 
 Distance::Distance(const Distance &dist) noexcept : _storage(dist._storage) { }
 Distance::Distance(Distance &&dist) noexcept : _storage(move(dist._storage)) { }
+Distance::Distance(Storage &&storage) noexcept : _storage(move(storage)) { }
 
 Distance &Distance::operator=(const Distance &dist) noexcept {
 	_storage = dist._storage;
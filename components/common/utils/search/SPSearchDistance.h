@@ -114,6 +114,9 @@ public:
 	Distance() noexcept;
 	Distance(const StringView &origin, const StringView &canonical, size_t maxDistance = maxOf<size_t>());
 
+	// restore alignment from previously calculated storage (e.g. from persistent search index)
+	explicit Distance(Storage &&) noexcept;
+
 	Distance(const Distance &) noexcept;
 	Distance(Distance &&) noexcept;
 
@@ -134,6 +137,8 @@ public:
 
 	memory::string info() const;
 
+	const Storage &storage() const { return _storage; }
+
 protected:
 	Storage _storage;
 };
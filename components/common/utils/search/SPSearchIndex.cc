@@ -25,10 +25,236 @@ THE SOFTWARE.
 
 #include "SPCommon.h"
 #include "SPString.h"
+#include "SPFilesystem.h"
 #include "SPSearchIndex.h"
 
+#ifndef __MINGW32__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 NS_SP_EXT_BEGIN(search)
 
+// Persistent index layout (host byte order):
+//  header
+//  uint32_t blocks[header.blocks]
+//  uint32_t offsets[header.terms + 1]
+//  uint8_t dictionary[header.dictionary]
+//  uint8_t data[header.data]
+//  nodes (file only)
+struct SearchIndex_Header {
+	static constexpr uint32_t Magic = 0x49535053; // SPSI
+	static constexpr uint32_t Version = 1;
+
+	uint32_t magic = Magic;
+	uint32_t version = Version;
+	uint32_t terms = 0;
+	uint32_t postings = 0;
+	uint32_t blocks = 0;
+	uint32_t dictionary = 0;
+	uint32_t data = 0;
+	uint32_t nodes = 0;
+
+	size_t size() const {
+		// in size_t, so, values from corrupted file can not overflow
+		return sizeof(SearchIndex_Header) + (size_t(blocks) + size_t(terms) + 1) * sizeof(uint32_t)
+				+ size_t(dictionary) + size_t(data);
+	}
+};
+
+struct SearchIndex_Hit {
+	uint32_t node;
+	SearchIndex::ResultToken token;
+};
+
+static void SearchIndex_writeVarUint(Bytes &buf, uint32_t val) {
+	while (val >= 0x80) {
+		buf.emplace_back(uint8_t(val | 0x80));
+		val >>= 7;
+	}
+	buf.emplace_back(uint8_t(val));
+}
+
+static uint32_t SearchIndex_readVarUint(const uint8_t *&ptr) {
+	uint32_t ret = 0;
+	uint32_t shift = 0;
+	while (*ptr & 0x80) {
+		ret |= uint32_t(*ptr & 0x7F) << shift;
+		shift += 7;
+		++ ptr;
+	}
+	ret |= uint32_t(*ptr) << shift;
+	++ ptr;
+	return ret;
+}
+
+static bool SearchIndex_readVarUint(BytesView &r, uint32_t &val) {
+	val = 0;
+	uint32_t shift = 0;
+	while (!r.empty() && shift < 32) {
+		auto b = r[0];
+		r.offset(1);
+		val |= uint32_t(b & 0x7F) << shift;
+		if (!(b & 0x80)) {
+			return true;
+		}
+		shift += 7;
+	}
+	return false;
+}
+
+// sequential reader for front-coded dictionary
+struct SearchIndex_TermReader {
+	SearchIndex_TermReader(const SearchIndex::TermIndex &idx, uint32_t block)
+	: index(&idx), ptr(idx.dictionary.data() + idx.blocks[block]), term(uint32_t(block * SearchIndex::TermBlockSize)) { }
+
+	bool next() {
+		if (term >= index->terms) {
+			return false;
+		}
+
+		auto prefix = SearchIndex_readVarUint(ptr);
+		auto suffix = SearchIndex_readVarUint(ptr);
+		value.resize(prefix);
+		value.append((const char *)ptr, suffix);
+		ptr += suffix;
+		++ term;
+		return true;
+	}
+
+	uint32_t current() const { return term - 1; }
+
+	const SearchIndex::TermIndex *index;
+	const uint8_t *ptr;
+	uint32_t term;
+	String value;
+};
+
+static StringView SearchIndex_getBlockTerm(const SearchIndex::TermIndex &idx, uint32_t block) {
+	auto ptr = idx.dictionary.data() + idx.blocks[block];
+	SearchIndex_readVarUint(ptr); // prefix size, always 0 for first term in block
+	auto size = SearchIndex_readVarUint(ptr);
+	return StringView((const char *)ptr, size);
+}
+
+template <typename Callback>
+static void SearchIndex_readPostings(const SearchIndex::TermIndex &idx, uint32_t term, const Callback &cb) {
+	auto ptr = idx.data.data() + idx.offsets[term];
+	auto end = idx.data.data() + idx.offsets[term + 1];
+
+	// node index is delta from previous posting (starting from maxOf<uint32_t>, so first delta is never 0),
+	// zero delta means same node, then slice start is delta from previous slice start
+	uint32_t node = maxOf<uint32_t>();
+	uint32_t start = 0;
+	while (ptr < end) {
+		auto delta = SearchIndex_readVarUint(ptr);
+		auto value = SearchIndex_readVarUint(ptr);
+		if (delta) {
+			node += delta;
+			start = value;
+		} else {
+			start += value;
+		}
+		cb(node, start);
+	}
+}
+
+// walks whole dictionary and all postings with bounds-checked reads, so, unchecked readers above
+// can be used with index from file; every posting should refer to existing node and slice within it
+static bool SearchIndex_validate(const SearchIndex::TermIndex &idx, const Vector<SearchIndex::Node> &nodes) {
+	if (idx.offsets.front() != 0) {
+		return false;
+	}
+
+	BytesView dict(idx.dictionary);
+	String value;
+	uint32_t postings = 0;
+	for (uint32_t term = 0; term < idx.terms; ++ term) {
+		bool first = (term % SearchIndex::TermBlockSize == 0);
+		if (first && idx.blocks[term / SearchIndex::TermBlockSize] != idx.dictionary.size() - dict.size()) {
+			return false;
+		}
+
+		uint32_t prefix = 0;
+		uint32_t suffix = 0;
+		if (!SearchIndex_readVarUint(dict, prefix) || !SearchIndex_readVarUint(dict, suffix)
+				|| (first && prefix != 0) || prefix > value.size() || suffix > dict.size()) {
+			return false;
+		}
+
+		value.resize(prefix);
+		value.append((const char *)dict.data(), suffix);
+		dict.offset(suffix);
+
+		// term size is a slice size for its postings
+		if (value.empty() || value.size() > maxOf<uint16_t>()
+				|| idx.offsets[term + 1] < idx.offsets[term] || idx.offsets[term + 1] > idx.data.size()) {
+			return false;
+		}
+
+		BytesView r(idx.data.data() + idx.offsets[term], idx.offsets[term + 1] - idx.offsets[term]);
+		uint32_t node = maxOf<uint32_t>();
+		uint32_t start = 0;
+		while (!r.empty()) {
+			uint32_t delta = 0;
+			uint32_t v = 0;
+			if (!SearchIndex_readVarUint(r, delta) || !SearchIndex_readVarUint(r, v)) {
+				return false;
+			}
+			if (delta) {
+				node += delta;
+				start = v;
+			} else {
+				start += v;
+			}
+			if (node >= nodes.size() || size_t(start) + value.size() > nodes[node].canonical.size()) {
+				return false;
+			}
+			++ postings;
+		}
+	}
+
+	return dict.empty() && postings == idx.postings;
+}
+
+// calls cb for every term in compact index, that starts with prefix
+template <typename Callback>
+static void SearchIndex_findTerms(const SearchIndex::TermIndex &idx, const StringView &prefix, const Callback &cb) {
+	if (idx.terms == 0) {
+		return;
+	}
+
+	// find first block, that starts with term >= prefix, prefixed terms can start in previous block
+	uint32_t lo = 0;
+	uint32_t hi = uint32_t(idx.blocks.size());
+	while (lo < hi) {
+		auto mid = lo + (hi - lo) / 2;
+		if (string::compare(SearchIndex_getBlockTerm(idx, mid), prefix) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	SearchIndex_TermReader reader(idx, lo > 0 ? lo - 1 : 0);
+	while (reader.next()) {
+		StringView value(reader.value);
+		if (string::compare(value, prefix) < 0) {
+			continue;
+		} else if (value.starts_with(prefix)) {
+			cb(reader.current(), value);
+		} else {
+			break;
+		}
+	}
+}
+
+SearchIndex::~SearchIndex() {
+	unmap();
+}
+
 bool SearchIndex::init(const TokenizerCallback &tcb) {
 	_tokenizer = tcb;
 	return true;
@@ -72,45 +298,187 @@ void SearchIndex::add(const StringView &v, int64_t id, int64_t tag) {
 	}
 }
 
+size_t SearchIndex::remove(int64_t id) {
+	size_t ret = 0;
+	for (auto &it : _nodes) {
+		if (it.id == id && !it.canonical.empty()) {
+			it.canonical.clear();
+			it.alignment = Distance();
+			++ ret;
+		}
+	}
+
+	if (ret > 0) {
+		// pending tokens refer to canonical string, so they should be dropped with node
+		_tokens.erase(std::remove_if(_tokens.begin(), _tokens.end(), [&] (const Token &t) {
+			return _nodes[t.index].canonical.empty();
+		}), _tokens.end());
+		_removed += ret;
+	}
+	return ret;
+}
+
+void SearchIndex::build() {
+	if (_tokens.empty() && _removed == 0 && !_index.offsets.empty()) {
+		return;
+	}
+
+	auto tokenComparator = [&] (const Token &l, const Token &r) {
+		return compareTokens(l, r);
+	};
+
+	if (!_tokensSorted) {
+		std::sort(_tokens.begin(), _tokens.end(), tokenComparator);
+	}
+
+	Vector<uint32_t> remap;
+	remap.reserve(_nodes.size());
+
+	uint32_t nextIndex = 0;
+	for (auto &it : _nodes) {
+		remap.emplace_back(it.canonical.empty() ? maxOf<uint32_t>() : nextIndex ++);
+	}
+
+	// decode compact index, it's already sorted, remapping preserves node order
+	Vector<Token> tokens;
+	tokens.reserve(_index.postings + _tokens.size());
+
+	if (_index.terms > 0) {
+		SearchIndex_TermReader reader(_index, 0);
+		while (reader.next()) {
+			auto size = uint16_t(reader.value.size());
+			SearchIndex_readPostings(_index, reader.current(), [&] (uint32_t node, uint32_t start) {
+				auto idx = remap[node];
+				if (idx != maxOf<uint32_t>()) {
+					tokens.emplace_back(Token{idx, Slice{uint16_t(start), size}});
+				}
+			});
+		}
+	}
+
+	auto mid = tokens.size();
+	for (auto &it : _tokens) {
+		auto idx = remap[it.index];
+		if (idx != maxOf<uint32_t>()) {
+			tokens.emplace_back(Token{idx, it.slice});
+		}
+	}
+
+	if (_removed > 0) {
+		for (size_t i = 0; i < _nodes.size(); ++ i) {
+			if (remap[i] != maxOf<uint32_t>() && remap[i] != i) {
+				_nodes[remap[i]] = move(_nodes[i]);
+			}
+		}
+		_nodes.resize(nextIndex);
+	}
+
+	std::inplace_merge(tokens.begin(), tokens.begin() + mid, tokens.end(), tokenComparator);
+
+	Bytes dictionary;
+	Bytes data;
+	Vector<uint32_t> blocks;
+	Vector<uint32_t> offsets;
+
+	StringView prev;
+	uint32_t prevNode = 0;
+	uint32_t prevStart = 0;
+
+	for (auto &it : tokens) {
+		auto value = makeStringView(it);
+		if (offsets.empty() || value != prev) {
+			size_t prefix = 0;
+			if (offsets.size() % TermBlockSize == 0) {
+				blocks.emplace_back(uint32_t(dictionary.size()));
+			} else {
+				auto len = std::min(prev.size(), value.size());
+				while (prefix < len && prev[prefix] == value[prefix]) {
+					++ prefix;
+				}
+			}
+
+			SearchIndex_writeVarUint(dictionary, uint32_t(prefix));
+			SearchIndex_writeVarUint(dictionary, uint32_t(value.size() - prefix));
+			dictionary.insert(dictionary.end(), (const uint8_t *)value.data() + prefix, (const uint8_t *)value.data() + value.size());
+
+			offsets.emplace_back(uint32_t(data.size()));
+			prev = value;
+			prevNode = maxOf<uint32_t>();
+			prevStart = 0;
+		}
+
+		auto delta = it.index - prevNode;
+		SearchIndex_writeVarUint(data, delta);
+		SearchIndex_writeVarUint(data, delta ? it.slice.start : it.slice.start - prevStart);
+		prevNode = it.index;
+		prevStart = it.slice.start;
+	}
+	offsets.emplace_back(uint32_t(data.size()));
+
+	SearchIndex_Header header;
+	header.terms = uint32_t(offsets.size() - 1);
+	header.postings = uint32_t(tokens.size());
+	header.blocks = uint32_t(blocks.size());
+	header.dictionary = uint32_t(dictionary.size());
+	header.data = uint32_t(data.size());
+	header.nodes = uint32_t(_nodes.size());
+
+	Bytes storage;
+	storage.resize(header.size());
+
+	auto target = storage.data();
+	memcpy(target, &header, sizeof(SearchIndex_Header)); target += sizeof(SearchIndex_Header);
+	memcpy(target, blocks.data(), blocks.size() * sizeof(uint32_t)); target += blocks.size() * sizeof(uint32_t);
+	memcpy(target, offsets.data(), offsets.size() * sizeof(uint32_t)); target += offsets.size() * sizeof(uint32_t);
+	memcpy(target, dictionary.data(), dictionary.size()); target += dictionary.size();
+	memcpy(target, data.data(), data.size());
+
+	unmap();
+	_storage = move(storage);
+	readIndex(BytesView(_storage));
+
+	_tokens.clear();
+	_tokensSorted = true;
+	_removed = 0;
+}
+
 SearchIndex::Result SearchIndex::performSearch(const StringView &v, size_t minMatch, const HeuristicCallback &cb,
-		const FilterCallback & filter) {
+		const FilterCallback & filter, size_t limit) {
+	if (_tokens.size() > std::max(PendingThreshold, size_t(_index.postings / 4))) {
+		build();
+	} else if (!_tokensSorted) {
+		std::sort(_tokens.begin(), _tokens.end(), [&] (const Token &l, const Token &r) {
+			return compareTokens(l, r);
+		});
+		_tokensSorted = true;
+	}
+
 	String origin(string::tolower(v));
 
 	SearchIndex::Result res{this};
 
 	uint32_t wordIndex = 0;
+	Vector<SearchIndex_Hit> hits;
 
 	auto tokenFn = [&] (const StringView &str) {
-		//std::cout << "Token: " << str << "\n";
+		auto match = uint16_t(str.size());
+
+		SearchIndex_findTerms(_index, str, [&] (uint32_t term, StringView value) {
+			auto size = uint16_t(value.size());
+			SearchIndex_readPostings(_index, term, [&] (uint32_t node, uint32_t start) {
+				hits.emplace_back(SearchIndex_Hit{node, ResultToken{wordIndex, match, Slice{uint16_t(start), size}}});
+			});
+		});
+
 		auto lb = std::lower_bound(_tokens.begin(), _tokens.end(), str, [&] (const Token &l, const StringView &r) {
 			return string::compare(makeStringView(l.index, l.slice), r) < 0;
 		});
 
-		if (lb != _tokens.end()) {
-			auto node = &_nodes.at(lb->index);
-			StringView value = makeStringView(*lb);
-			//std::cout << "Found: '" << value << "' from '" << _nodes.at(lb->index).canonical << "'\n";
-
-			while (lb != _tokens.end() && value.size() >= str.size() && String::traits_type::compare(value.data(), str.data(), str.size()) == 0) {
-				if (!filter || filter(node)) {
-					auto ret_it = std::lower_bound(res.nodes.begin(), res.nodes.end(), node,
-							[&] (const ResultNode &l, const Node *r) {
-						return l.node < r;
-					});
-					if (ret_it == res.nodes.end() || ret_it->node != node) {
-						res.nodes.emplace(ret_it, ResultNode{ 0.0f, node, {ResultToken{wordIndex, uint16_t(str.size()), lb->slice}} });
-					} else {
-						ret_it->matches.emplace_back(ResultToken{wordIndex, uint16_t(str.size()), lb->slice});
-					}
-				}
-				++ lb;
-				if (lb != _tokens.end()) {
-					value = makeStringView(*lb);
-					node = &_nodes.at(lb->index);
-					//std::cout << "Next: '" << value << "' from '" << _nodes.at(lb->index).canonical << "'\n";
-				}
-			}
+		while (lb != _tokens.end() && makeStringView(*lb).starts_with(str)) {
+			hits.emplace_back(SearchIndex_Hit{lb->index, ResultToken{wordIndex, match, lb->slice}});
+			++ lb;
 		}
+
 		wordIndex ++;
 	};
 
@@ -121,14 +489,47 @@ SearchIndex::Result SearchIndex::performSearch(const StringView &v, size_t minMa
 		r.split<DefaultSep>(tokenFn);
 	}
 
+	// group hits by node, stable sort preserves word order within node
+	std::stable_sort(hits.begin(), hits.end(), [] (const SearchIndex_Hit &l, const SearchIndex_Hit &r) {
+		return l.node < r.node;
+	});
+
+	auto it = hits.begin();
+	while (it != hits.end()) {
+		auto end = it + 1;
+		while (end != hits.end() && end->node == it->node) {
+			++ end;
+		}
+
+		auto node = &_nodes[it->node];
+		if (!node->canonical.empty() && (!filter || filter(node))) {
+			auto &ret = res.nodes.emplace_back(ResultNode{0.0f, node});
+			ret.matches.reserve(end - it);
+			for (; it != end; ++ it) {
+				ret.matches.emplace_back(it->token);
+			}
+		}
+		it = end;
+	}
+
+	auto scoreComparator = [] (const ResultNode &l, const ResultNode &r) {
+		return l.score > r.score;
+	};
+
 	if (cb) {
 		for (auto &it : res.nodes) {
 			it.score = cb(*this, it);
 		}
 
-		std::sort(res.nodes.begin(), res.nodes.end(), [] (const ResultNode &l, const ResultNode &r) {
-			return l.score > r.score;
-		});
+		if (limit < res.nodes.size()) {
+			std::partial_sort(res.nodes.begin(), res.nodes.begin() + limit, res.nodes.end(), scoreComparator);
+		} else {
+			std::sort(res.nodes.begin(), res.nodes.end(), scoreComparator);
+		}
+	}
+
+	if (limit < res.nodes.size()) {
+		res.nodes.resize(limit);
 	}
 
 	return res;
@@ -149,7 +550,105 @@ SearchIndex::Slice SearchIndex::convertToken(const Node &node, const ResultToken
 	}
 }
 
+bool SearchIndex::save(const StringView &path) {
+	build();
+
+	BytesView index = _mapped ? BytesView(_mapped, _mappedSize) : BytesView(_storage);
+	SearchIndex_Header header;
+	memcpy(&header, index.data(), sizeof(SearchIndex_Header));
+
+	Bytes out(index.data(), index.data() + header.size());
+	for (auto &it : _nodes) {
+		auto &storage = it.alignment.storage();
+
+		out.insert(out.end(), (const uint8_t *)&it.id, (const uint8_t *)&it.id + sizeof(int64_t));
+		out.insert(out.end(), (const uint8_t *)&it.tag, (const uint8_t *)&it.tag + sizeof(int64_t));
+		SearchIndex_writeVarUint(out, uint32_t(it.canonical.size()));
+		out.insert(out.end(), (const uint8_t *)it.canonical.data(), (const uint8_t *)it.canonical.data() + it.canonical.size());
+		SearchIndex_writeVarUint(out, uint32_t(storage.size()));
+
+		// alignment values are 2-bit, packed by 4 in byte
+		uint8_t b = 0;
+		for (size_t i = 0; i < storage.size(); ++ i) {
+			b |= toInt(storage.at(i)) << ((i % 4) * 2);
+			if (i % 4 == 3) {
+				out.emplace_back(b);
+				b = 0;
+			}
+		}
+		if (storage.size() % 4 != 0) {
+			out.emplace_back(b);
+		}
+	}
+
+	return filesystem::write(path, out);
+}
+
+bool SearchIndex::load(const StringView &path, bool mapped) {
+	unmap();
+	_storage.clear();
+	_nodes.clear();
+	_tokens.clear();
+	_tokensSorted = true;
+	_removed = 0;
+	_index = TermIndex();
+
+#ifndef __MINGW32__
+	if (mapped && !filepath::isBundled(path)) {
+		auto native = filesystem_native::posixToNative(filepath::absolute(path, true));
+		auto fd = ::open(native.data(), O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+
+		struct stat s;
+		void *ptr = MAP_FAILED;
+		if (::fstat(fd, &s) == 0 && s.st_size > 0) {
+			ptr = ::mmap(nullptr, size_t(s.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		}
+		::close(fd);
+
+		if (ptr == MAP_FAILED) {
+			return false;
+		}
+
+		_mapped = (uint8_t *)ptr;
+		_mappedSize = size_t(s.st_size);
+
+		if (readIndex(BytesView(_mapped, _mappedSize))) {
+			return true;
+		}
+
+		unmap();
+		_index = TermIndex();
+		return false;
+	}
+#endif
+
+	auto size = filesystem::size(path);
+	if (size == 0) {
+		return false;
+	}
+
+	_storage.resize(size);
+	if (filesystem::readIntoBuffer(_storage.data(), path) && readIndex(BytesView(_storage))) {
+		return true;
+	}
+
+	_storage.clear();
+	_index = TermIndex();
+	return false;
+}
+
 void SearchIndex::print() const {
+	if (_index.terms > 0) {
+		SearchIndex_TermReader reader(_index, 0);
+		while (reader.next()) {
+			SearchIndex_readPostings(_index, reader.current(), [&] (uint32_t node, uint32_t start) {
+				std::cout << node << " " << reader.value << " " << _nodes.at(node).id << "\n";
+			});
+		}
+	}
 	for (auto &it : _tokens) {
 		std::cout << it.index << " " << makeStringView(it) << " " << _nodes.at(it.index).id << "\n";
 	}
@@ -164,15 +663,110 @@ StringView SearchIndex::makeStringView(uint32_t idx, const Slice &sl) const {
 	return StringView(node.canonical.data() + sl.start, sl.size);
 }
 
+// order by token string, then by node index and position
+bool SearchIndex::compareTokens(const Token &l, const Token &r) const {
+	auto ret = string::compare(makeStringView(l), makeStringView(r));
+	if (ret == 0) {
+		return l.index < r.index || (l.index == r.index && l.slice.start < r.slice.start);
+	}
+	return ret < 0;
+}
+
 void SearchIndex::onToken(Vector<Token> &vec, const StringView &rep, uint32_t idx, const Slice &sl) {
-	auto insert_it = std::lower_bound(vec.begin(), vec.end(), rep, [&] (const Token &l, const StringView &r) {
-		return string::compare(makeStringView(l.index, l.slice), r) < 0;
-	});
-	if (insert_it ==  vec.end()) {
-		vec.emplace_back(Token{idx, sl});
-	} else {
-		vec.emplace(insert_it, Token{idx, sl});
+	// tokens are sorted lazily, on first search or build
+	vec.emplace_back(Token{idx, sl});
+	_tokensSorted = false;
+}
+
+bool SearchIndex::readIndex(BytesView data) {
+	SearchIndex_Header header;
+	if (data.size() < sizeof(SearchIndex_Header)) {
+		return false;
+	}
+
+	memcpy(&header, data.data(), sizeof(SearchIndex_Header));
+	if (header.magic != SearchIndex_Header::Magic || header.version != SearchIndex_Header::Version
+			|| header.size() > data.size()
+			|| header.blocks != (header.terms + TermBlockSize - 1) / TermBlockSize) {
+		return false;
+	}
+
+	auto ptr = data.data() + sizeof(SearchIndex_Header);
+
+	TermIndex index;
+	index.terms = header.terms;
+	index.postings = header.postings;
+	index.blocks = SpanView<uint32_t>((const uint32_t *)ptr, header.blocks); ptr += header.blocks * sizeof(uint32_t);
+	index.offsets = SpanView<uint32_t>((const uint32_t *)ptr, header.terms + 1); ptr += (header.terms + 1) * sizeof(uint32_t);
+	index.dictionary = BytesView(ptr, header.dictionary); ptr += header.dictionary;
+	index.data = BytesView(ptr, header.data); ptr += header.data;
+
+	if (index.offsets.back() != header.data || (header.blocks > 0 && index.blocks.back() >= header.dictionary)) {
+		return false;
+	}
+
+	// nodes are stored only in file, after compact index
+	if (data.size() > header.size()) {
+		Vector<Node> nodes;
+
+		// every node takes at least id, tag and two sizes
+		BytesView r(ptr, data.size() - header.size());
+		if (header.nodes > r.size() / (sizeof(int64_t) * 2 + 2)) {
+			return false;
+		}
+		nodes.reserve(header.nodes);
+
+		for (uint32_t i = 0; i < header.nodes; ++ i) {
+			Node node;
+			uint32_t size = 0;
+			if (r.size() < sizeof(int64_t) * 2) {
+				return false;
+			}
+
+			memcpy(&node.id, r.data(), sizeof(int64_t)); r.offset(sizeof(int64_t));
+			memcpy(&node.tag, r.data(), sizeof(int64_t)); r.offset(sizeof(int64_t));
+
+			if (!SearchIndex_readVarUint(r, size) || size == 0 || r.size() < size) {
+				return false;
+			}
+			node.canonical.assign((const char *)r.data(), size);
+			r.offset(size);
+
+			if (!SearchIndex_readVarUint(r, size) || r.size() < (size_t(size) + 3) / 4) {
+				return false;
+			}
+			if (size > 0) {
+				Distance::Storage storage;
+				storage.reserve(size);
+				for (uint32_t j = 0; j < size; ++ j) {
+					storage.emplace_back(Distance::Value((r[j / 4] >> ((j % 4) * 2)) & 0x3));
+				}
+				node.alignment = Distance(move(storage));
+				r.offset((size + 3) / 4);
+			}
+			nodes.emplace_back(move(node));
+		}
+
+		if (!SearchIndex_validate(index, nodes)) {
+			return false;
+		}
+		_nodes = move(nodes);
+	} else if (header.nodes != _nodes.size() || !SearchIndex_validate(index, _nodes)) {
+		return false;
+	}
+
+	_index = index;
+	return true;
+}
+
+void SearchIndex::unmap() {
+#ifndef __MINGW32__
+	if (_mapped) {
+		::munmap(_mapped, _mappedSize);
 	}
+#endif
+	_mapped = nullptr;
+	_mappedSize = 0;
 }
 
 float SearchIndex::Heuristic::operator () (const SearchIndex &index, const SearchIndex::ResultNode &node) {
@@ -25,6 +25,7 @@ THE SOFTWARE.
 
 #include "SPStringView.h"
 #include "SPSearchDistance.h"
+#include "SPSpanView.h"
 #include "SPRef.h"
 
 NS_SP_EXT_BEGIN(search)
@@ -120,27 +121,87 @@ public:
 		};
 	};
 
+	// Compact postings index: sorted term dictionary, front-coded in blocks of TermBlockSize terms,
+	// and a list of (node, slice start) postings for every term, delta/varint-encoded
+	// Slice size for posting is always a size of its term
+	struct TermIndex {
+		uint32_t terms = 0;
+		uint32_t postings = 0; // total number of postings
+		SpanView<uint32_t> blocks; // offset of every block in dictionary
+		SpanView<uint32_t> offsets; // offset of every term postings list in data, terms + 1 values
+		BytesView dictionary;
+		BytesView data;
+	};
+
+	static constexpr size_t TermBlockSize = 16;
+
+	// pending tokens are merged into compact index on search, when there are more of them then
+	// max(PendingThreshold, postings / 4); use build() to merge explicitly after bulk add
+	static constexpr size_t PendingThreshold = 4096;
+
+	SearchIndex() = default;
+	virtual ~SearchIndex();
+
+	// index can own memory-mapped file, copy will unmap it twice
+	SearchIndex(const SearchIndex &) = delete;
+	SearchIndex &operator=(const SearchIndex &) = delete;
+
 	bool init(const TokenizerCallback & = nullptr);
 
 	void reserve(size_t);
 	void add(const StringView &, int64_t id, int64_t tag);
 
+	// mark all nodes with id as removed, nodes are excluded from results immediately
+	// and dropped from index on next build; returns number of removed nodes
+	size_t remove(int64_t id);
+
+	// merge pending tokens into compact index and drop removed nodes
+	// node pointers from previous results are invalidated
+	void build();
+
+	// if limit is set, only top `limit` nodes (by heuristic score) are returned
 	Result performSearch(const StringView &, size_t minMatch, const HeuristicCallback & = Heuristic(),
-			const FilterCallback & filter = nullptr);
+			const FilterCallback & filter = nullptr, size_t limit = maxOf<size_t>());
 
 	StringView resolveToken(const Node &, const ResultToken &) const;
 	Slice convertToken(const Node &, const ResultToken &) const;
 
+	// write index into file, pending tokens are merged before write
+	bool save(const StringView &path);
+
+	// read index from file, previous contents is discarded
+	// if mapped == true, compact index is used directly from memory-mapped file
+	bool load(const StringView &path, bool mapped = true);
+
+	size_t size() const { return _nodes.size() - _removed; }
+
+	const TermIndex &getTermIndex() const { return _index; }
+
 	void print() const;
 
 protected:
 	StringView makeStringView(const Token &) const;
 	StringView makeStringView(uint32_t idx, const Slice &) const;
 
+	bool compareTokens(const Token &, const Token &) const;
+
 	void onToken(Vector<Token> &vec, const StringView &, uint32_t, const Slice &);
 
-	Vector<Node> _nodes;
-	Vector<Token> _tokens;
+	// reads and validates compact index and nodes (if stored after index), all offsets
+	// and postings are checked against data size, so, corrupted file can not cause out-of-bounds read
+	bool readIndex(BytesView);
+	void unmap();
+
+	Vector<Node> _nodes; // removed nodes have empty canonical string
+	Vector<Token> _tokens; // pending tokens, not yet merged into compact index
+	bool _tokensSorted = true;
+	size_t _removed = 0;
+
+	TermIndex _index;
+	Bytes _storage; // compact index data, if not mapped
+	uint8_t *_mapped = nullptr;
+	size_t _mappedSize = 0;
+
 	TokenizerCallback _tokenizer;
 };
 
@@ -565,6 +565,7 @@ bool TaskQueue::cancelWorkers() {
 
 	_context->cancel();
 	delete _context;
+	_context = nullptr;
 	return true;
 }
 
@@ -287,6 +287,7 @@ bool Renderer::requestRendering() {
 		layout::Builder * impl = new layout::Builder(document, media, fontSet, _ids);
 		impl->setExternalAssetsMeta(s->getExternalAssetMeta());
 		impl->setHyphens(s->getHyphens());
+		impl->setConcurrency(uint16_t(std::thread::hardware_concurrency()));
 		_renderingInProgress = true;
 		if (_renderingCallback) {
 			_renderingCallback(nullptr, true);
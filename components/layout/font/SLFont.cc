@@ -29,22 +29,6 @@ THE SOFTWARE.
 
 NS_LAYOUT_BEGIN
 
-constexpr uint16_t LAYOUT_PADDING  = 1;
-
-struct UVec2 {
-	uint16_t x;
-	uint16_t y;
-};
-
-struct URect {
-	uint16_t x;
-	uint16_t y;
-	uint16_t width;
-	uint16_t height;
-
-	UVec2 origin() const { return UVec2{x, y}; }
-};
-
 void FontCharString::addChar(char16_t c) {
 	auto it = std::lower_bound(chars.begin(), chars.end(), c);
 	if (it == chars.end() || *it != c) {
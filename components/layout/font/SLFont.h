@@ -40,6 +40,23 @@ using ReceiptCallback = Function<Bytes(const FontSource *, const String &)>;
 
 using FontLayoutId = ValueWrapper<uint16_t, class FontLayoutIdTag>;
 
+// Texture layout primitives, shared by font layout and FreeType font library
+constexpr uint16_t LAYOUT_PADDING  = 1;
+
+struct UVec2 {
+	uint16_t x;
+	uint16_t y;
+};
+
+struct URect {
+	uint16_t x;
+	uint16_t y;
+	uint16_t width;
+	uint16_t height;
+
+	UVec2 origin() const { return UVec2{x, y}; }
+};
+
 struct Metrics final {
 	uint16_t size = 0; // font size in pixels
 	uint16_t height = 0; // default font line height
@@ -96,6 +113,10 @@ public:
 	virtual Metrics getMetrics(FontLayoutId) = 0;
 	virtual CharLayout getChar(FontLayoutId, char16_t, uint16_t &face) = 0;
 	virtual StringView getFontName(FontLayoutId) = 0;
+
+	// should be changed when font data for existed layout id is replaced,
+	// formatter drops data, cached for layout ids, when generation is changed
+	virtual uint32_t getDataGeneration() const { return 0; }
 };
 
 struct EmplaceCharInterface {
@@ -271,8 +271,10 @@ bool Formatter::pushChar(char16_t ch) {
 		ch = string::tolower(ch);
 	}
 
-	CharLayout charDef = output->source->getChar(primaryFontId, ch, faceId);
+	return pushChar(ch, output->source->getChar(primaryFontId, ch, faceId));
+}
 
+bool Formatter::pushChar(char16_t ch, CharLayout charDef) {
 	if (charDef.charID == 0) {
 		if (ch == (char16_t)0x00AD) {
 			charDef = output->source->getChar(primaryFontId, '-', faceId);
@@ -549,7 +551,82 @@ bool Formatter::pushLineBreakChar() {
 	return true;
 }
 
+static constexpr size_t WordCacheMaxLength = 64;
+static constexpr size_t WordCacheMaxChars = 64 * 1024;
+
+static bool isWordChar(char16_t ch) {
+	return ch >= char16_t(0x20) && ch != char16_t(0x00A0) && ch != char16_t(0x00AD) && !string::isspace(ch);
+}
+
+static WideStringView readWord(const WideStringView &r) {
+	size_t len = 0;
+	while (len < r.size() && isWordChar(r[len])) {
+		++ len;
+	}
+	return WideStringView(r.data(), len);
+}
+
+const Formatter::ShapedChar *Formatter::shapeWord(WideStringView w) {
+	auto generation = output->source->getDataGeneration();
+	if (wordCacheSource != output->source || wordCacheGeneration != generation) {
+		clearWordCache();
+		wordCacheSource = output->source;
+		wordCacheGeneration = generation;
+	}
+
+	auto hash = hash::hash64((const char *)w.data(), w.size() * sizeof(char16_t),
+			uint64_t(primaryFontId.get()) << 8 | uint64_t(toInt(textStyle.textTransform)));
+
+	auto it = wordCache.find(hash);
+	if (it != wordCache.end()) {
+		auto &entry = it->second;
+		if (entry.layout == primaryFontId && entry.transform == textStyle.textTransform
+				&& entry.length == w.size() && memcmp(wordCacheText.data() + entry.text, w.data(), w.size() * sizeof(char16_t)) == 0) {
+			return wordCacheChars.data() + entry.chars;
+		}
+	}
+
+	if (wordCacheChars.size() + w.size() > WordCacheMaxChars) {
+		clearWordCache();
+	}
+
+	ShapedWord entry{primaryFontId, textStyle.textTransform, uint32_t(wordCacheText.size()), uint32_t(wordCacheChars.size()), uint32_t(w.size())};
+
+	char16_t prev = 0;
+	uint16_t face = faceId;
+	for (auto &it : w) {
+		char16_t ch = it;
+		if (textStyle.textTransform == TextTransform::Uppercase) {
+			ch = string::toupper(ch);
+		} else if (textStyle.textTransform == TextTransform::Lowercase) {
+			ch = string::tolower(ch);
+		}
+
+		ShapedChar shaped;
+		shaped.charID = ch;
+		shaped.kerning = prev ? output->source->getKerningAmount(primaryFontId, prev, it, face) : 0;
+		shaped.layout = output->source->getChar(primaryFontId, ch, face);
+		shaped.face = face;
+
+		wordCacheChars.emplace_back(shaped);
+		prev = it;
+	}
+
+	wordCacheText.insert(wordCacheText.end(), w.data(), w.data() + w.size());
+	wordCache[hash] = entry;
+
+	return wordCacheChars.data() + entry.chars;
+}
+
+void Formatter::clearWordCache() {
+	wordCache.clear();
+	wordCacheText.clear();
+	wordCacheChars.clear();
+}
+
 bool Formatter::readChars(WideStringView &r, const Vector<uint8_t> &hyph) {
+	WideStringView word; // rest of current shaped word
+	const ShapedChar *shaped = nullptr;
 	size_t wordPos = 0;
 	auto hIt = hyph.begin();
 	bool startWhitespace = output->chars.empty();
@@ -627,10 +704,38 @@ bool Formatter::readChars(WideStringView &r, const Vector<uint8_t> &hyph) {
 			}
 		}
 
-		auto kerning = output->source->getKerningAmount(primaryFontId, b, c, faceId);
-		lineX += kerning;
-		if (!pushChar(c)) {
-			return false;
+		int16_t kerning = 0;
+		if (!word.empty() && word.data() == r.data()) {
+			// next char of shaped word, b is previous char of the same word
+			kerning = shaped->kerning;
+		} else if (auto w = readWord(r); w.size() > 1 && w.size() <= WordCacheMaxLength) {
+			word = w;
+			shaped = shapeWord(w);
+			kerning = output->source->getKerningAmount(primaryFontId, b, c, faceId);
+		} else {
+			word.clear();
+			shaped = nullptr;
+		}
+
+		if (shaped) {
+			lineX += kerning;
+			faceId = shaped->face;
+			auto ch = shaped->charID;
+			auto charDef = shaped->layout;
+			++ shaped;
+			++ word;
+			if (word.empty()) {
+				shaped = nullptr;
+			}
+			if (!pushChar(ch, charDef)) {
+				return false;
+			}
+		} else {
+			kerning = output->source->getKerningAmount(primaryFontId, b, c, faceId);
+			lineX += kerning;
+			if (!pushChar(c)) {
+				return false;
+			}
 		}
 		startWhitespace = false;
 
@@ -1294,6 +1399,7 @@ void HyphenMap::addHyphenDict(CharGroupId id, FilePath file) {
 	if (!data.empty()) {
 		auto dict = hnj_hyphen_load_data(data.data(), data.size());
 		if (dict) {
+			std::unique_lock<std::shared_mutex> lock(_mutex);
 			auto it = _dicts.find(id);
 			if (it == _dicts.end()) {
 				_dicts.emplace(id, dict);
@@ -1309,6 +1415,7 @@ void HyphenMap::addHyphenDict(CharGroupId id, BytesView data) {
 	if (!data.empty()) {
 		auto dict = hnj_hyphen_load_data((const char *)data.data(), data.size());
 		if (dict) {
+			std::unique_lock<std::shared_mutex> lock(_mutex);
 			auto it = _dicts.find(id);
 			if (it == _dicts.end()) {
 				_dicts.emplace(id, dict);
@@ -1325,6 +1432,8 @@ Vector<uint8_t> HyphenMap::makeWordHyphens(const char16_t *ptr, size_t len) {
 		return Vector<uint8_t>();
 	}
 
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+
 	HyphenDict *dict = nullptr;
 	for (auto &it : _dicts) {
 		if (inCharGroup(it.first, ptr[0])) {
@@ -1366,9 +1475,11 @@ Vector<uint8_t> HyphenMap::makeWordHyphens(const WideStringView &r) {
 	return makeWordHyphens(r.data(), r.size());
 }
 void HyphenMap::purgeHyphenDicts() {
+	std::unique_lock<std::shared_mutex> lock(_mutex);
 	for (auto &it : _dicts) {
 		hnj_hyphen_free(it.second);
 	}
+	_dicts.clear();
 }
 
 String HyphenMap::convertWord(HyphenDict *dict, const char16_t *ptr, size_t len) {
@@ -26,6 +26,8 @@ THE SOFTWARE.
 #include "SLFont.h"
 #include "SLStyle.h"
 
+#include <shared_mutex>
+
 typedef struct _HyphenDict HyphenDict;
 
 NS_LAYOUT_BEGIN
@@ -149,6 +151,8 @@ public:
 	void getLabelRects(Vector<Rect> &, uint32_t first, uint32_t last, float density, const Vec2 & = Vec2(), const Padding &p = Padding()) const;
 };
 
+// Dictionaries can be shared between layout threads (see Builder::setConcurrency),
+// lookups take shared lock, dictionary updates - exclusive one
 class HyphenMap : public Ref {
 public:
 	virtual ~HyphenMap();
@@ -163,6 +167,7 @@ public:
 protected:
 	String convertWord(HyphenDict *, const char16_t *ptr, size_t len);
 
+	mutable std::shared_mutex _mutex;
 	Map<CharGroupId, HyphenDict *> _dicts;
 };
 
@@ -244,6 +249,7 @@ protected:
 	bool readChars(WideStringView &r, const Vector<uint8_t> & = Vector<uint8_t>());
 	void pushLineFiller(bool replaceLastChar = false);
 	bool pushChar(char16_t c);
+	bool pushChar(char16_t c, CharLayout charDef);
 	bool pushSpace(bool wrap = true);
 	bool pushTab();
 	bool pushLine(uint16_t first, uint16_t len, bool forceAlign);
@@ -253,6 +259,28 @@ protected:
 
 	void updateLineHeight(uint16_t first, uint16_t last);
 
+	// Char of shaped word: transformed char, its layout and kerning with previous char of the word
+	struct ShapedChar {
+		char16_t charID = 0;
+		uint16_t face = 0;
+		int16_t kerning = 0;
+		CharLayout layout;
+	};
+
+	struct ShapedWord {
+		FontLayoutId layout;
+		TextTransform transform = TextTransform::None;
+		uint32_t text = 0; // offset in wordCacheText
+		uint32_t chars = 0; // offset in wordCacheChars
+		uint32_t length = 0;
+	};
+
+	// Returns shaped chars for a word (sequence of chars without spaces and breaks) from the
+	// current run font and transform; results are cached, so repeated words are
+	// not queried from font source again. Pointer is valid until next call.
+	const ShapedChar *shapeWord(WideStringView word);
+	void clearWordCache();
+
 	FormatSpec *  output = nullptr;
 	HyphenMap * _hyphens = nullptr;
 
@@ -304,6 +332,14 @@ protected:
 	LinePositionCallback linePositionFunc = nullptr;
 
 	ContentRequest request = ContentRequest::Normal;
+
+	// cached words are valid for single source and its data generation,
+	// source is retained to be compared with new output's source
+	Rc<FormatterSourceInterface> wordCacheSource;
+	uint32_t wordCacheGeneration = 0;
+	std::unordered_map<uint64_t, ShapedWord> wordCache;
+	Vector<char16_t> wordCacheText;
+	Vector<ShapedChar> wordCacheChars;
 };
 
 NS_LAYOUT_END
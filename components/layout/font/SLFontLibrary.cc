@@ -384,9 +384,7 @@ void FreeTypeInterface::requestCharUpdate(const FontSource *source, const Receip
 	}
 }
 
-bool FreeTypeInterface::getKerning(const Vector<FT_Face> &faces, char16_t first, char16_t second, int16_t &value) {
-	auto firstFace = getFaceForChar(faces, first);
-	auto secondFace = getFaceForChar(faces, second);
+static bool getGlyphKerning(const Pair<FT_Face, int> &firstFace, const Pair<FT_Face, int> &secondFace, int16_t &value) {
 	if (firstFace.first && firstFace.first == secondFace.first && FT_HAS_KERNING(firstFace.first)) {
 		const FT_Face face = firstFace.first;
 		const int glyph1 = firstFace.second;
@@ -406,6 +404,10 @@ bool FreeTypeInterface::getKerning(const Vector<FT_Face> &faces, char16_t first,
 	return false;
 }
 
+bool FreeTypeInterface::getKerning(const Vector<FT_Face> &faces, char16_t first, char16_t second, int16_t &value) {
+	return getGlyphKerning(getFaceForChar(faces, first), getFaceForChar(faces, second), value);
+}
+
 bool FontTextureLayout::init(uint32_t i, FontTextureMap &&m) {
 	index = i;
 	map = move(m);
@@ -496,15 +498,31 @@ Rc<FontData> FreeTypeInterface::requestLayoutUpgrade(const FontSource *source, c
 			requestCharUpdate(source, cb, srcs, FontSize(ret->metrics.size), faces, ret->chars, c);
 		}
 
-		// kerning
+		// kerning: resolve face and glyph for every char once, not for every pair
+		Vector<Pair<FT_Face, int>> glyphs; glyphs.reserve(ret->chars.size());
+		for (auto &it : ret->chars) {
+			glyphs.emplace_back(getFaceForChar(faces, it.charID));
+		}
+
 		for (auto &c : charsToUpdate) {
+			auto cIt = std::lower_bound(ret->chars.begin(), ret->chars.end(), c);
+			if (cIt == ret->chars.end() || cIt->charID != c) {
+				continue;
+			}
+
+			auto &cGlyph = glyphs[cIt - ret->chars.begin()];
+			if (!cGlyph.first || !FT_HAS_KERNING(cGlyph.first)) {
+				continue;
+			}
+
 			int16_t kernValue = 0;
-			for (auto &it : ret->chars) {
-				if (getKerning(faces, c, it.charID, kernValue)) {
-					ret->kerning.emplace(c << 16 | (it.charID & 0xffff), kernValue);
+			for (size_t i = 0; i < ret->chars.size(); ++ i) {
+				auto charID = ret->chars[i].charID;
+				if (getGlyphKerning(cGlyph, glyphs[i], kernValue)) {
+					ret->kerning.emplace(c << 16 | (charID & 0xffff), kernValue);
 				}
-				if (getKerning(faces, it.charID, c, kernValue)) {
-					ret->kerning.emplace(it.charID << 16 | (c & 0xffff), kernValue);
+				if (getGlyphKerning(glyphs[i], cGlyph, kernValue)) {
+					ret->kerning.emplace(charID << 16 | (c & 0xffff), kernValue);
 				}
 			}
 		}
@@ -34,6 +34,49 @@ bool FontData::init(const FontData &data) {
 	return true;
 }
 
+static uint32_t hashKerningKey(uint32_t key, uint32_t shift) {
+	// Fibonacci hashing: top bits of key * 2^32/phi
+	return (key * 2654435769U) >> shift;
+}
+
+void FontData::updateTables() {
+	charBlocks.fill(0);
+	charPages.clear();
+	charPages.emplace_back(CharPage());
+
+	for (auto &it : chars) {
+		auto block = it.charID >> 8;
+		if (charBlocks[block] == 0) {
+			charBlocks[block] = uint16_t(charPages.size());
+			charPages.emplace_back(CharPage());
+		}
+		charPages[charBlocks[block]][it.charID & 0xFF] = it;
+	}
+
+	kerningTable.clear();
+	kerningShift = 32;
+	if (kerning.empty()) {
+		return;
+	}
+
+	uint32_t bits = 1;
+	while ((size_t(1) << bits) < kerning.size() * 2) {
+		++ bits;
+	}
+
+	kerningShift = 32 - bits;
+	kerningTable.resize(size_t(1) << bits);
+
+	const uint32_t mask = uint32_t(kerningTable.size() - 1);
+	for (auto &it : kerning) {
+		auto idx = hashKerningKey(it.first, kerningShift);
+		while (kerningTable[idx].key != 0) {
+			idx = (idx + 1) & mask;
+		}
+		kerningTable[idx] = KerningEntry{it.first, it.second};
+	}
+}
+
 uint16_t FontData::getHeight() const {
 	return metrics.height;
 }
@@ -45,6 +88,10 @@ int16_t FontData::getDescender() const {
 }
 
 CharLayout FontData::getChar(char16_t c) const {
+	if (!charPages.empty()) {
+		return charPages[charBlocks[c >> 8]][c & 0xFF];
+	}
+
 	auto it = std::lower_bound(chars.begin(), chars.end(), c);
 	if (it != chars.end() && *it == c) {
 		return *it;
@@ -54,16 +101,29 @@ CharLayout FontData::getChar(char16_t c) const {
 }
 
 uint16_t FontData::xAdvance(char16_t c) const {
-	auto it = std::lower_bound(chars.begin(), chars.end(), c);
-	if (it != chars.end() && *it == c) {
-		return it->xAdvance;
-	} else {
-		return 0;
-	}
+	return getChar(c).xAdvance;
 }
 
 int16_t FontData::kerningAmount(char16_t first, char16_t second) const {
 	uint32_t key = (first << 16) | (second & 0xffff);
+	if (!charPages.empty()) {
+		if (kerningTable.empty()) {
+			return 0;
+		}
+
+		const uint32_t mask = uint32_t(kerningTable.size() - 1);
+		auto idx = hashKerningKey(key, kerningShift);
+		while (true) {
+			auto &entry = kerningTable[idx];
+			if (entry.key == key) {
+				return entry.value;
+			} else if (entry.key == 0) {
+				return 0;
+			}
+			idx = (idx + 1) & mask;
+		}
+	}
+
 	auto it = kerning.find(key);
 	if (it != kerning.end()) {
 		return it->second;
@@ -138,6 +198,11 @@ bool FontLayout::merge(const Vector<char16_t> &chars) {
 		success = true;
 
 		Rc<FontData> newData(_updateCallback(_source, _face.src, data, charsToUpdate, _callback));
+		if (newData && newData != data) {
+			// data is immutable after publication, so tables are built once, out of lock
+			newData->updateTables();
+		}
+
 		std::unique_lock<Mutex> lock(_mutex);
 		if (_data == data) {
 			_data = newData;
@@ -508,9 +573,26 @@ FormatterFontSource::FormatterFontSource(Rc<FontSource> &&s) : _source(move(s))
 
 FontLayoutId FormatterFontSource::getLayout(const FontParameters &f, float scale) {
 	auto l = _source->getLayout(f, scale);
+
+	// layouts are persistent within source, so same id can be reused for every request,
+	// that allows formatter to share cached data between text runs
+	auto lIt = _layoutIds.find(l.get());
+	if (lIt != _layoutIds.end()) {
+		auto dIt = _layouts.find(lIt->second);
+		if (dIt != _layouts.end()) {
+			auto data = l->getData();
+			if (dIt->second.data != data) {
+				dIt->second.data = move(data);
+				++ _generation;
+			}
+			return FontLayoutId(lIt->second);
+		}
+	}
+
 	auto id = _nextId;
 	++ _nextId;
 
+	_layoutIds.emplace(l.get(), id);
 	_layouts.emplace(id, LayoutData{id, l, l->getData()});
 	return FontLayoutId(id);
 }
@@ -523,6 +605,7 @@ void FormatterFontSource::addString(FontLayoutId id, const FontCharString &str)
 
 	if (l->second.layout->addString(str)) {
 		l->second.data = l->second.layout->getData();
+		++ _generation;
 	}
 }
 
@@ -573,4 +656,8 @@ StringView FormatterFontSource::getFontName(FontLayoutId id) {
 	return l->second.layout->getName();
 }
 
+uint32_t FormatterFontSource::getDataGeneration() const {
+	return _generation;
+}
+
 NS_LAYOUT_END
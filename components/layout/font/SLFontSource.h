@@ -43,11 +43,26 @@ struct FontTextureInterface {
  * - basic fonts metric
  * - char layout for formatting
  * - kerning data for formatting
+ *
+ * `chars` and `kerning` are the source of truth, lookups during formatting use
+ * flat tables, built from them with `updateTables` before data is published
+ * (FontLayout does this on merge). Without tables, lookups fall back to `chars` and `kerning`.
  */
 struct FontData final : public Ref {
+	// glyph table page: layouts for 256 consecutive chars of one Unicode block
+	using CharPage = std::array<CharLayout, 256>;
+
+	struct KerningEntry {
+		uint32_t key = 0; // (first << 16) | second, 0 for empty slot
+		int16_t value = 0;
+	};
+
 	bool init();
 	bool init(const FontData &data);
 
+	// rebuild glyph and kerning tables from `chars` and `kerning`
+	void updateTables();
+
 	uint16_t getHeight() const;
 	int16_t getAscender() const;
 	int16_t getDescender() const;
@@ -62,6 +77,15 @@ struct FontData final : public Ref {
 	Metrics metrics;
 	Vector<CharLayout> chars;
 	Map<uint32_t, int16_t> kerning;
+
+	// two-level direct-mapped glyph table: high byte of char selects page, low byte - layout in page;
+	// page 0 is always empty and shared by all blocks without chars
+	std::array<uint16_t, 256> charBlocks = { };
+	Vector<CharPage> charPages;
+
+	// open-addressing kerning table with linear probing, size is power of two, load factor <= 0.5
+	Vector<KerningEntry> kerningTable;
+	uint32_t kerningShift = 32;
 };
 
 /* FontLayout - Copy-on-write wrapper for FontData
@@ -252,6 +276,7 @@ public:
 	virtual Metrics getMetrics(FontLayoutId) override;
 	virtual CharLayout getChar(FontLayoutId, char16_t, uint16_t &) override;
 	virtual StringView getFontName(FontLayoutId) override;
+	virtual uint32_t getDataGeneration() const override;
 
 protected:
 	struct LayoutData {
@@ -261,8 +286,10 @@ protected:
 	};
 
 	uint16_t _nextId = 0;
+	uint32_t _generation = 0;
 	Rc<FontSource> _source;
 	std::unordered_map<uint16_t, LayoutData> _layouts;
+	std::unordered_map<const FontLayout *, uint16_t> _layoutIds;
 };
 
 NS_LAYOUT_END
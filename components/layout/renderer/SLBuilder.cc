@@ -28,6 +28,7 @@ THE SOFTWARE.
 #include "SLNode.h"
 #include "SLResult.h"
 #include "SPString.h"
+#include "SPThreadTaskQueue.h"
 
 //#define SP_RTBUILDER_LOG(...) log::format("RTBuilder", __VA_ARGS__)
 #define SP_RTBUILDER_LOG(...)
@@ -106,6 +107,21 @@ Builder::Builder(Document *doc, const MediaParameters &media, FontSource *cfg, c
 	}
 }
 
+Builder::Builder(const Builder *parent) {
+	_media = parent->_media;
+	_margin = parent->_margin;
+	_document = parent->_document;
+	_fontSet = parent->_fontSet;
+	_externalAssets = parent->_externalAssets;
+	_hyphens = parent->_hyphens;
+	_maxNodeId = _document->getMaxNodeId();
+
+	// result media is not adjusted for print
+	_result = Rc<Result>::create(parent->_result->getMedia(), _fontSet, _document);
+
+	_layoutStack.reserve(4);
+}
+
 Builder::~Builder() { }
 
 void Builder::setExternalAssetsMeta(ExternalAssetsMap &&assets) {
@@ -120,6 +136,14 @@ void Builder::setMargin(const Margin &m) {
 	_margin = m;
 }
 
+void Builder::setConcurrency(uint16_t value) {
+	_concurrency = std::max(value, uint16_t(1));
+}
+
+void Builder::setPartialCallback(PartialCallback &&cb) {
+	_partialCallback = move(cb);
+}
+
 Result *Builder::getResult() const {
 	return _result;
 }
@@ -387,32 +411,28 @@ Layout *Builder::getTopLayout() const {
 	return nullptr;
 }
 
+void Builder::setPageParityDependent() {
+	_pageParity = true;
+}
+
 void Builder::render() {
 	if (_spine.empty()) {
 		_spine = _document->getSpine().vec();
 	}
 
-	auto root = _document->getRoot();
-	setPage(root);
-	_nodeStack.push_back(&root->root);
-	_contextStorage.reserve(8);
-
-	compileStyle(root->root);
-	Layout &l = makeLayout(&root->root, style::Display::Block, false);
-
-	if (_spine.empty() || (_media.flags & RenderFlag::RenderById) == 0) {
-		l.node.block = BlockStyle();
-		l.node.block.width = style::Metric{1.0f, style::Metric::Units::Percent};
-		l.node.block.marginLeft = style::Metric{_margin.left, style::Metric::Units::Px};
-		l.node.block.marginTop = style::Metric{_margin.top, style::Metric::Units::Px};
-		l.node.block.marginBottom = style::Metric{_margin.bottom, style::Metric::Units::Px};
-		l.node.block.marginRight = style::Metric{_margin.right, style::Metric::Units::Px};
-	}
+	Layout &l = makeRootLayout();
 	BackgroundStyle rootBackground = l.node.style->compileBackground(this);
 
-	_nodeStack.pop_back();
+	if (rootBackground.backgroundColor.a != 0) {
+		_result->setBackgroundColor(rootBackground.backgroundColor);
+	} else {
+		_result->setBackgroundColor(_media.defaultBackground);
+	}
 
 	bool pageBreak = (_media.flags & RenderFlag::PaginatedLayout);
+	bool chapters = pageBreak && _spine.size() > 1 && (_media.flags & RenderFlag::RenderById) == 0
+			&& (_concurrency > 1 || _partialCallback);
+
 	FloatContext f{ &l, pageBreak?_media.surfaceSize.height:nan() };
 	_floatStack.push_back(&f);
 	if (l.init(Vec2::ZERO, Size(_media.surfaceSize.width, nan()), 0.0f)) {
@@ -427,6 +447,9 @@ void Builder::render() {
 				setPage(page);
 				processChildNode(l, page->root, pos, height, collapsableMarginTop, pageBreak);
 			}
+		} else if (chapters) {
+			// chapters starts from new page, so, they can be laid out independently
+			renderChapters(l, height);
 		} else {
 			if (_media.flags & RenderFlag::RenderById) {
 				pageBreak = false;
@@ -457,18 +480,174 @@ void Builder::render() {
 
 	_result->setContentSize(l.pos.size + Size(0.0f, 16.0f));
 
-	if (rootBackground.backgroundColor.a != 0) {
-		_result->setBackgroundColor(rootBackground.backgroundColor);
-	} else {
-		_result->setBackgroundColor(_media.defaultBackground);
-	}
-
-	if (!l.layouts.empty()) {
+	if (!l.layouts.empty() || chapters) {
 		addLayoutObjects(l);
 	}
 	_result->finalize();
 }
 
+Layout &Builder::makeRootLayout() {
+	auto root = _document->getRoot();
+	setPage(root);
+	_nodeStack.push_back(&root->root);
+	_contextStorage.reserve(8);
+
+	compileStyle(root->root);
+	Layout &l = makeLayout(&root->root, style::Display::Block, false);
+
+	if (_spine.empty() || (_media.flags & RenderFlag::RenderById) == 0) {
+		l.node.block = BlockStyle();
+		l.node.block.width = style::Metric{1.0f, style::Metric::Units::Percent};
+		l.node.block.marginLeft = style::Metric{_margin.left, style::Metric::Units::Px};
+		l.node.block.marginTop = style::Metric{_margin.top, style::Metric::Units::Px};
+		l.node.block.marginBottom = style::Metric{_margin.bottom, style::Metric::Units::Px};
+		l.node.block.marginRight = style::Metric{_margin.right, style::Metric::Units::Px};
+	}
+
+	_nodeStack.pop_back();
+	return l;
+}
+
+void Builder::renderChapters(Layout &l, float &height) {
+	Vector<Chapter> chapters;
+	chapters.reserve(_spine.size());
+	for (auto &it : _spine) {
+		if (auto page = _document->getContentPage(it)) {
+			chapters.emplace_back(Chapter{page});
+		}
+	}
+
+	if (chapters.empty()) {
+		return;
+	}
+
+	// root node index should precede chapter's indexes, as in addLayoutObjects
+	if (l.node.node && !l.node.node->getHtmlId().empty()) {
+		_result->pushIndex(l.node.node->getHtmlId(), l.pos.position);
+	}
+
+	const float pageHeight = _media.surfaceSize.height;
+
+	size_t next = 0;
+	float nextPos = 0.0f;
+
+	auto merge = [&] () {
+		bool merged = false;
+		while (next < chapters.size() && chapters[next].ready) {
+			auto &it = chapters[next];
+			if (next == 0) {
+				nextPos = it.start;
+			}
+
+			// chapter was laid out with assumed position, it's valid only when it was moved for
+			// whole pages, and for even number of pages, if chapter depends on page parity
+			auto offset = nextPos - it.start;
+			auto pages = std::round(offset / pageHeight);
+			if (std::fabs(offset / pageHeight - pages) > 0.001f || (it.pageParity && int64_t(pages) % 2 != 0)) {
+				it.offset += offset;
+
+				Builder b(this);
+				b.renderChapter(it);
+				offset = nextPos - it.start;
+			}
+
+			_result->merge(it.result, offset);
+			height += it.height;
+			nextPos = it.end + offset;
+
+			it.result = nullptr;
+			merged = true;
+			++ next;
+		}
+		return merged;
+	};
+
+	auto publish = [&] () {
+		if (_partialCallback && next < chapters.size()) {
+			auto res = _result->makePartial(Size(_media.surfaceSize.width, nextPos));
+			_partialCallback(res);
+		}
+	};
+
+	if (_concurrency <= 1) {
+		for (auto &it : chapters) {
+			Builder b(this);
+			b.renderChapter(it);
+			it.ready = true;
+			if (merge()) {
+				publish();
+			}
+		}
+		return;
+	}
+
+	// chapter builders compile styles into their own maps and only read document and parent builder,
+	// shared HyphenMap and FontSource are guarded by their own locks
+	auto queue = Rc<thread::TaskQueue>::alloc("LayoutBuilder");
+	for (auto &it : chapters) {
+		queue->perform(Rc<thread::Task>::create([this, chapter = &it] (const thread::Task &) -> bool {
+			Builder b(this);
+			b.renderChapter(*chapter);
+			return true;
+		}, [chapter = &it] (const thread::Task &, bool) {
+			chapter->ready = true;
+		}));
+	}
+
+	queue->spawnWorkers(thread::TaskQueue::Flags::Waitable, maxOf<uint32_t>(),
+			uint16_t(std::min(size_t(_concurrency), chapters.size())));
+
+	while (next < chapters.size()) {
+		queue->wait(TimeInterval::milliseconds(100));
+		if (merge()) {
+			publish();
+		}
+	}
+
+	queue->cancelWorkers();
+}
+
+void Builder::renderChapter(Chapter &chapter) {
+	Layout &l = makeRootLayout();
+
+	FloatContext f{ &l, _media.surfaceSize.height };
+	_floatStack.push_back(&f);
+	if (l.init(Vec2::ZERO, Size(_media.surfaceSize.width, nan()), 0.0f)) {
+		Vec2 pos = l.pos.position;
+		pos.y += chapter.offset;
+
+		Vec2 start = pos;
+		doPageBreak(nullptr, start);
+
+		float collapsableMarginTop = l.pos.collapsableMarginTop;
+		float height = 0;
+		_layoutStack.push_back(&l);
+		l.node.context = style::Display::Block;
+
+		setPage(chapter.page);
+		processChildNode(l, chapter.page->root, pos, height, collapsableMarginTop, true);
+
+		// next chapter position, same as in processChildNode
+		doPageBreak(l.layouts.empty() ? nullptr : l.layouts.back(), pos);
+		_layoutStack.pop_back();
+
+		for (auto &it : l.layouts) {
+			addLayoutObjects(*it);
+		}
+
+		chapter.start = start.y;
+		chapter.end = pos.y;
+		chapter.height = height;
+	} else {
+		chapter.start = chapter.end = l.pos.position.y + chapter.offset;
+		chapter.height = 0.0f;
+	}
+	_floatStack.pop_back();
+
+	chapter.pageParity = _pageParity;
+	chapter.result = _result;
+}
+
 Pair<float, float> Builder::getFloatBounds(const Layout *l, float y, float height) {
 	float x = 0, width = _media.surfaceSize.width;
 	if (!_layoutStack.empty())  {
@@ -35,6 +35,9 @@ class Builder : public RendererInterface {
 public:
 	using ExternalAssetsMap = Map<String, Document::AssetMeta>;
 
+	// Called on rendering thread with result for leading chapters, that was already laid out
+	using PartialCallback = Function<void(Result *)>;
+
 	static void compileNodeStyle(Style &style, const ContentPage *page, const Node &node,
 			const Vector<const Node *> &stack, const MediaParameters &media, const Vector<bool> &resolved);
 
@@ -45,6 +48,10 @@ public:
 	void setHyphens(HyphenMap *);
 	void setMargin(const Margin &);
 
+	// Max number of threads for paginated layout of the spine, 1 for layout on calling thread
+	void setConcurrency(uint16_t);
+	void setPartialCallback(PartialCallback &&);
+
 	Result *getResult() const;
 
 	const MediaParameters &getMedia() const;
@@ -85,6 +92,9 @@ public:
 	uint16_t getLayoutDepth() const;
 	Layout *getTopLayout() const;
 
+	// layout depends on page number parity (page-break-* is left or right)
+	void setPageParityDependent();
+
 	void render();
 
 	Pair<float, float> getFloatBounds(const Layout *l, float y, float height);
@@ -96,6 +106,25 @@ public:
 	void processChilds(Layout &l, const Node &);
 
 protected:
+	struct Chapter {
+		const ContentPage *page = nullptr;
+		Rc<Result> result;
+		float offset = 0.0f; // vertical offset, chapter was laid out with
+		float start = 0.0f;
+		float end = 0.0f; // start position for the next chapter
+		float height = 0.0f;
+		bool pageParity = false;
+		bool ready = false;
+	};
+
+	// builder for a single chapter, shares document and media with parent
+	Builder(const Builder *parent);
+
+	Layout &makeRootLayout();
+
+	void renderChapters(Layout &l, float &height);
+	void renderChapter(Chapter &);
+
 	const Vector<bool> * resolvePage(const ContentPage *page);
 	void setPage(const ContentPage *);
 
@@ -124,6 +153,10 @@ protected:
 
 	Vector<String> _spine;
 
+	uint16_t _concurrency = 1;
+	PartialCallback _partialCallback;
+	bool _pageParity = false;
+
 	Vector<Layout *> _layoutStack;
 	Vector<FloatContext *> _floatStack;
 	Rc<HyphenMap> _hyphens;
@@ -284,9 +284,11 @@ bool Layout::init(const Vec2 &parentPos, const Size &parentSize, float collapsab
 			pos.padding.top += (curr + 1) * pageHeight - nextPos + 1.0f;
 			collapsableMarginTop = 0;
 		} else if (node.block.pageBreakBefore == style::PageBreak::Left) {
+			builder->setPageParityDependent();
 			uint32_t curr = (uint32_t)std::floor(nextPos / pageHeight);
 			pos.padding.top += (curr + ((curr % 2 == 1)?1:2)) * pageHeight - nextPos + 1.0f;
 		} else if (node.block.pageBreakBefore == style::PageBreak::Right) {
+			builder->setPageParityDependent();
 			uint32_t curr = (uint32_t)std::floor(nextPos / pageHeight);
 			pos.padding.top += (curr + ((curr % 2 == 0)?1:2)) * pageHeight - nextPos + 1.0f;
 		}
@@ -363,11 +365,13 @@ bool Layout::finalize(const Vec2 &parentPos, float collapsableMarginTop) {
 			uint32_t curr = (uint32_t)std::floor((nextPos - pos.margin.bottom) / pageHeight);
 			pos.padding.bottom += (curr + 1) * pageHeight - nextPos + 1.0f;
 		} else if (node.block.pageBreakAfter == style::PageBreak::Left) {
+			builder->setPageParityDependent();
 			auto bbox = getBoundingBox();
 			auto nextPos = bbox.origin.y + bbox.size.height;
 			uint32_t curr = (uint32_t)std::floor((nextPos - pos.margin.bottom) / pageHeight);
 			pos.padding.bottom += (curr + ((curr % 2 == 1)?1:2)) * pageHeight - nextPos + 1.0f;
 		} else if (node.block.pageBreakAfter == style::PageBreak::Right) {
+			builder->setPageParityDependent();
 			auto bbox = getBoundingBox();
 			auto nextPos = bbox.origin.y + bbox.size.height;
 			uint32_t curr = (uint32_t)std::floor((nextPos - pos.margin.bottom) / pageHeight);
@@ -491,7 +495,9 @@ InlineContext &Layout::makeInlineContext(float parentPosY, const Node &n) {
 	context = builder->acquireInlineContext(builder->getFontSet(), density);
 
 	if (request == ContentRequest::Normal) {
-		context->setTargetLabel(builder->getResult()->emplaceLabel(*this));
+		Label *label = builder->getResult()->emplaceLabel(*this);
+		label->format.setSource(Rc<FormatterFontSource>::alloc(builder->getFontSet()));
+		context->setTargetLabel(label);
 	}
 
 	pos.origin = Vec2(roundf(pos.position.x * density), roundf(parentPosY * density));
@@ -24,9 +24,6 @@ THE SOFTWARE.
 **/
 
 #include "SPLayout.h"
-#include "SLFont.cc"
-#include "SLFontFormatter.cc"
-#include "SLFontSource.cc"
 #include "SLFontLibrary.cc"
 #include "SLBuilder.cc"
 #include "SLResultObject.cc"
@@ -97,6 +97,45 @@ void Result::finalize() {
 	}
 }
 
+void Result::merge(Result *part, float offset) {
+	_objects.reserve(_objects.size() + part->_objects.size());
+	for (auto &it : part->_objects) {
+		it->bbox.origin.y += offset;
+		it->index = _objects.size();
+		_objects.push_back(it);
+	}
+
+	for (auto &it : part->_refs) {
+		it->bbox.origin.y += offset;
+		it->index = _refs.size();
+		_refs.push_back(it);
+	}
+
+	for (auto &it : part->_index) {
+		_index.emplace(it.first, Vec2(it.second.x, it.second.y + offset));
+	}
+
+	for (auto &it : part->_strings) {
+		_strings.emplace(it.first, it.second);
+	}
+
+	_parts.emplace_back(part);
+}
+
+Rc<Result> Result::makePartial(const Size &size) {
+	auto ret = Rc<Result>::create(_media, _fontSet, _document);
+	ret->_objects = _objects;
+	ret->_refs = _refs;
+	ret->_index = _index;
+	ret->_strings = _strings;
+	ret->_parts = _parts;
+	ret->_parts.emplace_back(this);
+	ret->_background = _background;
+	ret->setContentSize(size);
+	ret->finalize();
+	return ret;
+}
+
 void Result::setBackgroundColor(const Color4B &c) {
 	_background = c;
 }
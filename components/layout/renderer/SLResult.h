@@ -58,6 +58,13 @@ public:
 	void pushIndex(StringView, const Vec2 &);
 	void finalize();
 
+	// Appends objects from separately rendered part of the document, moved vertically by offset
+	// Part should not be modified after that, it's retained to keep objects memory
+	void merge(Result *, float offset);
+
+	// Creates finalized copy of current state, that shares objects with this result
+	Rc<Result> makePartial(const Size &);
+
 	void setBackgroundColor(const Color4B &c);
 	const Color4B & getBackgroundColor() const;
 
@@ -118,6 +125,7 @@ protected:
 	size_t _numPages = 1;
 
 	Map<CssStringId, String> _strings;
+	Vector<Rc<Result>> _parts;
 };
 
 NS_LAYOUT_END
@@ -25,22 +25,75 @@
 #include "SLSIMD.h"
 
 #include "SLSIMD_SSE.cc"
+#include "SLSIMD_AVX.cc"
 #include "SLSIMD_NEON.cc"
 
 namespace stappler::layout {
 
 #if SL_DEFAULT_SIMD == SL_DEFAULT_SIMD_NEON
-FunctionTable *LayoutFunctionTable = &s_NeonFunctionTable;
+#define SL_DEFAULT_FUNCTION_TABLE s_NeonFunctionTable
 #else
-FunctionTable *LayoutFunctionTable = &s_SseFunctionTable;
+#define SL_DEFAULT_FUNCTION_TABLE s_SseFunctionTable
 #endif
 
+FunctionTable *LayoutFunctionTable = &SL_DEFAULT_FUNCTION_TABLE;
+
+static SimdLevel s_SimdLevel = SimdLevel::Default;
+
 void initialize_simd() {
-#if SL_DEFAULT_SIMD == SL_DEFAULT_SIMD_NEON
-	LayoutFunctionTable = &s_NeonFunctionTable;
-#else
-	LayoutFunctionTable = &s_SseFunctionTable;
+	for (auto level : { SimdLevel::Avx512, SimdLevel::Avx2, SimdLevel::Sse41 }) {
+		if (auto table = get_simd_table(level)) {
+			LayoutFunctionTable = table;
+			s_SimdLevel = level;
+			return;
+		}
+	}
+
+	LayoutFunctionTable = &SL_DEFAULT_FUNCTION_TABLE;
+	s_SimdLevel = SimdLevel::Default;
+}
+
+FunctionTable *get_simd_table(SimdLevel level) {
+#if SL_SIMD_X86_DISPATCH
+	// cpu_supports also checks, that OS saves extended registers state (xgetbv)
+	__builtin_cpu_init();
+#endif
+
+	switch (level) {
+	case SimdLevel::Default:
+		return &SL_DEFAULT_FUNCTION_TABLE;
+#if SL_SIMD_X86_DISPATCH
+	case SimdLevel::Sse41:
+		if (__builtin_cpu_supports("sse4.1")) {
+			return &s_Sse41FunctionTable;
+		}
+		break;
+	case SimdLevel::Avx2:
+		if (__builtin_cpu_supports("avx2")) {
+			return &s_Avx2FunctionTable;
+		}
+		break;
+	case SimdLevel::Avx512:
+		if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+			return &s_Avx512FunctionTable;
+		}
+		break;
 #endif
+	default:
+		break;
+	}
+	return nullptr;
 }
 
+SimdLevel get_simd_level() {
+	return s_SimdLevel;
+}
+
+// other static initializers can run before this one, they will use default table
+static struct SimdInitializer {
+	SimdInitializer() {
+		initialize_simd();
+	}
+} s_SimdInitializer;
+
 }
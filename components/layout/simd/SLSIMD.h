@@ -57,22 +57,57 @@
 #endif
 
 
+// x86 builds can carry code for extended instruction sets (via target attributes)
+// and select it in runtime, so one binary can be used on any x86-64 host
+#if (__x86_64__ || __i386__) && (__GNUC__ || __clang__)
+#define SL_SIMD_X86_DISPATCH 1
+#else
+#define SL_SIMD_X86_DISPATCH 0
+#endif
+
+
 namespace stappler::layout {
 
 class Vec4;
+class Mat4;
+struct Color4B;
+struct Color4F;
 
 struct FunctionTable {
 	void (*multiplyVec4) (const Vec4 &, const Vec4 &, Vec4 &);
 	void (*divideVec4) (const Vec4 &, const Vec4 &, Vec4 &);
+
+	// dst can be the same object as one of arguments
+	void (*multiplyMat4) (const Mat4 &, const Mat4 &, Mat4 &);
+	void (*transformVec4) (const Mat4 &, const Vec4 &, Vec4 &);
+
+	// transforms array of 2d points (x, y pairs) as (x, y, 0, 1), without perspective division
+	// src and dst can be the same array
+	void (*transformPoints) (const Mat4 &, const float *src, float *dst, size_t count);
+
+	// dst = a * (1 - p) + b * p, results are the same as with Color4B::progress and Color4F::progress
+	void (*progressColor4B) (const Color4B *a, const Color4B *b, Color4B *dst, size_t count, float p);
+	void (*progressColor4F) (const Color4F *a, const Color4F *b, Color4F *dst, size_t count, float p);
+};
+
+enum class SimdLevel {
+	Default, // compile-time selection (simde-based SSE2 or NEON)
+	Sse41,
+	Avx2,
+	Avx512,
 };
 
 extern FunctionTable *LayoutFunctionTable;
 
-// in future, this will load more optimal LayoutFunctionTable based on cpuid
-// instead of default compile-time selection (simde-based)
-// noop for now
+// selects most optimal LayoutFunctionTable for the current CPU (with cpuid)
+// called automatically on library load, before that, default table is used
 void initialize_simd();
 
+// returns nullptr, if level is not supported by current CPU
+FunctionTable *get_simd_table(SimdLevel);
+
+SimdLevel get_simd_level();
+
 }
 
 #endif /* COMPONENTS_LAYOUT_SIMD_SLSIMD_H_ */
@@ -0,0 +1,214 @@
+/**
+ Copyright (c) 2023 Roman Katuntsev <sbkarr@stappler.org>
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ **/
+
+
+#include "SLSIMD.h"
+
+#if SL_SIMD_X86_DISPATCH
+
+#include <immintrin.h>
+
+// AVX2 and AVX-512 kernels are compiled with target attributes and used only if
+// initialize_simd() detects support for them; tails are processed with narrower kernels
+
+namespace stappler::layout {
+
+__attribute__((target("avx2")))
+static inline __m256 multiplyMat4_AVX2_impl(__m256 c0, __m256 c1, __m256 c2, __m256 c3, __m256 v) {
+	return _mm256_add_ps(
+		_mm256_add_ps(
+			_mm256_mul_ps(c0, _mm256_permute_ps(v, _MM_SHUFFLE(0, 0, 0, 0))),
+			_mm256_mul_ps(c1, _mm256_permute_ps(v, _MM_SHUFFLE(1, 1, 1, 1)))),
+		_mm256_add_ps(
+			_mm256_mul_ps(c2, _mm256_permute_ps(v, _MM_SHUFFLE(2, 2, 2, 2))),
+			_mm256_mul_ps(c3, _mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3)))));
+}
+
+__attribute__((target("avx2")))
+static void multiplyMat4_AVX2 (const Mat4 &m1, const Mat4 &m2, Mat4 &dst) {
+	// two columns of m2 per register, columns of m1 are duplicated in both lanes
+	const __m256 c0 = _mm256_broadcast_ps((const __m128 *)&m1.m[0]);
+	const __m256 c1 = _mm256_broadcast_ps((const __m128 *)&m1.m[4]);
+	const __m256 c2 = _mm256_broadcast_ps((const __m128 *)&m1.m[8]);
+	const __m256 c3 = _mm256_broadcast_ps((const __m128 *)&m1.m[12]);
+
+	const __m256 dst01 = multiplyMat4_AVX2_impl(c0, c1, c2, c3, _mm256_loadu_ps(&m2.m[0]));
+	const __m256 dst23 = multiplyMat4_AVX2_impl(c0, c1, c2, c3, _mm256_loadu_ps(&m2.m[8]));
+
+	_mm256_storeu_ps(&dst.m[0], dst01);
+	_mm256_storeu_ps(&dst.m[8], dst23);
+}
+
+__attribute__((target("avx2")))
+static void transformPoints_AVX2 (const Mat4 &m, const float *src, float *dst, size_t count) {
+	const __m256 cx = _mm256_setr_ps(m.m[0], m.m[1], m.m[0], m.m[1], m.m[0], m.m[1], m.m[0], m.m[1]);
+	const __m256 cy = _mm256_setr_ps(m.m[4], m.m[5], m.m[4], m.m[5], m.m[4], m.m[5], m.m[4], m.m[5]);
+	const __m256 ct = _mm256_setr_ps(m.m[12], m.m[13], m.m[12], m.m[13], m.m[12], m.m[13], m.m[12], m.m[13]);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const __m256 v = _mm256_loadu_ps(src + i * 2);
+		const __m256 x = _mm256_permute_ps(v, _MM_SHUFFLE(2, 2, 0, 0));
+		const __m256 y = _mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 1, 1));
+		_mm256_storeu_ps(dst + i * 2, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, cx), _mm256_mul_ps(y, cy)), ct));
+	}
+
+	transformPoints_SSE(m, src + i * 2, dst + i * 2, count - i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i progressColor4B_AVX2_impl(__m128i a, __m128i b, __m256i pa, __m256i pb) {
+	const __m256i v = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_cvtepu8_epi16(a), pa), _mm256_mullo_epi16(_mm256_cvtepu8_epi16(b), pb));
+	return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(v, _mm256_set1_epi16(1)), _mm256_srli_epi16(v, 8)), 8);
+}
+
+__attribute__((target("avx2")))
+static void progressColor4B_AVX2 (const Color4B *a, const Color4B *b, Color4B *dst, size_t count, float p) {
+	const uint8_t ip = uint8_t(p * 255.0f);
+	const __m256i pa = _mm256_set1_epi16(255 - ip);
+	const __m256i pb = _mm256_set1_epi16(ip);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m128i *va = (const __m128i *)(a + i);
+		const __m128i *vb = (const __m128i *)(b + i);
+		const __m256i lo = progressColor4B_AVX2_impl(_mm_loadu_si128(va), _mm_loadu_si128(vb), pa, pb);
+		const __m256i hi = progressColor4B_AVX2_impl(_mm_loadu_si128(va + 1), _mm_loadu_si128(vb + 1), pa, pb);
+
+		// packus works within 128-bit lanes, so 64-bit parts should be reordered
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+
+	progressColor4B_SSE(a + i, b + i, dst + i, count - i, p);
+}
+
+__attribute__((target("avx2")))
+static void progressColor4F_AVX2 (const Color4F *a, const Color4F *b, Color4F *dst, size_t count, float p) {
+	const __m256 pa = _mm256_set1_ps(1.0f - p);
+	const __m256 pb = _mm256_set1_ps(p);
+
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		_mm256_storeu_ps(&dst[i].r,
+			_mm256_add_ps(
+				_mm256_mul_ps(_mm256_loadu_ps(&a[i].r), pa),
+				_mm256_mul_ps(_mm256_loadu_ps(&b[i].r), pb)));
+	}
+
+	progressColor4F_SSE(a + i, b + i, dst + i, count - i, p);
+}
+
+__attribute__((target("avx512f")))
+static void multiplyMat4_AVX512 (const Mat4 &m1, const Mat4 &m2, Mat4 &dst) {
+	// whole m2 in one register, columns of m1 are duplicated in all lanes
+	const __m512 c0 = _mm512_broadcast_f32x4(_mm_load_ps(&m1.m[0]));
+	const __m512 c1 = _mm512_broadcast_f32x4(_mm_load_ps(&m1.m[4]));
+	const __m512 c2 = _mm512_broadcast_f32x4(_mm_load_ps(&m1.m[8]));
+	const __m512 c3 = _mm512_broadcast_f32x4(_mm_load_ps(&m1.m[12]));
+	const __m512 v = _mm512_loadu_ps(&m2.m[0]);
+
+	_mm512_storeu_ps(&dst.m[0], _mm512_add_ps(
+		_mm512_add_ps(
+			_mm512_mul_ps(c0, _mm512_permute_ps(v, _MM_SHUFFLE(0, 0, 0, 0))),
+			_mm512_mul_ps(c1, _mm512_permute_ps(v, _MM_SHUFFLE(1, 1, 1, 1)))),
+		_mm512_add_ps(
+			_mm512_mul_ps(c2, _mm512_permute_ps(v, _MM_SHUFFLE(2, 2, 2, 2))),
+			_mm512_mul_ps(c3, _mm512_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3))))));
+}
+
+__attribute__((target("avx512f")))
+static void transformPoints_AVX512 (const Mat4 &m, const float *src, float *dst, size_t count) {
+	const __m512 cx = _mm512_broadcast_f32x4(_mm_setr_ps(m.m[0], m.m[1], m.m[0], m.m[1]));
+	const __m512 cy = _mm512_broadcast_f32x4(_mm_setr_ps(m.m[4], m.m[5], m.m[4], m.m[5]));
+	const __m512 ct = _mm512_broadcast_f32x4(_mm_setr_ps(m.m[12], m.m[13], m.m[12], m.m[13]));
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m512 v = _mm512_loadu_ps(src + i * 2);
+		const __m512 x = _mm512_permute_ps(v, _MM_SHUFFLE(2, 2, 0, 0));
+		const __m512 y = _mm512_permute_ps(v, _MM_SHUFFLE(3, 3, 1, 1));
+		_mm512_storeu_ps(dst + i * 2, _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(x, cx), _mm512_mul_ps(y, cy)), ct));
+	}
+
+	transformPoints_AVX2(m, src + i * 2, dst + i * 2, count - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline __m256i progressColor4B_AVX512_impl(__m256i a, __m256i b, __m512i pa, __m512i pb) {
+	const __m512i v = _mm512_add_epi16(_mm512_mullo_epi16(_mm512_cvtepu8_epi16(a), pa), _mm512_mullo_epi16(_mm512_cvtepu8_epi16(b), pb));
+	return _mm512_cvtepi16_epi8(_mm512_srli_epi16(_mm512_add_epi16(_mm512_add_epi16(v, _mm512_set1_epi16(1)), _mm512_srli_epi16(v, 8)), 8));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void progressColor4B_AVX512 (const Color4B *a, const Color4B *b, Color4B *dst, size_t count, float p) {
+	const uint8_t ip = uint8_t(p * 255.0f);
+	const __m512i pa = _mm512_set1_epi16(255 - ip);
+	const __m512i pb = _mm512_set1_epi16(ip);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		_mm256_storeu_si256((__m256i *)(dst + i), progressColor4B_AVX512_impl(
+			_mm256_loadu_si256((const __m256i *)(a + i)), _mm256_loadu_si256((const __m256i *)(b + i)), pa, pb));
+	}
+
+	progressColor4B_SSE(a + i, b + i, dst + i, count - i, p);
+}
+
+__attribute__((target("avx512f")))
+static void progressColor4F_AVX512 (const Color4F *a, const Color4F *b, Color4F *dst, size_t count, float p) {
+	const __m512 pa = _mm512_set1_ps(1.0f - p);
+	const __m512 pb = _mm512_set1_ps(p);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		_mm512_storeu_ps(&dst[i].r,
+			_mm512_add_ps(
+				_mm512_mul_ps(_mm512_loadu_ps(&a[i].r), pa),
+				_mm512_mul_ps(_mm512_loadu_ps(&b[i].r), pb)));
+	}
+
+	progressColor4F_AVX2(a + i, b + i, dst + i, count - i, p);
+}
+
+[[maybe_unused]] static FunctionTable s_Avx2FunctionTable = {
+	multiplyVec4_SSE,
+	divideVec4_SSE,
+	multiplyMat4_AVX2,
+	transformVec4_SSE,
+	transformPoints_AVX2,
+	progressColor4B_AVX2,
+	progressColor4F_AVX2
+};
+
+[[maybe_unused]] static FunctionTable s_Avx512FunctionTable = {
+	multiplyVec4_SSE,
+	divideVec4_SSE,
+	multiplyMat4_AVX512,
+	transformVec4_SSE,
+	transformPoints_AVX512,
+	progressColor4B_AVX512,
+	progressColor4F_AVX512
+};
+
+}
+
+#endif
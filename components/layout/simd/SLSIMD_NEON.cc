@@ -44,9 +44,73 @@ static void divideVec4_NEON (const Vec4 &a, const Vec4 &b, Vec4 &dst) {
 #endif
 }
 
+static inline simde_float32x4_t transformVec4_NEON_impl(simde_float32x4_t c0, simde_float32x4_t c1,
+		simde_float32x4_t c2, simde_float32x4_t c3, simde_float32x4_t v) {
+	return simde_vaddq_f32(
+		simde_vaddq_f32(
+			simde_vmulq_laneq_f32(c0, v, 0),
+			simde_vmulq_laneq_f32(c1, v, 1)),
+		simde_vaddq_f32(
+			simde_vmulq_laneq_f32(c2, v, 2),
+			simde_vmulq_laneq_f32(c3, v, 3)));
+}
+
+static void multiplyMat4_NEON (const Mat4 &m1, const Mat4 &m2, Mat4 &dst) {
+	const simde_float32x4_t c0 = simde_vld1q_f32(&m1.m[0]);
+	const simde_float32x4_t c1 = simde_vld1q_f32(&m1.m[4]);
+	const simde_float32x4_t c2 = simde_vld1q_f32(&m1.m[8]);
+	const simde_float32x4_t c3 = simde_vld1q_f32(&m1.m[12]);
+
+	const simde_float32x4_t dst0 = transformVec4_NEON_impl(c0, c1, c2, c3, simde_vld1q_f32(&m2.m[0]));
+	const simde_float32x4_t dst1 = transformVec4_NEON_impl(c0, c1, c2, c3, simde_vld1q_f32(&m2.m[4]));
+	const simde_float32x4_t dst2 = transformVec4_NEON_impl(c0, c1, c2, c3, simde_vld1q_f32(&m2.m[8]));
+	const simde_float32x4_t dst3 = transformVec4_NEON_impl(c0, c1, c2, c3, simde_vld1q_f32(&m2.m[12]));
+
+	simde_vst1q_f32(&dst.m[0], dst0);
+	simde_vst1q_f32(&dst.m[4], dst1);
+	simde_vst1q_f32(&dst.m[8], dst2);
+	simde_vst1q_f32(&dst.m[12], dst3);
+}
+
+static void transformVec4_NEON (const Mat4 &m, const Vec4 &v, Vec4 &dst) {
+	simde_vst1q_f32(&dst.x, transformVec4_NEON_impl(
+		simde_vld1q_f32(&m.m[0]), simde_vld1q_f32(&m.m[4]), simde_vld1q_f32(&m.m[8]), simde_vld1q_f32(&m.m[12]),
+		simde_vld1q_f32(&v.x)));
+}
+
+static void transformPoints_NEON (const Mat4 &m, const float *src, float *dst, size_t count) {
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		// deinterleaved load: val[0] - x, val[1] - y
+		simde_float32x4x2_t v = simde_vld2q_f32(src + i * 2);
+		simde_float32x4x2_t ret;
+		ret.val[0] = simde_vaddq_f32(simde_vaddq_f32(
+				simde_vmulq_n_f32(v.val[0], m.m[0]), simde_vmulq_n_f32(v.val[1], m.m[4])), simde_vdupq_n_f32(m.m[12]));
+		ret.val[1] = simde_vaddq_f32(simde_vaddq_f32(
+				simde_vmulq_n_f32(v.val[0], m.m[1]), simde_vmulq_n_f32(v.val[1], m.m[5])), simde_vdupq_n_f32(m.m[13]));
+		simde_vst2q_f32(dst + i * 2, ret);
+	}
+
+	transformPoints_C(m, src + i * 2, dst + i * 2, count - i);
+}
+
+static void progressColor4F_NEON (const Color4F *a, const Color4F *b, Color4F *dst, size_t count, float p) {
+	for (size_t i = 0; i < count; ++ i) {
+		simde_vst1q_f32(&dst[i].r,
+			simde_vaddq_f32(
+				simde_vmulq_n_f32(simde_vld1q_f32(&a[i].r), 1.0f - p),
+				simde_vmulq_n_f32(simde_vld1q_f32(&b[i].r), p)));
+	}
+}
+
 [[maybe_unused]] static FunctionTable s_NeonFunctionTable = {
 	multiplyVec4_NEON,
-	divideVec4_NEON
+	divideVec4_NEON,
+	multiplyMat4_NEON,
+	transformVec4_NEON,
+	transformPoints_NEON,
+	progressColor4B_SSE, // simde-based SSE2 integer code is mapped to NEON well enough
+	progressColor4F_NEON
 };
 
 }
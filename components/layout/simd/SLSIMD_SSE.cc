@@ -22,6 +22,11 @@
 
 #include "SLSIMD.h"
 #include "simde/x86/sse.h"
+#include "simde/x86/sse2.h"
+
+#if SL_SIMD_X86_DISPATCH
+#include <smmintrin.h>
+#endif
 
 #if __SSE__
 #define SL_SSE_STORE_VEC4(vec, value)	vec.v = (value)
@@ -47,9 +52,151 @@ static void divideVec4_SSE (const Vec4 &a, const Vec4 &b, Vec4 &dst) {
 				SL_SSE_LOAD_VEC4(b)));
 }
 
+static inline simde__m128 transformVec4_SSE_impl(simde__m128 c0, simde__m128 c1, simde__m128 c2, simde__m128 c3, simde__m128 v) {
+	return simde_mm_add_ps(
+		simde_mm_add_ps(
+			simde_mm_mul_ps(c0, simde_mm_shuffle_ps(v, v, SIMDE_MM_SHUFFLE(0, 0, 0, 0))),
+			simde_mm_mul_ps(c1, simde_mm_shuffle_ps(v, v, SIMDE_MM_SHUFFLE(1, 1, 1, 1)))),
+		simde_mm_add_ps(
+			simde_mm_mul_ps(c2, simde_mm_shuffle_ps(v, v, SIMDE_MM_SHUFFLE(2, 2, 2, 2))),
+			simde_mm_mul_ps(c3, simde_mm_shuffle_ps(v, v, SIMDE_MM_SHUFFLE(3, 3, 3, 3)))));
+}
+
+static void multiplyMat4_SSE (const Mat4 &m1, const Mat4 &m2, Mat4 &dst) {
+	const simde__m128 c0 = simde_mm_load_ps(&m1.m[0]);
+	const simde__m128 c1 = simde_mm_load_ps(&m1.m[4]);
+	const simde__m128 c2 = simde_mm_load_ps(&m1.m[8]);
+	const simde__m128 c3 = simde_mm_load_ps(&m1.m[12]);
+
+	const simde__m128 dst0 = transformVec4_SSE_impl(c0, c1, c2, c3, simde_mm_load_ps(&m2.m[0]));
+	const simde__m128 dst1 = transformVec4_SSE_impl(c0, c1, c2, c3, simde_mm_load_ps(&m2.m[4]));
+	const simde__m128 dst2 = transformVec4_SSE_impl(c0, c1, c2, c3, simde_mm_load_ps(&m2.m[8]));
+	const simde__m128 dst3 = transformVec4_SSE_impl(c0, c1, c2, c3, simde_mm_load_ps(&m2.m[12]));
+
+	simde_mm_store_ps(&dst.m[0], dst0);
+	simde_mm_store_ps(&dst.m[4], dst1);
+	simde_mm_store_ps(&dst.m[8], dst2);
+	simde_mm_store_ps(&dst.m[12], dst3);
+}
+
+static void transformVec4_SSE (const Mat4 &m, const Vec4 &v, Vec4 &dst) {
+	SL_SSE_STORE_VEC4(dst, transformVec4_SSE_impl(
+		simde_mm_load_ps(&m.m[0]), simde_mm_load_ps(&m.m[4]), simde_mm_load_ps(&m.m[8]), simde_mm_load_ps(&m.m[12]),
+		SL_SSE_LOAD_VEC4(v)));
+}
+
+static void transformPoints_C (const Mat4 &m, const float *src, float *dst, size_t count) {
+	for (size_t i = 0; i < count; ++ i) {
+		const float x = src[i * 2];
+		const float y = src[i * 2 + 1];
+		dst[i * 2] = x * m.m[0] + y * m.m[4] + m.m[12];
+		dst[i * 2 + 1] = x * m.m[1] + y * m.m[5] + m.m[13];
+	}
+}
+
+static void transformPoints_SSE (const Mat4 &m, const float *src, float *dst, size_t count) {
+	// two points per register: (x0, y0, x1, y1)
+	const simde__m128 cx = simde_mm_setr_ps(m.m[0], m.m[1], m.m[0], m.m[1]);
+	const simde__m128 cy = simde_mm_setr_ps(m.m[4], m.m[5], m.m[4], m.m[5]);
+	const simde__m128 ct = simde_mm_setr_ps(m.m[12], m.m[13], m.m[12], m.m[13]);
+
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		const simde__m128 v = simde_mm_loadu_ps(src + i * 2);
+		const simde__m128 x = simde_mm_shuffle_ps(v, v, SIMDE_MM_SHUFFLE(2, 2, 0, 0));
+		const simde__m128 y = simde_mm_shuffle_ps(v, v, SIMDE_MM_SHUFFLE(3, 3, 1, 1));
+		simde_mm_storeu_ps(dst + i * 2, simde_mm_add_ps(simde_mm_add_ps(simde_mm_mul_ps(x, cx), simde_mm_mul_ps(y, cy)), ct));
+	}
+
+	transformPoints_C(m, src + i * 2, dst + i * 2, count - i);
+}
+
+// (a * (255 - p) + b * p) / 255 for 8 uint16_t channels; for x in [0, 255 * 255] x / 255 == (x + 1 + (x >> 8)) >> 8
+static inline simde__m128i progressColor4B_SSE_impl(simde__m128i a, simde__m128i b, simde__m128i pa, simde__m128i pb) {
+	const simde__m128i v = simde_mm_add_epi16(simde_mm_mullo_epi16(a, pa), simde_mm_mullo_epi16(b, pb));
+	return simde_mm_srli_epi16(simde_mm_add_epi16(simde_mm_add_epi16(v, simde_mm_set1_epi16(1)), simde_mm_srli_epi16(v, 8)), 8);
+}
+
+static void progressColor4B_SSE (const Color4B *a, const Color4B *b, Color4B *dst, size_t count, float p) {
+	const uint8_t ip = uint8_t(p * 255.0f);
+	const simde__m128i zero = simde_mm_setzero_si128();
+	const simde__m128i pa = simde_mm_set1_epi16(255 - ip);
+	const simde__m128i pb = simde_mm_set1_epi16(ip);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const simde__m128i va = simde_mm_loadu_si128((const simde__m128i *)(a + i));
+		const simde__m128i vb = simde_mm_loadu_si128((const simde__m128i *)(b + i));
+		const simde__m128i lo = progressColor4B_SSE_impl(simde_mm_unpacklo_epi8(va, zero), simde_mm_unpacklo_epi8(vb, zero), pa, pb);
+		const simde__m128i hi = progressColor4B_SSE_impl(simde_mm_unpackhi_epi8(va, zero), simde_mm_unpackhi_epi8(vb, zero), pa, pb);
+		simde_mm_storeu_si128((simde__m128i *)(dst + i), simde_mm_packus_epi16(lo, hi));
+	}
+
+	for (; i < count; ++ i) {
+		dst[i] = Color4B::progress(a[i], b[i], p);
+	}
+}
+
+static void progressColor4F_SSE (const Color4F *a, const Color4F *b, Color4F *dst, size_t count, float p) {
+	const simde__m128 pa = simde_mm_set1_ps(1.0f - p);
+	const simde__m128 pb = simde_mm_set1_ps(p);
+
+	for (size_t i = 0; i < count; ++ i) {
+		simde_mm_store_ps(&dst[i].r,
+			simde_mm_add_ps(
+				simde_mm_mul_ps(simde_mm_load_ps(&a[i].r), pa),
+				simde_mm_mul_ps(simde_mm_load_ps(&b[i].r), pb)));
+	}
+}
+
 [[maybe_unused]] static FunctionTable s_SseFunctionTable = {
 	multiplyVec4_SSE,
-	divideVec4_SSE
+	divideVec4_SSE,
+	multiplyMat4_SSE,
+	transformVec4_SSE,
+	transformPoints_SSE,
+	progressColor4B_SSE,
+	progressColor4F_SSE
 };
 
+#if SL_SIMD_X86_DISPATCH
+
+// SSE4.1 only adds zero-extension for byte channels, float kernels are the same as SSE2
+
+__attribute__((target("sse4.1")))
+static inline __m128i progressColor4B_SSE41_impl(__m128i a, __m128i b, __m128i pa, __m128i pb) {
+	const __m128i v = _mm_add_epi16(_mm_mullo_epi16(_mm_cvtepu8_epi16(a), pa), _mm_mullo_epi16(_mm_cvtepu8_epi16(b), pb));
+	return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(v, _mm_set1_epi16(1)), _mm_srli_epi16(v, 8)), 8);
+}
+
+__attribute__((target("sse4.1")))
+static void progressColor4B_SSE41 (const Color4B *a, const Color4B *b, Color4B *dst, size_t count, float p) {
+	const uint8_t ip = uint8_t(p * 255.0f);
+	const __m128i pa = _mm_set1_epi16(255 - ip);
+	const __m128i pb = _mm_set1_epi16(ip);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+		const __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+		const __m128i lo = progressColor4B_SSE41_impl(va, vb, pa, pb);
+		const __m128i hi = progressColor4B_SSE41_impl(_mm_srli_si128(va, 8), _mm_srli_si128(vb, 8), pa, pb);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+	}
+
+	progressColor4B_SSE(a + i, b + i, dst + i, count - i, p);
+}
+
+[[maybe_unused]] static FunctionTable s_Sse41FunctionTable = {
+	multiplyVec4_SSE,
+	divideVec4_SSE,
+	multiplyMat4_SSE,
+	transformVec4_SSE,
+	transformPoints_SSE,
+	progressColor4B_SSE41,
+	progressColor4F_SSE
+};
+
+#endif
+
 }
@@ -991,6 +991,10 @@ Color4B Color4B::progress(const Color4B &a, const Color4B &b, float fp) {
 	);
 }
 
+void Color4B::progress(const Color4B *a, const Color4B *b, Color4B *dst, size_t count, float p) {
+	LayoutFunctionTable->progressColor4B(a, b, dst, count, p);
+}
+
 
 Color4F::Color4F() : r(0.0f), g(0.0f), b(0.0f), a(0.0f) { }
 Color4F::Color4F(float _r, float _g, float _b, float _a) : r(_r), g(_g), b(_b), a(_a) { }
@@ -1045,6 +1049,10 @@ Color4F Color4F::progress(const Color4F &a, const Color4F &b, float p) {
 	);
 }
 
+void Color4F::progress(const Color4F *a, const Color4F *b, Color4F *dst, size_t count, float p) {
+	LayoutFunctionTable->progressColor4F(a, b, dst, count, p);
+}
+
 const Color3B Color3B::WHITE(255, 255, 255);
 const Color3B Color3B::BLACK(0, 0, 0);
 
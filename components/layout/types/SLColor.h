@@ -105,6 +105,9 @@ struct Color4B : public AllocBase {
 	static const Color4B BLACK;
 
 	static Color4B progress(const Color4B &a, const Color4B &b, float p);
+
+	// batch version, uses SIMD function table, dst can be the same array as a or b
+	static void progress(const Color4B *a, const Color4B *b, Color4B *dst, size_t count, float p);
 };
 
 /**
@@ -142,6 +145,9 @@ struct alignas(16) Color4F : public AllocBase {
 	static const Color4F BLACK;
 
 	static Color4F progress(const Color4F &a, const Color4F &b, float p);
+
+	// batch version, uses SIMD function table, dst can be the same array as a or b
+	static void progress(const Color4F *a, const Color4F *b, Color4F *dst, size_t count, float p);
 };
 
 class Color : public AllocBase {
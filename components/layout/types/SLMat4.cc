@@ -26,6 +26,7 @@
 #include "SLMat4.h"
 #include "SLMathUtil.h"
 #include "SLQuaternion.h"
+#include "SLSIMD.h"
 
 NS_LAYOUT_BEGIN
 
@@ -715,11 +716,7 @@ void Mat4::multiply(const Mat4& mat)
 void Mat4::multiply(const Mat4& m1, const Mat4& m2, Mat4* dst)
 {
     assert(dst);
-#ifdef __SSE__
-    MathUtil::multiplyMatrix(m1.col, m2.col, dst->col);
-#else
-    MathUtil::multiplyMatrix(m1.m, m2.m, dst->m);
-#endif
+    LayoutFunctionTable->multiplyMat4(m1, m2, *dst);
 }
 
 void Mat4::negate()
@@ -919,6 +916,12 @@ Vec2 Mat4::transformPoint(const Vec2& point) const {
     return Vec2(ret.x, ret.y);
 }
 
+void Mat4::transformPoints(const Vec2* src, Vec2* dst, size_t count) const
+{
+    static_assert(sizeof(Vec2) == sizeof(float) * 2, "Vec2 should be packed as array of floats");
+    LayoutFunctionTable->transformPoints(*this, (const float *)src, (float *)dst, count);
+}
+
 void Mat4::transformVector(const Vec3& vector, Vec3* dst) const
 {
     transformVector(vector.x, vector.y, vector.z, 0.0f, dst);
@@ -940,11 +943,7 @@ void Mat4::transformVector(Vec4* vector) const
 void Mat4::transformVector(const Vec4& vector, Vec4* dst) const
 {
     assert(dst);
-#ifdef __SSE__
-    MathUtil::transformVec4(col, vector.v, dst->v);
-#else
-    MathUtil::transformVec4(m, (const float*) &vector, (float*)dst);
-#endif
+    LayoutFunctionTable->transformVec4(*this, vector, *dst);
 }
 
 void Mat4::translate(float x, float y, float z)
@@ -789,6 +789,16 @@ public:
      */
     Vec2 transformPoint(const Vec2& point) const;
 
+    /**
+     * Transforms array of 2d points (as (x, y, 0, 1), without perspective division)
+     * by this matrix, and stores results in dst.
+     *
+     * @param src Points to transform.
+     * @param dst An array to store the transformed points in (can be the same as src).
+     * @param count Number of points.
+     */
+    void transformPoints(const Vec2* src, Vec2* dst, size_t count) const;
+
     /**
      * Transforms the specified vector by this matrix by
      * treating the fourth (w) coordinate as zero.
@@ -52,6 +52,18 @@ static inline float canvas_dist_sq(float x1, float y1, float x2, float y2) {
 	return dx * dx + dy * dy;
 }
 
+// transform is a rotation with translation in XY plane and keeps Z = 0, W = 1 for points on it;
+// reflections (negative determinant) are excluded, because they reverse contour orientation
+static inline bool canvas_is_rigid_2d(const Mat4 &t) {
+	const float e = 1e-5f;
+	return std::abs(t.m[2]) < e && std::abs(t.m[3]) < e && std::abs(t.m[6]) < e && std::abs(t.m[7]) < e
+		&& std::abs(t.m[14]) < e && std::abs(t.m[15] - 1.0f) < e
+		&& std::abs(t.m[0] * t.m[0] + t.m[1] * t.m[1] - 1.0f) < e
+		&& std::abs(t.m[4] * t.m[4] + t.m[5] * t.m[5] - 1.0f) < e
+		&& std::abs(t.m[0] * t.m[4] + t.m[1] * t.m[5]) < e
+		&& t.m[0] * t.m[5] - t.m[1] * t.m[4] > 0.0f;
+}
+
 Canvas::Canvas() : _pool(memory::pool::createTagged(nullptr, "layout::Canvas")), _tess(_pool), _stroke(_pool), _line(_pool) {
 	memset(&_tessAlloc, 0, sizeof(_tessAlloc));
 	_tessAlloc.memalloc = &staticPoolAlloc;
@@ -172,12 +184,21 @@ void Canvas::draw(const Path &path, float tx, float ty) {
 }
 
 void Canvas::tryBatchPath() {
+	_hasPathTransform = false;
 	if (_isBatch) {
 		if (_batchTransform.isIdentity()) {
 			_batchTransform = _transform;
 		} else if (_batchTransform != _transform) {
-			flushBatch();
-			_batchTransform = _transform;
+			// rigid transform does not change curve approximation or stroke geometry,
+			// so contours can be moved into batch space without flushing a batch
+			auto t = _batchTransform.getInversed() * _transform;
+			if (canvas_is_rigid_2d(t)) {
+				_pathTransform = t;
+				_hasPathTransform = true;
+			} else {
+				flushBatch();
+				_batchTransform = _transform;
+			}
 		}
 	}
 }
@@ -373,6 +394,15 @@ void Canvas::flushBatch() {
 }
 
 void Canvas::pushContour(const Path &path, bool closed) {
+	if (_hasPathTransform) {
+		if (!_line.line.empty()) {
+			LayoutFunctionTable->transformPoints(_pathTransform, &_line.line.front().x, &_line.line.front().x, _line.line.size());
+		}
+		if (!_line.outline.empty()) {
+			LayoutFunctionTable->transformPoints(_pathTransform, &_line.outline.front().x, &_line.outline.front().x, _line.outline.size());
+		}
+	}
+
 	if ((path.getStyle() & layout::Path::Style::Fill) != 0) {
 		size_t count = _line.line.size();
 		if (closed && count >= 2) {
@@ -132,6 +132,10 @@ protected:
 
 	Mat4 _batchTransform;
 
+	// from current path space to batch space, when batch was not flushed on transform change
+	Mat4 _pathTransform;
+	bool _hasPathTransform = false;
+
 	Function<void()> _flushCallback;
 };
 
@@ -43,6 +43,7 @@ class Page;
 class Storage;
 class Transaction;
 class PageCache;
+struct File;
 
 constexpr uint32_t UndefinedPage = stappler::maxOf<uint32_t>();
 
@@ -60,9 +61,9 @@ enum class PageType : uint8_t {
 	IntIndexTable =		0b0100'0001,
 	IntIndexContent =	0b0100'0010,
 	/*RevIndexTable =		0b0100'0001,
-	RevIndexContent =	0b0100'0010,
+	RevIndexContent =	0b0100'0010,*/
 	BytIndexTable =		0b1000'0001,
-	BytIndexContent =	0b1000'0010,*/
+	BytIndexContent =	0b1000'0010,
 };
 
 struct VirtualPageHeader {
@@ -89,6 +90,9 @@ using SchemeContentPageHeader = OidContentPageHeader;
 using IntIndexTreePageHeader = OidTreePageHeader;
 using IntIndexContentPageHeader = OidContentPageHeader;
 
+using BytIndexTreePageHeader = OidTreePageHeader;
+using BytIndexContentPageHeader = OidContentPageHeader;
+
 struct StorageHeader {
 	uint8_t title[6]; // 0 - 5
 	uint8_t version; // 6
@@ -99,13 +103,44 @@ struct StorageHeader {
 	uint32_t root; // 28 - 31
 };
 
+// WAL is append-only: header is followed by commits, each commit is a record with page map of whole WAL,
+// followed by frames, written within this commit; header points to last published commit
 struct WalHeader {
 	uint8_t title[6]; // 0 - 5
 	uint8_t version; // 6
 	uint8_t pageSize; // 7 ( size = 1 << value)
 	uint64_t mtime; // 8 - 15
-	uint32_t count; // 16 - 19
-	uint32_t offset; // 20 - 23
+	uint32_t count; // 16 - 19, pages in map of last commit
+	uint32_t hash; // 20 - 23, hash of last commit record
+	uint64_t offset; // 24 - 31, offset of last commit record (0 if nothing was committed)
+};
+
+struct WalCommit {
+	uint64_t mtime; // 0 - 7
+	uint32_t count; // 8 - 11, pages in map, map follows record
+	uint32_t frames; // 12 - 15, frames of this commit, follows map (aligned to system page)
+	uint32_t total; // 16 - 19, frames in WAL, including this commit
+	uint32_t hash; // 20 - 23, hash of record and map, calculated with zero in this field
+};
+
+struct WalFrame {
+	uint32_t page; // 0 - 3
+	uint32_t hash; // 4 - 7, hash of page content
+	uint64_t offset; // 8 - 15, offset of frame in WAL
+};
+
+// 2Q replacement queues: pages, accessed once, pass through FIFO (In),
+// pages, accessed again after eviction from In, live in LRU (Main)
+enum class PageQueue : uint8_t {
+	None,
+	In,
+	Main,
+};
+
+struct PageCacheStats {
+	size_t hits = 0;
+	size_t misses = 0;
+	size_t evictions = 0;
 };
 
 struct PageNode {
@@ -115,6 +150,12 @@ struct PageNode {
 	PageType type = PageType::None;
 	mem::Time access;
 	mutable std::atomic<uint32_t> refCount = 1;
+	bool wal = false; // page is mapped from WAL snapshot, not from storage file
+
+	// replacement queue links, only mapped read pages are linked
+	PageQueue queue = PageQueue::None;
+	PageNode *queuePrev = nullptr;
+	PageNode *queueNext = nullptr;
 
 	PageNode(uint32_t n, mem::BytesView b, OpenMode m, PageType p, mem::Time t)
 	: number(n), bytes(b), mode(m), type(p), access(t) { }
@@ -170,6 +211,26 @@ struct IntegerIndexPayload {
 	OidPosition position;
 };
 
+// string and bytes index pages: cells grow from page header, key bytes are stored in heap, that grows from page end
+struct BytesIndexCell {
+	uint32_t page = UndefinedPage;
+	uint32_t offset = 0; // offset of separator key within page
+	uint32_t size = 0; // size of separator key
+};
+
+struct BytesIndexPayload {
+	uint32_t offset = 0; // offset of key within page
+	uint32_t size = 0; // full size of key, only first BytesIndexKeyLimit bytes are stored
+	OidPosition position;
+};
+
+// string or bytes index value, pending within transaction
+struct BytesIndexValue {
+	mem::Bytes key; // truncated to BytesIndexKeyLimit
+	uint32_t size = 0; // full size of key
+	OidPosition position;
+};
+
 struct OidCellHeader {
 	Oid oid;
 	uint64_t nextObject;
@@ -207,13 +268,14 @@ constexpr uint32_t DefaultPageSize = 2_MiB;
 constexpr uint32_t ManifestPageSize = 32_KiB;
 constexpr uint64_t OidMax = 0xFFFF'FFFF'FFFFULL;
 constexpr size_t OidHeaderSize = sizeof(OidCellHeader);
-constexpr uint32_t PageCacheLimit = 24;
+constexpr uint32_t PageCacheLimit = 24; // default cache budget, in pages per hardware thread
 
 constexpr auto FormatTitle = mem::StringView("minidb");
 constexpr uint8_t FormatVersion = 1;
 
 constexpr auto WalTitle = mem::StringView("mdbwal");
-constexpr uint8_t WalVersion = 1;
+constexpr uint8_t WalVersion = 2;
+constexpr size_t WalReadAttempts = 128; // attempts to read WAL header, that is concurrently updated by writer
 
 template <typename T>
 inline constexpr bool has_single_bit(T x) noexcept {
@@ -228,6 +290,9 @@ inline bool operator<(const IntegerIndexPayload &l, const IntegerIndexPayload &r
 	}
 }
 
+// keys are ordered by stored bytes, then by full size (for truncated keys), then by oid
+bool operator<(const BytesIndexValue &l, const BytesIndexValue &r);
+
 inline bool operator<(const OidPosition &l, const OidPosition &r) {
 	return l.value < r.value;
 }
@@ -237,12 +302,14 @@ inline bool isContentType(PageType t) {
 	case PageType::OidContent:
 	case PageType::SchemeContent:
 	case PageType::IntIndexContent:
+	case PageType::BytIndexContent:
 		return true;
 		break;
 	case PageType::None:
 	case PageType::OidTable:
 	case PageType::SchemeTable:
 	case PageType::IntIndexTable:
+	case PageType::BytIndexTable:
 		return false;
 		break;
 	}
@@ -252,12 +319,36 @@ inline bool isContentType(PageType t) {
 uint32_t getSystemPageSize();
 uint8_t getPageSizeByte(uint32_t);
 
+// read and check WAL header, fails if WAL was not written by this format version
+bool readWalHeader(const File &, WalHeader &);
+
+// read and check commit record with its page map
+bool readWalCommit(const File &, uint64_t offset, WalCommit &, mem::Vector<WalFrame> &);
+
+// offset of first frame of commit, which record is placed at specified offset
+uint64_t getWalFramesOffset(uint64_t offset, const WalCommit &);
+
 static constexpr uint64_t VarUintMax = 0x1FFFFFFFFFFFFFFFULL; // 2305843009213693951
 
 size_t getVarUintSize(uint64_t);
 uint64_t readVarUint(uint8_p, uint8_p *pl = nullptr);
 size_t writeVarUint(uint8_t *p, uint64_t);
 
+// string and bytes fields are indexed with full keys up to BytesIndexKeyLimit bytes; longer keys are truncated,
+// so, for them index only narrows the range, and candidates should be checked with actual object value
+static constexpr uint32_t BytesIndexKeyLimit = 256;
+
+// lexicographical byte order, key is less then its own extension
+int compareIndexKeys(mem::BytesView, mem::BytesView);
+
+inline mem::BytesView getIndexKey(mem::BytesView key) {
+	return mem::BytesView(key.data(), std::min(key.size(), size_t(BytesIndexKeyLimit)));
+}
+
+inline mem::BytesView getIndexKey(const uint8_t *page, uint32_t offset, uint32_t size) {
+	return mem::BytesView(page + offset, std::min(size, BytesIndexKeyLimit));
+}
+
 struct InspectOptions {
 	mem::Function<void(mem::StringView)> cb;
 	uint32_t depth = stappler::maxOf<uint32_t>();
@@ -305,6 +396,7 @@ struct File {
 
 	void lock_shared();
 	void lock_exclusive();
+	bool try_lock_exclusive();
 	void unlock();
 
 	void *mmap(size_t len, off_t offset, int prot, int flags);
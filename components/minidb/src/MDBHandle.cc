@@ -208,8 +208,7 @@ bool Handle::endTransaction() {
 	} else if (_transactionCounter == 1) {
 		_transactionCounter = 0;
 		if (_transaction.isOpen()) {
-			_transaction.close();
-			return true;
+			return _transaction.close();
 		}
 	} else {
 		-- _transactionCounter;
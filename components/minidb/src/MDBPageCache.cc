@@ -36,9 +36,19 @@ PageCache::PageCache(const Storage *s, File & fd, bool writable)
 		_header = header;
 		_pageSize = 1 << header.pageSize;
 		_pageCount = header.pageCount;
-		_pagesLimit = PageCacheLimit * std::thread::hardware_concurrency();
 		return true;
 	}, OpenMode::Read);
+
+	_cacheSize = _storage->getParams().cacheSize;
+	if (_cacheSize == 0) {
+		_cacheSize = size_t(PageCacheLimit) * std::max(std::thread::hardware_concurrency(), 1U) * _pageSize;
+	}
+
+	auto cachePages = std::max(_cacheSize / std::max(_pageSize, uint32_t(1)), size_t(1));
+	_inLimit = std::max(cachePages / 4, size_t(1));
+	_ghostLimit = cachePages / 2;
+
+	openSnapshot();
 }
 
 PageCache::~PageCache() {
@@ -50,44 +60,34 @@ PageCache::~PageCache() {
 					" refs: ", it.second.refCount.load());
 		}
 	}
+	_storage->addCacheStats(_stats);
 }
 
 const PageNode * PageCache::openPage(uint32_t idx, OpenMode mode) {
 	std::unique_lock<mem::Mutex> lock(_mutex);
 
-	if (_nmapping > _pagesLimit) {
-		mem::Vector<PageNode *> nodes;
-		for (auto &it : _pages) {
-			if (it.second.mode == OpenMode::Read && it.second.number != idx && it.second.refCount.load() == 0) {
-				nodes.emplace_back(&it.second);
-			}
-		}
-
-		std::sort(nodes.begin(), nodes.end(), [&] (PageNode *l, PageNode *n) -> bool {
-			return l->access.toMicros() < n->access.toMicros();
-		});
-
-		auto shouldRemains = _pagesLimit / 2;
-
-		nodes.resize(std::min(_pages.size() - shouldRemains, nodes.size()));
-		for (auto &it : nodes) {
-			_storage->closePage(it->bytes, *_fd);
-			_pages.erase(it->number);
-			-- _nmapping;
-		}
-	}
-
 	auto it = _pages.find(idx);
 	if (it != _pages.end()) {
 		if (mode == OpenMode::Write && it->second.mode == OpenMode::Read) {
 			promote(it->second);
+		} else if (it->second.queue == PageQueue::Main) {
+			unlinkNode(it->second);
+			linkNode(it->second, PageQueue::Main);
 		}
+		++ _stats.hits;
 		it->second.access = stappler::Time::now();
 		++ it->second.refCount;
 		return &it->second;
 	}
 
-	mem::BytesView mem = _storage->openPage(this, idx, *_fd);
+	++ _stats.misses;
+
+	if (mode == OpenMode::Read) {
+		while ((_nmapping + 1) * _pageSize > _cacheSize && evictPage()) { }
+	}
+
+	bool wal = false;
+	mem::BytesView mem = mapPage(idx, wal);
 	if (mem.empty()) {
 		if (_writable) {
 			std::unique_lock<mem::Mutex> lock(_headerMutex);
@@ -100,11 +100,15 @@ const PageNode * PageCache::openPage(uint32_t idx, OpenMode mode) {
 	}
 
 	switch (mode) {
-	case OpenMode::Read:
+	case OpenMode::Read: {
 		++ _nmapping;
-		return &_pages.try_emplace(idx,
+		auto node = &_pages.try_emplace(idx,
 				idx, mem, OpenMode::Read, PageType(((VirtualPageHeader *)mem.data())->type), mem::Time::now()).first->second;
+		node->wal = wal;
+		linkNode(*node, (_ghost.erase(idx) > 0) ? PageQueue::Main : PageQueue::In);
+		return node;
 		break;
+	}
 	case OpenMode::Write: {
 		PageNode *ret = nullptr;
 		auto ptr = pages::alloc(mem);
@@ -112,7 +116,7 @@ const PageNode * PageCache::openPage(uint32_t idx, OpenMode mode) {
 			ret = &_pages.try_emplace(idx,
 					idx, ptr, OpenMode::Write, PageType(((VirtualPageHeader *)mem.data())->type), mem::Time::now()).first->second;
 		}
-		_storage->closePage(mem, *_fd);
+		unmapPage(mem, wal);
 		return ret;
 		break;
 	}
@@ -126,6 +130,13 @@ const PageNode * PageCache::allocatePage(PageType t) {
 	}
 
 	std::unique_lock<mem::Mutex> lock(_mutex);
+	if (!_freePages.empty()) {
+		auto idx = _freePages.back();
+		_freePages.pop_back();
+		lock.unlock();
+		return reusePage(idx, t);
+	}
+
 	std::unique_lock<mem::Mutex> hlock(_headerMutex);
 	auto idx = _header.pageCount;
 	++ _header.pageCount;
@@ -145,8 +156,27 @@ void PageCache::closePage(const PageNode *node) {
 	-- node->refCount;
 }
 
-void PageCache::clear(const Transaction &t, bool commit) {
-	bool hasUpdates = !_intIndex.empty() || _headerDirty;
+void PageCache::releasePage(uint32_t idx) {
+	std::unique_lock<mem::Mutex> lock(_mutex);
+	if (_writable) {
+		_freePages.emplace_back(idx);
+	}
+}
+
+const PageNode * PageCache::reusePage(uint32_t idx, PageType t) {
+	auto page = openPage(idx, OpenMode::Write);
+	if (page) {
+		std::unique_lock<mem::Mutex> lock(_mutex);
+		auto h = (VirtualPageHeader *)page->bytes.data();
+		h->type = stappler::toInt(t);
+		h->ncells = 0;
+		_pages.find(idx)->second.type = t;
+	}
+	return page;
+}
+
+bool PageCache::clear(const Transaction &t, bool commit) {
+	bool hasUpdates = !_intIndex.empty() || !_bytIndex.empty() || _headerDirty;
 	if (!hasUpdates) {
 		for (auto &it : _pages) {
 			if (it.second.mode == OpenMode::Write) {
@@ -156,7 +186,7 @@ void PageCache::clear(const Transaction &t, bool commit) {
 	}
 
 	if (hasUpdates && commit && _writable) {
-		if (!_intIndex.empty()) {
+		if (!_intIndex.empty() || !_bytIndex.empty()) {
 			writeIndexes(t);
 		}
 		_header.mtime = mem::Time::now().toMicros();
@@ -166,68 +196,67 @@ void PageCache::clear(const Transaction &t, bool commit) {
 	}
 
 	bool hasWal = false;
+	bool syncWal = _storage->getParams().commitMode == CommitMode::Sync;
+	size_t walFrames = 0;
 	std::unique_lock<mem::Mutex> lock(_mutex);
 	if (hasUpdates && commit && _writable) {
-		hasWal = makeWal();
-	}
-
-	bool success = true;
-
-	if (hasWal) {
-		auto it = _pages.begin();
-		while (it != _pages.end() && success) {
-			if (it->second.refCount.load() == 0) {
-				switch (it->second.mode) {
-				case OpenMode::Read:
-					_storage->closePage(it->second.bytes, *_fd);
-					-- _nmapping;
-					break;
-				case OpenMode::Write:
-					pages::free(it->second.bytes);
-					break;
-				}
-				it = _pages.erase(it);
-			} else {
-				++ it;
-			}
-		}
+		hasWal = makeWal(syncWal, walFrames);
+	}
 
-		_storage->applyWal(_storage->getSourceName(), *_fd);
-	} else {
-		auto it = _pages.begin();
-		while (it != _pages.end() && success) {
-			if (it->second.refCount.load() == 0) {
-				switch (it->second.mode) {
-				case OpenMode::Read:
-					_storage->closePage(it->second.bytes, *_fd);
-					-- _nmapping;
-					break;
-				case OpenMode::Write:
-					if (commit) {
-						if (it->second.number == 0) {
-							if (memcmp(it->second.bytes.data(), "minidb", 6) != 0) {
-								stappler::log::text("minidb", "Broken first page detected");
-								return;
-							}
-						}
-						if (!_storage->writePage(this, it->second.number, *_fd, it->second.bytes)) {
-							success = false;
-						}
-					}
-
-					pages::free(it->second.bytes);
-					break;
-				}
-				it = _pages.erase(it);
-			} else {
-				++ it;
+	// without WAL, changes can not be published without breaking readers isolation, so, they are dropped
+	bool success = hasWal || !hasUpdates || !commit || !_writable;
+	if (!success) {
+		stappler::log::text("minidb", "Fail to commit: fail to write WAL");
+	}
+
+	// pages are free only within committed state, after rollback they are still linked
+	if (!success || !commit) {
+		_freePages.clear();
+	}
+
+	auto it = _pages.begin();
+	while (it != _pages.end()) {
+		if (it->second.refCount.load() == 0) {
+			switch (it->second.mode) {
+			case OpenMode::Read:
+				unlinkNode(it->second);
+				unmapPage(it->second.bytes, it->second.wal);
+				-- _nmapping;
+				break;
+			case OpenMode::Write:
+				pages::free(it->second.bytes);
+				break;
 			}
+			it = _pages.erase(it);
+		} else {
+			++ it;
 		}
 	}
 
-	if (commit && _writable && success && hasWal) {
-		clearWal();
+	// header is published with WAL or dropped with other changes, next commit should not rewrite it again
+	_headerDirty = false;
+
+	if (hasWal && !_storage->isMemoryStorage()) {
+		_walGeneration = _storage->publishWal(syncWal);
+
+		// new WAL is already visible for new readers; try to merge it into storage file,
+		// then switch to actual snapshot; with deferred sync, merge (which is always synchronous)
+		// is postponed until WAL grows large enough; when WAL grows past hard limit, merge
+		// does not give up on current readers, but waits for them
+		auto &params = _storage->getParams();
+		closeSnapshot();
+		if (syncWal || walFrames >= params.walPagesLimit) {
+			_storage->applyWal(_storage->getSourceName(), *_fd, walFrames >= params.walFramesLimit);
+		}
+		openSnapshot();
 	}
+
+	return success;
+}
+
+PageCacheStats PageCache::getStats() const {
+	std::unique_lock<mem::Mutex> lock(_mutex);
+	return _stats;
 }
 
 bool PageCache::empty() const {
@@ -271,8 +300,10 @@ void PageCache::promote(PageNode &node) {
 
 	auto mem = pages::alloc(_pageSize);
 	memcpy((void *)mem.data(), node.bytes.data(), mem.size());
+	unlinkNode(node);
 	node.mode = OpenMode::Write;
-	_storage->closePage(node.bytes, *_fd);
+	unmapPage(node.bytes, node.wal);
+	node.wal = false;
 	node.bytes = mem;
 	node.access = mem::Time::now();
 	-- _nmapping;
@@ -290,6 +321,28 @@ void PageCache::addIndexValue(OidPosition idx, OidPosition obj, int64_t value) {
 	}
 }
 
+void PageCache::removeIndexValue(OidPosition idx, OidPosition obj, int64_t value) {
+	std::unique_lock<mem::Mutex> lock(_indexMutex);
+
+	IntegerIndexPayload payload{value, obj};
+
+	auto it = _intIndex.find(idx);
+	if (it != _intIndex.end()) {
+		// value was added within this transaction, so, it's not in index pages yet
+		auto lb = std::lower_bound(it->second.begin(), it->second.end(), payload);
+		if (lb != it->second.end() && lb->value == value && lb->position.value == obj.value) {
+			it->second.erase(lb);
+			return;
+		}
+	} else {
+		// index should be rewritten on commit, even if there is no new values for it
+		_intIndex.emplace(idx, mem::Vector<IntegerIndexPayload>());
+	}
+
+	auto &removed = _intIndexRemoved.try_emplace(idx).first->second;
+	removed.emplace(std::upper_bound(removed.begin(), removed.end(), payload), payload);
+}
+
 bool PageCache::hasIndexValue(OidPosition idx, int64_t value) {
 	std::unique_lock<mem::Mutex> lock(_indexMutex);
 
@@ -303,7 +356,75 @@ bool PageCache::hasIndexValue(OidPosition idx, int64_t value) {
 	return false;
 }
 
-void PageCache::writeIndexData(const Transaction &t, const SchemeCell &scheme, IndexCell *cell, mem::Vector<IntegerIndexPayload> &inputPayload) {
+mem::Vector<OidPosition> PageCache::getIndexValues(OidPosition idx, int64_t value) {
+	std::unique_lock<mem::Mutex> lock(_indexMutex);
+
+	mem::Vector<OidPosition> ret;
+	auto it = _intIndex.find(idx);
+	if (it != _intIndex.end()) {
+		auto lb = std::lower_bound(it->second.begin(), it->second.end(), IntegerIndexPayload{value, OidPosition{0, 0, 0}});
+		while (lb != it->second.end() && lb->value == value) {
+			ret.emplace_back(lb->position);
+			++ lb;
+		}
+	}
+	return ret;
+}
+
+static BytesIndexValue PageCache_makeIndexValue(OidPosition obj, mem::BytesView value) {
+	auto key = getIndexKey(value);
+	return BytesIndexValue{mem::Bytes(key.data(), key.data() + key.size()), uint32_t(value.size()), obj};
+}
+
+void PageCache::addIndexValue(OidPosition idx, OidPosition obj, mem::BytesView value) {
+	std::unique_lock<mem::Mutex> lock(_indexMutex);
+
+	auto payload = PageCache_makeIndexValue(obj, value);
+	auto &values = _bytIndex.try_emplace(idx).first->second;
+	values.emplace(std::upper_bound(values.begin(), values.end(), payload), std::move(payload));
+}
+
+void PageCache::removeIndexValue(OidPosition idx, OidPosition obj, mem::BytesView value) {
+	std::unique_lock<mem::Mutex> lock(_indexMutex);
+
+	auto payload = PageCache_makeIndexValue(obj, value);
+
+	// value was added within this transaction, so, it's not in index pages yet; if not - index should be
+	// rewritten on commit, even if there is no new values for it
+	auto &values = _bytIndex.try_emplace(idx).first->second;
+	auto range = std::equal_range(values.begin(), values.end(), payload);
+	auto it = std::find_if(range.first, range.second, [&] (const BytesIndexValue &v) {
+		return v.position.page == obj.page && v.position.offset == obj.offset;
+	});
+	if (it != range.second) {
+		values.erase(it);
+		return;
+	}
+
+	auto &removed = _bytIndexRemoved.try_emplace(idx).first->second;
+	removed.emplace(std::upper_bound(removed.begin(), removed.end(), payload), std::move(payload));
+}
+
+mem::Vector<OidPosition> PageCache::getIndexValues(OidPosition idx, mem::BytesView value) {
+	std::unique_lock<mem::Mutex> lock(_indexMutex);
+
+	mem::Vector<OidPosition> ret;
+	auto it = _bytIndex.find(idx);
+	if (it != _bytIndex.end()) {
+		auto key = getIndexKey(value);
+		auto lb = std::lower_bound(it->second.begin(), it->second.end(), key, [] (const BytesIndexValue &l, mem::BytesView r) {
+			return compareIndexKeys(mem::BytesView(l.key.data(), l.key.size()), r) < 0;
+		});
+		while (lb != it->second.end() && compareIndexKeys(mem::BytesView(lb->key.data(), lb->key.size()), key) == 0) {
+			ret.emplace_back(lb->position);
+			++ lb;
+		}
+	}
+	return ret;
+}
+
+void PageCache::writeIndexData(const Transaction &t, const SchemeCell &scheme, IndexCell *cell, mem::Vector<IntegerIndexPayload> &inputPayload,
+		const mem::Vector<IntegerIndexPayload> &removed) {
 	struct ContentPage {
 		IntIndexContentPageHeader header;
 		mem::SpanView<IntegerIndexPayload> data;
@@ -320,8 +441,9 @@ void PageCache::writeIndexData(const Transaction &t, const SchemeCell &scheme, I
 
 	size_t counter = 0;
 	auto data = (cell->root == UndefinedPage) ? mem::SpanView<IntegerIndexPayload>() : stappler::makeSpanView(
-			(IntegerIndexPayload *)mem::pool::palloc(mem::pool::acquire(), (scheme.counter + inputPayload.size() + 255) * sizeof(IntegerIndexPayload)),
-			scheme.counter + inputPayload.size() + 255);
+			(IntegerIndexPayload *)mem::pool::palloc(mem::pool::acquire(),
+					(scheme.counter + inputPayload.size() + removed.size() + 255) * sizeof(IntegerIndexPayload)),
+			scheme.counter + inputPayload.size() + removed.size() + 255);
 	auto dataView = data;
 
 	auto inputIt = inputPayload.begin();
@@ -384,6 +506,19 @@ void PageCache::writeIndexData(const Transaction &t, const SchemeCell &scheme, I
 		inputIt = inputPayload.end();
 	}
 
+	if (!data.empty() && !removed.empty()) {
+		// removed values has the same order as index payload; moved object can be reinserted with the same value and oid,
+		// so, cell position is also compared
+		auto begin = (IntegerIndexPayload *)data.data();
+		auto end = std::remove_if(begin, begin + counter, [&] (const IntegerIndexPayload &it) {
+			auto range = std::equal_range(removed.begin(), removed.end(), it);
+			return std::find_if(range.first, range.second, [&] (const IntegerIndexPayload &r) {
+				return r.position.page == it.position.page && r.position.offset == it.position.offset;
+			}) != range.second;
+		});
+		counter = end - begin;
+	}
+
 	/*if (counter != scheme.counter) {
 		counter = PageCache_fixIndexData(data, counter);
 	}*/
@@ -398,11 +533,7 @@ void PageCache::writeIndexData(const Transaction &t, const SchemeCell &scheme, I
 		} else {
 			auto n = pagePool.back();
 			pagePool.pop_back();
-			auto page = openPage(n, OpenMode::Write);
-			auto h = (VirtualPageHeader *)page->bytes.data();
-			h->type = stappler::toInt(t);
-			h->ncells = 0;
-			return page;
+			return reusePage(n, t);
 		}
 	};
 
@@ -436,6 +567,11 @@ void PageCache::writeIndexData(const Transaction &t, const SchemeCell &scheme, I
 		stack.replaceIntegerIndex(cell, mem::SpanView<IntegerIndexPayload>(data.data(), counter));
 	}
 
+	// index shrinks, pages, that was not reused, are free now
+	for (auto &it : pagePool) {
+		releasePage(it);
+	}
+
 
 	/*db::minidb::InspectOptions opts;
 	opts.cb = [&] (mem::StringView str) { std::cout << str; };
@@ -443,6 +579,62 @@ void PageCache::writeIndexData(const Transaction &t, const SchemeCell &scheme, I
 	db::minidb::inspectTree(t, cell->root, opts);*/
 }
 
+void PageCache::writeIndexData(const Transaction &t, IndexCell *cell, mem::Vector<BytesIndexValue> &inputPayload,
+		const mem::Vector<BytesIndexValue> &removed) {
+	mem::Vector<uint32_t> pagePool;
+	mem::Vector<BytesIndexValue> data;
+
+	auto firstPage = getPageList(t, cell->root, pagePool);
+	while (firstPage != UndefinedPage) {
+		auto page = openPage(firstPage, OpenMode::Read);
+		auto h = (const BytIndexContentPageHeader *)page->bytes.data();
+		firstPage = h->next;
+
+		auto begin = (const BytesIndexPayload *)(page->bytes.data() + sizeof(BytIndexContentPageHeader));
+		auto end = begin + h->ncells;
+		for (; begin != end; ++ begin) {
+			auto key = getIndexKey(page->bytes.data(), begin->offset, begin->size);
+			data.emplace_back(BytesIndexValue{mem::Bytes(key.data(), key.data() + key.size()), begin->size, begin->position});
+		}
+		closePage(page);
+	}
+
+	// removed values are dropped before merge: value can be removed and then added again for the same cell
+	// within one transaction, and only stored copy should be dropped
+	if (!removed.empty()) {
+		auto end = std::remove_if(data.begin(), data.end(), [&] (const BytesIndexValue &it) {
+			auto range = std::equal_range(removed.begin(), removed.end(), it);
+			return std::find_if(range.first, range.second, [&] (const BytesIndexValue &r) {
+				return r.position.page == it.position.page && r.position.offset == it.position.offset;
+			}) != range.second;
+		});
+		data.erase(end, data.end());
+	}
+
+	mem::Vector<BytesIndexValue> values; values.reserve(data.size() + inputPayload.size());
+	std::merge(std::make_move_iterator(data.begin()), std::make_move_iterator(data.end()),
+			std::make_move_iterator(inputPayload.begin()), std::make_move_iterator(inputPayload.end()), std::back_inserter(values));
+
+	std::sort(pagePool.begin(), pagePool.end(), std::greater<>());
+
+	TreeStack stack(t, cell->root);
+	stack.allocOverload = [this, &pagePool] (PageType t) {
+		if (pagePool.empty()) {
+			return allocatePage(t);
+		} else {
+			auto n = pagePool.back();
+			pagePool.pop_back();
+			return reusePage(n, t);
+		}
+	};
+
+	stack.replaceBytesIndex(cell, values);
+
+	for (auto &it : pagePool) {
+		releasePage(it);
+	}
+}
+
 void PageCache::writeIndexes(const Transaction &t) {
 	auto p = mem::pool::create(mem::pool::acquire());
 	for (auto &it : _intIndex) {
@@ -450,8 +642,24 @@ void PageCache::writeIndexes(const Transaction &t) {
 			auto cell = (IndexCell *)(indexPage->bytes.data() + it.first.offset);
 			if (cell->oid.value == it.first.value) {
 				auto scheme = t.getSchemeCell(cell->schemeOid);
+				auto removedIt = _intIndexRemoved.find(it.first);
+				mem::pool::push(p);
+				writeIndexData(t, scheme, cell, it.second,
+						(removedIt != _intIndexRemoved.end()) ? removedIt->second : mem::Vector<IntegerIndexPayload>());
+				mem::pool::pop();
+				mem::pool::clear(p);
+			}
+			closePage(indexPage);
+		}
+	}
+	for (auto &it : _bytIndex) {
+		if (auto indexPage = openPage(it.first.page, OpenMode::Write)) {
+			auto cell = (IndexCell *)(indexPage->bytes.data() + it.first.offset);
+			if (cell->oid.value == it.first.value) {
+				auto removedIt = _bytIndexRemoved.find(it.first);
 				mem::pool::push(p);
-				writeIndexData(t, scheme, cell, it.second);
+				writeIndexData(t, cell, it.second,
+						(removedIt != _bytIndexRemoved.end()) ? removedIt->second : mem::Vector<BytesIndexValue>());
 				mem::pool::pop();
 				mem::pool::clear(p);
 			}
@@ -459,110 +667,300 @@ void PageCache::writeIndexes(const Transaction &t) {
 		}
 	}
 	_intIndex.clear();
+	_intIndexRemoved.clear();
+	_bytIndex.clear();
+	_bytIndexRemoved.clear();
 	mem::pool::destroy(p);
 }
 
-bool PageCache::makeWal() const {
-	if (_storage->isMemoryStorage()) {
-		return true;
+void PageCache::linkNode(PageNode &node, PageQueue q) {
+	auto &queue = (q == PageQueue::Main) ? _main : _in;
+	node.queue = q;
+	node.queuePrev = nullptr;
+	node.queueNext = queue.head;
+	if (queue.head) {
+		queue.head->queuePrev = &node;
+	} else {
+		queue.tail = &node;
 	}
+	queue.head = &node;
+	++ queue.count;
+}
 
-	using MapType = mem::Pair<uint32_t, uint32_t>;
+void PageCache::unlinkNode(PageNode &node) {
+	if (node.queue == PageQueue::None) {
+		return;
+	}
 
-	size_t walFileSize = 0;
-	mem::Vector<MapType> pageMap;
+	auto &queue = (node.queue == PageQueue::Main) ? _main : _in;
+	if (node.queuePrev) {
+		node.queuePrev->queueNext = node.queueNext;
+	} else {
+		queue.head = node.queueNext;
+	}
+	if (node.queueNext) {
+		node.queueNext->queuePrev = node.queuePrev;
+	} else {
+		queue.tail = node.queuePrev;
+	}
+	-- queue.count;
 
-	for (auto &it : _pages) {
-		if (it.second.refCount.load() == 0) {
-			switch (it.second.mode) {
-			case OpenMode::Read:
-				break;
-			case OpenMode::Write: {
-				uint32_t h = stappler::hash::hash32((const char *)it.second.bytes.data(), it.second.bytes.size());
-				pageMap.emplace_back(it.second.number, h);
-				walFileSize += getPageSize();
-				// std::cout << "WAL page init:  " << it.second.number << " "
-				//		<< stappler::base16::encode(mem::BytesView((const uint8_t *)&h, sizeof(uint32_t))) << "\n";
-				break;
-			}
-			}
+	node.queue = PageQueue::None;
+	node.queuePrev = nullptr;
+	node.queueNext = nullptr;
+}
+
+PageNode *PageCache::findVictim(const Queue &queue) const {
+	// pinned pages (with non-zero refCount) can not be evicted
+	for (auto node = queue.tail; node; node = node->queuePrev) {
+		if (node->refCount.load() == 0) {
+			return node;
 		}
 	}
+	return nullptr;
+}
 
-	auto path = _storage->getSourceName();
-	auto walMapPath = toString(path, ".wal");
-	if (stappler::filesystem::exists(walMapPath)) {
-		return false;
+bool PageCache::evictPage() {
+	PageNode *node = nullptr;
+	if (_in.count > _inLimit || _main.count == 0) {
+		node = findVictim(_in);
+	}
+	if (!node) {
+		node = findVictim(_main);
+	}
+	if (!node) {
+		node = findVictim(_in);
+	}
+	if (!node) {
+		return false; // all mapped pages are pinned, budget will be exceeded
 	}
 
-	WalHeader header;
-	memcpy((void *)header.title, WalTitle.data(), WalTitle.size());
-	header.version = 0; // WalVersion; - make WAL invalid, so, write fail will not produce processeble WAL
-	header.pageSize = getPageSizeByte(_pageSize);
-	header.mtime = mem::Time::now().toMicros();
-	header.count = pageMap.size();
+	if (node->queue == PageQueue::In) {
+		pushGhost(node->number);
+	}
 
-	uint32_t mapSize = sizeof(MapType) * pageMap.size() + sizeof(WalHeader);
+	unlinkNode(*node);
+	unmapPage(node->bytes, node->wal);
+	-- _nmapping;
+	++ _stats.evictions;
 
-	header.offset = (mapSize + _pageSize - 1) & ~(_pageSize - 1);
+	auto number = node->number;
+	_pages.erase(number);
+	return true;
+}
 
-	auto extraPages = header.offset / _pageSize;
+void PageCache::pushGhost(uint32_t number) {
+	if (_ghostLimit == 0) {
+		return;
+	}
 
-	auto fd = ::open(walMapPath.data(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH );
-	if (fd < 0) {
+	auto slot = _ghostSeq % _ghostLimit;
+	if (_ghostQueue.size() < _ghostLimit) {
+		_ghostQueue.emplace_back(number);
+	} else {
+		// forget oldest ghost, if it was not re-added since
+		auto it = _ghost.find(_ghostQueue[slot]);
+		if (it != _ghost.end() && it->second == _ghostSeq - _ghostLimit) {
+			_ghost.erase(it);
+		}
+		_ghostQueue[slot] = number;
+	}
+	_ghost[number] = _ghostSeq ++;
+}
+
+bool PageCache::openSnapshot() {
+	closeSnapshot();
+
+	if (_storage->isMemoryStorage()) {
 		return false;
 	}
 
-	auto fileSize = _pageSize * (extraPages + pageMap.size());
-	if (::lseek(fd, fileSize - 1, SEEK_SET) == -1 || ::write(fd, "", 1) == -1) {
-		close(fd);
+	auto walPath = toString(_storage->getSourceName(), ".wal");
+	if (!_walFd.open(walPath.data(), O_RDONLY, 0)) {
 		return false;
 	}
 
-	auto origin = (uint8_t *)stappler::mempool::base::sp_mmap(nullptr, fileSize, PROT_WRITE, MAP_SHARED | MAP_NONBLOCK, fd, 0);
-	if (!origin) {
+	// WAL is only appended by writers, and published commits are never changed, so, opened descriptor
+	// holds consistent snapshot for all lifetime of the cache; header can be read, while writer updates it,
+	// such read is detected with commit hash and repeated
+	WalHeader header;
+	WalCommit commit;
+	mem::Vector<WalFrame> map;
+	bool success = false;
+	for (size_t i = 0; i < WalReadAttempts; ++ i) {
+		if (!readWalHeader(_walFd, header) || uint32_t(1 << header.pageSize) != _pageSize || header.offset == 0) {
+			break;
+		}
+		if (readWalCommit(_walFd, header.offset, commit, map) && commit.hash == header.hash && commit.count == header.count) {
+			success = true;
+			break;
+		}
+		std::this_thread::yield();
+	}
+
+	if (!success) {
+		_walFd.close();
 		return false;
 	}
 
-	uint8_t *mem = origin;
-	memcpy(mem, (void *)&header, sizeof(WalHeader)); mem += sizeof(WalHeader);
-	memcpy(mem, pageMap.data(), pageMap.size() * sizeof(MapType));
+	_walEnd = getWalFramesOffset(header.offset, commit) + uint64_t(commit.frames) * _pageSize;
+	_walFrames = commit.total;
+	for (auto &it : map) {
+		_walPages.emplace(it.page, it);
+	}
 
-	mem = origin + header.offset;
+	// storage header is on first page, it should be taken from WAL, if it was committed there
+	auto it = _walPages.find(0);
+	if (it != _walPages.end()) {
+		StorageHeader h;
+		if (::pread(_walFd.fd, &h, sizeof(StorageHeader), it->second.offset) == sizeof(StorageHeader)) {
+			std::unique_lock<mem::Mutex> lock(_headerMutex);
+			_header = h;
+			_pageCount = h.pageCount;
+		}
+	}
+	return true;
+}
 
-	for (auto &it : _pages) {
-		if (it.second.refCount.load() == 0) {
-			switch (it.second.mode) {
-			case OpenMode::Read:
-				break;
-			case OpenMode::Write:
-				memcpy(mem, it.second.bytes.data(), it.second.bytes.size());
-				mem += it.second.bytes.size();
-				break;
-			}
+void PageCache::closeSnapshot() {
+	_walFd.close();
+	_walPages.clear();
+	_walEnd = 0;
+	_walFrames = 0;
+}
+
+mem::BytesView PageCache::mapPage(uint32_t idx, bool &wal) {
+	auto it = _walPages.find(idx);
+	if (it != _walPages.end()) {
+		if (auto mem = _walFd.mmap(_pageSize, it->second.offset, PROT_READ, MAP_PRIVATE | MAP_NONBLOCK)) {
+			wal = true;
+			return mem::BytesView(uint8_p(mem), _pageSize);
 		}
+		return mem::BytesView();
 	}
 
-	::msync(origin, fileSize, MS_SYNC);
-	stappler::mempool::base::sp_munmap(origin, fileSize);
+	wal = false;
+	return _storage->openPage(this, idx, *_fd);
+}
 
-	// activate WAL
-	header.version = WalVersion;
-	::lseek(fd, 0, SEEK_SET);
-	::write(fd, &header, sizeof(WalHeader));
-	::close(fd);
-	return true;
+void PageCache::unmapPage(mem::BytesView mem, bool wal) {
+	if (wal) {
+		_walFd.munmap((void *)mem.data(), 0);
+	} else {
+		_storage->closePage(mem, *_fd);
+	}
 }
 
-void PageCache::clearWal() const {
+bool PageCache::makeWal(bool sync, size_t &nframes) const {
 	if (_storage->isMemoryStorage()) {
-		return;
+		return true;
 	}
 
-	auto path = _storage->getSourceName();
-	auto walMapPath = toString(path, ".wal");
-	::unlink(walMapPath.data());
-}
+	mem::Vector<const PageNode *> nodes;
+	for (auto &it : _pages) {
+		if (it.second.refCount.load() == 0 && it.second.mode == OpenMode::Write) {
+			nodes.emplace_back(&it.second);
+		}
+	}
+
+	auto walPath = toString(_storage->getSourceName(), ".wal");
+
+	// without valid snapshot, WAL (if any) has no published commits, that readers can use, so, it's started over
+	bool created = _walFd.fd < 0;
+	auto fd = ::open(walPath.data(), O_CREAT | O_RDWR | (created ? O_TRUNC : 0), S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH );
+	if (fd < 0) {
+		return false;
+	}
+
+	WalHeader header;
+	memset((void *)&header, 0, sizeof(WalHeader));
+	memcpy((void *)header.title, WalTitle.data(), WalTitle.size());
+	header.version = WalVersion;
+	header.pageSize = getPageSizeByte(_pageSize);
+
+	uint64_t sysPageSize = getSystemPageSize();
+	uint64_t offset = _walEnd;
+	if (created) {
+		// header without commits is not used by readers, so, it can be written before commit
+		if (::pwrite(fd, &header, sizeof(WalHeader), 0) != ssize_t(sizeof(WalHeader))) {
+			::close(fd);
+			return false;
+		}
+		offset = (sizeof(WalHeader) + sysPageSize - 1) & ~(sysPageSize - 1);
+	}
+
+	// new commit record contains whole page map of WAL, its own frames follow it
+	mem::Map<uint32_t, WalFrame> map(_walPages);
+
+	WalCommit commit;
+	commit.mtime = mem::Time::now().toMicros();
+	commit.count = 0;
+	commit.frames = nodes.size();
+	commit.total = _walFrames + nodes.size();
+	commit.hash = 0;
+
+	for (auto &it : nodes) {
+		map.emplace(it->number, WalFrame{it->number, 0, 0});
+	}
+	commit.count = map.size();
+
+	auto frameOffset = getWalFramesOffset(offset, commit);
+	for (auto &it : nodes) {
+		auto &frame = map[it->number];
+		frame.hash = stappler::hash::hash32((const char *)it->bytes.data(), it->bytes.size());
+		frame.offset = frameOffset;
+		frameOffset += _pageSize;
+	}
 
+	mem::Vector<uint8_t> record; record.resize(sizeof(WalCommit) + map.size() * sizeof(WalFrame));
+	auto frames = (WalFrame *)(record.data() + sizeof(WalCommit));
+	for (auto &it : map) {
+		*frames = it.second;
+		++ frames;
+	}
+	memcpy(record.data(), &commit, sizeof(WalCommit));
+	commit.hash = stappler::hash::hash32((const char *)record.data(), record.size());
+	memcpy(record.data(), &commit, sizeof(WalCommit));
+
+	bool success = ::pwrite(fd, record.data(), record.size(), offset) == ssize_t(record.size());
+	for (auto &it : nodes) {
+		if (!success) {
+			break;
+		}
+		success = ::pwrite(fd, it->bytes.data(), _pageSize, map[it->number].offset) == ssize_t(_pageSize);
+	}
+
+	// commit is written, but not yet published; on failure it will be overwritten by next commit
+	if (!success || (sync && ::fdatasync(fd) != 0)) {
+		::close(fd);
+		return false;
+	}
+
+	// publish new snapshot for readers
+	header.mtime = commit.mtime;
+	header.count = commit.count;
+	header.hash = commit.hash;
+	header.offset = offset;
+	if (::pwrite(fd, &header, sizeof(WalHeader), 0) != ssize_t(sizeof(WalHeader))) {
+		::close(fd);
+		return false;
+	}
+
+	if (sync) {
+		::fdatasync(fd);
+		if (created) {
+			auto dir = stappler::filepath::root(_storage->getSourceName());
+			auto dirFd = ::open(dir.empty() ? "." : dir.data(), O_RDONLY | O_DIRECTORY);
+			if (dirFd >= 0) {
+				::fsync(dirFd);
+				::close(dirFd);
+			}
+		}
+	}
+	::close(fd);
+
+	nframes = commit.total;
+	return true;
+}
 
 }
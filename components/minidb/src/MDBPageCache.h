@@ -36,8 +36,12 @@ public:
 	const PageNode * allocatePage(PageType);
 	void closePage(const PageNode *);
 
-	// release (and commit) unused pages
-	void clear(const Transaction &, bool commit);
+	// page, unlinked from tree within write transaction, is reused by next allocations of this transaction;
+	// free list is not stored, so, pages, that are still free on commit, are not reclaimed
+	void releasePage(uint32_t);
+
+	// release (and commit) unused pages, returns false if changes was not committed
+	bool clear(const Transaction &, bool commit);
 	bool empty() const;
 
 	uint32_t getRoot() const;
@@ -49,26 +53,71 @@ public:
 	uint32_t getPageSize() const { return _pageSize; }
 	uint32_t getPageCount() const { return _pageCount; }
 
+	size_t getCacheSize() const { return _cacheSize; }
+	PageCacheStats getStats() const;
+
+	// generation of last WAL, published by this cache (0 if none), see Storage::waitWal
+	uint64_t getWalGeneration() const { return _walGeneration; }
+
 	void promote(PageNode &);
 
 	const StorageHeader &getHeader() const { return _header; }
 
 	void addIndexValue(OidPosition idx, OidPosition obj, int64_t value);
+
+	// drop value of removed or updated object from index, values are excluded from index pages on commit
+	void removeIndexValue(OidPosition idx, OidPosition obj, int64_t value);
 	bool hasIndexValue(OidPosition idx, int64_t value);
+	mem::Vector<OidPosition> getIndexValues(OidPosition idx, int64_t value);
+
+	// string and bytes index values, keys are truncated to BytesIndexKeyLimit
+	void addIndexValue(OidPosition idx, OidPosition obj, mem::BytesView value);
+	void removeIndexValue(OidPosition idx, OidPosition obj, mem::BytesView value);
+
+	// values with the same stored key, for truncated key value should be checked with actual object
+	mem::Vector<OidPosition> getIndexValues(OidPosition idx, mem::BytesView value);
 
 protected:
-	void writeIndexData(const Transaction &t, const SchemeCell &scheme, IndexCell *cell, mem::Vector<IntegerIndexPayload> &payload);
+	void writeIndexData(const Transaction &t, const SchemeCell &scheme, IndexCell *cell, mem::Vector<IntegerIndexPayload> &payload,
+			const mem::Vector<IntegerIndexPayload> &removed);
+	void writeIndexData(const Transaction &t, IndexCell *cell, mem::Vector<BytesIndexValue> &payload,
+			const mem::Vector<BytesIndexValue> &removed);
 	void writeIndexes(const Transaction &);
 
-	bool makeWal() const;
-	void clearWal() const;
+	// open existing page for writing as new page of specified type
+	const PageNode * reusePage(uint32_t, PageType);
+
+	// WAL snapshot: pages, committed, but not yet merged into storage file
+	bool openSnapshot();
+	void closeSnapshot();
+
+	mem::BytesView mapPage(uint32_t idx, bool &wal);
+	void unmapPage(mem::BytesView, bool wal);
+
+	bool makeWal(bool sync, size_t &frames) const;
+
+	struct Queue {
+		PageNode *head = nullptr;
+		PageNode *tail = nullptr;
+		size_t count = 0;
+	};
+
+	void linkNode(PageNode &, PageQueue);
+	void unlinkNode(PageNode &);
+	PageNode *findVictim(const Queue &) const;
+	bool evictPage();
+	void pushGhost(uint32_t);
 
 	const Storage *_storage = nullptr;
 	File * _fd = nullptr;
 	bool _writable = false;
 	mem::Vector<mem::BytesView> _alloc;
 	mem::Map<uint32_t, PageNode> _pages;
+	mem::Vector<uint32_t> _freePages;
 	mem::Map<OidPosition, mem::Vector<IntegerIndexPayload>> _intIndex;
+	mem::Map<OidPosition, mem::Vector<IntegerIndexPayload>> _intIndexRemoved;
+	mem::Map<OidPosition, mem::Vector<BytesIndexValue>> _bytIndex;
+	mem::Map<OidPosition, mem::Vector<BytesIndexValue>> _bytIndexRemoved;
 
 	mutable mem::Mutex _mutex;
 	mutable mem::Mutex _headerMutex;
@@ -80,7 +129,25 @@ protected:
 	StorageHeader _header;
 
 	size_t _nmapping = 0;
-	size_t _pagesLimit = PageCacheLimit;
+	size_t _cacheSize = 0;
+	size_t _inLimit = 1;
+
+	Queue _in;
+	Queue _main;
+
+	// pages, recently evicted from In queue; ring of page numbers with insertion sequence in map
+	size_t _ghostLimit = 0;
+	size_t _ghostSeq = 0;
+	mem::Vector<uint32_t> _ghostQueue;
+	mem::Map<uint32_t, size_t> _ghost;
+
+	PageCacheStats _stats;
+
+	File _walFd;
+	uint64_t _walEnd = 0; // end of last commit in WAL snapshot, next commit is appended here
+	uint32_t _walFrames = 0; // frames in WAL snapshot, including overridden ones
+	uint64_t _walGeneration = 0;
+	mem::Map<uint32_t, WalFrame> _walPages; // page -> last frame
 };
 
 }
@@ -28,6 +28,7 @@ THE SOFTWARE.
 #include <sys/stat.h>
 #include <sys/file.h>
 #include <alloca.h>
+#include <fcntl.h>
 
 namespace db::minidb {
 
@@ -98,6 +99,207 @@ bool Storage::writePage(PageCache *cache, uint32_t idx, File & fd, mem::BytesVie
 	return true;
 }
 
+PageCacheStats Storage::getCacheStats() const {
+	PageCacheStats ret;
+	ret.hits = _cacheHits.load();
+	ret.misses = _cacheMisses.load();
+	ret.evictions = _cacheEvictions.load();
+	return ret;
+}
+
+void Storage::addCacheStats(const PageCacheStats &stats) const {
+	_cacheHits += stats.hits;
+	_cacheMisses += stats.misses;
+	_cacheEvictions += stats.evictions;
+}
+
+CommitStats Storage::getCommitStats() const {
+	CommitStats ret;
+	ret.commits = _commits.load();
+	ret.fsyncs = _fsyncs.load();
+	return ret;
+}
+
+uint64_t Storage::publishWal(bool synced) const {
+	++ _commits;
+	if (synced) {
+		++ _fsyncs;
+	}
+
+	std::unique_lock<std::mutex> lock(_commitMutex);
+	auto gen = ++ _publishedGeneration;
+	if (synced) {
+		// WAL was synced by committer, it also covers all previous generations
+		_syncedGeneration = gen;
+		_commitCond.notify_all();
+	} else if (_params.commitMode == CommitMode::Relaxed) {
+		if (!_flushThread.joinable()) {
+			_flushThread = std::thread([this] {
+				runFlushThread();
+			});
+		} else {
+			_commitCond.notify_all();
+		}
+	}
+	return gen;
+}
+
+void Storage::waitWal(uint64_t gen) const {
+	if (_params.commitMode != CommitMode::Group) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(_commitMutex);
+	while (_syncedGeneration < gen) {
+		if (_syncActive) {
+			// some other committer syncs WAL now, its sync can cover our generation, or we will be next leader
+			_commitCond.wait(lock);
+			continue;
+		}
+
+		// become a leader for all generations, published for now
+		_syncActive = true;
+		auto target = _publishedGeneration;
+		lock.unlock();
+
+		syncWal();
+
+		lock.lock();
+		_syncActive = false;
+		if (_syncedGeneration < target) {
+			_syncedGeneration = target;
+		}
+		_commitCond.notify_all();
+	}
+}
+
+bool Storage::syncWal() const {
+	auto walPath = toString(_sourceName, ".wal");
+
+	auto fd = ::open(walPath.data(), O_RDONLY);
+	if (fd < 0) {
+		// WAL was merged into storage file, merge is always synchronous
+		return true;
+	}
+
+	// WAL is append-only, so, sync covers all commits, published before it
+	auto ret = ::fdatasync(fd) == 0;
+	++ _fsyncs;
+	::close(fd);
+
+	// WAL can be created after last merge, its directory entry should be durable too
+	auto dir = stappler::filepath::root(_sourceName);
+	auto dirFd = ::open(dir.empty() ? "." : dir.data(), O_RDONLY | O_DIRECTORY);
+	if (dirFd >= 0) {
+		::fsync(dirFd);
+		::close(dirFd);
+	}
+	return ret;
+}
+
+void Storage::recoverWal() const {
+	auto walPath = toString(_sourceName, ".wal");
+	if (!stappler::filesystem::exists(walPath)) {
+		return;
+	}
+
+	StorageHeader storageHeader;
+	File sfd(_sourceName, O_RDONLY, 0);
+	if (!sfd || sfd.read(&storageHeader, sizeof(StorageHeader)) != sizeof(StorageHeader)) {
+		return;
+	}
+
+	uint32_t pageSize = 1 << storageHeader.pageSize;
+
+	WalHeader header;
+	File wfd(walPath, O_RDWR, 0);
+	if (!wfd) {
+		return;
+	}
+
+	if (!readWalHeader(wfd, header) || uint32_t(1 << header.pageSize) != pageSize) {
+		stappler::log::text("minidb", "Invalid WAL detected and dropped");
+		::unlink(walPath.data());
+		return;
+	}
+
+	// commits, published after last sync, can be incomplete after crash, so, frames of all commits
+	// should be checked; commits are checked in order, last complete one will be published
+	uint64_t sysPageSize = getSystemPageSize();
+	uint64_t offset = (sizeof(WalHeader) + sysPageSize - 1) & ~(sysPageSize - 1);
+	uint64_t last = 0;
+	WalCommit lastCommit;
+	mem::Vector<uint8_t> buf; buf.resize(pageSize);
+	while (header.offset != 0 && offset <= header.offset) {
+		WalCommit commit;
+		mem::Vector<WalFrame> map;
+		if (!readWalCommit(wfd, offset, commit, map)) {
+			break;
+		}
+
+		bool valid = true;
+		for (auto &it : map) {
+			if (it.offset > offset && (::pread(wfd.fd, buf.data(), pageSize, it.offset) != ssize_t(pageSize)
+					|| stappler::hash::hash32((const char *)buf.data(), pageSize) != it.hash)) {
+				valid = false;
+				break;
+			}
+		}
+		if (!valid) {
+			break;
+		}
+
+		last = offset;
+		lastCommit = commit;
+		offset = getWalFramesOffset(offset, commit) + uint64_t(commit.frames) * pageSize;
+	}
+
+	if (header.offset == last) {
+		return;
+	}
+
+	if (last == 0) {
+		stappler::log::text("minidb", "Incomplete WAL detected and dropped");
+		::unlink(walPath.data());
+		return;
+	}
+
+	stappler::log::text("minidb", "Incomplete WAL detected, last complete commit restored");
+	header.mtime = lastCommit.mtime;
+	header.count = lastCommit.count;
+	header.hash = lastCommit.hash;
+	header.offset = last;
+	if (::pwrite(wfd.fd, &header, sizeof(WalHeader), 0) != ssize_t(sizeof(WalHeader)) || ::fdatasync(wfd.fd) != 0) {
+		::unlink(walPath.data());
+	}
+}
+
+void Storage::runFlushThread() const {
+	std::unique_lock<std::mutex> lock(_commitMutex);
+	while (!_flushStop) {
+		if (_syncedGeneration >= _publishedGeneration) {
+			_commitCond.wait(lock);
+			continue;
+		}
+
+		// collect commits within durability window, then sync them at once
+		_commitCond.wait_for(lock, std::chrono::microseconds(_params.durabilityWindow.toMicroseconds()), [&] {
+			return _flushStop;
+		});
+
+		auto target = _publishedGeneration;
+		lock.unlock();
+
+		syncWal();
+
+		lock.lock();
+		if (_syncedGeneration < target) {
+			_syncedGeneration = target;
+		}
+		_commitCond.notify_all();
+	}
+}
+
 uint8_t Storage::getDictId(const db::Scheme *scheme) const {
 	auto it = _dicts.find(scheme);
 	if (it != _dicts.end()) {
@@ -453,6 +655,19 @@ bool Storage::init(const mem::Map<mem::StringView, const db::Scheme *> &map) {
 }
 
 void Storage::free() {
+	std::unique_lock<std::mutex> lock(_commitMutex);
+	if (_flushThread.joinable()) {
+		_flushStop = true;
+		_commitCond.notify_all();
+		lock.unlock();
+		_flushThread.join();
+		lock.lock();
+	}
+	if (_syncedGeneration < _publishedGeneration) {
+		lock.unlock();
+		syncWal();
+	}
+
 	for (auto &it : _sourceMemory) {
 		pages::free(it);
 	}
@@ -469,10 +684,11 @@ Storage::Storage(mem::pool_t *p, mem::StringView path, StorageParams params)
 		return;
 	}
 
+	// committed WAL (if any) is a valid snapshot for transactions, it will be merged by next writer
 	fd.lock_shared();
+	recoverWal();
 	auto fileSize = fd.seek(0, SEEK_END);
 	if (fileSize > 0) {
-		applyWal(_sourceName, fd);
 		return;
 	}
 
@@ -529,9 +745,6 @@ Storage::Storage(mem::pool_t *p, mem::StringView path, StorageParams params)
 			} while (0);
 			t.close();
 		}
-	} else {
-		// try to apply existed WAL
-		applyWal(_sourceName, fd);
 	}
 }
 
@@ -591,56 +804,102 @@ Storage::Storage(mem::pool_t *p, mem::BytesView data, StorageParams params)
 	}
 }
 
-void Storage::applyWal(mem::StringView path, File &sfd) const {
-	auto walMapPath = toString(path, ".wal");
-	if (!stappler::filesystem::exists(walMapPath)) {
-		return;
+bool Storage::applyWal(mem::StringView path, File &sfd, bool force) const {
+	auto walPath = toString(path, ".wal");
+	if (!stappler::filesystem::exists(walPath)) {
+		return true;
 	}
 
-	auto storagefileSize = sfd.seek(0, SEEK_END);
+	// pages of storage file can be mapped by readers with older snapshots,
+	// so, WAL can be applied only when there is no other users of storage file
+	auto prevLock = sfd.locked;
+	File gate;
+	if (!sfd.try_lock_exclusive()) {
+		if (!force) {
+			return false;
+		}
 
-	auto wfd = File(walMapPath.data(), O_RDONLY, 0);
-	auto fileSize = wfd.seek(0, SEEK_END);
+		// new readers wait on merge gate, so, only current readers can postpone merge
+		if (!gate.open(toString(path, ".merge").data(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH )) {
+			return false;
+		}
+		gate.lock_exclusive();
 
-	auto origin = (uint8_t *)wfd.mmap(fileSize, 0, PROT_READ, MAP_PRIVATE | MAP_NONBLOCK);
+		auto deadline = mem::Time::now() + _params.walMergeTimeout;
+		while (!sfd.try_lock_exclusive()) {
+			if (mem::Time::now() > deadline) {
+				stappler::log::text("minidb", "Fail to merge WAL: storage file is still in use by readers");
+				return false;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
 
-	WalHeader *h = (WalHeader *)origin;
-	if (memcmp(h->title, WalTitle.data(), WalTitle.size()) != 0 || h->version != WalVersion) {
-		unlink(walMapPath.data());
-		return;
+	auto restoreLock = [&] {
+		if (prevLock == LOCK_SH) {
+			sfd.lock_shared();
+		} else if (prevLock == LOCK_UN) {
+			sfd.unlock();
+		}
+	};
+
+	auto storagefileSize = sfd.seek(0, SEEK_END);
+
+	WalHeader header;
+	WalCommit commit;
+	mem::Vector<WalFrame> map;
+
+	auto wfd = File(walPath.data(), O_RDONLY, 0);
+	if (!readWalHeader(wfd, header)) {
+		unlink(walPath.data());
+		restoreLock();
+		return false;
 	}
 
-	uint32_t pageSize = 1 << h->pageSize;
-	uint32_t targetSize = h->count * pageSize + h->offset;
-	if (fileSize != targetSize) {
-		unlink(walMapPath.data());
-		return;
+	if (header.offset == 0) {
+		// nothing was committed into WAL
+		unlink(walPath.data());
+		restoreLock();
+		return true;
 	}
 
-	sfd.lock_exclusive();
-	mem::Pair<uint32_t, uint32_t> *pageMap = (mem::Pair<uint32_t, uint32_t> *)(origin + sizeof(WalHeader));
+	uint32_t pageSize = 1 << header.pageSize;
+	auto fileSize = uint64_t(wfd.seek(0, SEEK_END));
+	if (!readWalCommit(wfd, header.offset, commit, map) || commit.hash != header.hash) {
+		unlink(walPath.data());
+		restoreLock();
+		return false;
+	}
 
-	uint8_t *page = origin + h->offset;
+	auto origin = (uint8_t *)wfd.mmap(fileSize, 0, PROT_READ, MAP_PRIVATE | MAP_NONBLOCK);
+	if (!origin) {
+		restoreLock();
+		return false;
+	}
 
 	auto storagePageCount = storagefileSize / pageSize;
 
-	for (size_t i = 0; i < h->count; ++ i) {
-		auto id = pageMap[i].first;
-		auto bytes = mem::BytesView(page + i * pageSize, pageSize);
+	for (auto &it : map) {
+		if (it.offset + pageSize > fileSize) {
+			std::cout << "WAL page invalid: " << it.page << " out of WAL bounds\n";
+			continue;
+		}
+
+		auto bytes = mem::BytesView(origin + it.offset, pageSize);
 		uint32_t h = stappler::hash::hash32((const char *)bytes.data(), bytes.size());
 
-		if (h == pageMap[i].second) {
-			// std::cout << "WAL page write: " << id << " "
-			//		<< stappler::base16::encode(mem::BytesView((const uint8_t *)&h, sizeof(uint32_t))) << "\n";
-			writePageTarget(id, sfd, bytes, pageSize, storagePageCount);
+		if (h == it.hash) {
+			writePageTarget(it.page, sfd, bytes, pageSize, storagePageCount);
 		} else {
-			std::cout << "WAL page invalid: " << id << " "
+			std::cout << "WAL page invalid: " << it.page << " "
 					<< stappler::base16::encode(mem::BytesView((const uint8_t *)&h, sizeof(uint32_t))) << " vs. "
-					<< stappler::base16::encode(mem::BytesView((const uint8_t *)&pageMap[i].second, sizeof(uint32_t))) << "\n";
+					<< stappler::base16::encode(mem::BytesView((const uint8_t *)&it.hash, sizeof(uint32_t))) << "\n";
 		}
 	}
 
-	unlink(walMapPath.data());
+	unlink(walPath.data());
+	restoreLock();
+	return true;
 }
 
 bool Storage::writePageTarget(uint32_t idx, File & fd, mem::BytesView bytes, uint32_t pageSize, uint32_t pageCount) const {
@@ -24,11 +24,30 @@ THE SOFTWARE.
 #define COMPONENTS_MINIDB_SRC_MDBSTORAGE_H_
 
 #include "MDBHandle.h"
+#include <condition_variable>
+#include <thread>
 
 namespace db::minidb {
 
+enum class CommitMode {
+	Sync, // every commit syncs its own WAL
+	Group, // committers release write lock before sync, and wait for shared WAL sync
+	Relaxed, // committers do not wait for sync, WAL is synced in background within durability window
+};
+
 struct StorageParams {
 	uint32_t pageSize = DefaultPageSize;
+	size_t cacheSize = 0; // page cache budget per transaction in bytes, 0 - PageCacheLimit pages per hardware thread
+	CommitMode commitMode = CommitMode::Sync;
+	stappler::TimeInterval durabilityWindow = stappler::TimeInterval::milliseconds(10); // for CommitMode::Relaxed
+	uint32_t walPagesLimit = 64; // for Group and Relaxed modes, WAL is merged into storage only when it grows past this limit (in frames)
+	uint32_t walFramesLimit = 256; // past this limit, merge waits for readers, that use storage file, instead of postponing
+	stappler::TimeInterval walMergeTimeout = stappler::TimeInterval::seconds(1); // how long merge waits for readers
+};
+
+struct CommitStats {
+	size_t commits = 0;
+	size_t fsyncs = 0;
 };
 
 class Storage : public mem::AllocBase {
@@ -62,6 +81,14 @@ public:
 
 	bool isMemoryStorage() const { return !_sourceMemory.empty(); }
 
+	const StorageParams &getParams() const { return _params; }
+
+	// page cache counters, accumulated from all finished transactions
+	PageCacheStats getCacheStats() const;
+	void addCacheStats(const PageCacheStats &) const;
+
+	CommitStats getCommitStats() const;
+
 protected:
 	friend class Transaction;
 	friend class PageCache;
@@ -71,9 +98,25 @@ protected:
 	Storage(mem::pool_t *, mem::StringView path, StorageParams params);
 	Storage(mem::pool_t *, mem::BytesView data, StorageParams params);
 
-	void applyWal(mem::StringView, File &) const;
+	// merge committed WAL into storage file; fails without blocking if storage is in use by readers,
+	// forced merge closes merge gate for new readers, and waits for current ones within walMergeTimeout
+	bool applyWal(mem::StringView, File &, bool force = false) const;
 	bool writePageTarget(uint32_t idx, File & fd, mem::BytesView, uint32_t pageSize, uint32_t pageCount) const;
 
+	// group commit: new WAL was published by committer, returns its generation to wait for
+	uint64_t publishWal(bool synced) const;
+
+	// wait until WAL of specified generation is durable (or schedule background sync for CommitMode::Relaxed)
+	void waitWal(uint64_t) const;
+
+	// sync current WAL, all commits, published for now, become durable
+	bool syncWal() const;
+
+	// drop commits, that was not completely written before crash, from WAL
+	void recoverWal() const;
+
+	void runFlushThread() const;
+
 	mem::pool_t *_pool = nullptr;
 	mem::StringView _sourceName;
 	mutable mem::Vector<mem::BytesView> _sourceMemory;
@@ -83,6 +126,21 @@ protected:
 	StorageParams _params = StorageParams();
 
 	mutable mem::Mutex _mutex;
+
+	mutable std::atomic<size_t> _cacheHits = 0;
+	mutable std::atomic<size_t> _cacheMisses = 0;
+	mutable std::atomic<size_t> _cacheEvictions = 0;
+
+	mutable std::atomic<size_t> _commits = 0;
+	mutable std::atomic<size_t> _fsyncs = 0;
+
+	mutable std::mutex _commitMutex;
+	mutable std::condition_variable _commitCond;
+	mutable uint64_t _publishedGeneration = 0;
+	mutable uint64_t _syncedGeneration = 0;
+	mutable bool _syncActive = false;
+	mutable bool _flushStop = false;
+	mutable std::thread _flushThread;
 };
 
 }
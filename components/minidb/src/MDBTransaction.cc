@@ -88,13 +88,25 @@ bool Transaction::open(const Storage &storage, OpenMode mode) {
 		return false;
 	}
 
-	if (mode == OpenMode::Read) {
+	if (mode == OpenMode::Write) {
+		// writers are serialized with separate lock file, storage file itself remains shared with readers
+		if (!_writeLock.open(toString(storage.getSourceName(), ".lock").data(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH )) {
+			_fd.close();
+			return false;
+		}
+		_writeLock.lock_exclusive();
+	}
+
+	if (mode == OpenMode::Read && !storage.isMemoryStorage()) {
+		// forced WAL merge closes merge gate for new readers, while it waits for current ones
+		File gate(toString(storage.getSourceName(), ".merge"), O_CREAT | O_RDONLY, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH );
+		gate.lock_shared();
 		_fd.lock_shared();
 	} else {
-		_fd.lock_exclusive();
+		_fd.lock_shared();
 	}
 
-	if (mode == OpenMode::Write) {
+	if (mode == OpenMode::Write && storage.getParams().commitMode == CommitMode::Sync) {
 		storage.applyWal(storage.getSourceName(), _fd);
 	}
 
@@ -112,18 +124,30 @@ bool Transaction::open(const Storage &storage, OpenMode mode) {
 	return false;
 }
 
-void Transaction::close() {
+bool Transaction::close() {
+	bool success = _success;
+	uint64_t walGeneration = 0;
 	if (_fd) {
 		if (_pageCache) {
-			_pageCache->clear(*this, _success);
+			if (!_pageCache->clear(*this, _success)) {
+				success = false;
+			}
+			walGeneration = _pageCache->getWalGeneration();
 			delete _pageCache;
 			_pageCache = nullptr;
 		}
 		_fd.close();
 	}
+	_writeLock.close();
 	if (_storage) {
+		// wait for WAL sync without write lock, so, next writers can commit into the same sync group
+		if (walGeneration) {
+			_storage->waitWal(walGeneration);
+		}
 		_storage = nullptr;
 	}
+	_success = true;
+	return success;
 }
 
 const PageNode * Transaction::openPage(uint32_t idx, OpenMode mode) const {
@@ -151,10 +175,17 @@ void Transaction::invalidate() const {
 	_success = false;
 }
 
-void Transaction::commit() {
+bool Transaction::commit() {
 	if (_success) {
-		_pageCache->clear(*this, true);
+		if (!_pageCache->clear(*this, true)) {
+			// transaction state is not consistent with storage anymore, all next changes will be dropped
+			_success = false;
+			return false;
+		}
+		// WAL sync is awaited in close(), when write lock is released, so, other writers can share it
+		return true;
 	}
+	return false;
 }
 
 void Transaction::unlink() {
@@ -284,12 +315,44 @@ size_t Transaction::validateIndex(const SchemeCell &schemeCell, const IndexCell
 	size_t ret = 0;
 	mem::Vector<int64_t> unique;
 	mem::Vector<uint64_t> values; values.reserve(schemeCell.counter);
+	mem::Bytes prevKey;
+	uint32_t prevSize = 0;
 	while (firstPage != UndefinedPage) {
 		if (auto page = openPage(firstPage, OpenMode::Read)) {
 			auto h = (const IntIndexContentPageHeader *)page->bytes.data();
 			firstPage = h->next;
 
 			ret += h->ncells;
+			if (page->type == PageType::BytIndexContent) {
+				// keys should be ordered by stored bytes, then by full size; only keys within limit can be checked for uniqueness
+				auto begin = (const BytesIndexPayload *)(page->bytes.data() + sizeof(BytIndexContentPageHeader));
+				auto end = begin + h->ncells;
+				for (; begin != end; ++ begin) {
+					auto key = getIndexKey(page->bytes.data(), begin->offset, begin->size);
+					if (!values.empty()) {
+						auto cmp = compareIndexKeys(mem::BytesView(prevKey.data(), prevKey.size()), key);
+						if (cmp > 0 || (cmp == 0 && prevSize > begin->size)) {
+							closePage(page);
+							return 0;
+						} else if (cmp == 0 && checkUnique && begin->size < BytesIndexKeyLimit) {
+							std::cout << "Non-Unique value: " << mem::StringView((const char *)key.data(), key.size()) << "\n";
+							closePage(page);
+							return 0;
+						}
+					}
+
+					prevKey.assign(key.data(), key.data() + key.size());
+					prevSize = begin->size;
+
+					auto lb = std::lower_bound(values.begin(), values.end(), begin->position.value);
+					if (lb == values.end() || *lb != begin->position.value) {
+						values.emplace(lb, begin->position.value);
+					}
+				}
+				closePage(page);
+				continue;
+			}
+
 			auto begin = (const IntegerIndexPayload *)(page->bytes.data() + sizeof(IntIndexContentPageHeader));
 			auto end = begin + h->ncells;
 
@@ -470,7 +533,7 @@ bool Transaction::foreach(Worker &worker, const db::Query &query, const mem::Cal
 		if (it && it != stack.frames.back().end()) {
 			if (auto cell = stack.getOidCell(*(OidPosition *)it.data)) {
 				auto names = Transaction_getQueryName(worker, query);
-				auto v = decodeValue(worker.scheme(), cell, names);
+				auto v = decodeValue(worker.scheme(), *(OidPosition *)it.data, cell, names);
 				return cb(v);
 			}
 		}
@@ -488,7 +551,7 @@ bool Transaction::foreach(Worker &worker, const db::Query &query, const mem::Cal
 				if (auto cell = stack.getOidCell(targetPage, h, false)) {
 					mem::pool::push(orig);
 					do {
-						auto val = decodeValue(worker.scheme(), cell, names);
+						auto val = decodeValue(worker.scheme(), pos, cell, names);
 						if (!cb(val)) {
 							return false;
 						}
@@ -532,7 +595,7 @@ mem::Value Transaction::select(Worker &worker, const db::Query &query) {
 		if (it && it != stack.frames.back().end()) {
 			if (auto cell = stack.getOidCell(*(OidPosition *)it.data)) {
 				auto names = Transaction_getQueryName(worker, query);
-				return mem::Value({ decodeValue(worker.scheme(), cell, names) });
+				return mem::Value({ decodeValue(worker.scheme(), *(OidPosition *)it.data, cell, names) });
 			}
 		}
 	} else if (!query.getSelectAlias().empty()) {
@@ -549,7 +612,7 @@ mem::Value Transaction::select(Worker &worker, const db::Query &query) {
 				if (auto cell = stack.getOidCell(targetPage, h, false)) {
 					mem::pool::push(orig);
 					do {
-						auto val = decodeValue(worker.scheme(), cell, names);
+						auto val = decodeValue(worker.scheme(), pos, cell, names);
 						ret.addValue(std::move(val));
 					} while (0);
 					mem::pool::pop();
@@ -753,16 +816,30 @@ mem::Value Transaction::create(Worker &worker, mem::Value &idata) {
 	return mem::Value();
 }
 
-mem::Value Transaction::save(Worker &, uint64_t oid, const mem::Value &obj, const mem::Vector<mem::String> &fields) {
-	return mem::Value();
+mem::Value Transaction::save(Worker &worker, uint64_t oid, const mem::Value &obj, const mem::Vector<mem::String> &fields) {
+	if (!obj.isDictionary()) {
+		return mem::Value();
+	}
+
+	mem::Value patch;
+	if (fields.empty()) {
+		for (auto &it : obj.asDict()) {
+			patch.setValue(it.second, it.first);
+		}
+	} else {
+		for (auto &it : fields) {
+			patch.setValue(obj.getValue(it), it);
+		}
+	}
+	return patchValue(worker.scheme(), oid, patch, &worker);
 }
 
 mem::Value Transaction::patch(Worker &worker, uint64_t target, const mem::Value &patch) {
-	return mem::Value();
+	return patchValue(worker.scheme(), target, patch, &worker);
 }
 
-bool Transaction::remove(Worker &, uint64_t oid) {
-	return false;
+bool Transaction::remove(Worker &worker, uint64_t oid) {
+	return removeValue(worker.scheme(), oid);
 }
 
 size_t Transaction::count(Worker &worker, const db::Query &query) {
@@ -812,6 +889,17 @@ size_t Transaction::count(Worker &worker, const db::Query &query) {
 	return 0;
 }
 
+static mem::BytesView Transaction_getIndexBytes(const mem::Value &val) {
+	if (val.isString()) {
+		auto &str = val.getString();
+		return mem::BytesView((const uint8_t *)str.data(), str.size());
+	} else if (val.isBytes()) {
+		auto &bytes = val.getBytes();
+		return mem::BytesView(bytes.data(), bytes.size());
+	}
+	return mem::BytesView();
+}
+
 bool Transaction::fillIndexMap(IndexMap &map, const Worker *worker, const Scheme &scheme, const mem::Value &value) const {
 	auto schemeData = _storage->getSchemes().find(&scheme);
 	if (schemeData == _storage->getSchemes().end()) {
@@ -819,10 +907,31 @@ bool Transaction::fillIndexMap(IndexMap &map, const Worker *worker, const Scheme
 	}
 
 	map.scheme = schemeData->second.first;
+	map.target = &scheme;
 
 	for (auto &it : scheme.getFields()) {
 		if (it.second.isIndexed()) {
-			if (it.second.getType() == Type::Integer) {
+			if (it.second.getType() == Type::Text || it.second.getType() == Type::Bytes) {
+				auto &v = value.getValue(it.second.getName());
+				if (v.isString() || v.isBytes()) {
+					auto idxData = schemeData->second.second.find(&it.second);
+					if (idxData != schemeData->second.second.end()) {
+						auto bytes = Transaction_getIndexBytes(v);
+						map.bytesValues.emplace_back(idxData->second, mem::Bytes(bytes.data(), bytes.data() + bytes.size()));
+						if (it.second.hasFlag(Flags::Unique)) {
+							map.bytesUniques.emplace_back(idxData->second, v);
+							if (worker) {
+								auto &c = worker->getConflicts();
+								auto cit = c.find(&it.second);
+								if (cit != c.end()) {
+									map.conflicts.emplace(idxData->second, &(cit->second));
+								}
+							}
+						}
+						map.fields.emplace(idxData->second, &(it.second));
+					}
+				}
+			} else if (it.second.getType() == Type::Integer) {
 				if (value.isInteger(it.second.getName())) {
 					auto idxData = schemeData->second.second.find(&it.second);
 					if (idxData != schemeData->second.second.end()) {
@@ -909,14 +1018,18 @@ void Transaction::pushIndexMap(TreeStack &stack, const IndexMap &map, const OidC
 	for (auto &it : map.integerValues) {
 		_pageCache->addIndexValue(it.first, OidPosition{cell.page, cell.offset, cell.header->oid.value}, it.second);
 	}
+	for (auto &it : map.bytesValues) {
+		_pageCache->addIndexValue(it.first, OidPosition{cell.page, cell.offset, cell.header->oid.value},
+				mem::BytesView(it.second.data(), it.second.size()));
+	}
 }
 
 bool Transaction::checkUnique(const IndexMap &map) const { // false is unique value found
-	if (map.integerUniques.empty()) {
+	if (map.integerUniques.empty() && map.bytesUniques.empty()) {
 		return true;
 	}
 
-	auto pushFail = [&map] (const OidPosition &pos, int64_t value) {
+	auto pushFail = [&map] (const OidPosition &pos, const auto &value) {
 		auto f = map.fields.find(pos);
 		if (f == map.fields.end()) {
 			return false;
@@ -961,6 +1074,43 @@ bool Transaction::checkUnique(const IndexMap &map) const { // false is unique va
 			closePage(indexPage);
 		}
 	}
+
+	for (auto &it : map.bytesUniques) {
+		auto f = map.fields.find(it.first);
+		if (f == map.fields.end() || !map.target) {
+			continue;
+		}
+
+		auto failValue = it.second.isString() ? mem::StringView(it.second.getString()) : mem::StringView("(bytes)");
+
+		Query::Select tmp("NONE", db::Comparation::Equal, mem::Value(it.second), mem::Value());
+		const Query::Select *tmpPtr = &tmp;
+		auto vec = stappler::makeSpanView(&tmpPtr, 1);
+
+		// objects, created within this transaction, are not in index pages yet; only truncated keys are ambiguous
+		auto bytes = Transaction_getIndexBytes(it.second);
+		for (auto &pos : _pageCache->getIndexValues(it.first, bytes)) {
+			if (bytes.size() < BytesIndexKeyLimit || checkBytesValue(*map.target, *f->second, pos, vec)) {
+				return pushFail(it.first, failValue);
+			}
+		}
+
+		if (auto indexPage = openPage(it.first.page, OpenMode::Write)) {
+			auto d = (IndexCell *)(indexPage->bytes.data() + it.first.offset);
+			if (d->oid.value == it.first.value) {
+				bool found = false;
+				performBytesIndexScan(stack, *map.target, *f->second, *d, vec, db::Ordering::Ascending, [&] (const OidPosition &pos) -> bool {
+					found = true;
+					return false;
+				});
+				if (found) {
+					closePage(indexPage);
+					return pushFail(it.first, failValue);
+				}
+			}
+			closePage(indexPage);
+		}
+	}
 	return true;
 }
 
@@ -1135,6 +1285,175 @@ static void Transaction_getIndexHints(mem::SpanView<const Query::Select *> vec,
 	}
 }
 
+static bool Transaction_checkBytesVec(mem::BytesView value, mem::SpanView<const Query::Select *> vec) {
+	for (auto &it : vec) {
+		if (it->value1.isString() || it->value1.isBytes()) {
+			auto v1 = Transaction_getIndexBytes(it->value1);
+			auto v2 = Transaction_getIndexBytes(it->value2);
+			switch (it->compare) {
+			case Comparation::LessThen: if (! (compareIndexKeys(value, v1) < 0) ) { return false; } break;
+			case Comparation::LessOrEqual: if (! (compareIndexKeys(value, v1) <= 0) ) { return false; } break;
+			case Comparation::Equal: if (! (compareIndexKeys(value, v1) == 0) ) { return false; } break;
+			case Comparation::NotEqual: if (! (compareIndexKeys(value, v1) != 0) ) { return false; } break;
+			case Comparation::GreatherOrEqual: if (! (compareIndexKeys(value, v1) >= 0) ) { return false; } break;
+			case Comparation::GreatherThen: if (! (compareIndexKeys(value, v1) > 0) ) { return false; } break;
+			case Comparation::BetweenValues:
+				if (! (compareIndexKeys(value, v1) > 0 && compareIndexKeys(value, v2) < 0) ) { return false; } break;
+			case Comparation::Between:
+			case Comparation::BetweenEquals:
+				if (! (compareIndexKeys(value, v1) >= 0 && compareIndexKeys(value, v2) <= 0) ) { return false; } break;
+			case Comparation::NotBetweenValues:
+				if (! (compareIndexKeys(value, v1) < 0 || compareIndexKeys(value, v2) > 0) ) { return false; } break;
+			case Comparation::NotBetweenEquals:
+				if (! (compareIndexKeys(value, v1) <= 0 || compareIndexKeys(value, v2) >= 0) ) { return false; } break;
+			case Comparation::Prefix:
+				if (! (value.size() >= v1.size() && memcmp(value.data(), v1.data(), v1.size()) == 0) ) { return false; } break;
+			case Comparation::Suffix:
+				if (! (value.size() >= v1.size() && memcmp(value.data() + value.size() - v1.size(), v1.data(), v1.size()) == 0) ) { return false; } break;
+
+			case Comparation::In:
+			case Comparation::NotIn:
+			case Comparation::Invalid:
+			case Comparation::Includes:
+			case Comparation::IsNull:
+			case Comparation::IsNotNull:
+			case Comparation::WordPart:
+				std::cout << "Comparation not implemented: " << stappler::toInt(it->compare) << "\n";
+				return false;
+				break;
+			}
+		} else if (it->value1.isArray()) {
+			switch (it->compare) {
+			case Comparation::Equal:
+			case Comparation::In:
+			case Comparation::NotEqual:
+			case Comparation::NotIn: {
+				bool found = false;
+				for (auto &i : it->value1.asArray()) {
+					if (compareIndexKeys(value, Transaction_getIndexBytes(i)) == 0) {
+						found = true;
+						break;
+					}
+				}
+				if (found != (it->compare == Comparation::Equal || it->compare == Comparation::In)) {
+					return false;
+				}
+				break;
+			}
+			default:
+				std::cout << "Comparation not implemented: " << stappler::toInt(it->compare) << "\n";
+				return false;
+				break;
+			}
+		} else {
+			std::cout << "Invalid value type for: " << it->value1 << "\n";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// key range of string or bytes index scan; prefix bound is a key, that limits only first bytes of index keys
+struct Transaction_KeyBound {
+	mem::BytesView key;
+	bool prefix = false;
+};
+
+struct Transaction_KeyHints {
+	bool hasLower = false;
+	mem::BytesView lower; // greatest lower bound
+	mem::Vector<Transaction_KeyBound> upper;
+	mem::Vector<mem::Bytes> data;
+
+	void addLower(mem::BytesView key) {
+		if (!hasLower || compareIndexKeys(key, lower) > 0) {
+			lower = key;
+			hasLower = true;
+		}
+	}
+
+	void addUpper(mem::BytesView key, bool prefix) {
+		upper.emplace_back(Transaction_KeyBound{key, prefix});
+	}
+
+	// index key is above one of upper bounds, so, it and all keys after it can not satisfy selects;
+	// truncated key is a prefix of actual value, so, it's above bound only if actual value is
+	bool isAbove(mem::BytesView key) const {
+		for (auto &it : upper) {
+			if (it.prefix) {
+				if (compareIndexKeys(mem::BytesView(key.data(), std::min(key.size(), it.key.size())), it.key) > 0) {
+					return true;
+				}
+			} else if (compareIndexKeys(key, it.key) > 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool isBelow(mem::BytesView key) const {
+		return hasLower && compareIndexKeys(key, getIndexKey(lower)) < 0;
+	}
+
+	// start for backward scan: no key, that satisfies selects, is stored after it; keys with prefix are bounded with
+	// prefix, padded with 0xFF to stored key size
+	bool getUpperKey(mem::BytesView &ret) {
+		bool found = false;
+		for (auto &it : upper) {
+			auto key = getIndexKey(it.key);
+			if (it.prefix && key.size() < BytesIndexKeyLimit) {
+				auto &b = data.emplace_back(key.data(), key.data() + key.size());
+				b.resize(BytesIndexKeyLimit, 0xFF);
+				key = mem::BytesView(b.data(), b.size());
+			}
+			if (!found || compareIndexKeys(key, ret) < 0) {
+				ret = key;
+				found = true;
+			}
+		}
+		return found;
+	}
+};
+
+static void Transaction_getBytesIndexHints(mem::SpanView<const Query::Select *> vec, Transaction_KeyHints &hints) {
+	for (auto &it : vec) {
+		if (!it->value1.isString() && !it->value1.isBytes()) {
+			continue;
+		}
+
+		auto v1 = Transaction_getIndexBytes(it->value1);
+		switch (it->compare) {
+		case Comparation::Equal:
+			hints.addLower(v1);
+			hints.addUpper(v1, false);
+			break;
+		case Comparation::Prefix:
+			hints.addLower(v1);
+			hints.addUpper(v1, true);
+			break;
+		case Comparation::LessThen:
+		case Comparation::LessOrEqual:
+			hints.addUpper(v1, false);
+			break;
+		case Comparation::GreatherOrEqual:
+		case Comparation::GreatherThen:
+			hints.addLower(v1);
+			break;
+		case Comparation::BetweenValues:
+		case Comparation::Between:
+		case Comparation::BetweenEquals:
+			hints.addLower(v1);
+			if (it->value2.isString() || it->value2.isBytes()) {
+				hints.addUpper(Transaction_getIndexBytes(it->value2), false);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
 bool Transaction::performSelectList(TreeStack &stack, const Scheme &scheme, const db::Query &query,
 		const mem::Callback<bool(const OidPosition &)> &cb) const {
 	auto schemeCell = getSchemeCell(&scheme);
@@ -1209,7 +1528,8 @@ bool Transaction::performSelectList(TreeStack &stack, const Scheme &scheme, cons
 	auto makeOidLists = [&] (mem::StringView ex) {
 		for (auto &it : selectQueries) {
 			if (it.first != ex) {
-				performIndexScan(stack, schemeCell, it.second.cell, it.second.select, Ordering::Ascending, [&] (const OidPosition &pos) -> bool {
+				performIndexScan(stack, scheme, schemeCell, it.second.cell, scheme.getField(it.second.field), it.second.select,
+						Ordering::Ascending, [&] (const OidPosition &pos) -> bool {
 					it.second.oids.emplace_back(pos.value);
 					return true;
 				});
@@ -1238,7 +1558,8 @@ bool Transaction::performSelectList(TreeStack &stack, const Scheme &scheme, cons
 	auto ordIt = selectQueries.find(order);
 	if (ordIt != selectQueries.end()) {
 		makeOidLists(order);
-		performIndexScan(stack, schemeCell, ordIt->second.cell, ordIt->second.select, query.getOrdering(), [&] (const OidPosition &pos) -> bool {
+		performIndexScan(stack, scheme, schemeCell, ordIt->second.cell, scheme.getField(ordIt->second.field), ordIt->second.select,
+				query.getOrdering(), [&] (const OidPosition &pos) -> bool {
 			if (check(pos, ordIt->second.field)) {
 				if (offset > 0) {
 					-- offset;
@@ -1260,7 +1581,7 @@ bool Transaction::performSelectList(TreeStack &stack, const Scheme &scheme, cons
 		if (index.root == UndefinedPage && order != "__oid") {
 			return false;
 		} else {
-			performIndexScan(stack, schemeCell, index, {}, query.getOrdering(), [&] (const OidPosition &pos) -> bool {
+			performIndexScan(stack, scheme, schemeCell, index, scheme.getField(order), {}, query.getOrdering(), [&] (const OidPosition &pos) -> bool {
 				if (check(pos, order)) {
 					if (offset > 0) {
 						-- offset;
@@ -1281,7 +1602,8 @@ bool Transaction::performSelectList(TreeStack &stack, const Scheme &scheme, cons
 		// perform with first queried index
 		auto begin = selectQueries.begin();
 		makeOidLists(begin->second.field);
-		performIndexScan(stack, schemeCell, begin->second.cell, begin->second.select, query.getOrdering(),
+		performIndexScan(stack, scheme, schemeCell, begin->second.cell, scheme.getField(begin->second.field), begin->second.select,
+				query.getOrdering(),
 				[&] (const OidPosition &pos) -> bool {
 			if (check(pos, begin->second.field)) {
 				if (offset > 0) {
@@ -1376,6 +1698,78 @@ bool Transaction::performIndexScan(TreeStack &stack, const SchemeCell &scheme, c
 	return true;
 }
 
+bool Transaction::performIndexScan(TreeStack &stack, const Scheme &scheme, const SchemeCell &schemeCell, const IndexCell &cell,
+		const Field *field, mem::SpanView<const Query::Select *> vec, Ordering ord, const mem::Callback<bool(const OidPosition &)> &cb) const {
+	if (field && cell.root != UndefinedPage && (field->getType() == Type::Text || field->getType() == Type::Bytes)) {
+		return performBytesIndexScan(stack, scheme, *field, cell, vec, ord, cb);
+	}
+	return performIndexScan(stack, schemeCell, cell, vec, ord, cb);
+}
+
+bool Transaction::performBytesIndexScan(TreeStack &stack, const Scheme &scheme, const Field &field, const IndexCell &cell,
+		mem::SpanView<const Query::Select *> vec, Ordering ord, const mem::Callback<bool(const OidPosition &)> &cb) const {
+	if (cell.root == UndefinedPage) {
+		return true;
+	}
+
+	Transaction_KeyHints hints;
+	Transaction_getBytesIndexHints(vec, hints);
+
+	mem::BytesView upper;
+	bool hasUpper = hints.getUpperKey(upper);
+	if (hints.hasLower && hasUpper && compareIndexKeys(getIndexKey(hints.lower), upper) > 0) {
+		return true;
+	}
+
+	// only truncated keys should be checked with actual object value
+	auto check = [&] (const uint8_t *page, const BytesIndexPayload *payload) {
+		if (payload->size < BytesIndexKeyLimit) {
+			return Transaction_checkBytesVec(getIndexKey(page, payload->offset, payload->size), vec);
+		}
+		return checkBytesValue(scheme, field, payload->position, vec);
+	};
+
+	stack.root = cell.root;
+	if (ord == Ordering::Ascending) {
+		auto it = stack.openOnKey(true, hints.lower);
+		while (it) {
+			auto page = it.node->bytes.data();
+			auto payload = (BytesIndexPayload *)it.data;
+			if (hints.isAbove(getIndexKey(page, payload->offset, payload->size))) { return true; }
+			if (check(page, payload)) {
+				if (!cb(payload->position)) {
+					return true;
+				}
+			}
+			it = stack.next(it, true);
+		}
+	} else {
+		auto it = hasUpper ? stack.openOnKey(false, upper) : stack.open(false);
+		while (it) {
+			auto page = it.node->bytes.data();
+			auto payload = (BytesIndexPayload *)it.prev(1).data;
+			if (hints.isBelow(getIndexKey(page, payload->offset, payload->size))) { return true; }
+			if (check(page, payload)) {
+				if (!cb(payload->position)) {
+					return true;
+				}
+			}
+			it = stack.prev(it, true);
+		}
+	}
+	return true;
+}
+
+bool Transaction::checkBytesValue(const Scheme &scheme, const Field &field, const OidPosition &pos,
+		mem::SpanView<const Query::Select *> vec) const {
+	TreeStack stack(*this, _pageCache->getRoot());
+	if (auto cell = stack.getOidCell(pos)) {
+		auto val = decodeValue(scheme, cell, mem::Vector<mem::StringView>({field.getName()}));
+		return Transaction_checkBytesVec(Transaction_getIndexBytes(val.getValue(field.getName())), vec);
+	}
+	return false;
+}
+
 OidPosition Transaction::createValue(const db::Scheme &scheme, mem::Value &data) {
 	IndexMap map;
 	if (!fillIndexMap(map, nullptr, scheme, data)) {
@@ -1409,6 +1803,214 @@ OidPosition Transaction::createValue(const db::Scheme &scheme, mem::Value &data)
 	return oidPosition;
 }
 
+mem::Value Transaction::patchValue(const db::Scheme &scheme, uint64_t oid, const mem::Value &patch, const Worker *worker) {
+	auto schemeCell = getSchemeCell(&scheme);
+	if (schemeCell.root == UndefinedPage || !patch.isDictionary()) {
+		return mem::Value();
+	}
+
+	auto dict = scheme.getCompressDict();
+	auto dictId = _storage->getDictId(&scheme);
+	auto compressed = scheme.isCompressed() || !dict.empty();
+	if (!compressed) {
+		dictId = 0;
+	}
+
+	std::unique_lock<std::shared_mutex> lock(_mutex);
+
+	OidPosition pos;
+	do {
+		TreeStack stack(*this, schemeCell.root);
+		auto it = stack.openOnOid(oid);
+		if (!it || it == stack.frames.back().end()) {
+			return mem::Value();
+		}
+		pos = *(OidPosition *)it.data;
+	} while (0);
+
+	TreeStack stack(*this, _pageCache->getRoot());
+	auto cell = stack.getOidCell(pos, true);
+	if (!cell) {
+		return mem::Value();
+	}
+
+	auto prev = decodeValue(scheme, cell, mem::Vector<mem::StringView>());
+	prev.erase("__oid");
+
+	auto data = prev;
+
+	// new values of indexed fields, that was changed with patch
+	mem::Value changed;
+
+	for (auto &it : patch.asDict()) {
+		auto f = scheme.getField(it.first);
+		if (!f) {
+			continue;
+		}
+
+		if (f->isIndexed() && prev.getValue(it.first) != it.second) {
+			changed.setValue(it.second, it.first);
+		}
+
+		if (it.second.isNull()) {
+			data.erase(it.first);
+		} else if (!compressed && f->hasFlag(db::Flags::Compressed)) {
+			data.setBytes(mem::writeData(it.second, mem::EncodeFormat(mem::EncodeFormat::Cbor,
+					mem::EncodeFormat::LZ4HCCompression)), it.first);
+		} else {
+			data.setValue(it.second, it.first);
+		}
+	}
+
+	IndexMap uniqueMap;
+	if (!fillIndexMap(uniqueMap, worker, scheme, changed) || !checkUnique(uniqueMap)) {
+		return mem::Value();
+	}
+
+	mem::Bytes bytes;
+	OidType type = OidType::Object;
+	if (compressed) {
+		compressData(data, dict, [&] (OidType t, mem::BytesView b) {
+			type = t;
+			bytes.assign(b.data(), b.data() + b.size());
+		});
+	} else {
+		bytes.resize(getPayloadSize(PageType::OidContent, data));
+		writePayload(PageType::OidContent, bytes.data(), data);
+	}
+
+	auto target = pos;
+	if (cell.pages.size() == 1 && bytes.size() <= cell.header->size) {
+		memcpy(uint8_p(cell.pages.front().data()), bytes.data(), bytes.size());
+		cell.header->oid.type = stappler::toInt(type);
+		cell.header->oid.dictId = dictId;
+		cell.header->size = bytes.size();
+	} else {
+		// object grows beyond its cell, so, it's moved into new cell; scheme record and indexes are pointed to new position,
+		// and object keeps its oid within scheme; previous cell is not reclaimed
+		TreeStack cellStack(*this, _pageCache->getRoot());
+		auto newCell = cellStack.emplaceCell(type, OidFlags::None, bytes);
+		if (!newCell) {
+			return mem::Value();
+		}
+		newCell.header->oid.dictId = dictId;
+		target = OidPosition({ newCell.page, newCell.offset, oid });
+
+		TreeStack schemeStack(*this, schemeCell.root);
+		auto it = schemeStack.openOnOid(oid, OpenMode::Write);
+		if (!it || it == schemeStack.frames.back().end()) {
+			invalidate();
+			return mem::Value();
+		}
+		*(OidPosition *)it.data = target;
+	}
+
+	IndexMap prevMap;
+	IndexMap nextMap;
+	if (target.page == pos.page && target.offset == pos.offset) {
+		// object was updated in place, index values for unchanged fields are still valid
+		mem::Value prevChanged;
+		for (auto &it : changed.asDict()) {
+			prevChanged.setValue(prev.getValue(it.first), it.first);
+		}
+		fillIndexMap(prevMap, nullptr, scheme, prevChanged);
+		fillIndexMap(nextMap, nullptr, scheme, changed);
+	} else {
+		fillIndexMap(prevMap, nullptr, scheme, prev);
+		fillIndexMap(nextMap, nullptr, scheme, data);
+	}
+
+	for (auto &it : prevMap.integerValues) {
+		_pageCache->removeIndexValue(it.first, pos, it.second);
+	}
+	for (auto &it : prevMap.bytesValues) {
+		_pageCache->removeIndexValue(it.first, pos, mem::BytesView(it.second.data(), it.second.size()));
+	}
+	for (auto &it : nextMap.integerValues) {
+		_pageCache->addIndexValue(it.first, target, it.second);
+	}
+	for (auto &it : nextMap.bytesValues) {
+		_pageCache->addIndexValue(it.first, target, mem::BytesView(it.second.data(), it.second.size()));
+	}
+
+	data.setInteger(oid, "__oid");
+	if (worker && worker->shouldIncludeNone() && scheme.hasForceExclude()) {
+		for (auto &it : scheme.getFields()) {
+			if (it.second.hasFlag(db::Flags::ForceExclude)) {
+				data.erase(it.second.getName());
+			}
+		}
+	}
+	return data;
+}
+
+bool Transaction::removeValue(const db::Scheme &scheme, uint64_t oid) {
+	auto schemeData = _storage->getSchemes().find(&scheme);
+	if (schemeData == _storage->getSchemes().end()) {
+		return false;
+	}
+
+	std::unique_lock<std::shared_mutex> lock(_mutex);
+	auto schemePage = openPage(schemeData->second.first.page, OpenMode::Write);
+	if (!schemePage) {
+		return false;
+	}
+
+	auto schemeCell = (SchemeCell *)(schemePage->bytes.data() + schemeData->second.first.offset);
+	if (schemeCell->oid.value != schemeData->second.first.value || schemeCell->root == UndefinedPage) {
+		closePage(schemePage);
+		return false;
+	}
+
+	OidPosition pos;
+	do {
+		TreeStack stack(*this, schemeCell->root);
+		auto it = stack.openOnOid(oid, OpenMode::Write);
+		if (!it || it == stack.frames.back().end()) {
+			closePage(schemePage);
+			return false;
+		}
+
+		pos = *(OidPosition *)it.data;
+
+		auto h = (SchemeContentPageHeader *)it.node->bytes.data();
+		auto target = (OidPosition *)it.data;
+		auto end = (OidPosition *)(it.node->bytes.data() + sizeof(SchemeContentPageHeader)) + h->ncells;
+		memmove((void *)target, target + 1, (end - target - 1) * sizeof(OidPosition));
+		h->ncells -= 1;
+		-- schemeCell->counter;
+
+		if (h->ncells == 0) {
+			stack.unlinkPage(&schemeCell->root);
+		}
+	} while (0);
+
+	TreeStack stack(*this, _pageCache->getRoot());
+	if (auto cell = stack.getOidCell(pos)) {
+		IndexMap map;
+		if (fillIndexMap(map, nullptr, scheme, decodeValue(scheme, cell, mem::Vector<mem::StringView>()))) {
+			for (auto &it : map.integerValues) {
+				_pageCache->removeIndexValue(it.first, pos, it.second);
+			}
+			for (auto &it : map.bytesValues) {
+				_pageCache->removeIndexValue(it.first, pos, mem::BytesView(it.second.data(), it.second.size()));
+			}
+		}
+	}
+
+	closePage(schemePage);
+	return true;
+}
+
+mem::Value Transaction::decodeValue(const db::Scheme &scheme, const OidPosition &pos, const OidCell &cell,
+		const mem::Vector<mem::StringView> &names) const {
+	auto ret = decodeValue(scheme, cell, names);
+	if (ret.isDictionary()) {
+		ret.setInteger(pos.value, "__oid");
+	}
+	return ret;
+}
+
 mem::Value Transaction::decodeValue(const db::Scheme &scheme, const OidCell &cell, const mem::Vector<mem::StringView> &names) const {
 	if (OidType(cell.header->oid.type) == OidType::ObjectCompressedWithDictionary) {
 		auto dictId = _storage->getDictId(&scheme);
@@ -1484,7 +2086,7 @@ bool Transaction::foreach(const db::Scheme &scheme, const mem::Function<void(uin
 						if (auto cell = nstack.getOidCell(*pos, false)) {
 							mem::Value *value = nullptr;
 							perform([&] {
-								if (auto c = decodeValue(*scheme, cell, mem::Vector<mem::StringView>())) {
+								if (auto c = decodeValue(*scheme, *pos, cell, mem::Vector<mem::StringView>())) {
 									value = new mem::Value(std::move(c));
 								}
 							}, pool);
@@ -1527,7 +2129,7 @@ bool Transaction::foreach(const db::Scheme &scheme, const mem::Function<void(uin
 					if (auto cell = nstack.getOidCell(*pos, false)) {
 						mem::Value *value = nullptr;
 						perform([&] {
-							if (auto c = decodeValue(scheme, cell, mem::Vector<mem::StringView>())) {
+							if (auto c = decodeValue(scheme, *pos, cell, mem::Vector<mem::StringView>())) {
 								value = new mem::Value(std::move(c));
 							}
 						}, pool);
@@ -31,12 +31,17 @@ namespace db::minidb {
 // Transaction access control:
 //
 // Interprocess:
-//   - only one write (or read-write) transaction per file for all process, or
-//   - multiple read transaction for single file
+//   - only one write (or read-write) transaction per file for all process (serialized with <file>.lock), and
+//   - multiple read transaction for single file, concurrently with writer
 //
 // Threading:
-//   - only one write (or read-write) transaction per file for all threads, or
-//   - multiple read transaction for single file
+//   - only one write (or read-write) transaction per file for all threads, and
+//   - multiple read transaction for single file, concurrently with writer
+//
+// Isolation:
+//   - read transaction works with snapshot, captured on open: storage file with committed WAL pages on top of it
+//   - commit publishes new WAL with atomic rename, readers never see partially committed data
+//   - WAL is merged into storage file only when there is no readers with older snapshots
 //
 // Thread-safe:
 //   - any transaction (read or write) can be used from any thread of single process simultaneously
@@ -51,7 +56,9 @@ public:
 	~Transaction();
 
 	bool open(const Storage &, OpenMode);
-	void close();
+
+	// returns false if transaction was invalidated or changes was not committed
+	bool close();
 
 	const PageNode *openPage(uint32_t idx, OpenMode) const;
 	void closePage(const PageNode *) const;
@@ -71,7 +78,10 @@ public:
 	void setSpawnThread(const mem::Function<void(const mem::Function<void()> &)> &);
 
 	void invalidate() const;
-	void commit();
+
+	// commit changes without closing transaction; on failure transaction is invalidated
+	// in group commit mode, durability is guaranteed only after close()
+	bool commit();
 	void unlink();
 
 	SchemeCell getSchemeCell(const db::Scheme *) const;
@@ -97,8 +107,17 @@ public: // CRUD
 
 	OidPosition createValue(const Scheme &, mem::Value &);
 
+	// update stored object with values from patch (null values erases fields), indexes are updated for changed fields
+	mem::Value patchValue(const Scheme &, uint64_t oid, const mem::Value &patch, const Worker * = nullptr);
+
+	// unlink object from scheme and drop its index values; object cell itself is not reclaimed
+	bool removeValue(const Scheme &, uint64_t oid);
+
 	mem::Value decodeValue(const db::Scheme &scheme, const OidCell &cell, const mem::Vector<mem::StringView> &names) const;
 
+	// object can be moved into new cell on update, so, its oid should be taken from scheme or index record
+	mem::Value decodeValue(const db::Scheme &scheme, const OidPosition &, const OidCell &cell, const mem::Vector<mem::StringView> &names) const;
+
 	// uses SpawnThread, so, configure transaction with setSpawnThread
 	bool foreach(const db::Scheme &scheme, const mem::Function<void(uint64_t, uint64_t, mem::Value &)> &cb,
 			const mem::SpanView<uint64_t> &ids = mem::SpanView<uint64_t>()) const;
@@ -111,8 +130,11 @@ protected:
 
 	struct IndexMap {
 		OidPosition scheme;
+		const Scheme *target = nullptr;
 		mem::Vector<mem::Pair<OidPosition, int64_t>> integerValues;
+		mem::Vector<mem::Pair<OidPosition, mem::Bytes>> bytesValues;
 		mem::Vector<mem::Pair<OidPosition, int64_t>> integerUniques;
+		mem::Vector<mem::Pair<OidPosition, mem::Value>> bytesUniques;
 		mem::Map<OidPosition, const Worker::ConflictData *> conflicts;
 		mem::Map<OidPosition, const Field *> fields;
 	};
@@ -134,9 +156,20 @@ protected:
 	bool performIndexScan(TreeStack &, const SchemeCell &, const IndexCell &, mem::SpanView<const Query::Select *> vec, Ordering,
 			const mem::Callback<bool(const OidPosition &)> &) const;
 
+	// dispatch scan to integer or string/bytes index, based on field type
+	bool performIndexScan(TreeStack &, const Scheme &, const SchemeCell &, const IndexCell &, const Field *,
+			mem::SpanView<const Query::Select *> vec, Ordering, const mem::Callback<bool(const OidPosition &)> &) const;
+
+	bool performBytesIndexScan(TreeStack &, const Scheme &, const Field &, const IndexCell &, mem::SpanView<const Query::Select *> vec,
+			Ordering, const mem::Callback<bool(const OidPosition &)> &) const;
+
+	// check selects against actual field value of stored object
+	bool checkBytesValue(const Scheme &, const Field &, const OidPosition &, mem::SpanView<const Query::Select *>) const;
+
 	mem::pool_t *_pool = nullptr;
 	OpenMode _mode = OpenMode::Read;
 	File _fd;
+	File _writeLock;
 	const Storage *_storage = nullptr;
 	size_t _fileSize = 0;
 	mutable bool _success = true;
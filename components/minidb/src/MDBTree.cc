@@ -105,11 +105,14 @@ TreePageIterator TreeStack::open(bool forward, int64_t hint) {
 						} else {
 							auto it = page.begin();
 							if (it != page.end()) {
-								if (type != PageType::IntIndexTable) {
-									target = ((OidIndexCell *)it.data)->page;
+								if (type == PageType::IntIndexTable) {
+									target = ((IntegerIndexCell *)it.data)->page;
+									frames.emplace_back(page);
+								} else if (type == PageType::BytIndexTable) {
+									target = ((BytesIndexCell *)it.data)->page;
 									frames.emplace_back(page);
 								} else {
-									target = ((IntegerIndexCell *)it.data)->page;
+									target = ((OidIndexCell *)it.data)->page;
 									frames.emplace_back(page);
 								}
 							} else {
@@ -128,6 +131,10 @@ TreePageIterator TreeStack::open(bool forward, int64_t hint) {
 				}
 			} else {
 				frames.emplace_back(TreePage(frame));
+				if (frames.back().getCells() == 0) {
+					// only single leaf of tree can be empty
+					break;
+				}
 				if (forward) {
 					if (hint != stappler::minOf<int64_t>()) {
 						auto it = frames.back().findValue(hint, forward);
@@ -154,6 +161,45 @@ TreePageIterator TreeStack::open(bool forward, int64_t hint) {
 	return TreePageIterator(nullptr);
 }
 
+TreePageIterator TreeStack::openOnKey(bool forward, mem::BytesView hint) {
+	close();
+
+	uint32_t target = root;
+	if (target == UndefinedPage) {
+		return TreePageIterator(nullptr);
+	}
+
+	hint = getIndexKey(hint);
+	while (auto frame = openPage(target, OpenMode::Read)) {
+		auto &page = frames.emplace_back(TreePage(frame));
+		if (frame->type == PageType::BytIndexTable) {
+			target = page.findKeyTargetPage(hint, forward);
+			if (target == UndefinedPage) {
+				break;
+			}
+		} else if (frame->type == PageType::BytIndexContent) {
+			auto it = page.findKey(hint, forward);
+			if (forward) {
+				if (it == page.end()) {
+					// all keys on page are less then hint, continue with next page
+					-- it;
+					it = next(it, true);
+				}
+				return it;
+			} else if (it != page.begin()) {
+				return it;
+			}
+			// all keys on first leaf are greater then hint
+			break;
+		} else {
+			break;
+		}
+	}
+
+	close();
+	return TreePageIterator(nullptr);
+}
+
 bool TreeStack::openLastPage(uint32_t target) {
 	close();
 	auto type = PageType::OidTable;
@@ -467,7 +513,8 @@ static void writeInitialPageInfo(PageType type, mem::BytesView data, uint32_t ro
 		break;
 	case PageType::OidTable:
 	case PageType::SchemeTable:
-	case PageType::IntIndexTable: {
+	case PageType::IntIndexTable:
+	case PageType::BytIndexTable: {
 		auto newPageHeader = (OidTreePageHeader *)data.data();
 		newPageHeader->ncells = 0;
 		newPageHeader->root = root;
@@ -478,7 +525,8 @@ static void writeInitialPageInfo(PageType type, mem::BytesView data, uint32_t ro
 	}
 	case PageType::OidContent:
 	case PageType::SchemeContent:
-	case PageType::IntIndexContent: {
+	case PageType::IntIndexContent:
+	case PageType::BytIndexContent: {
 		auto newPageHeader = (OidContentPageHeader *)data.data();
 		newPageHeader->ncells = 0;
 		newPageHeader->root = root;
@@ -489,6 +537,175 @@ static void writeInitialPageInfo(PageType type, mem::BytesView data, uint32_t ro
 	}
 }
 
+bool TreeStack::replaceBytesIndex(IndexCell *index, mem::SpanView<BytesIndexValue> payload) {
+	struct Child {
+		uint32_t page;
+		mem::BytesView key; // first key of child, stored within written page
+	};
+
+	auto allocNode = [&] (PageType type) -> uint8_p {
+		auto node = allocatePage(type);
+		if (!node) {
+			return nullptr;
+		}
+		auto bytes = frames.emplace_back(node).writableData(*transaction);
+		writeInitialPageInfo(type, bytes);
+		return uint8_p(bytes.data());
+	};
+
+	// leaves are filled in key order and linked into list, cells are limited with cellLimit and free space between
+	// cell array and key heap
+	mem::Vector<Child> children;
+	uint32_t prev = UndefinedPage;
+	while (!payload.empty()) {
+		auto data = allocNode(PageType::BytIndexContent);
+		if (!data) {
+			return false;
+		}
+
+		auto number = frames.back().page->number;
+		auto pageSize = frames.back().page->bytes.size();
+		auto h = (BytIndexContentPageHeader *)data;
+		h->prev = prev;
+		if (prev != UndefinedPage) {
+			((BytIndexContentPageHeader *)(frames[frames.size() - 2].page->bytes.data()))->next = number;
+		}
+
+		auto cells = (BytesIndexPayload *)(data + sizeof(BytIndexContentPageHeader));
+		uint32_t heap = pageSize;
+		while (!payload.empty() && h->ncells < cellLimit) {
+			auto &value = payload.front();
+			auto cellsEnd = uint8_p(cells + h->ncells + 1) - data;
+			if (cellsEnd + value.key.size() > heap) {
+				break;
+			}
+
+			heap -= value.key.size();
+			memcpy(data + heap, value.key.data(), value.key.size());
+			cells[h->ncells].offset = heap;
+			cells[h->ncells].size = value.size;
+			cells[h->ncells].position = value.position;
+			++ h->ncells;
+			payload += 1;
+		}
+
+		children.emplace_back(Child{number, getIndexKey(data, cells->offset, cells->size)});
+		prev = number;
+	}
+
+	// interior levels: each page holds the first child in right pointer, next children are pushed with separator,
+	// and previous rightmost child is moved into new cell
+	while (children.size() > 1) {
+		mem::Vector<Child> parents;
+		auto it = children.begin();
+		while (it != children.end()) {
+			auto data = allocNode(PageType::BytIndexTable);
+			if (!data) {
+				return false;
+			}
+
+			auto number = frames.back().page->number;
+			auto h = (BytIndexTreePageHeader *)data;
+			h->right = it->page;
+			parents.emplace_back(Child{number, it->key});
+			++ it;
+
+			auto cells = (BytesIndexCell *)(data + sizeof(BytIndexTreePageHeader));
+			uint32_t heap = frames.back().page->bytes.size();
+			while (it != children.end() && h->ncells < cellLimit) {
+				auto cellsEnd = uint8_p(cells + h->ncells + 1) - data;
+				if (cellsEnd + it->key.size() > heap) {
+					break;
+				}
+
+				heap -= it->key.size();
+				memcpy(data + heap, it->key.data(), it->key.size());
+				cells[h->ncells].page = h->right;
+				cells[h->ncells].offset = heap;
+				cells[h->ncells].size = it->key.size();
+				h->right = it->page;
+				++ h->ncells;
+				++ it;
+			}
+		}
+		children = std::move(parents);
+	}
+
+	index->root = children.empty() ? UndefinedPage : children.front().page;
+	return true;
+}
+
+bool TreeStack::unlinkPage(uint32_t *rootPageLocation) {
+	if (frames.size() < 2) {
+		return false;
+	}
+
+	auto unlink = [&] (TreePage &page) {
+		auto h = (OidContentPageHeader *)page.writableData(*transaction).data();
+		if (h->prev != UndefinedPage) {
+			if (auto prev = openPage(h->prev, OpenMode::Write)) {
+				((OidContentPageHeader *)prev->bytes.data())->next = h->next;
+			}
+		}
+		if (h->next != UndefinedPage) {
+			if (auto next = openPage(h->next, OpenMode::Write)) {
+				((OidContentPageHeader *)next->bytes.data())->prev = h->prev;
+			}
+		}
+		transaction->getPageCache()->releasePage(page.page->number);
+		return page.page->number;
+	};
+
+	auto target = unlink(frames.back());
+	auto level = frames.size() - 1;
+	while (level > 0) {
+		-- level;
+		auto &parent = frames[level];
+		auto type = parent.getType();
+		if (type != PageType::OidTable && type != PageType::SchemeTable) {
+			return false;
+		}
+
+		auto offset = (parent.page->number == 0) ? sizeof(StorageHeader) : 0;
+		auto bytes = parent.writableData(*transaction);
+		auto h = (OidTreePageHeader *)(bytes.data() + offset);
+		auto begin = (OidIndexCell *)(bytes.data() + offset + sizeof(OidTreePageHeader));
+		auto end = begin + h->ncells;
+
+		// separator of cell is the first oid of the next child, so, with dropped cell, range of removed child is
+		// merged into next one; for rightmost child, last cell becomes rightmost
+		if (h->right == target) {
+			if (h->ncells > 0) {
+				h->right = (end - 1)->page;
+				-- h->ncells;
+			} else {
+				h->right = UndefinedPage;
+			}
+		} else {
+			auto cell = std::find_if(begin, end, [&] (const OidIndexCell &c) { return c.page == target; });
+			if (cell == end) {
+				return false;
+			}
+			memmove((void *)cell, cell + 1, (end - cell - 1) * sizeof(OidIndexCell));
+			-- h->ncells;
+		}
+
+		if (h->right != UndefinedPage) {
+			if (level == 0 && h->ncells == 0 && offset == 0) {
+				if (auto child = openPage(h->right, OpenMode::Write)) {
+					((OidTreePageHeader *)child->bytes.data())->root = UndefinedPage;
+				}
+				*rootPageLocation = h->right;
+				transaction->getPageCache()->releasePage(parent.page->number);
+			}
+			return true;
+		}
+
+		target = unlink(parent);
+	}
+	return true;
+}
+
 TreePage * TreeStack::splitPage(TreePage *page, int64_t oidValue, PageType rootType, uint32_t *rootPageLocation) {
 	auto alloc = [&] (PageType t) -> TreePage {
 		auto page = allocatePage(t);
@@ -620,6 +837,8 @@ static TreePage performRebalance(PageType type, TreePage &leftPage, TreePage &ri
 	case PageType::OidContent:
 	case PageType::SchemeTable:
 	case PageType::SchemeContent:
+	case PageType::BytIndexTable:
+	case PageType::BytIndexContent:
 		std::cout << "Balanced split with invalid page type detected\n";
 		break;
 	}
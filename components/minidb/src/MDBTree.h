@@ -49,6 +49,8 @@ struct TreePageIterator {
 			case PageType::SchemeContent: data = ((OidPosition *)data) + 1; break;
 			case PageType::IntIndexTable: data = ((IntegerIndexCell *)data) + 1; break;
 			case PageType::IntIndexContent: data = ((IntegerIndexPayload *)data) + 1; break;
+			case PageType::BytIndexTable: data = ((BytesIndexCell *)data) + 1; break;
+			case PageType::BytIndexContent: data = ((BytesIndexPayload *)data) + 1; break;
 			default: data = ((OidIndexCell *)data) + 1; break;
 			}
 		}
@@ -65,6 +67,8 @@ struct TreePageIterator {
 			case PageType::SchemeContent: data = ((OidPosition *)data) - 1; break;
 			case PageType::IntIndexTable: data = ((IntegerIndexCell *)data) - 1; break;
 			case PageType::IntIndexContent: data = ((IntegerIndexPayload *)data) - 1; break;
+			case PageType::BytIndexTable: data = ((BytesIndexCell *)data) - 1; break;
+			case PageType::BytIndexContent: data = ((BytesIndexPayload *)data) - 1; break;
 			default: data = ((OidIndexCell *)data) - 1; break;
 			}
 		}
@@ -80,6 +84,8 @@ struct TreePageIterator {
 			case PageType::SchemeContent: return TreePageIterator(node, ((OidPosition *)data) + v, nullptr); break;
 			case PageType::IntIndexTable: return TreePageIterator(node, ((IntegerIndexCell *)data) + v, nullptr); break;
 			case PageType::IntIndexContent: return TreePageIterator(node, ((IntegerIndexPayload *)data) + v, nullptr); break;
+			case PageType::BytIndexTable: return TreePageIterator(node, ((BytesIndexCell *)data) + v, nullptr); break;
+			case PageType::BytIndexContent: return TreePageIterator(node, ((BytesIndexPayload *)data) + v, nullptr); break;
 			default:
 				break;
 			}
@@ -95,6 +101,8 @@ struct TreePageIterator {
 			case PageType::SchemeContent: return TreePageIterator(node, ((OidPosition *)data) - v, nullptr); break;
 			case PageType::IntIndexTable: return TreePageIterator(node, ((IntegerIndexCell *)data) - v, nullptr); break;
 			case PageType::IntIndexContent: return TreePageIterator(node, ((IntegerIndexPayload *)data) - v, nullptr); break;
+			case PageType::BytIndexTable: return TreePageIterator(node, ((BytesIndexCell *)data) - v, nullptr); break;
+			case PageType::BytIndexContent: return TreePageIterator(node, ((BytesIndexPayload *)data) - v, nullptr); break;
 			default:
 				break;
 			}
@@ -134,6 +142,10 @@ struct TreePage {
 	TreePageIterator findValue(int64_t oid, bool forward) const;
 	uint32_t findTargetPage(int64_t oid, bool front = false) const;
 
+	// for string and bytes index pages: lower bound of key for forward search, upper bound for backward
+	TreePageIterator findKey(mem::BytesView, bool forward) const;
+	uint32_t findKeyTargetPage(mem::BytesView, bool forward) const;
+
 	bool pushOidIndex(const Transaction &, uint32_t page, int64_t oid, bool balanced = false);
 
 	int64_t getSplitValue(uint32_t) const;
@@ -159,12 +171,20 @@ struct TreeStack {
 	bool openLastPage(uint32_t);
 	bool openIntegerIndexPage(uint32_t, int64_t, bool front);
 
+	// open string or bytes index: on first key, not less then hint, for forward, or after last key, not greater then hint, for backward
+	TreePageIterator openOnKey(bool forward, mem::BytesView hint);
+
 	void close();
 
 	OidCell pushCell(size_t payloadSize, uint64_t oid);
 	bool addToScheme(SchemeCell *, uint64_t oid, uint32_t page, uint32_t offset);
 	bool addToIntegerIndex(IndexCell *, uint64_t oid, uint32_t page, uint32_t offset, int64_t value);
 	bool replaceIntegerIndex(IndexCell *, mem::SpanView<IntegerIndexPayload>);
+	bool replaceBytesIndex(IndexCell *, mem::SpanView<BytesIndexValue>);
+
+	// unlink empty content page (last frame) from leaf list and from its parent; parents, that become empty, are unlinked
+	// too, and root with single child is replaced with this child; single leaf is kept as tree root
+	bool unlinkPage(uint32_t *rootPageLocation);
 
 	TreePage * splitPage(TreePage *, int64_t oidValue, PageType type, uint32_t *rootPageLocation = nullptr);
 	TreePage * splitPageBalanced(TreePage *, int64_t oidValue, PageType type, uint32_t *rootPageLocation = nullptr);
@@ -45,6 +45,19 @@ uint32_t TreePage::getCells() const {
 	return h->ncells;
 }
 
+// key heap of string and bytes index page grows from page end, so, its start is the lowest key offset
+template <typename T>
+static uint32_t TreePage_getKeyHeapOffset(const PageNode *page, size_t headerSize, uint32_t ncells) {
+	uint32_t ret = page->bytes.size();
+	auto begin = (const T *)(page->bytes.data() + headerSize);
+	auto end = begin + ncells;
+	while (begin != end) {
+		ret = std::min(ret, begin->offset);
+		++ begin;
+	}
+	return ret;
+}
+
 stappler::Pair<size_t, uint32_t> TreePage::getFreeSpace() const {
 	size_t fullSize = page->bytes.size();
 	size_t headerSize = 0;
@@ -91,6 +104,18 @@ stappler::Pair<size_t, uint32_t> TreePage::getFreeSpace() const {
 		fullSize -= h->ncells * sizeof(IntegerIndexPayload);
 		return stappler::pair(fullSize, page->bytes.size() - fullSize);
 		break;
+	case PageType::BytIndexTable: {
+		headerSize = sizeof(BytIndexTreePageHeader) + h->ncells * sizeof(BytesIndexCell);
+		auto heap = TreePage_getKeyHeapOffset<BytesIndexCell>(page, sizeof(BytIndexTreePageHeader), h->ncells);
+		return stappler::pair(heap - headerSize, headerSize);
+		break;
+	}
+	case PageType::BytIndexContent: {
+		headerSize = sizeof(BytIndexContentPageHeader) + h->ncells * sizeof(BytesIndexPayload);
+		auto heap = TreePage_getKeyHeapOffset<BytesIndexPayload>(page, sizeof(BytIndexContentPageHeader), h->ncells);
+		return stappler::pair(heap - headerSize, headerSize);
+		break;
+	}
 	}
 
 	return stappler::pair(0, 0);
@@ -123,6 +148,12 @@ size_t TreePage::getHeaderSize(PageType type) const {
 	case PageType::IntIndexContent:
 		return sizeof(IntIndexContentPageHeader);
 		break;
+	case PageType::BytIndexTable:
+		return sizeof(BytIndexTreePageHeader);
+		break;
+	case PageType::BytIndexContent:
+		return sizeof(BytIndexContentPageHeader);
+		break;
 	}
 
 	return 0;
@@ -160,6 +191,16 @@ TreePageIterator TreePage::begin() const {
 		return TreePageIterator(page, page->bytes.data() + hs, nullptr);
 		break;
 	}
+	case PageType::BytIndexTable: {
+		auto hs = sizeof(BytIndexTreePageHeader);
+		return TreePageIterator(page, page->bytes.data() + hs, nullptr);
+		break;
+	}
+	case PageType::BytIndexContent: {
+		auto hs = sizeof(BytIndexContentPageHeader);
+		return TreePageIterator(page, page->bytes.data() + hs, nullptr);
+		break;
+	}
 	}
 
 	return TreePageIterator(nullptr);
@@ -197,6 +238,16 @@ TreePageIterator TreePage::end() const {
 		return TreePageIterator(page, page->bytes.data() + hs + sizeof(IntegerIndexPayload) * h->ncells, nullptr);
 		break;
 	}
+	case PageType::BytIndexTable: {
+		auto hs = sizeof(BytIndexTreePageHeader);
+		return TreePageIterator(page, page->bytes.data() + hs + sizeof(BytesIndexCell) * h->ncells, nullptr);
+		break;
+	}
+	case PageType::BytIndexContent: {
+		auto hs = sizeof(BytIndexContentPageHeader);
+		return TreePageIterator(page, page->bytes.data() + hs + sizeof(BytesIndexPayload) * h->ncells, nullptr);
+		break;
+	}
 	}
 
 	return TreePageIterator(nullptr);
@@ -363,6 +414,50 @@ uint32_t TreePage::findTargetPage(int64_t value, bool front) const {
 	}
 }
 
+TreePageIterator TreePage::findKey(mem::BytesView key, bool forward) const {
+	auto p = (BytIndexContentPageHeader *)page->bytes.data();
+	if (page->type != PageType::BytIndexContent || p->ncells == 0) {
+		return end();
+	}
+
+	auto data = page->bytes.data();
+	BytesIndexPayload *begin = (BytesIndexPayload *) ( data + sizeof(BytIndexContentPageHeader) );
+	BytesIndexPayload *end = begin + p->ncells;
+	if (forward) {
+		return TreePageIterator(page, std::lower_bound(begin, end, key, [data] (const BytesIndexPayload &l, mem::BytesView r) {
+			return compareIndexKeys(getIndexKey(data, l.offset, l.size), r) < 0;
+		}), nullptr);
+	} else {
+		return TreePageIterator(page, std::upper_bound(begin, end, key, [data] (mem::BytesView l, const BytesIndexPayload &r) {
+			return compareIndexKeys(l, getIndexKey(data, r.offset, r.size)) < 0;
+		}), nullptr);
+	}
+}
+
+uint32_t TreePage::findKeyTargetPage(mem::BytesView key, bool forward) const {
+	auto p = (BytIndexTreePageHeader *)page->bytes.data();
+	if (page->type != PageType::BytIndexTable) {
+		return UndefinedPage;
+	}
+
+	// separator is the first key of next child, and equal keys can span over several children, so,
+	// first child with separator, not less then key, for forward, and first with greater separator for backward
+	auto data = page->bytes.data();
+	BytesIndexCell *begin = (BytesIndexCell *) ( data + sizeof(BytIndexTreePageHeader) );
+	BytesIndexCell *end = begin + p->ncells;
+	BytesIndexCell *cell = nullptr;
+	if (forward) {
+		cell = std::lower_bound(begin, end, key, [data] (const BytesIndexCell &l, mem::BytesView r) {
+			return compareIndexKeys(getIndexKey(data, l.offset, l.size), r) < 0;
+		});
+	} else {
+		cell = std::upper_bound(begin, end, key, [data] (mem::BytesView l, const BytesIndexCell &r) {
+			return compareIndexKeys(l, getIndexKey(data, r.offset, r.size)) < 0;
+		});
+	}
+	return (cell == end) ? p->right : cell->page;
+}
+
 bool TreePage::pushOidIndex(const Transaction &t, uint32_t pageId, int64_t oid, bool balanced) {
 	auto offset = (page->number == 0) ? sizeof(StorageHeader) : 0;
 	auto bytes = writableData(t);
@@ -416,6 +511,8 @@ bool TreePage::pushOidIndex(const Transaction &t, uint32_t pageId, int64_t oid,
 		case PageType::SchemeTable:
 		case PageType::SchemeContent:
 		case PageType::IntIndexContent:
+		case PageType::BytIndexTable:
+		case PageType::BytIndexContent:
 			std::cout << "Balanced split with invalid page type detected\n";
 			return false;
 			break;
@@ -439,6 +536,8 @@ int64_t TreePage::getSplitValue(uint32_t idx) const {
 	case PageType::OidContent:
 	case PageType::SchemeTable:
 	case PageType::SchemeContent:
+	case PageType::BytIndexTable:
+	case PageType::BytIndexContent:
 		std::cout << "Balanced split with invalid page type detected\n";
 		break;
 	}
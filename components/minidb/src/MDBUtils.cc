@@ -60,6 +60,49 @@ uint8_t getPageSizeByte(uint32_t pageSize) {
 	return __builtin_ctz(pageSize);
 }
 
+bool readWalHeader(const File &fd, WalHeader &header) {
+	if (::pread(fd.fd, &header, sizeof(WalHeader), 0) != ssize_t(sizeof(WalHeader))
+			|| memcmp(header.title, WalTitle.data(), WalTitle.size()) != 0 || header.version != WalVersion) {
+		return false;
+	}
+	return true;
+}
+
+bool readWalCommit(const File &fd, uint64_t offset, WalCommit &commit, mem::Vector<WalFrame> &map) {
+	if (::pread(fd.fd, &commit, sizeof(WalCommit), offset) != ssize_t(sizeof(WalCommit))) {
+		return false;
+	}
+
+	// record can be incomplete or overwritten, so, map size should be checked before allocation
+	auto fileSize = fd.seek(0, SEEK_END);
+	if (fileSize < 0 || offset + sizeof(WalCommit) + uint64_t(commit.count) * sizeof(WalFrame) > uint64_t(fileSize)) {
+		return false;
+	}
+
+	mem::Vector<uint8_t> record; record.resize(sizeof(WalCommit) + commit.count * sizeof(WalFrame));
+	auto mapSize = ssize_t(commit.count * sizeof(WalFrame));
+	if (::pread(fd.fd, record.data() + sizeof(WalCommit), mapSize, offset + sizeof(WalCommit)) != mapSize) {
+		return false;
+	}
+
+	auto tmp = commit;
+	tmp.hash = 0;
+	memcpy(record.data(), &tmp, sizeof(WalCommit));
+	if (stappler::hash::hash32((const char *)record.data(), record.size()) != commit.hash) {
+		return false;
+	}
+
+	map.resize(commit.count);
+	memcpy((void *)map.data(), record.data() + sizeof(WalCommit), mapSize);
+	return true;
+}
+
+uint64_t getWalFramesOffset(uint64_t offset, const WalCommit &commit) {
+	uint64_t sysPageSize = getSystemPageSize();
+	offset += sizeof(WalCommit) + uint64_t(commit.count) * sizeof(WalFrame);
+	return (offset + sysPageSize - 1) & ~(sysPageSize - 1);
+}
+
 /*bool validateHeader(const StorageHeader &target, size_t memsize) {
 	if (memcmp(target.title, "minidb", 6) == 0 && target.version == 1 && has_single_bit(target.pageSize)) {
 		if (memsize == target.pageSize * target.pageCount) {
@@ -174,6 +217,25 @@ size_t writeVarUint(uint8_t *p, uint64_t id) {
 	return 0;
 }
 
+int compareIndexKeys(mem::BytesView l, mem::BytesView r) {
+	auto ret = ::memcmp(l.data(), r.data(), std::min(l.size(), r.size()));
+	if (ret == 0 && l.size() != r.size()) {
+		return (l.size() < r.size()) ? -1 : 1;
+	}
+	return ret;
+}
+
+bool operator<(const BytesIndexValue &l, const BytesIndexValue &r) {
+	auto cmp = compareIndexKeys(mem::BytesView(l.key.data(), l.key.size()), mem::BytesView(r.key.data(), r.key.size()));
+	if (cmp != 0) {
+		return cmp < 0;
+	} else if (l.size != r.size) {
+		return l.size < r.size;
+	} else {
+		return l.position.value < r.position.value;
+	}
+}
+
 const mem::Function<void(mem::StringView)> &operator<<(const mem::Function<void(mem::StringView)> &cb, mem::BytesView v) {
 	for (size_t i = 0; i < v.size(); ++ i) {
 		cb << stappler::base16::charToHex(*((const char *)(v.data() + i))) << " ";
@@ -204,6 +266,8 @@ const mem::Function<void(mem::StringView)> &operator << (const mem::Function<voi
 	case PageType::SchemeContent: cb("SchemeContent"); break;
 	case PageType::IntIndexTable: cb("IntIndexTable"); break;
 	case PageType::IntIndexContent: cb("IntIndexContent"); break;
+	case PageType::BytIndexTable: cb("BytIndexTable"); break;
+	case PageType::BytIndexContent: cb("BytIndexContent"); break;
 	default: cb("Unknown"); break;
 	}
 	return cb;
@@ -307,7 +371,8 @@ void inspectTreePage(const InspectOptions &opts, const void *iptr, size_t size,
 			break;
 		case PageType::OidTable:
 		case PageType::SchemeTable:
-		case PageType::IntIndexTable: {
+		case PageType::IntIndexTable:
+		case PageType::BytIndexTable: {
 			auto tree = (OidTreePageHeader *)h;
 			opts.cb << "\t" << WriteData(mem::BytesView(ptr + 4, 4)) << "- " << PageNumber(tree->root) << " - root - (4 - 8)\n";
 			opts.cb << "\t" << WriteData(mem::BytesView(ptr + 8, 4)) << "- " << PageNumber(tree->prev) << " - prev - (8 - 12)\n";
@@ -322,7 +387,8 @@ void inspectTreePage(const InspectOptions &opts, const void *iptr, size_t size,
 		}
 		case PageType::OidContent:
 		case PageType::SchemeContent:
-		case PageType::IntIndexContent: {
+		case PageType::IntIndexContent:
+		case PageType::BytIndexContent: {
 			auto tree = (OidContentPageHeader *)h;
 			opts.cb << "\t" << WriteData(mem::BytesView(ptr + 4, 4)) << "- " << PageNumber(tree->root) << " - root - (4 - 8)\n";
 			opts.cb << "\t" << WriteData(mem::BytesView(ptr + 8, 4)) << "- " << PageNumber(tree->prev) << " - prev - (8 - 12)\n";
@@ -379,6 +445,22 @@ void inspectTreePage(const InspectOptions &opts, const void *iptr, size_t size,
 
 		break;
 	}
+	case PageType::BytIndexTable: {
+		opts.cb << "Cells:\n";
+
+		for (uint32_t i = 0; i < ncells; ++ i) {
+			auto cell = (BytesIndexCell *)ptr;
+			opts.cb << "\t" << WriteData(mem::BytesView((uint8_t *)cell, sizeof(BytesIndexCell)))
+					<< " Cell:  (key) " << WriteData(getIndexKey(uint8_p(iptr), cell->offset, cell->size))
+					<< " (page) " << uint64_t(cell->page) << "\n";
+			ptr += sizeof(BytesIndexCell);
+
+			if (pages) {
+				pages->emplace_back(int64_t(i), uint32_t(cell->page));
+			}
+		}
+		break;
+	}
 	case PageType::OidContent: {
 		opts.cb << "Objects:\n";
 
@@ -499,6 +581,20 @@ void inspectTreePage(const InspectOptions &opts, const void *iptr, size_t size,
 
 		break;
 	}
+	case PageType::BytIndexContent: {
+		opts.cb << "Cells:\n";
+
+		for (uint32_t i = 0; i < ncells; ++ i) {
+			auto cell = (BytesIndexPayload *)ptr;
+			opts.cb << "\t" << WriteData(mem::BytesView((uint8_t *)cell, sizeof(BytesIndexPayload)))
+					<< " Cell:  (key) " << WriteData(getIndexKey(uint8_p(iptr), cell->offset, cell->size))
+					<< " (size) " << uint64_t(cell->size) << "  (oid) " << uint64_t(cell->position.value)
+					<< "  (page) " << uint64_t(cell->position.page)
+					<< "  (offset) " << uint64_t(cell->position.offset) << "\n";
+			ptr += sizeof(BytesIndexPayload);
+		}
+		break;
+	}
 	}
 
 	opts.cb << "\n";
@@ -516,6 +612,8 @@ mem::Map<PageType, uint32_t> inspectPages(const Transaction &t) {
 	ret.emplace(PageType::SchemeTable, 0);
 	ret.emplace(PageType::IntIndexContent, 0);
 	ret.emplace(PageType::IntIndexTable, 0);
+	ret.emplace(PageType::BytIndexContent, 0);
+	ret.emplace(PageType::BytIndexTable, 0);
 
 	auto root = t.getRoot();
 
@@ -566,6 +664,19 @@ mem::Map<PageType, uint32_t> inspectPages(const Transaction &t) {
 					}
 					break;
 				}
+				case PageType::BytIndexTable: {
+					auto h = ((BytIndexTreePageHeader *)ptr);
+					ptr += sizeof(BytIndexTreePageHeader);
+					for (uint32_t i = 0; i < ncells; ++ i) {
+						auto cell = (BytesIndexCell *)ptr;
+						tmp.emplace_back(uint32_t(cell->page));
+						ptr += sizeof(BytesIndexCell);
+					}
+					if (h->right != UndefinedPage) {
+						tmp.emplace_back(h->right);
+					}
+					break;
+				}
 				default:
 					break;
 				}
@@ -638,6 +749,19 @@ static mem::Vector<uint32_t> processContentPages(const Transaction &t, const mem
 				}
 				break;
 			}
+			case PageType::BytIndexTable: {
+				auto h = ((BytIndexTreePageHeader *)ptr);
+				ptr += sizeof(BytIndexTreePageHeader);
+				for (uint32_t i = 0; i < ncells; ++ i) {
+					auto cell = (BytesIndexCell *)ptr;
+					tmp.emplace_back(uint32_t(cell->page));
+					ptr += sizeof(BytesIndexCell);
+				}
+				if (h->right != UndefinedPage) {
+					tmp.emplace_back(h->right);
+				}
+				break;
+			}
 			default:
 				if (ret) {
 					ret->emplace_back(it);
@@ -827,6 +951,24 @@ void File::lock_exclusive() {
 	}
 }
 
+bool File::try_lock_exclusive() {
+	if (fd < 0) {
+		return false;
+	}
+	if (locked == LOCK_EX) {
+		return true;
+	}
+	if (::flock(fd, LOCK_EX | LOCK_NB) == 0) {
+		locked = LOCK_EX;
+		return true;
+	}
+	// lock conversion is not atomic, previous lock can be dropped on failure
+	if (locked == LOCK_SH) {
+		::flock(fd, LOCK_SH);
+	}
+	return false;
+}
+
 void File::unlock() {
 	if (fd >= 0 && locked != LOCK_UN) {
 		::flock(fd, LOCK_UN);
@@ -23,10 +23,28 @@ THE SOFTWARE.
 #include "STRoot.h"
 #include "MDBStorage.h"
 #include "MDBTransaction.h"
+#include "MDBHandle.h"
+
+#include <random>
+#include <sys/wait.h>
 
 namespace stappler {
 
-static constexpr auto HELP_STRING = "MiniDB Test\n";
+static constexpr auto HELP_STRING =
+R"HelpString(MiniDB Test
+Options:
+	--bench mvcc - run concurrent readers against single writer
+	--bench commit - run concurrent writers to measure commit throughput
+	--test wal - check that committed data survives process crash and WAL replay, that failed WAL write is reported, and that long reader can not postpone merge past WAL limit
+	--test commit - check that commits from concurrent writers share WAL syncs in group commit mode
+	--test index - check that string and integer indexes are maintained on create, update and remove
+	--readers <n> - number of reader threads (default: 4)
+	--writers <n> - number of writer threads (default: 4)
+	--writes <n> - number of write transactions or inserted rows (default: 1000)
+	--cache <bytes> - page cache budget per transaction
+	--commit <sync|group|relaxed> - WAL commit mode (default: sync)
+	--window <ms> - durability window for relaxed commit mode (default: 10)
+)HelpString";
 
 static constexpr auto s_config = R"Config({
 	"listen": "127.0.0.1:8080",
@@ -59,13 +77,696 @@ int parseOptionSwitch(data::Value &ret, char c, const char *str) {
 	return 1;
 }
 
-int parseOptionString(data::Value &ret, StringView str, int argc, const char * argv[]) {
+int parseOptionString(data::Value &ret, const StringView &str, int argc, const char * argv[]) {
 	if (str == "help") {
 		ret.setBool(true, "help");
+	} else if (str == "bench" && argc > 0) {
+		ret.setString(argv[0], "bench");
+		return 2;
+	} else if (str == "test" && argc > 0) {
+		ret.setString(argv[0], "test");
+		return 2;
+	} else if (str == "readers" && argc > 0) {
+		ret.setInteger(StringView(argv[0]).readInteger().get(), "readers");
+		return 2;
+	} else if (str == "writers" && argc > 0) {
+		ret.setInteger(StringView(argv[0]).readInteger().get(), "writers");
+		return 2;
+	} else if (str == "commit" && argc > 0) {
+		ret.setString(argv[0], "commit");
+		return 2;
+	} else if (str == "window" && argc > 0) {
+		ret.setInteger(StringView(argv[0]).readInteger().get(), "window");
+		return 2;
+	} else if (str == "writes" && argc > 0) {
+		ret.setInteger(StringView(argv[0]).readInteger().get(), "writes");
+		return 2;
+	} else if (str == "cache" && argc > 0) {
+		ret.setInteger(StringView(argv[0]).readInteger().get(), "cache");
+		return 2;
 	}
 	return 1;
 }
 
+// Single writer commits small objects one per transaction, while reader threads continuously open
+// snapshots and lookup random objects; readers should not wait for writer's commits
+static void runMvccBenchmark(db::minidb::Storage *storage, const db::Scheme &scheme, size_t nReaders, size_t nWrites) {
+	std::atomic<bool> finalized(false);
+	std::atomic<uint64_t> lastOid(0);
+	std::atomic<size_t> reads(0);
+	std::atomic<size_t> found(0);
+	std::atomic<uint64_t> readTime(0);
+	std::atomic<uint64_t> maxReadTime(0);
+
+	auto readerFn = [&] (size_t idx) {
+		auto pool = memory::pool::create((memory::pool_t *)nullptr);
+		memory::pool::push(pool);
+
+		std::mt19937_64 rng(idx);
+		while (!finalized.load()) {
+			auto t = Time::now();
+			db::minidb::Transaction transaction;
+			if (transaction.open(*storage, db::minidb::OpenMode::Read)) {
+				memory::pool::push(transaction.getPool());
+				do {
+					db::minidb::TreeStack stack(transaction, transaction.getRoot());
+					auto max = lastOid.load();
+					for (size_t i = 0; i < 16 && max > 0; ++ i) {
+						if (stack.openOnOid(rng() % max + 1)) {
+							++ found;
+						}
+					}
+				} while (0);
+				memory::pool::pop();
+				transaction.close();
+			}
+			auto dt = (Time::now() - t).toMicros();
+			readTime += dt;
+			auto prev = maxReadTime.load();
+			while (prev < dt && !maxReadTime.compare_exchange_weak(prev, dt)) { }
+			++ reads;
+		}
+
+		memory::pool::pop();
+		memory::pool::destroy(pool);
+	};
+
+	db::mem::Vector<std::thread> readers;
+	for (size_t i = 0; i < nReaders; ++ i) {
+		readers.emplace_back(readerFn, i);
+	}
+
+	auto pool = memory::pool::create((memory::pool_t *)nullptr);
+	memory::pool::push(pool);
+
+	auto t = Time::now();
+	for (size_t i = 0; i < nWrites; ++ i) {
+		db::minidb::Transaction transaction;
+		if (transaction.open(*storage, db::minidb::OpenMode::Write)) {
+			memory::pool::push(transaction.getPool());
+			db::mem::Value val;
+			val.setString(toString("key", i), "key");
+			val.setInteger(Time::now().toMicros(), "time");
+			val.setValue(db::mem::Value{ db::mem::Value("data"), db::mem::Value(int64_t(i)) }, "data");
+			auto pos = transaction.createValue(scheme, val);
+			memory::pool::pop();
+			transaction.close();
+			if (pos.value) {
+				lastOid.store(pos.value);
+			}
+		}
+	}
+	auto dt = Time::now() - t;
+
+	finalized.store(true);
+	for (auto &it : readers) {
+		it.join();
+	}
+
+	auto totalTime = std::max(dt.toMicros(), uint64_t(1));
+	std::cout << "Readers: " << nReaders << " Writes: " << nWrites << " Time: " << dt.toMicros() << "mks"
+			<< " Commits/sec: " << size_t(nWrites * 1'000'000.0 / totalTime)
+			<< " Snapshots/sec: " << size_t(reads.load() * 1'000'000.0 / totalTime)
+			<< " Found: " << found.load()
+			<< " Avg read: " << readTime.load() / std::max(reads.load(), size_t(1)) << "mks"
+			<< " Max read: " << maxReadTime.load() << "mks\n";
+
+	auto stats = storage->getCacheStats();
+	std::cout << "Page cache: " << storage->getParams().cacheSize << " bytes"
+			<< " Hits: " << stats.hits << " Misses: " << stats.misses << " Evictions: " << stats.evictions
+			<< " Hit ratio: " << (stats.hits * 100 / std::max(stats.hits + stats.misses, size_t(1))) << "%\n";
+
+	memory::pool::pop();
+	memory::pool::destroy(pool);
+}
+
+// Writer threads commit small objects one per transaction; with group or relaxed commit mode
+// number of fsyncs should be significantly lower then number of commits
+static void runCommitBenchmark(db::minidb::Storage *storage, const db::Scheme &scheme, size_t nWriters, size_t nWrites) {
+	std::atomic<size_t> writes(0);
+
+	auto writerFn = [&] (size_t idx) {
+		auto pool = memory::pool::create((memory::pool_t *)nullptr);
+		memory::pool::push(pool);
+
+		while (true) {
+			auto i = writes.fetch_add(1);
+			if (i >= nWrites) {
+				break;
+			}
+
+			db::minidb::Transaction transaction;
+			if (transaction.open(*storage, db::minidb::OpenMode::Write)) {
+				memory::pool::push(transaction.getPool());
+				db::mem::Value val;
+				val.setString(toString("key", i), "key");
+				val.setInteger(Time::now().toMicros(), "time");
+				val.setValue(db::mem::Value{ db::mem::Value("data"), db::mem::Value(int64_t(idx)) }, "data");
+				transaction.createValue(scheme, val);
+				memory::pool::pop();
+				transaction.close();
+			}
+		}
+
+		memory::pool::pop();
+		memory::pool::destroy(pool);
+	};
+
+	auto initial = storage->getCommitStats();
+
+	auto t = Time::now();
+	db::mem::Vector<std::thread> writers;
+	for (size_t i = 0; i < nWriters; ++ i) {
+		writers.emplace_back(writerFn, i);
+	}
+	for (auto &it : writers) {
+		it.join();
+	}
+	auto dt = Time::now() - t;
+
+	auto stats = storage->getCommitStats();
+	auto commits = stats.commits - initial.commits;
+	auto fsyncs = stats.fsyncs - initial.fsyncs;
+
+	auto totalTime = std::max(dt.toMicros(), uint64_t(1));
+	std::cout << "Writers: " << nWriters << " Writes: " << nWrites << " Time: " << dt.toMicros() << "mks"
+			<< " Commits: " << commits << " Fsyncs: " << fsyncs
+			<< " Commits/sec: " << size_t(commits * 1'000'000.0 / totalTime)
+			<< " Fsyncs/sec: " << size_t(fsyncs * 1'000'000.0 / totalTime)
+			<< " Commits per fsync: " << (commits / std::max(fsyncs, size_t(1))) << "\n";
+}
+
+static bool checkOids(db::minidb::Storage *storage, const db::mem::Vector<uint64_t> &oids, bool expected) {
+	bool success = false;
+	db::minidb::Transaction transaction;
+	if (transaction.open(*storage, db::minidb::OpenMode::Read)) {
+		success = true;
+		do {
+			db::minidb::TreeStack stack(transaction, transaction.getRoot());
+			for (auto &it : oids) {
+				if (bool(stack.openOnOid(it)) != expected) {
+					std::cout << "Object " << it << (expected ? " not found\n" : " should not exist\n");
+					success = false;
+				}
+			}
+		} while (0);
+		transaction.close();
+	}
+	return success;
+}
+
+// Child process commits objects in group commit mode, then exits without closing storage, so WAL is not merged;
+// all objects should be available after reopen, and after WAL is merged by next writer
+static bool runWalTest(db::mem::pool_t *pool, const db::mem::Map<db::mem::StringView, const db::Scheme *> &schemes,
+		const db::Scheme &scheme, size_t nWrites) {
+	auto path = filesystem::writablePath("tmp.wal.minidb");
+	filesystem::remove(path);
+	filesystem::remove(toString(path, ".wal"));
+
+	auto makeObject = [] (size_t i) {
+		db::mem::Value val;
+		val.setString(toString("key", i), "key");
+		val.setInteger(Time::now().toMicros(), "time");
+		val.setValue(db::mem::Value{ db::mem::Value("data"), db::mem::Value(int64_t(i)) }, "data");
+		return val;
+	};
+
+	int fds[2];
+	if (::pipe(fds) != 0) {
+		return false;
+	}
+
+	auto pid = ::fork();
+	if (pid == 0) {
+		::close(fds[0]);
+
+		db::minidb::StorageParams params;
+		params.pageSize = 16_KiB;
+		params.commitMode = db::minidb::CommitMode::Group;
+
+		auto storage = db::minidb::Storage::open(pool, path, params);
+		storage->init(schemes);
+		for (size_t i = 0; i < nWrites; ++ i) {
+			db::minidb::Transaction transaction;
+			if (transaction.open(*storage, db::minidb::OpenMode::Write)) {
+				memory::pool::push(transaction.getPool());
+				auto val = makeObject(i);
+				auto pos = transaction.createValue(scheme, val);
+				memory::pool::pop();
+				if (transaction.close() && pos.value) {
+					// report only oids, confirmed by commit
+					::write(fds[1], &pos.value, sizeof(uint64_t));
+				}
+			}
+		}
+		::close(fds[1]);
+		::_exit(0);
+	}
+
+	::close(fds[1]);
+	db::mem::Vector<uint64_t> oids;
+	uint64_t oid = 0;
+	while (::read(fds[0], &oid, sizeof(uint64_t)) == sizeof(uint64_t)) {
+		oids.emplace_back(oid);
+	}
+	::close(fds[0]);
+
+	int status = 0;
+	::waitpid(pid, &status, 0);
+
+	bool success = true;
+	if (oids.size() != nWrites) {
+		std::cout << "Committed: " << oids.size() << " of " << nWrites << "\n";
+		success = false;
+	}
+
+	if (!filesystem::exists(toString(path, ".wal"))) {
+		std::cout << "WAL was merged before crash, test is not conclusive\n";
+	}
+
+	db::minidb::StorageParams params;
+	params.pageSize = 16_KiB;
+
+	auto storage = db::minidb::Storage::open(pool, path, params);
+	storage->init(schemes);
+
+	if (!checkOids(storage, oids, true)) {
+		std::cout << "WAL replay: failed\n";
+		success = false;
+	}
+
+	// sync writer merges WAL into storage file
+	db::mem::Vector<uint64_t> newOids;
+	db::minidb::Transaction transaction;
+	if (transaction.open(*storage, db::minidb::OpenMode::Write)) {
+		memory::pool::push(transaction.getPool());
+		auto val = makeObject(nWrites);
+		auto pos = transaction.createValue(scheme, val);
+		memory::pool::pop();
+		if (transaction.close() && pos.value) {
+			newOids.emplace_back(pos.value);
+		}
+	}
+
+	if (newOids.empty() || filesystem::exists(toString(path, ".wal")) || !checkOids(storage, oids, true)
+			|| !checkOids(storage, newOids, true)) {
+		std::cout << "WAL merge: failed\n";
+		success = false;
+	}
+
+	// WAL can not be written, when its path is occupied with directory; commit should fail
+	// and its changes should not be visible
+	auto walPath = toString(path, ".wal");
+	filesystem::mkdir(walPath);
+
+	newOids.clear();
+	bool committed = true;
+	if (transaction.open(*storage, db::minidb::OpenMode::Write)) {
+		memory::pool::push(transaction.getPool());
+		auto val = makeObject(nWrites + 1);
+		auto pos = transaction.createValue(scheme, val);
+		memory::pool::pop();
+		if (pos.value) {
+			newOids.emplace_back(pos.value);
+		}
+		committed = transaction.close();
+	}
+
+	filesystem::remove(walPath);
+
+	if (committed || newOids.empty() || !checkOids(storage, newOids, false) || !checkOids(storage, oids, true)) {
+		std::cout << "WAL write failure: failed\n";
+		success = false;
+	}
+
+	db::minidb::Storage::destroy(storage);
+
+	// WAL, that grows past hard limit, should be merged, when reader, that uses storage file, is finished
+	params.commitMode = db::minidb::CommitMode::Group;
+	params.walPagesLimit = 1;
+	params.walFramesLimit = 8;
+
+	storage = db::minidb::Storage::open(pool, path, params);
+	storage->init(schemes);
+
+	std::atomic<bool> readerOpened(false);
+	std::thread reader([&] {
+		db::minidb::Transaction t;
+		if (t.open(*storage, db::minidb::OpenMode::Read)) {
+			readerOpened = true;
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			t.close();
+		} else {
+			readerOpened = true;
+		}
+	});
+
+	while (!readerOpened) {
+		std::this_thread::yield();
+	}
+
+	newOids.clear();
+	bool merged = false;
+	for (size_t i = 0; i < 64 && !merged; ++ i) {
+		if (transaction.open(*storage, db::minidb::OpenMode::Write)) {
+			memory::pool::push(transaction.getPool());
+			auto val = makeObject(nWrites + 2 + i);
+			auto pos = transaction.createValue(scheme, val);
+			memory::pool::pop();
+			if (transaction.close() && pos.value) {
+				newOids.emplace_back(pos.value);
+			}
+		}
+		merged = !filesystem::exists(walPath);
+	}
+
+	reader.join();
+
+	if (!merged || newOids.empty() || !checkOids(storage, newOids, true) || !checkOids(storage, oids, true)) {
+		std::cout << "WAL forced merge: failed\n";
+		success = false;
+	}
+
+	db::minidb::Storage::destroy(storage);
+
+	std::cout << "WAL test: " << (success ? "passed" : "failed") << "\n";
+	return success;
+}
+
+// Writer threads commit several changesets within each transaction in group commit mode; WAL sync is awaited
+// only when write lock is released, so, commits from different writers should share fsyncs
+static bool runCommitTest(db::mem::pool_t *pool, const db::mem::Map<db::mem::StringView, const db::Scheme *> &schemes,
+		const db::Scheme &scheme, size_t nWriters, size_t nWrites) {
+	static constexpr size_t CommitsPerTransaction = 4;
+
+	auto path = filesystem::writablePath("tmp.commit.minidb");
+	filesystem::remove(path);
+	filesystem::remove(toString(path, ".wal"));
+
+	db::minidb::StorageParams params;
+	params.pageSize = 16_KiB;
+	params.commitMode = db::minidb::CommitMode::Group;
+
+	auto storage = db::minidb::Storage::open(pool, path, params);
+	storage->init(schemes);
+
+	std::mutex mutex;
+	std::atomic<size_t> writes(0);
+	std::atomic<bool> failed(false);
+	db::mem::Vector<uint64_t> oids;
+
+	auto writerFn = [&] (size_t idx) {
+		auto pool = memory::pool::create((memory::pool_t *)nullptr);
+		memory::pool::push(pool);
+
+		while (writes.fetch_add(1) < nWrites) {
+			db::minidb::Transaction transaction;
+			if (!transaction.open(*storage, db::minidb::OpenMode::Write)) {
+				failed = true;
+				continue;
+			}
+
+			std::vector<uint64_t> committed;
+			memory::pool::push(transaction.getPool());
+			for (size_t i = 0; i < CommitsPerTransaction; ++ i) {
+				db::mem::Value val;
+				val.setString(toString("key", idx, "-", i), "key");
+				val.setInteger(Time::now().toMicros(), "time");
+				val.setValue(db::mem::Value{ db::mem::Value("data"), db::mem::Value(int64_t(idx)) }, "data");
+				auto pos = transaction.createValue(scheme, val);
+				if (!pos.value || !transaction.commit()) {
+					failed = true;
+					break;
+				}
+				committed.emplace_back(pos.value);
+			}
+			memory::pool::pop();
+
+			if (!transaction.close()) {
+				failed = true;
+			}
+
+			std::unique_lock lock(mutex);
+			oids.insert(oids.end(), committed.begin(), committed.end());
+		}
+
+		memory::pool::pop();
+		memory::pool::destroy(pool);
+	};
+
+	auto initial = storage->getCommitStats();
+
+	db::mem::Vector<std::thread> writers;
+	for (size_t i = 0; i < nWriters; ++ i) {
+		writers.emplace_back(writerFn, i);
+	}
+	for (auto &it : writers) {
+		it.join();
+	}
+
+	auto stats = storage->getCommitStats();
+	auto commits = stats.commits - initial.commits;
+	auto fsyncs = stats.fsyncs - initial.fsyncs;
+
+	bool success = true;
+	std::cout << "Commits: " << commits << " Fsyncs: " << fsyncs << "\n";
+
+	if (failed || oids.size() != nWrites * CommitsPerTransaction || commits < oids.size()) {
+		std::cout << "Group commit: not all changes was committed\n";
+		success = false;
+	}
+
+	// WAL is synced only on close, when write lock is released, so, each transaction with several commits
+	// waits for sync only once, and other writers can join this sync
+	if (fsyncs == 0 || fsyncs * 2 > commits) {
+		std::cout << "Group commit: commits does not share fsyncs\n";
+		success = false;
+	}
+
+	if (!checkOids(storage, oids, true)) {
+		success = false;
+	}
+
+	db::minidb::Storage::destroy(storage);
+
+	std::cout << "Commit test: " << (success ? "passed" : "failed") << "\n";
+	return success;
+}
+
+// Objects are created, updated (in place and with growth into new cell) and removed with workers, then selected
+// through string and integer indexes; replaced and removed values should not be found
+static bool runIndexTest(db::mem::pool_t *pool) {
+	db::Scheme scheme("indexed");
+	scheme.define({
+		db::Field::Text("name", db::Flags::Indexed, db::MaxLength(1_KiB)),
+		db::Field::Integer("index", db::Flags::Indexed),
+		db::Field::Data("data")
+	});
+
+	db::mem::Map<db::mem::StringView, const db::Scheme *> schemes;
+	schemes.emplace(scheme.getName(), &scheme);
+	db::Scheme::initSchemes(schemes);
+
+	auto path = filesystem::writablePath("tmp.index.minidb");
+	filesystem::remove(path);
+	filesystem::remove(toString(path, ".wal"));
+
+	db::minidb::StorageParams params;
+	params.pageSize = 16_KiB;
+
+	auto storage = db::minidb::Storage::open(pool, path, params);
+	storage->init(schemes);
+
+	auto perform = [&] (db::minidb::OpenMode mode, const Callback<void(db::Worker &)> &cb) {
+		db::minidb::Transaction t;
+		if (!t.open(*storage, mode)) {
+			return false;
+		}
+		memory::pool::push(t.getPool());
+		do {
+			db::minidb::Handle handle(t);
+			db::Adapter adapter(&handle);
+			auto transaction = db::Transaction::acquire(adapter);
+			db::Worker worker(scheme, transaction);
+			cb(worker);
+			transaction.release();
+		} while (0);
+		memory::pool::pop();
+		return t.close();
+	};
+
+	bool success = true;
+	auto check = [&] (db::Worker &worker, StringView name, const db::Query &q, size_t expected, uint64_t oid = 0) {
+		auto ret = worker.select(q);
+		if (ret.size() != expected || (oid && ret.getValue(0).getInteger("__oid") != int64_t(oid))) {
+			std::cout << name << ": failed: " << ret << "\n";
+			success = false;
+		}
+	};
+
+	const size_t nObjects = 16;
+	db::mem::Vector<uint64_t> oids;
+
+	success = perform(db::minidb::OpenMode::Write, [&] (db::Worker &worker) {
+		for (size_t i = 0; i < nObjects; ++ i) {
+			auto ret = worker.create(db::mem::Value({
+				pair("name", db::mem::Value(toString("name", i))),
+				pair("index", db::mem::Value(int64_t(i))),
+				pair("data", db::mem::Value(toString("data", i))),
+			}));
+			oids.emplace_back(ret.getInteger("__oid"));
+		}
+	}) && success;
+
+	success = perform(db::minidb::OpenMode::Write, [&] (db::Worker &worker) {
+		// grows, object is moved into new cell
+		if (!worker.update(oids[1], db::mem::Value({ pair("name", db::mem::Value("renamed")) }))) {
+			std::cout << "Update (growth): failed\n";
+			success = false;
+		}
+		// shrinks, object is updated in place
+		if (!worker.update(oids[2], db::mem::Value({ pair("name", db::mem::Value("nm2")) }))) {
+			std::cout << "Update (in place): failed\n";
+			success = false;
+		}
+		if (!worker.update(oids[3], db::mem::Value({ pair("index", db::mem::Value(int64_t(100))) }))) {
+			std::cout << "Update (integer): failed\n";
+			success = false;
+		}
+		// key is longer then index key prefix, candidates are checked with object value
+		if (!worker.update(oids[5], db::mem::Value({ pair("name", db::mem::Value("long-name-value-5")) }))) {
+			std::cout << "Update (long key): failed\n";
+			success = false;
+		}
+		if (!worker.remove(oids[4])) {
+			std::cout << "Remove: failed\n";
+			success = false;
+		}
+
+		// object, created and removed within same transaction, should not reach index pages
+		auto tmp = worker.create(db::mem::Value({
+			pair("name", db::mem::Value("temporary")),
+			pair("index", db::mem::Value(int64_t(200))),
+		}));
+		if (!worker.remove(uint64_t(tmp.getInteger("__oid")))) {
+			std::cout << "Remove (pending): failed\n";
+			success = false;
+		}
+	}) && success;
+
+	success = perform(db::minidb::OpenMode::Read, [&] (db::Worker &worker) {
+		check(worker, "Renamed (old)", db::Query().select("name", db::mem::Value("name1")), 0);
+		check(worker, "Renamed (new)", db::Query().select("name", db::mem::Value("renamed")), 1, oids[1]);
+		check(worker, "Renamed (index)", db::Query().select("index", db::mem::Value(int64_t(1))), 1, oids[1]);
+		check(worker, "Shrinked (old)", db::Query().select("name", db::mem::Value("name2")), 0);
+		check(worker, "Shrinked (new)", db::Query().select("name", db::mem::Value("nm2")), 1, oids[2]);
+		check(worker, "Integer (old)", db::Query().select("index", db::mem::Value(int64_t(3))), 0);
+		check(worker, "Integer (new)", db::Query().select("index", db::mem::Value(int64_t(100))), 1, oids[3]);
+		check(worker, "Integer (name)", db::Query().select("name", db::mem::Value("name3")), 1, oids[3]);
+		check(worker, "Long key", db::Query().select("name", db::mem::Value("long-name-value-5")), 1, oids[5]);
+		check(worker, "Long key (prefix)", db::Query().select("name", db::Comparation::Prefix, db::mem::Value("long")), 1, oids[5]);
+		check(worker, "Removed (name)", db::Query().select("name", db::mem::Value("name4")), 0);
+		check(worker, "Removed (index)", db::Query().select("index", db::mem::Value(int64_t(4))), 0);
+		check(worker, "Removed (pending)", db::Query().select("name", db::mem::Value("temporary")), 0);
+		check(worker, "Removed (pending index)", db::Query().select("index", db::mem::Value(int64_t(200))), 0);
+		check(worker, "Prefix", db::Query().select("name", db::Comparation::Prefix, db::mem::Value("name")), nObjects - 4);
+		check(worker, "All", db::Query(), nObjects - 1);
+
+		auto obj = worker.get(oids[1]);
+		if (obj.getString("data") != "data1" || obj.getInteger("__oid") != int64_t(oids[1])) {
+			std::cout << "Moved object: failed: " << obj << "\n";
+			success = false;
+		}
+	}) && success;
+
+	// keys with long shared prefix should not fall into single index key, and index pages should be split
+	// into multilevel tree; keys longer then stored key limit differ only in tail
+	const size_t nShared = 2000;
+	db::mem::Vector<uint64_t> sharedOids;
+	auto longKey = [] (StringView tail) {
+		return toString(String(db::minidb::BytesIndexKeyLimit + 16, 'x'), tail);
+	};
+
+	success = perform(db::minidb::OpenMode::Write, [&] (db::Worker &worker) {
+		for (size_t i = 0; i < nShared; ++ i) {
+			sharedOids.emplace_back(worker.create(db::mem::Value({
+				pair("name", db::mem::Value(toString("shared-prefix-", 10000 + i))),
+				pair("index", db::mem::Value(int64_t(1000 + i))),
+			})).getInteger("__oid"));
+		}
+		worker.create(db::mem::Value({ pair("name", db::mem::Value(longKey("a"))) }));
+		worker.create(db::mem::Value({ pair("name", db::mem::Value(longKey("b"))) }));
+	}) && success;
+
+	success = perform(db::minidb::OpenMode::Read, [&] (db::Worker &worker) {
+		check(worker, "Shared prefix", db::Query().select("name", db::Comparation::Prefix, db::mem::Value("shared-prefix-")), nShared);
+		check(worker, "Shared prefix (narrow)", db::Query().select("name", db::Comparation::Prefix, db::mem::Value("shared-prefix-101")), 100);
+		check(worker, "Shared (equal)", db::Query().select("name", db::mem::Value("shared-prefix-11234")), 1);
+		check(worker, "Shared (missing)", db::Query().select("name", db::mem::Value("shared-prefix-1123")), 0);
+		check(worker, "Shared (range)", db::Query().select("name", db::Comparation::BetweenEquals,
+				db::mem::Value("shared-prefix-10100"), db::mem::Value("shared-prefix-10199")), 100);
+		check(worker, "Long key (a)", db::Query().select("name", db::mem::Value(longKey("a"))), 1);
+		check(worker, "Long key (b)", db::Query().select("name", db::mem::Value(longKey("b"))), 1);
+		check(worker, "Long key (prefix)", db::Query().select("name", db::Comparation::Prefix, db::mem::Value(longKey(""))), 2);
+
+		for (auto ord : { db::Ordering::Ascending, db::Ordering::Descending }) {
+			auto ret = worker.select(db::Query().select("name", db::Comparation::Prefix, db::mem::Value("shared-prefix-10"))
+					.order("name", ord));
+			bool sorted = (ret.size() == 1000);
+			for (size_t i = 1; i < ret.size() && sorted; ++ i) {
+				auto cmp = ret.getValue(i - 1).getString("name").compare(ret.getValue(i).getString("name"));
+				sorted = (ord == db::Ordering::Ascending) ? (cmp < 0) : (cmp > 0);
+			}
+			if (!sorted) {
+				std::cout << "Shared (order): failed: " << ret.size() << "\n";
+				success = false;
+			}
+		}
+	}) && success;
+
+	// first scheme leaf becomes empty and should be unlinked from scheme tree
+	const size_t nRemoved = 1200;
+	success = perform(db::minidb::OpenMode::Write, [&] (db::Worker &worker) {
+		for (auto &it : oids) {
+			worker.remove(it);
+		}
+		for (size_t i = 0; i < nRemoved; ++ i) {
+			if (!worker.remove(sharedOids[i])) {
+				std::cout << "Remove (leaf): failed\n";
+				success = false;
+			}
+		}
+	}) && success;
+
+	success = perform(db::minidb::OpenMode::Write, [&] (db::Worker &worker) {
+		check(worker, "Empty leaf (all)", db::Query(), nShared - nRemoved + 2);
+		check(worker, "Empty leaf (prefix)", db::Query().select("name", db::Comparation::Prefix, db::mem::Value("shared-prefix-1")),
+				nShared - nRemoved);
+		check(worker, "Empty leaf (first)", db::Query().select("name", db::mem::Value("shared-prefix-10000")), 0);
+
+		for (auto ord : { db::Ordering::Ascending, db::Ordering::Descending }) {
+			auto ret = worker.select(db::Query().order("__oid", ord));
+			auto first = ret.getValue((ord == db::Ordering::Ascending) ? 0 : ret.size() - 1).getInteger("__oid");
+			if (ret.size() != nShared - nRemoved + 2 || first != int64_t(sharedOids[nRemoved])) {
+				std::cout << "Empty leaf (order): failed: " << ret.size() << " " << first << "\n";
+				success = false;
+			}
+		}
+
+		worker.create(db::mem::Value({ pair("name", db::mem::Value("after-remove")) }));
+	}) && success;
+
+	success = perform(db::minidb::OpenMode::Read, [&] (db::Worker &worker) {
+		check(worker, "Empty leaf (create)", db::Query().select("name", db::mem::Value("after-remove")), 1);
+		check(worker, "Empty leaf (all after create)", db::Query(), nShared - nRemoved + 3);
+	}) && success;
+
+	db::minidb::Storage::destroy(storage);
+
+	std::cout << "Index test: " << (success ? "passed" : "failed") << "\n";
+	return success;
+}
+
 SP_EXTERN_C int _spMain(argc, argv) {
 	data::Value opts = data::parseCommandLineOptions(argc, argv,
 			&parseOptionSwitch, &parseOptionString);
@@ -163,18 +864,59 @@ SP_EXTERN_C int _spMain(argc, argv) {
 
 	db::Scheme::initSchemes(schemes);
 
+	if (opts.getString("test") == "index") {
+		return runIndexTest(pool) ? 0 : -1;
+	}
+
+	if (opts.getString("test") == "commit") {
+		return runCommitTest(pool, schemes, _test,
+				size_t(opts.isInteger("writers") ? opts.getInteger("writers") : 4),
+				size_t(opts.isInteger("writes") ? opts.getInteger("writes") : 64)) ? 0 : -1;
+	}
+
+	if (opts.getString("test") == "wal") {
+		return runWalTest(pool, schemes, _test, size_t(opts.isInteger("writes") ? opts.getInteger("writes") : 16)) ? 0 : -1;
+	}
+
 	auto writablePath = filesystem::writablePath("tmp.minidb");
 
 	db::minidb::StorageParams params;
 	params.pageSize = 16_KiB;
+	if (opts.isInteger("cache")) {
+		params.cacheSize = size_t(opts.getInteger("cache"));
+	}
+	if (opts.getString("commit") == "group") {
+		params.commitMode = db::minidb::CommitMode::Group;
+	} else if (opts.getString("commit") == "relaxed") {
+		params.commitMode = db::minidb::CommitMode::Relaxed;
+	}
+	if (opts.isInteger("window")) {
+		params.durabilityWindow = TimeInterval::milliseconds(opts.getInteger("window"));
+	}
 
 	db::minidb::Storage *storage = db::minidb::Storage::open(pool, writablePath, params);
 
 	storage->init(schemes);
 
+	if (opts.getString("bench") == "mvcc") {
+		runMvccBenchmark(storage, _test,
+				size_t(opts.isInteger("readers") ? opts.getInteger("readers") : 4),
+				size_t(opts.isInteger("writes") ? opts.getInteger("writes") : 1000));
+		db::minidb::Storage::destroy(storage);
+		return 0;
+	} else if (opts.getString("bench") == "commit") {
+		runCommitBenchmark(storage, _test,
+				size_t(opts.isInteger("writers") ? opts.getInteger("writers") : 4),
+				size_t(opts.isInteger("writes") ? opts.getInteger("writes") : 1000));
+		db::minidb::Storage::destroy(storage);
+		return 0;
+	}
+
 	db::minidb::Transaction t;
 	if (t.open(*storage, db::minidb::OpenMode::Read)) {
-		minidb::inspectTree(t, 0, [&] (mem::StringView str) { std::cout << str; });
+		minidb::InspectOptions inspect;
+		inspect.cb = [&] (mem::StringView str) { std::cout << str; };
+		minidb::inspectTree(t, 0, inspect);
 		do {
 			db::minidb::TreeStack stack(t, 0);
 			for (uint64_t i = 0; i <= 26; ++ i) {
@@ -53,6 +53,7 @@ constexpr auto getInputUpdateFrequency() { return 0.1f; }
 
 constexpr auto getUploadTmpFilePrefix() { return "sa.upload"; }
 constexpr auto getUploadTmpImagePrefix() { return "sa.image"; }
+constexpr auto getImageVariantsMaxAttempts() { return 3; }
 constexpr auto getUploadTmpFileBuffer() { return 8_KiB; }
 constexpr auto getUploadUseBuffer() { return true; }
 
@@ -74,6 +75,7 @@ constexpr auto getDefaultWebsocketMax() { return 1_KiB; }
 
 constexpr auto getWebsocketBufferSlots() -> size_t { return 16; }
 constexpr auto getWebsocketMaxBufferSlotSize() -> size_t { return 8_KiB; }
+constexpr auto getWebsocketDeflateMinSize() -> size_t { return 128; } // smaller messages are sent without compression
 
 #if DEBUG
 constexpr auto getDefaultPugTemplateUpdateInterval() { return 3_sec; }
@@ -24,28 +24,6 @@
 
 NS_SA_BEGIN
 
-static apr_status_t DbdModule_construct(void **data_ptr, void *params, mem::pool_t *pool) {
-	DbdModule *group = (DbdModule *)params;
-
-	db::sql::Driver::Handle rec;
-	mem::perform([&] {
-		rec = group->getDriver()->connect(*group->getParams());
-	}, pool);
-
-    *data_ptr = rec.get();
-    return APR_SUCCESS;
-}
-
-static apr_status_t DbdModule_destruct(void *data, void *params, mem::pool_t *pool) {
-	DbdModule *group = (DbdModule *)params;
-
-	if (!group->isDestroyed()) {
-		group->getDriver()->finish(db::sql::Driver::Handle(data));
-	}
-
-	return APR_SUCCESS;
-}
-
 DbdModule *DbdModule::create(mem::pool_t *root, Map<StringView, StringView> *params) {
 	auto pool = mem::pool::create(root);
 	DbdModule *m = nullptr;
@@ -55,47 +33,26 @@ DbdModule *DbdModule::create(mem::pool_t *root, Map<StringView, StringView> *par
 
 		StringView driverName;
 		Config cfg;
+		bool persistent = true;
 		for (auto &it : *params) {
-			if (it.first == "nmin") {
-				if (int v = StringView(it.second).readInteger(10).get(0)) {
-					cfg.nmin = stappler::math::clamp(v, 1, config::getMaxDatabaseConnections());
-				} else {
-					std::cout << "[DbdModule] invalid value for nmin: " << it.second << "\n";
-				}
-			} else if (it.first == "nkeep") {
-				if (int v = StringView(it.second).readInteger(10).get(0)) {
-					cfg.nkeep = stappler::math::clamp(v, 1, config::getMaxDatabaseConnections());
-				} else {
-					std::cout << "[DbdModule] invalid value for nkeep: " << it.second << "\n";
-				}
-			} else if (it.first == "nmax") {
-				if (int v = StringView(it.second).readInteger(10).get(0)) {
-					cfg.nmax = stappler::math::clamp(v, 1, config::getMaxDatabaseConnections());
-				} else {
-					std::cout << "[DbdModule] invalid value for nmax: " << it.second << "\n";
-				}
-			} else if (it.first == "exptime") {
-				if (auto v = StringView(it.second).readInteger(10).get(0)) {
-					cfg.exptime = v;
-				} else {
-					std::cout << "[DbdModule] invalid value for exptime: " << it.second << "\n";
-				}
-			} else if (it.first == "persistent") {
+			if (it.first == "persistent") {
 				if (it.second == "1" || it.second == "yes") {
-					cfg.persistent = true;
+					persistent = true;
 				} else if (it.second == "0" || it.second == "no") {
-					cfg.persistent = false;
+					persistent = false;
 				} else {
 					std::cout << "[DbdModule] invalid value for persistent: " << it.second << "\n";
 				}
 			} else if (it.first == "driver") {
 				driverName = it.second;
 				driver = Root::getInstance()->getDbDriver(it.second);
+			} else {
+				cfg.set(it.first, it.second);
 			}
 		}
 
 		if (driver) {
-			m = new (pool) DbdModule(pool, cfg, driver, params);
+			m = new (pool) DbdModule(pool, cfg, persistent, driver, params);
 		} else {
 			std::cout << "[DbdModule] driver not found: " << driverName << "\n";
 		}
@@ -112,46 +69,53 @@ void DbdModule::destroy(DbdModule *module) {
 }
 
 db::sql::Driver::Handle DbdModule::openConnection(apr_pool_t *pool) {
-	db::sql::Driver::Handle rec;
-
-	if (!_config.persistent) {
-		DbdModule_construct((void**) &rec, this, pool);
+	if (!_persistent) {
+		db::sql::Driver::Handle rec;
+		mem::perform([&] {
+			rec = _dbDriver->connect(*_dbParams);
+		}, pool);
 		return rec;
 	}
 
-	auto rv = apr_reslist_acquire(_reslist, (void**) &rec);
-	if (rv != APR_SUCCESS) {
+	if (_destroyed) {
 		return db::sql::Driver::Handle(nullptr);
 	}
 
-	if (!_dbDriver->isValid(rec)) {
-		apr_reslist_invalidate(_reslist, rec.get());
-		return db::sql::Driver::Handle(nullptr);
-	}
-
-	return rec;
+	// pool validates idle connections and reconnects, if validation failed
+	return _handles->acquire();
 }
 
 void DbdModule::closeConnection(db::sql::Driver::Handle rec) {
-	if (!_config.persistent) {
+	if (!_persistent) {
 		_dbDriver->finish(rec);
 	} else {
-		apr_reslist_release(_reslist, rec.get());
+		// driver pool is alive until all acquired handles are released, even after module was closed
+		_handles->release(rec);
+	}
+}
+
+void DbdModule::cleanup() {
+	if (!_destroyed) {
+		_handles->cleanup();
 	}
 }
 
 void DbdModule::close() {
 	if (!_destroyed) {
-		if (_reslist) {
-			apr_reslist_destroy(_reslist);
-			_reslist = nullptr;
-		}
+		_handles->destroy();
 		_destroyed = true;
 	}
 }
 
-DbdModule::DbdModule(mem::pool_t *pool, const Config &cfg, db::sql::Driver *driver, Map<StringView, StringView> *params)
-: _pool(pool), _config(cfg), _dbParams(params), _dbDriver(driver) {
+DbdModule::Stats DbdModule::getStats() const {
+	if (!_destroyed) {
+		return _handles->getStats();
+	}
+	return Stats();
+}
+
+DbdModule::DbdModule(mem::pool_t *pool, const Config &cfg, bool persistent, db::sql::Driver *driver, Map<StringView, StringView> *params)
+: _pool(pool), _persistent(persistent), _dbParams(params), _dbDriver(driver) {
 	auto handle = _dbDriver->connect(*_dbParams);
 	if (handle.get()) {
 		_dbDriver->init(handle, mem::Vector<mem::StringView>());
@@ -160,16 +124,14 @@ DbdModule::DbdModule(mem::pool_t *pool, const Config &cfg, db::sql::Driver *driv
 		std::cout << "[DbdModule] fail to initialize connection with driver " << _dbDriver->getDriverName() << "\n";
 	}
 
-	if (_config.persistent) {
-		auto rv = apr_reslist_create(&_reslist, _config.nmin, _config.nkeep, _config.nmax,
-				apr_time_from_sec(cfg.exptime), DbdModule_construct, DbdModule_destruct, this, _pool);
-		if (rv == APR_SUCCESS) {
-			_destroyed = false;
-		}
+	if (_persistent) {
+		_handles = db::sql::DriverPool::create(_dbDriver, *_dbParams, cfg);
+		_handles->prefill();
+		_destroyed = false;
 	}
 
 	mem::pool::cleanup_register(_pool, [this] {
-		_destroyed = true;
+		close();
 	});
 }
 
@@ -24,18 +24,14 @@
 #define COMPONENTS_SERENITY_SRC_SERVER_SEDBDMODULE_H_
 
 #include "Root.h"
+#include "STSqlDriverPool.h"
 
 NS_SA_BEGIN
 
 class DbdModule : public AllocBase {
 public:
-	struct Config {
-		int nmin = 1;
-		int nkeep = 2;
-		int nmax = 10;
-		int64_t exptime = 300;
-		bool persistent = true;
-	};
+	using Config = db::sql::DriverPool::Config;
+	using Stats = db::sql::DriverPool::Stats;
 
 	static DbdModule *create(mem::pool_t *root, Map<StringView, StringView> *params);
 	static void destroy(DbdModule *);
@@ -43,6 +39,9 @@ public:
 	db::sql::Driver::Handle openConnection(apr_pool_t *);
 	void closeConnection(db::sql::Driver::Handle);
 
+	// close expired connections
+	void cleanup();
+
 	void close();
 
 	mem::pool_t *getPool() const { return _pool; }
@@ -50,18 +49,18 @@ public:
 	db::sql::Driver *getDriver() const { return _dbDriver; }
 	Map<StringView, StringView> *getParams() const { return _dbParams; }
 
+	// connection pool counters, empty when connections are not persistent
+	Stats getStats() const;
+
 protected:
-	DbdModule(mem::pool_t *root, const Config &, db::sql::Driver *, Map<StringView, StringView> *params);
+	DbdModule(mem::pool_t *root, const Config &, bool persistent, db::sql::Driver *, Map<StringView, StringView> *params);
 
 	mem::pool_t *_pool = nullptr;
-	Config _config;
+	bool _persistent = true;
 	Map<StringView, StringView> *_dbParams = nullptr;
 	bool _destroyed = true;
-	apr_reslist_t *_reslist = nullptr;
+	db::sql::DriverPool *_handles = nullptr;
 	db::sql::Driver *_dbDriver = nullptr;
-
-	Vector<const char *> _keywords;
-	Vector<const char *> _values;
 };
 
 NS_SA_END
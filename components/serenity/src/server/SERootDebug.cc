@@ -107,6 +107,9 @@ static void sa_server_timer_postgres_error(PollClient *cl, int epoll) {
 				std::cout << "Failed to start thread worker with socket epoll_ctl("
 						<< sock << ", EPOLL_CTL_ADD): " << strerror_r(errno, buf, 255) << "\n";
 				cl->server.closeDbConnection(handle);
+			} else {
+				// catch up with broadcasts, sent while listener was disconnected
+				cl->server.processBroadcasts(handle);
 			}
 		} else {
 			cl->server.closeDbConnection(handle);
@@ -115,13 +118,25 @@ static void sa_server_timer_postgres_error(PollClient *cl, int epoll) {
 }
 
 static void sa_server_timer_postgres_process(PollClient *cl, int epoll) {
-	if (!cl->server.getDbDriver()->consumeNotifications(db::pq::Driver::Handle(cl->ptr), [&] (mem::StringView name) {
-		if (name == config::getStorageBroadcastChannelName()) {
-			cl->server.checkBroadcasts();
+	// Notifications, received by libpq while broadcasts are fetched, stays in its buffer and
+	// does not trigger edge-triggered epoll, so we consume them until no new broadcasts left.
+	// Multiple notifications are coalesced into single fetch.
+	bool hasBroadcasts = false;
+	do {
+		hasBroadcasts = false;
+		if (!cl->server.getDbDriver()->consumeNotifications(db::pq::Driver::Handle(cl->ptr), [&] (mem::StringView name) {
+			if (name == config::getStorageBroadcastChannelName()) {
+				hasBroadcasts = true;
+			}
+		})) {
+			sa_server_timer_postgres_error(cl, epoll);
+			return;
 		}
-	})) {
-		sa_server_timer_postgres_error(cl, epoll);
-	}
+
+		if (hasBroadcasts) {
+			cl->server.processBroadcasts(db::sql::Driver::Handle(cl->ptr));
+		}
+	} while (hasBroadcasts);
 }
 
 static bool sa_server_timer_thread_poll(int epollFd) {
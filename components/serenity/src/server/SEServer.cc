@@ -1020,6 +1020,9 @@ void Server::initHeartBeat(apr_pool_t *, int epoll) {
 				std::cout << "Failed to start thread worker with socket epoll_ctl("
 						<< sock << ", EPOLL_CTL_ADD): " << strerror_r(errno, buf, 255) << "\n";
 				closeDbConnection(handle);
+			} else {
+				// acquire last broadcast id, so first notification delivers messages
+				processBroadcasts(handle);
 			}
 		} else {
 			closeDbConnection(handle);
@@ -1032,6 +1035,10 @@ void Server::onHeartBeat(apr_pool_t *pool) {
 	apr::pool::perform([&] {
 		auto now = Time::now();
 		if (!_config->loadingFalled) {
+			if (_config->customDbd) {
+				_config->customDbd->cleanup();
+			}
+
 			if (now - _config->lastDatabaseCleanup > config::getDefaultDatabaseCleanupInterval()) {
 				db::sql::Driver::Handle handle = openDbConnection(pool);
 				if (handle.get()) {
@@ -1060,21 +1067,19 @@ void Server::onHeartBeat(apr_pool_t *pool) {
 	memory::pool::store(pool, nullptr, "Apr.Server");
 }
 
-void Server::checkBroadcasts() {
-	Task::perform(*this, [&] (Task &task) {
-		task.addExecuteFn([this] (const Task &task) -> bool {
-			auto handle = openDbConnection(task.pool());
-			if (handle.get()) {
-				_config->dbDriver->performWithStorage(handle, [&] (const db::Adapter &a) {
-					_config->broadcastId = a.interface()->processBroadcasts([&] (BytesView bytes) {
-						onBroadcast(bytes);
-					}, _config->broadcastId);
-				});
-				closeDbConnection(handle);
-			}
-			return true;
-		});
-	});
+void Server::processBroadcasts(db::sql::Driver::Handle handle) {
+	// fetch all pending broadcasts with single query on listener connection
+	auto pool = memory::pool::create(getProcessPool());
+	mem::perform([&] {
+		mem::perform([&] {
+			_config->dbDriver->performWithStorage(handle, [&] (const db::Adapter &a) {
+				_config->broadcastId = a.interface()->processBroadcasts([&] (BytesView bytes) {
+					onBroadcast(bytes);
+				}, _config->broadcastId);
+			});
+		}, pool);
+	}, *this);
+	memory::pool::destroy(pool);
 }
 
 void Server::onBroadcast(const data::Value &val) {
@@ -1105,6 +1110,17 @@ void Server::onBroadcast(const data::Value &val) {
 }
 
 void Server::onBroadcast(const BytesView &bytes) {
+	// only system broadcasts and broadcasts with data are processed,
+	// check it before decoding of whole payload
+	data::Value system;
+	StringView paths[] = { "system", "data" };
+	data::Value *values[] = { &system, nullptr };
+
+	data::Projection<memory::DefaultInterface> proj(paths, values);
+	if (data::visit(bytes, proj) && !system.getBool() && !proj.isFound(1)) {
+		return;
+	}
+
 	onBroadcast(data::read(bytes));
 }
 
@@ -1682,6 +1698,13 @@ db::sql::Driver::Handle Server::openDbConnection(mem::pool_t *pool) const {
 	return handle;
 }
 
+db::sql::DriverPool::Stats Server::getDbPoolStats() const {
+	if (_config->customDbd) {
+		return _config->customDbd->getStats();
+	}
+	return db::sql::DriverPool::Stats();
+}
+
 void Server::closeDbConnection(db::sql::Driver::Handle handle) const {
 	if (_config->customDbd) {
 		_config->customDbd->closeConnection(handle);
@@ -24,7 +24,7 @@ THE SOFTWARE.
 #define SERENITY_SRC_SERVER_SESERVER_H_
 
 #include "Define.h"
-#include "STSqlDriver.h"
+#include "STSqlDriverPool.h"
 
 NS_SA_BEGIN
 
@@ -47,7 +47,7 @@ public:
 	void onChildInit(mem::pool_t *rootPool);
 	void initHeartBeat(apr_pool_t *, int);
 	void onHeartBeat(apr_pool_t *);
-	void checkBroadcasts();
+	void processBroadcasts(db::sql::Driver::Handle);
 	void onBroadcast(const data::Value &);
 	void onBroadcast(const BytesView &);
 	int onRequest(Request &);
@@ -132,6 +132,9 @@ public:
 	db::sql::Driver::Handle openDbConnection(mem::pool_t *) const;
 	void closeDbConnection(db::sql::Driver::Handle) const;
 
+	// counters of server's own connection pool (when server uses custom dbd)
+	db::sql::DriverPool::Stats getDbPoolStats() const;
+
 public: // httpd server info
 	apr::weak_string getDefaultName() const;
 
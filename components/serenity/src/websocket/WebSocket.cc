@@ -146,12 +146,21 @@ int Manager::accept(Request &req) {
 	auto handler = onAccept(req, pool);
 
 	if (handler) {
+		DeflateParams deflate;
+		if (_deflateEnabled) {
+			auto extensions = h.at("sec-websocket-extensions");
+			deflate = DeflateParams::negotiate(StringView(extensions.data(), extensions.size()));
+		}
+
 		auto hout = req.getResponseHeaders();
 
 		hout.clear();
 		hout.emplace("Upgrade", "websocket");
 		hout.emplace("Connection", "Upgrade");
 		hout.emplace("Sec-WebSocket-Accept", makeAcceptKey(key));
+		if (deflate.enabled) {
+			hout.emplace("Sec-WebSocket-Extensions", deflate.encode());
+		}
 
 		auto r = req.request();
 		auto sock = ap_get_conn_socket(r->connection);
@@ -165,7 +174,7 @@ int Manager::accept(Request &req) {
 	    ap_add_output_filter(WEBSOCKET_FILTER, (void *)handler, r, r->connection);
 
 	    // duplicate connection
-	    if (auto conn = Connection::create(alloc, pool, req)) {
+	    if (auto conn = Connection::create(alloc, pool, req, deflate)) {
 			handler->setConnection(conn);
 			apr_thread_t *thread = nullptr;
 			apr_threadattr_t *attr = nullptr;
@@ -57,6 +57,10 @@ public:
 
 	const Server &server() const { return _server; }
 
+	// allow permessage-deflate extension for new connections
+	void setDeflateEnabled(bool value) { _deflateEnabled = value; }
+	bool isDeflateEnabled() const { return _deflateEnabled; }
+
 protected:
 	void addHandler(Handler *);
 	void removeHandler(Handler *);
@@ -66,6 +70,7 @@ protected:
 	std::atomic<size_t> _count;
 	Vector<Handler *> _handlers;
 	Server _server;
+	bool _deflateEnabled = true;
 };
 
 class Handler : public AllocPool {
@@ -25,6 +25,7 @@ THE SOFTWARE.
 
 #include <sys/eventfd.h>
 
+#include "WebSocketDeflate.cc"
 #include "WebSocketWriter.cc"
 #include "WebSocketReader.cc"
 #include "WebSocketSsl.cc"
@@ -88,7 +89,7 @@ static apr_socket_t *Connection_duplicateSocket(apr_pool_t *pool, apr_socket_t *
 	return nullptr;
 }
 
-Connection *Connection::create(apr_allocator_t *alloc, apr_pool_t *pool, const Request &rctx) {
+Connection *Connection::create(apr_allocator_t *alloc, apr_pool_t *pool, const Request &rctx, const DeflateParams &deflate) {
 	auto req = rctx.request();
 	auto conn = req->connection;
 
@@ -153,7 +154,7 @@ Connection *Connection::create(apr_allocator_t *alloc, apr_pool_t *pool, const R
 
 	Connection *ret = nullptr;
 	mem::perform([&] {
-		ret = new (pool) Connection(alloc, pool, wsConn, wsSock);
+		ret = new (pool) Connection(alloc, pool, wsConn, wsSock, deflate);
 
 		if (sslOutputFilter) {
 			if (!ret->setSslCtx(conn, sslOutputFilter)) {
@@ -364,25 +365,42 @@ bool Connection::write(FrameType t, const uint8_t *bytes, size_t count) {
 		return false;
 	}
 
-	size_t offset = 0;
-	StackBuffer<32> buf;
-	makeHeader(buf, count, t);
-
-	offset = buf.size();
-
 	auto bb = _writer->tmpbb;
 	auto of = _connection->output_filters;
 
-	_mutex.lock();
-	auto err = ap_fwrite(of, bb, (const char *)buf.data(), offset);
-	if (count > 0) {
-		err = ap_fwrite(of, bb, (const char *)bytes, count);
-	}
+	auto writeFrame = [&] (const uint8_t *data, size_t size, bool compressed) {
+		StackBuffer<32> buf;
+		makeHeader(buf, size, t, compressed);
 
-	err = ap_fflush(of, bb);
-	apr_brigade_cleanup(bb);
+		auto err = ap_fwrite(of, bb, (const char *)buf.data(), buf.size());
+		if (size > 0) {
+			err = ap_fwrite(of, bb, (const char *)data, size);
+		}
 
+		err = ap_fflush(of, bb);
+		apr_brigade_cleanup(bb);
+		return err;
+	};
+
+	apr_status_t err = APR_SUCCESS;
+
+	_mutex.lock();
+	if (_writer->deflate && (t == FrameType::Text || t == FrameType::Binary) && count >= config::getWebsocketDeflateMinSize()) {
+		// compression state is shared between messages, so message should be compressed and written within same lock
+		{
+			Bytes deflated(_writer->deflatePool);
+			if (_writer->deflate->compress(bytes, count, deflated) == DeflateStream::Status::Ok) {
+				err = writeFrame(deflated.data(), deflated.size(), true);
+			} else {
+				err = APR_EGENERAL;
+			}
+		}
+		memory::pool::clear(_writer->deflatePool);
+	} else {
+		err = writeFrame(bytes, count, false);
+	}
 	_mutex.unlock();
+
 	if (err != APR_SUCCESS) {
 		return false;
 	}
@@ -739,7 +757,7 @@ bool Connection::readSocket(const apr_pollfd_t *fd, Handler *h) {
 					if (h) {
 						h->sendPendingNotifications(_reader->pool);
 					}
-					if (h && !h->onFrame(_reader->type, _reader->frame.buffer)) {
+					if (h && !h->onFrame(_reader->frame.type, _reader->frame.buffer)) {
 						return false;
 					}
 					return true;
@@ -800,15 +818,15 @@ bool Connection::writeSocket(const apr_pollfd_t *fd) {
 	return true;
 }
 
-Connection::Connection(apr_allocator_t *a, apr_pool_t *p, conn_rec *c, apr_socket_t *s)
+Connection::Connection(apr_allocator_t *a, apr_pool_t *p, conn_rec *c, apr_socket_t *s, const DeflateParams &deflate)
 : _allocator(a), _pool(p), _connection(c), _socket(s), _group(Server(c->base_server), [this] {
 	wakeup();
 }) {
 	ap_add_output_filter(WEBSOCKET_FILTER_OUT, (void *)this, nullptr, c);
 	ap_add_input_filter(WEBSOCKET_FILTER_IN, (void *)this, nullptr, c);
 
-	_writer = new (_pool) FrameWriter(_pool, _connection->bucket_alloc);
-	_reader = new (_pool) FrameReader(_pool, _connection->bucket_alloc);
+	_writer = new (_pool) FrameWriter(_pool, _connection->bucket_alloc, deflate);
+	_reader = new (_pool) FrameReader(_pool, _connection->bucket_alloc, deflate);
 	_network = new (_pool) NetworkReader(_pool, _connection->bucket_alloc);
 
 	serenity::Connection cctx(_connection);
@@ -28,11 +28,14 @@ THE SOFTWARE.
 #include "SPBuffer.h"
 #include "Task.h"
 
+#include <zlib.h>
+
 NS_SA_EXT_BEGIN(websocket)
 
 struct FrameWriter;
 struct FrameReader;
 struct NetworkReader;
+struct DeflateStream;
 
 class Handler;
 
@@ -67,9 +70,128 @@ enum class StatusCode : uint16_t {
 	SSLError = 1015,
 };
 
+// permessage-deflate extension parameters (RFC 7692)
+struct DeflateParams {
+	bool enabled = false;
+	bool serverNoContextTakeover = false;
+	bool clientNoContextTakeover = false;
+	bool clientMaxWindowBitsOffered = false;
+	uint8_t serverMaxWindowBits = 15;
+	uint8_t clientMaxWindowBits = 15;
+
+	// select first acceptable offer from Sec-WebSocket-Extensions request header
+	static DeflateParams negotiate(StringView);
+
+	// value for Sec-WebSocket-Extensions response header
+	String encode() const;
+};
+
+// raw deflate stream, that compress or decompress whole messages with shared LZ77 window
+struct DeflateStream : AllocPool {
+	enum Mode {
+		Deflate,
+		Inflate
+	};
+
+	enum class Status {
+		Ok,
+		Overflow, // decompressed message is larger then max size
+		Error, // corrupted stream
+	};
+
+	DeflateStream(mem::pool_t *, Mode, uint8_t windowBits, bool noContextTakeover);
+
+	bool valid() const { return _valid; }
+
+	// compress message into out, with trailing 0x00 0x00 0xff 0xff removed
+	Status compress(const uint8_t *, size_t, Bytes &out);
+
+	// decompress message without trailing 0x00 0x00 0xff 0xff into out
+	Status decompress(const uint8_t *, size_t, Bytes &out, size_t max);
+
+protected:
+	Status feed(const uint8_t *, size_t, Bytes &out, size_t &offset, size_t max);
+
+	Mode _mode;
+	bool _valid = false;
+	bool _noContextTakeover = false;
+	z_stream _stream;
+};
+
+// xor payload with client mask; offset is a position of data within frame payload
+void unmask(uint32_t mask, size_t offset, uint8_t *data, size_t nbytes);
+
+// message, assembled from data frame and its continuations
+struct Frame {
+	bool fin; // fin value inside current frame
+	FrameType type; // opcode from first frame
+	Bytes buffer; // common data buffer
+	size_t block; // size of completely written block when segmented
+	size_t offset; // offset inside current frame
+	bool compressed; // RSV1 was set in first frame with permessage-deflate
+};
+
+struct FrameReader : AllocPool {
+	enum class Status : uint8_t {
+		Head,
+		Size16,
+		Size64,
+		Mask,
+		Body,
+		Control
+	};
+
+	enum class Error : uint8_t {
+		None,
+		NotInitialized, // error in reader initialization
+		ExtraIsNotEmpty,// rsv 1-3 is not empty
+		NotMasked,// input frame is not masked
+		UnknownOpcode,// unknown opcode in frame
+		InvalidSegment,// invalid FIN or OPCODE sequence in segmented frames
+		InvalidSize,// frame (or sequence) is larger then max size
+		InvalidAction,// Handler tries to perform invalid reading action
+		InvalidPayload,// compressed payload can not be decompressed
+	};
+
+	bool fin = false;
+	bool masked = false;
+
+	Status status = Status::Head;
+	Error error = Error::None;
+	FrameType type = FrameType::None;
+	uint8_t extra = 0;
+	uint32_t mask = 0;
+	size_t size = 0;
+	size_t max = config::getDefaultWebsocketMax(); // absolute maximum (even for segmented frames)
+
+	Frame frame;
+	apr_pool_t *pool;
+	StackBuffer<128> buffer;
+	apr_bucket_alloc_t *bucket_alloc;
+	apr_bucket_brigade *tmpbb;
+	DeflateStream *inflate = nullptr;
+
+	FrameReader(apr_pool_t *p, apr_bucket_alloc_t *alloc, const DeflateParams &);
+
+	operator bool() const {  return error == Error::None; }
+
+	size_t getRequiredBytes() const;
+	uint8_t * prepare(size_t &len);
+	bool save(uint8_t *, size_t nbytes);
+
+	bool isFrameReady() const;
+	bool isControlReady() const;
+	void popFrame();
+	void clear();
+
+	bool updateState();
+	bool decompressFrame();
+};
+
 class Connection : public AllocPool {
 public:
-	static Connection *create(apr_allocator_t *alloc, apr_pool_t *pool, const Request &);
+	static Connection *create(apr_allocator_t *alloc, apr_pool_t *pool, const Request &,
+			const DeflateParams & = DeflateParams());
 	static void destroy(Connection *);
 
 	static apr_status_t outputFilterFunc(ap_filter_t *f, apr_bucket_brigade *bb);
@@ -122,7 +244,7 @@ protected:
 	bool readSocket(const apr_pollfd_t *fd, Handler *h);
 	bool writeSocket(const apr_pollfd_t *fd);
 
-	Connection(apr_allocator_t *, apr_pool_t *, conn_rec *, apr_socket_t *);
+	Connection(apr_allocator_t *, apr_pool_t *, conn_rec *, apr_socket_t *, const DeflateParams &);
 
 	bool setSslCtx(conn_rec *, void *);
 	void clearSslCtx();
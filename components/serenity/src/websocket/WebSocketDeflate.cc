@@ -0,0 +1,244 @@
+/**
+Copyright (c) 2021 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "WebSocketConnection.h"
+
+NS_SA_EXT_BEGIN(websocket)
+
+// trailing empty block, that removed from compressed messages (RFC 7692, 7.2.1)
+static const uint8_t DeflateTrailer[4] = { 0x00, 0x00, 0xff, 0xff };
+
+static bool DeflateParams_readWindowBits(StringView value, uint8_t &bits) {
+	value.trimChars<StringView::CharGroup<CharGroupId::WhiteSpace>, StringView::Chars<'"'>>();
+	auto val = value.readInteger(10);
+	if (!val.valid() || !value.empty() || val.get() < 8 || val.get() > 15) {
+		return false;
+	}
+	bits = uint8_t(val.get());
+	return true;
+}
+
+static bool DeflateParams_readOffer(StringView offer, DeflateParams &params) {
+	bool valid = true;
+	bool serverMaxWindowBits = false;
+	bool isDeflate = false;
+	bool isFirst = true;
+
+	offer.split<StringView::Chars<';'>>([&] (StringView &token) {
+		token.trimChars<StringView::CharGroup<CharGroupId::WhiteSpace>>();
+		if (isFirst) {
+			isDeflate = (token == "permessage-deflate");
+			isFirst = false;
+			return;
+		}
+
+		if (!valid || !isDeflate) {
+			return;
+		}
+
+		auto name = token.readUntil<StringView::Chars<'='>>();
+		name.trimChars<StringView::CharGroup<CharGroupId::WhiteSpace>>();
+
+		bool hasValue = token.is('=');
+		if (hasValue) {
+			++ token;
+		}
+
+		// duplicated or unknown params, or params with invalid values invalidates whole offer
+		if (name == "server_no_context_takeover" && !hasValue && !params.serverNoContextTakeover) {
+			params.serverNoContextTakeover = true;
+		} else if (name == "client_no_context_takeover" && !hasValue && !params.clientNoContextTakeover) {
+			params.clientNoContextTakeover = true;
+		} else if (name == "server_max_window_bits" && hasValue && !serverMaxWindowBits) {
+			serverMaxWindowBits = true;
+			valid = DeflateParams_readWindowBits(token, params.serverMaxWindowBits);
+		} else if (name == "client_max_window_bits" && !params.clientMaxWindowBitsOffered) {
+			params.clientMaxWindowBitsOffered = true;
+			if (hasValue) {
+				valid = DeflateParams_readWindowBits(token, params.clientMaxWindowBits);
+			}
+		} else {
+			valid = false;
+		}
+	});
+
+	// zlib can not produce raw deflate stream with 256-byte window, so, we decline such offers
+	if (!isDeflate || !valid || params.serverMaxWindowBits < 9) {
+		return false;
+	}
+
+	params.enabled = true;
+	return true;
+}
+
+DeflateParams DeflateParams::negotiate(StringView header) {
+	DeflateParams ret;
+	header.split<StringView::Chars<','>>([&] (StringView &offer) {
+		if (!ret.enabled) {
+			DeflateParams params;
+			if (DeflateParams_readOffer(offer, params)) {
+				ret = params;
+			}
+		}
+	});
+	return ret;
+}
+
+String DeflateParams::encode() const {
+	if (!enabled) {
+		return String();
+	}
+
+	StringStream ret;
+	ret << "permessage-deflate";
+	if (serverNoContextTakeover) {
+		ret << "; server_no_context_takeover";
+	}
+	if (clientNoContextTakeover) {
+		ret << "; client_no_context_takeover";
+	}
+	if (serverMaxWindowBits != 15) {
+		ret << "; server_max_window_bits=" << uint32_t(serverMaxWindowBits);
+	}
+	if (clientMaxWindowBitsOffered) {
+		ret << "; client_max_window_bits=" << uint32_t(clientMaxWindowBits);
+	}
+	return ret.str();
+}
+
+DeflateStream::DeflateStream(mem::pool_t *pool, Mode mode, uint8_t windowBits, bool noContextTakeover)
+: _mode(mode), _noContextTakeover(noContextTakeover) {
+	memset((void *)&_stream, 0, sizeof(z_stream));
+
+	// negative window bits for raw deflate stream without zlib header
+	if (_mode == Deflate) {
+		_valid = deflateInit2(&_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, - int(windowBits), 8, Z_DEFAULT_STRATEGY) == Z_OK;
+	} else {
+		_valid = inflateInit2(&_stream, - int(windowBits)) == Z_OK;
+	}
+
+	if (_valid) {
+		mem::pool::cleanup_register(pool, [this] {
+			if (_mode == Deflate) {
+				deflateEnd(&_stream);
+			} else {
+				inflateEnd(&_stream);
+			}
+			_valid = false;
+		});
+	}
+}
+
+auto DeflateStream::compress(const uint8_t *data, size_t size, Bytes &out) -> Status {
+	if (!_valid || _mode != Deflate) {
+		return Status::Error;
+	}
+
+	_stream.next_in = (Bytef *)data;
+	_stream.avail_in = uInt(size);
+
+	size_t offset = 0;
+	out.resize(deflateBound(&_stream, uLong(size)) + sizeof(DeflateTrailer) + 8);
+	do {
+		if (offset == out.size()) {
+			out.resize(out.size() * 2);
+		}
+
+		_stream.next_out = (Bytef *)out.data() + offset;
+		_stream.avail_out = uInt(out.size() - offset);
+
+		auto err = ::deflate(&_stream, Z_SYNC_FLUSH);
+		offset = out.size() - _stream.avail_out;
+		if (err != Z_OK && err != Z_BUF_ERROR) {
+			return Status::Error;
+		}
+	} while (_stream.avail_out == 0);
+
+	// sync flush always ends with empty stored block
+	if (offset >= sizeof(DeflateTrailer) && memcmp(out.data() + offset - sizeof(DeflateTrailer), DeflateTrailer, sizeof(DeflateTrailer)) == 0) {
+		offset -= sizeof(DeflateTrailer);
+	}
+	out.resize(offset);
+
+	if (_noContextTakeover) {
+		deflateReset(&_stream);
+	}
+	return Status::Ok;
+}
+
+auto DeflateStream::decompress(const uint8_t *data, size_t size, Bytes &out, size_t max) -> Status {
+	if (!_valid || _mode != Inflate) {
+		return Status::Error;
+	}
+
+	size_t offset = 0;
+	out.resize(std::min(std::max(size * 4, size_t(1_KiB)), max));
+
+	auto status = feed(data, size, out, offset, max);
+	if (status == Status::Ok) {
+		status = feed(DeflateTrailer, sizeof(DeflateTrailer), out, offset, max);
+	}
+
+	out.resize(std::min(offset, max));
+
+	if (_noContextTakeover || status != Status::Ok) {
+		inflateReset(&_stream);
+	}
+	return status;
+}
+
+auto DeflateStream::feed(const uint8_t *data, size_t size, Bytes &out, size_t &offset, size_t max) -> Status {
+	_stream.next_in = (Bytef *)data;
+	_stream.avail_in = uInt(size);
+
+	do {
+		if (offset == out.size()) {
+			if (out.size() > max) {
+				return Status::Overflow;
+			}
+			// one extra byte to distinguish message of exactly max size from larger one
+			out.resize(std::min(std::max(out.size() * 2, size_t(1_KiB)), max + 1));
+		}
+
+		_stream.next_out = (Bytef *)out.data() + offset;
+		_stream.avail_out = uInt(out.size() - offset);
+
+		auto err = ::inflate(&_stream, Z_SYNC_FLUSH);
+		offset = out.size() - _stream.avail_out;
+
+		if (err == Z_STREAM_END) {
+			// peer finished stream with final block, next message starts with new stream
+			inflateReset(&_stream);
+			break;
+		} else if (err == Z_BUF_ERROR) {
+			if (_stream.avail_out != 0) {
+				break; // no more input
+			}
+		} else if (err != Z_OK) {
+			return Status::Error;
+		}
+	} while (_stream.avail_in > 0 || _stream.avail_out == 0);
+
+	return (offset > max) ? Status::Overflow : Status::Ok;
+}
+
+NS_SA_EXT_END(websocket)
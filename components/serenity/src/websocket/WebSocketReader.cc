@@ -26,69 +26,9 @@ THE SOFTWARE.
 #include "Define.h"
 #include "WebSocket.h"
 
-NS_SA_EXT_BEGIN(websocket)
-
-struct Frame {
-	bool fin; // fin value inside current frame
-	FrameType type; // opcode from first frame
-	Bytes buffer; // common data buffer
-	size_t block; // size of completely written block when segmented
-	size_t offset; // offset inside current frame
-};
-
-struct FrameReader : AllocPool {
-	enum class Status : uint8_t {
-		Head,
-		Size16,
-		Size64,
-		Mask,
-		Body,
-		Control
-	};
-
-	enum class Error : uint8_t {
-		None,
-		NotInitialized, // error in reader initialization
-		ExtraIsNotEmpty,// rsv 1-3 is not empty
-		NotMasked,// input frame is not masked
-		UnknownOpcode,// unknown opcode in frame
-		InvalidSegment,// invalid FIN or OPCODE sequence in segmented frames
-		InvalidSize,// frame (or sequence) is larger then max size
-		InvalidAction,// Handler tries to perform invalid reading action
-	};
-
-	bool fin = false;
-	bool masked = false;
-
-	Status status = Status::Head;
-	Error error = Error::None;
-	FrameType type = FrameType::None;
-	uint8_t extra = 0;
-	uint32_t mask = 0;
-	size_t size = 0;
-	size_t max = config::getDefaultWebsocketMax(); // absolute maximum (even for segmented frames)
-
-	Frame frame;
-	apr_pool_t *pool;
-	StackBuffer<128> buffer;
-	apr_bucket_alloc_t *bucket_alloc;
-	apr_bucket_brigade *tmpbb;
+#include "simde/x86/sse2.h"
 
-	FrameReader(apr_pool_t *p, apr_bucket_alloc_t *alloc);
-
-	operator bool() const {  return error == Error::None; }
-
-	size_t getRequiredBytes() const;
-	uint8_t * prepare(size_t &len);
-	bool save(uint8_t *, size_t nbytes);
-
-	bool isFrameReady() const;
-	bool isControlReady() const;
-	void popFrame();
-	void clear();
-
-	bool updateState();
-};
+NS_SA_EXT_BEGIN(websocket)
 
 struct NetworkReader : AllocPool {
 	apr_pool_t *pool = nullptr;
@@ -105,11 +45,45 @@ static size_t FrameReader_requiredBytes(const B &buffer, size_t max) {
 	return (buffer.size() < max) ? (max - buffer.size()) : 0;
 }
 
-static void FrameReader_unmask(uint32_t mask, size_t offset, uint8_t *data, size_t nbytes) {
-	uint8_t j = offset % 4;
-	for (size_t i = 0; i < nbytes; ++i, ++j) {
-		if (j >= 4) { j = 0; }
-		data[i] ^= ((mask >> (j * 8)) & 0xFF);
+void unmask(uint32_t mask, size_t offset, uint8_t *data, size_t nbytes) {
+	// rotate mask to data offset, so every 4-byte aligned block of data uses the same mask bytes
+	uint8_t maskBytes[4];
+	for (size_t j = 0; j < 4; ++ j) {
+		maskBytes[j] = (mask >> (((offset + j) % 4) * 8)) & 0xFF;
+	}
+
+	uint32_t mask32;
+	memcpy(&mask32, maskBytes, sizeof(uint32_t));
+
+	size_t i = 0;
+	auto mask128 = simde_mm_set1_epi32(int32_t(mask32));
+	for (; i + 64 <= nbytes; i += 64) {
+		auto ptr = (simde__m128i *)(data + i);
+		auto v0 = simde_mm_loadu_si128(ptr);
+		auto v1 = simde_mm_loadu_si128(ptr + 1);
+		auto v2 = simde_mm_loadu_si128(ptr + 2);
+		auto v3 = simde_mm_loadu_si128(ptr + 3);
+		simde_mm_storeu_si128(ptr, simde_mm_xor_si128(v0, mask128));
+		simde_mm_storeu_si128(ptr + 1, simde_mm_xor_si128(v1, mask128));
+		simde_mm_storeu_si128(ptr + 2, simde_mm_xor_si128(v2, mask128));
+		simde_mm_storeu_si128(ptr + 3, simde_mm_xor_si128(v3, mask128));
+	}
+
+	for (; i + 16 <= nbytes; i += 16) {
+		auto ptr = (simde__m128i *)(data + i);
+		simde_mm_storeu_si128(ptr, simde_mm_xor_si128(simde_mm_loadu_si128(ptr), mask128));
+	}
+
+	uint64_t mask64 = uint64_t(mask32) | (uint64_t(mask32) << 32);
+	for (; i + 8 <= nbytes; i += 8) {
+		uint64_t v;
+		memcpy(&v, data + i, sizeof(uint64_t));
+		v ^= mask64;
+		memcpy(data + i, &v, sizeof(uint64_t));
+	}
+
+	for (; i < nbytes; ++ i) {
+		data[i] ^= maskBytes[i % 4];
 	}
 }
 
@@ -128,7 +102,6 @@ static FrameType FrameReader_getTypeFromOpcode(uint8_t opcode) {
 static bool isControlFrameType(FrameType t) {
 	switch (t) {
 	case FrameType::Close:
-	case FrameType::Continue:
 	case FrameType::Ping:
 	case FrameType::Pong:
 		return true;
@@ -150,6 +123,7 @@ StatusCode Connection::resolveStatus(StatusCode code) {
 		case FrameReader::Error::InvalidSegment: return StatusCode::ProtocolError; break;
 		case FrameReader::Error::InvalidSize: return StatusCode::TooLarge; break;
 		case FrameReader::Error::InvalidAction: return StatusCode::UnexceptedCondition; break;
+		case FrameReader::Error::InvalidPayload: return StatusCode::NotConsistent; break;
 		default: return StatusCode::Ok; break;
 		}
 	} else if (code == StatusCode::None) {
@@ -158,14 +132,22 @@ StatusCode Connection::resolveStatus(StatusCode code) {
 	return code;
 }
 
-FrameReader::FrameReader(apr_pool_t *p, apr_bucket_alloc_t *alloc)
-: frame(Frame{false, FrameType::None, Bytes(), 0, 0})
+FrameReader::FrameReader(apr_pool_t *p, apr_bucket_alloc_t *alloc, const DeflateParams &params)
+: frame(Frame{false, FrameType::None, Bytes(), 0, 0, false})
 , pool(memory::pool::create(p)), bucket_alloc(alloc) {
 	if (!pool) {
 		error = Error::NotInitialized;
 	} else {
 	    tmpbb = apr_brigade_create(pool, bucket_alloc);
 		new (&frame.buffer) Bytes(pool); // switch allocator
+
+		if (params.enabled) {
+			// stream should outlive frame pool
+			inflate = new (p) DeflateStream(p, DeflateStream::Inflate, params.clientMaxWindowBits, params.clientNoContextTakeover);
+			if (!inflate->valid()) {
+				error = Error::NotInitialized;
+			}
+		}
 	}
 }
 
@@ -203,10 +185,13 @@ bool FrameReader::save(uint8_t *b, size_t nbytes) {
 	case Status::Size16:
 	case Status::Size64:
 	case Status::Mask:
+		buffer.save(b, nbytes); break;
 	case Status::Control:
+		// control frame payload is masked the same way as data payload
+		unmask(mask, buffer.size(), b, nbytes);
 		buffer.save(b, nbytes); break;
 	case Status::Body:
-		FrameReader_unmask(mask, frame.offset, b, nbytes);
+		unmask(mask, frame.offset, b, nbytes);
 		frame.offset += nbytes;
 		break;
 	default: break;
@@ -233,6 +218,12 @@ bool FrameReader::updateState() {
 		masked =	(buffer[1] & 0b10000000) != 0;
 		size =		(buffer[1] & 0b01111111);
 
+		if (extra == 0b01000000 && inflate && (type == FrameType::Text || type == FrameType::Binary)) {
+			// RSV1 marks compressed message, only first frame of data message can be marked
+			frame.compressed = true;
+			extra = 0;
+		}
+
 		if (extra != 0 || !masked || type == FrameType::None) {
 			if (extra != 0) {
 				error = Error::ExtraIsNotEmpty;
@@ -245,12 +236,18 @@ bool FrameReader::updateState() {
 			return false;
 		}
 
-		if (!frame.buffer.empty()) {
-			if (!isControlFrameType(type)) {
+		if (isControlFrameType(type)) {
+			// control frames can be injected in the middle of fragmented message, but can not be fragmented itself
+			if (!fin || size > 125) {
 				error = Error::InvalidSegment;
 				messages::error("Websocket", "Invalid segment", mem::Value(toInt(error)));
 				return false;
 			}
+		} else if ((type == FrameType::Continue) != (frame.type != FrameType::None)) {
+			// continuation is valid only after non-final data frame, and new message can not start before it ends
+			error = Error::InvalidSegment;
+			messages::error("Websocket", "Invalid segment", mem::Value(toInt(error)));
+			return false;
 		}
 
 		if (size > max) {
@@ -317,6 +314,15 @@ bool FrameReader::updateState() {
 		if (type != FrameType::Continue) {
 			frame.type = type;
 		}
+		if (fin) {
+			if (frame.compressed) {
+				return decompressFrame();
+			}
+		} else {
+			// wait for continuation frame
+			frame.offset = 0;
+			status = Status::Head;
+		}
 		break;
 	default:
 		break;
@@ -340,6 +346,31 @@ bool FrameReader::updateState() {
 	return true;
 }
 
+bool FrameReader::decompressFrame() {
+	Bytes out(pool);
+	switch (inflate->decompress(frame.buffer.data(), frame.block, out, max)) {
+	case DeflateStream::Status::Ok:
+		break;
+	case DeflateStream::Status::Overflow:
+		error = Error::InvalidSize;
+		messages::error("Websocket", "Too large query", mem::Value{{
+			pair("size", mem::Value(out.size())),
+			pair("max", mem::Value(max)),
+		}});
+		return false;
+		break;
+	case DeflateStream::Status::Error:
+		error = Error::InvalidPayload;
+		messages::error("Websocket", "Invalid compressed payload", mem::Value(toInt(error)));
+		return false;
+		break;
+	}
+
+	frame.buffer = move(out);
+	frame.block = frame.buffer.size();
+	return true;
+}
+
 bool FrameReader::isControlReady() const {
 	if (status == Status::Control && getRequiredBytes() == 0) {
 		return true;
@@ -380,6 +411,7 @@ void FrameReader::clear() {
 	frame.offset = 0;
 	frame.fin = true;
 	frame.type = FrameType::None;
+	frame.compressed = false;
 }
 
 NetworkReader::NetworkReader(apr_pool_t *p, apr_bucket_alloc_t *alloc) : bucket_alloc(alloc) {
@@ -59,8 +59,10 @@ struct FrameWriter : AllocPool {
 	apr_bucket_brigade *tmpbb = nullptr;
 	WriteSlot *firstSlot = nullptr;
 	WriteSlot *lastSlot = nullptr;
+	DeflateStream *deflate = nullptr;
+	apr_pool_t *deflatePool = nullptr; // temporary pool for compressed message
 
-	FrameWriter(apr_pool_t *, apr_bucket_alloc_t *alloc);
+	FrameWriter(apr_pool_t *, apr_bucket_alloc_t *alloc, const DeflateParams &);
 
 	bool empty() const { return firstSlot == nullptr; }
 
@@ -83,13 +85,13 @@ static uint8_t getOpcodeFromType(FrameType opcode) {
 	return 0;
 }
 
-static void makeHeader(StackBuffer<32> &buf, size_t dataSize, FrameType t) {
+static void makeHeader(StackBuffer<32> &buf, size_t dataSize, FrameType t, bool compressed = false) {
 	size_t sizeSize = (dataSize <= 125) ? 0 : ((dataSize > (size_t)maxOf<uint16_t>())? 8 : 2);
 	size_t frameSize = 2 + sizeSize;
 
 	buf.prepare(frameSize);
 
-	buf[0] = ((uint8_t)0b10000000 | getOpcodeFromType(t));
+	buf[0] = ((uint8_t)0b10000000 | (compressed ? (uint8_t)0b01000000 : (uint8_t)0) | getOpcodeFromType(t));
 	if (sizeSize == 0) {
 		buf[1] = ((uint8_t)dataSize);
 	} else if (sizeSize == 2) {
@@ -137,8 +139,16 @@ void WriteSlot::pop(size_t size) {
 	}
 }
 
-FrameWriter::FrameWriter(apr_pool_t *p, apr_bucket_alloc_t *alloc) : pool(p) {
+FrameWriter::FrameWriter(apr_pool_t *p, apr_bucket_alloc_t *alloc, const DeflateParams &params) : pool(p) {
 	tmpbb = apr_brigade_create(p, alloc);
+
+	if (params.enabled) {
+		auto stream = new (p) DeflateStream(p, DeflateStream::Deflate, params.serverMaxWindowBits, params.serverNoContextTakeover);
+		if (stream->valid()) {
+			deflate = stream;
+			deflatePool = memory::pool::create(p);
+		}
+	}
 }
 
 void FrameWriter::popReadSlot() {
@@ -850,6 +850,472 @@ const VarStorage *ContextFn::getVarStorage(VarScope *scope, const StringView &ke
 	return nullptr;
 }
 
+struct ContextVM {
+	using Op = Template::Op;
+	using OpCode = Template::OpCode;
+	using Options = Template::Options;
+
+	static const Op VirtualHtml;
+	static const Op VirtualBody;
+
+	bool run(const Op *begin, const Op *end);
+
+	bool runTagOpen(const Op &);
+	bool runTagClose(const Op &);
+	void runTagInline(const Op &);
+
+	bool runIf(const Op &);
+	bool runEach(const Op &, const Op *elseOp);
+	bool runCase(const Op &);
+	bool runWhile(const Op &);
+	bool runInclude(const Op &);
+	bool runMixin(const Op &);
+
+	void pushWithPrettyFilter(memory::ostringstream &, size_t indent);
+	void onError(const StringView &);
+
+	Context *ctx = nullptr;
+	const Template *tpl = nullptr;
+	std::ostream *out = nullptr;
+	Options opts;
+	bool stopOnError = false;
+
+	Vector<const Op *> tagStack;
+	bool withinHead = false;
+	bool withinBody = false;
+};
+
+const ContextVM::Op ContextVM::VirtualHtml{OpCode::TagClose, Template::TagVirtual, 0, StringView("</html>")};
+const ContextVM::Op ContextVM::VirtualBody{OpCode::TagClose, Template::TagVirtual, 0, StringView("</body>")};
+
+bool ContextVM::run(const Op *op, const Op *end) {
+	while (op != end) {
+		auto &c = *op;
+		switch (c.code) {
+		case OpCode::Text:
+			*out << c.value;
+			break;
+		case OpCode::TagOpen:
+			runTagOpen(c);
+			break;
+		case OpCode::TagClose:
+			if (!runTagClose(c)) {
+				return false;
+			}
+			break;
+		case OpCode::TagSelfClosed:
+			if (opts.hasFlag(Options::LineFeeds) && !tagStack.empty()) {
+				*out << "\n";
+			}
+			*out << c.value;
+			break;
+		case OpCode::TagInline:
+			runTagInline(c);
+			break;
+		case OpCode::Output:
+			if (!ctx->print(*c.expr, *out, c.flags & Template::Escaped) && stopOnError) {
+				return false;
+			}
+			break;
+		case OpCode::Attribute:
+			if (!ctx->printAttr(c.value, *c.expr, *out, c.flags & Template::Escaped) && stopOnError) {
+				return false;
+			}
+			break;
+		case OpCode::AttributeList:
+			if (!ctx->printAttrExprList(*c.expr, *out) && stopOnError) {
+				return false;
+			}
+			break;
+		case OpCode::Code:
+			if (!ctx->exec(*c.expr, *out) && stopOnError) {
+				return false;
+			}
+			break;
+		case OpCode::Block:
+		case OpCode::When:
+		case OpCode::Default:
+			run(c.begin(), c.end());
+			break;
+		case OpCode::Case:
+			if (!runCase(c) && stopOnError) {
+				return false;
+			}
+			break;
+		case OpCode::If:
+			if (!runIf(c) && stopOnError) {
+				return false;
+			}
+			break;
+		case OpCode::Each:
+		case OpCode::EachPair:
+			if (c.flags & Template::HasElse) {
+				auto elseOp = c.end();
+				if (!runEach(c, elseOp) && stopOnError) {
+					return false;
+				}
+				op = elseOp;
+			} else if (!runEach(c, nullptr) && stopOnError) {
+				return false;
+			}
+			break;
+		case OpCode::While:
+			if (!runWhile(c) && stopOnError) {
+				return false;
+			}
+			break;
+		case OpCode::Include:
+			if (!runInclude(c) && stopOnError) {
+				return false;
+			}
+			break;
+		case OpCode::Mixin:
+			if (!ctx->setMixin(c.value, &c)) {
+				onError(toString("Invalid mixin declaration: ", c.value));
+			}
+			break;
+		case OpCode::MixinCall:
+			if (!runMixin(c)) {
+				return false;
+			}
+			break;
+		case OpCode::Branch:
+		case OpCode::Else:
+			// should not be in this context
+			return false;
+			break;
+		}
+		op = op->end();
+	}
+	return true;
+}
+
+bool ContextVM::runTagOpen(const Op &c) {
+	if (opts.hasFlag(Options::LineFeeds) && !tagStack.empty()) {
+		*out << "\n";
+	}
+	if (tagStack.empty() && (c.flags & Template::TagHtml) == 0) {
+		*out << "<html>";
+		tagStack.push_back(&VirtualHtml);
+	}
+	if (c.flags & Template::TagHead) {
+		withinHead = true;
+	} else if (!withinHead) {
+		if (c.flags & Template::TagBody) {
+			withinBody = true;
+		} else if (!withinBody) {
+			*out << "<body>";
+			tagStack.push_back(&VirtualBody);
+			withinBody = true;
+		}
+	}
+	tagStack.push_back(&c);
+	*out << c.value;
+	return true;
+}
+
+bool ContextVM::runTagClose(const Op &c) {
+	while (!tagStack.empty() && (tagStack.back()->flags & Template::TagVirtual)) {
+		*out << tagStack.back()->value;
+		tagStack.pop_back();
+	}
+	if (tagStack.empty()) {
+		return false;
+	}
+	if (tagStack.back()->flags & Template::TagHead) {
+		withinHead = false;
+	} else if (tagStack.back()->flags & Template::TagBody) {
+		withinBody = false;
+	}
+	*out << c.value;
+	tagStack.pop_back();
+	if (opts.hasFlag(Options::LineFeeds) && !tagStack.empty()) {
+		*out << "\n";
+	}
+	return true;
+}
+
+void ContextVM::runTagInline(const Op &c) {
+	if (tagStack.empty() && (c.flags & Template::TagHtml) == 0) {
+		*out << "<html>";
+		tagStack.push_back(&VirtualHtml);
+	}
+	if ((c.flags & Template::TagHead) == 0 && !withinHead) {
+		if ((c.flags & Template::TagBody) == 0 && !withinBody) {
+			*out << "<body>";
+			tagStack.push_back(&VirtualBody);
+			withinBody = true;
+		}
+	}
+	if (opts.hasFlag(Options::LineFeeds) && !tagStack.empty()) {
+		*out << "\n";
+	}
+	*out << c.value;
+}
+
+bool ContextVM::runIf(const Op &chain) {
+	Context::VarScope scope;
+	ctx->pushVarScope(scope);
+
+	bool r = true;
+	bool success = false;
+	bool allowElseIf = (chain.flags & Template::Unless) == 0;
+
+	auto it = chain.begin();
+	while (it != chain.end() && it->code == OpCode::Branch) {
+		if (auto var = ctx->exec(*it->expr, *out, true)) {
+			auto &v = var.readValue();
+			auto val = (v.getType() == Value::Type::DICTIONARY || v.getType() == Value::Type::ARRAY) ? !v.empty() : v.asBool();
+			if ((!allowElseIf && !val) || val) {
+				if (!run(it->begin(), it->end())) {
+					r = false;
+				}
+				success = true;
+				break;
+			}
+		} else {
+			r = false;
+		}
+		it = it->end();
+	}
+
+	if (!success && it != chain.end() && it->code == OpCode::Else) {
+		if (!run(it->begin(), it->end())) {
+			r = false;
+		}
+	}
+
+	ctx->popVarScope();
+	return r;
+}
+
+bool ContextVM::runEach(const Op &c, const Op *elseOp) {
+	if (c.value.empty() || (c.code == OpCode::EachPair && c.extra.empty())) {
+		return false;
+	}
+
+	bool r = true;
+	bool runElse = false;
+
+	Context::VarScope scope;
+	ctx->pushVarScope(scope);
+
+	auto setVars = [&] (Value &&key, const Value *val, bool isConst) {
+		ctx->set(c.value, isConst, val);
+		if (c.code == OpCode::EachPair) {
+			ctx->set(c.extra, move(key));
+		}
+	};
+
+	if (auto var = ctx->exec(*c.expr, *out)) {
+		auto runWithVar = [&] (const Value &val, bool isConst) -> bool {
+			if (val.isArray()) {
+				if (val.size() > 0) {
+					size_t i = 0;
+					for (auto &v_it : val.asArray()) {
+						setVars(Value(uint32_t(i)), &v_it, isConst);
+						if (!run(c.begin(), c.end()) && stopOnError) {
+							return false;
+						}
+						scope.namedVars.clear();
+						++ i;
+					}
+				} else {
+					runElse = true;
+				}
+			} else if (val.isDictionary()) {
+				if (val.size() > 0) {
+					for (auto &v_it : val.asDict()) {
+						setVars(Value(v_it.first), &v_it.second, isConst);
+						if (!run(c.begin(), c.end()) && stopOnError) {
+							return false;
+						}
+						scope.namedVars.clear();
+					}
+				} else {
+					runElse = true;
+				}
+			} else if (!elseOp) {
+				if (val) {
+					setVars(Value(0), &val, isConst);
+					if (!run(c.begin(), c.end()) && stopOnError) {
+						return false;
+					}
+				}
+			} else {
+				runElse = true;
+			}
+			return true;
+		};
+
+		if (Value * mut = var.getMutable()) {
+			r = runWithVar(*mut, false);
+		} else if (const Value &rv = var.readValue()) {
+			r = runWithVar(rv, true);
+		}
+	} else {
+		r = false;
+		runElse = true;
+	}
+
+	if (elseOp && runElse) {
+		if (!run(elseOp->begin(), elseOp->end()) && stopOnError) {
+			r = false;
+		}
+	}
+
+	ctx->popVarScope();
+	return r;
+}
+
+bool ContextVM::runCase(const Op &c) {
+	auto runWhen = [&] (const Op *it) -> bool {
+		// empty when falls through to next non-empty one
+		while (it != c.end() && it->code == OpCode::When) {
+			if (it->size > 0) {
+				return run(it->begin(), it->end());
+			}
+			it = it->end();
+		}
+		return false;
+	};
+
+	auto perform = [&] () -> bool {
+		if (auto var = ctx->exec(*c.expr, *out)) {
+			auto &val = var.readValue();
+			if (val) {
+				const Op *def = nullptr;
+				auto it = c.begin();
+				while (it != c.end()) {
+					switch (it->code) {
+					case OpCode::When:
+						if (auto v = ctx->exec(*it->expr, *out)) {
+							if (val == v.readValue()) {
+								return runWhen(it);
+							}
+						} else {
+							return false;
+						}
+						break;
+					case OpCode::Default: def = it; break;
+					default: break;
+					}
+					it = it->end();
+				}
+				if (def) {
+					return run(def->begin(), def->end());
+				} else {
+					return true;
+				}
+			}
+		}
+		return false;
+	};
+
+	Context::VarScope scope;
+	ctx->pushVarScope(scope);
+	auto ret = perform();
+	ctx->popVarScope();
+	return ret;
+}
+
+bool ContextVM::runWhile(const Op &c) {
+	Context::VarScope scope;
+	while (true) {
+		if (auto var = ctx->exec(*c.expr, *out)) {
+			if (var.readValue().asBool()) {
+				scope.namedVars.clear();
+				scope.mixins.clear();
+				ctx->pushVarScope(scope);
+				if (!run(c.begin(), c.end())) {
+					ctx->popVarScope();
+					return false;
+				}
+				ctx->popVarScope();
+			} else {
+				return true;
+			}
+		} else {
+			break;
+		}
+	}
+	return false;
+}
+
+bool ContextVM::runInclude(const Op &c) {
+	if (tpl->getOptions().hasFlag(Options::Pretty)) {
+		memory::ostringstream stream;
+		if (!ctx->runInclude(c.value, stream, tpl)) {
+			return false;
+		}
+		pushWithPrettyFilter(stream, c.indent);
+		return true;
+	}
+	return ctx->runInclude(c.value, *out, tpl);
+}
+
+bool ContextVM::runMixin(const Op &c) {
+	auto mixin = ctx->getMixin(c.value);
+	if (!mixin) {
+		onError(toString("Mixin with name ", c.value, " is not found"));
+		return !stopOnError;
+	}
+
+	if (c.args.size() < mixin->required) {
+		onError(toString("Not enough arguments for mixin: ", c.value));
+		if (stopOnError) {
+			return false;
+		}
+	}
+
+	Context::VarScope scope;
+
+	for (size_t i = 0; i < mixin->args.size(); ++ i) {
+		auto &it = mixin->args[i];
+		auto n = scope.namedVars.emplace(it.first.str<memory::PoolInterface>(), VarStorage()).first;
+		if (i < c.args.size()) {
+			n->second.assign(ctx->exec(*c.args.at(i), *out));
+		} else if (it.second) {
+			n->second.assign(ctx->exec(*it.second, *out));
+		} else {
+			onError(toString("Invalid argument for ", it.first));
+			if (stopOnError) {
+				return false;
+			}
+		}
+	}
+
+	ctx->pushVarScope(scope);
+	auto ret = run(mixin->op->begin(), mixin->op->end());
+	ctx->popVarScope();
+
+	return ret || !stopOnError;
+}
+
+void ContextVM::pushWithPrettyFilter(memory::ostringstream &str, size_t indent) {
+	StringView r(str.weak());
+	*out << '\n';
+	while (!r.empty()) {
+		for (size_t i = 0; i < indent; ++ i) {
+			*out << '\t';
+		}
+		*out << r.readUntil<StringView::Chars<'\r', '\n'>>();
+		*out << r.readChars<StringView::Chars<'\r'>>();
+		if (r.is('\n')) {
+			*out << '\n';
+			++ r;
+		}
+	}
+}
+
+void ContextVM::onError(const StringView &err) {
+	if (out != &std::cout) {
+		*out << "Context error: " << err << "\n";
+	} else {
+		*out << "<!-- " << "Context error: " << err << " -->";
+	}
+}
+
 void Context::VarList::emplace(Var &&var) {
 	if (staticCount < MinStaticVars) {
 		staticList[staticCount] = move(var);
@@ -985,6 +1451,25 @@ Var Context::exec(const Expression &expr, std::ostream &out, bool allowUndefined
 	return fn.execExpr(expr, expr.op, false);
 }
 
+bool Context::run(const Template &tpl, std::ostream &out, const Template::Options &opts) {
+	auto program = tpl.getProgram();
+
+	ContextVM vm{this, &tpl, &out, opts, tpl.getOptions().hasFlag(Template::Options::StopOnError)};
+	vm.tagStack.reserve(8);
+
+	auto ret = vm.run(program.data(), program.data() + program.size());
+	if (ret) {
+		while (!vm.tagStack.empty() && (vm.tagStack.back()->flags & Template::TagVirtual)) {
+			out << vm.tagStack.back()->value;
+			vm.tagStack.pop_back();
+		}
+		if (!vm.tagStack.empty()) {
+			return false;
+		}
+	}
+	return ret;
+}
+
 void Context::set(const StringView &name, const Value &val, VarClass *cl) {
 	auto it = currentScope->namedVars.emplace(name.str<memory::PoolInterface>()).first;
 	it->second.set(val, cl);
@@ -1046,15 +1531,15 @@ static bool Context_processMixinArgs(Context::Mixin &mixin, Expression *expr) {
 	return true;
 }
 
-bool Context::setMixin(const StringView &name, const Template::Chunk *chunk) {
+bool Context::setMixin(const StringView &name, const Template::Op *op) {
 	auto it = currentScope->mixins.find(name);
 	if (it != currentScope->mixins.end()) {
 		return false;
 	}
 
-	Mixin mixin{chunk};
-	if (chunk->expr && chunk->expr->op == Expression::Call) {
-		if (!Context_processMixinArgs(mixin, chunk->expr->right)) {
+	Mixin mixin{op};
+	if (op->expr && op->expr->op == Expression::Call) {
+		if (!Context_processMixinArgs(mixin, op->expr->right)) {
 			return false;
 		}
 	}
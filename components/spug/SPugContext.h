@@ -37,7 +37,7 @@ public:
 	using IncludeCallback = Function<bool(const StringView &, Context &, std::ostream &, const Template *)>;
 
 	struct Mixin {
-		const Template::Chunk *chunk;
+		const Template::Op *op;
 		Vector<Pair<StringView, Expression *>> args;
 		size_t required = 0;
 	};
@@ -75,13 +75,16 @@ public:
 	bool printAttrExprList(const Expression &, std::ostream &);
 	Var exec(const Expression &, std::ostream &, bool allowUndefined = false);
 
+	// execute compiled template program
+	bool run(const Template &, std::ostream &, const Template::Options &);
+
 	void set(const StringView &name, const Value &, VarClass * = nullptr);
 	void set(const StringView &name, Value &&, VarClass * = nullptr);
 	void set(const StringView &name, bool isConst, const Value *, VarClass * = nullptr);
 
 	void set(const StringView &name, Callback &&);
 
-	bool setMixin(const StringView &name, const Template::Chunk *);
+	bool setMixin(const StringView &name, const Template::Op *);
 	const Mixin *getMixin(const StringView &name) const;
 
 	const VarStorage *getVar(const StringView &name) const;
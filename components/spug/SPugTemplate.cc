@@ -634,6 +634,8 @@ Template::Template(memory::pool_t *p, const StringView &str, const Options &opts
 		renderer.flushBuffer();
 		renderer.end();
 		_includes = move(renderer.extractIncludes());
+
+		compileChunk(_root);
 	}
 }
 
@@ -642,20 +644,7 @@ bool Template::run(Context &ctx, std::ostream &out) const {
 }
 
 bool Template::run(Context &ctx, std::ostream &out, const Options &opts) const {
-	RunContext rctx;
-	rctx.tagStack.reserve(8);
-	rctx.opts = opts;
-	auto ret = runChunk(_root, ctx, out, rctx);
-	if (ret) {
-		while (!rctx.tagStack.empty() && rctx.tagStack.back()->type == VirtualTag) {
-			out << rctx.tagStack.back()->value;
-			rctx.tagStack.pop_back();
-		}
-		if (!rctx.tagStack.empty()) {
-			return false;
-		}
-	}
-	return ret;
+	return ctx.run(*this, out, opts);
 }
 
 static void Template_describeChunk(std::ostream &stream, const Template::Chunk &chunk, size_t depth) {
@@ -709,6 +698,41 @@ void Template::describe(std::ostream &stream, bool tokens) const {
 	}
 	Template_describeChunk(stream, _root, 0);
 	stream << "\n";
+
+	stream << "Program:\n";
+	for (size_t i = 0; i < _program.size(); ++ i) {
+		auto &op = _program[i];
+		stream << "  " << i << ": ";
+		switch (op.code) {
+		case OpCode::Text: stream << "text " << op.value.size() << " bytes"; break;
+		case OpCode::TagOpen: stream << "tag-open " << op.value; break;
+		case OpCode::TagClose: stream << "tag-close " << op.value; break;
+		case OpCode::TagSelfClosed: stream << "tag-self-closed " << op.value; break;
+		case OpCode::TagInline: stream << "tag-inline " << op.value; break;
+		case OpCode::Output: stream << ((op.flags & Escaped) ? "output-escaped" : "output-unescaped"); break;
+		case OpCode::Attribute: stream << ((op.flags & Escaped) ? "attr-escaped " : "attr-unescaped ") << op.value; break;
+		case OpCode::AttributeList: stream << "attr-list"; break;
+		case OpCode::Code: stream << "code"; break;
+		case OpCode::Block: stream << "block"; break;
+		case OpCode::Case: stream << "case"; break;
+		case OpCode::When: stream << "when"; break;
+		case OpCode::Default: stream << "default"; break;
+		case OpCode::If: stream << ((op.flags & Unless) ? "unless" : "if"); break;
+		case OpCode::Branch: stream << "branch"; break;
+		case OpCode::Else: stream << "else"; break;
+		case OpCode::Each: stream << "each " << op.value; break;
+		case OpCode::EachPair: stream << "each " << op.value << " " << op.extra; break;
+		case OpCode::While: stream << "while"; break;
+		case OpCode::Include: stream << "include " << op.value; break;
+		case OpCode::Mixin: stream << "mixin " << op.value; break;
+		case OpCode::MixinCall: stream << "mixin-call " << op.value << " of " << op.args.size(); break;
+		}
+		if (op.size) {
+			stream << " -> " << i + op.size + 1;
+		}
+		stream << "\n";
+	}
+	stream << "\n";
 }
 
 static void Template_readMixinArgs(Vector<Expression *> &vars, Expression *expr) {
@@ -722,513 +746,184 @@ static void Template_readMixinArgs(Vector<Expression *> &vars, Expression *expr)
 	}
 }
 
-bool Template::runChunk(const Chunk &chunk, Context &exec, std::ostream &out, RunContext &tagStack) const {
-	auto onError = [&] (const StringView &err) {
-		if (&out != &std::cout) {
-			out << "Context error: " << err << "\n";
-		} else {
-			out << "<!-- " << "Context error: " << err << " -->";
-		}
-	};
-
-	auto runIf = [&] (auto &it) -> bool {
-		Context::VarScope scope;
-		exec.pushVarScope(scope);
-
-		bool success = false;
-		bool r = true;
-		bool allowElseIf = (*it)->type == ControlIf;
-
-		auto tryExec = [&] () -> bool {
-			if (auto var = exec.exec(*(*it)->expr, out, true)) {
-				auto &v = var.readValue();
-				auto val = (v.getType() == Value::Type::DICTIONARY || v.getType() == Value::Type::ARRAY) ? !v.empty() : v.asBool();
-				if ((!allowElseIf && !val) || val) {
-					if (!runChunk(**it, exec, out, tagStack)) {
-						r = false;
-					}
-					return true;
-				} else {
-					++ it;
-				}
-			} else {
-				++ it;
-				r = false;
-			}
-			return false;
-		};
-
-
-		if ((*it)->type == ControlIf || (*it)->type == ControlUnless) {
-			if (tryExec()) {
-				success = true;
-				++ it;
-			}
-		}
-
-		if (!success && allowElseIf) {
-			while (it != chunk.chunks.end() && (*it)->type == ControlElseIf) {
-				if (tryExec()) {
-					success = true;
-					++ it;
-					break;
-				}
-			}
-		}
-
-		if (!success && it != chunk.chunks.end() && (*it)->type == ControlElse) {
-			if (!runChunk(**it, exec, out, tagStack)) {
-				success = true;
-				r = false;
-			}
-			++ it;
-		}
-
-		while (it != chunk.chunks.end() && ((*it)->type == ControlElse || (allowElseIf && (*it)->type == ControlElseIf))) {
-			++ it;
-		}
-
-		exec.popVarScope();
-
-		return r;
-	};
-
-	auto runEachBody = [&] (auto &it, const auto &cb) -> bool {
-		bool r = true;
-		Context::VarScope scope;
-		exec.pushVarScope(scope);
-
-		auto next = it + 1;
-		bool hasElse = (next != chunk.chunks.end() && (*next)->type == ControlElse);
-		bool runElse = false;
-
-		if (auto var = exec.exec(*(*it)->expr, out)) {
-			auto runWithVar = [&] (const Value &val, bool isConst) -> bool {
-				if (val.isArray()) {
-					size_t i = 0;
-					if (val.size() > 0) {
-						for (auto &v_it : val.asArray()) {
-							cb(Value(uint32_t(i)), &v_it, isConst);
-							if (!runChunk(**it, exec, out, tagStack) && _opts.hasFlag(Options::StopOnError)) {
-								return false;
-							}
-							scope.namedVars.clear();
-							++ i;
-						}
-					} else {
-						runElse = true;
-					}
-				} else if (val.isDictionary()) {
-					if (val.size() > 0) {
-						for (auto &v_it : val.asDict()) {
-							cb(Value(v_it.first), &v_it.second, isConst);
-							if (!runChunk(**it, exec, out, tagStack) && _opts.hasFlag(Options::StopOnError)) {
-								return false;
-							}
-							scope.namedVars.clear();
-						}
-					} else {
-						runElse = true;
-					}
-				} else {
-					if (!hasElse) {
-						if (val) {
-							cb(Value(0), &val, isConst);
-							if (!runChunk(**it, exec, out, tagStack) && _opts.hasFlag(Options::StopOnError)) {
-								return false;
-							}
-						}
-					} else {
-						runElse = true;
-					}
-				}
-				return true;
-			};
-
-			if (Value * mut = var.getMutable()) {
-				r = runWithVar(*mut, false);
-			} else if (const Value &rv = var.readValue()) {
-				r = runWithVar(rv, true);
-			}
-		} else {
-			r = false;
-			runElse = true;
-		}
-
-		if (hasElse) {
-			++ it;
-			if (runElse) {
-				if (!runChunk(**it, exec, out, tagStack) && _opts.hasFlag(Options::StopOnError)) {
-					return false;
-				}
-			}
-		}
-
-		exec.popVarScope();
-		++ it;
-		return r;
-	};
-
-	auto runEach = [&] (auto &it) -> bool {
-		StringView varName((*it)->value);
-		if (varName.empty()) {
-			return false;
-		}
-
-		return runEachBody(it, [&] (Value &&it, const Value *val, bool isConst) {
-			exec.set(varName, isConst, val);
-		});
-	};
-
-	auto runEachPair = [&] (auto &it) -> bool {
-		StringView varFirst;
-		StringView varSecond;
-
-		string::split((*it)->value, " ", [&] (const StringView &val) {
-			if (varFirst.empty()) {
-				varFirst = val;
-			} else {
-				varSecond = val;
-			}
-		});
-
-		if (varFirst.empty() || varSecond.empty()) {
-			return false;
-		}
-
-		return runEachBody(it, [&] (Value &&it, const Value *val, bool isConst) {
-			exec.set(varFirst, isConst, val);
-			exec.set(varSecond, move(it));
-		});
-	};
-
-	auto runWhile = [&] (const Chunk &ch) {
-		Context::VarScope scope;
-		while (true) {
-			if (auto var = exec.exec(*ch.expr, out)) {
-				if (var.readValue().asBool()) {
-					scope.namedVars.clear();
-					scope.mixins.clear();
-					exec.pushVarScope(scope);
-					if (!runChunk(ch, exec, out, tagStack)) {
-						exec.popVarScope();
-						return false;
-					}
-					exec.popVarScope();
-				} else {
-					return true;
-				}
-			} else {
-				break;
-			}
-		}
-		return false;
-	};
-
-	auto runMixinChunk = [&] (const Chunk &ch) -> bool {
-		auto mixin = exec.getMixin(ch.value);
-		if (!mixin) {
-			onError(toString("Mixin with name ", ch.value, " is not found"));
-			if (_opts.hasFlag(Options::StopOnError)) {
-				return false;
-			}
-			return true;
-		}
-
-		Vector<Expression *> vars;
-		Template_readMixinArgs(vars, ch.expr);
-
-		if (vars.size() < mixin->required) {
-			onError(toString("Not enough arguments for mixin: ", ch.value));
-			if (_opts.hasFlag(Options::StopOnError)) {
-				return false;
-			}
-		}
-
-		Context::VarScope scope;
-
-		for (size_t i = 0; i < mixin->args.size(); ++ i) {
-			auto &it = mixin->args[i];
-			auto n = scope.namedVars.emplace(it.first.str<memory::PoolInterface>(), VarStorage()).first;
-			if (i < vars.size()) {
-				n->second.assign(exec.exec(*vars.at(i), out));
-			} else if (it.second) {
-				n->second.assign(exec.exec(*it.second, out));
-			} else {
-				onError(toString("Invalid argument for ", it.first));
-				if (_opts.hasFlag(Options::StopOnError)) {
-					return false;
-				}
-			}
-		}
-
-		exec.pushVarScope(scope);
-
-		if (!runChunk(*mixin->chunk, exec, out, tagStack) && _opts.hasFlag(Options::StopOnError)) {
-			return false;
-		}
-
-		exec.popVarScope();
-		return true;
-	};
+static uint8_t Template_getTagFlags(const StringView &value) {
+	auto name = string::tolower(StringView(value, 5));
+	if (name == "<html") {
+		return Template::TagHtml;
+	} else if (name == "<head") {
+		return Template::TagHead;
+	} else if (name == "<body") {
+		return Template::TagBody;
+	}
+	return Template::None;
+}
 
+void Template::compileChunk(const Chunk &chunk) {
+	size_t textPos = maxOf<size_t>() - 1;
 	auto it = chunk.chunks.begin();
 	while (it != chunk.chunks.end()) {
 		auto &c = **it;
 		switch (c.type) {
 		case HtmlTag:
 			if (StringView(c.value).starts_with("</")) {
-				while (!tagStack.tagStack.empty() && tagStack.tagStack.back()->type == VirtualTag) {
-					auto name = string::tolower(StringView(tagStack.tagStack.back()->value, 5));
-					out << tagStack.tagStack.back()->value;
-					if (name == "</body") {
-						tagStack.withinBody = false;
-					}
-					tagStack.tagStack.pop_back();
-				}
-				if (tagStack.tagStack.empty()) {
-					return false;
-				}
-				auto name = string::tolower(StringView(tagStack.tagStack.back()->value, 5));
-				if (name == "<head") {
-					tagStack.withinHead = false;
-				} else if (name == "<body") {
-					tagStack.withinBody = false;
-				}
-				out << c.value;
-				tagStack.tagStack.pop_back();
-				if (tagStack.opts.hasFlag(Options::LineFeeds) && !tagStack.tagStack.empty()) {
-					out << "\n";
-				}
+				_program.emplace_back(Op{OpCode::TagClose, None, 0, c.value});
 			} else if (!StringView(c.value).ends_with("/>")) {
-				if (tagStack.opts.hasFlag(Options::LineFeeds) && !tagStack.tagStack.empty()) {
-					out << "\n";
-				}
-				if (tagStack.tagStack.empty() && string::tolower(StringView(c.value, 5)) != "<html") {
-					out << "<html>";
-					tagStack.tagStack.push_back(new Template::Chunk{VirtualTag, String("</html>"), nullptr});
-				}
-				if (string::tolower(StringView(c.value, 5)) == "<head") {
-					tagStack.withinHead = true;
-				} else if (!tagStack.withinHead) {
-					if (string::tolower(StringView(c.value, 5)) == "<body") {
-						tagStack.withinBody = true;
-					} else if (!tagStack.withinBody) {
-						out << "<body>";
-						tagStack.tagStack.push_back(new Template::Chunk{VirtualTag, String("</body>"), nullptr});
-						tagStack.withinBody = true;
-					}
-				}
-				tagStack.tagStack.push_back(&c);
-				out << c.value;
+				_program.emplace_back(Op{OpCode::TagOpen, Template_getTagFlags(c.value), 0, c.value});
 			} else {
-				if (tagStack.opts.hasFlag(Options::LineFeeds) && !tagStack.tagStack.empty()) {
-					out << "\n";
-				}
-				out << c.value;
+				_program.emplace_back(Op{OpCode::TagSelfClosed, None, 0, c.value});
 			}
 			++ it;
 			break;
 		case HtmlInlineTag:
-
-			if (tagStack.tagStack.empty() && string::tolower(StringView(c.value, 5)) != "<html") {
-				out << "<html>";
-				tagStack.tagStack.push_back(new Template::Chunk{VirtualTag, String("</html>"), nullptr});
-			}
-			if (string::tolower(StringView(c.value, 5)) != "<head" && !tagStack.withinHead) {
-				if (string::tolower(StringView(c.value, 5)) != "<body" && !tagStack.withinBody) {
-					out << "<body>";
-					tagStack.tagStack.push_back(new Template::Chunk{VirtualTag, String("</body>"), nullptr});
-					tagStack.withinBody = true;
-				}
-			}
-
-			if (tagStack.opts.hasFlag(Options::LineFeeds) && !tagStack.tagStack.empty()) {
-				out << "\n";
-			}
-			out << c.value;
+			_program.emplace_back(Op{OpCode::TagInline, Template_getTagFlags(c.value), 0, c.value});
 			++ it;
 			break;
 		case HtmlEntity:
-			out << c.value;
+			if (textPos + 1 == _program.size()) {
+				// merge static runs, that was split by chunk boundaries
+				auto &back = _program.back();
+				auto buf = (char *)memory::pool::palloc(_pool, back.value.size() + c.value.size());
+				memcpy(buf, back.value.data(), back.value.size());
+				memcpy(buf + back.value.size(), c.value.data(), c.value.size());
+				back.value = StringView(buf, back.value.size() + c.value.size());
+			} else {
+				_program.emplace_back(Op{OpCode::Text, None, 0, c.value});
+				textPos = _program.size() - 1;
+			}
 			++ it;
 			break;
 		case OutputEscaped:
 		case OutputUnescaped:
-			if (!exec.print(*c.expr, out, c.type == OutputEscaped) && _opts.hasFlag(Options::StopOnError)) {
-				return false;
-			}
+			_program.emplace_back(Op{OpCode::Output, (c.type == OutputEscaped) ? Escaped : None, 0, StringView(), StringView(), c.expr});
 			++ it;
 			break;
 		case AttributeEscaped:
 		case AttributeUnescaped:
-			if (!exec.printAttr(c.value, *c.expr, out, c.type == AttributeEscaped) && _opts.hasFlag(Options::StopOnError)) {
-				return false;
-			}
+			_program.emplace_back(Op{OpCode::Attribute, (c.type == AttributeEscaped) ? Escaped : None, 0, c.value, StringView(), c.expr});
 			++ it;
 			break;
 		case AttributeList:
-			if (!exec.printAttrExprList(*c.expr, out) && _opts.hasFlag(Options::StopOnError)) {
-				return false;
-			}
+			_program.emplace_back(Op{OpCode::AttributeList, None, 0, StringView(), StringView(), c.expr});
+			++ it;
+			break;
+		case Code:
+			// nested chunks of code line are never executed
+			_program.emplace_back(Op{OpCode::Code, None, 0, StringView(), StringView(), c.expr});
 			++ it;
 			break;
 		case Block:
+			compileBody(c, OpCode::Block);
+			++ it;
+			break;
 		case ControlWhen:
-		case ControlDefault:
-			runChunk(c, exec, out, tagStack);
+			compileBody(c, OpCode::When);
 			++ it;
 			break;
-		case Code:
-			if (!exec.exec(*c.expr, out) && _opts.hasFlag(Options::StopOnError)) {
-				return false;
-			}
+		case ControlDefault:
+			compileBody(c, OpCode::Default);
 			++ it;
 			break;
 		case ControlCase:
-			if (!runCase(c, exec, out, tagStack) && _opts.hasFlag(Options::StopOnError)) {
-				return false;
-			}
+			compileBody(c, OpCode::Case);
 			++ it;
 			break;
 		case ControlIf:
-			if (!runIf(it) && _opts.hasFlag(Options::StopOnError)) {
-				return false;
+		case ControlUnless: {
+			// compile whole if-elseif-else chain into single op, drop orphaned branches like runtime did
+			bool allowElseIf = c.type == ControlIf;
+			auto pos = _program.size();
+			_program.emplace_back(Op{OpCode::If, allowElseIf ? None : Unless});
+
+			compileBody(c, OpCode::Branch);
+			++ it;
+
+			if (allowElseIf) {
+				while (it != chunk.chunks.end() && (*it)->type == ControlElseIf) {
+					compileBody(**it, OpCode::Branch);
+					++ it;
+				}
 			}
-			break;
-		case ControlUnless:
-			if (!runIf(it) && _opts.hasFlag(Options::StopOnError)) {
-				return false;
+
+			if (it != chunk.chunks.end() && (*it)->type == ControlElse) {
+				compileBody(**it, OpCode::Else);
+				++ it;
+			}
+
+			while (it != chunk.chunks.end() && ((*it)->type == ControlElse || (allowElseIf && (*it)->type == ControlElseIf))) {
+				++ it;
 			}
+
+			_program[pos].size = _program.size() - pos - 1;
 			break;
+		}
 		case ControlEach:
-			if (!runEach(it) && _opts.hasFlag(Options::StopOnError)) {
-				return false;
+		case ControlEachPair: {
+			auto next = it + 1;
+			uint8_t flags = (next != chunk.chunks.end() && (*next)->type == ControlElse) ? HasElse : None;
+			if (c.type == ControlEach) {
+				compileBody(c, OpCode::Each, flags, c.value);
+			} else {
+				StringView r(c.value);
+				auto first = r.readUntil<StringView::Chars<' '>>();
+				r.skipChars<StringView::Chars<' '>>();
+				compileBody(c, OpCode::EachPair, flags, first, r.readUntil<StringView::Chars<' '>>());
 			}
-			break;
-		case ControlEachPair:
-			if (!runEachPair(it) && _opts.hasFlag(Options::StopOnError)) {
-				return false;
+			++ it;
+			if (flags & HasElse) {
+				compileBody(**it, OpCode::Else);
+				++ it;
 			}
 			break;
+		}
 		case ControlWhile:
-			if (!runWhile(**it) && _opts.hasFlag(Options::StopOnError)) {
-				return false;
-			}
+			compileBody(c, OpCode::While);
 			++ it;
 			break;
 		case Include:
-			if (_opts.hasFlag(Options::Pretty)) {
-				memory::ostringstream stream;
-				if (!exec.runInclude((*it)->value, stream, this) && _opts.hasFlag(Options::StopOnError)) {
-					return false;
-				}
-				pushWithPrettyFilter(stream, (*it)->indent, out);
-			} else {
-				if (!exec.runInclude((*it)->value, out, this) && _opts.hasFlag(Options::StopOnError)) {
-					return false;
-				}
-			}
+			_program.emplace_back(Op{OpCode::Include, None, 0, c.value});
+			_program.back().indent = c.indent;
 			++ it;
 			break;
 		case ControlMixin:
-			++ it;
 			if (c.expr->op == Expression::Call && c.expr->left->isToken) {
-				if (!exec.setMixin(c.expr->left->value.getString(), &c)) {
-					onError(toString("Invalid mixin declaration: ", c.expr->left->value.getString()));
-				}
+				compileBody(c, OpCode::Mixin, None, c.expr->left->value.getString());
 			} else if (c.expr->op == Expression::NoOp && c.expr->isToken) {
-				if (!exec.setMixin(c.expr->value.getString(), &c)) {
-					onError(toString("Invalid mixin declaration: ", c.expr->value.getString()));
-				}
+				compileBody(c, OpCode::Mixin, None, c.expr->value.getString());
 			}
+			++ it;
 			break;
-		case MixinCall:
-			if (!runMixinChunk(c)) {
-				return false;
-			}
+		case MixinCall: {
+			Vector<Expression *> vars;
+			Template_readMixinArgs(vars, c.expr);
+
+			auto args = (Expression **)memory::pool::palloc(_pool, std::max(vars.size(), size_t(1)) * sizeof(Expression *));
+			memcpy(args, vars.data(), vars.size() * sizeof(Expression *));
+
+			_program.emplace_back(Op{OpCode::MixinCall, None, 0, c.value});
+			_program.back().args = SpanView<Expression *>(args, vars.size());
 			++ it;
 			break;
+		}
 		case ControlElseIf:
+			compileBody(c, OpCode::Branch);
+			++ it;
+			break;
 		case ControlElse:
+			compileBody(c, OpCode::Else);
+			++ it;
+			break;
 		case VirtualTag:
-			// should not be in this context
-			return false;
+			++ it;
 			break;
 		}
 	}
-
-	return true;
 }
 
-bool Template::runCase(const Chunk &chunk, Context &exec, std::ostream &out, RunContext &tagStack) const {
-	auto runWhenChunk = [&] (auto it) -> bool {
-		if ((*it)->chunks.size() > 0) {
-			return runChunk(**it, exec, out, tagStack);
-		} else {
-			++ it;
-			while (it != chunk.chunks.end() && (*it)->type == Template::ControlWhen) {
-				if ((*it)->chunks.size() > 0) {
-					return runChunk(**it, exec, out, tagStack);
-				}
-			}
-		}
-		return false;
-	};
-
-	auto perform = [&] () -> bool {
-		if (auto var = exec.exec(*chunk.expr, out)) {
-			if (auto val = var.readValue()) {
-				const Template::Chunk *def = nullptr;
-				auto it = chunk.chunks.begin();
-				while (it != chunk.chunks.end()) {
-					switch ((*it)->type) {
-					case Template::ControlWhen:
-						if (auto v = exec.exec(*(*it)->expr, out)) {
-							auto &v2 = v.readValue();
-							if (val == v2) {
-								return runWhenChunk(it);
-							}
-						} else {
-							return false;
-						}
-						break;
-					case Template::ControlDefault: def = *it; break;
-					default: break;
-					}
-					++ it;
-				}
-				if (def) {
-					return runChunk(*def, exec, out, tagStack);
-				} else {
-					return true;
-				}
-			}
-		}
-		return false;
-	};
-
-	Context::VarScope scope;
-	exec.pushVarScope(scope);
-	auto ret = perform();
-	exec.popVarScope();
-	return ret;
-}
-
-void Template::pushWithPrettyFilter(memory::ostringstream &str, size_t indent, std::ostream &out) const {
-	StringView r(str.weak());
-	out << '\n';
-	while (!r.empty()) {
-		for (size_t i = 0; i < indent; ++ i) {
-			out << '\t';
-		}
-		out << r.readUntil<StringView::Chars<'\r', '\n'>>();
-		out << r.readChars<StringView::Chars<'\r'>>();
-		if (r.is('\n')) {
-			out << '\n';
-			++ r;
-		}
-	}
+void Template::compileBody(const Chunk &chunk, OpCode code, uint8_t flags, StringView value, StringView extra) {
+	auto pos = _program.size();
+	_program.emplace_back(Op{code, flags, 0, value, extra, chunk.expr});
+	compileChunk(chunk);
+	_program[pos].size = _program.size() - pos - 1;
 }
 
 NS_SP_EXT_END(pug)
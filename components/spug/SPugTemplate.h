@@ -24,6 +24,7 @@
 #define SPUG_SPUGTEMPLATE_H_
 
 #include "SPugLexer.h"
+#include "SPSpanView.h"
 
 NS_SP_EXT_BEGIN(pug)
 
@@ -72,6 +73,58 @@ public:
 		Vector<Chunk *> chunks;
 	};
 
+	enum class OpCode : uint8_t {
+		Text, // static text run, escaped and merged at read time
+		TagOpen,
+		TagClose,
+		TagSelfClosed,
+		TagInline,
+		Output,
+		Attribute,
+		AttributeList,
+		Code,
+		Block,
+		Case,
+		When,
+		Default,
+		If, // if/unless chain, branches are placed within body
+		Branch,
+		Else,
+		Each,
+		EachPair,
+		While,
+		Include,
+		Mixin,
+		MixinCall,
+	};
+
+	enum OpFlags : uint8_t {
+		None = 0,
+		Escaped = 1 << 0,
+		Unless = 1 << 1,
+		HasElse = 1 << 2,
+		TagHtml = 1 << 3,
+		TagHead = 1 << 4,
+		TagBody = 1 << 5,
+		TagVirtual = 1 << 6,
+	};
+
+	// Flat program, compiled from chunk tree. Control ops followed by its body, `size` is
+	// the number of ops within body, so every subrange can be executed on its own
+	struct Op {
+		OpCode code = OpCode::Text;
+		uint8_t flags = 0;
+		uint32_t size = 0;
+		StringView value;
+		StringView extra;
+		Expression *expr = nullptr;
+		SpanView<Expression *> args;
+		size_t indent = 0;
+
+		const Op *begin() const { return this + 1; }
+		const Op *end() const { return this + 1 + size; }
+	};
+
 	struct Options {
 		enum Flags {
 			Pretty,
@@ -103,20 +156,13 @@ public:
 
 	void describe(std::ostream &stream, bool tokens = false) const;
 
-protected:
-	struct RunContext {
-		Vector<Template::Chunk *> tagStack;
-		bool withinHead = false;
-		bool withinBody = false;
-		Options opts;
-	};
+	SpanView<Op> getProgram() const { return _program; }
 
+protected:
 	Template(memory::pool_t *, const StringView &, const Options &opts, const Callback<void(const StringView &)> &err);
 
-	bool runChunk(const Chunk &chunk, Context &, std::ostream &, RunContext &) const;
-	bool runCase(const Chunk &chunk, Context &, std::ostream &, RunContext &) const;
-
-	void pushWithPrettyFilter(memory::ostringstream &, size_t indent, std::ostream &) const;
+	void compileChunk(const Chunk &chunk);
+	void compileBody(const Chunk &chunk, OpCode, uint8_t flags = 0, StringView value = StringView(), StringView extra = StringView());
 
 	memory::pool_t *_pool;
 	Lexer _lexer;
@@ -124,6 +170,8 @@ protected:
 	Chunk _root;
 	Options _opts;
 
+	Vector<Op> _program;
+
 	Vector<StringView> _includes;
 };
 
@@ -27,6 +27,7 @@ THE SOFTWARE.
 #include "STServer.cc"
 #include "STRoot.cc"
 #include "STRootWorker.cc"
+#include "STRootWorkerUring.cc"
 
 #include "STInputFilter.cc"
 #include "STRequest.cc"
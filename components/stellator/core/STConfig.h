@@ -120,6 +120,7 @@ constexpr auto getUploadTmpFilePrefix() { return "sa.upload"; }
 
 // Prefix for temporary file, used to store data for uploaded image rescaling
 constexpr auto getUploadTmpImagePrefix() { return "sa.image"; }
+constexpr auto getImageVariantsMaxAttempts() { return 3; }
 
 // Absolute maximum for storage subobject resolution system
 // No resolution will be performed if this depth is reach
@@ -41,6 +41,7 @@ THE SOFTWARE.
 #include "STStorageScheme.cc"
 
 #include "STSqlDriver.cc"
+#include "STSqlDriverPool.cc"
 #include "STSqlHandle.cc"
 #include "STSqlHandleObject.cc"
 #include "STSqlHandleProp.cc"
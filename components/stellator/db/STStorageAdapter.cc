@@ -314,6 +314,14 @@ TransactionStatus Adapter::getTransactionStatus() const {
 	return _interface->getTransactionStatus();
 }
 
+bool Adapter::beginBatch() const {
+	return _interface->beginBatch();
+}
+
+bool Adapter::endBatch() const {
+	return _interface->endBatch();
+}
+
 void Adapter::runAutoFields(const Transaction &t, const mem::Vector<uint64_t> &vec, const Scheme &scheme, const Field &field) {
 	auto &defs = field.getSlot()->autoField;
 	if (defs.defaultFn) {
@@ -103,6 +103,9 @@ protected:
 	bool isInTransaction() const;
 	TransactionStatus getTransactionStatus() const;
 
+	bool beginBatch() const;
+	bool endBatch() const;
+
 	void runAutoFields(const Transaction &t, const mem::Vector<uint64_t> &vec, const Scheme &, const Field &);
 
 protected:
@@ -136,11 +136,14 @@ constexpr auto getTransactionStackKey() { return "ST.Transaction.Stack"; }
 
 constexpr auto getUploadTmpFilePrefix() { return "sa.upload"; }
 constexpr auto getUploadTmpImagePrefix() { return "sa.image"; }
+constexpr auto getImageVariantsMaxAttempts() { return 3; }
 
 constexpr auto getStorageBroadcastChannelName() { return "serenity_broadcast"; }
 
 constexpr uint16_t getResourceResolverMaxDepth() { return 4; }
 
+constexpr int getMaxDatabaseConnections() { return 1024; }
+
 }
 
 void setStorageRoot(StorageRoot *);
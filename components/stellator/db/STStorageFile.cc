@@ -206,8 +206,7 @@ mem::Value File::createFile(const Transaction &t, const Field &f, InputFile &fil
 	return Value();
 }
 
-mem::Value File::createFile(const Transaction &t, const mem::StringView &type, const mem::StringView &path, int64_t mtime) {
-	auto scheme = internals::getFileScheme();
+static mem::Value File_getFileData(const mem::StringView &type, const mem::StringView &path, int64_t mtime) {
 	auto size = stappler::filesystem::size(path);
 
 	mem::Value fileData;
@@ -232,8 +231,12 @@ mem::Value File::createFile(const Transaction &t, const mem::StringView &type, c
 			fileData.setString(type, "type");
 		}
 	}
+	return fileData;
+}
 
-	fileData = Worker(*scheme, t).create(fileData, true);
+mem::Value File::createFile(const Transaction &t, const mem::StringView &type, const mem::StringView &path, int64_t mtime) {
+	auto scheme = internals::getFileScheme();
+	auto fileData = Worker(*scheme, t).create(File_getFileData(type, path, mtime), true);
 	if (fileData && fileData.isInteger("__oid")) {
 		auto id = fileData.getInteger("__oid");
 		if (stappler::filesystem::move(path, File::getFilesystemPath(id))) {
@@ -312,35 +315,21 @@ static bool getTargetImageSize(size_t W, size_t H, const MinImageSize &min, cons
 	return false;
 }
 
-static mem::String saveImage(stappler::Bitmap &bmp) {
+// image is decoded, resampled and encoded into file line by line, so, neither source nor result is resident in memory
+static mem::String resizeImage(const stappler::io::Producer &source, size_t width, size_t height) {
 	file_t file = file_t::open_tmp(config::getUploadTmpImagePrefix(), false);
-	mem::String path(file.path());
-	file.close();
-
-	if (!path.empty()) {
-		bool ret = false;
-		auto fmt = bmp.getOriginalFormat();
-		if (fmt == stappler::Bitmap::FileFormat::Custom) {
-			ret = bmp.save(bmp.getOriginalFormatName(), path);
-		} else {
-			ret = bmp.save(bmp.getOriginalFormat(), path);
-		}
-
-		if (ret) {
-			return mem::String(path);
-		}
+	if (!file) {
+		return mem::String();
 	}
 
-    return mem::String();
-}
-
-static mem::String resizeImage(stappler::Bitmap &bmp, size_t width, size_t height) {
-	auto newImage = bmp.resample(width, height);
-    if (newImage) {
-    	return saveImage(newImage);
-    }
+	mem::String path(file.path());
+	if (!stappler::Bitmap::resample(source, file, width, height)) {
+		file.close_remove();
+		return mem::String();
+	}
 
-    return mem::String();
+	file.close();
+	return path;
 }
 
 static mem::Map<mem::String, mem::String> writeImages(const Field &f, InputFile &file) {
@@ -354,38 +343,15 @@ static mem::Map<mem::String, mem::String> writeImages(const Field &f, InputFile
 
 	mem::Map<mem::String, mem::String> ret;
 
+	// thumbnails are generated later, see File::scheduleImageVariants
 	bool needResize = getTargetImageSize(width, height, field->minImageSize, field->maxImageSize, targetWidth, targetHeight);
-	if (needResize || field->thumbnails.size() > 0) {
-		stappler::Buffer data(file.writeSize);
-		stappler::io::Producer prod(file.file);
-		prod.seek(0, stappler::io::Seek::Set);
-		prod.read(data, file.writeSize);
-
-		stappler::Bitmap bmp(data.data(), data.size());
-	    if (!bmp) {
-	    	messages::error("Storage", "Fail to open image");
-	    } else {
-		    if (needResize) {
-		    	auto fpath = resizeImage(bmp, targetWidth, targetHeight);
-		    	if (!fpath.empty()) {
-		    		ret.emplace(f.getName().str<mem::Interface>(), std::move(fpath));
-		    	}
-		    } else {
-		    	ret.emplace(f.getName().str<mem::Interface>(), file.file.path());
-		    }
-
-		    if (field->thumbnails.size() > 0) {
-		    	for (auto &it : field->thumbnails) {
-			    	getTargetImageSize(width, height, MinImageSize(), MaxImageSize(it.width, it.height),
-			    			targetWidth, targetHeight);
-
-			    	auto fpath = resizeImage(bmp, targetWidth, targetHeight);
-			    	if (!fpath.empty()) {
-			    		ret.emplace(it.name, std::move(fpath));
-			    	}
-		    	}
-		    }
-	    }
+	if (needResize) {
+		auto fpath = resizeImage(file.file, targetWidth, targetHeight);
+		if (fpath.empty()) {
+			messages::error("Storage", "Fail to resize image");
+		} else {
+			ret.emplace(f.getName().str<mem::Interface>(), std::move(fpath));
+		}
 	} else {
 		ret.emplace(f.getName().str<mem::Interface>(), file.path);
 	}
@@ -405,36 +371,15 @@ static mem::Map<mem::String, mem::String> writeImages(const Field &f, const mem:
 
 	mem::Map<mem::String, mem::String> ret;
 
+	// thumbnails are generated later, see File::scheduleImageVariants
 	bool needResize = getTargetImageSize(width, height, field->minImageSize, field->maxImageSize, targetWidth, targetHeight);
-	if (needResize || field->thumbnails.size() > 0) {
-		stappler::Bitmap bmp(data);
-	    if (!bmp) {
-	    	messages::error("Storage", "Fail to open image");
-	    } else {
-		    if (needResize) {
-		    	auto fpath = resizeImage(bmp, targetWidth, targetHeight);
-		    	if (!fpath.empty()) {
-		    		ret.emplace(f.getName().str<mem::Interface>(), std::move(fpath));
-		    	}
-		    } else {
-		    	auto fpath = saveImage(bmp);
-		    	if (!fpath.empty()) {
-		    		ret.emplace(f.getName().str<mem::Interface>(), std::move(fpath));
-		    	}
-		    }
-
-		    if (field->thumbnails.size() > 0) {
-		    	for (auto &it : field->thumbnails) {
-			    	getTargetImageSize(width, height, MinImageSize(), MaxImageSize(it.width, it.height),
-			    			targetWidth, targetHeight);
-
-			    	auto fpath = resizeImage(bmp, targetWidth, targetHeight);
-			    	if (!fpath.empty()) {
-			    		ret.emplace(it.name, std::move(fpath));
-			    	}
-		    	}
-		    }
-	    }
+	if (needResize) {
+		auto fpath = resizeImage(source, targetWidth, targetHeight);
+		if (fpath.empty()) {
+			messages::error("Storage", "Fail to resize image");
+		} else {
+			ret.emplace(f.getName().str<mem::Interface>(), std::move(fpath));
+		}
 	} else {
 		file_t file = file_t::open_tmp(config::getUploadTmpImagePrefix(), false);
 		file.xsputn((const char *)data.data(), data.size());
@@ -445,6 +390,135 @@ static mem::Map<mem::String, mem::String> writeImages(const Field &f, const mem:
 	return ret;
 }
 
+// file objects for thumbnails are created within request, so, their ids are returned to client with primary image
+// and replace ids of stale thumbnails of previous image; content is written later, see File::scheduleImageVariants
+static void File_reserveImageVariants(const Transaction &t, const Field &f, const mem::StringView &type, mem::Value &ret) {
+	auto field = static_cast<const FieldImage *>(f.getSlot());
+	if (!field->primary || !ret.isInteger(f.getName())) {
+		return;
+	}
+
+	auto scheme = internals::getFileScheme();
+	for (auto &it : field->thumbnails) {
+		mem::Value fileData;
+		fileData.setString(type, "type");
+		fileData.setInteger(0, "size");
+
+		fileData = Worker(*scheme, t).create(fileData, true);
+		if (fileData && fileData.isInteger("__oid")) {
+			ret.setInteger(fileData.getInteger("__oid"), it.name);
+		}
+	}
+}
+
+struct File_VariantData {
+	uint64_t oid = 0;
+	int64_t fileId = 0;
+	const Field *variant = nullptr;
+	int64_t variantId = 0;
+};
+
+static void File_scheduleImageVariants(const Scheme &scheme, const Field &field,
+		const mem::Vector<File_VariantData> &variants, uint32_t attempt);
+
+// write reserved thumbnails of single object from stored primary image; every thumbnail is streamed from file,
+// so, decoder can use cheap downscaling (JPEG DCT scaling) for small sizes
+static void File_writeImageVariants(const Transaction &t, const Scheme &scheme, const Field &f,
+		const File_VariantData *begin, const File_VariantData *end, mem::Vector<File_VariantData> &failed) {
+	mem::Vector<const Field *> fields{ &f };
+	for (auto it = begin; it != end; ++ it) {
+		fields.emplace_back(it->variant);
+	}
+
+	// object can be not visible yet, if task was started before request's transaction was committed
+	auto obj = Worker(scheme, t).asSystem().get(begin->oid, fields);
+	if (!obj) {
+		failed.insert(failed.end(), begin, end);
+		return;
+	}
+
+	// object was updated with another image since task was scheduled, reserved thumbnails was dropped with update
+	if (obj.getInteger(f.getName()) != begin->fileId) {
+		return;
+	}
+
+	auto file = stappler::filesystem::openForReading(File::getFilesystemPath(begin->fileId));
+
+	size_t width = 0, height = 0;
+	if (!file || !stappler::Bitmap::getImageSize(file, width, height)) {
+		messages::error("Storage", "Fail to open image", mem::Value({ std::make_pair("file", mem::Value(begin->fileId)) }));
+		failed.insert(failed.end(), begin, end);
+		return;
+	}
+
+	auto fileScheme = internals::getFileScheme();
+	auto type = File::getData(t, begin->fileId).getString("type");
+	for (auto it = begin; it != end; ++ it) {
+		if (obj.getInteger(it->variant->getName()) != it->variantId) {
+			continue;
+		}
+
+		auto slot = static_cast<const FieldImage *>(it->variant->getSlot());
+		size_t targetWidth, targetHeight;
+		getTargetImageSize(width, height, MinImageSize(), slot->maxImageSize, targetWidth, targetHeight);
+
+		auto fpath = resizeImage(file, targetWidth, targetHeight);
+		if (!fpath.empty()) {
+			auto fileData = File_getFileData(type, fpath, 0);
+			if (stappler::filesystem::move(fpath, File::getFilesystemPath(it->variantId))) {
+				fileScheme->update(t, it->variantId, fileData, UpdateFlags::Protected | UpdateFlags::NoReturn);
+				continue;
+			}
+			stappler::filesystem::remove(fpath);
+		}
+
+		messages::error("Storage", "Fail to resize image", mem::Value({ std::make_pair("file", mem::Value(begin->fileId)) }));
+		failed.emplace_back(*it);
+	}
+}
+
+static void File_performImageVariants(const Transaction &t, const Scheme &scheme, const Field &field,
+		const mem::Vector<File_VariantData> &variants, uint32_t attempt) {
+	mem::Vector<File_VariantData> failed;
+	auto it = variants.begin();
+	while (it != variants.end()) {
+		auto end = std::find_if(it, variants.end(), [&] (const File_VariantData &d) { return d.oid != it->oid; });
+		File_writeImageVariants(t, scheme, field, &(*it), &(*it) + (end - it), failed);
+		it = end;
+	}
+
+	if (failed.empty()) {
+		return;
+	}
+
+	if (attempt + 1 < uint32_t(config::getImageVariantsMaxAttempts())) {
+		File_scheduleImageVariants(scheme, field, failed, attempt + 1);
+		return;
+	}
+
+	// out of attempts: drop placeholders, so, client can fall back to primary image
+	for (auto &it : failed) {
+		auto obj = Worker(scheme, t).asSystem().get(it.oid, { it.variant });
+		if (obj && obj.getInteger(it.variant->getName()) == it.variantId) {
+			mem::Value patch;
+			patch.setValue(mem::Value(), it.variant->getName());
+			scheme.update(t, it.oid, patch, UpdateFlags::Protected | UpdateFlags::NoReturn);
+		}
+	}
+}
+
+static void File_scheduleImageVariants(const Scheme &scheme, const Field &field,
+		const mem::Vector<File_VariantData> &variants, uint32_t attempt) {
+	internals::scheduleAyncDbTask([&] (stappler::memory::pool_t *p) -> mem::Function<void(const Transaction &t)> {
+		auto vec = new (p) mem::Vector<File_VariantData>(p);
+		vec->assign(variants.begin(), variants.end());
+
+		return [vec, scheme = &scheme, field = &field, attempt] (const Transaction &t) {
+			File_performImageVariants(t, *scheme, *field, *vec, attempt);
+		};
+	});
+}
+
 mem::Value File::createImage(const Transaction &t, const Field &f, InputFile &file) {
 	mem::Value ret;
 
@@ -465,6 +539,7 @@ mem::Value File::createImage(const Transaction &t, const Field &f, InputFile &fi
 			}
 		}
 	}
+	File_reserveImageVariants(t, f, file.type, ret);
 	return ret;
 }
 
@@ -481,9 +556,51 @@ mem::Value File::createImage(const Transaction &t, const Field &f, const mem::St
 			ret.setValue(std::move(val), field);
 		}
 	}
+	File_reserveImageVariants(t, f, type, ret);
 	return ret;
 }
 
+void File::scheduleImageVariants(const Scheme &scheme, const Field &field, uint64_t oid, const mem::Value &obj) {
+	struct File_VariantsTask : AllocPool {
+		const Scheme *scheme = nullptr;
+		const Field *field = nullptr;
+		mem::Map<uint64_t, mem::Vector<File_VariantData>> objects;
+	};
+
+	auto slot = static_cast<const FieldImage *>(field.getSlot());
+	auto fileId = obj.getInteger(field.getName());
+	if (!oid || !fileId || !slot->primary || slot->thumbnails.empty()) {
+		return;
+	}
+
+	// all uploads within request are processed with single task, last upload for object wins
+	stappler::memory::pool_t * p = stappler::memory::pool::acquire();
+	auto key = mem::toString(scheme.getName(), "_v_", field.getName());
+	auto d = stappler::memory::pool::get<File_VariantsTask>(p, key);
+	if (!d) {
+		d = new (p) File_VariantsTask;
+		d->scheme = &scheme;
+		d->field = &field;
+		stappler::memory::pool::store(p, d, key, [d] {
+			mem::Vector<File_VariantData> vec;
+			for (auto &it : d->objects) {
+				vec.insert(vec.end(), it.second.begin(), it.second.end());
+			}
+			File_scheduleImageVariants(*d->scheme, *d->field, vec, 0);
+		});
+	}
+
+	auto &vec = d->objects[oid];
+	vec.clear();
+	for (auto &it : slot->thumbnails) {
+		auto variant = scheme.getField(it.name);
+		auto variantId = obj.getInteger(it.name);
+		if (variant && variantId) {
+			vec.emplace_back(File_VariantData{oid, fileId, variant, variantId});
+		}
+	}
+}
+
 bool File::removeFile(const mem::Value &val) {
 	int64_t id = 0;
 	if (val.isInteger()) {
@@ -41,6 +41,10 @@ public:
 	static mem::Value createImage(const Transaction &, const Field &, InputFile &);
 	static mem::Value createImage(const Transaction &, const Field &, const mem::StringView &type, const mem::BytesView &data, int64_t = 0);
 
+	// thumbnails for primary image field are written asynchronously, after request is complete, into file objects,
+	// reserved by createImage; failed thumbnails are retried, then dropped from object
+	static void scheduleImageVariants(const Scheme &, const Field &, uint64_t oid, const mem::Value &obj);
+
 	static mem::Value getData(const Transaction &, uint64_t id);
 	static void setData(const Transaction &, uint64_t id, const mem::Value &);
 
@@ -138,6 +138,13 @@ public: // others
 	virtual bool beginTransaction() = 0;
 	virtual bool endTransaction() = 0;
 
+	// start batch of write operations: queries, which results are not required immediately,
+	// can be deferred and sent to server together; batches can be nested, queue is flushed with outermost endBatch
+	virtual bool beginBatch() { return true; }
+
+	// flush deferred queries, returns false if any of them failed (transaction is cancelled in this case)
+	virtual bool endBatch() { return true; }
+
 	// try to authorize user with name and password, using fields and scheme from Auth object
 	// authorization is protected with internal '__login" scheme to prevent bruteforce attacks
 	virtual User * authorizeUser(const Auth &, const mem::StringView &name, const mem::StringView &password) = 0;
@@ -455,6 +455,13 @@ mem::Value Scheme::createWithWorker(Worker &w, const mem::Value &data, bool isPr
 			for (auto &it : views) {
 				updateView(t, ret, it, mem::Vector<uint64_t>());
 			}
+			if (ret.isArray()) {
+				for (auto &it : ret.asArray()) {
+					scheduleFileVariants(it.getInteger("__oid"), it);
+				}
+			} else {
+				scheduleFileVariants(ret.getInteger("__oid"), patch);
+			}
 			retVal = std::move(ret);
 			return true;
 		} else {
@@ -495,6 +502,7 @@ mem::Value Scheme::updateWithWorker(Worker &w, uint64_t oid, const mem::Value &d
 			messages::error("Storage", "Fail to update object for id", mem::Value({ std::make_pair("oid", mem::Value((int64_t)oid)) }));
 			return false;
 		}
+		scheduleFileVariants(oid, filePatch);
 		return true;
 	});
 
@@ -532,6 +540,7 @@ mem::Value Scheme::updateWithWorker(Worker &w, const mem::Value & obj, const mem
 			messages::error("Storage", "No object for id to update", mem::Value({ std::make_pair("oid", mem::Value((int64_t)oid)) }));
 			return false;
 		}
+		scheduleFileVariants(oid, filePatch);
 		return true;
 	});
 
@@ -809,8 +818,21 @@ mem::Value Scheme::setFileWithWorker(Worker &w, uint64_t oid, const Field &f, In
 			patch.setValue(std::move(d));
 		}
 		if (patchOrUpdate(w, oid, patch)) {
+			scheduleFileVariants(oid, patch);
 			// resolve files
 			ret = File::getData(t, patch.getInteger(f.getName()));
+			if (f.getType() == Type::Image) {
+				// thumbnails are not written yet, but ids of reserved files are already known
+				mem::Value thumbnails;
+				for (auto &it : static_cast<const FieldImage *>(f.getSlot())->thumbnails) {
+					if (patch.isInteger(it.name)) {
+						thumbnails.setInteger(patch.getInteger(it.name), it.name);
+					}
+				}
+				if (!thumbnails.empty()) {
+					ret.setValue(std::move(thumbnails), "thumbnails");
+				}
+			}
 			return true;
 		} else {
 			purgeFilePatch(t, patch);
@@ -1312,6 +1334,19 @@ void Scheme::purgeFilePatch(const Transaction &t, const mem::Value &patch) const
 	}
 }
 
+void Scheme::scheduleFileVariants(uint64_t oid, const mem::Value &patch) const {
+	if (!patch.isDictionary()) {
+		return;
+	}
+
+	for (auto &it : patch.asDict()) {
+		auto f = getField(it.first);
+		if (f && f->getType() == Type::Image && it.second.isInteger()) {
+			File::scheduleImageVariants(*this, *f, oid, patch);
+		}
+	}
+}
+
 void Scheme::initScheme() {
 	// init non-linked object fields as StrongReferences
 	for (auto &it : fields) {
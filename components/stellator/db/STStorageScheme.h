@@ -236,6 +236,7 @@ protected:
 
 	mem::Value createFilePatch(const Transaction &, const mem::Value &val, mem::Value &changeSet) const;
 	void purgeFilePatch(const Transaction &t, const mem::Value &) const;
+	void scheduleFileVariants(uint64_t oid, const mem::Value &) const;
 	void mergeValues(const Field &f, const mem::Value &obj, mem::Value &original, mem::Value &newVal) const;
 
 	stappler::Pair<bool, mem::Value> prepareUpdate(const mem::Value &data, bool isProtected) const;
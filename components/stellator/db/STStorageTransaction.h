@@ -123,6 +123,9 @@ public: // adapter interface
 	bool perform(const mem::Callback<bool()> & cb) const;
 	bool performAsSystem(const mem::Callback<bool()> & cb) const;
 
+	// perform in transaction, write queries without required results are sent to storage in batches
+	bool performBatch(const mem::Callback<bool()> & cb) const;
+
 	bool isInTransaction() const;
 	TransactionStatus getTransactionStatus() const;
 
@@ -213,6 +216,14 @@ inline bool Transaction::performAsSystem(const mem::Callback<bool()> &cb) const
 	return ret;
 }
 
+inline bool Transaction::performBatch(const mem::Callback<bool()> &cb) const {
+	return perform([&] {
+		_data->adapter.beginBatch();
+		auto ret = cb();
+		return _data->adapter.endBatch() && ret;
+	});
+}
+
 struct AccessRole : public mem::AllocBase {
 	using OnSelect = stappler::ValueWrapper<mem::Function<bool(Worker &, const Query &)>, class OnSelectTag>;
 	using OnCount = stappler::ValueWrapper<mem::Function<bool(Worker &, const Query &)>, class OnCountTag>;
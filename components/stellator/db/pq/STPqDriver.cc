@@ -23,6 +23,8 @@ THE SOFTWARE.
 #include "STPqDriver.h"
 
 #include <dlfcn.h>
+#include <list>
+#include <unordered_map>
 
 NS_DB_PQ_BEGIN
 
@@ -44,7 +46,9 @@ enum ExecStatusType {
 	PGRES_NONFATAL_ERROR,
 	PGRES_FATAL_ERROR,
 	PGRES_COPY_BOTH,
-	PGRES_SINGLE_TUPLE
+	PGRES_SINGLE_TUPLE,
+	PGRES_PIPELINE_SYNC,
+	PGRES_PIPELINE_ABORTED
 };
 
 enum PGTransactionStatusType {
@@ -96,6 +100,15 @@ struct DriverSym : mem::AllocBase {
 	using PQisBusyType = int (*) (void *conn);
 	using PQgetResultType = void *(*) (void *conn);
 	using PQsetNoticeProcessorType = void (*) (void *conn, PQnoticeProcessor, void *);
+	using PQprepareType = void *(*) (void *conn, const char *stmtName, const char *query, int nParams, const void *paramTypes);
+	using PQexecPreparedType = void *(*) (void *conn, const char *stmtName, int nParams, const char *const *paramValues,
+			const int *paramLengths, const int *paramFormats, int resultFormat);
+	using PQresultErrorFieldType = char *(*) (const void *res, int fieldcode);
+	using PQenterPipelineModeType = int (*) (void *conn);
+	using PQexitPipelineModeType = int (*) (void *conn);
+	using PQpipelineSyncType = int (*) (void *conn);
+	using PQsendQueryParamsType = int (*) (void *conn, const char *command, int nParams, const void *paramTypes,
+			const char *const *paramValues, const int *paramLengths, const int *paramFormats, int resultFormat);
 
 	DriverSym(mem::StringView name, void *d) : name(name), ptr(d) {
 		this->PQresultStatus = DriverSym::PQresultStatusType(dlsym(d, "PQresultStatus"));
@@ -128,13 +141,22 @@ struct DriverSym : mem::AllocBase {
 		this->PQisBusy = DriverSym::PQisBusyType(dlsym(d, "PQisBusy"));
 		this->PQgetResult = DriverSym::PQgetResultType(dlsym(d, "PQgetResult"));
 		this->PQsetNoticeProcessor = DriverSym::PQsetNoticeProcessorType(dlsym(d, "PQsetNoticeProcessor"));
+		this->PQprepare = DriverSym::PQprepareType(dlsym(d, "PQprepare"));
+		this->PQexecPrepared = DriverSym::PQexecPreparedType(dlsym(d, "PQexecPrepared"));
+		this->PQresultErrorField = DriverSym::PQresultErrorFieldType(dlsym(d, "PQresultErrorField"));
+
+		// pipeline mode is available since libpq 14, it's optional
+		this->PQenterPipelineMode = DriverSym::PQenterPipelineModeType(dlsym(d, "PQenterPipelineMode"));
+		this->PQexitPipelineMode = DriverSym::PQexitPipelineModeType(dlsym(d, "PQexitPipelineMode"));
+		this->PQpipelineSync = DriverSym::PQpipelineSyncType(dlsym(d, "PQpipelineSync"));
+		this->PQsendQueryParams = DriverSym::PQsendQueryParamsType(dlsym(d, "PQsendQueryParams"));
 	}
 
 	~DriverSym() { }
 
 	operator bool () const {
 		void **begin = (void **)&this->PQconnectdbParams;
-		void **end = (void **)&this->PQsetNoticeProcessor + 1;
+		void **end = (void **)&this->PQresultErrorField + 1;
 		while (begin != end) {
 			if (*begin == nullptr) {
 				return false;
@@ -176,6 +198,13 @@ struct DriverSym : mem::AllocBase {
 	PQisBusyType PQisBusy = nullptr;
 	PQgetResultType PQgetResult = nullptr;
 	PQsetNoticeProcessorType PQsetNoticeProcessor = nullptr;
+	PQprepareType PQprepare = nullptr;
+	PQexecPreparedType PQexecPrepared = nullptr;
+	PQresultErrorFieldType PQresultErrorField = nullptr;
+	PQenterPipelineModeType PQenterPipelineMode = nullptr;
+	PQexitPipelineModeType PQexitPipelineMode = nullptr;
+	PQpipelineSyncType PQpipelineSync = nullptr;
+	PQsendQueryParamsType PQsendQueryParams = nullptr;
 	uint32_t refCount = 1;
 };
 
@@ -186,6 +215,54 @@ struct DriverHandle {
 	mem::pool_t *pool;
 };
 
+// LRU of prepared statements for single connection, stored in connection's pool userdata
+// Standard containers are used, because connection's pool is long-lived and can not reuse small blocks
+struct DriverStatementCache {
+	static constexpr auto Key = "ST.Pq.StatementCache";
+	static constexpr size_t DeallocateBatch = 16;
+
+	struct Statement {
+		std::string query;
+		std::string name; // empty if statement is not prepared on server yet
+		size_t uses = 0;
+	};
+
+	using List = std::list<Statement>;
+
+	// most recently used statements are at the front
+	List list;
+	std::unordered_map<mem::StringView, List::iterator> index;
+
+	// names of evicted statements, that should be deallocated on server
+	std::vector<std::string> deallocate;
+
+	uint64_t nextId = 0;
+	Driver::StatementStats stats;
+
+	void clear() {
+		list.clear();
+		index.clear();
+		deallocate.clear();
+	}
+};
+
+static DriverStatementCache *Driver_getStatementCache(mem::pool_t *pool, bool create) {
+	if (!pool) {
+		return nullptr;
+	}
+
+	DriverStatementCache *cache = nullptr;
+	mem::pool::userdata_get((void **)&cache, DriverStatementCache::Key, pool);
+	if (!cache && create) {
+		cache = new DriverStatementCache;
+		mem::pool::userdata_set((void *)cache, DriverStatementCache::Key, nullptr, pool);
+		mem::pool::cleanup_register(pool, [cache] {
+			delete cache;
+		});
+	}
+	return cache;
+}
+
 static std::mutex s_driverMutex;
 
 struct PgDriverLibStorage {
@@ -434,6 +511,12 @@ void Driver::finish(Handle h) const {
 bool Driver::isValid(Handle handle) const {
 	auto conn = getConnection(handle);
 	if (conn.get()) {
+		if (_handle->PQstatus(conn.get()) != CONNECTION_OK) {
+			// connection will be reset, server-side prepared statements are lost
+			if (auto cache = Driver_getStatementCache(getHandlePool(handle), false)) {
+				cache->clear();
+			}
+		}
 		return isValid(conn);
 	}
 	return false;
@@ -456,12 +539,15 @@ bool Driver::isIdle(Connection conn) const {
 int Driver::listenForNotifications(Handle handle) const {
 	auto conn = getConnection(handle).get();
 
+	// wait for LISTEN completion, so connection can be used to fetch broadcasts right after notification
 	auto query = mem::toString("LISTEN ", config::getStorageBroadcastChannelName(), ";");
-	int querySent = _handle->PQsendQuery(conn, query.data());
-	if (querySent == 0) {
+	auto res = _handle->PQexec(conn, query.data());
+	if (_handle->PQresultStatus(res) != PGRES_COMMAND_OK) {
 		std::cout << "[Postgres]: " << _handle->PQerrorMessage(conn) << "\n";
+		_handle->PQclear(res);
 		return -1;
 	}
+	_handle->PQclear(res);
 
 	if (_handle->PQsetnonblocking(conn, 1) == -1) {
 		std::cout << "[Postgres]: " << _handle->PQerrorMessage(conn) << "\n";
@@ -523,6 +609,8 @@ Driver::Status Driver::getStatus(Result res) const {
 	case PGRES_FATAL_ERROR: return Driver::Status::FatalError; break;
 	case PGRES_COPY_BOTH: return Driver::Status::CopyBoth; break;
 	case PGRES_SINGLE_TUPLE: return Driver::Status::SingleTuple; break;
+	case PGRES_PIPELINE_SYNC: return Driver::Status::PipelineSync; break;
+	case PGRES_PIPELINE_ABORTED: return Driver::Status::PipelineAborted; break;
 	default: break;
 	}
 	return Driver::Status::Empty;
@@ -576,6 +664,8 @@ char *Driver::getStatusMessage(Status st) const {
 	case Status::FatalError: return _handle->PQresStatus(PGRES_FATAL_ERROR); break;
 	case Status::CopyBoth: return _handle->PQresStatus(PGRES_COPY_BOTH); break;
 	case Status::SingleTuple: return _handle->PQresStatus(PGRES_SINGLE_TUPLE); break;
+	case Status::PipelineSync: return _handle->PQresStatus(PGRES_PIPELINE_SYNC); break;
+	case Status::PipelineAborted: return _handle->PQresStatus(PGRES_PIPELINE_ABORTED); break;
 	}
 	return nullptr;
 }
@@ -606,6 +696,128 @@ Driver::Result Driver::exec(Connection conn, const char *command, int nParams, c
 	return Driver::Result(_handle->PQexecParams(conn.get(), command, nParams, nullptr, paramValues, paramLengths, paramFormats, resultFormat));
 }
 
+Driver::Result Driver::execCached(Handle handle, Connection conn, const char *command, int nParams, const char *const *paramValues,
+		const int *paramLengths, const int *paramFormats, int resultFormat) const {
+	auto cache = Driver_getStatementCache(getHandlePool(handle), true);
+	if (!cache) {
+		return exec(conn, command, nParams, paramValues, paramLengths, paramFormats, resultFormat);
+	}
+
+	++ cache->stats.lookups;
+
+	DriverStatementCache::List::iterator it;
+	auto indexIt = cache->index.find(mem::StringView(command));
+	if (indexIt == cache->index.end()) {
+		cache->list.emplace_front(DriverStatementCache::Statement{command});
+		it = cache->list.begin();
+		cache->index.emplace(mem::StringView(it->query), it);
+
+		if (cache->list.size() > StatementCacheSize) {
+			auto &last = cache->list.back();
+			if (!last.name.empty()) {
+				cache->deallocate.emplace_back(std::move(last.name));
+				++ cache->stats.evicted;
+			}
+			cache->index.erase(mem::StringView(last.query));
+			cache->list.pop_back();
+		}
+	} else {
+		it = indexIt->second;
+		cache->list.splice(cache->list.begin(), cache->list, it);
+	}
+
+	++ it->uses;
+
+	// deallocate evicted statements outside of transaction, so failure can not abort it
+	if (cache->deallocate.size() >= DriverStatementCache::DeallocateBatch
+			&& _handle->PQtransactionStatus(conn.get()) == PQTRANS_IDLE) {
+		mem::StringStream query;
+		for (auto &name : cache->deallocate) {
+			query << "DEALLOCATE " << name << ";";
+		}
+		_handle->PQclear(_handle->PQexec(conn.get(), query.weak().data()));
+		cache->deallocate.clear();
+	}
+
+	if (it->name.empty()) {
+		if (it->uses < StatementPrepareThreshold) {
+			return exec(conn, command, nParams, paramValues, paramLengths, paramFormats, resultFormat);
+		}
+
+		auto name = mem::toString("stpq_", ++ cache->nextId);
+
+		if (_dbCtrl) {
+			_dbCtrl(false);
+		}
+
+		auto res = _handle->PQprepare(conn.get(), name.data(), command, nParams, nullptr);
+		if (_handle->PQresultStatus(res) != PGRES_COMMAND_OK) {
+			// return error result to caller, as it was returned by exec
+			return Driver::Result(res);
+		}
+
+		clearResult(Driver::Result(res));
+
+		it->name = std::string(name.data(), name.size());
+		++ cache->stats.prepared;
+	} else {
+		++ cache->stats.hits;
+	}
+
+	if (_dbCtrl) {
+		_dbCtrl(false);
+	}
+
+	auto res = _handle->PQexecPrepared(conn.get(), it->name.data(), nParams, paramValues, paramLengths, paramFormats, resultFormat);
+	if (res && _handle->PQresultStatus(res) == PGRES_FATAL_ERROR) {
+		auto state = _handle->PQresultErrorField(res, 'C'); // PG_DIAG_SQLSTATE
+		if (state && strcmp(state, "26000") == 0) {
+			// invalid_sql_statement_name: statement was dropped on server, prepare it again on next use
+			it->name.clear();
+			it->uses = 0;
+		}
+	}
+	return Driver::Result(res);
+}
+
+bool Driver::isPipelineSupported() const {
+	return _handle->PQenterPipelineMode && _handle->PQexitPipelineMode && _handle->PQpipelineSync && _handle->PQsendQueryParams;
+}
+
+bool Driver::enterPipelineMode(Connection conn) const {
+	return _handle->PQenterPipelineMode(conn.get()) == 1;
+}
+
+bool Driver::exitPipelineMode(Connection conn) const {
+	return _handle->PQexitPipelineMode(conn.get()) == 1;
+}
+
+bool Driver::pipelineSync(Connection conn) const {
+	if (_dbCtrl) {
+		_dbCtrl(false); // sync produces own result
+	}
+	return _handle->PQpipelineSync(conn.get()) == 1;
+}
+
+bool Driver::sendQuery(Connection conn, const char *command, int nParams, const char *const *paramValues,
+		const int *paramLengths, const int *paramFormats, int resultFormat) const {
+	if (_dbCtrl) {
+		_dbCtrl(false);
+	}
+	return _handle->PQsendQueryParams(conn.get(), command, nParams, nullptr, paramValues, paramLengths, paramFormats, resultFormat) == 1;
+}
+
+Driver::Result Driver::getResult(Connection conn) const {
+	return Driver::Result(_handle->PQgetResult(conn.get()));
+}
+
+Driver::StatementStats Driver::getStatementStats(Handle handle) const {
+	if (auto cache = Driver_getStatementCache(getHandlePool(handle), false)) {
+		return cache->stats;
+	}
+	return StatementStats();
+}
+
 Interface::StorageType Driver::getTypeById(uint32_t oid) const {
 	auto it = std::lower_bound(_storageTypes.begin(), _storageTypes.end(), oid, [] (const mem::Pair<uint32_t, Interface::StorageType> &l, uint32_t r) -> bool {
 		return l.first < r;
@@ -745,9 +957,9 @@ int64_t ResultCursor::toInteger(size_t field) const {
 				driver->getLength(result, currentRow, field));
 		switch (r.size()) {
 		case 1: return r.readUnsigned(); break;
-		case 2: return r.readUnsigned16(); break;
-		case 4: return r.readUnsigned32(); break;
-		case 8: return r.readUnsigned64(); break;
+		case 2: return int16_t(r.readUnsigned16()); break;
+		case 4: return int32_t(r.readUnsigned32()); break;
+		case 8: return int64_t(r.readUnsigned64()); break;
 		default: break;
 		}
 		return 0;
@@ -977,6 +1189,16 @@ Driver::Handle Driver::doConnect(const char * const *keywords, const char * cons
 	return Driver::Handle(nullptr);
 }
 
+mem::pool_t *Driver::getHandlePool(Handle _h) const {
+	if (_external) {
+		auto h = (ap_dbd_t *)_h.get();
+		return h ? h->pool : nullptr;
+	} else {
+		auto h = (DriverHandle *)_h.get();
+		return h ? h->pool : nullptr;
+	}
+}
+
 Driver::Connection Driver::getConnection(Handle _h) const {
 	if (_external) {
 		auto h = (ap_dbd_t *)_h.get();
@@ -1020,6 +1242,11 @@ Driver::Handle Driver::doConnect(const char * const *keywords, const char * cons
 	return Driver::Handle(nullptr);
 }
 
+mem::pool_t *Driver::getHandlePool(Handle _h) const {
+	auto h = (DriverHandle *)_h.get();
+	return h ? h->pool : nullptr;
+}
+
 Driver::Connection Driver::getConnection(Handle _h) const {
 	auto h = (DriverHandle *)_h.get();
 	return Driver::Connection(h->conn);
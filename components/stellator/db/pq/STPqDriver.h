@@ -42,6 +42,8 @@ public:
 		FatalError,
 		CopyBoth,
 		SingleTuple,
+		PipelineSync,
+		PipelineAborted,
 	};
 
 	enum class TransactionStatus {
@@ -52,6 +54,18 @@ public:
 		Unknown
 	};
 
+	struct StatementStats {
+		size_t lookups = 0; // queries, executed through statement cache
+		size_t hits = 0; // executions of already prepared statements (plan reuse)
+		size_t prepared = 0; // statements, prepared on server
+		size_t evicted = 0; // prepared statements, evicted from cache
+	};
+
+	// Every connection has LRU cache of prepared statements, keyed by query text
+	// Query is prepared on server when it was executed StatementPrepareThreshold times
+	static constexpr size_t StatementCacheSize = 256;
+	static constexpr size_t StatementPrepareThreshold = 2;
+
 	static Driver *open(mem::StringView path = mem::StringView(), const void *external = nullptr);
 
 	virtual ~Driver();
@@ -66,6 +80,9 @@ public:
 
 	virtual Connection getConnection(Handle h) const override;
 
+	// pool, associated with connection
+	mem::pool_t *getHandlePool(Handle h) const;
+
 	virtual bool isValid(Handle) const override;
 	virtual bool isValid(Connection) const override;
 	virtual bool isIdle(Connection) const override;
@@ -100,6 +117,25 @@ public:
 	Result exec(Connection conn, const char *command, int nParams, const char *const *paramValues,
 			const int *paramLengths, const int *paramFormats, int resultFormat) const;
 
+	// same as exec with parameters, but uses prepared statement from connection's cache
+	Result execCached(Handle handle, Connection conn, const char *command, int nParams, const char *const *paramValues,
+			const int *paramLengths, const int *paramFormats, int resultFormat) const;
+
+	StatementStats getStatementStats(Handle) const;
+
+	// pipeline mode (libpq 14+): queries are sent with sendQuery without waiting for results,
+	// pipelineSync marks end of batch, then results should be read in order with getResult
+	bool isPipelineSupported() const;
+	bool enterPipelineMode(Connection) const;
+	bool exitPipelineMode(Connection) const;
+	bool pipelineSync(Connection) const;
+
+	bool sendQuery(Connection conn, const char *command, int nParams, const char *const *paramValues,
+			const int *paramLengths, const int *paramFormats, int resultFormat) const;
+
+	// returns nullptr when all results for current query was read
+	Result getResult(Connection) const;
+
 	operator bool () const { return _handle != nullptr; }
 
 	Interface::StorageType getTypeById(uint32_t) const;
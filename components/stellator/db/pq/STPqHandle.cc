@@ -453,6 +453,10 @@ void Handle::makeQuery(const stappler::Callback<void(sql::SqlQuery &)> &cb) {
 
 bool Handle::selectQuery(const sql::SqlQuery &query, const stappler::Callback<bool(sql::Result &)> &cb,
 		const mem::Callback<void(const mem::Value &)> &errCb) {
+	if (pipeline && !flushPipeline()) {
+		return false;
+	}
+
 	if (!conn.get() || getTransactionStatus() == db::TransactionStatus::Rollback) {
 		return false;
 	}
@@ -466,7 +470,7 @@ bool Handle::selectQuery(const sql::SqlQuery &query, const stappler::Callback<bo
 	}
 
 	ExecParamData data(query);
-	ResultCursor res(driver, driver->exec(conn, query.getQuery().weak().data(), queryInterface->params.size(),
+	ResultCursor res(driver, driver->execCached(handle, conn, query.getQuery().weak().data(), queryInterface->params.size(),
 			data.paramValues, data.paramLengths, data.paramFormats, 1));
 	if (!res.isSuccess()) {
 		auto info = res.getInfo();
@@ -490,6 +494,10 @@ bool Handle::selectQuery(const sql::SqlQuery &query, const stappler::Callback<bo
 }
 
 bool Handle::performSimpleQuery(const mem::StringView &query, const mem::Callback<void(const mem::Value &)> &errCb) {
+	if (pipeline) {
+		flushPipeline();
+	}
+
 	if (getTransactionStatus() == db::TransactionStatus::Rollback) {
 		return false;
 	}
@@ -518,6 +526,10 @@ bool Handle::performSimpleQuery(const mem::StringView &query, const mem::Callbac
 
 bool Handle::performSimpleSelect(const mem::StringView &query, const stappler::Callback<void(sql::Result &)> &cb,
 		const mem::Callback<void(const mem::Value &)> &errCb) {
+	if (pipeline && !flushPipeline()) {
+		return false;
+	}
+
 	if (getTransactionStatus() == db::TransactionStatus::Rollback) {
 		return false;
 	}
@@ -549,6 +561,119 @@ bool Handle::performSimpleSelect(const mem::StringView &query, const stappler::C
 	return false;
 }
 
+bool Handle::beginBatch() {
+	++ batchLevel;
+	return true;
+}
+
+bool Handle::endBatch() {
+	if (batchLevel > 0) {
+		-- batchLevel;
+	}
+
+	if (batchLevel == 0 && pipeline) {
+		return flushPipeline();
+	}
+	return getTransactionStatus() != db::TransactionStatus::Rollback;
+}
+
+bool Handle::queueQuery(const db::sql::SqlQuery &query) {
+	if (batchLevel == 0 || !driver->isPipelineSupported()) {
+		return SqlHandle::queueQuery(query);
+	}
+
+	if (!conn.get() || getTransactionStatus() == db::TransactionStatus::Rollback) {
+		return false;
+	}
+
+	if (!pipeline) {
+		if (!driver->enterPipelineMode(conn)) {
+			return SqlHandle::queueQuery(query);
+		}
+		pipeline = true;
+	}
+
+	auto queryInterface = static_cast<PgQueryInterface *>(query.getInterface());
+
+	if (messages::isDebugEnabled()) {
+		if (!query.getTarget().starts_with("__")) {
+			messages::local("Database-Query", query.getQuery().weak());
+		}
+	}
+
+	// parameters are copied into connection's output buffer, so query can be reused after send
+	ExecParamData data(query);
+	if (!driver->sendQuery(conn, query.getQuery().weak().data(), queryInterface->params.size(),
+			data.paramValues, data.paramLengths, data.paramFormats, 1)) {
+		messages::error("Database", "Fail to send query into pipeline");
+		flushPipeline();
+		cancelTransaction_pg();
+		return false;
+	}
+
+	++ pipelineQueries;
+	if (pipelineQueries >= PipelineQueueSize) {
+		return flushPipeline();
+	}
+	return true;
+}
+
+bool Handle::flushPipeline() {
+	if (!pipeline) {
+		return true;
+	}
+
+	bool success = driver->pipelineSync(conn);
+	if (success) {
+		// every query produces it's results, followed by nullptr, sync produces single result with no nullptr after it
+		size_t nulls = 0;
+		while (true) {
+			auto r = driver->getResult(conn);
+			if (!r.get()) {
+				if (++ nulls > pipelineQueries) {
+					// no sync result, connection is broken
+					success = false;
+					break;
+				}
+				continue;
+			}
+
+			ResultCursor res(driver, r);
+			auto err = res.getError();
+			if (err == Driver::Status::PipelineSync) {
+				break;
+			} else if (err == Driver::Status::PipelineAborted) {
+				// query was skipped by server after previous failure
+				continue;
+			}
+
+			lastError = err;
+			if (!res.isSuccess()) {
+				auto info = res.getInfo();
+#if DEBUG
+				std::cout << mem::EncodeFormat::Pretty << info << "\n";
+#endif
+				messages::debug("Database", "Fail to perform query in pipeline", std::move(info));
+				messages::error("Database", "Fail to perform query in pipeline");
+				success = false;
+			}
+		}
+	}
+
+	driver->exitPipelineMode(conn);
+	pipeline = false;
+	pipelineQueries = 0;
+
+	if (!success) {
+		cancelTransaction_pg();
+	}
+	return success;
+}
+
+Driver::StatementStats Handle::getStatementStats() const {
+	return driver->getStatementStats(handle);
+}
+
 bool Handle::isSuccess() const {
 	return ResultCursor::pgsql_is_success(lastError);
 }
@@ -39,6 +39,10 @@ class Handle : public db::sql::SqlHandle {
 public:
 	using Value = mem::Value;
 
+	// max number of queries in pipeline before forced sync
+	// connection works in blocking mode, so we should not wait too long to read results
+	static constexpr size_t PipelineQueueSize = 256;
+
 	Handle(const Driver *, Driver::Handle);
 
 	Handle(const Handle &) = delete;
@@ -66,6 +70,12 @@ public:
 
 	virtual bool isSuccess() const override;
 
+	virtual bool beginBatch() override;
+	virtual bool endBatch() override;
+
+	// counters of connection's prepared statement cache
+	Driver::StatementStats getStatementStats() const;
+
 	void close();
 
 public: // adapter interface
@@ -79,6 +89,11 @@ protected:
 	void cancelTransaction_pg();
 	bool endTransaction_pg();
 
+	virtual bool queueQuery(const db::sql::SqlQuery &) override;
+
+	// send sync, read all pending pipeline results and leave pipeline mode
+	bool flushPipeline();
+
 	using ViewIdVec = mem::Vector<mem::Pair<const Scheme::ViewScheme *, int64_t>>;
 
 	const Driver *driver = nullptr;
@@ -87,6 +102,10 @@ protected:
 	Driver::Status lastError = Driver::Status::Empty;
 	mem::Value lastErrorInfo;
 	TransactionLevel level = TransactionLevel::ReadCommited;
+
+	size_t batchLevel = 0;
+	size_t pipelineQueries = 0;
+	bool pipeline = false;
 };
 
 NS_DB_PQ_END
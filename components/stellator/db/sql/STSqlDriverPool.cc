@@ -0,0 +1,344 @@
+/**
+ Copyright (c) 2021 Roman Katuntsev <sbkarr@stappler.org>
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ **/
+
+#include "STSqlDriverPool.h"
+
+NS_DB_SQL_BEGIN
+
+bool DriverPool::Config::set(const mem::StringView &key, const mem::StringView &value) {
+	auto readCount = [&] (size_t &target) {
+		if (auto v = mem::StringView(value).readInteger(10).get(0)) {
+			target = size_t(stappler::math::clamp(v, int64_t(1), int64_t(config::getMaxDatabaseConnections())));
+		} else {
+			std::cout << "[DriverPool] invalid value for " << key << ": " << value << "\n";
+		}
+	};
+
+	auto readInterval = [&] (mem::TimeInterval &target, bool allowZero) {
+		auto r = mem::StringView(value).readInteger(10);
+		if (r.valid() && (r.get() > 0 || (allowZero && r.get() == 0))) {
+			target = mem::TimeInterval::seconds(r.get());
+		} else {
+			std::cout << "[DriverPool] invalid value for " << key << ": " << value << "\n";
+		}
+	};
+
+	if (key == "nmin") {
+		readCount(nmin);
+	} else if (key == "nkeep") {
+		readCount(nkeep);
+	} else if (key == "nmax") {
+		readCount(nmax);
+	} else if (key == "exptime") {
+		readInterval(exptime, false);
+	} else if (key == "lifetime") {
+		readInterval(lifetime, true);
+	} else if (key == "timeout") {
+		readInterval(timeout, true);
+	} else {
+		return false;
+	}
+	return true;
+}
+
+DriverPool *DriverPool::create(Driver *driver, const mem::Map<mem::StringView, mem::StringView> &params, const Config &cfg) {
+	auto p = mem::pool::create((mem::pool_t *)nullptr);
+	mem::pool::push(p);
+	auto ret = new (p) DriverPool(driver, params, cfg);
+	mem::pool::pop();
+	return ret;
+}
+
+void DriverPool::destroy() {
+	close();
+	unref();
+}
+
+DriverPool::DriverPool(Driver *driver, const mem::Map<mem::StringView, mem::StringView> &params, const Config &cfg)
+: _pool(mem::pool::acquire()), _driver(driver), _config(cfg), _refs(1) {
+	for (auto &it : params) {
+		_params.emplace(it.first.pdup(_pool), it.second.pdup(_pool));
+	}
+
+	_config.nmax = std::max(_config.nmax, size_t(1));
+	_config.nmin = std::min(_config.nmin, _config.nmax);
+	_config.nkeep = stappler::math::clamp(_config.nkeep, _config.nmin, _config.nmax);
+}
+
+DriverPool::~DriverPool() {
+	close();
+}
+
+Driver::Handle DriverPool::acquire() {
+	HandleList expired;
+	Driver::Handle ret(nullptr);
+
+	// acquired handle holds reference, so pool is alive until it's released
+	++ _refs;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	auto start = mem::Time::now();
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(_config.timeout.toMicros());
+	bool waited = false;
+
+	collectExpired(expired, start);
+
+	while (!_closed) {
+		if (!_idle.empty()) {
+			auto h = _idle.back().handle;
+			_idle.pop_back();
+
+			// validate without lock, driver can try to restore connection
+			lock.unlock();
+			bool valid = _driver->isValid(h);
+			lock.lock();
+
+			if (valid) {
+				++ _stats.reused;
+				ret = h;
+				break;
+			}
+
+			++ _stats.invalidated;
+			detach(expired, h);
+			continue;
+		}
+
+		if (_handles.size() + _connecting < _config.nmax) {
+			++ _connecting;
+			lock.unlock();
+			auto h = connect();
+			lock.lock();
+			-- _connecting;
+
+			if (h.get()) {
+				ret = h;
+			} else {
+				// let other waiter try it's own connection
+				_cond.notify_one();
+			}
+			break;
+		}
+
+		if (!waited) {
+			++ _stats.waits;
+			waited = true;
+		}
+
+		++ _stats.waiting;
+		if (_config.timeout) {
+			if (_cond.wait_until(lock, deadline) == std::cv_status::timeout) {
+				-- _stats.waiting;
+				if (_idle.empty() && _handles.size() + _connecting >= _config.nmax) {
+					++ _stats.timeouts;
+					break;
+				}
+				continue;
+			}
+		} else {
+			_cond.wait(lock);
+		}
+		-- _stats.waiting;
+	}
+
+	if (ret.get()) {
+		++ _stats.acquired;
+	}
+
+	if (waited) {
+		auto t = mem::Time::now() - start;
+		_stats.waitTime += t;
+		_stats.maxWaitTime = std::max(_stats.maxWaitTime, t);
+	}
+
+	lock.unlock();
+
+	finish(expired);
+
+	if (!ret.get()) {
+		unref();
+	}
+	return ret;
+}
+
+void DriverPool::release(Driver::Handle h) {
+	if (!h.get()) {
+		return;
+	}
+
+	auto now = mem::Time::now();
+	bool valid = _driver->isValid(h) && _driver->isIdle(_driver->getConnection(h));
+
+	HandleList expired;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	auto it = _handles.find(h.get());
+	if (it == _handles.end()) {
+		lock.unlock();
+		_driver->finish(h);
+		return;
+	}
+
+	if (!valid || _closed) {
+		if (!valid) {
+			++ _stats.invalidated;
+		}
+		detach(expired, h);
+	} else if (_config.lifetime && now - it->second.ctime > _config.lifetime) {
+		++ _stats.expired;
+		detach(expired, h);
+	} else {
+		_idle.emplace_back(IdleHandle{h, it->second.ctime, now});
+	}
+
+	collectExpired(expired, now);
+	lock.unlock();
+
+	_cond.notify_one();
+	finish(expired);
+	unref();
+}
+
+void DriverPool::prefill() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (!_closed && _handles.size() + _connecting < _config.nmin) {
+		++ _connecting;
+		lock.unlock();
+		auto h = connect();
+		lock.lock();
+		-- _connecting;
+
+		if (!h.get()) {
+			break;
+		}
+
+		_idle.emplace_back(IdleHandle{h, _handles[h.get()].ctime, mem::Time::now()});
+		_cond.notify_one();
+	}
+}
+
+void DriverPool::cleanup() {
+	HandleList expired;
+
+	_mutex.lock();
+	collectExpired(expired, mem::Time::now());
+	_mutex.unlock();
+
+	finish(expired);
+	prefill();
+}
+
+void DriverPool::close() {
+	HandleList handles;
+
+	_mutex.lock();
+	_closed = true;
+	for (auto &it : _idle) {
+		detach(handles, it.handle);
+	}
+	_idle.clear();
+	_mutex.unlock();
+
+	_cond.notify_all();
+	finish(handles);
+}
+
+DriverPool::Stats DriverPool::getStats() const {
+	std::unique_lock<std::mutex> lock(_mutex);
+	auto ret = _stats;
+	ret.opened = _handles.size();
+	ret.idle = _idle.size();
+	return ret;
+}
+
+void DriverPool::unref() {
+	if (-- _refs == 0) {
+		auto p = _pool;
+		this->~DriverPool();
+		mem::pool::destroy(p);
+	}
+}
+
+Driver::Handle DriverPool::connect() {
+	mem::pool_t *p = nullptr;
+	_poolMutex.lock();
+	p = mem::pool::create(_pool);
+	_poolMutex.unlock();
+
+	Driver::Handle h(nullptr);
+	mem::pool::push(p);
+	h = _driver->connect(_params);
+	mem::pool::pop();
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (h.get()) {
+		++ _stats.connected;
+		_handles.emplace(h.get(), HandleInfo{p, mem::Time::now()});
+	} else {
+		++ _stats.failed;
+		lock.unlock();
+
+		_poolMutex.lock();
+		mem::pool::destroy(p);
+		_poolMutex.unlock();
+	}
+	return h;
+}
+
+void DriverPool::finish(HandleList &handles) {
+	for (auto &it : handles) {
+		mem::pool::push(it.second);
+		_driver->finish(it.first);
+		mem::pool::pop();
+
+		_poolMutex.lock();
+		mem::pool::destroy(it.second);
+		_poolMutex.unlock();
+	}
+	handles.clear();
+}
+
+void DriverPool::detach(HandleList &out, Driver::Handle h) {
+	auto it = _handles.find(h.get());
+	if (it != _handles.end()) {
+		out.emplace_back(h, it->second.pool);
+		_handles.erase(it);
+	}
+}
+
+void DriverPool::collectExpired(HandleList &out, mem::Time now) {
+	// idle handles stored in order of release, so least recently used ones are first
+	auto it = _idle.begin();
+	while (it != _idle.end()) {
+		if ((_config.lifetime && now - it->ctime > _config.lifetime)
+				|| (_idle.size() > _config.nkeep && now - it->atime > _config.exptime)) {
+			++ _stats.expired;
+			detach(out, it->handle);
+			it = _idle.erase(it);
+		} else {
+			++ it;
+		}
+	}
+}
+
+NS_DB_SQL_END
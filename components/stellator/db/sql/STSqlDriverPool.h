@@ -0,0 +1,142 @@
+/**
+ Copyright (c) 2021 Roman Katuntsev <sbkarr@stappler.org>
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ **/
+
+#ifndef COMPONENTS_STELLATOR_DB_SQL_STSQLDRIVERPOOL_H_
+#define COMPONENTS_STELLATOR_DB_SQL_STSQLDRIVERPOOL_H_
+
+#include "STSqlDriver.h"
+
+#include <condition_variable>
+#include <atomic>
+
+NS_DB_SQL_BEGIN
+
+// Bounded pool of driver handles, shared between threads of server
+// Idle handles are reused in LIFO order, so excess handles stay unused and expire after `exptime`
+// Handle is validated with Driver::isValid on acquire and with Driver::isValid/isIdle on release
+//
+// Pool is allocated in it's own memory pool and freed by destroy() only when all acquired handles
+// are released, so, handle can be safely released from cleanup of request's memory pool,
+// that can outlive owner of the driver pool
+class DriverPool : public mem::AllocBase {
+public:
+	struct Config {
+		size_t nmin = 1; // handles, opened with prefill
+		size_t nkeep = 2; // idle handles, that are not closed after `exptime`
+		size_t nmax = 10; // max number of opened handles, acquire waits when limit is reached
+		mem::TimeInterval exptime = mem::TimeInterval::seconds(300); // idle time, after which excess handle is closed
+		mem::TimeInterval lifetime; // max time since connection, after which handle is recycled (zero - unlimited)
+		mem::TimeInterval timeout; // max time to wait in acquire (zero - no limit)
+
+		// read pool option from string parameter, returns false if key is not a pool option
+		bool set(const mem::StringView &key, const mem::StringView &value);
+	};
+
+	struct Stats {
+		size_t opened = 0; // handles, currently opened by pool
+		size_t idle = 0; // handles, currently available for reuse
+		size_t waiting = 0; // threads, currently waiting in acquire
+
+		size_t acquired = 0; // handles, acquired from pool
+		size_t reused = 0; // acquires, served with idle handle
+		size_t connected = 0; // new connections
+		size_t failed = 0; // failed connection attempts
+		size_t invalidated = 0; // handles, closed by validation
+		size_t expired = 0; // handles, closed by exptime or lifetime
+		size_t waits = 0; // acquires, that had to wait for handle
+		size_t timeouts = 0; // acquires, failed by timeout
+
+		mem::TimeInterval waitTime; // total time, spent in wait queue
+		mem::TimeInterval maxWaitTime;
+	};
+
+	static DriverPool *create(Driver *, const mem::Map<mem::StringView, mem::StringView> &params, const Config &);
+
+	// close pool and free it, when last acquired handle is released
+	void destroy();
+
+	// returns null handle if connection failed, wait timed out or pool was closed
+	Driver::Handle acquire();
+	void release(Driver::Handle);
+
+	// open handles up to `nmin`
+	void prefill();
+
+	// close expired idle handles, then prefill
+	void cleanup();
+
+	// close idle handles, acquired handles will be closed on release
+	void close();
+
+	Driver *getDriver() const { return _driver; }
+	const mem::Map<mem::StringView, mem::StringView> &getParams() const { return _params; }
+	const Config &getConfig() const { return _config; }
+
+	Stats getStats() const;
+
+protected:
+	struct HandleInfo {
+		mem::pool_t *pool = nullptr;
+		mem::Time ctime;
+	};
+
+	struct IdleHandle {
+		Driver::Handle handle;
+		mem::Time ctime;
+		mem::Time atime;
+	};
+
+	using HandleList = std::vector<mem::Pair<Driver::Handle, mem::pool_t *>>;
+
+	DriverPool(Driver *, const mem::Map<mem::StringView, mem::StringView> &params, const Config &);
+	~DriverPool();
+
+	// drop reference of owner or acquired handle, pool is freed with last reference
+	void unref();
+
+	Driver::Handle connect();
+	void finish(HandleList &);
+
+	// should be called with locked mutex
+	void detach(HandleList &, Driver::Handle);
+	void collectExpired(HandleList &, mem::Time now);
+
+	mem::pool_t *_pool = nullptr;
+	Driver *_driver = nullptr;
+	mem::Map<mem::StringView, mem::StringView> _params;
+	Config _config;
+
+	mutable std::mutex _mutex;
+	std::mutex _poolMutex; // memory pool is not thread-safe, handles use subpools of it
+	std::condition_variable _cond;
+
+	std::vector<IdleHandle> _idle;
+	std::unordered_map<void *, HandleInfo> _handles;
+	size_t _connecting = 0;
+	std::atomic<size_t> _refs; // owner and acquired handles
+	bool _closed = false;
+	Stats _stats;
+};
+
+NS_DB_SQL_END
+
+#endif /* COMPONENTS_STELLATOR_DB_SQL_STSQLDRIVERPOOL_H_ */
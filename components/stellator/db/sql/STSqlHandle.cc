@@ -245,6 +245,12 @@ void SqlHandle::finalizeBroadcast() {
 			performQuery(query);
 			_bcasts.clear();
 		});
+		if (isNotificationsSupported()) {
+			makeQuery([&] (SqlQuery &query) {
+				query.getStream() << "NOTIFY " << config::getStorageBroadcastChannelName() << ";";
+				performQuery(query);
+			});
+		}
 	}
 }
 
@@ -538,6 +544,10 @@ int64_t SqlHandle::selectQueryId(const SqlQuery &query) {
 	return id;
 }
 
+bool SqlHandle::queueQuery(const SqlQuery &query) {
+	return performQuery(query) != stappler::maxOf<size_t>();
+}
+
 size_t SqlHandle::performQuery(const SqlQuery &query) {
 	if (getTransactionStatus() == db::TransactionStatus::Rollback) {
 		return stappler::maxOf<size_t>();
@@ -111,6 +111,10 @@ protected:
 	int64_t selectQueryId(const SqlQuery &);
 	size_t performQuery(const SqlQuery &);
 
+	// perform query, which result is not required immediately
+	// within batch (see beginBatch) driver can defer it and send to server with other queries
+	virtual bool queueQuery(const SqlQuery &);
+
 	mem::Value selectValueQuery(const Scheme &, const SqlQuery &, const mem::Vector<const Field *> &virtuals);
 	mem::Value selectValueQuery(const Field &, const SqlQuery &, const mem::Vector<const Field *> &virtuals);
 	void selectValueQuery(mem::Value &, const FieldView &, const SqlQuery &);
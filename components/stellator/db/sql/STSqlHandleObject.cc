@@ -223,106 +223,152 @@ mem::Value SqlHandle::create(Worker &worker, mem::Value &idata) {
 		return ret;
 	};
 
-	if (Handle_hasPostUpdate(idata, fields)) {
-		if (idata.isDictionary()) {
-			return perform(idata);
-		} else if (idata.isArray()) {
-			mem::Value ret;
-			for (auto &it : idata.asArray()) {
-				if (auto v = perform(it)) {
-					ret.addValue(std::move(v));
+	// insert all objects with single multi-row query, ids are assigned in order of values
+	auto performBulk = [&] (mem::Value &ret) -> bool {
+		bool success = false;
+		mem::Vector<mem::StringView> fields;
+		for (auto &it : ret.asArray()) {
+			for (auto &f : it.asDict()) {
+				auto iit = std::lower_bound(fields.begin(), fields.end(), f.first);
+				if (iit == fields.end()) {
+					fields.emplace_back(f.first);
+				} else if (*iit != f.first) {
+					fields.emplace(iit, f.first);
 				}
 			}
-			return ret;
 		}
-	} else {
-		if (idata.isDictionary()) {
-			return perform(idata);
-		} else if (idata.isArray()) {
-			mem::Vector<mem::StringView> fields;
-			for (auto &it : idata.asArray()) {
-				for (auto &f : it.asDict()) {
-					auto iit = std::lower_bound(fields.begin(), fields.end(), f.first);
-					if (iit == fields.end()) {
-						fields.emplace_back(f.first);
-					} else if (*iit != f.first) {
-						fields.emplace(iit, f.first);
-					}
-				}
-			}
 
-			mem::Value ret(idata);
-			makeQuery([&] (SqlQuery &query) {
-				auto ins = query.insert(scheme.getName());
-				for (auto &it : fields) {
-					ins.field(it);
-				}
+		makeQuery([&] (SqlQuery &query) {
+			auto ins = query.insert(scheme.getName());
+			for (auto &it : fields) {
+				ins.field(it);
+			}
 
-				auto val = ins.values();
-				for (auto &it : ret.asArray()) {
-					for (auto &fIt : fields) {
-						if (auto f = scheme.getField(fIt)) {
-							auto &v = it.getValue(fIt);
-							if (v) {
-								if (f->getType() == db::Type::FullTextView) {
-									val.value(db::Binder::FullTextField{v});
-								} else {
-									val.value(db::Binder::DataField{f, v, f->isDataLayout(), f->hasFlag(db::Flags::Compressed)});
-								}
+			auto val = ins.values();
+			for (auto &it : ret.asArray()) {
+				for (auto &fIt : fields) {
+					if (auto f = scheme.getField(fIt)) {
+						auto &v = it.getValue(fIt);
+						if (v) {
+							if (f->getType() == db::Type::FullTextView) {
+								val.value(db::Binder::FullTextField{v});
 							} else {
-								val.def();
+								val.value(db::Binder::DataField{f, v, f->isDataLayout(), f->hasFlag(db::Flags::Compressed)});
 							}
+						} else {
+							val.def();
 						}
 					}
-
-					val = val.next();
 				}
 
-				auto &conflicts = worker.getConflicts();
-				for (auto &it : conflicts) {
-					if (it.second.isDoNothing()) {
-						val.onConflict(it.first->getName()).doNothing();
-					} else {
-						auto c = val.onConflict(it.first->getName()).doUpdate();
-						for (auto &iit : fields) {
-							auto f = scheme.getField(iit);
-							if (f && (it.second.mask.empty() || std::find(it.second.mask.begin(), it.second.mask.end(), f) != it.second.mask.end())) {
-								c.excluded(iit);
-							}
-						}
+				val = val.next();
+			}
 
-						if (it.second.hasCondition()) {
-							c.where().parenthesis(db::Operator::And, [&] (SqlQuery::WhereBegin &wh) {
-								SqlQuery::WhereContinue iw(wh.query, wh.state);
-								query.writeWhere(iw, db::Operator::And, worker.scheme(), it.second.condition);
-							});
+			auto &conflicts = worker.getConflicts();
+			for (auto &it : conflicts) {
+				if (it.second.isDoNothing()) {
+					val.onConflict(it.first->getName()).doNothing();
+				} else {
+					auto c = val.onConflict(it.first->getName()).doUpdate();
+					for (auto &iit : fields) {
+						auto f = scheme.getField(iit);
+						if (f && (it.second.mask.empty() || std::find(it.second.mask.begin(), it.second.mask.end(), f) != it.second.mask.end())) {
+							c.excluded(iit);
 						}
 					}
-				}
 
-				val.returning().field(SqlQuery::Field("__oid").as("id")).finalize();
-				selectQuery(query, [&] (Result &res) {
-					size_t i = 0;
-					for (auto it : res) {
-						ret.getValue(i).setInteger(it.toInteger(0), "__oid");
-						++ i;
+					if (it.second.hasCondition()) {
+						c.where().parenthesis(db::Operator::And, [&] (SqlQuery::WhereBegin &wh) {
+							SqlQuery::WhereContinue iw(wh.query, wh.state);
+							query.writeWhere(iw, db::Operator::And, worker.scheme(), it.second.condition);
+						});
 					}
+				}
+			}
+
+			val.returning().field(SqlQuery::Field("__oid").as("id")).finalize();
+			success = selectQuery(query, [&] (Result &res) {
+				if (!res.success()) {
+					return false;
+				}
+
+				size_t i = 0;
+				for (auto it : res) {
+					ret.getValue(i).setInteger(it.toInteger(0), "__oid");
+					++ i;
+				}
 
-					for (auto &iit : ret.asArray()) {
-						if (worker.shouldIncludeNone() && worker.scheme().hasForceExclude()) {
-							for (auto &it : worker.scheme().getFields()) {
-								if (it.second.hasFlag(db::Flags::ForceExclude)) {
-									iit.erase(it.second.getName());
-								}
+				for (auto &iit : ret.asArray()) {
+					if (worker.shouldIncludeNone() && worker.scheme().hasForceExclude()) {
+						for (auto &it : worker.scheme().getFields()) {
+							if (it.second.hasFlag(db::Flags::ForceExclude)) {
+								iit.erase(it.second.getName());
 							}
 						}
 					}
-					return true;
-				});
+				}
+				return true;
 			});
+		});
+
+		return success;
+	};
+
+	if (Handle_hasPostUpdate(idata, fields)) {
+		if (idata.isDictionary()) {
+			return perform(idata);
+		} else if (idata.isArray()) {
+			mem::Value ret;
+			bool bulk = false;
+			beginBatch();
+			if (worker.getConflicts().empty()) {
+				// with no conflict resolution every object gets it's row, so we can insert them all at once,
+				// then write relations for all objects in batch
+				mem::Value postUpdate;
+				ret = idata;
+				for (auto &it : ret.asArray()) {
+					postUpdate.addValue(Handle_preparePostUpdate(it, fields));
+				}
+
+				if (performBulk(ret)) {
+					makeQuery([&] (SqlQuery &query) {
+						size_t i = 0;
+						for (auto &it : ret.asArray()) {
+							auto id = it.getInteger("__oid");
+							if (id > 0) {
+								performPostUpdate(worker.transaction(), query, scheme, it, id, postUpdate.getValue(i), false);
+							}
+							++ i;
+						}
+					});
+					bulk = true;
+				}
+			}
 
+			if (!bulk) {
+				// multi-row insert is rejected as a whole, so, fall back to insert objects one by one:
+				// only rejected objects are skipped (for drivers with statement-level rollback, like SQLite)
+				ret = mem::Value();
+				for (auto &it : idata.asArray()) {
+					if (auto v = perform(it)) {
+						ret.addValue(std::move(v));
+					}
+				}
+			}
+			if (!endBatch()) {
+				return mem::Value();
+			}
 			return ret;
 		}
+	} else {
+		if (idata.isDictionary()) {
+			return perform(idata);
+		} else if (idata.isArray()) {
+			mem::Value ret(idata);
+			if (performBulk(ret)) {
+				return ret;
+			}
+		}
 	}
 	return mem::Value();
 }
@@ -336,7 +336,7 @@ bool SqlHandle::insertIntoSet(SqlQuery &query, const Scheme &s, int64_t id, cons
 					}
 				}
 				w.finalize();
-				return performQuery(query) != stappler::maxOf<size_t>();
+				return queueQuery(query);
 			}
 		} else {
 			// set to set is not implemented
@@ -349,7 +349,7 @@ bool SqlHandle::insertIntoArray(SqlQuery &query, const Scheme &scheme, int64_t i
 	if (d.isNull()) {
 		query.remove(mem::toString(scheme.getName(), "_f_", field.getName()))
 				.where(mem::toString(scheme.getName(), "_id"), Comparation::Equal, id).finalize();
-		return performQuery(query) != stappler::maxOf<size_t>();
+		return queueQuery(query);
 	} else {
 		if (field.transform(scheme, id, const_cast<mem::Value &>(d))) {
 			auto &arrf = static_cast<const db::FieldArray *>(field.getSlot())->tfield;
@@ -364,7 +364,7 @@ bool SqlHandle::insertIntoArray(SqlQuery &query, const Scheme &scheme, int64_t i
 				} else {
 					vals.onConflictDoNothing().finalize();
 				}
-				return performQuery(query) != stappler::maxOf<size_t>();
+				return queueQuery(query);
 			}
 		}
 	}
@@ -380,7 +380,7 @@ bool SqlHandle::insertIntoRefSet(SqlQuery &query, const Scheme &scheme, int64_t
 			vals.values(id, it);
 		}
 		vals.onConflictDoNothing().finalize();
-		performQuery(query);
+		queueQuery(query);
 		return true;
 	}
 	return false;
@@ -399,7 +399,7 @@ bool SqlHandle::cleanupRefSet(SqlQuery &query, const Scheme &scheme, uint64_t oi
 					whi.where(Operator::Or, mem::toString(fScheme->getName(), "_id"), Comparation::Equal, it);
 				}
 			}).finalize();
-			performQuery(query);
+			queueQuery(query);
 			return true;
 		} else if (objField->onRemove == db::RemovePolicy::StrongReference) {
 			auto w = query.remove(fScheme->getName()).where();
@@ -407,7 +407,7 @@ bool SqlHandle::cleanupRefSet(SqlQuery &query, const Scheme &scheme, uint64_t oi
 				w.where(Operator::Or, "__oid", Comparation::Equal, it);
 			}
 			w.finalize();
-			performQuery(query);
+			queueQuery(query);
 			return true;
 		}
 	}
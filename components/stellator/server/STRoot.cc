@@ -45,6 +45,16 @@ struct Root::Internal : mem::AllocBase {
 	bool shouldClose = false;
 	std::mutex mutex;
 
+	// "accept": "reuseport" - every worker owns SO_REUSEPORT listener
+	// "accept": "shared" (default) - all workers wait on single listener
+	bool reusePort = false;
+
+	// "epollExclusive": false - disable EPOLLEXCLUSIVE for listener events
+	bool epollExclusive = true;
+
+	// "ioBackend": "uring" - use io_uring event loop in workers, fallback to epoll if not available
+	bool useUring = false;
+
 	Internal() {
 		scheduled.reserve(128);
 		followed.reserve(16);
@@ -77,6 +87,24 @@ bool Root::run(const mem::Value &config) {
 		auto l = mem::StringView(config.getString("listen"));
 		auto w = config.getInteger("workers");
 
+		auto accept = mem::StringView(config.getString("accept"));
+		if (accept == "reuseport") {
+			_internal->reusePort = true;
+		} else if (!accept.empty() && accept != "shared") {
+			std::cout << "Invalid accept mode: " << accept << ", fallback to \"shared\"\n";
+		}
+
+		if (config.isBool("epollExclusive")) {
+			_internal->epollExclusive = config.getBool("epollExclusive");
+		}
+
+		auto backend = mem::StringView(config.getString("ioBackend"));
+		if (backend == "uring") {
+			_internal->useUring = true;
+		} else if (!backend.empty() && backend != "epoll") {
+			std::cout << "Invalid io backend: " << backend << ", fallback to \"epoll\"\n";
+		}
+
 		size_t workers = std::thread::hardware_concurrency();
 		if (w >= 2 && w <= 256) {
 			workers = size_t(w);
@@ -32,18 +32,26 @@ THE SOFTWARE.
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/eventfd.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <fcntl.h>
 
 #include "concurrentqueue.h"
 
+// should be included after concurrentqueue.h, linux/fs.h defines BLOCK_SIZE macro
+#include <linux/io_uring.h>
+
 namespace stellator {
 
 class ConnectionWorker;
+struct ConnectionUring;
 
 class ConnectionQueue : public mem::AllocBase {
 public:
-	ConnectionQueue(mem::pool_t *p, Root *h, int socket, size_t nWorkers = std::thread::hardware_concurrency());
+	// if sockets count is less then workers count, sockets will be shared between workers
+	// sockets are owned and closed by Root::run
+	ConnectionQueue(mem::pool_t *p, Root *h, const mem::Vector<int> &sockets, bool exclusive, bool uring,
+			size_t nWorkers = std::thread::hardware_concurrency());
 	~ConnectionQueue();
 
 	void run();
@@ -53,30 +61,38 @@ public:
 	void finalize();
 
 	void pushTask(Task *);
-	Task * popTask();
+	Task * popTask(ConnectionWorker *);
 	void releaseTask(Task *);
 
 	bool hasTasks();
 
-	size_t getWorkersCount() const { return _workers.size(); }
+	// wake first idle worker, starting from worker with specified index
+	bool wakeup(size_t);
+
+	size_t getWorkersCount() const { return _workersCount.load(); }
 
 protected:
 	size_t _nWorkers = std::thread::hardware_concurrency();
 	std::atomic<bool> _finalized;
 	std::atomic<int32_t> _refCount;
 
+	// workers vector is reserved before threads started, _workersCount publishes
+	// workers, that available for stealing
 	mem::Vector<ConnectionWorker *> _workers;
+	std::atomic<size_t> _workersCount;
 	mem::pool_t *_pool = nullptr;
 	Root *_root = nullptr;
 
 	std::atomic<size_t> _taskCounter;
-	// moodycamel::ConcurrentQueue<Task *> _taskQueue;
-	std::deque<Task *> _taskDeque;
-	std::mutex _taskMutex;
+	std::atomic<size_t> _nextWorker;
+
+	// tasks from non-worker threads (root thread, external threads)
+	moodycamel::ConcurrentQueue<Task *> _taskQueue;
 
 	int _pipe[2] = { -1, -1 };
-	int _eventFd = -1;
-	int _socket = -1;
+	mem::Vector<int> _sockets;
+	bool _exclusive = true;
+	bool _uring = false;
 	mem::Time _start = mem::Time::now();
 };
 
@@ -88,7 +104,8 @@ public:
 
 	struct Buffer : mem::AllocBase {
 		Buffer *next = nullptr;
-	    mem::pool_t *pool = nullptr;
+	    mem::pool_t *pool = nullptr; // for buffers, allocated from pool
+		ConnectionWorker *worker = nullptr; // for buffers from worker's slab
 
 		uint8_t *buf = nullptr;
 		size_t size = 0;
@@ -108,13 +125,19 @@ public:
 		Buffer **input = nullptr;
 
 		Buffer *outputFront = nullptr;
-		Buffer **outputTail = nullptr;
+		Buffer **outputTail = &outputFront;
 
 	    mem::pool_t *pool = nullptr;
 
 		int fd = -1;
 	    struct epoll_event event;
 
+		// io_uring backend state: operations in flight, that reference this client
+		uint32_t inflight = 0;
+		bool closing = false;
+		bool writePending = false;
+		struct iovec *iov = nullptr;
+
 		Client(Generation *);
 		Client();
 
@@ -124,8 +147,17 @@ public:
 		void performRead();
 		void performWrite();
 
-		void readBuffer(const uint8_t *, size_t);
+		// takes ownership of buffer
+		void readBuffer(Buffer *);
+
 		void writeBuffer(const uint8_t *, size_t);
+
+		// takes ownership of buffer
+		void writeBuffer(Buffer *);
+
+		void pushOutput(Buffer *);
+		void consumeOutput(size_t);
+		void releaseOutput();
 	};
 
 	struct Generation : mem::AllocBase {
@@ -136,22 +168,42 @@ public:
 		size_t activeClients = 0;
 
 		mem::pool_t *pool = nullptr;
+		ConnectionWorker *worker = nullptr;
 		bool endOfLife = false;
 
-		Generation(mem::pool_t *);
+		Generation(mem::pool_t *, ConnectionWorker *);
 
 		Client *pushFd(int);
 		void releaseClient(Client *);
 		void releaseAll();
+
+		// return released client into empty list, when there is no io_uring operations for it
+		void recycleClient(Client *);
 	};
 
 	static constexpr size_t MaxEvents = 64;
 
-	ConnectionWorker(ConnectionQueue *queue, Root *, int socket, int pipe, int event);
+	// max buffers in single writev call
+	static constexpr size_t MaxIovecs = 64;
+
+	// input and output chunks are allocated from per-worker slab with fixed size blocks
+	static constexpr size_t SlabBufferSize = 16_KiB;
+	static constexpr size_t MaxFreeSlabBuffers = 256;
+
+	static constexpr unsigned UringEntries = 256;
+	static constexpr unsigned UringBuffers = 64; // should be power of 2
+
+	// max tasks, performed between epoll_wait calls
+	static constexpr size_t MaxTasksPerIteration = 16;
+
+	static ConnectionWorker *getCurrent();
+
+	ConnectionWorker(ConnectionQueue *queue, Root *, size_t index, int socket, int pipe, bool exclusive, bool uring);
 	~ConnectionWorker();
 
 	bool worker();
 	bool poll(int);
+	bool pollUring();
 
 	void initializeThread();
 	void finalizeThread();
@@ -160,21 +212,59 @@ public:
 
 	void runTask(Task *);
 
+	// returns true if more tasks can be available
+	bool runPendingTasks();
+
+	// returns true if worker was idle and event was sent
+	bool wakeup();
+
+	// acquire empty buffer from worker's slab, only in worker thread
+	Buffer *acquireBuffer();
+	void releaseBuffer(Buffer *);
+
+	bool isUring() const { return _uring != nullptr; }
+	void submitUringWrite(Client *);
+
+	size_t getIndex() const { return _index; }
+	moodycamel::ConcurrentQueue<Task *> &getTaskQueue() { return _taskQueue; }
+
 protected:
 	Generation *makeGeneration();
 	void pushFd(int epollFd, int fd);
 
+	bool initUring();
+	void releaseUring();
+	void armUringAccept();
+	void armUringAcceptRetry();
+	void armUringEvent();
+	void armUringRecv(Client *);
+	void onUringCompletion(uint64_t data, int32_t res, uint32_t flags, bool &shouldClose);
+
 	void onError(const mem::StringView &);
 
 	ConnectionQueue *_queue;
 	std::thread::id _threadId;
 
 	Root *_root = nullptr;
+	size_t _index = 0;
 
 	int _inputFd = -1;
 	int _cancelFd = -1;
 	int _eventFd = -1;
 	size_t _fdCount = 0;
+	bool _exclusive = true;
+	bool _useUring = false;
+
+	ConnectionUring *_uring = nullptr;
+	uint64_t _eventValue = 0;
+
+	// worker-local task queue, other workers can steal from it
+	moodycamel::ConcurrentQueue<Task *> _taskQueue;
+	std::atomic<bool> _idle;
+
+	mem::pool_t *_slabPool = nullptr;
+	Buffer *_freeBuffers = nullptr;
+	size_t _freeBuffersCount = 0;
 
 	Generation *_generation = nullptr;
 
@@ -216,6 +306,8 @@ static mem::StringView s_getSignalName(int sig) {
 	return mem::StringView();
 }
 
+static thread_local ConnectionWorker *tl_worker = nullptr;
+
 static void s_ConnectionWorker_workerThread(ConnectionWorker *tm) {
 	sigset_t mask;
 	sigemptyset(&mask);
@@ -246,10 +338,11 @@ static bool ConnectionHandler_setNonblocking(int fd) {
 	return true;
 }
 
-ConnectionQueue::ConnectionQueue(mem::pool_t *p, Root *h, int socket, size_t nWorker)
-: _nWorkers(nWorker), _finalized(false), _refCount(1), _pool(p), _root(h), _socket(socket) {
-	_eventFd = eventfd(0, EFD_NONBLOCK);
+ConnectionQueue::ConnectionQueue(mem::pool_t *p, Root *h, const mem::Vector<int> &sockets, bool exclusive, bool uring, size_t nWorker)
+: _nWorkers(nWorker), _finalized(false), _refCount(1), _workersCount(0), _pool(p), _root(h)
+, _sockets(sockets), _exclusive(exclusive), _uring(uring) {
 	_taskCounter.store(0);
+	_nextWorker.store(0);
 }
 
 void ConnectionQueue::run() {
@@ -260,8 +353,10 @@ void ConnectionQueue::run() {
 		ConnectionHandler_setNonblocking(_pipe[1]);
 
 		for (uint32_t i = 0; i < _nWorkers; i++) {
-			ConnectionWorker *worker = new (_pool) ConnectionWorker(this, _root, _socket, _pipe[0], _eventFd);
+			auto socket = _sockets.empty() ? -1 : _sockets[i % _sockets.size()];
+			ConnectionWorker *worker = new (_pool) ConnectionWorker(this, _root, i, socket, _pipe[0], _exclusive, _uring);
 			_workers.push_back(worker);
+			++ _workersCount;
 		}
 	}
 
@@ -272,7 +367,6 @@ ConnectionQueue::~ConnectionQueue() {
 	std::cout << "Cancel (with " << (mem::Time::now() - _start).toMicros() << "mks)\n";
 	if (_pipe[0] > -1) { close(_pipe[0]); }
 	if (_pipe[1] > -1) { close(_pipe[1]); }
-	if (_eventFd > -1) { close(_eventFd); }
 }
 
 void ConnectionQueue::retain() {
@@ -289,13 +383,20 @@ void ConnectionQueue::finalize() {
 	_finalized = true;
 	write(_pipe[1], "END!", 4);
 
+	// workers steal tasks from siblings until they are stopped, so, no worker can be
+	// deleted before all of them are joined
 	for (auto &it : _workers) {
 		if (it->thread().joinable()) {
 			it->thread().join();
-			delete it;
 		}
 	}
 
+	_workersCount = 0;
+	for (auto &it : _workers) {
+		delete it;
+	}
+	_workers.clear();
+
 	release();
 }
 
@@ -303,26 +404,43 @@ void ConnectionQueue::pushTask(Task *task) {
 	if (auto g = task->getGroup()) {
 		g->onAdded(task);
 	}
-	uint64_t value = 1;
-	_taskMutex.lock();
-	_taskDeque.push_back(task);
-	_taskMutex.unlock();
 	++ _taskCounter;
-	write(_eventFd, &value, sizeof(uint64_t));
+
+	// pairs with the fence in ConnectionWorker::poll: either the worker sees the task
+	// on its queue recheck, or we see its idle flag and wake it
+	if (auto w = ConnectionWorker::getCurrent()) {
+		// worker pushes into own queue; worker itself is busy now, so,
+		// wake other idle worker to steal the task
+		w->getTaskQueue().enqueue(task);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		wakeup(w->getIndex() + 1);
+	} else {
+		_taskQueue.enqueue(task);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		wakeup(_nextWorker.fetch_add(1));
+	}
 }
 
-Task * ConnectionQueue::popTask() {
+Task * ConnectionQueue::popTask(ConnectionWorker *w) {
 	Task *t = nullptr;
 
-	_taskMutex.lock();
-	t = _taskDeque.front();
-	_taskDeque.pop_front();
-	_taskMutex.unlock();
+	// own queue first, then shared queue, then try to steal from other workers
+	if (w->getTaskQueue().try_dequeue(t)) {
+		return t;
+	}
 
-	/*if (_taskQueue.try_dequeue(t)) {
+	if (_taskQueue.try_dequeue(t)) {
 		return t;
-	}*/
-	return t;
+	}
+
+	auto count = _workersCount.load();
+	for (size_t i = 1; i < count; ++ i) {
+		if (_workers[(w->getIndex() + i) % count]->getTaskQueue().try_dequeue(t)) {
+			return t;
+		}
+	}
+
+	return nullptr;
 }
 
 void ConnectionQueue::releaseTask(Task *task) {
@@ -338,24 +456,42 @@ bool ConnectionQueue::hasTasks() {
 	return _taskCounter.load();
 }
 
-ConnectionWorker::ConnectionWorker(ConnectionQueue *queue, Root *h, int socket, int pipe, int event)
-: _queue(queue), _root(h), _inputFd(socket), _cancelFd(pipe), _eventFd(event), _thread(s_ConnectionWorker_workerThread, this) {
+bool ConnectionQueue::wakeup(size_t idx) {
+	auto count = _workersCount.load();
+	for (size_t i = 0; i < count; ++ i) {
+		if (_workers[(idx + i) % count]->wakeup()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+ConnectionWorker *ConnectionWorker::getCurrent() {
+	return tl_worker;
+}
+
+ConnectionWorker::ConnectionWorker(ConnectionQueue *queue, Root *h, size_t index, int socket, int pipe, bool exclusive, bool uring)
+: _queue(queue), _root(h), _index(index), _inputFd(socket), _cancelFd(pipe), _eventFd(eventfd(0, EFD_NONBLOCK))
+, _exclusive(exclusive), _useUring(uring), _idle(false), _thread(s_ConnectionWorker_workerThread, this) {
 	_queue->retain();
 }
 
 ConnectionWorker::~ConnectionWorker() {
+	if (_eventFd > -1) { close(_eventFd); }
 	_queue->release();
 }
 
 void ConnectionWorker::initializeThread() {
 	_threadId = std::this_thread::get_id();
+	_slabPool = mem::pool::acquire();
+	tl_worker = this;
 }
 
 bool ConnectionWorker::worker() {
 	Client sockEvent;
 	sockEvent.fd = _inputFd;
 	sockEvent.event.data.ptr = &sockEvent;
-	sockEvent.event.events = EPOLLIN | EPOLLEXCLUSIVE;
+	sockEvent.event.events = _exclusive ? (EPOLLIN | EPOLLEXCLUSIVE) : EPOLLIN;
 
 	Client pipeEvent;
 	pipeEvent.fd = _cancelFd;
@@ -365,7 +501,7 @@ bool ConnectionWorker::worker() {
 	Client eventEvent;
 	eventEvent.fd = _eventFd;
 	eventEvent.event.data.ptr = &eventEvent;
-	eventEvent.event.events = EPOLLIN | EPOLLET | EPOLLEXCLUSIVE;
+	eventEvent.event.events = EPOLLIN | EPOLLET;
 
 	sigset_t sigset;
 	sigfillset(&sigset);
@@ -373,6 +509,32 @@ bool ConnectionWorker::worker() {
 	int signalFd = ::signalfd(-1, &sigset, 0);
 	ConnectionHandler_setNonblocking(signalFd);
 
+	auto readSignals = [&] {
+		struct signalfd_siginfo si;
+		int nr = ::read(signalFd, &si, sizeof si);
+		while (nr == sizeof si) {
+			if (si.ssi_signo != SIGINT) {
+				onError(mem::toString("epoll_wait() exit with signal: ", si.ssi_signo, " ", s_getSignalName(si.ssi_signo)));
+			}
+			nr = ::read(signalFd, &si, sizeof si);
+		}
+	};
+
+	if (_useUring) {
+		initializeThread();
+		if (initUring()) {
+			while (pollUring()) {
+				readSignals();
+			}
+			finalizeThread();
+			releaseUring();
+			close(signalFd);
+			return true;
+		} else {
+			onError("io_uring is not available, fallback to epoll");
+		}
+	}
+
 	int epollFd = epoll_create1(0);
 
 	int err = 0;
@@ -402,14 +564,7 @@ bool ConnectionWorker::worker() {
 
 	initializeThread();
 	while (poll(epollFd)) {
-		struct signalfd_siginfo si;
-		int nr = ::read(signalFd, &si, sizeof si);
-		while (nr == sizeof si) {
-			if (si.ssi_signo != SIGINT) {
-				onError(mem::toString("epoll_wait() exit with signal: ", si.ssi_signo, " ", s_getSignalName(si.ssi_signo)));
-			}
-			nr = ::read(signalFd, &si, sizeof si);
-		}
+		readSignals();
 	}
 	finalizeThread();
 
@@ -424,36 +579,32 @@ bool ConnectionWorker::poll(int epollFd) {
 	std::array<struct epoll_event, ConnectionWorker::MaxEvents> _events;
 
 	while (!_shouldClose) {
-		int nevents = epoll_wait(epollFd, _events.data(), ConnectionWorker::MaxEvents, -1);
-		if (nevents == -1 && errno != EINTR) {
-			char buf[256] = { 0 };
-			onError(mem::toString("epoll_wait() failed with errno ", errno, " (", strerror_r(errno, buf, 255), ")"));
-			return false;
-		} else if (errno == EINTR) {
-			return true;
+		int timeout = -1;
+		if (runPendingTasks()) {
+			// do not sleep, if there are some tasks left
+			timeout = 0;
+		} else {
+			// mark worker as idle, then recheck queues: task, pushed after last check
+			// will see idle flag and wake us with eventfd (see ConnectionQueue::pushTask)
+			_idle.store(true);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (auto task = _queue->popTask(this)) {
+				_idle.store(false);
+				runTask(task);
+				timeout = 0;
+			}
 		}
 
-		/// process high-priority events
-		for (int i = 0; i < nevents; i++) {
-			Client *client = (Client *)_events[i].data.ptr;
+		int nevents = epoll_wait(epollFd, _events.data(), ConnectionWorker::MaxEvents, timeout);
+		_idle.store(false);
 
-			if ((_events[i].events & EPOLLIN)) {
-				if (client->fd == _eventFd) {
-					uint64_t value = 0;
-					auto sz = read(_eventFd, &value, sizeof(uint64_t));
-					if (sz == 8 && value) {
-						auto ev = _queue->popTask();
-						if (value > 1) {
-							value -= 1;
-							// forward event to another worker
-							write(_eventFd, &value, sizeof(uint64_t));
-						}
-						if (ev) {
-							runTask(ev);
-						}
-					}
-				}
+		if (nevents == -1) {
+			if (errno != EINTR) {
+				char buf[256] = { 0 };
+				onError(mem::toString("epoll_wait() failed with errno ", errno, " (", strerror_r(errno, buf, 255), ")"));
+				return false;
 			}
+			return true;
 		}
 
 		for (int i = 0; i < nevents; i++) {
@@ -493,7 +644,9 @@ bool ConnectionWorker::poll(int epollFd) {
 					//onError("Received end signal");
 					_shouldClose = true;
 				} else if (client->fd == _eventFd) {
-					// do nothing
+					// reset wakeup counter, tasks will be processed on next iteration
+					uint64_t value = 0;
+					while (read(_eventFd, &value, sizeof(uint64_t)) == sizeof(uint64_t)) { }
 				} else {
 					client->performRead();
 				}
@@ -515,7 +668,7 @@ bool ConnectionWorker::poll(int epollFd) {
 		auto gen = _generation;
 		while (gen) {
 			gen->releaseAll();
-			gen = _generation->prev;
+			gen = gen->prev;
 		}
 	}
 
@@ -534,6 +687,56 @@ void ConnectionWorker::runTask(Task *task) {
 	}, serv);
 }
 
+bool ConnectionWorker::runPendingTasks() {
+	for (size_t i = 0; i < MaxTasksPerIteration; ++ i) {
+		if (auto task = _queue->popTask(this)) {
+			runTask(task);
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+ConnectionWorker::Buffer *ConnectionWorker::acquireBuffer() {
+	Buffer *ret = nullptr;
+	if (_freeBuffers) {
+		ret = _freeBuffers;
+		_freeBuffers = ret->next;
+		-- _freeBuffersCount;
+	} else {
+		auto block = mem::pool::palloc(_slabPool, sizeof(Buffer) + SlabBufferSize);
+		ret = new (block) Buffer();
+		ret->worker = this;
+		ret->buf = (uint8_t *)block + sizeof(Buffer);
+		ret->capacity = SlabBufferSize;
+	}
+
+	ret->next = nullptr;
+	ret->size = 0;
+	ret->offset = 0;
+	return ret;
+}
+
+void ConnectionWorker::releaseBuffer(Buffer *buf) {
+	if (_freeBuffersCount < MaxFreeSlabBuffers) {
+		buf->next = _freeBuffers;
+		_freeBuffers = buf;
+		++ _freeBuffersCount;
+	} else {
+		mem::pool::free(_slabPool, buf, sizeof(Buffer) + SlabBufferSize);
+	}
+}
+
+bool ConnectionWorker::wakeup() {
+	if (_idle.exchange(false)) {
+		uint64_t value = 1;
+		write(_eventFd, &value, sizeof(uint64_t));
+		return true;
+	}
+	return false;
+}
+
 void ConnectionWorker::pushFd(int epollFd, int fd) {
 	if (!_generation) {
 		_generation = makeGeneration();
@@ -555,7 +758,7 @@ void ConnectionWorker::onError(const mem::StringView &str) {
 
 
 ConnectionWorker::Buffer *ConnectionWorker::Buffer::create(mem::pool_t *p, const uint8_t *buf, size_t size) {
-	auto msize = std::min(size_t(256), sizeof(Buffer) + size + 4) ;
+	auto msize = std::max(size_t(256), sizeof(Buffer) + size);
 	auto block = mem::pool::alloc(p, msize);
 
 	auto b = new (block) Buffer();
@@ -572,7 +775,11 @@ ConnectionWorker::Buffer *ConnectionWorker::Buffer::create(mem::pool_t *p, const
 }
 
 void ConnectionWorker::Buffer::release() {
-	mem::pool::free(pool, this, capacity + sizeof(this));
+	if (worker) {
+		worker->releaseBuffer(this);
+	} else {
+		mem::pool::free(pool, this, capacity + sizeof(Buffer));
+	}
 }
 
 ConnectionWorker::Client::Client(Generation *g) : gen(g) { }
@@ -585,22 +792,37 @@ void ConnectionWorker::Client::init(int ifd) {
 	event.data.ptr = this;
 	event.events = EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP;
 	fd = ifd;
+	pool = gen->pool;
+	outputFront = nullptr;
+	outputTail = &outputFront;
+	inflight = 0;
+	closing = false;
+	writePending = false;
 
 	ConnectionHandler_setNonblocking(fd);
 }
 
 void ConnectionWorker::Client::release() {
-	close(event.data.fd);
+	if (inflight > 0) {
+		// terminate pending io_uring operations, output will be released when they are finished
+		shutdown(fd, SHUT_RDWR);
+	} else {
+		releaseOutput();
+	}
+	close(fd);
 }
 
 void ConnectionWorker::Client::performRead() {
-	uint8_t buf[8_KiB] = { 0 };
-
-	auto sz = ::read(fd, buf, 8_KiB);
+	auto b = gen->worker->acquireBuffer();
+	auto sz = ::read(fd, b->buf, b->capacity);
 	while (sz > 0) {
-		readBuffer(buf, sz);
-		sz = ::read(fd, buf, 8_KiB);
+		b->size = sz;
+		readBuffer(b);
+
+		b = gen->worker->acquireBuffer();
+		sz = ::read(fd, b->buf, b->capacity);
 	}
+	gen->worker->releaseBuffer(b);
 
 	if (sz == 0) {
 		//gen->releaseClient(this);
@@ -612,68 +834,116 @@ void ConnectionWorker::Client::performRead() {
 }
 
 void ConnectionWorker::Client::performWrite() {
-	if (!outputFront) {
+	if (gen->worker->isUring()) {
+		gen->worker->submitUringWrite(this);
 		return;
 	}
 
 	while (outputFront) {
-		auto size = outputFront->size - outputFront->offset;
-		auto ret = write(fd, outputFront->buf + outputFront->offset, size);
-		while (ret > 0) {
-			if (ret != int(size)) {
-				size = outputFront->size - outputFront->offset;
-				ret = write(fd, outputFront->buf + outputFront->offset, size);
-			} else {
-				ret = 0;
-			}
+		// flush output chain with single writev
+		std::array<struct iovec, MaxIovecs> iov;
+		size_t niov = 0;
+		auto b = outputFront;
+		while (b && niov < MaxIovecs) {
+			iov[niov].iov_base = b->buf + b->offset;
+			iov[niov].iov_len = b->size - b->offset;
+			++ niov;
+			b = b->next;
 		}
 
-		if (ret == 0) {
-			auto f = outputFront;
-			outputFront = outputFront->next;
-			if (&f->next == outputTail) {
-				outputTail = nullptr;
-			}
-			f->release();
-		} else if (ret == -1) {
+		auto ret = ::writev(fd, iov.data(), niov);
+		if (ret > 0) {
+			consumeOutput(ret);
+		} else if (ret == -1 && errno == EAGAIN) {
 			return; // not available space to write
+		} else {
+			char buf[256] = { 0 };
+			std::cout << "[Worker] fail to write to client: " << strerror_r(errno, buf, 255) << "\n";
+			releaseOutput();
+			return;
 		}
 	}
 }
 
-void ConnectionWorker::Client::readBuffer(const uint8_t *buf, size_t size) {
-	mem::StringView r((const char *)buf, size);
-	std::cout << r << "\n";
-	writeBuffer(buf, size);
+void ConnectionWorker::Client::readBuffer(Buffer *buf) {
+	// echo input without copying
+	writeBuffer(buf);
 }
 
 void ConnectionWorker::Client::writeBuffer(const uint8_t *buf, size_t size) {
-	if (outputFront) {
-		*outputTail = Buffer::create(pool, buf, size);
-		outputTail = &((*outputTail)->next);
-	} else {
-		auto ret = write(fd, buf, size);
-		while (ret > 0) {
-			if (ret != int(size)) {
-				buf += ret; size -= ret;
-				ret = write(fd, buf, size);
-			} else {
-				ret = 0;
-			}
+	if (!outputFront && !gen->worker->isUring()) {
+		auto ret = ::write(fd, buf, size);
+		while (ret > 0 && size_t(ret) != size) {
+			buf += ret; size -= ret;
+			ret = ::write(fd, buf, size);
 		}
 
-		if (ret == -1) {
-			if (errno != EAGAIN) {
-				std::cout << "[Worker] fail to write to client\n";
-			} else {
-				outputFront = Buffer::create(pool, buf, size);
-				outputTail = &outputFront->next;
+		if (ret > 0) {
+			return;
+		} else if (ret == -1 && errno != EAGAIN) {
+			std::cout << "[Worker] fail to write to client\n";
+			return;
+		}
+	}
+
+	// copy rest of data into slab buffers
+	bool flush = !outputFront;
+	while (size > 0) {
+		auto b = gen->worker->acquireBuffer();
+		b->size = std::min(size, b->capacity);
+		memcpy(b->buf, buf, b->size);
+		buf += b->size; size -= b->size;
+		pushOutput(b);
+	}
+
+	if (flush && gen->worker->isUring()) {
+		performWrite();
+	}
+}
+
+void ConnectionWorker::Client::writeBuffer(Buffer *b) {
+	if (!outputFront) {
+		pushOutput(b);
+		performWrite();
+	} else {
+		pushOutput(b);
+	}
+}
+
+void ConnectionWorker::Client::pushOutput(Buffer *b) {
+	b->next = nullptr;
+	*outputTail = b;
+	outputTail = &b->next;
+}
+
+void ConnectionWorker::Client::consumeOutput(size_t size) {
+	while (outputFront && size > 0) {
+		auto available = outputFront->size - outputFront->offset;
+		if (size >= available) {
+			size -= available;
+			auto f = outputFront;
+			outputFront = f->next;
+			if (!outputFront) {
+				outputTail = &outputFront;
 			}
+			f->release();
+		} else {
+			outputFront->offset += size;
+			size = 0;
 		}
 	}
 }
 
-ConnectionWorker::Generation::Generation(mem::pool_t *p) : pool(p) {
+void ConnectionWorker::Client::releaseOutput() {
+	while (outputFront) {
+		auto f = outputFront;
+		outputFront = f->next;
+		f->release();
+	}
+	outputTail = &outputFront;
+}
+
+ConnectionWorker::Generation::Generation(mem::pool_t *p, ConnectionWorker *w) : pool(p), worker(w) {
 
 }
 
@@ -701,6 +971,10 @@ ConnectionWorker::Client *ConnectionWorker::Generation::pushFd(int fd) {
 }
 
 void ConnectionWorker::Generation::releaseClient(Client *client) {
+	if (client->closing) {
+		return; // already released, waiting for io_uring operations
+	}
+
 	client->release();
 
 	if (client == active) {
@@ -711,12 +985,25 @@ void ConnectionWorker::Generation::releaseClient(Client *client) {
 		if (client->next) { client->next->prev = client->prev; }
 	}
 
+	-- activeClients;
+
+	if (client->inflight > 0) {
+		client->closing = true;
+		client->next = client->prev = nullptr;
+		return;
+	}
+
+	recycleClient(client);
+}
+
+void ConnectionWorker::Generation::recycleClient(Client *client) {
+	client->releaseOutput();
+	client->closing = false;
+
 	client->next = empty;
 	client->prev = nullptr;
 	if (empty) { empty->prev = client; }
 	empty = client;
-
-	-- activeClients;
 }
 
 void ConnectionWorker::Generation::releaseAll() {
@@ -727,7 +1014,53 @@ void ConnectionWorker::Generation::releaseAll() {
 
 ConnectionWorker::Generation *ConnectionWorker::makeGeneration() {
 	auto p = mem::pool::create(mem::pool::acquire());
-	return new (p) Generation(p);
+	return new (p) Generation(p, this);
+}
+
+static int Root_openListenSocket(mem::StringView _addr, int _port, bool reusePort) {
+	int socket = ::socket(AF_INET, SOCK_STREAM, 0);
+	if (socket == -1) {
+		messages::error("Root:Socket", "Fail to open socket");
+		return -1;
+	}
+
+	int enable = 1;
+	if (setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) == -1) {
+		messages::error("Root:Socket", "Fail to set socket option");
+		close(socket);
+		return -1;
+	}
+
+	if (reusePort && setsockopt(socket, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) == -1) {
+		messages::error("Root:Socket", "Fail to set SO_REUSEPORT socket option");
+		close(socket);
+		return -1;
+	}
+
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = !_addr.empty() ? inet_addr(_addr.str<mem::Interface>().data()) : htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(_port);
+	if (::bind(socket, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		messages::error("Root:Socket", "Fail to bind socket");
+		close(socket);
+		return -1;
+	}
+
+	if (!ConnectionHandler_setNonblocking(socket)) {
+		messages::error("Root:Socket", "Fail to set socket nonblock");
+		close(socket);
+		return -1;
+	}
+
+	if (::listen(socket, SOMAXCONN) < 0) {
+		messages::error("Root:Socket", "Fail to listen on socket");
+		close(socket);
+		return -1;
+	}
+
+	return socket;
 }
 
 bool Root::run(mem::StringView _addr, int _port, size_t nWorkers) {
@@ -751,49 +1084,26 @@ bool Root::run(mem::StringView _addr, int _port, size_t nWorkers) {
 	sigaddset(&mask, SIGPIPE);
 	::sigprocmask(SIG_BLOCK, &mask, &oldmask);
 
-	int socket = -1;
+	mem::Vector<int> sockets;
 	if (_addr != "none") {
-		int socket = ::socket(AF_INET, SOCK_STREAM, 0);
-		if (socket == -1) {
-			messages::error("Root:Socket", "Fail to open socket");
-			return false;
-		}
-
-		int enable = 1;
-		if (setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) == -1) {
-			messages::error("Root:Socket", "Fail to set socket option");
-			close(socket);
-			return false;
-		}
-
-		struct sockaddr_in addr;
-		memset(&addr, 0, sizeof(addr));
-		addr.sin_family = AF_INET;
-		addr.sin_addr.s_addr = !_addr.empty() ? inet_addr(_addr.data()) : htonl(INADDR_LOOPBACK);
-		addr.sin_port = htons(_port);
-		if (::bind(socket, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
-			messages::error("Root:Socket", "Fail to bind socket");
-			close(socket);
-			return false;
-		}
-
-		if (!ConnectionHandler_setNonblocking(socket)) {
-			messages::error("Root:Socket", "Fail to set socket nonblock");
-			close(socket);
-			return false;
-		}
-
-		if (::listen(socket, SOMAXCONN) < 0) {
-			messages::error("Root:Socket", "Fail to listen on socket");
-			close(socket);
-			return false;
+		// with SO_REUSEPORT every worker owns its own listener, kernel balances connections between them
+		auto nSockets = _internal->reusePort ? nWorkers : 1;
+		for (size_t i = 0; i < nSockets; ++ i) {
+			auto socket = Root_openListenSocket(_addr, _port, _internal->reusePort);
+			if (socket < 0) {
+				for (auto &it : sockets) {
+					close(it);
+				}
+				return false;
+			}
+			sockets.emplace_back(socket);
 		}
 	}
 
 	auto p = mem::pool::create(_pool);
 	auto ret = mem::perform([&] () -> bool {
 		_internal->isRunned = true;
-		_internal->queue = new (p) ConnectionQueue(p, this, socket, nWorkers);
+		_internal->queue = new (p) ConnectionQueue(p, this, sockets, _internal->epollExclusive, _internal->useUring, nWorkers);
 
 		onChildInit();
 
@@ -850,7 +1160,9 @@ bool Root::run(mem::StringView _addr, int _port, size_t nWorkers) {
 
 	mem::pool::destroy(p);
 
-	close(socket);
+	for (auto &it : sockets) {
+		close(it);
+	}
 
 	sigaction(SIGUSR1, &s_sharedSigOldUsr1Action, nullptr);
 	sigaction(SIGUSR2, &s_sharedSigOldUsr2Action, nullptr);
@@ -0,0 +1,593 @@
+/**
+Copyright (c) 2019 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+// io_uring event backend for ConnectionWorker, included into STCore.scu.cpp after STRootWorker.cc
+//
+// Ring is driven with raw syscalls, no liburing required. Backend uses multishot accept,
+// multishot recv with provided buffer ring, writev for output and eventfd read for task wakeups.
+// If kernel does not support something from this list, worker falls back to epoll.
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <poll.h>
+
+namespace stellator {
+
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_ACCEPT_MULTISHOT)
+
+struct ConnectionUring : mem::AllocBase {
+	// user_data is client pointer with operation in lower bits (Client is at least 8-byte aligned)
+	enum Op : uint64_t {
+		None,
+		Accept,
+		Recv,
+		Write,
+		Event,
+		Cancel,
+		AcceptRetry,
+		OpMask = 7
+	};
+
+	static constexpr uint16_t BufferGroup = 0;
+
+	// delay before accept is rearmed, when process is out of descriptors or memory
+	static constexpr long AcceptRetryNanos = 100'000'000;
+
+	static uint64_t makeData(void *ptr, Op op) { return uint64_t(uintptr_t(ptr)) | op; }
+	static Op getOp(uint64_t data) { return Op(data & OpMask); }
+	static void *getPtr(uint64_t data) { return (void *)uintptr_t(data & ~uint64_t(OpMask)); }
+
+	bool init(unsigned entries, unsigned nBuffers, size_t bufferSize);
+	void release();
+
+	bool isSupported(uint8_t op) const;
+
+	// returns nullptr only if ring is full and submit failed
+	struct io_uring_sqe *getSqe();
+
+	// submit pending SQEs and optionally wait for completions, returns -errno on failure
+	int submit(unsigned waitNr);
+
+	template <typename Callback>
+	unsigned forEachCqe(const Callback &);
+
+	uint8_t *getBuffer(uint16_t bid) const { return bufData + bid * bufSize; }
+	void recycleBuffer(uint16_t bid);
+
+	// do not use io_uring_buf_ring::bufs in C++: __DECLARE_FLEX_ARRAY adds empty struct before array,
+	// that shifts it by 8 bytes from the layout, expected by kernel
+	struct io_uring_buf *getRingBuf(unsigned idx) const { return ((struct io_uring_buf *)bufRing) + idx; }
+
+	int fd = -1;
+
+	unsigned *sqHead = nullptr;
+	unsigned *sqTail = nullptr;
+	unsigned *sqMask = nullptr;
+	unsigned *sqArray = nullptr;
+	unsigned sqEntries = 0;
+	unsigned sqLocalTail = 0;
+	unsigned pending = 0;
+	struct io_uring_sqe *sqes = nullptr;
+
+	unsigned *cqHead = nullptr;
+	unsigned *cqTail = nullptr;
+	unsigned *cqMask = nullptr;
+	struct io_uring_cqe *cqes = nullptr;
+
+	void *sqPtr = MAP_FAILED;
+	void *cqPtr = MAP_FAILED;
+	size_t sqSize = 0;
+	size_t cqSize = 0;
+	size_t sqesSize = 0;
+
+	struct io_uring_buf_ring *bufRing = nullptr;
+	uint8_t *bufData = nullptr;
+	unsigned bufEntries = 0;
+	size_t bufSize = 0;
+	size_t bufRingSize = 0;
+
+	struct __kernel_timespec acceptRetry;
+};
+
+bool ConnectionUring::init(unsigned entries, unsigned nBuffers, size_t bufferSize) {
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	fd = int(syscall(__NR_io_uring_setup, entries, &params));
+	if (fd < 0) {
+		return false;
+	}
+
+	// multishot recv has no opcode or feature bit, it was added in 6.0 together with
+	// IORING_OP_SEND_ZC, so, this opcode is used to detect it
+	if (!isSupported(IORING_OP_SEND_ZC)) {
+		release();
+		return false;
+	}
+
+	sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		sqSize = cqSize = std::max(sqSize, cqSize);
+	}
+
+	sqPtr = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (sqPtr == MAP_FAILED) {
+		release();
+		return false;
+	}
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		cqPtr = sqPtr;
+	} else {
+		cqPtr = mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if (cqPtr == MAP_FAILED) {
+			release();
+			return false;
+		}
+	}
+
+	sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+	sqes = (struct io_uring_sqe *)mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		sqes = nullptr;
+		release();
+		return false;
+	}
+
+	sqHead = (unsigned *)((uint8_t *)sqPtr + params.sq_off.head);
+	sqTail = (unsigned *)((uint8_t *)sqPtr + params.sq_off.tail);
+	sqMask = (unsigned *)((uint8_t *)sqPtr + params.sq_off.ring_mask);
+	sqArray = (unsigned *)((uint8_t *)sqPtr + params.sq_off.array);
+	sqEntries = params.sq_entries;
+	sqLocalTail = *sqTail;
+
+	cqHead = (unsigned *)((uint8_t *)cqPtr + params.cq_off.head);
+	cqTail = (unsigned *)((uint8_t *)cqPtr + params.cq_off.tail);
+	cqMask = (unsigned *)((uint8_t *)cqPtr + params.cq_off.ring_mask);
+	cqes = (struct io_uring_cqe *)((uint8_t *)cqPtr + params.cq_off.cqes);
+
+	// provided buffer ring for multishot recv, nBuffers should be power of 2
+	bufEntries = nBuffers;
+	bufSize = bufferSize;
+	bufRingSize = nBuffers * sizeof(struct io_uring_buf);
+
+	bufRing = (struct io_uring_buf_ring *)mmap(nullptr, bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (bufRing == MAP_FAILED) {
+		bufRing = nullptr;
+		release();
+		return false;
+	}
+
+	bufData = (uint8_t *)mmap(nullptr, nBuffers * bufferSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (bufData == MAP_FAILED) {
+		bufData = nullptr;
+		release();
+		return false;
+	}
+
+	struct io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = uint64_t(uintptr_t(bufRing));
+	reg.ring_entries = nBuffers;
+	reg.bgid = BufferGroup;
+
+	if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+		release();
+		return false;
+	}
+
+	for (unsigned i = 0; i < nBuffers; ++ i) {
+		auto buf = getRingBuf(i);
+		buf->addr = uint64_t(uintptr_t(getBuffer(i)));
+		buf->len = bufferSize;
+		buf->bid = i;
+	}
+	__atomic_store_n(&bufRing->tail, uint16_t(nBuffers), __ATOMIC_RELEASE);
+
+	return true;
+}
+
+void ConnectionUring::release() {
+	if (bufData) {
+		munmap(bufData, bufEntries * bufSize);
+		bufData = nullptr;
+	}
+	if (bufRing) {
+		munmap(bufRing, bufRingSize);
+		bufRing = nullptr;
+	}
+	if (sqes) {
+		munmap(sqes, sqesSize);
+		sqes = nullptr;
+	}
+	if (cqPtr != MAP_FAILED && cqPtr != sqPtr) {
+		munmap(cqPtr, cqSize);
+	}
+	cqPtr = MAP_FAILED;
+	if (sqPtr != MAP_FAILED) {
+		munmap(sqPtr, sqSize);
+		sqPtr = MAP_FAILED;
+	}
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+}
+
+bool ConnectionUring::isSupported(uint8_t op) const {
+	// same as for io_uring_buf_ring, flexible array is not used in C++, ops goes right after header
+	std::array<uint64_t, (sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op)) / sizeof(uint64_t)> data;
+	data.fill(0);
+
+	auto probe = (struct io_uring_probe *)data.data();
+	if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+		return false;
+	}
+
+	auto ops = (const struct io_uring_probe_op *)(probe + 1);
+	return op <= probe->last_op && op < probe->ops_len && (ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+}
+
+struct io_uring_sqe *ConnectionUring::getSqe() {
+	auto head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+	if (sqLocalTail - head >= sqEntries) {
+		// ring is full, flush it without waiting
+		if (submit(0) < 0) {
+			return nullptr;
+		}
+		head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+		if (sqLocalTail - head >= sqEntries) {
+			return nullptr;
+		}
+	}
+
+	auto idx = sqLocalTail & *sqMask;
+	auto sqe = &sqes[idx];
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	sqArray[idx] = idx;
+	++ sqLocalTail;
+	++ pending;
+	return sqe;
+}
+
+int ConnectionUring::submit(unsigned waitNr) {
+	__atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+
+	auto toSubmit = pending;
+	pending = 0;
+
+	if (toSubmit == 0 && waitNr == 0) {
+		return 0;
+	}
+
+	auto ret = syscall(__NR_io_uring_enter, fd, toSubmit, waitNr, waitNr ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+	if (ret < 0) {
+		return -errno;
+	}
+	return int(ret);
+}
+
+template <typename Callback>
+unsigned ConnectionUring::forEachCqe(const Callback &cb) {
+	unsigned count = 0;
+	auto head = *cqHead;
+	while (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+		auto cqe = &cqes[head & *cqMask];
+		auto data = cqe->user_data;
+		auto res = cqe->res;
+		auto flags = cqe->flags;
+
+		// release slot before callback, callback can produce new SQEs
+		++ head;
+		__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+
+		cb(data, res, flags);
+		++ count;
+	}
+	return count;
+}
+
+void ConnectionUring::recycleBuffer(uint16_t bid) {
+	auto tail = bufRing->tail;
+	auto buf = getRingBuf(tail & (bufEntries - 1));
+	buf->addr = uint64_t(uintptr_t(getBuffer(bid)));
+	buf->len = bufSize;
+	buf->bid = bid;
+	__atomic_store_n(&bufRing->tail, uint16_t(tail + 1), __ATOMIC_RELEASE);
+}
+
+bool ConnectionWorker::initUring() {
+	auto uring = new (mem::pool::palloc(_slabPool, sizeof(ConnectionUring))) ConnectionUring;
+	if (!uring->init(UringEntries, UringBuffers, SlabBufferSize)) {
+		uring->~ConnectionUring();
+		mem::pool::free(_slabPool, uring, sizeof(ConnectionUring));
+		return false;
+	}
+
+	_uring = uring;
+
+	if (_inputFd >= 0) {
+		armUringAccept();
+	}
+
+	if (auto sqe = _uring->getSqe()) {
+		// poll, not read: cancel pipe is shared between workers and should not be drained
+		sqe->opcode = IORING_OP_POLL_ADD;
+		sqe->fd = _cancelFd;
+		sqe->poll32_events = POLLIN;
+		sqe->user_data = ConnectionUring::makeData(nullptr, ConnectionUring::Cancel);
+	}
+
+	armUringEvent();
+	return true;
+}
+
+void ConnectionWorker::releaseUring() {
+	if (_uring) {
+		_uring->release();
+		_uring->~ConnectionUring();
+		mem::pool::free(_slabPool, _uring, sizeof(ConnectionUring));
+		_uring = nullptr;
+	}
+}
+
+void ConnectionWorker::armUringAccept() {
+	if (auto sqe = _uring->getSqe()) {
+		sqe->opcode = IORING_OP_ACCEPT;
+		sqe->fd = _inputFd;
+		sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+		sqe->user_data = ConnectionUring::makeData(nullptr, ConnectionUring::Accept);
+	}
+}
+
+void ConnectionWorker::armUringAcceptRetry() {
+	if (auto sqe = _uring->getSqe()) {
+		_uring->acceptRetry.tv_sec = 0;
+		_uring->acceptRetry.tv_nsec = ConnectionUring::AcceptRetryNanos;
+
+		sqe->opcode = IORING_OP_TIMEOUT;
+		sqe->addr = uint64_t(uintptr_t(&_uring->acceptRetry));
+		sqe->len = 1;
+		sqe->user_data = ConnectionUring::makeData(nullptr, ConnectionUring::AcceptRetry);
+	}
+}
+
+void ConnectionWorker::armUringEvent() {
+	if (auto sqe = _uring->getSqe()) {
+		sqe->opcode = IORING_OP_READ;
+		sqe->fd = _eventFd;
+		sqe->addr = uint64_t(uintptr_t(&_eventValue));
+		sqe->len = sizeof(uint64_t);
+		sqe->user_data = ConnectionUring::makeData(nullptr, ConnectionUring::Event);
+	}
+}
+
+void ConnectionWorker::armUringRecv(Client *client) {
+	if (auto sqe = _uring->getSqe()) {
+		sqe->opcode = IORING_OP_RECV;
+		sqe->fd = client->fd;
+		sqe->ioprio = IORING_RECV_MULTISHOT;
+		sqe->flags = IOSQE_BUFFER_SELECT;
+		sqe->buf_group = ConnectionUring::BufferGroup;
+		sqe->user_data = ConnectionUring::makeData(client, ConnectionUring::Recv);
+		++ client->inflight;
+	}
+}
+
+void ConnectionWorker::submitUringWrite(Client *client) {
+	if (client->writePending || client->closing || !client->outputFront) {
+		return;
+	}
+
+	if (!client->iov) {
+		client->iov = (struct iovec *)mem::pool::palloc(client->pool, sizeof(struct iovec) * MaxIovecs);
+	}
+
+	size_t niov = 0;
+	auto b = client->outputFront;
+	while (b && niov < MaxIovecs) {
+		client->iov[niov].iov_base = b->buf + b->offset;
+		client->iov[niov].iov_len = b->size - b->offset;
+		++ niov;
+		b = b->next;
+	}
+
+	if (auto sqe = _uring->getSqe()) {
+		sqe->opcode = IORING_OP_WRITEV;
+		sqe->fd = client->fd;
+		sqe->addr = uint64_t(uintptr_t(client->iov));
+		sqe->len = niov;
+		sqe->user_data = ConnectionUring::makeData(client, ConnectionUring::Write);
+		client->writePending = true;
+		++ client->inflight;
+	}
+}
+
+void ConnectionWorker::onUringCompletion(uint64_t data, int32_t res, uint32_t flags, bool &shouldClose) {
+	auto client = (Client *)ConnectionUring::getPtr(data);
+
+	// operation on client is finished, client can be reused, if it was released
+	auto finalize = [&] {
+		-- client->inflight;
+		if (client->closing && client->inflight == 0) {
+			client->gen->recycleClient(client);
+			return true;
+		}
+		return client->closing;
+	};
+
+	switch (ConnectionUring::getOp(data)) {
+	case ConnectionUring::Accept:
+		if (res >= 0) {
+			if (!_generation) {
+				_generation = makeGeneration();
+			}
+			auto c = _generation->pushFd(res);
+			++ _fdCount;
+			armUringRecv(c);
+		} else if (res != -EAGAIN && res != -ECANCELED) {
+			char buf[256] = { 0 };
+			onError(mem::toString("accept() failed with errno ", -res, " (", strerror_r(-res, buf, 255), ")"));
+		}
+		if (!(flags & IORING_CQE_F_MORE) && !shouldClose) {
+			switch (res) {
+			case -EMFILE:
+			case -ENFILE:
+			case -ENOBUFS:
+			case -ENOMEM:
+				// resources can be freed by closed clients, retry later instead of spinning
+				armUringAcceptRetry();
+				break;
+			case -EINVAL:
+			case -EBADF:
+			case -ENOTSOCK:
+			case -EOPNOTSUPP:
+				// listener is not usable, rearming will fail the same way
+				onError("accept is disabled for worker");
+				break;
+			default:
+				armUringAccept();
+				break;
+			}
+		}
+		break;
+	case ConnectionUring::AcceptRetry:
+		if (!shouldClose) {
+			armUringAccept();
+		}
+		break;
+	case ConnectionUring::Recv:
+		if (flags & IORING_CQE_F_BUFFER) {
+			auto bid = uint16_t(flags >> IORING_CQE_BUFFER_SHIFT);
+			if (res > 0 && !client->closing) {
+				// return ring buffer as soon as possible, data goes to the slab buffer
+				auto b = acquireBuffer();
+				b->size = size_t(res);
+				memcpy(b->buf, _uring->getBuffer(bid), b->size);
+				_uring->recycleBuffer(bid);
+				client->readBuffer(b);
+			} else {
+				_uring->recycleBuffer(bid);
+			}
+		}
+		if (!(flags & IORING_CQE_F_MORE)) {
+			if (finalize()) {
+				break;
+			}
+			if (res > 0 || res == -ENOBUFS) {
+				// multishot was terminated by kernel or there was no free buffers, rearm
+				armUringRecv(client);
+			} else {
+				if (res < 0) {
+					onError(mem::toString("recv() failed with errno ", -res));
+				}
+				client->gen->releaseClient(client);
+			}
+		}
+		break;
+	case ConnectionUring::Write:
+		client->writePending = false;
+		if (finalize()) {
+			break;
+		}
+		if (res >= 0) {
+			client->consumeOutput(size_t(res));
+			submitUringWrite(client);
+		} else {
+			onError(mem::toString("writev() failed with errno ", -res));
+			client->gen->releaseClient(client);
+		}
+		break;
+	case ConnectionUring::Event:
+		// wakeup counter is already reset with read, tasks will be processed on next iteration
+		armUringEvent();
+		break;
+	case ConnectionUring::Cancel:
+		shouldClose = true;
+		break;
+	default:
+		break;
+	}
+}
+
+bool ConnectionWorker::pollUring() {
+	bool _shouldClose = false;
+
+	while (!_shouldClose) {
+		unsigned waitNr = 1;
+		if (runPendingTasks()) {
+			waitNr = 0;
+		} else {
+			_idle.store(true);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (auto task = _queue->popTask(this)) {
+				_idle.store(false);
+				runTask(task);
+				waitNr = 0;
+			}
+		}
+
+		// single syscall to submit all new operations and wait for completions
+		auto err = _uring->submit(waitNr);
+		_idle.store(false);
+
+		if (err < 0) {
+			if (err != -EINTR) {
+				char buf[256] = { 0 };
+				onError(mem::toString("io_uring_enter() failed with errno ", -err, " (", strerror_r(-err, buf, 255), ")"));
+				return false;
+			}
+			return true;
+		}
+
+		_uring->forEachCqe([&] (uint64_t data, int32_t res, uint32_t flags) {
+			onUringCompletion(data, res, flags, _shouldClose);
+		});
+	}
+
+	if (_shouldClose) {
+		auto gen = _generation;
+		while (gen) {
+			gen->releaseAll();
+			gen = gen->prev;
+		}
+	}
+
+	return !_shouldClose;
+}
+
+#else
+
+bool ConnectionWorker::initUring() { return false; }
+void ConnectionWorker::releaseUring() { }
+void ConnectionWorker::armUringAccept() { }
+void ConnectionWorker::armUringAcceptRetry() { }
+void ConnectionWorker::armUringEvent() { }
+void ConnectionWorker::armUringRecv(Client *) { }
+void ConnectionWorker::submitUringWrite(Client *) { }
+void ConnectionWorker::onUringCompletion(uint64_t, int32_t, uint32_t, bool &) { }
+bool ConnectionWorker::pollUring() { return false; }
+
+#endif
+
+}
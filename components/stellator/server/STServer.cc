@@ -70,38 +70,19 @@ static constexpr auto SA_SERVER_FILE_SCHEME_NAME = "__files";
 static constexpr auto SA_SERVER_USER_SCHEME_NAME = "__users";
 static constexpr auto SA_SERVER_ERROR_SCHEME_NAME = "__error";
 
-struct DbConnection : public mem::AllocBase {
-	db::sql::Driver::Handle handle;
-	DbConnection *next = nullptr;
-};
-
 struct DbConnList : public mem::AllocBase {
-	struct Config {
-		int nmin = 1;
-		int nkeep = 2;
-		int nmax = 10;
-		int64_t exptime = 300;
-		bool persistent = true;
-	};
-
 	mem::pool_t *pool = nullptr;
-	mem::Vector<DbConnection> array;
-
-	DbConnection *opened = nullptr;
-	DbConnection *free = nullptr;
-
-	Config _config;
-	size_t count = 0;
-	std::mutex mutex;
+	bool persistent = true;
 
 	db::sql::Driver *driver = nullptr;
+	db::sql::DriverPool *handles = nullptr;
 	mem::Map<mem::StringView, mem::StringView> params;
 
 	DbConnList(Root *, size_t nWorkers, const mem::Value &db);
 	~DbConnList();
 
 	db::sql::Driver::Handle open();
-	void close(db::pq::Driver::Handle h);
+	void close(db::sql::Driver::Handle h);
 };
 
 struct Server::Config : public mem::AllocBase {
@@ -248,53 +229,25 @@ struct Server::Config : public mem::AllocBase {
 
 DbConnList::DbConnList(Root *root, size_t nWorkers, const mem::Value &db)
 : pool(mem::pool::acquire()) {
-	array.resize(nWorkers);
-
-	memset((void *)array.data(), 0, sizeof(DbConnection) * array.size());
-
-	DbConnection *target = nullptr;
-	for (auto &it : array) {
-		it.next = target;
-		target = &it;
-	}
-	free = target;
+	// every worker can hold one handle, and one more for nested storage access (see Server::performWithStorage);
+	// waiting is limited, so exhausted pool can not block workers forever
+	db::sql::DriverPool::Config cfg;
+	cfg.nkeep = nWorkers;
+	cfg.nmax = nWorkers * 2;
+	cfg.timeout = mem::TimeInterval::seconds(30);
 
 	for (auto &it : db.asDict()) {
-		if (it.first == "nmin") {
-			if (int v = it.second.getInteger()) {
-				_config.nmin = stappler::math::clamp(v, 1, config::getMaxDatabaseConnections());
-			} else {
-				std::cout << "[DbdModule] invalid value for nmin: " << it.second << "\n";
-			}
-		} else if (it.first == "nkeep") {
-			if (int v = it.second.getInteger()) {
-				_config.nkeep = stappler::math::clamp(v, 1, config::getMaxDatabaseConnections());
-			} else {
-				std::cout << "[DbdModule] invalid value for nkeep: " << it.second << "\n";
-			}
-		} else if (it.first == "nmax") {
-			if (int v = it.second.getInteger()) {
-				_config.nmax = stappler::math::clamp(v, 1, config::getMaxDatabaseConnections());
-			} else {
-				std::cout << "[DbdModule] invalid value for nmax: " << it.second << "\n";
-			}
-		} else if (it.first == "exptime") {
-			if (auto v = it.second.getInteger()) {
-				_config.exptime = v;
-			} else {
-				std::cout << "[DbdModule] invalid value for exptime: " << it.second << "\n";
-			}
-		} else if (it.first == "persistent") {
+		if (it.first == "persistent") {
 			if (it.second == "1" || it.second == "yes") {
-				_config.persistent = true;
+				persistent = true;
 			} else if (it.second == "0" || it.second == "no") {
-				_config.persistent = false;
+				persistent = false;
 			} else {
 				std::cout << "[DbdModule] invalid value for persistent: " << it.second << "\n";
 			}
 		} else if (it.first == "driver") {
 			driver = root->getDbDriver(it.second.getString());
-		} else {
+		} else if (!cfg.set(it.first, it.second.asString())) {
 			params.emplace(mem::StringView(it.first).pdup(), mem::StringView(it.second.getString()).pdup());
 		}
 	}
@@ -302,77 +255,57 @@ DbConnList::DbConnList(Root *root, size_t nWorkers, const mem::Value &db)
 	if (!driver) {
 		driver = root->getRootDbDriver();
 	}
-}
 
-DbConnList::~DbConnList() { }
+	if (driver && persistent) {
+		handles = db::sql::DriverPool::create(driver, params, cfg);
+	}
+}
 
-db::sql::Driver::Handle DbConnList::open() {
-	db::pq::Driver::Handle ret(nullptr);
-	mutex.lock();
-	while (opened) {
-		auto tmpOpened = opened;
-		ret = opened->handle;
-		opened->handle = db::pq::Driver::Handle(nullptr);
-		opened = opened->next;
-
-		tmpOpened->next = free;
-		free = tmpOpened;
-
-		auto conn = driver->getConnection(ret);
-		if (driver->isValid(conn)) {
-			break;
-		} else {
-			driver->finish(ret);
-			ret = db::pq::Driver::Handle(nullptr);
-		}
+DbConnList::~DbConnList() {
+	if (handles) {
+		handles->destroy();
 	}
-	mutex.unlock();
+}
 
-	if (ret.get()) {
-		return ret;
+db::sql::Driver::Handle DbConnList::open() {
+	db::sql::Driver::Handle ret;
+	if (handles) {
+		ret = handles->acquire();
 	} else {
-		db::sql::Driver::Handle ret;
 		mem::perform([&] {
 			ret = driver->connect(params);
 		}, pool);
-		if (ret.get()) {
-			auto key = mem::toString("pq", uintptr_t(ret.get()));
-			mem::pool::store(ret.get(), key, [d = driver, ret] () {
-				d->finish(ret);
-			});
-		}
-		return ret;
 	}
+
+	if (ret.get()) {
+		// return handle if it was not closed before pool destruction; request pool can outlive server's config,
+		// so, capture only driver pool (it's freed after last handle release) and driver (owned by root)
+		auto key = mem::toString("pq", uintptr_t(ret.get()));
+		mem::pool::store(ret.get(), key, [handles = handles, driver = driver, ret] () {
+			if (handles) {
+				handles->release(ret);
+			} else {
+				driver->finish(ret);
+			}
+		});
+	}
+	return ret;
 }
 
-void DbConnList::close(db::pq::Driver::Handle h) {
-	if (h.get()) {
-		auto key = mem::toString("pq", uintptr_t(h.get()));
-		mem::pool::store(h.get(), key, nullptr);
+void DbConnList::close(db::sql::Driver::Handle h) {
+	if (!h.get()) {
+		return;
 	}
 
-	auto conn = driver->getConnection(h);
-	bool valid = driver->isValid(conn) && driver->isIdle(conn);
-	if (!valid) {
+	auto key = mem::toString("pq", uintptr_t(h.get()));
+	mem::pool::store(h.get(), key, nullptr);
+
+	if (handles) {
+		handles->release(h);
+	} else {
 		mem::perform([&] {
 			driver->finish(h);
 		}, pool);
-	} else {
-		mutex.lock();
-		if (free) {
-			auto tmpfree = free;
-			free->handle = h;
-			free = free->next;
-
-			tmpfree->next = opened;
-			opened = tmpfree;
-			mutex.unlock();
-		} else {
-			mutex.unlock();
-			mem::perform([&] {
-				driver->finish(h);
-			}, pool);
-		}
 	}
 }
 
@@ -619,6 +552,9 @@ void Server::onHeartBeat(mem::pool_t *pool) {
 	mem::perform([&] {
 		auto now = mem::Time::now();
 		if (!_config->loadingFalled) {
+			if (_config->dbConnList.handles) {
+				_config->dbConnList.handles->cleanup();
+			}
 
 			auto db = _config->dbConnList.open();
 			if (!db.empty()) {
@@ -675,6 +611,17 @@ void Server::onBroadcast(const mem::Value &val) {
 }
 
 void Server::onBroadcast(const mem::BytesView &bytes) {
+	// only system broadcasts and broadcasts with data are processed,
+	// check it before decoding of whole payload
+	mem::Value system;
+	mem::StringView paths[] = { "system", "data" };
+	mem::Value *values[] = { &system, nullptr };
+
+	stappler::data::Projection<mem::Interface> proj(paths, values);
+	if (stappler::data::visit<mem::Interface>(bytes, proj) && !system.getBool() && !proj.isFound(1)) {
+		return;
+	}
+
 	onBroadcast(stappler::data::read<stappler::BytesView, mem::Interface>(bytes));
 }
 
@@ -830,6 +777,13 @@ void Server::performWithStorage(const mem::Callback<void(const db::Transaction &
 	}, targetPool);
 }
 
+db::sql::DriverPool::Stats Server::getDbPoolStats() const {
+	if (_config->dbConnList.handles) {
+		return _config->dbConnList.handles->getStats();
+	}
+	return db::sql::DriverPool::Stats();
+}
+
 void Server::setSessionKeys(mem::StringView pub, mem::StringView priv) const {
 	_config->publicSessionKey = pub.str<mem::Interface>();
 	_config->privateSessionKey = priv.str<mem::Interface>();
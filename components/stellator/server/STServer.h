@@ -24,6 +24,7 @@ THE SOFTWARE.
 #define STELLATOR_SERVER_STSERVER_H_
 
 #include "STDefine.h"
+#include "STSqlDriverPool.h"
 
 namespace stellator {
 
@@ -118,6 +119,9 @@ public:
 
 	void performWithStorage(const mem::Callback<void(const db::Transaction &)> &cb, bool openNewConnecton = false) const;
 
+	// counters of server's database connection pool
+	db::sql::DriverPool::Stats getDbPoolStats() const;
+
 public: // httpd server info
 	mem::StringView getDefaultName() const;
     mem::StringView getServerScheme() const;
@@ -32,8 +32,10 @@ CLI_SRCS_DIRS += \
 	components/common \
 	components/spug \
 	components/layout/document \
+	components/layout/font \
 	components/layout/types \
 	components/layout/vg \
+	components/layout/simd \
 	components/stappler/src/core \
 	$(COCOS2D_CLI_SRCS_DIRS)
 
@@ -29,7 +29,7 @@ COMMON_PRECOMPILED_HEADERS += \
 COMMON_SRCS_DIRS += components/common
 COMMON_SRCS_OBJS += 
 COMMON_INCLUDES_DIRS += components/common
-COMMON_INCLUDES_OBJS += $(OSTYPE_INCLUDE)
+COMMON_INCLUDES_OBJS += $(OSTYPE_INCLUDE) components/thirdparty
 
 TOOLKIT_NAME := COMMON
 TOOLKIT_TITLE := common
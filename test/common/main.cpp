@@ -36,6 +36,7 @@ static constexpr auto HELP_STRING(
 R"HelpString(sptest <options> <command>
 Options are one of:
     -v (--verbose)
+    -b (--bench) - run long benchmarks
     -h (--help))HelpString");
 
 
@@ -175,6 +176,8 @@ int parseOptionSwitch(data::Value &ret, char c, const char *str) {
 		ret.setBool(true, "help");
 	} else if (c == 'v') {
 		ret.setBool(true, "verbose");
+	} else if (c == 'b') {
+		ret.setBool(true, "bench");
 	}
 	return 1;
 }
@@ -184,6 +187,8 @@ int parseOptionString(data::Value &ret, const StringView &str, int argc, const c
 		ret.setBool(true, "help");
 	} else if (str == "verbose") {
 		ret.setBool(true, "verbose");
+	} else if (str == "bench") {
+		ret.setBool(true, "bench");
 	} else if (str == "gencbor") {
 		ret.setBool(true, "gencbor");
 	}
@@ -237,6 +242,8 @@ int _spMain(argc, argv) {
 		}
 	}
 
+	Test::EnableBenchmarks(opts.getBool("bench"));
+
 	data::Value null;
 	data::Value integer(42);
 	data::Value f(42.0);
@@ -0,0 +1,297 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/**
+Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "SPCommon.h"
+#include "SPTime.h"
+#include "SPBitmap.h"
+#include "SPCrypto.h"
+#include "SPData.h"
+#include "SPFilesystem.h"
+#include "Test.h"
+
+#include <sys/resource.h>
+
+NS_SP_BEGIN
+
+struct BitmapResampleTest : Test {
+	BitmapResampleTest() : Test("BitmapResampleTest") { }
+
+	static Bitmap makeImage(uint32_t width, uint32_t height, Bitmap::PixelFormat fmt) {
+		auto bpp = Bitmap::getBytesPerPixel(fmt);
+		Bytes data(size_t(width) * height * bpp);
+		uint32_t seed = 42;
+		for (uint32_t y = 0; y < height; ++ y) {
+			for (uint32_t x = 0; x < width; ++ x) {
+				auto px = data.data() + (size_t(y) * width + x) * bpp;
+				for (uint8_t c = 0; c < bpp; ++ c) {
+					seed = seed * 1103515245 + 12345;
+					px[c] = uint8_t(((x * (c + 1) + y * (3 - c)) / 4 + ((seed >> 16) & 0x0F)) & 0xFF);
+				}
+			}
+		}
+		return Bitmap(std::move(data), width, height, fmt, Bitmap::Alpha::Unpremultiplied);
+	}
+
+	static size_t getPeakMemory() {
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		return size_t(usage.ru_maxrss); // in KiB
+	}
+
+	static bool streamResample(BytesView source, Bytes &target, Bitmap::ResampleFilter f, uint32_t width, uint32_t height) {
+		CoderSource input(source);
+		StringStream output;
+		if (!Bitmap::resample(input, output, f, width, height)) {
+			return false;
+		}
+
+		auto str = output.str();
+		target.assign((const uint8_t *)str.data(), (const uint8_t *)str.data() + str.size());
+		return true;
+	}
+
+	virtual bool run() override {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		runTest(stream, "Identity", count, passed, [&] {
+			for (auto fmt : { Bitmap::PixelFormat::A8, Bitmap::PixelFormat::IA88, Bitmap::PixelFormat::RGB888, Bitmap::PixelFormat::RGBA8888 }) {
+				auto bmp = makeImage(131, 67, fmt);
+				auto ret = bmp.resample(Bitmap::ResampleFilter::Box, bmp.width(), bmp.height());
+				if (ret.data() != bmp.data()) {
+					return false;
+				}
+			}
+			return true;
+		});
+
+		runTest(stream, "Constant color", count, passed, [&] {
+			Bytes data(320 * 240 * 4);
+			for (size_t i = 0; i < data.size(); ++ i) {
+				data[i] = uint8_t(40 + (i % 4) * 50);
+			}
+
+			Bitmap bmp(std::move(data), 320, 240, Bitmap::PixelFormat::RGBA8888, Bitmap::Alpha::Unpremultiplied);
+			for (int f = 0; f <= toInt(Bitmap::ResampleFilter::QuadMix); ++ f) {
+				for (auto &size : { pair(73u, 41u), pair(1000u, 999u) }) {
+					auto ret = bmp.resample(Bitmap::ResampleFilter(f), size.first, size.second);
+					if (ret.width() != size.first || ret.height() != size.second) {
+						return false;
+					}
+
+					for (size_t i = 0; i < ret.size(); ++ i) {
+						if (ret.data()[i] != uint8_t(40 + (i % 4) * 50)) {
+							stream << "\t\tFilter " << f << ": invalid value at " << i << "\n";
+							return false;
+						}
+					}
+				}
+			}
+			return true;
+		});
+
+		runTest(stream, "Reference resampler", count, passed, [&] {
+			// resample/reference.cbor contains results of previous scalar resampler for every filter
+			auto ref = data::readFile(filesystem::currentDir("resample/reference.cbor"));
+			if (!ref.isArray() || ref.empty()) {
+				stream << "\t\tFail to read reference data\n";
+				return false;
+			}
+
+			for (auto &it : ref.asArray()) {
+				auto bmp = makeImage(it.getInteger("width"), it.getInteger("height"), Bitmap::PixelFormat(it.getInteger("format")));
+				auto &results = it.getValue("results");
+				for (int f = 0; f <= toInt(Bitmap::ResampleFilter::QuadMix); ++ f) {
+					auto &expected = results.getBytes(f);
+					auto ret = bmp.resample(Bitmap::ResampleFilter(f), it.getInteger("targetWidth"), it.getInteger("targetHeight"));
+					if (ret.size() != expected.size()) {
+						stream << "\t\tFilter " << f << ": size mismatch\n";
+						return false;
+					}
+
+					for (size_t i = 0; i < ret.size(); ++ i) {
+						if (std::abs(int(ret.dataPtr()[i]) - int(expected[i])) > 1) {
+							stream << "\t\tFilter " << f << ": " << int(ret.dataPtr()[i]) << " vs. " << int(expected[i]) << " at " << i << "\n";
+							return false;
+						}
+					}
+				}
+			}
+			return true;
+		});
+
+		runTest(stream, "Streaming resample", count, passed, [&] {
+			for (auto fmt : { Bitmap::PixelFormat::A8, Bitmap::PixelFormat::RGB888, Bitmap::PixelFormat::RGBA8888 }) {
+				auto source = makeImage(997, 601, fmt).write(Bitmap::FileFormat::Png);
+				auto expected = Bitmap(source).resample(Bitmap::ResampleFilter::Lanczos3, 301, 155);
+
+				Bytes data;
+				if (!streamResample(source, data, Bitmap::ResampleFilter::Lanczos3, 301, 155)) {
+					return false;
+				}
+
+				// PNG is lossless and decoded at full size, so results should be identical
+				Bitmap ret(data);
+				if (ret.getOriginalFormat() != Bitmap::FileFormat::Png || ret.data() != expected.data()) {
+					stream << "\t\tPng: result mismatch for format " << toInt(fmt) << "\n";
+					return false;
+				}
+			}
+
+			auto source = makeImage(1600, 1200, Bitmap::PixelFormat::RGB888).write(Bitmap::FileFormat::Jpeg);
+
+			Bytes data;
+			if (!streamResample(source, data, Bitmap::ResampleFilter::Default, 180, 120)) {
+				return false;
+			}
+
+			Bitmap ret(data);
+			if (ret.getOriginalFormat() != Bitmap::FileFormat::Jpeg || ret.width() != 180 || ret.height() != 120) {
+				return false;
+			}
+
+			// encoded directly into file, without intermediate buffer
+			CoderSource input(source);
+			auto file = filesystem::file::open_tmp("sptest.resample");
+			if (!Bitmap::resample(input, file, Bitmap::ResampleFilter::Default, 180, 120)) {
+				return false;
+			}
+
+			auto path = toString(file.path(), ".jpg");
+			if (!file.close_rename(path)) {
+				file.close_remove();
+				return false;
+			}
+
+			auto fileData = filesystem::readIntoMemory(path);
+			filesystem::remove(path);
+
+			return fileData == data;
+		});
+
+		runTest(stream, "Streaming benchmark", count, passed, [&] {
+			// 40 MP image, encoded line by line, so it's never resident in memory
+			const uint32_t width = 7744;
+			const uint32_t height = 5184;
+
+			StringStream encoded;
+			BitmapFormat::LineInfo info;
+			info.color = Bitmap::PixelFormat::RGB888;
+			info.width = width;
+			info.height = height;
+
+			Bytes line(width * 3);
+			if (!BitmapFormat::writeLines(Bitmap::FileFormat::Jpeg, encoded, info, [&] (const BitmapFormat::line_fn &cb) -> bool {
+				for (uint32_t y = 0; y < height; ++ y) {
+					for (uint32_t x = 0; x < width; ++ x) {
+						line[x * 3] = uint8_t(x * 255 / width);
+						line[x * 3 + 1] = uint8_t(y * 255 / height);
+						line[x * 3 + 2] = (((x / 64) + (y / 64)) & 1) ? 200 : 40;
+					}
+					if (!cb(line.data())) {
+						return false;
+					}
+				}
+				return true;
+			})) {
+				return false;
+			}
+
+			auto str = encoded.str();
+			BytesView source((const uint8_t *)str.data(), str.size());
+
+			stream << "\t\tJpeg " << width << "x" << height << " (" << source.size() << " bytes) -> 1280x853:\n";
+
+			// ru_maxrss only grows, so streaming path should be measured first, and before other benchmarks
+			auto mem = getPeakMemory();
+			auto t = Time::now();
+
+			Bytes streamed;
+			if (!streamResample(source, streamed, Bitmap::ResampleFilter::Default, 1280, 853)) {
+				return false;
+			}
+
+			stream << "\t\t\tstreaming: " << (Time::now() - t).toMillis() << " ms; peak RSS: +"
+					<< (getPeakMemory() - mem) / 1024 << " MiB\n";
+
+			mem = getPeakMemory();
+			t = Time::now();
+
+			Bytes full;
+			{
+				Bitmap bmp(source);
+				full = bmp.resample(1280, 853).write(Bitmap::FileFormat::Jpeg);
+			}
+
+			stream << "\t\t\tfull decode: " << (Time::now() - t).toMillis() << " ms; peak RSS: +"
+					<< (getPeakMemory() - mem) / 1024 << " MiB\n";
+
+			return !streamed.empty() && !full.empty();
+		});
+
+		if (BenchmarksEnabled()) {
+			runTest(stream, "Resample benchmark", count, passed, [&] {
+				auto source = makeImage(4000, 3000, Bitmap::PixelFormat::RGB888);
+
+				const Pair<Bitmap::FileFormat, StringView> formats[] = {
+					pair(Bitmap::FileFormat::Jpeg, "Jpeg"),
+					pair(Bitmap::FileFormat::Png, "Png"),
+					pair(Bitmap::FileFormat::WebpLossy, "WebP"),
+				};
+
+				for (auto &fmt : formats) {
+					auto t = Time::now();
+					Bitmap bmp(source.write(fmt.first));
+					if (!bmp) {
+						stream << "\t\t" << fmt.second << ": fail to encode or decode image\n";
+						return false;
+					}
+
+					stream << "\t\t" << fmt.second << " (" << bmp.width() << "x" << bmp.height() << "): decode: "
+							<< (Time::now() - t).toMillis() << " ms;";
+
+					for (int f = 0; f <= toInt(Bitmap::ResampleFilter::QuadMix); ++ f) {
+						t = Time::now();
+						auto ret = bmp.resample(Bitmap::ResampleFilter(f), 800, 600);
+						if (!ret) {
+							return false;
+						}
+						stream << " " << f << ": " << (Time::now() - t).toMillis() << " ms;";
+					}
+					stream << "\n";
+				}
+				return true;
+			});
+		}
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+} BitmapResampleTest;
+
+NS_SP_END
@@ -0,0 +1,315 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/**
+Copyright (c) 2019 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "SPCommon.h"
+#include "SPTime.h"
+#include "SPString.h"
+#include "SPData.h"
+#include "SPFilesystem.h"
+#include "Test.h"
+
+static constexpr auto DataReaderTestString(
+R"JsonString({
+	"id": 42,
+	"name": "test \"name\"",
+	"items": [ { "name": "a", "v": 1 }, { "name": "b", "v": [ 1, 2, 3 ] } ],
+	"skipped": { "a": [ 1, 2, { "b": "}]" } ], "c": null },
+	"meta": { "tags": [ "x", "y" ], "flag": true, "nested": { "deep": 1.5, "list": [ -1, 1e3 ] } },
+	"last": false
+})JsonString");
+
+NS_SP_BEGIN
+
+struct DataReaderTest : Test {
+	DataReaderTest() : Test("DataReaderTest") { }
+
+	struct CountVisitor : data::ReaderVisitor {
+		data::ReaderResult onKey(StringView key) {
+			++ keys;
+			if (key == "skipped") {
+				return data::ReaderResult::Skip;
+			} else if (key == "last") {
+				return data::ReaderResult::Stop;
+			}
+			return data::ReaderResult::Continue;
+		}
+
+		data::ReaderResult onBeginDict(size_t) { ++ dicts; return data::ReaderResult::Continue; }
+		data::ReaderResult onString(StringView) { ++ strings; return data::ReaderResult::Continue; }
+
+		size_t keys = 0;
+		size_t dicts = 0;
+		size_t strings = 0;
+	};
+
+	static data::Value build(BytesView bytes, bool &success) {
+		data::Value ret;
+		data::ValueBuilder<memory::StandartInterface> builder(ret);
+		success = data::visit<memory::StandartInterface>(bytes, builder);
+		return ret;
+	}
+
+	static bool compareFormats(StringStream &stream, const data::Value &val) {
+		bool success = false;
+		auto str = data::toString(val, false);
+		auto cbor = data::write(val, data::EncodeFormat::Cbor);
+
+		auto fromJson = build(BytesView((const uint8_t *)str.data(), str.size()), success);
+		if (!success || fromJson != data::read(str)) {
+			stream << "\t\tJson mismatch for: " << str.substr(0, 256) << "\n";
+			return false;
+		}
+
+		auto fromCbor = build(cbor, success);
+		if (!success || fromCbor != data::read(cbor)) {
+			stream << "\t\tCbor mismatch for: " << str.substr(0, 256) << "\n";
+			return false;
+		}
+		return true;
+	}
+
+	virtual bool run() override {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		data::Value testData;
+		filesystem::ftw(filesystem::currentDir("data"), [&] (const StringView &path, bool isFile) {
+			if (isFile && filepath::lastExtension(path) == "json") {
+				testData.addValue(data::readFile(path));
+			}
+		});
+
+		auto testValue = data::read(String(DataReaderTestString));
+
+		runTest(stream, "Value builder", count, passed, [&] {
+			size_t failed = 0;
+			for (auto &it : testData.asArray()) {
+				if (!compareFormats(stream, it)) {
+					++ failed;
+				}
+			}
+			if (!compareFormats(stream, testValue)) {
+				++ failed;
+			}
+			return failed == 0;
+		});
+
+		runTest(stream, "Skip and stop", count, passed, [&] {
+			auto cbor = data::write(testValue, data::EncodeFormat::Cbor);
+			auto json = String(DataReaderTestString);
+
+			CountVisitor jsonVisitor;
+			CountVisitor cborVisitor;
+			if (!data::visit(BytesView((const uint8_t *)json.data(), json.size()), jsonVisitor) || !data::visit(cbor, cborVisitor)) {
+				return false;
+			}
+
+			// cbor encoder writes keys in order of dictionary, so "last" goes right after "items"
+			return jsonVisitor.keys == 15 && jsonVisitor.dicts == 5 && jsonVisitor.strings == 5
+					&& cborVisitor.keys == 7 && cborVisitor.dicts == 3 && cborVisitor.strings == 2;
+		});
+
+		runTest(stream, "Projection", count, passed, [&] {
+			StringView paths[] = {
+				"id", "items.1.name", "meta.nested", "meta.nested.list.1", "meta.tags.1", "missing", "items.5", "items.0"
+			};
+
+			auto cbor = data::write(testValue, data::EncodeFormat::Cbor);
+			auto json = String(DataReaderTestString);
+
+			for (auto &bytes : { BytesView(cbor), BytesView((const uint8_t *)json.data(), json.size()) }) {
+				data::Value values[8];
+				data::Value *ptrs[] = { &values[0], &values[1], &values[2], &values[3], &values[4], &values[5], &values[6], nullptr };
+
+				data::Projection<memory::StandartInterface> proj(paths, ptrs);
+				if (!data::visit(bytes, proj)) {
+					return false;
+				}
+
+				if (values[0].getInteger() != 42 || values[1].getString() != "b"
+						|| values[2] != testValue.getValue("meta").getValue("nested") || values[3].getDouble() != 1000.0
+						|| values[4].getString() != "y" || !values[5].isNull() || !values[6].isNull()
+						|| !proj.isFound(0) || !proj.isFound(3) || proj.isFound(5) || proj.isFound(6) || !proj.isFound(7) || proj.isComplete()) {
+					stream << "\t\t" << data::Value(Vector<data::Value>(values, values + 8)) << "\n";
+					return false;
+				}
+			}
+			return true;
+		});
+
+		runTest(stream, "Projection limits", count, passed, [&] {
+			auto json = String(DataReaderTestString);
+			auto bytes = BytesView((const uint8_t *)json.data(), json.size());
+
+			Vector<StringView> paths(data::Projection<memory::StandartInterface>::MaxFields + 1, StringView("id"));
+			data::Projection<memory::StandartInterface> tooMany(paths);
+
+			StringView deepPath[] = { "a.b.c.d.e.f.g.h.i.j.k.l.m.n.o.p.q" };
+			data::Projection<memory::StandartInterface> tooDeep(deepPath);
+
+			StringView emptyPath[] = { "id", "" };
+			data::Projection<memory::StandartInterface> empty(emptyPath);
+
+			paths.pop_back();
+			data::Projection<memory::StandartInterface> maxFields(paths);
+
+			for (auto proj : { &tooMany, &tooDeep, &empty, &maxFields }) {
+				data::visit(bytes, *proj);
+			}
+
+			return !tooMany.isValid() && !tooMany.isFound(0) && !tooMany.isComplete()
+					&& !tooDeep.isValid() && !tooDeep.isComplete()
+					&& !empty.isValid() && !empty.isFound(0) && !empty.isComplete()
+					&& maxFields.isValid() && maxFields.isComplete();
+		});
+
+		runTest(stream, "Malformed input", count, passed, [&] {
+			auto cbor = data::write(testValue, data::EncodeFormat::Cbor);
+			auto json = String(DataReaderTestString);
+
+			// every truncated prefix should be rejected without reading out of bounds
+			size_t accepted = 0;
+			for (size_t i = 0; i < cbor.size(); ++ i) {
+				bool success = false;
+				build(BytesView(cbor.data(), i), success);
+				if (success) {
+					++ accepted;
+				}
+				CountVisitor visitor;
+				data::visit(BytesView(cbor.data(), i), visitor);
+			}
+			for (size_t i = 1; i < json.size(); ++ i) {
+				bool success = false;
+				build(BytesView((const uint8_t *)json.data(), i), success);
+				if (success) {
+					++ accepted;
+				}
+			}
+			if (accepted > 0) {
+				stream << "\t\tTruncated input accepted: " << accepted << "\n";
+				return false;
+			}
+
+			Vector<Bytes> invalid;
+			invalid.emplace_back(Bytes{ 0xd9, 0xd9, 0xf7, 0x5b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf0, 0x61 }); // huge string length
+			invalid.emplace_back(Bytes{ 0xd9, 0xd9, 0xf7, 0x9b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf0 }); // huge array length
+			invalid.emplace_back(Bytes{ 0xd9, 0xd9, 0xf7, 0xa1, 0x61, 0x61 }); // map without value
+			invalid.emplace_back(Bytes{ 0xd9, 0xd9, 0xf7, 0x7f, 0x61, 0x61, 0x01, 0xff }); // integer in chunked string
+			invalid.emplace_back(Bytes{ 0xd9, 0xd9, 0xf7, 0xff }); // break without container
+
+			// chain of nested tags should be limited as nested containers
+			Bytes tags{ 0xd9, 0xd9, 0xf7 };
+			tags.resize(100'003, 0xc0);
+			tags.emplace_back(0x01);
+			invalid.emplace_back(tags);
+
+			// skipped value with chain of nested tags
+			Bytes skipped{ 0xd9, 0xd9, 0xf7, 0xa1, 0x67, 's', 'k', 'i', 'p', 'p', 'e', 'd' };
+			skipped.resize(skipped.size() + 100'000, 0xc0);
+			skipped.emplace_back(0x01);
+			invalid.emplace_back(skipped);
+
+			invalid.emplace_back(Bytes(100'000, '['));
+			StringView("{\"a\" 1}|{\"a\":}|[1,]|[1 2]|\"\\u12|tru|-|{\"a\":1,}").split<StringView::Chars<'|'>>([&] (StringView it) {
+				invalid.emplace_back(Bytes((const uint8_t *)it.data(), (const uint8_t *)it.data() + it.size()));
+			});
+
+			size_t idx = 0;
+			for (auto &it : invalid) {
+				bool success = false;
+				build(it, success);
+
+				CountVisitor visitor;
+				if (success || data::visit(it, visitor)) {
+					stream << "\t\tInvalid input accepted: " << idx << "\n";
+					return false;
+				}
+				++ idx;
+			}
+
+			// tags within limit are still valid
+			Bytes validTags{ 0xd9, 0xd9, 0xf7 };
+			validTags.resize(3 + 16, 0xc0);
+			validTags.emplace_back(0x01);
+
+			bool success = false;
+			auto val = build(validTags, success);
+			return success && val.getInteger() == 1;
+		});
+
+		runTest(stream, "Projection benchmark", count, passed, [&] {
+			data::Value val;
+			auto &payload = val.emplace("payload");
+			for (size_t i = 0; i < 64; ++ i) {
+				payload.addValue(testData);
+			}
+			val.setValue(data::Value({
+				pair("id", data::Value(42)),
+				pair("url", data::Value("/test/url"))
+			}), "zheader");
+
+			auto json = data::toString(val, false);
+			auto cbor = data::write(val, data::EncodeFormat::Cbor);
+			size_t ntests = 32;
+
+			StringView paths[] = { "zheader.id", "zheader.url" };
+
+			auto measure = [&] (BytesView bytes, StringView name) {
+				int64_t fullId = 0, projId = 0;
+
+				auto t = Time::now();
+				for (size_t i = 0; i < ntests; ++ i) {
+					auto tmp = data::read(bytes);
+					fullId += tmp.getValue("zheader").getInteger("id");
+				}
+				auto fullTime = std::max((Time::now() - t).toMicros(), uint64_t(1));
+
+				t = Time::now();
+				for (size_t i = 0; i < ntests; ++ i) {
+					data::Value values[2];
+					data::Value *ptrs[] = { &values[0], &values[1] };
+					data::Projection<memory::StandartInterface> proj(paths, ptrs);
+					data::visit<memory::StandartInterface>(bytes, proj);
+					projId += values[0].getInteger();
+				}
+				auto projTime = std::max((Time::now() - t).toMicros(), uint64_t(1));
+
+				stream << "\t\t" << name << " (" << bytes.size() << " bytes): full decode: " << fullTime / ntests
+						<< " us; projection: " << projTime / ntests << " us\n";
+				return fullId == projId && fullId == int64_t(42 * ntests);
+			};
+
+			return measure(BytesView((const uint8_t *)json.data(), json.size()), "Json") && measure(cbor, "Cbor");
+		});
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+} DataReaderTest;
+
+NS_SP_END
@@ -27,6 +27,7 @@ THE SOFTWARE.
 #include "SPTime.h"
 #include "SPString.h"
 #include "SPData.h"
+#include "SPFilesystem.h"
 #include "Test.h"
 
 static constexpr auto JsonNumberTestString(
@@ -126,4 +127,285 @@ struct JsonNumbersTest : Test {
 
 } JsonNumbersTest;
 
+struct JsonEncodeTest : Test {
+	JsonEncodeTest() : Test("JsonEncodeTest") { }
+
+	// per-char escaping, as it was implemented with iostreams
+	static String encodeStringReference(const String &str) {
+		StringStream stream;
+		stream << '"';
+		for (auto &i : str) {
+			switch (i) {
+			case '\n' : stream << "\\n"; break;
+			case '\r' : stream << "\\r"; break;
+			case '\t' : stream << "\\t"; break;
+			case '\f' : stream << "\\f"; break;
+			case '\b' : stream << "\\b"; break;
+			case '\\' : stream << "\\\\"; break;
+			case '\"' : stream << "\\\""; break;
+			default:
+				if (i >= 0 && i < 0x20) {
+					stream << "\\u" << std::setfill('0') << std::setw(4)
+						<< std::hex << (int32_t)i << std::dec << std::setw(1) << std::setfill(' ');
+				} else {
+					stream << i;
+				}
+				break;
+			}
+		}
+		stream << '"';
+		return stream.str();
+	}
+
+	virtual bool run() override {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		runTest(stream, "String escaping", count, passed, [&] {
+			for (size_t i = 0; i < 256; ++ i) {
+				String str;
+				auto len = rand_uint32_t() % (i < 128 ? 48 : 8_KiB);
+				for (size_t j = 0; j < len; ++ j) {
+					// mostly printable chars with some special ones
+					auto r = rand_uint32_t() % 64;
+					str.push_back(r == 0 ? char(rand_uint32_t() % 0x20) : (r == 1 ? '"' : (r == 2 ? '\\' : (r == 3 ? char(0xD0) : char('a' + r % 26)))));
+				}
+
+				StringStream out;
+				data::json::encodeString(out, str);
+				if (out.str() != encodeStringReference(str)) {
+					stream << "\t\tInvalid escaping for: " << encodeStringReference(str) << "\n";
+					return false;
+				}
+
+				if (data::read(out.str()).getString() != str) {
+					stream << "\t\tInvalid round-trip for: " << encodeStringReference(str) << "\n";
+					return false;
+				}
+			}
+			return true;
+		});
+
+		runTest(stream, "Number round-trip", count, passed, [&] {
+			for (size_t i = 0; i < 1024; ++ i) {
+				data::Value val;
+				val.addDouble(rand_double());
+				val.addDouble(rand_float());
+				val.addInteger(rand_int64_t());
+				val.addInteger(rand_int32_t());
+
+				auto str = data::toString(val, false);
+				if (data::read(str) != val) {
+					stream << "\t\tInvalid round-trip for: " << str << "\n";
+					return false;
+				}
+			}
+			return true;
+		});
+
+		data::Value testData;
+		filesystem::ftw(filesystem::currentDir("data"), [&] (const StringView &path, bool isFile) {
+			if (isFile) {
+				auto ext = filepath::lastExtension(path);
+				if (ext == "json" || ext == "cbor") {
+					testData.addValue(data::readFile(path));
+				}
+			}
+		});
+
+		runTest(stream, "Data round-trip", count, passed, [&] {
+			size_t failed = 0;
+			for (auto &it : testData.asArray()) {
+				if (it.isDouble() && (!std::isfinite(it.getDouble()) || (it.getDouble() == 0.0 && std::signbit(it.getDouble())))) {
+					continue; // not representable in JSON
+				}
+
+				// bytes and integral doubles are changed by JSON, so, compare output of second encoding
+				auto raw = data::toString(it, false);
+				auto pretty = data::toString(it, true);
+				if (data::toString(data::read(raw), false) != raw || data::toString(data::read(pretty), true) != pretty) {
+					stream << "\t\tInvalid round-trip for: " << raw << "\n";
+					++ failed;
+				}
+			}
+			return failed == 0;
+		});
+
+		runTest(stream, "Encode benchmark", count, passed, [&] {
+			data::Value val;
+			for (size_t i = 0; i < 64; ++ i) {
+				val.addValue(testData);
+			}
+
+			size_t ntests = 64;
+			size_t bytes = 0;
+			auto t = Time::now();
+			for (size_t i = 0; i < ntests; ++ i) {
+				bytes += data::toString(val, false).size();
+			}
+			auto rawTime = std::max((Time::now() - t).toMicros(), uint64_t(1));
+
+			size_t prettyBytes = 0;
+			t = Time::now();
+			for (size_t i = 0; i < ntests; ++ i) {
+				prettyBytes += data::toString(val, true).size();
+			}
+			auto prettyTime = std::max((Time::now() - t).toMicros(), uint64_t(1));
+
+			String longString;
+			for (size_t i = 0; i < 64_KiB; ++ i) {
+				longString.push_back((i % 1024 == 0) ? '\n' : char('a' + i % 26));
+			}
+
+			size_t stringBytes = 0;
+			t = Time::now();
+			for (size_t i = 0; i < ntests * 16; ++ i) {
+				StringStream out;
+				data::json::encodeString(out, longString);
+				stringBytes += out.str().size();
+			}
+			auto stringTime = std::max((Time::now() - t).toMicros(), uint64_t(1));
+
+			stream << "\t\tRaw: " << bytes / rawTime << " MB/s; Pretty: " << prettyBytes / prettyTime
+					<< " MB/s; Strings: " << stringBytes / stringTime << " MB/s\n";
+			return true;
+		});
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+} JsonEncodeTest;
+
+struct JsonDecodeTest : Test {
+	JsonDecodeTest() : Test("JsonDecodeTest") { }
+
+	// parse with sequential and two-stage decoders, results should be the same
+	static bool compareDecoders(StringStream &stream, const String &str, size_t &structural) {
+		StringView seqView(str);
+		auto seq = data::json::readSequential<memory::StandartInterface>(seqView);
+
+		StringView structView(str);
+		data::Value val;
+		if (data::json::readStructural<memory::StandartInterface>(structView, val)) {
+			++ structural;
+			if (data::toString(val, false) != data::toString(seq, false) || structView.size() != seqView.size()) {
+				stream << "\t\tDecoders mismatch for: " << str.substr(0, 256) << "\n";
+				return false;
+			}
+		}
+
+		if (data::toString(data::read(str), false) != data::toString(seq, false)) {
+			stream << "\t\tInvalid fallback for: " << str.substr(0, 256) << "\n";
+			return false;
+		}
+		return true;
+	}
+
+	virtual bool run() override {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		data::Value testData;
+		filesystem::ftw(filesystem::currentDir("data"), [&] (const StringView &path, bool isFile) {
+			if (isFile && filepath::lastExtension(path) == "json") {
+				testData.addValue(data::readFile(path));
+			}
+		});
+
+		runTest(stream, "Data files", count, passed, [&] {
+			size_t structural = 0;
+			size_t failed = 0;
+			for (auto &it : testData.asArray()) {
+				if (!compareDecoders(stream, data::toString(it, false), structural)
+						|| !compareDecoders(stream, data::toString(it, true), structural)) {
+					++ failed;
+				}
+			}
+			stream << "\t\tParsed with structural decoder: " << structural << " of " << testData.size() * 2 << "\n";
+			return failed == 0;
+		});
+
+		runTest(stream, "Strings and numbers", count, passed, [&] {
+			size_t structural = 0;
+			for (size_t i = 0; i < 64; ++ i) {
+				String str("{\"values\": [");
+				auto n = rand_uint32_t() % 256;
+				for (size_t j = 0; j < n; ++ j) {
+					if (j != 0) {
+						str.append(", ");
+					}
+					switch (rand_uint32_t() % 8) {
+					case 0: str.append(toString(rand_int64_t())); break;
+					case 1: str.append(toString(rand_int32_t())); break;
+					case 2: str.append(data::toString(data::Value(rand_double()))); break;
+					case 3: str.append("\"tab\\tquote\\\"backslash\\\\unicode\\u0430\\u0431\""); break;
+					case 4: str.append("{ \"key\\\\\" : true, \"\" : false, \"n\": null, \"f\": -1.5e-3 }"); break;
+					case 5: str.append("[ 0, -0, 1e10, 100000000000000000000, 012 ]"); break;
+					case 6: str.append("\"\\\\\""); break;
+					default: str.append("\"plain string with [brackets], {braces} and : commas, \""); break;
+					}
+				}
+				str.append("], \"end\": \"\\\\\\\\\" }");
+
+				if (!compareDecoders(stream, str, structural)) {
+					return false;
+				}
+
+				// truncated and broken inputs should fall back to sequential decoder
+				// (cut on separators, sequential decoder does not check bounds within literals)
+				auto sep = str.find(',', rand_uint32_t() % str.size());
+				if (sep != String::npos) {
+					if (!compareDecoders(stream, str.substr(0, sep + 1), structural)) {
+						return false;
+					}
+					auto broken = str;
+					broken[sep] = ':';
+					if (!compareDecoders(stream, broken, structural)) {
+						return false;
+					}
+				}
+			}
+			return structural >= 64;
+		});
+
+		runTest(stream, "Decode benchmark", count, passed, [&] {
+			data::Value val;
+			for (size_t i = 0; i < 64; ++ i) {
+				val.addValue(testData);
+			}
+
+			auto str = data::toString(val, true);
+			size_t ntests = 32;
+
+			auto t = Time::now();
+			for (size_t i = 0; i < ntests; ++ i) {
+				StringView r(str);
+				data::json::readSequential<memory::StandartInterface>(r);
+			}
+			auto seqTime = std::max((Time::now() - t).toMicros(), uint64_t(1));
+
+			t = Time::now();
+			for (size_t i = 0; i < ntests; ++ i) {
+				StringView r(str);
+				data::Value tmp;
+				data::json::readStructural<memory::StandartInterface>(r, tmp);
+			}
+			auto structTime = std::max((Time::now() - t).toMicros(), uint64_t(1));
+
+			stream << "\t\tSequential: " << str.size() * ntests / seqTime << " MB/s; Structural: "
+					<< str.size() * ntests / structTime << " MB/s\n";
+			return true;
+		});
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+} JsonDecodeTest;
+
 NS_SP_END
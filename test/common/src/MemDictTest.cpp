@@ -25,6 +25,7 @@ THE SOFTWARE.
 
 #include "SPCommon.h"
 #include "SPString.h"
+#include "SPTime.h"
 #include "SPData.h"
 #include "Test.h"
 
@@ -135,4 +136,151 @@ struct MemDictTest : MemPoolTest {
 	}
 } _MemDictTest;
 
+struct MemFlatDictTest : MemPoolTest {
+	MemFlatDictTest() : MemPoolTest("MemFlatDictTest") { }
+
+	template <typename Interface>
+	static data::ValueTemplate<Interface> makeObject(size_t nkeys, uint64_t seed) {
+		data::ValueTemplate<Interface> ret;
+		for (size_t i = 0; i < nkeys; ++ i) {
+			auto key = toString("field", (seed * 7919 + i * 104729) % 100000);
+			switch (i % 3) {
+			case 0: ret.setInteger(i, StringView(key)); break;
+			case 1: ret.setString(key, StringView(key)); break;
+			case 2: ret.setDouble(double(i) / 3.0, StringView(key)); break;
+			}
+		}
+		return ret;
+	}
+
+	// build, lookup and serialization times for dictionaries of nkeys, in microseconds
+	template <typename Interface>
+	static void runBenchmark(StringStream &stream, pool_t *pool, const char *name, size_t nkeys, size_t nobjects) {
+		memory::pool::clear(pool);
+
+		Vector<String> keys;
+		for (size_t i = 0; i < nkeys; ++ i) {
+			auto key = toString("field", (i * 104729) % 100000);
+			keys.emplace_back(key.data(), key.size());
+		}
+
+		auto t = Time::now();
+		data::ValueTemplate<Interface> objects;
+		for (size_t i = 0; i < nobjects; ++ i) {
+			objects.addValue(makeObject<Interface>(nkeys, 0));
+		}
+		auto buildTime = (Time::now() - t).toMicros();
+
+		int64_t sum = 0;
+		t = Time::now();
+		for (auto &obj : objects.asArray()) {
+			for (size_t i = 0; i < nkeys; i += 3) {
+				sum += obj.getInteger(StringView(keys[i]));
+			}
+		}
+		auto lookupTime = (Time::now() - t).toMicros();
+
+		size_t bytes = 0;
+		t = Time::now();
+		bytes += data::json::write(objects, false).size();
+		bytes += data::cbor::write(objects).size();
+		auto writeTime = (Time::now() - t).toMicros();
+
+		stream << "\t\t" << name << " " << nkeys << " keys: build: " << buildTime << " lookup: " << lookupTime
+				<< " write: " << writeTime << " (" << sum << " " << bytes << " " << memory::pool::get_allocated_bytes(pool) << " bytes)\n";
+	}
+
+	virtual bool run(pool_t *pool) {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		runTest(stream, "ValueTemplate test", count, passed, [&] {
+			for (size_t nkeys : { 4, 15, 16, 17, 100, 1000 }) {
+				auto flat = makeObject<memory::PoolFlatInterface>(nkeys, nkeys);
+				auto tree = makeObject<memory::PoolInterface>(nkeys, nkeys);
+
+				if (data::json::write(flat, false) != data::json::write(tree, false) || flat.size() != tree.size()) {
+					stream << "\t\tInvalid content for " << nkeys << " keys\n";
+					return false;
+				}
+
+				for (auto &it : tree.asDict()) {
+					if (!flat.hasValue(it.first) || flat.getValue(it.first) != data::ValueTemplate<memory::PoolFlatInterface>(it.second)) {
+						stream << "\t\tLookup failed for " << it.first << "\n";
+						return false;
+					}
+				}
+
+				if (flat.hasValue("missing") || flat.hasValue("")) {
+					return false;
+				}
+
+				auto json = data::json::write(tree, false);
+				StringView jsonView(json);
+				auto cbor = data::cbor::write(tree);
+				if (data::json::read<memory::PoolFlatInterface>(jsonView) != flat
+						|| data::cbor::read<memory::PoolFlatInterface>(cbor) != flat) {
+					stream << "\t\tDecoding failed for " << nkeys << " keys\n";
+					return false;
+				}
+
+				// erase every second key
+				size_t i = 0;
+				for (auto &it : tree.asDict()) {
+					if (i ++ % 2 == 0) {
+						flat.erase(it.first);
+					}
+				}
+				i = 0;
+				for (auto &it : tree.asDict()) {
+					if ((i ++ % 2 == 0) == flat.hasValue(it.first)) {
+						stream << "\t\tErase failed for " << it.first << "\n";
+						return false;
+					}
+				}
+
+				if (data::ValueTemplate<memory::PoolInterface>(makeObject<memory::StandartFlatInterface>(nkeys, 1)) != makeObject<memory::PoolInterface>(nkeys, 1)) {
+					stream << "\t\tConversion failed for " << nkeys << " keys\n";
+					return false;
+				}
+			}
+			return true;
+		});
+
+		runTest(stream, "emplace sub test", count, passed, [&] {
+			data::ValueTemplate<memory::PoolFlatInterface> val;
+			val.setString("One", "One");
+			val.setString("Two", "Two");
+			val.setString("Three", "Three");
+			val.setString("Four", "Four");
+
+			// value is moved from dictionary into itself
+			val.setValue(std::move(val.getValue("Three")), "Green");
+
+			data::ValueTemplate<memory::PoolFlatInterface> test;
+			test.setString("Four", "Four");
+			test.setString("Three", "Green");
+			test.setString("One", "One");
+			test.setValue(data::Value(), "Three");
+			test.setString("Two", "Two");
+
+			return val == test && val.getString("One") == "One" && val.getString("Green") == "Three";
+		});
+
+		runTest(stream, "Benchmark", count, passed, [&] {
+			for (size_t nkeys : { 8, 16, 64 }) {
+				runBenchmark<memory::PoolInterface>(stream, pool, "rbtree", nkeys, 20'000);
+				runBenchmark<memory::PoolFlatInterface>(stream, pool, "flat", nkeys, 20'000);
+			}
+			return true;
+		});
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+} _MemFlatDictTest;
+
 NS_SP_END
@@ -0,0 +1,158 @@
+/**
+Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "SPCommon.h"
+#include "SPTime.h"
+#include "SPMemPoolStruct.h"
+#include "Test.h"
+
+#include <thread>
+
+NS_SP_BEGIN
+
+struct MemPoolAllocatorTest : Test {
+	static constexpr size_t PoolsPerThread = 100'000;
+
+	MemPoolAllocatorTest() : Test("MemPoolAllocatorTest") { }
+
+	// create and destroy child pools of shared allocator from multiple threads, returns pools/sec
+	size_t runBenchmark(mempool::custom::Allocator &alloc, size_t nThreads) {
+		auto root = mempool::custom::Pool::create(&alloc);
+
+		auto threadFn = [&] {
+			for (size_t i = 0; i < PoolsPerThread; ++ i) {
+				auto pool = root->make_child();
+				pool->palloc(1_KiB);
+				if (i % 4 == 0) {
+					// force second node for some pools
+					pool->palloc(12_KiB);
+				}
+				mempool::custom::Pool::destroy(pool);
+			}
+		};
+
+		auto t = Time::now();
+		Vector<std::thread> threads;
+		for (size_t i = 0; i < nThreads; ++ i) {
+			threads.emplace_back(threadFn);
+		}
+		for (auto &it : threads) {
+			it.join();
+		}
+		auto dt = std::max((Time::now() - t).toMicros(), uint64_t(1));
+
+		mempool::custom::Pool::destroy(root);
+
+		return size_t(nThreads * PoolsPerThread * 1'000'000.0 / dt);
+	}
+
+	virtual bool run() override {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		runTest(stream, "Magazine reuse test", count, passed, [&] {
+			mempool::custom::Allocator alloc;
+			auto root = mempool::custom::Pool::create(&alloc);
+
+			auto pool = root->make_child();
+			mempool::custom::Pool::destroy(pool);
+
+			auto allocated = alloc.allocated.load();
+			auto cached = alloc.get_cached();
+
+			for (size_t i = 0; i < 1000; ++ i) {
+				auto pool = root->make_child();
+				pool->palloc(1_KiB);
+				mempool::custom::Pool::destroy(pool);
+			}
+
+			// node should be reused from thread magazine without new allocations
+			bool success = cached > 0 && alloc.allocated.load() == allocated && alloc.get_cached() == cached;
+
+			// nodes in magazine of other thread should be returned on thread termination
+			std::thread thread([&] {
+				auto pool = root->make_child();
+				mempool::custom::Pool::destroy(pool);
+			});
+			thread.join();
+
+			success = success && alloc.get_cached() == cached;
+
+			mempool::custom::Pool::destroy(root);
+			return success;
+		});
+
+		runTest(stream, "Free after thread magazines release", count, passed, [&] {
+			struct PoolHolder {
+				mempool::custom::Pool *pool = nullptr;
+
+				~PoolHolder() {
+					// called after thread magazines was released, nodes should go directly to allocator
+					if (pool) {
+						mempool::custom::Pool::destroy(pool);
+					}
+				}
+			};
+
+			mempool::custom::Allocator alloc;
+			auto root = mempool::custom::Pool::create(&alloc);
+			auto cached = alloc.get_cached();
+
+			std::thread thread([&] {
+				// constructed before thread magazines, so, it will be destroyed after them
+				static thread_local PoolHolder holder;
+				holder.pool = root->make_child();
+				holder.pool->palloc(1_KiB);
+			});
+			thread.join();
+
+			auto success = alloc.get_cached() == cached;
+
+			mempool::custom::Pool::destroy(root);
+			return success;
+		});
+
+		runTest(stream, "Create/destroy benchmark", count, passed, [&] {
+			auto nThreads = std::max(std::thread::hardware_concurrency(), 4U);
+			for (size_t i = 1; i <= nThreads; i *= 2) {
+				mempool::custom::Allocator locked;
+				locked.magazinesEnabled = false;
+				auto lockedRate = runBenchmark(locked, i);
+
+				mempool::custom::Allocator cached;
+				auto cachedRate = runBenchmark(cached, i);
+
+				stream << "\t\tThreads: " << i << " Locked: " << lockedRate << " pools/sec; Magazines: " << cachedRate
+						<< " pools/sec; Allocated: " << locked.allocated.load() << " vs. " << cached.allocated.load() << " bytes\n";
+			}
+			return true;
+		});
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+} _MemPoolAllocatorTest;
+
+NS_SP_END
@@ -29,10 +29,53 @@ THE SOFTWARE.
 #include "Test.h"
 
 #include "SPSearchConfiguration.h"
+#include "SPSearchIndex.h"
+#include "SPFilesystem.h"
+#include "SPTime.h"
 #include "SPUrl.h"
 
 NS_SP_BEGIN
 
+static memory::string SearchIndexTest_makePhrase(uint32_t &seed, size_t words) {
+	static constexpr StringView syllables[] = {
+		"ка", "ра", "ба", "мо", "ли", "ne", "to", "ra", "ver", "st", "al", "on", "pre", "ex", "ma", "in"
+	};
+
+	memory::string ret;
+	for (size_t i = 0; i < words; ++ i) {
+		if (!ret.empty()) {
+			ret.append(" ");
+		}
+		seed = seed * 1103515245 + 12345;
+		auto len = 1 + (seed >> 16) % 4;
+		for (size_t j = 0; j < len; ++ j) {
+			seed = seed * 1103515245 + 12345;
+			auto s = syllables[(seed >> 16) % (sizeof(syllables) / sizeof(StringView))];
+			ret.append(s.data(), s.size());
+		}
+	}
+	return ret;
+}
+
+// reference prefix search: ids of nodes, that contains words started with every query token
+static Set<int64_t> SearchIndexTest_naiveSearch(const Map<int64_t, memory::string> &nodes, StringView query) {
+	Set<int64_t> ret;
+	for (auto &it : nodes) {
+		bool found = false;
+		query.split<search::SearchIndex::DefaultSep>([&] (StringView q) {
+			StringView(it.second).split<search::SearchIndex::DefaultSep>([&] (StringView w) {
+				if (w.starts_with(q)) {
+					found = true;
+				}
+			});
+		});
+		if (found) {
+			ret.emplace(it.first);
+		}
+	}
+	return ret;
+}
+
 static constexpr auto SearchParserTest =
 R"( 7'/10,5' 2011 шт. 20 лестница крыши 7\' 2011 шт. 20 X - арматурный прут 2011 шт.7 шт. 10)";
 
@@ -305,6 +348,204 @@ struct SearchTest : MemPoolTest {
 			return true;
 		});
 
+		runTest(stream, "Search index", count, passed, [&] {
+			uint32_t seed = 42;
+			Map<int64_t, String> nodes;
+
+			auto index = Rc<search::SearchIndex>::alloc();
+			index->init();
+
+			for (int64_t i = 0; i < 2000; ++ i) {
+				auto str = SearchIndexTest_makePhrase(seed, 1 + i % 5);
+				index->add(str, i, i % 3);
+				nodes.emplace(i, move(str));
+				if (i == 1000) {
+					index->build();
+				}
+			}
+
+			for (int64_t i = 0; i < 2000; i += 7) {
+				index->remove(i);
+				nodes.erase(i);
+			}
+
+			auto check = [&] (StringView query) {
+				auto ref = SearchIndexTest_naiveSearch(nodes, query);
+				auto res = index->performSearch(query, 0);
+
+				Vector<StringView> words;
+				query.split<search::SearchIndex::DefaultSep>([&] (StringView w) {
+					words.emplace_back(w);
+				});
+
+				Set<int64_t> ids;
+				for (auto &it : res.nodes) {
+					for (auto &m : it.matches) {
+						if (index->resolveToken(*it.node, m) != words[m.word]) {
+							stream << "'" << query << "': invalid match";
+							return false;
+						}
+					}
+					ids.emplace(it.node->id);
+				}
+				if (ids != ref) {
+					stream << "'" << query << "': " << ids.size() << " != " << ref.size();
+					return false;
+				}
+
+				auto top = index->performSearch(query, 0, search::SearchIndex::Heuristic(), nullptr, 10);
+				auto full = index->performSearch(query, 0, search::SearchIndex::Heuristic());
+				if (top.nodes.size() != std::min(size_t(10), full.nodes.size())) {
+					return false;
+				}
+				for (size_t i = 0; i < top.nodes.size(); ++ i) {
+					if (top.nodes[i].score != full.nodes[i].score) {
+						stream << "'" << query << "': invalid top-k order";
+						return false;
+					}
+				}
+				return true;
+			};
+
+			auto queries = [&] {
+				for (auto &it : {"ка", "ра ba", "ver", "pre ex", "stal", "ne to ra", "mol", "inma", "x", "каба"}) {
+					if (!check(it)) {
+						return false;
+					}
+				}
+				return true;
+			};
+
+			if (!queries()) {
+				return false;
+			}
+
+			index->build();
+			if (!queries() || index->size() != nodes.size()) {
+				return false;
+			}
+
+			auto path = filesystem::currentDir("search-index-test.bin");
+			if (!index->save(path)) {
+				stream << "Fail to save index";
+				return false;
+			}
+
+			bool success = true;
+			for (auto mapped : {true, false}) {
+				index = Rc<search::SearchIndex>::alloc();
+				index->init();
+				if (!index->load(path, mapped) || index->size() != nodes.size() || !queries()) {
+					stream << "Fail to load index (" << mapped << ")";
+					success = false;
+					break;
+				}
+
+				index->add("prefix mapped", 10000, 0);
+				nodes.emplace(10000, "prefix mapped");
+				if (!check("pre")) {
+					success = false;
+					break;
+				}
+				nodes.erase(10000);
+			}
+
+			filesystem::remove(path);
+			return success;
+		});
+
+		runTest(stream, "Search index corrupted file", count, passed, [&] {
+			uint32_t seed = 7;
+
+			auto index = Rc<search::SearchIndex>::alloc();
+			index->init();
+			for (int64_t i = 0; i < 200; ++ i) {
+				index->add(SearchIndexTest_makePhrase(seed, 1 + i % 3), i, 0);
+			}
+			index->build();
+
+			auto path = filesystem::currentDir("search-index-corrupted.bin");
+			auto target = filesystem::currentDir("search-index-corrupted-2.bin");
+			if (!index->save(path)) {
+				stream << "Fail to save index";
+				return false;
+			}
+
+			auto data = filesystem::readIntoMemory<memory::StandartInterface>(path);
+
+			bool success = true;
+			for (auto mapped : {true, false}) {
+				// truncated file should always be rejected
+				for (size_t len = 0; len < data.size(); len += 1 + len / 8) {
+					filesystem::write(target, data.data(), len);
+					auto idx = Rc<search::SearchIndex>::alloc();
+					idx->init();
+					if (idx->load(target, mapped)) {
+						stream << "Truncated index loaded: " << len << " of " << data.size() << "\n";
+						success = false;
+					}
+				}
+
+				// corrupted file can be loaded or rejected, but search should not read out of bounds
+				for (size_t i = 0; i < 256; ++ i) {
+					auto tmp = data;
+					for (size_t j = 0; j < 4; ++ j) {
+						seed = seed * 1103515245 + 12345;
+						tmp[(seed >> 8) % tmp.size()] ^= uint8_t(1 + (seed >> 24) % 255);
+					}
+					filesystem::write(target, tmp.data(), tmp.size());
+
+					auto idx = Rc<search::SearchIndex>::alloc();
+					idx->init();
+					if (idx->load(target, mapped)) {
+						for (auto &it : {"ка", "ра ba", "ver", "x"}) {
+							idx->performSearch(it, 0);
+						}
+					}
+				}
+			}
+
+			filesystem::remove(target);
+			filesystem::remove(path);
+			return success;
+		});
+
+		runTest(stream, "Search index benchmark", count, passed, [&] {
+			uint32_t seed = 1;
+			size_t nnodes = 100000;
+
+			auto index = Rc<search::SearchIndex>::alloc();
+			index->init();
+			index->reserve(nnodes);
+
+			auto t = Time::now();
+			for (size_t i = 0; i < nnodes; ++ i) {
+				index->add(SearchIndexTest_makePhrase(seed, 1 + i % 4), i, 0);
+			}
+			index->build();
+			auto buildTime = (Time::now() - t).toMicros();
+
+			auto &terms = index->getTermIndex();
+
+			Vector<String> queries;
+			for (size_t i = 0; i < 256; ++ i) {
+				auto q = SearchIndexTest_makePhrase(seed, 1 + i % 2);
+				queries.emplace_back(q.substr(0, 2 + i % 5));
+			}
+
+			size_t results = 0;
+			t = Time::now();
+			for (auto &it : queries) {
+				results += index->performSearch(it, 0, search::SearchIndex::Heuristic(), nullptr, 10).nodes.size();
+			}
+			auto queryTime = std::max((Time::now() - t).toMicros(), uint64_t(1));
+
+			stream << "\t\tBuild: " << buildTime / 1000 << " ms for " << nnodes << " nodes, " << terms.terms << " terms, "
+					<< terms.postings << " postings, " << terms.dictionary.size() + terms.data.size() << " bytes; Query: "
+					<< queryTime / queries.size() << " us/query\n";
+			return results > 0;
+		});
+
 		_desc = stream.str();
 
 		return count == passed;
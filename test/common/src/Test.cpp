@@ -52,6 +52,7 @@ struct TestManager {
 	bool run(const String &) const;
 
 	bool colorsSupported = false;
+	bool benchmarksEnabled = false;
 	Set<Test *> tests;
 
 	std::random_device rd;
@@ -154,6 +155,14 @@ bool Test::Run(const String &str) {
 	return TestManager::getInstance()->run(str);
 }
 
+void Test::EnableBenchmarks(bool value) {
+	TestManager::getInstance()->benchmarksEnabled = value;
+}
+
+bool Test::BenchmarksEnabled() {
+	return TestManager::getInstance()->benchmarksEnabled;
+}
+
 Test::Test(const String &name) : _name(name) {
 	TestManager::getInstance()->insert(this);
 }
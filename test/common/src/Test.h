@@ -32,6 +32,10 @@ struct Test {
 	static bool RunAll();
 	static bool Run(const String &);
 
+	// long-running benchmarks are only performed when enabled with --bench
+	static void EnableBenchmarks(bool);
+	static bool BenchmarksEnabled();
+
 	Test(const String &name);
 	virtual ~Test();
 
@@ -0,0 +1,610 @@
+/**
+Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "STRoot.h"
+#include "STSqlDriverPool.h"
+
+namespace stappler {
+
+static constexpr auto HELP_STRING =
+R"HelpString(PostgreSQL driver test
+Options:
+	--test decode - check that values in binary and text result formats are decoded equally
+	--test cache - check prepared statements reuse and eviction in connection's statement cache
+	--test pipeline - check that objects with relations, created with pipelined batch, are stored completely
+	--test pool - check driver handles pool with fake driver (database is not required)
+	--bench insert - insert rows one object per query vs. bulk, with and without array field
+	--writes <n> - number of objects to insert (default: 1000 for benchmark, 100 for tests)
+	--host <host>, --dbname <name>, --user <user>, --password <password> - connection parameters
+)HelpString";
+
+static constexpr auto s_config = R"Config({
+	"host": "localhost",
+	"dbname": "test",
+	"user": "serenity",
+	"password": "serenity",
+})Config";
+
+int parseOptionSwitch(data::Value &ret, char c, const char *str) {
+	if (c == 'h') {
+		ret.setBool(true, "help");
+	}
+	return 1;
+}
+
+int parseOptionString(data::Value &ret, const StringView &str, int argc, const char * argv[]) {
+	if (str == "help") {
+		ret.setBool(true, "help");
+	} else if (str == "test" && argc > 0) {
+		ret.setString(argv[0], "test");
+		return 2;
+	} else if (str == "bench" && argc > 0) {
+		ret.setString(argv[0], "bench");
+		return 2;
+	} else if (str == "writes" && argc > 0) {
+		ret.setInteger(StringView(argv[0]).readInteger().get(), "writes");
+		return 2;
+	} else if ((str == "host" || str == "dbname" || str == "user" || str == "password") && argc > 0) {
+		ret.setString(argv[0], str);
+		return 2;
+	}
+	return 1;
+}
+
+static bool runTest(StringView name, const Callback<bool()> &cb) {
+	auto success = cb();
+	std::cout << name << ": " << (success ? "passed" : "failed") << "\n";
+	return success;
+}
+
+// Tables for test schemes are created by adapter and dropped after test, with triggers functions
+static void dropTables(db::pq::Driver *driver, db::pq::Driver::Handle handle, std::initializer_list<StringView> tables) {
+	auto conn = driver->getConnection(handle);
+
+	db::mem::StringStream names;
+	for (auto &it : tables) {
+		if (&it != tables.begin()) {
+			names << ",";
+		}
+		names << "'" << it << "'";
+	}
+
+	db::mem::Vector<db::mem::String> triggers;
+	auto res = driver->exec(conn, db::mem::toString("SELECT tgname FROM pg_trigger WHERE NOT tgisinternal AND tgrelid::regclass::text IN (",
+			names.weak(), ");").data());
+	for (size_t i = 0; i < driver->getNTuples(res); ++ i) {
+		triggers.emplace_back(db::mem::String(driver->getValue(res, i, 0), driver->getLength(res, i, 0)));
+	}
+	driver->clearResult(res);
+
+	db::mem::StringStream query;
+	query << "DROP TABLE IF EXISTS ";
+	for (auto &it : tables) {
+		if (&it != tables.begin()) {
+			query << ", ";
+		}
+		query << it;
+	}
+	query << " CASCADE;";
+	for (auto &it : triggers) {
+		query << "DROP FUNCTION IF EXISTS \"" << it << "_func\"();";
+	}
+	driver->clearResult(driver->exec(conn, query.weak().data()));
+}
+
+static db::mem::Value makeObject(size_t i, bool withTags) {
+	db::mem::Value val;
+	val.setString(toString("key", i), "key");
+	val.setInteger(Time::now().toMicros(), "time");
+	val.setValue(db::mem::Value{ db::mem::Value("data"), db::mem::Value(int64_t(i)) }, "data");
+	if (withTags) {
+		val.setValue(db::mem::Value{ db::mem::Value(toString("tag", i)), db::mem::Value(toString("tag", i + 1)) }, "tags");
+	}
+	return val;
+}
+
+// Driver without database: handle is a number, handles from `broken` set are not valid
+class TestPoolDriver : public db::sql::Driver {
+public:
+	virtual bool init(Handle handle, const db::mem::Vector<db::mem::StringView> &) override { return true; }
+
+	virtual void performWithStorage(Handle handle, const db::mem::Callback<void(const db::Adapter &)> &cb) const override { }
+	virtual db::Interface *acquireInterface(Handle handle, db::mem::pool_t *) const override { return nullptr; }
+
+	virtual Handle connect(const db::mem::Map<db::mem::StringView, db::mem::StringView> &) const override {
+		std::unique_lock<std::mutex> lock(mutex);
+		++ connected;
+		return Handle((void *)uintptr_t(connected));
+	}
+
+	virtual void finish(Handle h) const override {
+		std::unique_lock<std::mutex> lock(mutex);
+		++ finished;
+	}
+
+	virtual Connection getConnection(Handle h) const override { return Connection(h.get()); }
+
+	virtual bool isValid(Handle h) const override { return isValid(getConnection(h)); }
+	virtual bool isValid(Connection c) const override {
+		std::unique_lock<std::mutex> lock(mutex);
+		return broken.find(c.get()) == broken.end();
+	}
+	virtual bool isIdle(Connection c) const override {
+		std::unique_lock<std::mutex> lock(mutex);
+		return busy.find(c.get()) == busy.end();
+	}
+
+	void setBroken(Handle h) {
+		std::unique_lock<std::mutex> lock(mutex);
+		broken.emplace(h.get());
+	}
+
+	void setBusy(Handle h) {
+		std::unique_lock<std::mutex> lock(mutex);
+		busy.emplace(h.get());
+	}
+
+	size_t getOpened() const {
+		std::unique_lock<std::mutex> lock(mutex);
+		return connected - finished;
+	}
+
+	mutable std::mutex mutex;
+	mutable size_t connected = 0;
+	mutable size_t finished = 0;
+	std::set<void *> broken;
+	std::set<void *> busy;
+};
+
+static bool runPoolTest() {
+	db::mem::Map<db::mem::StringView, db::mem::StringView> params;
+	bool success = true;
+
+	auto check = [&] (StringView name, bool value) {
+		if (!value) {
+			std::cout << "\t" << name << ": failed\n";
+			success = false;
+		}
+	};
+
+	TestPoolDriver driver;
+
+	db::sql::DriverPool::Config cfg;
+	cfg.nmin = 1;
+	cfg.nkeep = 1;
+	cfg.nmax = 3;
+	cfg.timeout = TimeInterval::milliseconds(100);
+	cfg.exptime = TimeInterval::milliseconds(50);
+
+	auto pool = db::sql::DriverPool::create(&driver, params, cfg);
+
+	// acquire and release
+	auto h1 = pool->acquire();
+	auto h2 = pool->acquire();
+	check("Acquire", h1.get() && h2.get() && h1 != h2 && pool->getStats().opened == 2 && pool->getStats().idle == 0);
+
+	pool->release(h1);
+	pool->release(h2);
+	check("Release", pool->getStats().idle == 2 && driver.getOpened() == 2);
+
+	// last released handle should be reused first
+	auto h3 = pool->acquire();
+	check("LIFO reuse", h3 == h2 && pool->getStats().reused == 1 && driver.connected == 2);
+
+	// wait for released handle, then fail by timeout
+	auto h4 = pool->acquire();
+	auto h5 = pool->acquire();
+	check("Limit", h4.get() && h5.get() && pool->getStats().opened == 3);
+
+	std::thread thread([&] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		pool->release(h5);
+	});
+	auto h6 = pool->acquire();
+	thread.join();
+	check("Wait", h6 == h5 && pool->getStats().waits == 1);
+
+	auto t = Time::now();
+	auto h7 = pool->acquire();
+	check("Timeout", !h7.get() && pool->getStats().timeouts == 1 && Time::now() - t >= TimeInterval::milliseconds(100));
+
+	// invalid idle handle should be closed and replaced on acquire
+	pool->release(h6);
+	driver.setBroken(h6);
+	auto h8 = pool->acquire();
+	check("Validation on acquire", h8.get() && h8 != h6 && pool->getStats().invalidated == 1);
+
+	// handle, that was not idle on release, should be closed
+	driver.setBusy(h8);
+	pool->release(h8);
+	check("Validation on release", pool->getStats().invalidated == 2 && pool->getStats().idle == 0);
+
+	// excess idle handles should expire, nkeep handles should be kept
+	pool->release(h3);
+	pool->release(h4);
+	std::this_thread::sleep_for(std::chrono::milliseconds(60));
+	pool->cleanup();
+	check("Expiry", pool->getStats().idle == 1 && pool->getStats().opened == 1 && pool->getStats().expired == 1
+			&& driver.getOpened() == 1);
+
+	// destroyed pool should be freed after last handle release
+	auto h9 = pool->acquire();
+	pool->destroy();
+	check("Destroy", !pool->acquire().get() && driver.getOpened() == 1);
+	pool->release(h9);
+	check("Release after destroy", driver.getOpened() == 0);
+
+	return success;
+}
+
+// Values in binary format are decoded by ResultCursor, values in text format are parsed from strings,
+// both should produce same results, including negative int2/int4 and float4 values
+static bool runDecodeTest(db::pq::Driver *driver, db::pq::Driver::Handle handle) {
+	struct Column {
+		StringView expr;
+		db::mem::Value value;
+	};
+
+	Column columns[] = {
+		{ "(-1)::int2", db::mem::Value(int64_t(-1)) },
+		{ "(-32768)::int2", db::mem::Value(int64_t(-32768)) },
+		{ "32767::int2", db::mem::Value(int64_t(32767)) },
+		{ "(-123456)::int4", db::mem::Value(int64_t(-123456)) },
+		{ "(-2147483648)::int4", db::mem::Value(int64_t(-2147483648LL)) },
+		{ "2147483647::int4", db::mem::Value(int64_t(2147483647)) },
+		{ "(-5000000000)::int8", db::mem::Value(int64_t(-5000000000LL)) },
+		{ "(-1.5)::float4", db::mem::Value(-1.5) },
+		{ "(-2.25)::float8", db::mem::Value(-2.25) },
+		{ "true", db::mem::Value(true) },
+		{ "false", db::mem::Value(false) },
+		{ "'text'::text", db::mem::Value("text") },
+	};
+
+	db::mem::StringStream query;
+	query << "SELECT ";
+	for (auto &it : columns) {
+		if (&it != columns) {
+			query << ", ";
+		}
+		query << it.expr;
+	}
+	query << ";";
+
+	auto queryString = query.str();
+	auto conn = driver->getConnection(handle);
+
+	bool success = true;
+	for (int format : { 0, 1 }) {
+		db::pq::ResultCursor cursor(driver, driver->exec(conn, queryString.data(), 0, nullptr, nullptr, nullptr, format));
+		if (!cursor.isSuccess() || cursor.getFieldsCount() != sizeof(columns) / sizeof(Column)) {
+			std::cout << "Fail to perform query: " << queryString << "\n";
+			return false;
+		}
+
+		for (size_t i = 0; i < cursor.getFieldsCount(); ++ i) {
+			auto &c = columns[i];
+			if (cursor.isBinaryFormat(i) != (format == 1)) {
+				std::cout << c.expr << ": invalid result format\n";
+				success = false;
+			}
+
+			auto val = cursor.toTypedData(i);
+			if (val != c.value) {
+				std::cout << c.expr << " (" << (format ? "binary" : "text") << "): " << val << " != " << c.value << "\n";
+				success = false;
+			}
+
+			if (c.value.isInteger() && cursor.toInteger(i) != c.value.getInteger()) {
+				std::cout << c.expr << " (" << (format ? "binary" : "text") << "): toInteger: "
+						<< cursor.toInteger(i) << " != " << c.value.getInteger() << "\n";
+				success = false;
+			} else if (c.value.isDouble() && cursor.toDouble(i) != c.value.getDouble()) {
+				std::cout << c.expr << " (" << (format ? "binary" : "text") << "): toDouble: "
+						<< cursor.toDouble(i) << " != " << c.value.getDouble() << "\n";
+				success = false;
+			} else if (c.value.isBool() && cursor.toBool(i) != c.value.getBool()) {
+				std::cout << c.expr << " (" << (format ? "binary" : "text") << "): toBool: "
+						<< cursor.toBool(i) << " != " << c.value.getBool() << "\n";
+				success = false;
+			}
+		}
+	}
+
+	return success;
+}
+
+// Query is prepared on second execution and reused after that; when more then StatementCacheSize queries
+// were prepared, old statements should be evicted and deallocated on server
+static bool runCacheTest(db::pq::Driver *driver, db::pq::Driver::Handle handle, const db::Scheme &scheme, size_t nObjects) {
+	bool success = true;
+	driver->performWithStorage(handle, [&] (const db::Adapter &adapter) {
+		auto transaction = db::Transaction::acquire(adapter);
+		transaction.perform([&] {
+			db::mem::Value objects;
+			for (size_t i = 0; i < nObjects; ++ i) {
+				objects.addValue(makeObject(i, false));
+			}
+			return db::Worker(scheme, transaction).create(objects).size() == nObjects;
+		});
+
+		auto stats = driver->getStatementStats(handle);
+
+		// same query should be prepared once, then reused
+		db::mem::Value first;
+		for (size_t i = 0; i < 10; ++ i) {
+			auto val = db::Worker(scheme, transaction).select(db::Query().select("key", db::mem::Value("key1")));
+			if (i == 0) {
+				first = val;
+			} else if (val != first || val.size() != 1) {
+				std::cout << "Cached query returns invalid result: " << val << "\n";
+				success = false;
+			}
+		}
+
+		auto next = driver->getStatementStats(handle);
+		if (next.lookups - stats.lookups != 10 || next.prepared - stats.prepared != 1
+				|| next.hits - stats.hits != 10 - db::pq::Driver::StatementPrepareThreshold) {
+			std::cout << "Invalid statement stats: lookups: " << next.lookups - stats.lookups << " prepared: "
+					<< next.prepared - stats.prepared << " hits: " << next.hits - stats.hits << "\n";
+			success = false;
+		}
+
+		// distinct queries (by limit) should be prepared and evicted from cache
+		auto nQueries = db::pq::Driver::StatementCacheSize + 64;
+		stats = next;
+		for (size_t i = 0; i < nQueries; ++ i) {
+			for (size_t j = 0; j < db::pq::Driver::StatementPrepareThreshold; ++ j) {
+				auto val = db::Worker(scheme, transaction).select(db::Query().select("key", db::mem::Value("key1")).limit(i + 1));
+				if (val.size() != 1) {
+					success = false;
+				}
+			}
+		}
+
+		next = driver->getStatementStats(handle);
+		if (next.prepared - stats.prepared != nQueries || next.evicted - stats.evicted < nQueries - db::pq::Driver::StatementCacheSize) {
+			std::cout << "Invalid statement stats: prepared: " << next.prepared - stats.prepared
+					<< " evicted: " << next.evicted - stats.evicted << "\n";
+			success = false;
+		}
+
+		// evicted statements should be deallocated in batches, when connection is idle
+		auto res = driver->exec(driver->getConnection(handle), "SELECT count(*) FROM pg_prepared_statements;");
+		auto nPrepared = size_t(StringView(driver->getValue(res, 0, 0)).readInteger().get(0));
+		driver->clearResult(res);
+
+		if (nPrepared > db::pq::Driver::StatementCacheSize + 64) {
+			std::cout << "Evicted statements are not deallocated: " << nPrepared << "\n";
+			success = false;
+		}
+
+		transaction.release();
+	});
+	return success;
+}
+
+// Array create writes relations for all objects in single pipelined batch,
+// every object should be created with it's array field
+static bool runPipelineTest(db::pq::Driver *driver, db::pq::Driver::Handle handle, const db::Scheme &scheme, size_t nObjects) {
+	std::cout << "Pipeline mode: " << (driver->isPipelineSupported() ? "supported" : "not supported") << "\n";
+
+	bool success = true;
+	driver->performWithStorage(handle, [&] (const db::Adapter &adapter) {
+		auto transaction = db::Transaction::acquire(adapter);
+
+		db::mem::Value ret;
+		if (!transaction.performBatch([&] {
+			db::mem::Value objects;
+			for (size_t i = 0; i < nObjects; ++ i) {
+				objects.addValue(makeObject(i, true));
+			}
+			ret = db::Worker(scheme, transaction).create(objects);
+			return ret.size() == nObjects;
+		})) {
+			std::cout << "Fail to create objects: " << ret.size() << " of " << nObjects << "\n";
+			success = false;
+		}
+
+		size_t i = 0;
+		for (auto &it : ret.asArray()) {
+			auto tags = db::Worker(scheme, transaction).getField(it, "tags");
+			auto expected = makeObject(i, true).getValue("tags");
+			if (tags != expected) {
+				std::cout << "Invalid tags for " << it.getInteger("__oid") << ": " << tags << " != " << expected << "\n";
+				success = false;
+			}
+			++ i;
+		}
+
+		// failed query in batch should fail whole batch and transaction
+		if (transaction.performBatch([&] {
+			db::mem::Value objects;
+			objects.addValue(makeObject(nObjects, true));
+			db::Worker(scheme, transaction).create(objects);
+			auto h = static_cast<db::pq::Handle *>(transaction.getAdapter().interface());
+			h->performSimpleQuery("SELECT * FROM pq_test_not_exists;");
+			return true;
+		})) {
+			std::cout << "Failed batch was committed\n";
+			success = false;
+		}
+
+		if (db::Worker(scheme, transaction).count() != nObjects) {
+			std::cout << "Failed batch was not rolled back\n";
+			success = false;
+		}
+
+		transaction.release();
+	});
+	return success;
+}
+
+// Inserts rows into PostgreSQL one object per query, then as single array; objects with
+// array field require relation writes, that are sent in pipeline when array is inserted
+static void runInsertBenchmark(db::pq::Driver *driver, db::pq::Driver::Handle handle, const db::Scheme &scheme,
+		const db::Scheme &tagsScheme, size_t nRows) {
+	std::cout << "Pipeline mode: " << (driver->isPipelineSupported() ? "supported" : "not supported") << "\n";
+
+	driver->performWithStorage(handle, [&] (const db::Adapter &adapter) {
+		auto run = [&] (StringView name, const db::Scheme &s, bool withTags, bool bulk) {
+			size_t rows = 0;
+			auto t = Time::now();
+			if (auto transaction = db::Transaction::acquire(adapter)) {
+				transaction.perform([&] {
+					if (bulk) {
+						db::mem::Value objects;
+						for (size_t i = 0; i < nRows; ++ i) {
+							objects.addValue(makeObject(i, withTags));
+						}
+						if (auto ret = db::Worker(s, transaction).create(objects)) {
+							rows = ret.size();
+						}
+					} else {
+						for (size_t i = 0; i < nRows; ++ i) {
+							if (db::Worker(s, transaction).create(makeObject(i, withTags))) {
+								++ rows;
+							}
+						}
+					}
+					return true;
+				});
+				transaction.release();
+			}
+			auto dt = Time::now() - t;
+
+			std::cout << name << ": Rows: " << rows << " Time: " << dt.toMicros() << "mks"
+					<< " Rows/sec: " << size_t(rows * 1'000'000.0 / std::max(dt.toMicros(), uint64_t(1))) << "\n";
+		};
+
+		run("Object per query", scheme, false, false);
+		run("Multi-row insert", scheme, false, true);
+		run("Object per query (with array field)", tagsScheme, true, false);
+		run("Multi-row insert (with array field)", tagsScheme, true, true);
+	});
+}
+
+SP_EXTERN_C int _spMain(argc, argv) {
+	data::Value opts = data::parseCommandLineOptions(argc, argv,
+			&parseOptionSwitch, &parseOptionString);
+	if (opts.getBool("help")) {
+		std::cout << HELP_STRING << "\n";
+		return 0;
+	};
+
+	auto pool = memory::pool::create((memory::pool_t *)nullptr);
+	memory::pool::context ctx(pool);
+
+	auto test = opts.getString("test");
+	auto bench = opts.getString("bench");
+
+	bool success = true;
+	if (bench.empty() && (test.empty() || test == "pool")) {
+		success = runTest("Pool test", [&] { return runPoolTest(); }) && success;
+		if (test == "pool") {
+			return success ? 0 : -1;
+		}
+	}
+
+	auto config = data::read<StringView, stellator::mem::Interface>(StringView(s_config));
+	for (auto &it : { "host", "dbname", "user", "password" }) {
+		if (opts.isString(it)) {
+			config.setString(opts.getString(it), it);
+		}
+	}
+
+	auto driver = db::pq::Driver::open();
+	if (!driver) {
+		std::cout << "Fail to load libpq\n";
+		return -1;
+	}
+
+	db::mem::Map<db::mem::StringView, db::mem::StringView> params;
+	for (auto &it : config.asDict()) {
+		params.emplace(it.first, it.second.getString());
+	}
+
+	auto handle = driver->connect(params);
+	if (!handle.get()) {
+		std::cout << "Fail to connect to database\n";
+		return -1;
+	}
+
+	driver->init(handle, db::mem::Vector<db::mem::StringView>());
+
+	using namespace db;
+
+	db::Scheme _test = db::Scheme(bench.empty() ? "pq_test" : "pq_bench");
+	db::Scheme _testTags = db::Scheme(bench.empty() ? "pq_test_tags" : "pq_bench_tags");
+
+	_test.define({
+		Field::Text("key"),
+		Field::Integer("time", Flags::Indexed),
+		Field::Data("data")
+	});
+
+	_testTags.define({
+		Field::Text("key"),
+		Field::Integer("time", Flags::Indexed),
+		Field::Data("data"),
+		Field::Array("tags", Field::Text(""))
+	});
+
+	mem::Map<mem::StringView, const db::Scheme *> schemes;
+	schemes.emplace(_test.getName(), &_test);
+	schemes.emplace(_testTags.getName(), &_testTags);
+
+	db::Scheme::initSchemes(schemes);
+
+	auto tables = {
+		_test.getName(), _testTags.getName(), StringView(mem::toString(_testTags.getName(), "_f_tags")).pdup()
+	};
+
+	// drop tables, left from failed run
+	dropTables(driver, handle, tables);
+
+	driver->performWithStorage(handle, [&] (const db::Adapter &adapter) {
+		adapter.init(db::Interface::Config{"localhost"}, schemes);
+	});
+
+	if (bench == "insert") {
+		runInsertBenchmark(driver, handle, _test, _testTags,
+				size_t(opts.isInteger("writes") ? opts.getInteger("writes") : 1000));
+	} else {
+		auto nObjects = size_t(opts.isInteger("writes") ? opts.getInteger("writes") : 100);
+		if (test.empty() || test == "decode") {
+			success = runTest("Decode test", [&] { return runDecodeTest(driver, handle); }) && success;
+		}
+		if (test.empty() || test == "cache") {
+			success = runTest("Statement cache test", [&] { return runCacheTest(driver, handle, _test, nObjects); }) && success;
+		}
+		if (test.empty() || test == "pipeline") {
+			success = runTest("Pipeline test", [&] { return runPipelineTest(driver, handle, _testTags, nObjects); }) && success;
+		}
+	}
+
+	dropTables(driver, handle, tables);
+
+	driver->finish(handle);
+	return success ? 0 : -1;
+}
+
+}
@@ -0,0 +1,118 @@
+/**
+Copyright (c) 2021 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "Define.h"
+#include "WebSocket.h"
+
+NS_SA_EXT_BEGIN(test)
+
+// Receives benchmark broadcasts and tracks delivery latency
+class TestBroadcastManager : public websocket::Manager {
+public:
+	TestBroadcastManager(Server serv) : Manager(serv) { }
+
+	void reset() {
+		_received = 0;
+		_totalLatency = 0;
+		_maxLatency = 0;
+	}
+
+	virtual bool onBroadcast(const data::Value &val) override {
+		auto latency = Time::now().toMicros() - val.getInteger("sent");
+		_totalLatency += latency;
+
+		auto max = _maxLatency.load();
+		while (latency > max && !_maxLatency.compare_exchange_weak(max, latency)) { }
+
+		++ _received;
+		return false; // no handlers to receive this broadcast
+	}
+
+	size_t getReceived() const { return _received.load(); }
+	uint64_t getTotalLatency() const { return _totalLatency.load(); }
+	uint64_t getMaxLatency() const { return _maxLatency.load(); }
+
+protected:
+	std::atomic<size_t> _received = 0;
+	std::atomic<uint64_t> _totalLatency = 0;
+	std::atomic<uint64_t> _maxLatency = 0;
+};
+
+// Publishes N broadcasts (?count=N) and measures time until all of them are delivered back to this server
+class TestBroadcastBenchHandler : public RequestHandler {
+public:
+	static constexpr auto Timeout = 10_sec;
+
+	TestBroadcastBenchHandler(TestBroadcastManager *m, StringView url) : _manager(m), _url(url) { }
+
+	virtual bool isRequestPermitted(Request & rctx) override {
+		return true;
+	}
+
+	virtual int onTranslateName(Request &rctx) override {
+		auto count = size_t(std::max(rctx.getParsedQueryArgs().getInteger("count"), int64_t(1)));
+		if (!rctx.getParsedQueryArgs().hasValue("count")) {
+			count = 1000;
+		}
+
+		_manager->reset();
+
+		auto start = Time::now();
+		rctx.server().performWithStorage([&] (const db::Transaction &t) {
+			for (size_t i = 0; i < count; ++ i) {
+				t.getAdapter().broadcast(data::Value({
+					pair("server", data::Value(rctx.server().getDefaultName())),
+					pair("url", data::Value(_url)),
+					pair("data", data::Value({
+						pair("sent", data::Value(Time::now().toMicros())),
+					}))
+				}));
+			}
+		});
+		auto published = Time::now();
+
+		while (_manager->getReceived() < count && Time::now() - start < Timeout) {
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+		auto delivered = Time::now();
+
+		auto received = _manager->getReceived();
+
+		data::Value ret;
+		ret.setInteger(count, "count");
+		ret.setInteger(received, "received");
+		ret.setInteger((published - start).toMicros(), "publishTime");
+		ret.setInteger((delivered - start).toMicros(), "deliveryTime");
+		if (received > 0) {
+			ret.setInteger(_manager->getTotalLatency() / received, "avgLatency");
+			ret.setInteger(_manager->getMaxLatency(), "maxLatency");
+		}
+		rctx.writeData(ret);
+		return DONE;
+	}
+
+protected:
+	TestBroadcastManager *_manager;
+	StringView _url;
+};
+
+NS_SA_EXT_END(test)
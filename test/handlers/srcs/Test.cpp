@@ -35,6 +35,9 @@ THE SOFTWARE.
 #include "PugTest.cc"
 #include "UploadTest.cc"
 #include "TestMap.cc"
+#include "WebSocketBench.cc"
+#include "WebSocketTest.cc"
+#include "BroadcastBench.cc"
 
 NS_SA_EXT_BEGIN(test)
 
@@ -181,6 +184,14 @@ void TestHandler::onChildInit(Server &serv) {
 	serv.addHandler("/handler", SA_HANDLER(TestSelectHandler));
 	serv.addHandler("/pug/", SA_HANDLER(TestPugHandler));
 	serv.addHandler("/upload/", SA_HANDLER(TestUploadHandler));
+	serv.addHandler("/bench/websocket", SA_HANDLER(TestWebsocketBenchHandler));
+	serv.addHandler("/test/websocket", SA_HANDLER(TestWebsocketHandler));
+
+	auto broadcastManager = new TestBroadcastManager(serv);
+	serv.addWebsocket("/bench/broadcast/ws", broadcastManager);
+	serv.addHandler("/bench/broadcast", [broadcastManager] () -> RequestHandler * {
+		return new TestBroadcastBenchHandler(broadcastManager, "/bench/broadcast/ws");
+	});
 
 	serv.addHandler("/map/", new TestHandlerMap);
 
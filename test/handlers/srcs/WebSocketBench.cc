@@ -0,0 +1,127 @@
+/**
+Copyright (c) 2021 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "Define.h"
+#include "WebSocket.h"
+
+NS_SA_EXT_BEGIN(test)
+
+// Frame throughput for websocket payload processing: unmasking of input frames and
+// permessage-deflate compression with and without context takeover
+class TestWebsocketBenchHandler : public RequestHandler {
+public:
+	static constexpr size_t BytesPerTest = 64_MiB;
+
+	virtual bool isRequestPermitted(Request & rctx) override {
+		return true;
+	}
+
+	virtual int onTranslateName(Request &rctx) override {
+		data::Value ret;
+		for (size_t frameSize : { size_t(125), size_t(4_KiB), size_t(64_KiB) }) {
+			auto &val = ret.emplace();
+			val.setInteger(frameSize, "frameSize");
+			val.setDouble(runUnmask(frameSize, true), "unmask");
+			val.setDouble(runUnmask(frameSize, false), "unmaskBytewise");
+			runDeflate(val.emplace("deflate"), frameSize, false);
+			runDeflate(val.emplace("deflateNoContextTakeover"), frameSize, true);
+		}
+		rctx.writeData(ret);
+		return DONE;
+	}
+
+protected:
+	static double getRate(size_t bytes, TimeInterval dt) {
+		return double(bytes) / 1_MiB * 1'000'000.0 / std::max(dt.toMicros(), uint64_t(1)); // MiB/sec
+	}
+
+	// previous byte-by-byte unmask, as a baseline
+	static void unmaskBytewise(uint32_t mask, size_t offset, uint8_t *data, size_t nbytes) {
+		uint8_t j = offset % 4;
+		for (size_t i = 0; i < nbytes; ++i, ++j) {
+			if (j >= 4) { j = 0; }
+			data[i] ^= ((mask >> (j * 8)) & 0xFF);
+		}
+	}
+
+	double runUnmask(size_t frameSize, bool vectorized) {
+		Bytes frame(frameSize, uint8_t(0x5A));
+		auto frames = BytesPerTest / frameSize;
+
+		auto t = Time::now();
+		for (size_t i = 0; i < frames; ++ i) {
+			// shifted offset to emulate partial reads from socket
+			if (vectorized) {
+				websocket::unmask(0xA1B2C3D4, i % 4, frame.data(), frame.size());
+			} else {
+				unmaskBytewise(0xA1B2C3D4, i % 4, frame.data(), frame.size());
+			}
+		}
+		return getRate(frames * frameSize, Time::now() - t);
+	}
+
+	void runDeflate(data::Value &val, size_t frameSize, bool noContextTakeover) {
+		auto pool = mem::pool::create(mem::pool::acquire());
+
+		mem::pool::push(pool);
+
+		// typical json message stream
+		StringStream stream;
+		size_t i = 0;
+		while (stream.size() < frameSize) {
+			stream << "{\"id\":" << i << ",\"event\":\"update\",\"data\":{\"field\":\"value-" << i % 16 << "\"}}";
+			++ i;
+		}
+		auto msg = stream.str();
+		msg.resize(frameSize);
+
+		auto deflate = new (pool) websocket::DeflateStream(pool, websocket::DeflateStream::Deflate, 15, noContextTakeover);
+		auto inflate = new (pool) websocket::DeflateStream(pool, websocket::DeflateStream::Inflate, 15, noContextTakeover);
+
+		auto frames = BytesPerTest / frameSize / 16;
+		size_t compressedSize = 0;
+		TimeInterval compressTime;
+		TimeInterval decompressTime;
+
+		Bytes compressed;
+		Bytes decompressed;
+		for (size_t j = 0; j < frames; ++ j) {
+			auto t = Time::now();
+			deflate->compress((const uint8_t *)msg.data(), msg.size(), compressed);
+			compressTime += Time::now() - t;
+			compressedSize += compressed.size();
+
+			t = Time::now();
+			inflate->decompress(compressed.data(), compressed.size(), decompressed, frameSize);
+			decompressTime += Time::now() - t;
+		}
+
+		val.setDouble(getRate(frames * frameSize, compressTime), "compress");
+		val.setDouble(getRate(frames * frameSize, decompressTime), "decompress");
+		val.setDouble(double(compressedSize) / (frames * frameSize), "ratio");
+
+		mem::pool::pop();
+		mem::pool::destroy(pool);
+	}
+};
+
+NS_SA_EXT_END(test)
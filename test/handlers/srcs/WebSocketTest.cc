@@ -0,0 +1,305 @@
+/**
+Copyright (c) 2021 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "Define.h"
+#include "WebSocket.h"
+
+NS_SA_EXT_BEGIN(test)
+
+// Correctness checks for websocket input processing: unmasking, permessage-deflate negotiation,
+// deflate round trip and reading of fragmented (and compressed) messages with FrameReader
+class TestWebsocketHandler : public RequestHandler {
+public:
+	virtual bool isRequestPermitted(Request & rctx) override {
+		return true;
+	}
+
+	virtual int onTranslateName(Request &rctx) override {
+		data::Value ret;
+		bool success = true;
+		auto check = [&] (StringView name, bool value) {
+			ret.setBool(value, name);
+			success = success && value;
+		};
+
+		check("unmask", runUnmask());
+		check("negotiate", runNegotiate());
+		check("deflate", runDeflate());
+		check("fragmented", runFragmented(rctx));
+		ret.setBool(success, "success");
+
+		rctx.writeData(ret);
+		return DONE;
+	}
+
+protected:
+	static constexpr uint8_t MaskBytes[4] = { 0xA1, 0xB2, 0xC3, 0xD4 };
+
+	// client frame with payload masked byte by byte, as described in RFC 6455, 5.3
+	static void writeFrame(Bytes &out, uint8_t opcode, bool fin, bool rsv1, BytesView payload) {
+		out.emplace_back(uint8_t((fin ? 0x80 : 0) | (rsv1 ? 0x40 : 0) | opcode));
+		if (payload.size() < 126) {
+			out.emplace_back(uint8_t(0x80 | payload.size()));
+		} else if (payload.size() <= 0xFFFF) {
+			out.emplace_back(uint8_t(0x80 | 126));
+			out.emplace_back(uint8_t(payload.size() >> 8));
+			out.emplace_back(uint8_t(payload.size() & 0xFF));
+		} else {
+			out.emplace_back(uint8_t(0x80 | 127));
+			for (size_t i = 0; i < 8; ++ i) {
+				out.emplace_back(uint8_t((uint64_t(payload.size()) >> ((7 - i) * 8)) & 0xFF));
+			}
+		}
+		for (auto &it : MaskBytes) {
+			out.emplace_back(it);
+		}
+		for (size_t i = 0; i < payload.size(); ++ i) {
+			out.emplace_back(payload[i] ^ MaskBytes[i % 4]);
+		}
+	}
+
+	// feed reader with chunks of limited size to emulate partial reads from socket
+	static bool feedReader(websocket::FrameReader &reader, BytesView data, size_t chunk,
+			const Callback<void(websocket::FrameType, BytesView)> &cb) {
+		while (!data.empty()) {
+			auto len = std::min(std::min(reader.getRequiredBytes(), chunk), data.size());
+			auto buf = reader.prepare(len);
+			memcpy(buf, data.data(), len);
+			data.offset(len);
+			if (!reader.save(buf, len)) {
+				return false;
+			}
+
+			if (reader.isControlReady()) {
+				cb(reader.type, reader.buffer.get<BytesView>());
+				reader.popFrame();
+			} else if (reader.isFrameReady()) {
+				cb(reader.frame.type, BytesView(reader.frame.buffer));
+				reader.popFrame();
+			}
+		}
+		return true;
+	}
+
+	bool runUnmask() {
+		uint32_t mask;
+		memcpy(&mask, MaskBytes, sizeof(uint32_t));
+
+		Bytes source; source.resize(259);
+		for (size_t i = 0; i < source.size(); ++ i) {
+			source[i] = uint8_t(i * 7 + 3);
+		}
+
+		// every size with every initial offset within mask, so, all vector and scalar tails are covered
+		for (size_t size = 0; size <= source.size(); ++ size) {
+			for (size_t offset = 0; offset < 8; ++ offset) {
+				Bytes data(source.begin(), source.begin() + size);
+				websocket::unmask(mask, offset, data.data(), data.size());
+				for (size_t i = 0; i < size; ++ i) {
+					if (data[i] != (source[i] ^ MaskBytes[(offset + i) % 4])) {
+						return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	bool runNegotiate() {
+		using websocket::DeflateParams;
+
+		auto p = DeflateParams::negotiate("permessage-deflate");
+		if (!p.enabled || p.serverNoContextTakeover || p.clientNoContextTakeover || p.clientMaxWindowBitsOffered
+				|| p.serverMaxWindowBits != 15 || p.clientMaxWindowBits != 15 || p.encode() != "permessage-deflate") {
+			return false;
+		}
+
+		// client_max_window_bits without value only allows server to select window size
+		p = DeflateParams::negotiate("permessage-deflate; client_max_window_bits");
+		if (!p.enabled || !p.clientMaxWindowBitsOffered || p.clientMaxWindowBits != 15
+				|| p.encode() != "permessage-deflate; client_max_window_bits=15") {
+			return false;
+		}
+
+		p = DeflateParams::negotiate("permessage-deflate; client_max_window_bits=10; server_max_window_bits=\"12\"");
+		if (!p.enabled || p.clientMaxWindowBits != 10 || p.serverMaxWindowBits != 12
+				|| p.encode() != "permessage-deflate; server_max_window_bits=12; client_max_window_bits=10") {
+			return false;
+		}
+
+		p = DeflateParams::negotiate("permessage-deflate; server_no_context_takeover; client_no_context_takeover");
+		if (!p.enabled || !p.serverNoContextTakeover || !p.clientNoContextTakeover
+				|| p.encode() != "permessage-deflate; server_no_context_takeover; client_no_context_takeover") {
+			return false;
+		}
+
+		// first offer is declined (zlib can not use 256-byte window), second one is accepted
+		p = DeflateParams::negotiate("permessage-deflate; server_max_window_bits=8, permessage-deflate; client_no_context_takeover");
+		if (!p.enabled || p.serverMaxWindowBits != 15 || !p.clientNoContextTakeover) {
+			return false;
+		}
+
+		for (auto &it : {
+			StringView("x-webkit-deflate-frame"),
+			StringView("permessage-deflate; server_max_window_bits=16"),
+			StringView("permessage-deflate; client_max_window_bits=7"),
+			StringView("permessage-deflate; server_max_window_bits"),
+			StringView("permessage-deflate; server_no_context_takeover=1"),
+			StringView("permessage-deflate; client_no_context_takeover; client_no_context_takeover"),
+			StringView("permessage-deflate; unknown_param"),
+		}) {
+			if (DeflateParams::negotiate(it).enabled) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool runDeflate() {
+		auto pool = mem::pool::create(mem::pool::acquire());
+		mem::pool::push(pool);
+
+		bool success = true;
+		for (bool noContextTakeover : { false, true }) {
+			for (uint8_t windowBits : { uint8_t(9), uint8_t(15) }) {
+				auto deflate = new (pool) websocket::DeflateStream(pool, websocket::DeflateStream::Deflate, windowBits, noContextTakeover);
+				auto inflate = new (pool) websocket::DeflateStream(pool, websocket::DeflateStream::Inflate, windowBits, noContextTakeover);
+
+				// messages share LZ77 window with context takeover
+				for (size_t i = 0; i < 4; ++ i) {
+					StringStream stream;
+					for (size_t j = 0; j < 64 * (i + 1); ++ j) {
+						stream << "{\"id\":" << j << ",\"event\":\"update\",\"message\":" << i << "}";
+					}
+					auto msg = stream.str();
+
+					Bytes compressed;
+					Bytes decompressed;
+					if (deflate->compress((const uint8_t *)msg.data(), msg.size(), compressed) != websocket::DeflateStream::Status::Ok
+							|| compressed.size() >= msg.size()
+							|| inflate->decompress(compressed.data(), compressed.size(), decompressed, msg.size()) != websocket::DeflateStream::Status::Ok
+							|| StringView((const char *)decompressed.data(), decompressed.size()) != msg) {
+						success = false;
+					}
+				}
+			}
+		}
+
+		// output should not grow past max size, even for initial reservation
+		auto deflate = new (pool) websocket::DeflateStream(pool, websocket::DeflateStream::Deflate, 15, true);
+		auto inflate = new (pool) websocket::DeflateStream(pool, websocket::DeflateStream::Inflate, 15, true);
+		String msg(4_KiB, 'a');
+		Bytes compressed;
+		Bytes decompressed;
+		deflate->compress((const uint8_t *)msg.data(), msg.size(), compressed);
+		if (inflate->decompress(compressed.data(), compressed.size(), decompressed, 100) != websocket::DeflateStream::Status::Overflow
+				|| decompressed.size() > 100) {
+			success = false;
+		}
+
+		// stream should be usable after overflow
+		if (inflate->decompress(compressed.data(), compressed.size(), decompressed, msg.size()) != websocket::DeflateStream::Status::Ok
+				|| decompressed.size() != msg.size()) {
+			success = false;
+		}
+
+		mem::pool::pop();
+		mem::pool::destroy(pool);
+		return success;
+	}
+
+	bool runFragmented(Request &rctx) {
+		auto pool = mem::pool::create(mem::pool::acquire());
+		mem::pool::push(pool);
+
+		auto alloc = rctx.request()->connection->bucket_alloc;
+
+		websocket::DeflateParams params;
+		params.enabled = true;
+
+		bool success = true;
+		for (size_t chunk : { size_t(3), size_t(1_KiB) }) {
+			websocket::FrameReader reader(pool, alloc, params);
+			reader.max = 64_KiB;
+
+			auto deflate = new (pool) websocket::DeflateStream(pool, websocket::DeflateStream::Deflate, 15, false);
+
+			String text("Hello, fragmented world!");
+			String large(1_KiB, 'x');
+			Bytes compressed;
+			deflate->compress((const uint8_t *)large.data(), large.size(), compressed);
+
+			Bytes data;
+
+			// text message, split into three frames, with ping between fragments
+			writeFrame(data, 0x1, false, false, BytesView((const uint8_t *)text.data(), 7));
+			writeFrame(data, 0x9, true, false, BytesView((const uint8_t *)"ping", 4));
+			writeFrame(data, 0x0, false, false, BytesView((const uint8_t *)text.data() + 7, 10));
+			writeFrame(data, 0x0, true, false, BytesView((const uint8_t *)text.data() + 17, text.size() - 17));
+
+			// compressed binary message: RSV1 only in first frame, inflated after last one
+			auto half = compressed.size() / 2;
+			writeFrame(data, 0x2, false, true, BytesView(compressed.data(), half));
+			writeFrame(data, 0x0, true, false, BytesView(compressed.data() + half, compressed.size() - half));
+
+			// unfragmented message after fragmented ones
+			writeFrame(data, 0x1, true, false, BytesView((const uint8_t *)text.data(), text.size()));
+
+			Vector<Pair<websocket::FrameType, String>> frames;
+			if (!feedReader(reader, data, chunk, [&] (websocket::FrameType type, BytesView payload) {
+				frames.emplace_back(type, String((const char *)payload.data(), payload.size()));
+			})) {
+				success = false;
+			}
+
+			if (frames.size() != 4
+					|| frames[0].first != websocket::FrameType::Ping || frames[0].second != "ping"
+					|| frames[1].first != websocket::FrameType::Text || frames[1].second != text
+					|| frames[2].first != websocket::FrameType::Binary || frames[2].second != large
+					|| frames[3].first != websocket::FrameType::Text || frames[3].second != text) {
+				success = false;
+			}
+		}
+
+		// continuation without initial frame and new message within fragmented one are protocol errors
+		for (bool continuation : { true, false }) {
+			websocket::FrameReader reader(pool, alloc, websocket::DeflateParams());
+
+			Bytes data;
+			if (!continuation) {
+				writeFrame(data, 0x1, false, false, BytesView((const uint8_t *)"abc", 3));
+			}
+			writeFrame(data, continuation ? 0x0 : 0x1, true, false, BytesView((const uint8_t *)"def", 3));
+
+			if (feedReader(reader, data, data.size(), [&] (websocket::FrameType, BytesView) { })
+					|| reader.error != websocket::FrameReader::Error::InvalidSegment) {
+				success = false;
+			}
+		}
+
+		mem::pool::pop();
+		mem::pool::destroy(pool);
+		return success;
+	}
+};
+
+NS_SA_EXT_END(test)
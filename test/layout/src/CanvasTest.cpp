@@ -0,0 +1,170 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/**
+Copyright (c) 2023 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+
+#include "SPLayout.h"
+#include "SLCanvas.h"
+#include "SLPath.h"
+#include "SLTesselator.h"
+#include "Test.h"
+
+NS_SP_BEGIN
+
+struct CanvasTest : Test {
+	CanvasTest() : Test("CanvasTest") { }
+
+	using Canvas = layout::Canvas;
+	using Path = layout::Path;
+	using Mat4 = layout::Mat4;
+
+	// summary of triangles, emitted by canvas in screen space
+	struct DrawResult {
+		size_t flushes = 0;
+		size_t triangles = 0;
+		float area = 0.0f;
+		float minX = maxOf<float>(), minY = maxOf<float>();
+		float maxX = -maxOf<float>(), maxY = -maxOf<float>();
+
+		bool isEqual(const DrawResult &other) const {
+			const float e = 1e-2f;
+			return std::abs(area - other.area) < e * std::max(1.0f, area)
+				&& std::abs(minX - other.minX) < e && std::abs(minY - other.minY) < e
+				&& std::abs(maxX - other.maxX) < e && std::abs(maxY - other.maxY) < e;
+		}
+	};
+
+	static void collect(Canvas *canvas, DrawResult &result) {
+		++ result.flushes;
+
+		auto &tess = canvas->getTess();
+		auto &t = canvas->getTransform();
+		if (tess.empty()) {
+			return;
+		}
+
+		auto res = tessVecResultTriangles((TESStesselator **)tess.data(), int(tess.size()));
+		if (!res) {
+			return;
+		}
+
+		auto verts = res->triangles.vertexBuffer;
+		auto elts = res->triangles.elementsBuffer;
+		for (int i = 0; i < res->triangles.elementCount; ++ i) {
+			float x[3], y[3];
+			for (int j = 0; j < 3; ++ j) {
+				auto &v = verts[elts[i * 3 + j]];
+				x[j] = t.m[0] * v.x + t.m[4] * v.y + t.m[12];
+				y[j] = t.m[1] * v.x + t.m[5] * v.y + t.m[13];
+				result.minX = std::min(result.minX, x[j]); result.maxX = std::max(result.maxX, x[j]);
+				result.minY = std::min(result.minY, y[j]); result.maxY = std::max(result.maxY, y[j]);
+			}
+			result.area += std::abs((x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0])) * 0.5f;
+			++ result.triangles;
+		}
+	}
+
+	// draws path with every transform, in batch or one by one
+	static DrawResult draw(const Path &path, const Vector<Mat4> &transforms, bool batch) {
+		DrawResult ret;
+		auto canvas = Rc<Canvas>::create();
+		canvas->setFlushCallback([&] {
+			collect(canvas, ret);
+		});
+
+		canvas->translate(100.0f, 100.0f);
+		if (batch) {
+			canvas->beginBatch();
+		}
+		for (auto &it : transforms) {
+			canvas->draw(path, it);
+		}
+		if (batch) {
+			canvas->endBatch();
+		}
+		return ret;
+	}
+
+	virtual bool run() override {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		// asymmetric shape, so reflection can not produce the same geometry
+		Path path;
+		path.moveTo(0.0f, 0.0f).lineTo(40.0f, 0.0f).lineTo(40.0f, 10.0f).lineTo(10.0f, 30.0f).lineTo(0.0f, 30.0f).closePath();
+		path.setStyle(Path::Style::Fill);
+		path.setAntialiased(false);
+		path.setFillColor(layout::Color4B(255, 255, 255, 255));
+
+		auto makeTransform = [] (float angle, float tx, float ty, float sx = 1.0f, float sy = 1.0f) {
+			Mat4 ret;
+			Mat4::createTranslation(tx, ty, 0.0f, &ret);
+			ret.rotateZ(angle);
+			ret.scale(sx, sy, 1.0f);
+			return ret;
+		};
+
+		auto check = [&] (StringView name, const Vector<Mat4> &transforms, size_t batchFlushes) {
+			auto batched = draw(path, transforms, true);
+			auto single = draw(path, transforms, false);
+			if (batched.flushes != batchFlushes || single.flushes != transforms.size() || !batched.isEqual(single)) {
+				stream << "\t\t" << name << ": flushes: " << batched.flushes << " vs. " << single.flushes
+						<< "; area: " << batched.area << " vs. " << single.area
+						<< "; bounds: (" << batched.minX << ", " << batched.minY << ", " << batched.maxX << ", " << batched.maxY
+						<< ") vs. (" << single.minX << ", " << single.minY << ", " << single.maxX << ", " << single.maxY << ")\n";
+				return false;
+			}
+			return true;
+		};
+
+		runTest(stream, "Rigid transform batching", count, passed, [&] {
+			// rotated and moved copies are drawn within single batch
+			return check("Rigid", Vector<Mat4>{
+				makeTransform(0.0f, 10.0f, 20.0f),
+				makeTransform(float(M_PI) / 6.0f, 120.0f, 10.0f),
+				makeTransform(-float(M_PI) / 2.0f, 20.0f, 200.0f),
+				makeTransform(float(M_PI), 300.0f, 300.0f),
+			}, 1);
+		});
+
+		runTest(stream, "Non-rigid transform flush", count, passed, [&] {
+			// reflection preserves distances, but reverses orientation, so batch should be flushed on it
+			return check("Reflection", Vector<Mat4>{
+				makeTransform(0.0f, 10.0f, 20.0f),
+				makeTransform(0.0f, 200.0f, 20.0f, -1.0f, 1.0f),
+			}, 2) && check("Scale", Vector<Mat4>{
+				makeTransform(0.0f, 10.0f, 20.0f),
+				makeTransform(0.0f, 200.0f, 20.0f, 2.0f, 2.0f),
+			}, 2);
+		});
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+} CanvasTest;
+
+NS_SP_END
@@ -0,0 +1,377 @@
+/**
+ Copyright (c) 2023 Roman Katuntsev <sbkarr@stappler.org>
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ **/
+
+#include "SPLayout.h"
+#include "SPTime.h"
+#include "SLFontSource.h"
+#include "SLFontFormatter.h"
+#include "Test.h"
+
+NS_SP_BEGIN
+
+struct FontFormatterTest : Test {
+	FontFormatterTest() : Test("FontFormatterTest") { }
+
+	using FontData = layout::FontData;
+	using FontLayoutId = layout::FontLayoutId;
+	using FontParameters = layout::FontParameters;
+	using TextParameters = layout::TextParameters;
+	using TextTransform = layout::TextTransform;
+	using CharLayout = layout::CharLayout;
+	using CharSpec = layout::CharSpec;
+	using FormatSpec = layout::FormatSpec;
+	using Formatter = layout::Formatter;
+
+	// Formatter source with single font, that uses FontData directly, without FreeType
+	struct DataSource : layout::FormatterSourceInterface {
+		DataSource(Rc<FontData> &&d) : data(move(d)) { }
+
+		virtual FontLayoutId getLayout(const FontParameters &f, float scale) override { return FontLayoutId(0); }
+		virtual void addString(FontLayoutId, const layout::FontCharString &) override { }
+		virtual uint16_t getFontHeight(FontLayoutId) override { return data->getHeight(); }
+		virtual int16_t getKerningAmount(FontLayoutId, char16_t first, char16_t second, uint16_t face) const override {
+			return data->kerningAmount(first, second);
+		}
+		virtual layout::Metrics getMetrics(FontLayoutId) override { return data->getMetrics(); }
+		virtual CharLayout getChar(FontLayoutId, char16_t c, uint16_t &face) override {
+			face = 0;
+			return data->getChar(c);
+		}
+		virtual StringView getFontName(FontLayoutId) override { return "DataSource"; }
+		virtual uint32_t getDataGeneration() const override { return generation; }
+
+		// replaces data for the same layout id, like FontLayout upgrade with new chars
+		void setData(Rc<FontData> &&d) {
+			data = move(d);
+			++ generation;
+		}
+
+		Rc<FontData> data;
+		uint32_t generation = 0;
+	};
+
+	static bool isKerned(char16_t a, char16_t b) {
+		return (a * 131 + b * 31) % 11 == 0;
+	}
+
+	static Rc<FontData> makeFontData(bool tables) {
+		auto ret = Rc<FontData>::create();
+		ret->metrics.size = 16;
+		ret->metrics.height = 20;
+		ret->metrics.ascender = 15;
+		ret->metrics.descender = -5;
+
+		auto addRange = [&] (char16_t first, char16_t last) {
+			for (char16_t c = first; c <= last; ++ c) {
+				ret->chars.emplace_back(CharLayout{c, int16_t(c % 3), int16_t(-12 + c % 5), uint16_t(6 + (c * 7) % 9)});
+			}
+		};
+
+		addRange(0x20, 0x7E);
+		addRange(0xA0, 0xFF);
+		addRange(0x400, 0x45F);
+		addRange(0x2010, 0x2027);
+
+		for (auto &a : ret->chars) {
+			for (auto &b : ret->chars) {
+				if (a.charID > 0x20 && b.charID > 0x20 && isKerned(a.charID, b.charID)) {
+					ret->kerning.emplace(uint32_t(a.charID) << 16 | b.charID, -int16_t(1 + (a.charID + b.charID) % 3));
+				}
+			}
+		}
+
+		if (tables) {
+			ret->updateTables();
+		}
+		return ret;
+	}
+
+	static Vector<WideString> makeDocument(size_t paragraphs, size_t words) {
+		const char16_t *syllables[] = {
+			u"ka", u"lo", u"mi", u"tra", u"ven", u"sto", u"ri", u"an", u"que", u"wy",
+			u"по", u"ка", u"ли", u"сто", u"ра", u"ны", u"ве", u"жи", u"ко", u"ть",
+		};
+
+		uint32_t seed = 42;
+		auto next = [&] {
+			seed = seed * 1103515245 + 12345;
+			return (seed >> 16) & 0x7FFF;
+		};
+
+		Vector<WideString> vocabulary;
+		for (size_t i = 0; i < 2000; ++ i) {
+			WideString word;
+			auto len = 1 + next() % 4;
+			auto base = (next() % 2) * 10;
+			for (size_t j = 0; j < len; ++ j) {
+				word.append(syllables[base + next() % 10]);
+			}
+			vocabulary.emplace_back(move(word));
+		}
+
+		Vector<WideString> ret;
+		for (size_t i = 0; i < paragraphs; ++ i) {
+			WideString p;
+			for (size_t j = 0; j < words; ++ j) {
+				// most of words is from short head of vocabulary, like in natural text
+				auto idx = next() % 16 ? next() % 200 : next() % vocabulary.size();
+				if (!p.empty()) {
+					p.push_back(u' ');
+				}
+				p.append(vocabulary[idx]);
+				switch (next() % 16) {
+				case 0: p.push_back(u','); break;
+				case 1: p.push_back(u'.'); break;
+				case 2: p.append(u" —"); break;
+				default: break;
+				}
+			}
+			ret.emplace_back(move(p));
+		}
+		return ret;
+	}
+
+	static size_t formatDocument(const Rc<DataSource> &source, const Vector<WideString> &doc, uint16_t width,
+			Vector<CharSpec> *chars = nullptr, size_t *lines = nullptr) {
+		FontParameters font;
+		TextParameters text;
+
+		Formatter formatter;
+		size_t ret = 0;
+		for (auto &it : doc) {
+			FormatSpec spec(Rc<layout::FormatterSourceInterface>(source.get()), it.size(), 1);
+			formatter.reset(&spec);
+			formatter.setWidth(width);
+			formatter.begin(0);
+			formatter.read(font, text, it);
+			formatter.finalize();
+
+			ret += spec.chars.size();
+			if (chars) {
+				chars->insert(chars->end(), spec.chars.begin(), spec.chars.end());
+			}
+			if (lines) {
+				*lines += spec.lines.size();
+			}
+		}
+		return ret;
+	}
+
+	virtual bool run() override {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		auto tables = makeFontData(true);
+		auto fallback = makeFontData(false);
+
+		runTest(stream, "Glyph and kerning tables", count, passed, [&] {
+			for (uint32_t c = 0; c <= 0xFFFF; ++ c) {
+				auto a = tables->getChar(char16_t(c));
+				auto b = fallback->getChar(char16_t(c));
+				if (a.charID != b.charID || a.xOffset != b.xOffset || a.yOffset != b.yOffset || a.xAdvance != b.xAdvance) {
+					stream << "\t\tChar mismatch: " << c << "\n";
+					return false;
+				}
+			}
+
+			for (auto &a : fallback->chars) {
+				for (auto &b : fallback->chars) {
+					if (tables->kerningAmount(a.charID, b.charID) != fallback->kerningAmount(a.charID, b.charID)) {
+						stream << "\t\tKerning mismatch: " << uint32_t(a.charID) << " " << uint32_t(b.charID) << "\n";
+						return false;
+					}
+				}
+			}
+
+			stream << "\t\tpages: " << tables->charPages.size() << "; kerning pairs: " << tables->kerning.size()
+					<< "; kerning slots: " << tables->kerningTable.size() << "\n";
+			return tables->kerningAmount(0, u'a') == 0 && tables->kerningAmount(u'a', 0) == 0;
+		});
+
+		runTest(stream, "Shaping cache", count, passed, [&] {
+			auto source = Rc<DataSource>::alloc(Rc<FontData>(tables));
+			WideString str(u"kalo stomi kalo trakalo stomi kalo ставка по ставка kalo stomi");
+
+			FontParameters font;
+			TextParameters text;
+			Formatter formatter;
+
+			for (auto transform : { TextTransform::None, TextTransform::Uppercase, TextTransform::None }) {
+				text.textTransform = transform;
+
+				FormatSpec spec(Rc<layout::FormatterSourceInterface>(source.get()));
+				formatter.reset(&spec);
+				formatter.begin(0);
+				formatter.read(font, text, str);
+				formatter.finalize();
+
+				// without width limit, text is a single line, so positions can be calculated directly
+				int16_t x = 0;
+				char16_t prev = 0;
+				size_t idx = 0;
+				for (auto c : str) {
+					char16_t ch = (transform == TextTransform::Uppercase) ? string::toupper(c) : c;
+					if (c != u' ') {
+						x += tables->kerningAmount(prev, c);
+					}
+
+					auto &spec_c = spec.chars.at(idx ++);
+					auto adv = tables->getChar(ch).xAdvance;
+					if (spec_c.charID != ch || spec_c.pos != x || spec_c.advance != adv) {
+						stream << "\t\tMismatch at " << idx - 1 << ": " << string::toUtf8(ch) << " " << spec_c.pos << " " << x << "\n";
+						return false;
+					}
+
+					x += adv;
+					prev = (c == u' ') ? 0 : c;
+				}
+
+				if (idx != spec.chars.size()) {
+					return false;
+				}
+			}
+			return true;
+		});
+
+		runTest(stream, "Shaping cache invalidation", count, passed, [&] {
+			auto source = Rc<DataSource>::alloc(makeFontData(true));
+			WideString str(u"kalo stomi kalo");
+
+			auto upgraded = makeFontData(false);
+			for (auto &it : upgraded->chars) {
+				it.xAdvance += 3;
+			}
+			upgraded->updateTables();
+
+			FontParameters font;
+			TextParameters text;
+			Formatter formatter;
+
+			// same formatter is used before and after data replacement, so cached words should be dropped
+			for (size_t i = 0; i < 2; ++ i) {
+				if (i == 1) {
+					source->setData(Rc<FontData>(upgraded));
+				}
+
+				FormatSpec spec(Rc<layout::FormatterSourceInterface>(source.get()));
+				formatter.reset(&spec);
+				formatter.begin(0);
+				formatter.read(font, text, str);
+				formatter.finalize();
+
+				if (spec.chars.size() != str.size()) {
+					return false;
+				}
+
+				for (size_t j = 0; j < str.size(); ++ j) {
+					auto adv = source->data->getChar(str[j]).xAdvance;
+					if (spec.chars[j].advance != adv) {
+						stream << "\t\tStale advance at " << j << ": " << spec.chars[j].advance << " vs. " << adv << "\n";
+						return false;
+					}
+				}
+			}
+			return true;
+		});
+
+		runTest(stream, "Formatting benchmark", count, passed, [&] {
+			auto doc = makeDocument(256, 180);
+
+			size_t docSize = 0;
+			for (auto &it : doc) {
+				docSize += it.size();
+			}
+
+			auto tablesSource = Rc<DataSource>::alloc(Rc<FontData>(tables));
+			auto fallbackSource = Rc<DataSource>::alloc(Rc<FontData>(fallback));
+
+			Vector<CharSpec> tablesChars, fallbackChars;
+			size_t tablesLines = 0, fallbackLines = 0;
+			formatDocument(tablesSource, doc, 600, &tablesChars, &tablesLines);
+			formatDocument(fallbackSource, doc, 600, &fallbackChars, &fallbackLines);
+
+			if (tablesChars.size() != fallbackChars.size() || tablesLines != fallbackLines) {
+				stream << "\t\tResult mismatch\n";
+				return false;
+			}
+
+			for (size_t i = 0; i < tablesChars.size(); ++ i) {
+				auto &a = tablesChars[i];
+				auto &b = fallbackChars[i];
+				if (a.charID != b.charID || a.pos != b.pos || a.advance != b.advance) {
+					stream << "\t\tResult mismatch at " << i << "\n";
+					return false;
+				}
+			}
+
+			stream << "\t\tDocument: " << doc.size() << " paragraphs; " << docSize << " chars; " << tablesLines << " lines\n";
+
+			const size_t ntests = 8;
+
+			auto measureLookup = [&] (const Rc<FontData> &data) {
+				size_t ret = 0;
+				auto t = Time::now();
+				for (size_t i = 0; i < ntests; ++ i) {
+					for (auto &p : doc) {
+						char16_t prev = 0;
+						for (auto c : p) {
+							ret += data->getChar(c).xAdvance + data->kerningAmount(prev, c);
+							prev = c;
+						}
+					}
+				}
+				stream << (Time::now() - t).toMicros() / ntests << " us";
+				return ret;
+			};
+
+			auto measureFormat = [&] (const Rc<DataSource> &source) {
+				size_t ret = 0;
+				auto t = Time::now();
+				for (size_t i = 0; i < ntests; ++ i) {
+					ret += formatDocument(source, doc, 600);
+				}
+				stream << (Time::now() - t).toMicros() / ntests << " us";
+				return ret;
+			};
+
+			stream << "\t\tLookup: sorted chars and map: ";
+			auto a = measureLookup(fallback);
+			stream << "; flat tables: ";
+			auto b = measureLookup(tables);
+			stream << "\n\t\tFormatting: sorted chars and map: ";
+			auto c = measureFormat(fallbackSource);
+			stream << "; flat tables: ";
+			auto d = measureFormat(tablesSource);
+			stream << "\n";
+
+			return a == b && c == d;
+		});
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+} FontFormatterTest;
+
+NS_SP_END
@@ -0,0 +1,373 @@
+/**
+ Copyright (c) 2023 Roman Katuntsev <sbkarr@stappler.org>
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ **/
+
+#include "SPLayout.h"
+#include "SPTime.h"
+#include "SPFilesystem.h"
+#include "SLBuilder.h"
+#include "SLResult.h"
+#include "SLFontLibrary.h"
+#include "Test.h"
+
+#include <thread>
+
+NS_SP_BEGIN
+
+struct LayoutBuilderTest : Test {
+	LayoutBuilderTest() : Test("LayoutBuilderTest") { }
+
+	using FontFace = layout::style::FontFace;
+	using MediaParameters = layout::MediaParameters;
+	using Builder = layout::Builder;
+	using Result = layout::Result;
+
+	// FreeType interface is not thread-safe, so, like application font library, we use one per thread
+	struct FontSource : layout::FontSource {
+		static layout::FreeTypeInterface *getInterface(const String &fallback) {
+			static thread_local Rc<layout::FreeTypeInterface> tl_interface;
+			if (!tl_interface) {
+				tl_interface = Rc<layout::FreeTypeInterface>::create(fallback);
+			}
+			return tl_interface;
+		}
+
+		bool init(StringView path) {
+			FontFaceMap map;
+			map.emplace("default", Vector<FontFace>{FontFace(path.str())});
+
+			if (!layout::FontSource::init(move(map), [] (const layout::FontSource *, const String &file) {
+				return filesystem::readIntoMemory(file);
+			})) {
+				return false;
+			}
+
+			_metricCallback = [fallback = path.str()] (const layout::FontSource *source, const Vector<FontFace::FontFaceSource> &srcs,
+					layout::FontSize size, const layout::ReceiptCallback &cb) {
+				return getInterface(fallback)->requestMetrics(source, srcs, size, cb);
+			};
+
+			_layoutCallback = [fallback = path.str()] (const layout::FontSource *source, const Vector<FontFace::FontFaceSource> &srcs,
+					const Rc<layout::FontData> &data, const Vector<char16_t> &chars, const layout::ReceiptCallback &cb) {
+				return getInterface(fallback)->requestLayoutUpgrade(source, srcs, data, chars, cb);
+			};
+			return true;
+		}
+	};
+
+	// EPUB-like document: every spine item is a separate xhtml page with its own styles
+	struct BookDocument : layout::Document {
+		bool init(size_t chapters, size_t paragraphs, StringView css) {
+			auto vocabulary = makeVocabulary();
+
+			uint32_t seed = 42;
+			auto next = [&] {
+				seed = seed * 1103515245 + 12345;
+				return (seed >> 16) & 0x7FFF;
+			};
+
+			auto sentence = [&] (StringStream &out, size_t words) {
+				for (size_t i = 0; i < words; ++ i) {
+					if (i > 0) {
+						out << " ";
+					}
+					auto &word = vocabulary[next() % 16 ? next() % 200 : next() % vocabulary.size()];
+					switch (next() % 24) {
+					case 0: out << "<em>" << word << "</em>"; break;
+					case 1: out << "<strong>" << word << "</strong>"; break;
+					case 2: out << "<a href=\"#chapter-" << next() % chapters << "\">" << word << "</a>"; break;
+					default: out << word; break;
+					}
+				}
+				out << ".";
+			};
+
+			_contents.label = "Book";
+			for (size_t i = 0; i < chapters; ++ i) {
+				StringStream out;
+				out << "<html><head><style>" << css << "</style></head><body>"
+						"<h1 id=\"chapter-" << i << "\">Chapter " << i << "</h1>";
+				auto count = paragraphs / 2 + next() % paragraphs;
+				for (size_t j = 0; j < count; ++ j) {
+					if (next() % 12 == 0) {
+						out << "<ul>";
+						for (size_t k = 0; k < 3; ++ k) {
+							out << "<li>";
+							sentence(out, 4 + next() % 8);
+							out << "</li>";
+						}
+						out << "</ul>";
+					} else {
+						out << "<p>";
+						for (size_t k = 0, n = 1 + next() % 6; k < n; ++ k) {
+							sentence(out, 6 + next() % 16);
+							out << " ";
+						}
+						out << "</p>";
+					}
+				}
+				out << "</body></html>";
+
+				auto path = toString("OEBPS/chapter", i, ".xhtml");
+				processHtml(path, out.str());
+				_spine.emplace_back(path);
+				_contents.childs.emplace_back(ContentRecord{toString("Chapter ", i), toString("chapter-", i)});
+			}
+
+			return prepare();
+		}
+
+		static Vector<String> makeVocabulary() {
+			const char *syllables[] = {
+				"ka", "lo", "mi", "tra", "ven", "sto", "ri", "an", "que", "wy",
+				"по", "ка", "ли", "сто", "ра", "ны", "ве", "жи", "ко", "ть",
+			};
+
+			uint32_t seed = 7;
+			auto next = [&] {
+				seed = seed * 1103515245 + 12345;
+				return (seed >> 16) & 0x7FFF;
+			};
+
+			Vector<String> ret;
+			for (size_t i = 0; i < 2000; ++ i) {
+				String word;
+				auto len = 1 + next() % 4;
+				auto base = (next() % 2) * 10;
+				for (size_t j = 0; j < len; ++ j) {
+					word.append(syllables[base + next() % 10]);
+				}
+				ret.emplace_back(move(word));
+			}
+			return ret;
+		}
+	};
+
+	static MediaParameters makeMedia() {
+		MediaParameters media;
+		media.surfaceSize = layout::Size(480.0f, 720.0f);
+		media.flags = layout::RenderFlag::PaginatedLayout;
+		return media;
+	}
+
+	static Rc<Result> render(layout::Document *doc, layout::FontSource *source, uint16_t concurrency,
+			Builder::PartialCallback &&cb = nullptr, layout::HyphenMap *hyphens = nullptr) {
+		Builder builder(doc, makeMedia(), source);
+		builder.setConcurrency(concurrency);
+		if (hyphens) {
+			builder.setHyphens(hyphens);
+		}
+		if (cb) {
+			builder.setPartialCallback(move(cb));
+		}
+		builder.render();
+		return builder.getResult();
+	}
+
+	static bool compareResults(StringStream &stream, const Result *a, const Result *b) {
+		if (a->getContentSize() != b->getContentSize() || a->getNumPages() != b->getNumPages()) {
+			stream << "\t\tContent size mismatch: " << a->getContentSize() << " " << b->getContentSize() << "\n";
+			return false;
+		}
+
+		auto &aObjects = a->getObjects();
+		auto &bObjects = b->getObjects();
+		if (aObjects.size() != bObjects.size() || a->getRefs().size() != b->getRefs().size()) {
+			stream << "\t\tObjects mismatch: " << aObjects.size() << " " << bObjects.size() << "\n";
+			return false;
+		}
+
+		for (size_t i = 0; i < aObjects.size(); ++ i) {
+			auto x = aObjects[i];
+			auto y = bObjects[i];
+			if (x->type != y->type || x->index != i || y->index != i || !x->bbox.equals(y->bbox)) {
+				stream << "\t\tObject mismatch at " << i << ": " << x->bbox << " " << y->bbox << "\n";
+				return false;
+			}
+			if (x->isLabel() && (x->asLabel()->format.chars.size() != y->asLabel()->format.chars.size()
+					|| x->asLabel()->format.lines.size() != y->asLabel()->format.lines.size())) {
+				stream << "\t\tLabel mismatch at " << i << "\n";
+				return false;
+			}
+		}
+
+		for (size_t i = 0; i < a->getRefs().size(); ++ i) {
+			auto x = a->getRefs()[i];
+			auto y = b->getRefs()[i];
+			if (!x->bbox.equals(y->bbox) || x->target != y->target || y->index != i) {
+				stream << "\t\tLink mismatch at " << i << "\n";
+				return false;
+			}
+		}
+
+		if (a->getIndex() != b->getIndex()) {
+			stream << "\t\tIndex mismatch\n";
+			for (auto &it : a->getIndex()) { auto f = b->getIndex().find(it.first); stream << it.first << " " << it.second << " " << (f == b->getIndex().end() ? layout::Vec2(-1,-1) : f->second) << "\n"; }
+			return false;
+		}
+
+		auto &aBounds = a->getBounds();
+		auto &bBounds = b->getBounds();
+		if (aBounds.size() != bBounds.size()) {
+			return false;
+		}
+
+		for (size_t i = 0; i < aBounds.size(); ++ i) {
+			if (aBounds[i].start != bBounds[i].start || aBounds[i].end != bBounds[i].end || aBounds[i].page != bBounds[i].page) {
+				stream << "\t\tBounds mismatch at " << i << "\n";
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// every spine item should start from new page, every label should contain text
+	static bool checkPages(StringStream &stream, const layout::Document *doc, const Result *res) {
+		for (auto &it : res->getObjects()) {
+			if (it->isLabel() && it->asLabel()->format.chars.empty()) {
+				stream << "\t\tEmpty label: " << it->index << "\n";
+				return false;
+			}
+		}
+
+		float prev = -1.0f;
+		for (auto &it : doc->getSpine()) {
+			auto idx = res->getIndex().find(it);
+			if (idx == res->getIndex().end() || idx->second.y <= prev
+					|| std::fmod(idx->second.y, res->getMedia().surfaceSize.height) != 0.0f) {
+				stream << "\t\tInvalid chapter position: " << it << "\n";
+				return false;
+			}
+			prev = idx->second.y;
+		}
+		return true;
+	}
+
+	virtual bool run() override {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		auto fontPath = filesystem::currentDir("../../components/document/gui-test/common/fonts/DejaVuSansStappler.woff");
+		auto source = Rc<FontSource>::create(fontPath);
+
+		// one dictionary is shared by all chapter builders
+		auto hyphens = Rc<layout::HyphenMap>::create();
+		hyphens->addHyphenDict(CharGroupId::Latin,
+				layout::FilePath(filesystem::currentDir("../../components/document/gui-test/common/hyphen/hyph_en_GB.dic")));
+
+		const StringView css("p { text-indent: 1.5em; margin: 0.5em 0; } h1 { font-size: 2em; margin: 1em 0; }");
+		const StringView parityCss("p { text-indent: 1.5em; margin: 0.5em 0; } h1 { page-break-before: right; }");
+
+		runTest(stream, "Chapter layout", count, passed, [&] {
+			if (!filesystem::exists(fontPath)) {
+				stream << "\t\tFont not found: " << fontPath << "\n";
+				return false;
+			}
+
+			for (auto &it : { css, parityCss }) {
+				for (layout::HyphenMap *h : { (layout::HyphenMap *)nullptr, hyphens.get() }) {
+					auto doc = Rc<BookDocument>::create(16, 24, it);
+					auto serial = render(doc, source, 1, nullptr, h);
+					auto inplace = render(doc, source, 1, [] (Result *) { }, h);
+					auto parallel = render(doc, source, 4, nullptr, h);
+
+					if (!checkPages(stream, doc, serial) || !compareResults(stream, serial, inplace) || !compareResults(stream, serial, parallel)) {
+						return false;
+					}
+				}
+			}
+			return true;
+		});
+
+		runTest(stream, "Partial results", count, passed, [&] {
+			auto doc = Rc<BookDocument>::create(16, 24, css);
+
+			Vector<Rc<Result>> partials;
+			auto result = render(doc, source, 4, [&] (Result *res) {
+				partials.emplace_back(res);
+			});
+
+			if (partials.empty()) {
+				return false;
+			}
+
+			// every partial result is a prefix of the final one
+			float height = 0.0f;
+			for (auto &it : partials) {
+				auto &objects = it->getObjects();
+				if (objects.size() > result->getObjects().size() || it->getContentSize().height <= height
+						|| !std::equal(objects.begin(), objects.end(), result->getObjects().begin())) {
+					return false;
+				}
+				height = it->getContentSize().height;
+			}
+
+			stream << "\t\t" << partials.size() << " partial results; first: " << partials.front()->getNumPages() << " of "
+					<< result->getNumPages() << " pages\n";
+			return true;
+		});
+
+		runTest(stream, "Layout benchmark", count, passed, [&] {
+			auto t = Time::now();
+			auto doc = Rc<BookDocument>::create(160, 48, css);
+
+			stream << "\t\tDocument: " << doc->getSpine().size() << " chapters; prepared in " << (Time::now() - t).toMillis() << " ms\n";
+
+			uint16_t threads = std::max(uint16_t(std::thread::hardware_concurrency()), uint16_t(2));
+
+			auto measure = [&] (StringView name, uint16_t concurrency, bool partial) {
+				TimeInterval first;
+				auto t = Time::now();
+				auto res = render(doc, source, concurrency, partial ? Builder::PartialCallback([&] (Result *) {
+					if (!first) {
+						first = Time::now() - t;
+					}
+				}) : nullptr);
+				auto full = Time::now() - t;
+				if (!first) {
+					first = full;
+				}
+
+				stream << "\t\t" << name << ": " << full.toMillis() << " ms; first pages: " << first.toMillis()
+						<< " ms; " << res->getNumPages() << " pages; " << res->getObjects().size() << " objects\n";
+				return res;
+			};
+
+			// first pass to fill font caches
+			render(doc, source, 1);
+
+			auto serial = measure("serial", 1, false);
+			auto inplace = measure("chapters", 1, true);
+			auto parallel = measure(toString("chapters on ", threads, " threads"), threads, true);
+
+			return compareResults(stream, serial, inplace) && compareResults(stream, serial, parallel);
+		});
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+} LayoutBuilderTest;
+
+NS_SP_END
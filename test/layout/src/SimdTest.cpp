@@ -0,0 +1,235 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/**
+Copyright (c) 2023 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "SPLayout.h"
+#include "SPTime.h"
+#include "SLSIMD.h"
+#include "Test.h"
+
+NS_SP_BEGIN
+
+struct SimdTest : Test {
+	SimdTest() : Test("SimdTest") { }
+
+	using SimdLevel = layout::SimdLevel;
+	using FunctionTable = layout::FunctionTable;
+	using Mat4 = layout::Mat4;
+	using Vec4 = layout::Vec4;
+	using Color4B = layout::Color4B;
+	using Color4F = layout::Color4F;
+
+	static StringView getLevelName(SimdLevel level) {
+		switch (level) {
+		case SimdLevel::Default: return "Default";
+		case SimdLevel::Sse41: return "SSE4.1";
+		case SimdLevel::Avx2: return "AVX2";
+		case SimdLevel::Avx512: return "AVX-512";
+		}
+		return StringView();
+	}
+
+	static bool isEqual(const float *a, const float *b, size_t count) {
+		for (size_t i = 0; i < count; ++ i) {
+			if (std::abs(a[i] - b[i]) > 1e-4f * std::max(1.0f, std::abs(a[i]))) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static void multiplyMat4(const Mat4 &m1, const Mat4 &m2, Mat4 &dst) {
+		Mat4 ret;
+		for (size_t col = 0; col < 4; ++ col) {
+			for (size_t row = 0; row < 4; ++ row) {
+				ret.m[col * 4 + row] = m1.m[row] * m2.m[col * 4] + m1.m[4 + row] * m2.m[col * 4 + 1]
+					+ m1.m[8 + row] * m2.m[col * 4 + 2] + m1.m[12 + row] * m2.m[col * 4 + 3];
+			}
+		}
+		dst = ret;
+	}
+
+	Mat4 makeMatrix() const {
+		Mat4 ret;
+		for (auto &it : ret.m) {
+			it = rand_float() * 4.0f - 2.0f;
+		}
+		return ret;
+	}
+
+	bool testTable(StringStream &stream, const FunctionTable &table, StringView name) {
+		// odd sizes to test tail processing
+		const size_t counts[] = { 0, 1, 3, 7, 17, 1023 };
+
+		for (size_t i = 0; i < 16; ++ i) {
+			auto m1 = makeMatrix();
+			auto m2 = makeMatrix();
+			Mat4 expected, ret;
+
+			multiplyMat4(m1, m2, expected);
+			table.multiplyMat4(m1, m2, ret);
+			table.multiplyMat4(m1, m2, m2); // dst is an argument
+			if (!isEqual(expected.m, ret.m, 16) || !isEqual(expected.m, m2.m, 16)) {
+				stream << "\t\t" << name << ": multiplyMat4 failed\n";
+				return false;
+			}
+
+			Vec4 v(rand_float(), rand_float(), rand_float(), rand_float()), vret;
+			table.transformVec4(m1, v, vret);
+			const float vexpected[4] = {
+				v.x * m1.m[0] + v.y * m1.m[4] + v.z * m1.m[8] + v.w * m1.m[12],
+				v.x * m1.m[1] + v.y * m1.m[5] + v.z * m1.m[9] + v.w * m1.m[13],
+				v.x * m1.m[2] + v.y * m1.m[6] + v.z * m1.m[10] + v.w * m1.m[14],
+				v.x * m1.m[3] + v.y * m1.m[7] + v.z * m1.m[11] + v.w * m1.m[15],
+			};
+			if (!isEqual(vexpected, &vret.x, 4)) {
+				stream << "\t\t" << name << ": transformVec4 failed\n";
+				return false;
+			}
+		}
+
+		auto m = makeMatrix();
+		for (auto count : counts) {
+			Vector<float> points(count * 2);
+			Vector<float> expected(count * 2);
+			for (size_t i = 0; i < count; ++ i) {
+				points[i * 2] = rand_float() * 1000.0f;
+				points[i * 2 + 1] = rand_float() * 1000.0f;
+				expected[i * 2] = points[i * 2] * m.m[0] + points[i * 2 + 1] * m.m[4] + m.m[12];
+				expected[i * 2 + 1] = points[i * 2] * m.m[1] + points[i * 2 + 1] * m.m[5] + m.m[13];
+			}
+
+			table.transformPoints(m, points.data(), points.data(), count);
+			if (!isEqual(expected.data(), points.data(), count * 2)) {
+				stream << "\t\t" << name << ": transformPoints failed for " << count << " points\n";
+				return false;
+			}
+		}
+
+		for (auto count : counts) {
+			for (auto p : { 0.0f, 0.25f, 0.5f, 0.999f, 1.0f }) {
+				Vector<Color4B> a(count), b(count), ret(count);
+				Vector<Color4F> fa(count), fb(count), fret(count);
+				for (size_t i = 0; i < count; ++ i) {
+					a[i] = Color4B(rand_uint32_t() & 0xFF, rand_uint32_t() & 0xFF, rand_uint32_t() & 0xFF, rand_uint32_t() & 0xFF);
+					b[i] = Color4B(rand_uint32_t() & 0xFF, rand_uint32_t() & 0xFF, rand_uint32_t() & 0xFF, rand_uint32_t() & 0xFF);
+					fa[i] = Color4F(a[i]);
+					fb[i] = Color4F(b[i]);
+				}
+
+				table.progressColor4B(a.data(), b.data(), ret.data(), count, p);
+				table.progressColor4F(fa.data(), fb.data(), fret.data(), count, p);
+				for (size_t i = 0; i < count; ++ i) {
+					auto fexpected = Color4F::progress(fa[i], fb[i], p);
+					if (ret[i] != Color4B::progress(a[i], b[i], p) || !isEqual(&fexpected.r, &fret[i].r, 4)) {
+						stream << "\t\t" << name << ": progressColor failed for " << count << " colors at " << i << "\n";
+						return false;
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+	virtual bool run() override {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		const SimdLevel levels[] = { SimdLevel::Default, SimdLevel::Sse41, SimdLevel::Avx2, SimdLevel::Avx512 };
+
+		runTest(stream, "Function tables", count, passed, [&] {
+			stream << "\t\tSelected: " << getLevelName(layout::get_simd_level()) << "\n";
+			if (layout::LayoutFunctionTable != layout::get_simd_table(layout::get_simd_level())) {
+				return false;
+			}
+
+			for (auto level : levels) {
+				if (auto table = layout::get_simd_table(level)) {
+					if (!testTable(stream, *table, getLevelName(level))) {
+						return false;
+					}
+				} else {
+					stream << "\t\t" << getLevelName(level) << ": not supported\n";
+				}
+			}
+			return true;
+		});
+
+		runTest(stream, "Kernel benchmark", count, passed, [&] {
+			const size_t npoints = 64 * 1024;
+			const size_t ntests = 256;
+
+			auto m = makeMatrix();
+			Vector<Mat4> mats(1024, m);
+			Vector<Mat4> targetMats(1024);
+			Vector<float> points(npoints * 2, 1.0f);
+			Vector<float> targetPoints(npoints * 2);
+			Vector<Color4B> colorsB(npoints, Color4B(10, 20, 30, 40));
+			Vector<Color4F> colorsF(npoints, Color4F(0.1f, 0.2f, 0.3f, 0.4f));
+			Vector<Color4B> targetB(npoints, Color4B::WHITE);
+			Vector<Color4F> targetF(npoints, Color4F::WHITE);
+
+			auto measure = [&] (const auto &cb) {
+				auto t = Time::now();
+				for (size_t i = 0; i < ntests; ++ i) {
+					cb();
+				}
+				return (Time::now() - t).toMicros() / ntests;
+			};
+
+			for (auto level : levels) {
+				auto table = layout::get_simd_table(level);
+				if (!table) {
+					continue;
+				}
+
+				stream << "\t\t" << getLevelName(level) << ":";
+				stream << " multiplyMat4 (x1024): " << measure([&] {
+					for (size_t i = 0; i < mats.size(); ++ i) {
+						table->multiplyMat4(mats[i], m, targetMats[i]);
+					}
+				}) << " us;";
+				stream << " transformPoints: " << measure([&] {
+					table->transformPoints(m, points.data(), targetPoints.data(), npoints);
+				}) << " us;";
+				stream << " progressColor4B: " << measure([&] {
+					table->progressColor4B(colorsB.data(), targetB.data(), colorsB.data(), npoints, 0.5f);
+				}) << " us;";
+				stream << " progressColor4F: " << measure([&] {
+					table->progressColor4F(colorsF.data(), targetF.data(), colorsF.data(), npoints, 0.5f);
+				}) << " us;\n";
+			}
+			return true;
+		});
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+} SimdTest;
+
+NS_SP_END
@@ -26,11 +26,27 @@ THE SOFTWARE.
 #include "SPData.h"
 #include "SPString.h"
 #include "STRoot.h"
+#include "STTask.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
 
 #define HELP_STRING \
-	"SocketTest\n" \
+	"SocketTest <options>\n" \
+	"Options are one of:\n" \
+	"    --bench tasks - run task dispatch benchmark, reports tasks/sec\n" \
+	"    --workers <N> - number of workers for benchmark\n" \
+	"    --tasks <N> - number of tasks for benchmark\n" \
+	"    --bench accept - run connection benchmark, reports connections/sec and accept latency\n" \
+	"    --accept <shared|reuseport> - listener mode for benchmark\n" \
+	"    --clients <N> - number of client threads for benchmark\n" \
+	"    --connections <N> - number of connections for benchmark\n" \
+	"    --bench loopback - run keep-alive request benchmark, reports requests/sec and latency\n" \
+	"    --backend <epoll|uring> - worker io backend for benchmark\n" \
+	"    --requests <N> - number of requests for benchmark\n" \
 
-USING_NS_SP;
+using namespace stappler;
 
 static constexpr auto s_config = R"Config({
 	"listen": "127.0.0.1:8080",
@@ -63,13 +79,250 @@ int parseOptionSwitch(data::Value &ret, char c, const char *str) {
 	return 1;
 }
 
-int parseOptionString(data::Value &ret, const String &str, int argc, const char * argv[]) {
+static constexpr auto s_benchConfig = R"Config({
+	"listen": "none",
+	"hosts" : [
+		{
+			"name": "localhost",
+			"admin": "serenity@stappler.org",
+			"root": "$WORK_DIR/www"
+		}
+	]
+})Config";
+
+int parseOptionString(data::Value &ret, const StringView &str, int argc, const char * argv[]) {
 	if (str == "help") {
 		ret.setBool(true, "help");
+	} else if (str == "bench" && argc > 0) {
+		ret.setString(argv[0], "bench");
+		return 2;
+	} else if (str == "workers" && argc > 0) {
+		ret.setInteger(StringView(argv[0]).readInteger().get(), "workers");
+		return 2;
+	} else if (str == "tasks" && argc > 0) {
+		ret.setInteger(StringView(argv[0]).readInteger().get(), "tasks");
+		return 2;
+	} else if (str == "accept" && argc > 0) {
+		ret.setString(argv[0], "accept");
+		return 2;
+	} else if (str == "clients" && argc > 0) {
+		ret.setInteger(StringView(argv[0]).readInteger().get(), "clients");
+		return 2;
+	} else if (str == "connections" && argc > 0) {
+		ret.setInteger(StringView(argv[0]).readInteger().get(), "connections");
+		return 2;
+	} else if (str == "backend" && argc > 0) {
+		ret.setString(argv[0], "backend");
+		return 2;
+	} else if (str == "requests" && argc > 0) {
+		ret.setInteger(StringView(argv[0]).readInteger().get(), "requests");
+		return 2;
 	}
 	return 1;
 }
 
+// Pushes tasks from external thread and from within worker tasks (to test local queues and stealing),
+// reports tasks/sec for the configured number of workers
+static void runTaskBenchmark(stellator::Root *root, size_t nTasks) {
+	auto pool = memory::pool::create((memory::pool_t *)nullptr);
+	memory::pool::push(pool);
+
+	while (root->getThreadCount() == 0) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	auto serv = root->getRootServer();
+
+	std::atomic<size_t> counter(0);
+	stellator::TaskGroup group(serv);
+
+	auto spawnFn = [&] (size_t n) {
+		group.perform([&, n] (stellator::Task &task) {
+			task.addExecuteFn([&, n] (const stellator::Task &) -> bool {
+				// spawn child tasks into worker-local queue
+				for (size_t i = 0; i < n; ++ i) {
+					group.perform([&] (stellator::Task &task) {
+						task.addExecuteFn([&] (const stellator::Task &) -> bool {
+							++ counter;
+							return true;
+						});
+					});
+				}
+				++ counter;
+				return true;
+			});
+		});
+	};
+
+	static constexpr size_t ChildTasks = 7;
+
+	auto t = Time::now();
+	for (size_t i = 0; i < nTasks / (ChildTasks + 1); ++ i) {
+		spawnFn(ChildTasks);
+	}
+
+	group.waitForAll();
+	auto dt = Time::now() - t;
+
+	std::cout << "Workers: " << root->getThreadCount() << " Tasks: " << counter.load()
+			<< " Time: " << dt.toMicros() << "mks"
+			<< " Tasks/sec: " << size_t(counter.load() * 1'000'000.0 / std::max(dt.toMicros(), uint64_t(1))) << "\n";
+
+	memory::pool::pop();
+	memory::pool::destroy(pool);
+
+	root->scheduleCancel();
+}
+
+static constexpr int s_benchPort = 8081;
+
+// Every connection performs connect -> write -> read echo -> close, latency of this cycle is
+// measured, so it includes time, spent in listener queue before accept
+static void runAcceptBenchmark(stellator::Root *root, size_t nClients, size_t nConnections) {
+	while (root->getThreadCount() == 0) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+	addr.sin_port = htons(s_benchPort);
+
+	std::vector<std::vector<uint64_t>> latencies(nClients);
+	std::vector<std::thread> threads;
+	std::atomic<size_t> failed(0);
+
+	auto t = Time::now();
+	for (size_t i = 0; i < nClients; ++ i) {
+		threads.emplace_back([&, i] {
+			auto &lat = latencies[i];
+			lat.reserve(nConnections / nClients);
+			for (size_t j = 0; j < nConnections / nClients; ++ j) {
+				auto st = Time::now();
+				int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+				if (::connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+					char buf = 'a';
+					if (::write(fd, &buf, 1) == 1 && ::read(fd, &buf, 1) == 1) {
+						lat.emplace_back((Time::now() - st).toMicros());
+					} else {
+						++ failed;
+					}
+				} else {
+					++ failed;
+				}
+				::close(fd);
+			}
+		});
+	}
+
+	for (auto &it : threads) {
+		it.join();
+	}
+
+	auto dt = Time::now() - t;
+
+	std::vector<uint64_t> all;
+	for (auto &it : latencies) {
+		all.insert(all.end(), it.begin(), it.end());
+	}
+	std::sort(all.begin(), all.end());
+
+	auto percentile = [&] (double p) -> uint64_t {
+		return all.empty() ? 0 : all[std::min(all.size() - 1, size_t(all.size() * p))];
+	};
+
+	std::cout << "Workers: " << root->getThreadCount() << " Clients: " << nClients
+			<< " Connections: " << all.size() << " Failed: " << failed.load()
+			<< " Connections/sec: " << size_t(all.size() * 1'000'000.0 / std::max(dt.toMicros(), uint64_t(1)))
+			<< " p50: " << percentile(0.5) << "mks p99: " << percentile(0.99) << "mks\n";
+
+	root->scheduleCancel();
+}
+
+// Every client keeps single connection and performs small write -> read echo cycles on it
+static void runLoopbackBenchmark(stellator::Root *root, size_t nClients, size_t nRequests) {
+	while (root->getThreadCount() == 0) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+	addr.sin_port = htons(s_benchPort);
+
+	static constexpr size_t RequestSize = 64;
+
+	std::vector<std::vector<uint64_t>> latencies(nClients);
+	std::vector<std::thread> threads;
+	std::atomic<size_t> failed(0);
+
+	auto t = Time::now();
+	for (size_t i = 0; i < nClients; ++ i) {
+		threads.emplace_back([&, i] {
+			auto &lat = latencies[i];
+			lat.reserve(nRequests / nClients);
+
+			int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+			if (::connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+				failed += nRequests / nClients;
+				::close(fd);
+				return;
+			}
+
+			std::array<char, RequestSize> req;
+			std::array<char, RequestSize> resp;
+			memset(req.data(), 'a', req.size());
+
+			for (size_t j = 0; j < nRequests / nClients; ++ j) {
+				auto st = Time::now();
+				if (::write(fd, req.data(), req.size()) != ssize_t(req.size())) {
+					++ failed;
+					break;
+				}
+				size_t received = 0;
+				while (received < resp.size()) {
+					auto ret = ::read(fd, resp.data() + received, resp.size() - received);
+					if (ret <= 0) {
+						break;
+					}
+					received += ret;
+				}
+				if (received != resp.size()) {
+					++ failed;
+					break;
+				}
+				lat.emplace_back((Time::now() - st).toMicros());
+			}
+			::close(fd);
+		});
+	}
+
+	for (auto &it : threads) {
+		it.join();
+	}
+
+	auto dt = Time::now() - t;
+
+	std::vector<uint64_t> all;
+	for (auto &it : latencies) {
+		all.insert(all.end(), it.begin(), it.end());
+	}
+	std::sort(all.begin(), all.end());
+
+	auto percentile = [&] (double p) -> uint64_t {
+		return all.empty() ? 0 : all[std::min(all.size() - 1, size_t(all.size() * p))];
+	};
+
+	std::cout << "Workers: " << root->getThreadCount() << " Clients: " << nClients
+			<< " Requests: " << all.size() << " Failed: " << failed.load()
+			<< " Requests/sec: " << size_t(all.size() * 1'000'000.0 / std::max(dt.toMicros(), uint64_t(1)))
+			<< " p50: " << percentile(0.5) << "mks p99: " << percentile(0.99) << "mks\n";
+
+	root->scheduleCancel();
+}
+
 int _spMain(argc, argv) {
 	data::Value opts = data::parseCommandLineOptions(argc, argv,
 			&parseOptionSwitch, &parseOptionString);
@@ -81,10 +334,54 @@ int _spMain(argc, argv) {
 	stellator::Root * root = stellator::Root::getInstance();
 	memory::pool::push(root->pool());
 
-	auto val = data::read<StringView, stellator::mem::Interface>(StringView(s_config));
+	auto bench = opts.getString("bench");
+	auto val = data::read<StringView, stellator::mem::Interface>(StringView(bench.empty() ? s_config : s_benchConfig));
+	if (opts.isInteger("workers")) {
+		val.setInteger(opts.getInteger("workers"), "workers");
+	}
+	if (bench == "accept" || bench == "loopback") {
+		val.setString(toString("127.0.0.1:", s_benchPort), "listen");
+		if (opts.isString("accept")) {
+			val.setString(opts.getString("accept"), "accept");
+		}
+		if (opts.isString("backend")) {
+			val.setString(opts.getString("backend"), "ioBackend");
+		}
+	}
 
 	memory::pool::pop();
 
+	if (bench == "tasks") {
+		auto nTasks = size_t(opts.isInteger("tasks") ? opts.getInteger("tasks") : 1'000'000);
+		std::thread benchThread([&] {
+			runTaskBenchmark(root, nTasks);
+		});
+
+		root->run(val);
+		benchThread.join();
+		return 0;
+	} else if (bench == "accept") {
+		auto nClients = size_t(opts.isInteger("clients") ? opts.getInteger("clients") : 4);
+		auto nConnections = size_t(opts.isInteger("connections") ? opts.getInteger("connections") : 100'000);
+		std::thread benchThread([&] {
+			runAcceptBenchmark(root, nClients, nConnections);
+		});
+
+		root->run(val);
+		benchThread.join();
+		return 0;
+	} else if (bench == "loopback") {
+		auto nClients = size_t(opts.isInteger("clients") ? opts.getInteger("clients") : 16);
+		auto nRequests = size_t(opts.isInteger("requests") ? opts.getInteger("requests") : 1'000'000);
+		std::thread benchThread([&] {
+			runLoopbackBenchmark(root, nClients, nRequests);
+		});
+
+		root->run(val);
+		benchThread.join();
+		return 0;
+	}
+
 	root->run(val);
 
 	return 0;
@@ -27,6 +27,7 @@
 #include "SPData.h"
 #include "SPDataStream.h"
 #include "SPLog.h"
+#include "SPTime.h"
 
 #include "SPugLexer.h"
 #include "SPugTemplate.h"
@@ -401,9 +402,185 @@ else
 	p Failure
 )";
 
+const auto s_benchText = R"(
+doctype html
+html
+	head
+		title= title
+	body
+		mixin item(entry)
+			li(class=entry.active ? 'active' : 'inactive')
+				a(href="/items/" + entry.id)= entry.name
+				if entry.tags.length
+					each tag in entry.tags
+						span.tag= tag
+				else
+					span.empty No tags
+		h1= title
+		ul.items
+			each entry in items
+				+item(entry)
+		p.footer Rendered #{items.length} items
+)";
+
+static void runBenchmark(size_t count) {
+	using Value = pug::Value;
+
+	pug::Template * tpl = pug::Template::read(s_benchText, pug::Template::Options::getDefault());
+
+	Value items;
+	for (size_t i = 0; i < 50; ++ i) {
+		auto &item = items.emplace();
+		item.setInteger(i, "id");
+		item.setString(toString("Item #", i), "name");
+		item.setBool(i % 3 == 0, "active");
+		auto &tags = item.emplace("tags");
+		tags.setArray(Value::ArrayType());
+		for (size_t j = 0; j < i % 4; ++ j) {
+			tags.addString(toString("tag", j));
+		}
+	}
+
+	auto pool = memory::pool::create(memory::pool::acquire());
+	size_t bytes = 0;
+	auto t = Time::now();
+	for (size_t i = 0; i < count; ++ i) {
+		memory::pool::push(pool);
+		do {
+			pug::Context ctx;
+			ctx.set("title", Value("Benchmark"));
+			ctx.set("items", true, &items);
+
+			memory::ostringstream out;
+			tpl->run(ctx, out);
+			bytes += out.size();
+		} while (0);
+		memory::pool::pop();
+		memory::pool::clear(pool);
+	}
+	auto dt = std::max((Time::now() - t).toMicros(), uint64_t(1));
+	memory::pool::destroy(pool);
+
+	std::cout << " Rendered " << count << " times in " << dt << " us: " << size_t(count * 1'000'000.0 / dt)
+			<< " renders/sec, " << bytes / count << " bytes per page\n";
+}
+
+// templates above, rendered with pretty options, compared with output in test/expected/<name>.html
+static std::pair<StringView, const char *> s_goldenTemplates[] = {
+	std::make_pair("attr", s_attrText),
+	std::make_pair("attr2", s_attrText2),
+	std::make_pair("attr3", s_attrText3),
+	std::make_pair("output", s_outputText),
+	std::make_pair("code", s_codeText),
+	std::make_pair("var", s_varText),
+	std::make_pair("call", s_callText),
+	std::make_pair("tag", s_tagText),
+	std::make_pair("case", s_caseText),
+	std::make_pair("if", s_ifText),
+	std::make_pair("each", s_eachText),
+	std::make_pair("condop", s_condOpText),
+	std::make_pair("while", s_whileText),
+	std::make_pair("interp", s_InterpText),
+	std::make_pair("taginterp", s_tagInterpText),
+	std::make_pair("mixin", s_tagMixinText),
+	std::make_pair("mixinlist", s_tagMixinListText),
+	std::make_pair("mixincombo", s_tagMixinComboText),
+	std::make_pair("tagif", s_tagIfTest),
+	std::make_pair("not", s_notTest),
+	std::make_pair("recursion", s_recursionTest),
+	std::make_pair("undefined", s_undefinedTest),
+	std::make_pair("bench", s_benchText),
+};
+
+// with update flag, expected output is rewritten with actual one
+static bool runGoldenTests(bool update) {
+	using Value = pug::Value;
+
+	Value items;
+	for (size_t i = 0; i < 5; ++ i) {
+		auto &item = items.emplace();
+		item.setInteger(i, "id");
+		item.setString(toString("Item #", i), "name");
+		item.setBool(i % 3 == 0, "active");
+		auto &tags = item.emplace("tags");
+		tags.setArray(Value::ArrayType());
+		for (size_t j = 0; j < i % 4; ++ j) {
+			tags.addString(toString("tag", j));
+		}
+	}
+
+	Value test{
+		pair("value", Value("value1")),
+		pair("next", Value{
+			pair("value", Value("value2")),
+			pair("next", Value{
+				pair("value", Value("value3")),
+			}),
+		}),
+	};
+
+	Value unit{
+		pair("role", Value(10)),
+		pair("category", Value(2)),
+	};
+
+	size_t passed = 0;
+	for (auto &it : s_goldenTemplates) {
+		memory::ostringstream out;
+		auto tpl = pug::Template::read(it.second, pug::Template::Options::getPretty(), [&] (const StringView &err) {
+			out << "<!-- read error: " << err << " -->\n";
+		});
+
+		if (tpl) {
+			pug::Context ctx;
+			ctx.set("world", Value("World"));
+			ctx.set("title", Value("Title"));
+			ctx.set("items", true, &items);
+			ctx.set("test", true, &test);
+			ctx.set("unit", true, &unit);
+			ctx.set("func", [] (pug::VarStorage &self, pug::Var *args, size_t count) -> pug::Var {
+				if (count == 0) {
+					return pug::Var(Value("No arguments"));
+				} else {
+					memory::PoolInterface::StringStreamType stream;
+					for (size_t i = 0; i < count; ++ i) {
+						stream << " " << args[i].readValue();
+					}
+					return pug::Var(Value(stream.str()));
+				}
+			});
+
+			if (!tpl->run(ctx, out)) {
+				out << "\n<!-- run failed -->";
+			}
+		}
+
+		auto path = filesystem::currentDir(toString("test/expected/", it.first, ".html"));
+		auto result = out.str();
+		if (update) {
+			filesystem::write(path, (const uint8_t *)result.data(), result.size());
+			++ passed;
+		} else if (StringView(filesystem::readTextFile(path)) == StringView(result)) {
+			++ passed;
+		} else {
+			std::cout << " " << it.first << ": failed, expected output: " << path << "\n" << result << "\n";
+		}
+	}
+
+	auto count = sizeof(s_goldenTemplates) / sizeof(s_goldenTemplates[0]);
+	std::cout << " Golden tests: " << passed << " / " << count << " passed\n";
+	return passed == count;
+}
+
 int parseOptionSwitch(data::Value &ret, char c, const char *str) {
 	if (c == 'v') {
 		ret.setBool(true, "verbose");
+	} else if (c == 'b') {
+		ret.setBool(true, "bench");
+	} else if (c == 't') {
+		ret.setBool(true, "test");
+	} else if (c == 'u') {
+		ret.setBool(true, "update");
 	}
 	return 1;
 }
@@ -411,6 +588,12 @@ int parseOptionSwitch(data::Value &ret, char c, const char *str) {
 int parseOptionString(data::Value &ret, const StringView &str, int argc, const char * argv[]) {
 	if (str == "v") {
 		ret.setBool(true, "verbose");
+	} else if (str == "bench") {
+		ret.setBool(true, "bench");
+	} else if (str == "test") {
+		ret.setBool(true, "test");
+	} else if (str == "update") {
+		ret.setBool(true, "update");
 	}
 	return 1;
 }
@@ -429,6 +612,18 @@ int _spMain(argc, argv) {
 	auto pool = memory::pool::create(nullptr);
 	memory::pool::push(pool);
 
+	if (opts.getBool("bench")) {
+		runBenchmark(10'000);
+		memory::pool::pop();
+		return 0;
+	}
+
+	if (opts.getBool("test")) {
+		auto ret = runGoldenTests(opts.getBool("update"));
+		memory::pool::pop();
+		return ret ? 0 : -1;
+	}
+
 	//auto &args = opts.getValue("args");
 
 	pug::Template * tpl = pug::Template::read(s_undefinedTest, pug::Template::Options::getPretty());